@@ -0,0 +1,673 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <sys/socket.h>
+#include <pthread.h>
+
+#include "utils/cmdLineParser.h"
+#include "utils/debug.h"
+#include "utils/list.h"
+#include "common/protocol.h"
+#include "common/messages.h"
+#include "common/game.h"
+#include "common/gameEngine.h"
+#include "common/fleetPlacement.h"
+#include "common/metrics.h"
+#include "server/users.h"
+
+/**
+ * Micro-benchmark delle primitive più usate dal server:
+ * - protocollo: serializePayload, parsePayload, getPayloadIntValue su payload di dimensioni
+ *   diverse, escapeString e unescapeString su stringhe di lunghezze diverse, e l'andata e
+ *   ritorno di un messaggio (costruzione del payload, safeSendMsg, safeRecvMsg, lettura dei
+ *   campi) su una coppia di socket UNIX;
+ * - registri: add_node/release_node, get_node e get_user_socket_fd da 1 a `-threads` thread;
+ * - gioco: attack, place_ship, generate_turn_order ed engine_advance_turn (l'aggiornamento del
+ *   turno) con un numero diverso di giocatori, e la vita intera di uno stato di partita
+ *   (creazione, ingresso dei giocatori, flotte, avvio, free_game_state);
+ * - metriche: metrics_inc, metrics_count_msg_out, metrics_observe e le misure di latenza di un
+ *   messaggio da 1 a `-threads` thread, che non devono rallentare con più thread perché ognuno
+ *   scrive nel proprio shard.
+ *
+ * Ogni benchmark calibra il numero di operazioni in modo che una ripetizione duri circa
+ * `-time` / BENCH_REPETITIONS ms, poi esegue BENCH_REPETITIONS ripetizioni. I dati sono generati
+ * con un seed fisso, così due esecuzioni misurano esattamente le stesse operazioni.
+ *
+ * L'output è una tabella separata da tabulazioni, con una riga di intestazione, pensata per
+ * essere confrontata tra versioni diverse:
+ *   benchmark  param  threads  iterations  ns_per_op  ns_per_op_min  ops_per_s  allocs_per_op
+ * `ns_per_op` è la mediana delle ripetizioni e `ns_per_op_min` la migliore; con più thread
+ * ogni thread esegue `iterations` operazioni e `ops_per_s` è il totale di tutti i thread.
+ * `allocs_per_op` conta le chiamate a malloc, calloc e realloc (anche quelle fatte da strdup)
+ * per operazione, solo per i benchmark con un thread ("-" per gli altri).
+ */
+
+#define BENCH_REPETITIONS 5
+#define BENCH_SEED 12345
+#define BENCH_USERS 10000 // Utenti registrati per i benchmark dei registri
+#define MAX_BENCH_THREADS 64
+
+typedef void (*BenchFunction)(void *ctx, int thread_index, long iterations);
+
+typedef struct {
+    BenchFunction function;
+    void *ctx;
+    int thread_index;
+    long iterations;
+    pthread_barrier_t *barrier;
+} BenchThreadArg;
+
+static const char *filter = NULL;
+static long target_ns;
+static long max_threads;
+static volatile long sink; // Impedisce al compilatore di eliminare i risultati non usati
+static __thread long allocs_count; // Allocazioni fatte dal thread, contate dalle funzioni qui sotto
+
+/*
+ * Il benchmark sostituisce malloc, calloc e realloc della libc per contarne le chiamate; glibc
+ * chiama queste funzioni anche dall'interno della libreria (strdup, fopen...).
+ */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size) {
+    allocs_count++;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+    allocs_count++;
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size) {
+    allocs_count++;
+    return __libc_realloc(ptr, size);
+}
+
+static long now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000L + now.tv_nsec;
+}
+
+static int compare_long(const void *a, const void *b) {
+    long x = *(const long *)a, y = *(const long *)b;
+    return (x > y) - (x < y);
+}
+
+static void *bench_thread(void *arg) {
+    BenchThreadArg *thread_arg = (BenchThreadArg *)arg;
+    pthread_barrier_wait(thread_arg->barrier);
+    thread_arg->function(thread_arg->ctx, thread_arg->thread_index, thread_arg->iterations);
+    pthread_barrier_wait(thread_arg->barrier);
+    return NULL;
+}
+
+/**
+ * Esegue `iterations` operazioni su ogni thread e ne misura il tempo complessivo.
+ * Con un solo thread la funzione viene chiamata direttamente.
+ */
+static long run_once(BenchFunction function, void *ctx, int threads, long iterations) {
+    if (threads == 1) {
+        long start = now_ns();
+        function(ctx, 0, iterations);
+        return now_ns() - start;
+    }
+
+    pthread_t tids[MAX_BENCH_THREADS];
+    BenchThreadArg args[MAX_BENCH_THREADS];
+    pthread_barrier_t barrier;
+    pthread_barrier_init(&barrier, NULL, threads + 1);
+    for (int t = 0; t < threads; t++) {
+        args[t] = (BenchThreadArg){function, ctx, t, iterations, &barrier};
+        if (pthread_create(&tids[t], NULL, bench_thread, &args[t]) != 0) {
+            LOG_ERROR("Errore nella creazione del thread %d", t);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    pthread_barrier_wait(&barrier);
+    long start = now_ns();
+    pthread_barrier_wait(&barrier);
+    long elapsed = now_ns() - start;
+
+    for (int t = 0; t < threads; t++) {
+        pthread_join(tids[t], NULL);
+    }
+    pthread_barrier_destroy(&barrier);
+    return elapsed;
+}
+
+/**
+ * Calibra, ripete e stampa un benchmark, se il suo nome contiene il filtro indicato con -filter.
+ */
+static void run_bench(const char *name, const char *param, BenchFunction function, void *ctx, int threads) {
+    if (filter != NULL && strstr(name, filter) == NULL) return;
+
+    // Raddoppia le operazioni finché una ripetizione non raggiunge la durata richiesta
+    long repetition_ns = target_ns / BENCH_REPETITIONS;
+    long iterations = 1;
+    long elapsed = run_once(function, ctx, threads, iterations);
+    while (elapsed < repetition_ns && iterations < (1L << 40)) {
+        long scale = elapsed > 0 ? repetition_ns / elapsed : 2;
+        iterations *= scale < 2 ? 2 : scale > 100 ? 100 : scale;
+        elapsed = run_once(function, ctx, threads, iterations);
+    }
+
+    long samples[BENCH_REPETITIONS];
+    long allocs_start = allocs_count;
+    for (int r = 0; r < BENCH_REPETITIONS; r++) {
+        samples[r] = run_once(function, ctx, threads, iterations);
+    }
+    long allocs = allocs_count - allocs_start;
+    qsort(samples, BENCH_REPETITIONS, sizeof(long), compare_long);
+
+    double median = (double)samples[BENCH_REPETITIONS / 2] / iterations;
+    double best = (double)samples[0] / iterations;
+    char allocs_per_op[32] = "-";
+    if (threads == 1) {
+        snprintf(allocs_per_op, sizeof(allocs_per_op), "%.2f", (double)allocs / ((double)BENCH_REPETITIONS * iterations));
+    }
+    printf("%s\t%s\t%d\t%ld\t%.2f\t%.2f\t%.0f\t%s\n", name, param, threads, iterations, median, best,
+           median > 0 ? threads * 1e9 / median : 0.0, allocs_per_op);
+    fflush(stdout);
+}
+
+// ---------------------------------------------------------------------------------------------
+// Protocollo
+// ---------------------------------------------------------------------------------------------
+
+typedef struct {
+    Payload *payload;
+    char *serialized;
+    int lists;
+    char *raw; // Stringa da codificare, con un carattere speciale ogni 8
+    char *escaped;
+    int sockets[2]; // Coppia di socket UNIX per l'andata e ritorno
+} ProtocolCtx;
+
+/**
+ * Payload con `lists` liste come quelle di MSG_ATTACK_UPDATE.
+ */
+static Payload *build_attack_payload(int lists, unsigned int *rng_state) {
+    static const char *results[] = {"miss", "hit", "sunk", "eliminated"};
+    Payload *payload = createEmptyPayload();
+    for (int i = 0; i < lists; i++) {
+        addPayloadList(payload);
+        addPayloadKeyValuePairInt(payload, "attacker_id", rand_r(rng_state) % 100000);
+        addPayloadKeyValuePairInt(payload, "attacked_id", rand_r(rng_state) % 100000);
+        addPayloadKeyValuePairInt(payload, "x", rand_r(rng_state) % GRID_SIZE);
+        addPayloadKeyValuePairInt(payload, "y", rand_r(rng_state) % GRID_SIZE);
+        addPayloadKeyValuePair(payload, "result", results[rand_r(rng_state) % 4]);
+    }
+    return payload;
+}
+
+static void bench_serialize(void *arg, int thread_index, long iterations) {
+    (void)thread_index;
+    ProtocolCtx *ctx = (ProtocolCtx *)arg;
+    for (long i = 0; i < iterations; i++) {
+        char *serialized = serializePayload(ctx->payload);
+        sink += serialized[0];
+        free(serialized);
+    }
+}
+
+static void bench_parse(void *arg, int thread_index, long iterations) {
+    (void)thread_index;
+    ProtocolCtx *ctx = (ProtocolCtx *)arg;
+    for (long i = 0; i < iterations; i++) {
+        Payload *payload = parsePayload(ctx->serialized);
+        sink += payload->size;
+        freePayload(payload);
+    }
+}
+
+static void bench_get_int(void *arg, int thread_index, long iterations) {
+    (void)thread_index;
+    ProtocolCtx *ctx = (ProtocolCtx *)arg;
+    int value = 0;
+    for (long i = 0; i < iterations; i++) {
+        // Ultima lista: il caso peggiore della ricerca lineare tra le liste
+        getPayloadIntValue(ctx->payload, ctx->lists - 1, "y", &value);
+        sink += value;
+    }
+}
+
+/**
+ * Tutti i campi di tutte le liste lette per chiave, come facevano gli handler prima degli schemi.
+ */
+static void bench_get_fields(void *arg, int thread_index, long iterations) {
+    (void)thread_index;
+    ProtocolCtx *ctx = (ProtocolCtx *)arg;
+    for (long i = 0; i < iterations; i++) {
+        for (int l = 0; l < ctx->lists; l++) {
+            int attacker_id = 0, attacked_id = 0, x = 0, y = 0;
+            getPayloadIntValue(ctx->payload, l, "attacker_id", &attacker_id);
+            getPayloadIntValue(ctx->payload, l, "attacked_id", &attacked_id);
+            getPayloadIntValue(ctx->payload, l, "x", &x);
+            getPayloadIntValue(ctx->payload, l, "y", &y);
+            char *result = getPayloadValue(ctx->payload, l, "result");
+            sink += attacker_id + attacked_id + x + y + (result != NULL ? result[0] : 0);
+            free(result);
+        }
+    }
+}
+
+/**
+ * Gli stessi campi letti con il decoder generato dallo schema di MSG_ATTACK_UPDATE.
+ */
+static void bench_decode(void *arg, int thread_index, long iterations) {
+    (void)thread_index;
+    ProtocolCtx *ctx = (ProtocolCtx *)arg;
+    for (long i = 0; i < iterations; i++) {
+        // I record vengono allocati dall'arena del payload, riportata ogni volta al punto di partenza
+        ArenaMark mark = arena_mark(&ctx->payload->arena);
+        AttackResultRecord *shots;
+        int count = decode_attack_update_msg(ctx->payload, &shots);
+        sink += count > 0 ? shots[count - 1].y + shots[count - 1].result : 0;
+        arena_rewind(&ctx->payload->arena, mark);
+    }
+}
+
+/**
+ * Un messaggio come MSG_ATTACK_UPDATE dall'inizio alla fine: il payload viene costruito con
+ * l'encoder, inviato con safeSendMsg, ricevuto con safeTryRecvMsg e decodificato come farebbe
+ * l'handler, poi liberato.
+ */
+static void bench_round_trip(void *arg, int thread_index, long iterations) {
+    (void)thread_index;
+    ProtocolCtx *ctx = (ProtocolCtx *)arg;
+    AttackResultRecord *shots = (AttackResultRecord *)malloc(ctx->lists * sizeof(AttackResultRecord));
+    for (long i = 0; i < iterations; i++) {
+        for (int l = 0; l < ctx->lists; l++) {
+            shots[l] = (AttackResultRecord){l, l + 1, l % GRID_SIZE, (l * 7) % GRID_SIZE, ATTACK_RESULT_HIT};
+        }
+        Payload *payload = encode_attack_update_msg(shots, ctx->lists);
+        if (safeSendMsg(ctx->sockets[0], MSG_ATTACK_UPDATE, payload) < 0) {
+            LOG_ERROR("Invio non riuscito nel benchmark di andata e ritorno");
+            exit(EXIT_FAILURE);
+        }
+
+        uint16_t msg_type;
+        Payload *received = NULL;
+        if (safeTryRecvMsg(ctx->sockets[1], &msg_type, &received) != 1) {
+            LOG_ERROR("Ricezione non riuscita nel benchmark di andata e ritorno");
+            exit(EXIT_FAILURE);
+        }
+        AttackResultRecord *records;
+        int count = decode_attack_update_msg(received, &records);
+        for (int l = 0; l < count; l++) {
+            sink += records[l].x + records[l].y + records[l].result;
+        }
+        freePayload(received);
+    }
+    free(shots);
+}
+
+static void bench_escape(void *arg, int thread_index, long iterations) {
+    (void)thread_index;
+    ProtocolCtx *ctx = (ProtocolCtx *)arg;
+    for (long i = 0; i < iterations; i++) {
+        char *escaped = escapeString(ctx->raw);
+        sink += escaped[0];
+        free(escaped);
+    }
+}
+
+static void bench_unescape(void *arg, int thread_index, long iterations) {
+    (void)thread_index;
+    ProtocolCtx *ctx = (ProtocolCtx *)arg;
+    for (long i = 0; i < iterations; i++) {
+        char *raw = unescapeString(ctx->escaped);
+        sink += raw[0];
+        free(raw);
+    }
+}
+
+static void run_protocol_benchmarks(void) {
+    static const int LIST_COUNTS[] = {1, 8, 64, 512};
+    static const int STRING_LENGTHS[] = {16, 256, 4096};
+    static const char SPECIAL[] = "|:[],\\";
+    unsigned int rng_state = BENCH_SEED;
+    char param[32];
+
+    for (size_t s = 0; s < sizeof(LIST_COUNTS) / sizeof(LIST_COUNTS[0]); s++) {
+        ProtocolCtx ctx = {0};
+        ctx.lists = LIST_COUNTS[s];
+        ctx.payload = build_attack_payload(ctx.lists, &rng_state);
+        ctx.serialized = serializePayload(ctx.payload);
+        snprintf(param, sizeof(param), "lists=%d", ctx.lists);
+
+        run_bench("protocol.serialize", param, bench_serialize, &ctx, 1);
+        run_bench("protocol.parse", param, bench_parse, &ctx, 1);
+        run_bench("protocol.get_int", param, bench_get_int, &ctx, 1);
+        run_bench("protocol.get_fields", param, bench_get_fields, &ctx, 1);
+        run_bench("protocol.decode", param, bench_decode, &ctx, 1);
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, ctx.sockets) == 0) {
+            run_bench("protocol.round_trip", param, bench_round_trip, &ctx, 1);
+            close(ctx.sockets[0]);
+            close(ctx.sockets[1]);
+        }
+
+        freePayload(ctx.payload);
+        free(ctx.serialized);
+    }
+
+    for (size_t s = 0; s < sizeof(STRING_LENGTHS) / sizeof(STRING_LENGTHS[0]); s++) {
+        ProtocolCtx ctx = {0};
+        int length = STRING_LENGTHS[s];
+        ctx.raw = (char *)malloc(length + 1);
+        for (int i = 0; i < length; i++) {
+            ctx.raw[i] = i % 8 == 7 ? SPECIAL[rand_r(&rng_state) % (sizeof(SPECIAL) - 1)] : 'a' + rand_r(&rng_state) % 26;
+        }
+        ctx.raw[length] = '\0';
+        ctx.escaped = escapeString(ctx.raw);
+        snprintf(param, sizeof(param), "bytes=%d", length);
+
+        run_bench("protocol.escape", param, bench_escape, &ctx, 1);
+        run_bench("protocol.unescape", param, bench_unescape, &ctx, 1);
+
+        free(ctx.raw);
+        free(ctx.escaped);
+    }
+}
+
+// ---------------------------------------------------------------------------------------------
+// Registri
+// ---------------------------------------------------------------------------------------------
+
+typedef struct {
+    ListManager *list;
+    unsigned int *user_ids;
+    int users_count;
+} RegistryCtx;
+
+static void bench_add_release(void *arg, int thread_index, long iterations) {
+    (void)thread_index;
+    RegistryCtx *ctx = (RegistryCtx *)arg;
+    for (long i = 0; i < iterations; i++) {
+        ListItem *node = add_node(ctx->list, ctx);
+        release_node(ctx->list, node->index);
+    }
+}
+
+static void bench_get_node(void *arg, int thread_index, long iterations) {
+    RegistryCtx *ctx = (RegistryCtx *)arg;
+    unsigned int rng_state = BENCH_SEED + thread_index;
+    long found = 0;
+    for (long i = 0; i < iterations; i++) {
+        ListItem *node = get_node(ctx->user_ids[rand_r(&rng_state) % ctx->users_count], ctx->list);
+        found += node->ptr != NULL;
+    }
+    sink += found;
+}
+
+static void bench_get_user_socket_fd(void *arg, int thread_index, long iterations) {
+    RegistryCtx *ctx = (RegistryCtx *)arg;
+    unsigned int rng_state = BENCH_SEED + thread_index;
+    long total = 0;
+    for (long i = 0; i < iterations; i++) {
+        total += get_user_socket_fd(ctx->user_ids[rand_r(&rng_state) % ctx->users_count]);
+    }
+    sink += total;
+}
+
+static void run_registry_benchmarks(void) {
+    RegistryCtx ctx;
+    ctx.list = create_list_manager();
+    ctx.users_count = BENCH_USERS;
+    ctx.user_ids = (unsigned int *)malloc(BENCH_USERS * sizeof(unsigned int));
+
+    // Gli utenti registrati occupano i primi nodi: add_node riusa sempre la testa della free-list
+    init_lists();
+    char username[32];
+    for (int i = 0; i < BENCH_USERS; i++) {
+        snprintf(username, sizeof(username), "user%d", i);
+        ctx.user_ids[i] = (unsigned int)create_user(username, 1000 + i);
+        add_node(ctx.list, &ctx.user_ids[i]);
+    }
+
+    char param[32];
+    snprintf(param, sizeof(param), "users=%d", BENCH_USERS);
+    // Potenze di 2 fino a -threads, che viene sempre misurato
+    for (int threads = 1; ; threads = threads * 2 < max_threads ? threads * 2 : max_threads) {
+        run_bench("registry.add_release", param, bench_add_release, &ctx, threads);
+        run_bench("registry.get_node", param, bench_get_node, &ctx, threads);
+        run_bench("registry.get_user_socket_fd", param, bench_get_user_socket_fd, &ctx, threads);
+        if (threads == max_threads) break;
+    }
+
+    free(ctx.user_ids);
+}
+
+// ---------------------------------------------------------------------------------------------
+// Gioco
+// ---------------------------------------------------------------------------------------------
+
+typedef struct {
+    PlayerState player; // Giocatore con la flotta piazzata, bersaglio di `attack`
+    FleetSetup fleet;
+    GameBoard placed_board; // Griglia del giocatore prima degli attacchi
+    GameBoard empty_board;
+    int cells[GRID_SIZE * GRID_SIZE]; // Ordine casuale in cui vengono attaccate le celle
+    GameState *game; // Partita in corso per i benchmark dei turni
+    GameEventList events;
+    int players; // Giocatori delle partite create da `game.lifecycle`
+} GameCtx;
+
+static void bench_attack(void *arg, int thread_index, long iterations) {
+    (void)thread_index;
+    GameCtx *ctx = (GameCtx *)arg;
+    long results = 0;
+    for (long i = 0; i < iterations; i++) {
+        int cell = ctx->cells[i % (GRID_SIZE * GRID_SIZE)];
+        if (cell == ctx->cells[0]) {
+            // Una volta colpite tutte le celle si riparte dalla griglia iniziale
+            ctx->player.board = ctx->placed_board;
+        }
+        results += attack(&ctx->player, cell / GRID_SIZE, cell % GRID_SIZE);
+    }
+    sink += results;
+}
+
+static void bench_place_ship(void *arg, int thread_index, long iterations) {
+    (void)thread_index;
+    GameCtx *ctx = (GameCtx *)arg;
+    GameBoard board = ctx->empty_board;
+    long results = 0;
+    for (long i = 0; i < iterations; i++) {
+        int ship = i % NUM_SHIPS;
+        if (ship == 0) {
+            board = ctx->empty_board;
+        }
+        results += place_ship(&board, &ctx->fleet.ships[ship]);
+    }
+    sink += results;
+}
+
+static void bench_generate_turn_order(void *arg, int thread_index, long iterations) {
+    (void)thread_index;
+    GameCtx *ctx = (GameCtx *)arg;
+    for (long i = 0; i < iterations; i++) {
+        generate_turn_order(ctx->game);
+        sink += ctx->game->player_turn_order[0];
+    }
+}
+
+static void bench_advance_turn(void *arg, int thread_index, long iterations) {
+    (void)thread_index;
+    GameCtx *ctx = (GameCtx *)arg;
+    for (long i = 0; i < iterations; i++) {
+        clear_game_event_list(&ctx->events);
+        engine_advance_turn(ctx->game, &ctx->events);
+    }
+    sink += ctx->game->player_turn;
+}
+
+/**
+ * Partita in corso con `players` giocatori e flotte casuali.
+ */
+static GameState *build_game(int players, unsigned int *rng_state) {
+    GameState *game = engine_create_game(1, "bench", 0, BENCH_SEED);
+    char username[24];
+    for (int i = 0; i < players; i++) {
+        FleetSetup fleet;
+        snprintf(username, sizeof(username), "player%d", i);
+        generate_random_fleet(&fleet, game->rules->fleet, rng_state);
+        if (engine_join(game, i, username, NULL) != ENGINE_OK || engine_place_fleet(game, i, &fleet, NULL) != ENGINE_OK) {
+            LOG_ERROR("Preparazione della partita di benchmark fallita");
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (engine_start(game, NULL) != ENGINE_OK) {
+        LOG_ERROR("Avvio della partita di benchmark fallito");
+        exit(EXIT_FAILURE);
+    }
+    return game;
+}
+
+static void bench_game_lifecycle(void *arg, int thread_index, long iterations) {
+    (void)thread_index;
+    GameCtx *ctx = (GameCtx *)arg;
+    unsigned int rng_state = BENCH_SEED;
+    for (long i = 0; i < iterations; i++) {
+        GameState *game = build_game(ctx->players, &rng_state);
+        sink += game->players_count;
+        free_game_state(game);
+    }
+}
+
+static void run_game_benchmarks(void) {
+    static const int PLAYER_COUNTS[] = {2, 8, 64};
+    unsigned int rng_state = BENCH_SEED;
+    GameCtx ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    init_game_event_list(&ctx.events);
+
+    generate_random_fleet(&ctx.fleet, get_game_rules(0)->fleet, &rng_state);
+    init_board(&ctx.empty_board);
+    ctx.player.board = ctx.empty_board;
+    for (int i = 0; i < NUM_SHIPS; i++) {
+        place_ship(&ctx.player.board, &ctx.fleet.ships[i]);
+    }
+    ctx.player.board.ships_left = NUM_SHIPS;
+    ctx.player.fleet = &ctx.fleet;
+    ctx.placed_board = ctx.player.board;
+
+    for (int c = 0; c < GRID_SIZE * GRID_SIZE; c++) ctx.cells[c] = c;
+    for (int c = GRID_SIZE * GRID_SIZE - 1; c > 0; c--) {
+        int j = rand_r(&rng_state) % (c + 1);
+        int temp = ctx.cells[c];
+        ctx.cells[c] = ctx.cells[j];
+        ctx.cells[j] = temp;
+    }
+
+    run_bench("game.attack", "cells=100", bench_attack, &ctx, 1);
+    run_bench("game.place_ship", "ships=5", bench_place_ship, &ctx, 1);
+
+    char param[32];
+    for (size_t p = 0; p < sizeof(PLAYER_COUNTS) / sizeof(PLAYER_COUNTS[0]); p++) {
+        ctx.game = build_game(PLAYER_COUNTS[p], &rng_state);
+        snprintf(param, sizeof(param), "players=%d", PLAYER_COUNTS[p]);
+        run_bench("game.advance_turn", param, bench_advance_turn, &ctx, 1);
+        run_bench("game.generate_turn_order", param, bench_generate_turn_order, &ctx, 1);
+        free_game_state(ctx.game);
+
+        ctx.players = PLAYER_COUNTS[p];
+        run_bench("game.lifecycle", param, bench_game_lifecycle, &ctx, 1);
+    }
+
+    free_game_event_list(&ctx.events);
+}
+
+// ---------------------------------------------------------------------------------------------
+// Metriche
+// ---------------------------------------------------------------------------------------------
+
+static void bench_metrics_inc(void *arg, int thread_index, long iterations) {
+    (void)arg;
+    (void)thread_index;
+    for (long i = 0; i < iterations; i++) {
+        metrics_inc(METRIC_LOGINS);
+    }
+}
+
+static void bench_metrics_count_msg(void *arg, int thread_index, long iterations) {
+    (void)arg;
+    (void)thread_index;
+    for (long i = 0; i < iterations; i++) {
+        metrics_count_msg_out((uint16_t)(i & 15), 64);
+    }
+}
+
+static void bench_metrics_observe(void *arg, int thread_index, long iterations) {
+    (void)arg;
+    (void)thread_index;
+    for (long i = 0; i < iterations; i++) {
+        metrics_observe(METRIC_STAGE_HANDLE, MSG_ATTACK, 1000 + (i & 1023) * 37);
+    }
+}
+
+// Misure registrate per ogni messaggio ricevuto: inizio, parsing, invio a tutti e fine dell'handler
+static void bench_metrics_message(void *arg, int thread_index, long iterations) {
+    (void)arg;
+    (void)thread_index;
+    metrics_loop_woke();
+    for (long i = 0; i < iterations; i++) {
+        metrics_msg_begin();
+        metrics_msg_parsed(MSG_ATTACK, metrics_now_ns());
+        metrics_fanout_begin();
+        metrics_fanout_end();
+        metrics_msg_end(MSG_ATTACK);
+    }
+}
+
+static void run_metrics_benchmarks(void) {
+    for (int threads = 1; ; threads = threads * 2 < max_threads ? threads * 2 : max_threads) {
+        run_bench("metrics.inc", "-", bench_metrics_inc, NULL, threads);
+        run_bench("metrics.count_msg_out", "-", bench_metrics_count_msg, NULL, threads);
+        run_bench("metrics.observe", "-", bench_metrics_observe, NULL, threads);
+        run_bench("metrics.message", "stages=5", bench_metrics_message, NULL, threads);
+        if (threads == max_threads) break;
+    }
+
+    MetricsSnapshot snapshot;
+    metrics_snapshot(&snapshot);
+    sink += snapshot.values[METRIC_LOGINS];
+}
+
+static long parse_long_param(ArgvParam *args, char *name, long default_value, long min_value) {
+    char *value = getArgvParamValue(name, args);
+    if (value == NULL) return default_value;
+
+    char *endPtr;
+    long result = strtol(value, &endPtr, 0);
+    if (*endPtr || result < min_value) {
+        LOG_ERROR("Valore non valido per -%s: %s", name, value);
+        exit(EXIT_FAILURE);
+    }
+    return result;
+}
+
+int main(int argc, char *argv[]) {
+    ArgvParam *allowedArgs = setArgvParams("-Vfilter,-Vtime,-Vthreads");
+    parseCmdLine(argc, argv, allowedArgs);
+
+    filter = getArgvParamValue("filter", allowedArgs);
+    target_ns = parse_long_param(allowedArgs, "time", 250, 1) * 1000000L;
+    max_threads = parse_long_param(allowedArgs, "threads", sysconf(_SC_NPROCESSORS_ONLN), 1);
+    if (max_threads > MAX_BENCH_THREADS) max_threads = MAX_BENCH_THREADS;
+
+    printf("benchmark\tparam\tthreads\titerations\tns_per_op\tns_per_op_min\tops_per_s\tallocs_per_op\n");
+    run_protocol_benchmarks();
+    run_registry_benchmarks();
+    run_game_benchmarks();
+    run_metrics_benchmarks();
+    return EXIT_SUCCESS;
+}
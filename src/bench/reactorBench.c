@@ -0,0 +1,322 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include "utils/cmdLineParser.h"
+#include "utils/debug.h"
+#include "common/metrics.h"
+#include "common/protocol.h"
+#include "server/reactor.h"
+
+/**
+ * Benchmark dei backend del reactor sul percorso dei messaggi del server.
+ * Apre N connessioni TCP in loopback: il lato server resta in questo processo ed è registrato con
+ * reactor_add_edge come fa la lobby, il lato client passa a un processo figlio, così ogni processo
+ * tiene un solo descrittore per connessione. A ogni giro il figlio invia un messaggio su `batch`
+ * connessioni scelte a caso e ne attende le risposte, misurando la latenza di andata e ritorno; il
+ * server legge con safeTryRecvMsg e risponde con safeSendMsg. Con `-churn P` il P% delle
+ * connessioni servite viene rimosso e registrato di nuovo, come un client che passa dalla lobby a
+ * una partita. Il server riporta le chiamate di sistema per messaggio: quelle del reactor
+ * (attese e registrazioni) e le recv e send sulle connessioni (METRIC_SOCKET_SYSCALLS), che con
+ * il backend uring passano dal ring.
+ */
+
+#define MAX_BENCH_EVENTS 256
+
+static long parse_long_param(ArgvParam *args, char *name, long default_value, long min_value) {
+    char *value = getArgvParamValue(name, args);
+    if (value == NULL) return default_value;
+
+    char *endPtr;
+    long result = strtol(value, &endPtr, 0);
+    if (*endPtr || result < min_value) {
+        LOG_ERROR("Valore non valido per -%s: %s", name, value);
+        exit(EXIT_FAILURE);
+    }
+    return result;
+}
+
+static long elapsed_ns(const struct timespec *from, const struct timespec *to) {
+    return (to->tv_sec - from->tv_sec) * 1000000000L + (to->tv_nsec - from->tv_nsec);
+}
+
+static int compare_long(const void *a, const void *b) {
+    long x = *(const long *)a, y = *(const long *)b;
+    return (x > y) - (x < y);
+}
+
+static void set_nodelay(int fd) {
+    int nodelay = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+}
+
+/**
+ * Lato client, nel processo figlio: apre le connessioni, attende il via del server e invia i
+ * messaggi a gruppi su connessioni distinte, come client che giocano insieme.
+ * @param start_fd Pipe da cui arriva il via, dopo che il server ha registrato tutte le connessioni.
+ */
+static int run_clients(const struct sockaddr_in *address, long connections, long messages, long batch, int start_fd) {
+    int *fds = (int *)malloc(connections * sizeof(int));
+    char *busy = (char *)calloc(connections, 1);
+    long *latencies = (long *)malloc(messages * sizeof(long));
+    long *slots = (long *)malloc(batch * sizeof(long));
+    struct timespec *sent_at = (struct timespec *)malloc(batch * sizeof(struct timespec));
+    if (!fds || !busy || !latencies || !slots || !sent_at) {
+        LOG_ERROR("Allocazione dei client fallita");
+        return EXIT_FAILURE;
+    }
+
+    for (long i = 0; i < connections; i++) {
+        fds[i] = socket(AF_INET, SOCK_STREAM, 0);
+        if (fds[i] < 0 || connect(fds[i], (const struct sockaddr *)address, sizeof(*address)) < 0) {
+            LOG_ERROR("Errore nella connessione %ld: %s", i, strerror(errno));
+            return EXIT_FAILURE;
+        }
+        set_nodelay(fds[i]);
+    }
+    char go;
+    if (read(start_fd, &go, 1) != 1) {
+        return EXIT_FAILURE; // Il server è terminato prima del via
+    }
+
+    unsigned int seed = 1;
+    long received = 0;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    while (received < messages) {
+        long in_flight = 0;
+        while (in_flight < batch && received + in_flight < messages) {
+            long conn = rand_r(&seed) % connections;
+            if (busy[conn]) continue;
+            busy[conn] = 1;
+            slots[in_flight] = conn;
+            clock_gettime(CLOCK_MONOTONIC, &sent_at[in_flight]);
+            Payload *payload = createEmptyPayload();
+            addPayloadKeyValuePairInt(payload, "seq", (int)(received + in_flight));
+            if (safeSendMsg(fds[conn], MSG_ATTACK, payload) < 0) {
+                LOG_ERROR("Errore nell'invio sulla connessione %ld", conn);
+                return EXIT_FAILURE;
+            }
+            in_flight++;
+        }
+
+        for (long n = 0; n < in_flight; n++) {
+            uint16_t msg_type;
+            Payload *payload = NULL;
+            if (safeRecvMsg(fds[slots[n]], &msg_type, &payload) < 0) {
+                LOG_ERROR("Risposta mancante sulla connessione %ld", slots[n]);
+                return EXIT_FAILURE;
+            }
+            freePayload(payload);
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            latencies[received++] = elapsed_ns(&sent_at[n], &now);
+            busy[slots[n]] = 0;
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = elapsed_ns(&start, &end) / 1e9;
+    qsort(latencies, received, sizeof(long), compare_long);
+    printf("latenza p50:        %.1f us\n", latencies[received / 2] / 1e3);
+    printf("latenza p99:        %.1f us\n", latencies[(long)(received * 0.99)] / 1e3);
+    printf("latenza max:        %.1f us\n", latencies[received - 1] / 1e3);
+    printf("messaggi/s:         %.0f\n", elapsed > 0 ? received / elapsed : 0.0);
+    fflush(stdout);
+
+    for (long i = 0; i < connections; i++) {
+        closeConnection(fds[i]);
+    }
+    free(fds);
+    free(busy);
+    free(latencies);
+    free(slots);
+    free(sent_at);
+    return EXIT_SUCCESS;
+}
+
+static int64_t socket_syscalls(void) {
+    MetricsSnapshot snapshot;
+    metrics_snapshot(&snapshot);
+    return snapshot.values[METRIC_SOCKET_SYSCALLS];
+}
+
+/**
+ * Lato server: legge i messaggi arrivati su una connessione e risponde a ciascuno.
+ * @return Messaggi serviti, -1 se la connessione è stata chiusa o ha dato errore.
+ */
+static int serve_connection(Reactor *reactor, int fd, long conn, long churn, unsigned int *seed) {
+    int served = 0;
+    for (int budget = REACTOR_CONNECTION_BUDGET; budget > 0; budget--) {
+        uint16_t msg_type;
+        Payload *payload = NULL;
+        int received = safeTryRecvMsg(fd, &msg_type, &payload);
+        if (received == 0) {
+            return served;
+        }
+        if (received < 0) {
+            return -1;
+        }
+        int seq = 0;
+        getPayloadIntValue(payload, 0, "seq", &seq);
+        freePayload(payload);
+
+        Payload *reply = createEmptyPayload();
+        addPayloadKeyValuePairInt(reply, "seq", seq);
+        if (safeSendMsg(fd, MSG_ATTACK_UPDATE, reply) < 0) {
+            return -1;
+        }
+        served++;
+
+        if (churn > 0 && rand_r(seed) % 100 < churn) {
+            // I messaggi rimasti, già ricevuti, fanno restituire la connessione dalla prossima attesa
+            reactor_remove(reactor, fd);
+            reactor_add_edge(reactor, fd, (uint64_t)conn);
+            return served;
+        }
+    }
+    reactor_defer(reactor, fd, (uint64_t)conn);
+    return served;
+}
+
+int main(int argc, char *argv[]) {
+    ArgvParam *allowedArgs = setArgvParams("-Vconnections,-Vmessages,-Vbatch,-Vchurn,-Vreactor");
+    parseCmdLine(argc, argv, allowedArgs);
+
+    long connections = parse_long_param(allowedArgs, "connections", 50000, 1);
+    long messages = parse_long_param(allowedArgs, "messages", 200000, 1);
+    long batch = parse_long_param(allowedArgs, "batch", 16, 1);
+    long churn = parse_long_param(allowedArgs, "churn", 0, 0);
+    char *backend = getArgvParamValue("reactor", allowedArgs);
+    if (reactor_select_backend(backend != NULL ? backend : "epoll") < 0) {
+        exit(EXIT_FAILURE);
+    }
+
+    // Ogni processo tiene un descrittore per connessione: si alza il limite fin dove consentito
+    struct rlimit limit;
+    getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+    long max_connections = (long)limit.rlim_cur - 64;
+    if (connections > max_connections) {
+        LOG_WARNING("Limite di %ld descrittori: le connessioni passano da %ld a %ld", (long)limit.rlim_cur, connections, max_connections);
+        connections = max_connections;
+    }
+    if (batch > connections) batch = connections;
+    if (batch > MAX_BENCH_EVENTS) batch = MAX_BENCH_EVENTS;
+
+    int listen_s = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address;
+    socklen_t address_len = sizeof(address);
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int start_pipe[2];
+    if (listen_s < 0 || bind(listen_s, (struct sockaddr *)&address, sizeof(address)) < 0 ||
+        listen(listen_s, SOMAXCONN) < 0 || getsockname(listen_s, (struct sockaddr *)&address, &address_len) < 0 ||
+        pipe(start_pipe) < 0) {
+        LOG_ERROR("Errore nella creazione della socket del benchmark: %s", strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    fflush(stdout);
+    pid_t child = fork();
+    if (child < 0) {
+        LOG_ERROR("Errore nella creazione del processo dei client: %s", strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    if (child == 0) {
+        close(listen_s);
+        close(start_pipe[1]);
+        exit(run_clients(&address, connections, messages, batch, start_pipe[0]));
+    }
+    close(start_pipe[0]);
+
+    int *server_fds = (int *)malloc(connections * sizeof(int));
+    Reactor *reactor = reactor_create();
+    if (!server_fds || !reactor) {
+        LOG_ERROR("Allocazione del benchmark fallita");
+        kill(child, SIGKILL);
+        exit(EXIT_FAILURE);
+    }
+    for (long i = 0; i < connections; i++) {
+        server_fds[i] = accept(listen_s, NULL, NULL);
+        if (server_fds[i] < 0) {
+            LOG_ERROR("Errore nell'accettazione della connessione %ld: %s", i, strerror(errno));
+            kill(child, SIGKILL);
+            exit(EXIT_FAILURE);
+        }
+        set_nodelay(server_fds[i]);
+        reactor_add_edge(reactor, server_fds[i], (uint64_t)i);
+    }
+    close(listen_s);
+
+    printf("reactor:            %s\n", reactor_backend_name());
+    printf("connessioni:        %ld\n", connections);
+    printf("gruppi:             %ld messaggi, churn %ld%%\n", batch, churn);
+    fflush(stdout);
+
+    unsigned int seed = 1;
+    uint64_t base_reactor = reactor_syscalls(reactor);
+    int64_t base_socket = socket_syscalls();
+    long served = 0;
+    if (write(start_pipe[1], "g", 1) != 1) {
+        LOG_ERROR("Errore nell'avvio dei client");
+        kill(child, SIGKILL);
+        exit(EXIT_FAILURE);
+    }
+
+    while (served < messages) {
+        ReactorEvent events[MAX_BENCH_EVENTS];
+        int nfds = reactor_wait(reactor, events, MAX_BENCH_EVENTS, 1000);
+        if (nfds <= 0) {
+            LOG_ERROR("Il reactor non ha segnalato messaggi in attesa dopo %ld risposte", served);
+            kill(child, SIGKILL);
+            exit(EXIT_FAILURE);
+        }
+        for (int n = 0; n < nfds; n++) {
+            long conn = (long)events[n].tag;
+            int result = serve_connection(reactor, server_fds[conn], conn, churn, &seed);
+            if (result < 0) {
+                LOG_ERROR("Connessione %ld chiusa dopo %ld risposte", conn, served);
+                kill(child, SIGKILL);
+                exit(EXIT_FAILURE);
+            }
+            served += result;
+        }
+    }
+    // Le ultime risposte accodate partono con un'attesa, come nel ciclo di un thread del server
+    ReactorEvent last_events[1];
+    reactor_wait(reactor, last_events, 1, 0);
+
+    uint64_t reactor_calls = reactor_syscalls(reactor) - base_reactor;
+    int64_t socket_calls = socket_syscalls() - base_socket;
+    int status;
+    if (waitpid(child, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+        LOG_ERROR("Il processo dei client è terminato con un errore");
+        exit(EXIT_FAILURE);
+    }
+
+    printf("messaggi:           %ld\n", served);
+    printf("syscall/messaggio:  %.2f (reactor %.2f, socket %.2f)\n", (double)(reactor_calls + socket_calls) / served,
+           (double)reactor_calls / served, (double)socket_calls / served);
+
+    reactor_destroy(reactor);
+    for (long i = 0; i < connections; i++) {
+        closeConnection(server_fds[i]);
+    }
+    free(server_fds);
+    return EXIT_SUCCESS;
+}
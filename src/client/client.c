@@ -6,6 +6,7 @@
 
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/un.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <netinet/in.h>
@@ -15,9 +16,13 @@
 #include "utils/debug.h"
 #include "utils/userInput.h"
 #include "common/protocol.h"
+#include "common/shmTransport.h"
 #include "client/clientGameManager.h"
 
 void menu(int conn_s);
+int connect_to_server(const char *address, int port);
+int connect_to_local_server(const char *path);
+int follow_redirect(int conn_s, Payload *redirectPayload);
 void cleanup_on_exit();
 void cleanup_and_exit_handler();
 
@@ -29,45 +34,48 @@ int main(int argc, char *argv[]){
     signal(SIGTERM, cleanup_and_exit_handler); // Gestisce la terminazione del processo
     signal(SIGPIPE, SIG_IGN);
 
-    ArgvParam *allowedArgs = setArgvParams("RVaddress,RVport");
+    ArgvParam *allowedArgs = setArgvParams("-Vaddress,-Vport,-Vunix,-Vshm");
     parseCmdLine(argc, argv, allowedArgs);
 
     char *addressString = getArgvParamValue("address", allowedArgs);
     char *portString = getArgvParamValue("port", allowedArgs);
+    char *unixPath = getArgvParamValue("unix", allowedArgs);
+    char *shmPath = getArgvParamValue("shm", allowedArgs);
 
-    int port;
-    if (getIntFromString(portString, &port) != 0) {
-        LOG_ERROR("Porta non riconosciuta");
-        exit(EXIT_FAILURE);
-    }
-    
-    struct sockaddr_in servaddr;
-    memset(&servaddr, 0, sizeof(servaddr));
-    servaddr.sin_family = AF_INET;
-    servaddr.sin_port = htons(port);
-
-    struct hostent *he = NULL;
-    if(inet_aton(addressString, &servaddr.sin_addr) <= 0){
-
-        if((he = gethostbyname(addressString)) == NULL){
-            LOG_ERROR("Indirizzo IP non valido, risoluzione nome fallita");
+    int conn_s; // connection socket
+    if (unixPath != NULL || shmPath != NULL) {
+        // Server sulla stessa macchina: socket UNIX, con -shm anche la memoria condivisa
+        conn_s = connect_to_local_server(shmPath != NULL ? shmPath : unixPath);
+        if (conn_s < 0) {
+            exit(EXIT_FAILURE);
+        }
+        if (shmPath != NULL) {
+            int attached = shm_request_channel(conn_s);
+            if (attached < 0) {
+                LOG_ERROR("Errore durante il passaggio alla memoria condivisa");
+                exit(EXIT_FAILURE);
+            }
+            if (attached > 0) {
+                LOG_WARNING("Il server non offre la memoria condivisa, la connessione prosegue sulla socket UNIX");
+            }
+        }
+    } else {
+        if (addressString == NULL || portString == NULL) {
+            printf("Specificare -address e -port, oppure -unix o -shm con il percorso della socket UNIX del server\n");
+            printUsage(argv[0], allowedArgs);
             exit(EXIT_FAILURE);
         }
 
-        servaddr.sin_addr = *((struct in_addr *)he->h_addr_list[0]);
-    }
-
-    int conn_s; // connection socket
-    if((conn_s = socket(AF_INET, SOCK_STREAM, 0)) < 0){
-        LOG_ERROR("Errore durante la creazione della socket");
-        exit(EXIT_FAILURE);
-    }
+        int port;
+        if (getIntFromString(portString, &port) != 0) {
+            LOG_ERROR("Porta non riconosciuta");
+            exit(EXIT_FAILURE);
+        }
 
-    conn_socket_for_exit = conn_s; // Salvo il socket per la chiusura in caso di errore
-    
-    if(connect(conn_s, (struct sockaddr *) &servaddr, sizeof(servaddr)) < 0){
-        LOG_ERROR("Errore durante la connect");
-        exit(EXIT_FAILURE);
+        conn_s = connect_to_server(addressString, port);
+        if (conn_s < 0) {
+            exit(EXIT_FAILURE);
+        }
     }
 
 
@@ -116,6 +124,17 @@ int main(int argc, char *argv[]){
                 LOG_ERROR("ID dell'utente non trovato nel payload");
                 exit(EXIT_FAILURE);
             }
+
+            // Dopo un riavvio del server il giocatore di una partita ripristinata vi rientra direttamente
+            int restored_game_id;
+            char *restored_game_name = getPayloadValue(payload, 0, "game_name");
+            if (restored_game_name != NULL && getPayloadIntValue(payload, 0, "game_id", &restored_game_id) == 0) {
+                freePayload(payload);
+                printf("Bentornato %s! Riconnessione alla partita `%s`...\n", user->username, restored_game_name);
+                handle_game_msg(conn_s, restored_game_id, restored_game_name);
+                break;
+            }
+            free(restored_game_name);
             freePayload(payload);
 
             printf("Benvenuto nel gioco %s!\n", user->username);
@@ -172,9 +191,31 @@ void menu(int conn_s){
                     exit(EXIT_FAILURE);
                 }
 
+                printf("Regolamento [classic/salvo] (Invio per classic): ");
+                char *ruleset = readAlfanumericString(16);
+                if(ruleset == NULL){
+                    LOG_ERROR("Errore durante la lettura del regolamento");
+                    exit(EXIT_FAILURE);
+                }
+
+                printf("Numero di bot (Invio per nessuno, altri bot si aggiungono con B): ");
+                char *bots = readAlfanumericString(2);
+                if(bots == NULL){
+                    LOG_ERROR("Errore durante la lettura del numero di bot");
+                    exit(EXIT_FAILURE);
+                }
+
                 Payload *createGamePayload = createEmptyPayload();
                 addPayloadKeyValuePair(createGamePayload, "game_name", game_name);
+                if(ruleset[0] != '\0'){
+                    addPayloadKeyValuePair(createGamePayload, "ruleset", ruleset);
+                }
+                if(bots[0] != '\0'){
+                    addPayloadKeyValuePair(createGamePayload, "bots", bots);
+                }
                 free(game_name);
+                free(ruleset);
+                free(bots);
 
                 if(safeSendMsg(conn_s, MSG_CREATE_GAME, createGamePayload) < 0){
                     LOG_ERROR("Errore durante l'invio del messaggio di creazione della partita al server");
@@ -246,6 +287,9 @@ void menu(int conn_s){
                         handle_game_msg(conn_s, game_id, game_name);
                     }
 
+                } else if(msg_type == MSG_REDIRECT){
+                    // La partita è su un altro nodo: se l'ingresso non riesce si resta nel menu del nuovo nodo
+                    conn_s = follow_redirect(conn_s, payload);
                 } else if(msg_type == MSG_ERROR_JOIN_GAME){
                     LOG_ERROR("Errore durante l'unione alla partita");
                 } else {
@@ -268,10 +312,145 @@ void menu(int conn_s){
     }
 }
 
+/**
+ * Apre una connessione con il server.
+ * @param address Indirizzo IP o hostname del server.
+ * @param port Porta del server.
+ * @return Socket connessa, o -1 in caso di errore.
+ */
+int connect_to_server(const char *address, int port) {
+    struct sockaddr_in servaddr;
+    memset(&servaddr, 0, sizeof(servaddr));
+    servaddr.sin_family = AF_INET;
+    servaddr.sin_port = htons(port);
+
+    struct hostent *he = NULL;
+    if(inet_aton(address, &servaddr.sin_addr) <= 0){
+
+        if((he = gethostbyname(address)) == NULL){
+            LOG_ERROR("Indirizzo IP non valido, risoluzione nome fallita");
+            return -1;
+        }
+
+        servaddr.sin_addr = *((struct in_addr *)he->h_addr_list[0]);
+    }
+
+    int conn_s;
+    if((conn_s = socket(AF_INET, SOCK_STREAM, 0)) < 0){
+        LOG_ERROR("Errore durante la creazione della socket");
+        return -1;
+    }
+
+    if(connect(conn_s, (struct sockaddr *) &servaddr, sizeof(servaddr)) < 0){
+        LOG_ERROR("Errore durante la connect");
+        close(conn_s);
+        return -1;
+    }
+
+    conn_socket_for_exit = conn_s; // Salvo il socket per la chiusura in caso di errore
+    return conn_s;
+}
+
+/**
+ * Apre una connessione con un server sulla stessa macchina tramite la sua socket UNIX.
+ * @param path Percorso della socket UNIX del server (opzione -unix del server).
+ * @return Socket connessa, o -1 in caso di errore.
+ */
+int connect_to_local_server(const char *path) {
+    struct sockaddr_un servaddr;
+    memset(&servaddr, 0, sizeof(servaddr));
+    servaddr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(servaddr.sun_path)) {
+        LOG_ERROR("Percorso della socket UNIX troppo lungo");
+        return -1;
+    }
+    strcpy(servaddr.sun_path, path);
+
+    int conn_s;
+    if((conn_s = socket(AF_UNIX, SOCK_STREAM, 0)) < 0){
+        LOG_ERROR("Errore durante la creazione della socket");
+        return -1;
+    }
+
+    if(connect(conn_s, (struct sockaddr *) &servaddr, sizeof(servaddr)) < 0){
+        LOG_ERROR("Errore durante la connect sulla socket UNIX `%s`", path);
+        close(conn_s);
+        return -1;
+    }
+
+    conn_socket_for_exit = conn_s; // Salvo il socket per la chiusura in caso di errore
+    return conn_s;
+}
+
+/**
+ * Segue un MSG_REDIRECT verso il nodo del cluster che ospita la partita richiesta.
+ * Chiude la connessione attuale, si collega al nuovo nodo e vi rifà il login con lo stesso nome
+ * utente e il token ricevuto: il nodo risponde con il benvenuto e poi con l'esito dell'ingresso.
+ * Se l'ingresso riesce la partita prosegue e la funzione non ritorna.
+ * @param conn_s Socket del nodo che ha inviato il redirect.
+ * @param redirectPayload Payload del messaggio MSG_REDIRECT.
+ * @return Socket del nuovo nodo, con l'utente nella lobby.
+ */
+int follow_redirect(int conn_s, Payload *redirectPayload) {
+    char *host = getPayloadValue(redirectPayload, 0, "host");
+    char *token = getPayloadValue(redirectPayload, 0, "token");
+    int port, game_id;
+    if (host == NULL || token == NULL ||
+        getPayloadIntValue(redirectPayload, 0, "port", &port) != 0 ||
+        getPayloadIntValue(redirectPayload, 0, "game_id", &game_id) != 0) {
+        LOG_ERROR("Messaggio di redirect non valido");
+        exit(EXIT_FAILURE);
+    }
+
+    printf("La partita %d si trova su un altro server (%s:%d), connessione in corso...\n", game_id, host, port);
+    closeConnection(conn_s);
+    conn_socket_for_exit = -1;
+    conn_s = connect_to_server(host, port);
+    free(host);
+    if (conn_s < 0) {
+        exit(EXIT_FAILURE);
+    }
+
+    Payload *loginPayload = createEmptyPayload();
+    addPayloadKeyValuePair(loginPayload, "username", user->username);
+    addPayloadKeyValuePair(loginPayload, "token", token);
+    free(token);
+    if(safeSendMsg(conn_s, MSG_LOGIN, loginPayload) < 0){
+        LOG_ERROR("Errore durante l'invio del messaggio di login al server");
+        exit(EXIT_FAILURE);
+    }
+
+    uint16_t msg_type;
+    Payload *payload = NULL;
+    if(safeRecvMsg(conn_s, &msg_type, &payload) < 0 || msg_type != MSG_WELCOME){
+        LOG_ERROR("Errore durante il login sul nuovo server");
+        exit(EXIT_FAILURE);
+    }
+    getPayloadIntValue(payload, 0, "user_id", (int *)&user->user_id); // Ogni nodo assegna i propri ID
+    freePayload(payload);
+
+    if(safeRecvMsg(conn_s, &msg_type, &payload) < 0){
+        LOG_ERROR("Errore durante la ricezione del messaggio di unione alla partita dal server");
+        exit(EXIT_FAILURE);
+    }
+    if(msg_type == MSG_GAME_JOINED){
+        char *game_name = getPayloadValue(payload, 0, "game_name");
+        freePayload(payload);
+        if(game_name != NULL){
+            handle_game_msg(conn_s, game_id, game_name);
+        }
+        LOG_ERROR("Nome della partita non trovato nel payload");
+    } else {
+        LOG_ERROR("Errore durante l'unione alla partita");
+        freePayload(payload);
+    }
+    return conn_s;
+}
+
 void cleanup_on_exit() {
     if (conn_socket_for_exit >= 0) {
         LOG_INFO("Chiusura della connessione...");
-        close(conn_socket_for_exit);
+        closeConnection(conn_socket_for_exit);
         conn_socket_for_exit = -1;
     }
 }
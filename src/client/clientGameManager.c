@@ -12,6 +12,7 @@
 #include "utils/debug.h"
 #include "utils/userInput.h"
 #include "common/protocol.h"
+#include "common/shmTransport.h"
 #include "common/game.h"
 
 UserInfo *user = NULL; // Informazioni sull'utente corrente
@@ -24,6 +25,8 @@ pthread_mutex_t game_state_mutex;
 FILE *client_log_file = NULL;
 char *log_file_path = NULL;
 
+static void enter_playing_screen();
+
 void handle_game_msg(int conn_s, unsigned int game_id, char *game_name) {
     game = create_game_state(game_id, game_name);
     if (game == NULL) {
@@ -39,7 +42,7 @@ void handle_game_msg(int conn_s, unsigned int game_id, char *game_name) {
     }
 
     PlayerState *player_state = get_player_state(game, user->user_id);
-    player_state->fleet = (FleetSetup *)malloc(sizeof(FleetSetup));
+    player_state->fleet = alloc_fleet_setup();
     if (player_state->fleet == NULL) {
         LOG_ERROR("Errore nell'allocazione della flotta del giocatore");
         exit(EXIT_FAILURE);
@@ -109,6 +112,12 @@ void handle_game_msg(int conn_s, unsigned int game_id, char *game_name) {
     ev.data.fd = conn_s;
     epoll_ctl(client_epoll_fd, EPOLL_CTL_ADD, conn_s, &ev);
 
+    // In memoria condivisa i messaggi sono segnalati dall'eventfd, la socket segnala solo la chiusura
+    int wakeup_fd = shm_wakeup_fd(conn_s);
+    if (wakeup_fd != conn_s) {
+        epoll_ctl(client_epoll_fd, EPOLL_CTL_ADD, wakeup_fd, &ev);
+    }
+
     while(1) {
         struct epoll_event events[2];
         int nfds = epoll_wait(client_epoll_fd, events, 1, -1);
@@ -128,18 +137,14 @@ void handle_game_msg(int conn_s, unsigned int game_id, char *game_name) {
             switch (signal.type) {
                 case GAME_UI_SIGNAL_FLEET_DEPLOYED:{
                     // Invia un messaggio al server per notificare che la flotta è stata piazzata
-                    Payload *payload = createEmptyPayload();
+                    ShipRecord ships[NUM_SHIPS];
                     pthread_mutex_lock(&game_state_mutex);
                     for(int i = 0; i < NUM_SHIPS; i++) {
                         ShipPlacement *ship = &game->players[0].fleet->ships[i];
-
-                        addPayloadList(payload);
-                        addPayloadKeyValuePairInt(payload, "dim", ship->dim);
-                        addPayloadKeyValuePairInt(payload, "vertical", ship->vertical);
-                        addPayloadKeyValuePairInt(payload, "x", ship->x);
-                        addPayloadKeyValuePairInt(payload, "y", ship->y);
+                        ships[i] = (ShipRecord){ship->dim, ship->vertical, ship->x, ship->y};
                     }
                     pthread_mutex_unlock(&game_state_mutex);
+                    Payload *payload = encode_fleet_msg(ships, NUM_SHIPS);
                     if (safeSendMsg(conn_s, MSG_SETUP_FLEET, payload) < 0) {
                         LOG_ERROR_FILE(client_log_file, "Errore durante l'invio del messaggio MSG_SETUP_FLEET al server");
                         goto close_game;
@@ -154,16 +159,26 @@ void handle_game_msg(int conn_s, unsigned int game_id, char *game_name) {
                     }
                     break;
                 }
+                case GAME_UI_SIGNAL_ADD_BOT:{
+                    // Chiede al server di aggiungere un bot alla partita
+                    if (safeSendMsg(conn_s, MSG_ADD_BOT, NULL) < 0) {
+                        LOG_ERROR_FILE(client_log_file, "Errore durante l'invio del messaggio MSG_ADD_BOT al server");
+                        goto close_game;
+                    }
+                    break;
+                }
                 case GAME_UI_SIGNAL_ATTACK:{
                     pthread_mutex_lock(&game_state_mutex);
-                    AttackPosition *attack_position = (AttackPosition *)signal.data;
+                    AttackSalvo *salvo = (AttackSalvo *)signal.data;
+
+                    // Una lista per ogni colpo della salva
+                    ShotRecord shots[MAX_SALVO_SIZE];
+                    for (int i = 0; i < salvo->count; i++) {
+                        shots[i] = (ShotRecord){salvo->shots[i].player_id, salvo->shots[i].x, salvo->shots[i].y};
+                    }
+                    Payload *attack_payload = encode_attack_msg(shots, salvo->count);
 
-                    Payload *attack_payload = createEmptyPayload();
-                    addPayloadKeyValuePairInt(attack_payload, "player_id", attack_position->player_id);
-                    addPayloadKeyValuePairInt(attack_payload, "x", attack_position->x);
-                    addPayloadKeyValuePairInt(attack_payload, "y", attack_position->y);
-                    
-                    free(attack_position);
+                    free(salvo);
 
                     if (safeSendMsg(conn_s, MSG_ATTACK, attack_payload) < 0) {
                         LOG_ERROR_FILE(client_log_file, "Errore durante l'invio del messaggio MSG_PLAYER_ACTION al server");
@@ -182,10 +197,14 @@ void handle_game_msg(int conn_s, unsigned int game_id, char *game_name) {
 
             uint16_t msg_type;
             Payload *payload = NULL;
-            if (safeRecvMsg(conn_s, &msg_type, &payload) < 0) {
+            int received = safeTryRecvMsg(conn_s, &msg_type, &payload);
+            if (received < 0) {
                 LOG_ERROR_FILE(client_log_file, "Errore durante la ricezione del messaggio di gioco dal server");
                 break;
             }
+            if (received == 0) {
+                continue; // Sveglia senza messaggi da leggere
+            }
 
             switch (msg_type) {
                 case MSG_GAME_STATE_UPDATE: {
@@ -204,6 +223,14 @@ void handle_game_msg(int conn_s, unsigned int game_id, char *game_name) {
                     on_fleet_setup_reminder_msg();
                     break;
                 }
+                case MSG_FLEET_AUTO_PLACED: {
+                    on_fleet_auto_placed_msg(payload);
+                    break;
+                }
+                case MSG_GAME_RESUMED: {
+                    on_game_resumed_msg(payload);
+                    break;
+                }
                 case MSG_GAME_STARTED: {
                     on_game_started_msg(payload);
                     break;
@@ -258,6 +285,15 @@ void on_game_state_update_msg(Payload *payload) {
 
         if (strcmp(key, "game_info") == 0) {
             // Gestisci le informazioni del gioco
+            char *ruleset = getPayloadValue(payload, i, "ruleset");
+            int ruleset_id = find_game_rules(ruleset);
+            if (ruleset_id < 0) {
+                LOG_WARNING_FILE(client_log_file, "Regolamento non riconosciuto, uso quello di default");
+            }
+            pthread_mutex_lock(&game_state_mutex);
+            game->rules = get_game_rules(ruleset_id);
+            pthread_mutex_unlock(&game_state_mutex);
+            free(ruleset);
         } else if (strcmp(key, "player_info") == 0) {
             // Gestisci le informazioni del giocatore
             int player_id;
@@ -306,11 +342,12 @@ void on_player_joined_msg(Payload *payload){
 
 void on_player_left_msg(Payload *payload) {
     LOG_DEBUG_FILE(client_log_file, "Ricevuto MSG_PLAYER_LEFT");
-    int player_id;
-    if (getPayloadIntValue(payload, 0, "player_id", &player_id) < 0) {
+    PlayerIdRecord *left;
+    if (decode_player_left_msg(payload, &left) < 0) {
         LOG_ERROR_FILE(client_log_file, "ID del giocatore non trovato nel payload");
         return;
     }
+    int player_id = left->player_id;
 
     pthread_mutex_lock(&game_state_mutex);
     for(unsigned int i = 0; i < game->player_turn_order_count; i++) {
@@ -330,15 +367,48 @@ void on_player_left_msg(Payload *payload) {
 void on_fleet_setup_reminder_msg(){
     LOG_DEBUG_FILE(client_log_file, "Ricevuto MSG_FLEET_SETUP_REMINDER");
     log_game_message(SET_COLOR_TEXT_FORMAT "Piazza le navi!" RESET_FORMAT " Hai 2 minuti." RESET_FORMAT, COLOR_YELLOW);
-    log_game_message("Usa le Frecce per muovere, R per ruotare e Invio per confermare.");
+    log_game_message("Usa le Frecce per muovere, R per ruotare, Invio per confermare e A per il piazzamento automatico.");
+}
+
+void on_fleet_auto_placed_msg(Payload *payload) {
+    LOG_DEBUG_FILE(client_log_file, "Ricevuto MSG_FLEET_AUTO_PLACED");
+
+    ShipRecord *ships;
+    if (decode_fleet_msg(payload, &ships) < 0) {
+        LOG_ERROR_FILE(client_log_file, "Flotta non valida nel payload");
+        return;
+    }
+
+    FleetSetup fleet;
+    for (int i = 0; i < NUM_SHIPS; i++) {
+        fleet.ships[i] = (ShipPlacement){ships[i].x, ships[i].y, ships[i].dim, ships[i].vertical};
+    }
+
+    pthread_mutex_lock(&game_state_mutex);
+    PlayerState *local_player = &game->players[0];
+    *local_player->fleet = fleet;
+    init_board(&local_player->board);
+    for (int i = 0; i < NUM_SHIPS; i++) {
+        place_ship(&local_player->board, &local_player->fleet->ships[i]);
+    }
+
+    pthread_mutex_lock(&screen.mutex);
+    screen.ships_placed = NUM_SHIPS;
+    screen.cursor.show = 0;
+    refresh_board();
+    pthread_mutex_unlock(&screen.mutex);
+    pthread_mutex_unlock(&game_state_mutex);
+
+    log_game_message(SET_COLOR_TEXT_FORMAT "Tempo scaduto!" RESET_FORMAT " La tua flotta è stata piazzata automaticamente.", COLOR_YELLOW);
 }
 
 void on_game_started_msg(Payload *payload) {
     LOG_DEBUG_FILE(client_log_file, "Ricevuto MSG_GAME_STARTED");
 
-    int payload_size = getPayloadListSize(payload);
+    PlayerIdRecord *turn_order;
+    int payload_size = decode_game_started_msg(payload, &turn_order);
     if (payload_size <= 0) {
-        LOG_ERROR_FILE(client_log_file, "Nessun giocatore trovato nell'ordine dei turni");
+        LOG_ERROR_FILE(client_log_file, "Ordine dei turni mancante o non valido nel payload");
         return;
     }
 
@@ -352,11 +422,7 @@ void on_game_started_msg(Payload *payload) {
     }
 
     for (int i = 0; i < payload_size; i++) {
-        int player_id;
-        if (getPayloadIntValue(payload, i, "player_id", &player_id) < 0) {
-            LOG_ERROR_FILE(client_log_file, "ID del giocatore non trovato nel payload");
-            continue;
-        }
+        int player_id = turn_order[i].player_id;
         game->player_turn_order[i] = player_id;
         if (player_id == (int)user->user_id) {
             local_player_turn_index = i;
@@ -366,6 +432,13 @@ void on_game_started_msg(Payload *payload) {
 
     log_game_message(SET_COLOR_TEXT_FORMAT "La partita è iniziata! Che la battaglia abbia inizio!" RESET_FORMAT, COLOR_YELLOW);
 
+    enter_playing_screen();
+}
+
+/**
+ * Passa la schermata alla fase di gioco, mostrando la griglia del primo avversario attivo.
+ */
+static void enter_playing_screen() {
     pthread_mutex_lock(&game_state_mutex);
     pthread_mutex_lock(&screen.mutex);
     screen.game_screen_state = GAME_SCREEN_STATE_PLAYING;
@@ -380,14 +453,104 @@ void on_game_started_msg(Payload *payload) {
     refresh_screen();
 }
 
+/**
+ * Gestisce lo stato di una partita ripristinata dopo un riavvio del server.
+ * Il payload segue lo schema GAME_RESUMED_SECTIONS: fase e turno corrente, flotta locale,
+ * ordine dei turni, navi rimaste di ogni giocatore e colpi già sparati.
+ * @param payload Il payload del messaggio.
+ */
+void on_game_resumed_msg(Payload *payload) {
+    LOG_DEBUG_FILE(client_log_file, "Ricevuto MSG_GAME_RESUMED");
+
+    GameResumedMsg msg;
+    if (decode_game_resumed_msg(payload, &msg) < 0) {
+        LOG_ERROR_FILE(client_log_file, "Stato della partita ripristinata non valido nel payload");
+        return;
+    }
+    int state = msg.resume_info[0].state;
+    int ships_count = msg.ship_count;
+
+    pthread_mutex_lock(&game_state_mutex);
+    for (int i = 0; i < msg.board_count; i++) {
+        PlayerState *player_state = get_player_state(game, msg.board[i].player_id);
+        if (player_state != NULL) {
+            player_state->board.ships_left = msg.board[i].ships_left;
+        }
+    }
+
+    // La flotta va piazzata prima dei colpi, che la sovrascrivono sulla griglia locale
+    PlayerState *local_player = &game->players[0];
+    if (ships_count == NUM_SHIPS) {
+        int ships_left = local_player->board.ships_left;
+        for (int i = 0; i < NUM_SHIPS; i++) {
+            local_player->fleet->ships[i] = (ShipPlacement){msg.ship[i].x, msg.ship[i].y, msg.ship[i].dim, msg.ship[i].vertical};
+        }
+        init_board(&local_player->board);
+        for (int i = 0; i < NUM_SHIPS; i++) {
+            place_ship(&local_player->board, &local_player->fleet->ships[i]);
+        }
+        local_player->board.ships_left = ships_left;
+    }
+
+    for (int i = 0; i < msg.shot_count; i++) {
+        BoardShotRecord *shot = &msg.shot[i];
+        PlayerState *player_state = get_player_state(game, shot->player_id);
+        if (player_state != NULL) {
+            set_cell(&player_state->board, shot->x, shot->y, shot->hit ? 'X' : '*');
+        }
+    }
+
+    int is_active = 0;
+    if (msg.turn_order_count > 0) {
+        int *new_turn_order = realloc(game->player_turn_order, sizeof(int) * msg.turn_order_count);
+        if (new_turn_order != NULL) {
+            game->player_turn_order = new_turn_order;
+            game->player_turn_order_count = msg.turn_order_count;
+            for (int i = 0; i < msg.turn_order_count; i++) {
+                game->player_turn_order[i] = msg.turn_order[i].player_id;
+                if (msg.turn_order[i].player_id == (int)user->user_id) {
+                    local_player_turn_index = i;
+                    is_active = 1;
+                }
+            }
+            game->player_turn = msg.resume_info[0].player_turn;
+        }
+    }
+
+    pthread_mutex_lock(&screen.mutex);
+    if (ships_count == NUM_SHIPS) {
+        screen.ships_placed = NUM_SHIPS;
+        screen.cursor.show = 0;
+    }
+    pthread_mutex_unlock(&screen.mutex);
+    pthread_mutex_unlock(&game_state_mutex);
+
+    log_game_message(SET_COLOR_TEXT_FORMAT "Riconnesso alla partita dopo il riavvio del server." RESET_FORMAT " La partita riprenderà quando tutti i giocatori saranno tornati.", COLOR_YELLOW);
+
+    if (state == GAME_IN_PROGRESS && game->player_turn_order_count > 0) {
+        if (is_active) {
+            enter_playing_screen();
+        } else {
+            on_you_are_eliminated_msg();
+        }
+    } else {
+        pthread_mutex_lock(&game_state_mutex);
+        pthread_mutex_lock(&screen.mutex);
+        refresh_board();
+        pthread_mutex_unlock(&screen.mutex);
+        pthread_mutex_unlock(&game_state_mutex);
+    }
+}
+
 void on_turn_order_update_msg(Payload *payload){
     LOG_DEBUG_FILE(client_log_file, "Ricevuto MSG_TURN_ORDER_UPDATE");
 
-    int player_turn;
-    if (getPayloadIntValue(payload, 0, "player_turn", &player_turn) < 0) {
+    PlayerTurnRecord *turn;
+    if (decode_turn_order_update_msg(payload, &turn) < 0) {
         LOG_ERROR_FILE(client_log_file, "Turno del giocatore non trovato nel payload");
         return;
     }
+    int player_turn = turn->player_turn;
     
     pthread_mutex_lock(&game_state_mutex);
     game->player_turn = player_turn;
@@ -414,62 +577,74 @@ void on_your_turn_msg(){
     pthread_mutex_unlock(&game_state_mutex);
 }
 
+/**
+ * Gestisce l'aggiornamento di un attacco.
+ * Il payload contiene una lista per ogni colpo della salva.
+ * @param payload Il payload del messaggio.
+ */
 void on_attack_update_msg(Payload *payload) {
     LOG_DEBUG_FILE(client_log_file, "Ricevuto MSG_ATTACK_UPDATE");
 
-    int attacker_id, attacked_id, x, y;
-    if (getPayloadIntValue(payload, 0, "attacker_id", &attacker_id) < 0 ||
-        getPayloadIntValue(payload, 0, "attacked_id", &attacked_id) < 0 ||
-        getPayloadIntValue(payload, 0, "x", &x) < 0 ||
-        getPayloadIntValue(payload, 0, "y", &y) < 0) {
-        LOG_ERROR_FILE(client_log_file, "Informazioni sull'attacco non trovate nel payload");
+    AttackResultRecord *shots;
+    int shots_count = decode_attack_update_msg(payload, &shots);
+    if (shots_count < 0) {
+        LOG_ERROR_FILE(client_log_file, "Informazioni sull'attacco non valide nel payload");
         return;
     }
-    char *result = getPayloadValue(payload, 0, "result");
-    if (result == NULL) {
-        LOG_ERROR_FILE(client_log_file, "Risultato dell'attacco non trovato nel payload");
-        return;
+    for (int i = 0; i < shots_count; i++) {
+        apply_attack_update(&shots[i]);
     }
 
+    pthread_mutex_lock(&game_state_mutex);
+    pthread_mutex_lock(&screen.mutex);
+    refresh_board();
+    pthread_mutex_unlock(&screen.mutex);
+    pthread_mutex_unlock(&game_state_mutex);
+}
+
+/**
+ * Applica allo stato locale un singolo colpo di un MSG_ATTACK_UPDATE e lo registra nel log.
+ * @param shot Il colpo, decodificato dal payload del messaggio.
+ */
+void apply_attack_update(const AttackResultRecord *shot) {
+    int attacker_id = shot->attacker_id, attacked_id = shot->attacked_id, x = shot->x, y = shot->y;
+
     pthread_mutex_lock(&game_state_mutex);
     PlayerState *attacked_state = get_player_state(game, attacked_id);
     if (attacked_state == NULL) {
         LOG_ERROR_FILE(client_log_file, "Giocatore con ID %d non trovato nello stato del gioco", attacker_id);
-        free(result);
         pthread_mutex_unlock(&game_state_mutex);
         return;
     }
     GameBoard *attacked_board = &attacked_state->board;
-    int log_case = 0; // 1=hit,2=miss,3=sunk,0=unknown
-    if(strcmp(result, "hit") == 0) {
-        set_cell(attacked_board, x, y, 'X'); // Colpito
-        log_case = 1;
-    } else if (strcmp(result, "miss") == 0) {
-        set_cell(attacked_board, x, y, '*'); // Mancato
-        log_case = 2;
-    } else if (strcmp(result, "sunk") == 0) {
-        set_cell(attacked_board, x, y, 'X'); // Colpito
-        attacked_board->ships_left--; // Decrementa le navi rimaste
-        log_case = 3;
-    } else if (strcmp(result, "eliminated") == 0) {
-        set_cell(attacked_board, x, y, 'X'); // Colpito
-        attacked_board->ships_left = 0; // Tutte le navi sono state affondate
-        log_case = 4;
-        for(unsigned int i = 0; i < game->player_turn_order_count; i++) {
-            if(game->player_turn_order[i] == (int)attacked_id) {
-                game->player_turn_order[i] = -1; // Rimuove il giocatore dall'ordine dei turni
-                break;
+    int log_case = 0; // 1=hit,2=miss,3=sunk,4=eliminated
+    switch (shot->result) {
+        case ATTACK_RESULT_HIT:
+            set_cell(attacked_board, x, y, 'X'); // Colpito
+            log_case = 1;
+            break;
+        case ATTACK_RESULT_MISS:
+            set_cell(attacked_board, x, y, '*'); // Mancato
+            log_case = 2;
+            break;
+        case ATTACK_RESULT_SUNK:
+            set_cell(attacked_board, x, y, 'X'); // Colpito
+            attacked_board->ships_left--; // Decrementa le navi rimaste
+            log_case = 3;
+            break;
+        case ATTACK_RESULT_ELIMINATED:
+            set_cell(attacked_board, x, y, 'X'); // Colpito
+            attacked_board->ships_left = 0; // Tutte le navi sono state affondate
+            log_case = 4;
+            for(unsigned int i = 0; i < game->player_turn_order_count; i++) {
+                if(game->player_turn_order[i] == (int)attacked_id) {
+                    game->player_turn_order[i] = -1; // Rimuove il giocatore dall'ordine dei turni
+                    break;
+                }
             }
-        }
-    } else {
-        LOG_ERROR_FILE(client_log_file, "Risultato dell'attacco non riconosciuto: %s", result);
+            break;
     }
 
-    pthread_mutex_lock(&screen.mutex);
-    refresh_board();
-    pthread_mutex_unlock(&screen.mutex);
-    
-    
     int is_my_attack = (attacker_id == (int)user->user_id);
     int am_i_attacked = (attacked_id == (int)user->user_id);
     char col = 'A' + x;
@@ -503,8 +678,6 @@ void on_attack_update_msg(Payload *payload) {
     }
     
     pthread_mutex_unlock(&game_state_mutex);
-    free(result);
-
 }
 
 void on_you_are_eliminated_msg() {
@@ -521,11 +694,12 @@ void on_you_are_eliminated_msg() {
 void on_game_finished_msg(Payload *payload) {
     LOG_DEBUG_FILE(client_log_file, "Ricevuto MSG_GAME_FINISHED");
 
-    int winner_id;
-    if (getPayloadIntValue(payload, 0, "winner_id", &winner_id) < 0) {
+    WinnerRecord *winner;
+    if (decode_game_finished_msg(payload, &winner) < 0) {
         LOG_ERROR_FILE(client_log_file, "ID del vincitore non trovato nel payload");
         return;
     }
+    int winner_id = winner->winner_id;
 
     pthread_mutex_lock(&screen.mutex);
     screen.game_screen_state = GAME_SCREEN_STATE_FINISHED;
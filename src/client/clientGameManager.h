@@ -4,6 +4,7 @@
 #include <pthread.h>
 #include "common/protocol.h"
 #include "common/game.h"
+#include "common/messages.h"
 
 extern UserInfo *user;
 extern int is_owner;
@@ -21,10 +22,13 @@ void on_game_state_update_msg(Payload *payload);
 void on_player_joined_msg(Payload *payload);
 void on_player_left_msg(Payload *payload);
 void on_fleet_setup_reminder_msg();
+void on_fleet_auto_placed_msg(Payload *payload);
+void on_game_resumed_msg(Payload *payload);
 void on_game_started_msg(Payload *payload);
 void on_turn_order_update_msg(Payload *payload);
 void on_your_turn_msg();
 void on_attack_update_msg(Payload *payload);
+void apply_attack_update(const AttackResultRecord *shot);
 void on_you_are_eliminated_msg();
 void on_game_finished_msg(Payload *payload);
 
@@ -8,10 +8,12 @@
 #include <string.h>
 #include <pthread.h>
 #include <stdarg.h>
+#include <time.h>
 
 #include "client/gameUI.h"
 #include "client/clientGameManager.h"
 #include "common/game.h"
+#include "common/fleetPlacement.h"
 #include "utils/debug.h"
 
 struct termios orig_termios;
@@ -265,11 +267,19 @@ void draw_legend(int x, int y) {
         printf(SET_COLOR_TEXT_FORMAT "Frecce" RESET_FORMAT ":muovi  ", COLOR_BLUE);
         printf(SET_COLOR_TEXT_FORMAT "R" RESET_FORMAT ":ruota  ", COLOR_GREEN);
         printf(SET_COLOR_TEXT_FORMAT "Invio" RESET_FORMAT ":piazza  ", COLOR_YELLOW);
-        if (is_owner)
+        printf(SET_COLOR_TEXT_FORMAT "A" RESET_FORMAT ":auto  ", COLOR_GREEN);
+        if (is_owner) {
+            printf(SET_COLOR_TEXT_FORMAT "B" RESET_FORMAT ":bot  ", COLOR_CYAN);
             printf(SET_COLOR_TEXT_FORMAT "S" RESET_FORMAT ":avvia", COLOR_MAGENTA);
+        }
     } else if (screen.game_screen_state == GAME_SCREEN_STATE_PLAYING) {
         printf(SET_COLOR_TEXT_FORMAT "Frecce" RESET_FORMAT ":seleziona  ", COLOR_BLUE);
-        printf(SET_COLOR_TEXT_FORMAT "Invio" RESET_FORMAT ":attacca  ", COLOR_YELLOW);
+        if (game->rules->salvo_size > 1) {
+            printf(SET_COLOR_TEXT_FORMAT "Invio" RESET_FORMAT ":mira  ", COLOR_YELLOW);
+            printf(SET_COLOR_TEXT_FORMAT "F" RESET_FORMAT ":fuoco  ", COLOR_RED);
+        } else {
+            printf(SET_COLOR_TEXT_FORMAT "Invio" RESET_FORMAT ":attacca  ", COLOR_YELLOW);
+        }
         printf(SET_COLOR_TEXT_FORMAT "Q/E" RESET_FORMAT ":scorri", COLOR_CYAN);
     }
 
@@ -377,6 +387,13 @@ void refresh_board() {
                         printf(" ");
                     }
 
+                    // Bersagli già selezionati per la salva su questo avversario
+                    for (int i = 0; i < screen.salvo.count; i++) {
+                        AttackPosition *shot = &screen.salvo.shots[i];
+                        if (shot->player_id != (int)current_player->user.user_id) continue;
+                        printf(MOVE_CURSOR_FORMAT SET_COLOR_TEXT_FORMAT "+" RESET_FORMAT, shot->y + START_GRID_Y + 3, left_padding + GRID_WIDTH + GRID_PADDING + shot->x * 2 + 6, COLOR_MAGENTA);
+                    }
+
                     if(screen.cursor.show) {
                         printf(MOVE_CURSOR_FORMAT SET_COLOR_TEXT_FORMAT HIGHLIGHT_FORMAT " " RESET_FORMAT, screen.cursor.y + START_GRID_Y + 3, left_padding + GRID_WIDTH + GRID_PADDING + screen.cursor.x * 2 + 6, COLOR_RED);
                     }
@@ -480,6 +497,57 @@ EscapeSequence read_escape_sequence() {
     return ESCAPE_OTHER;
 }
 
+/**
+ * Invia al thread principale la salva selezionata e la azzera.
+ * Va chiamata con `game_state_mutex` e `screen.mutex` acquisiti.
+ * @param pipe_fd_write File descriptor della pipe verso il thread principale.
+ */
+static void send_salvo(int pipe_fd_write) {
+    AttackSalvo *salvo = malloc(sizeof(AttackSalvo));
+    if (salvo == NULL) {
+        LOG_ERROR_FILE(client_log_file, "Errore durante l'allocazione della salva");
+        return;
+    }
+    *salvo = screen.salvo;
+    screen.salvo.count = 0;
+
+    GameUISignal sig;
+    memset(&sig, 0, sizeof(sig));
+    sig.type = GAME_UI_SIGNAL_ATTACK;
+    sig.data = salvo;
+    write(pipe_fd_write, &sig, sizeof(GameUISignal));
+
+    screen.cursor.show = 0; // Nascondi il cursore dopo l'attacco
+    refresh_board();
+}
+
+/**
+ * Conclude il piazzamento della flotta locale: nasconde il cursore e invia la flotta
+ * al thread principale.
+ * Va chiamata senza `game_state_mutex` e `screen.mutex` acquisiti.
+ * @param pipe_fd_write File descriptor della pipe verso il thread principale.
+ */
+static void send_fleet_deployed(int pipe_fd_write) {
+    pthread_mutex_lock(&game_state_mutex);
+    pthread_mutex_lock(&screen.mutex);
+    screen.cursor.show = 0; // Nascondi il cursore
+    refresh_board();
+    pthread_mutex_unlock(&screen.mutex);
+    pthread_mutex_unlock(&game_state_mutex);
+
+    if (is_owner) {
+        log_game_message("Flotta schierata! Premi 'S' per iniziare la partita.");
+    } else {
+        log_game_message("Flotta schierata! Attendi che il proprietario avvii la partita.");
+    }
+
+    GameUISignal sig;
+    memset(&sig, 0, sizeof(sig));
+    sig.type = GAME_UI_SIGNAL_FLEET_DEPLOYED;
+    sig.data = NULL;
+    write(pipe_fd_write, &sig, sizeof(GameUISignal));
+}
+
 void *game_ui_thread(void *arg) {
     GameUIArg *ui_arg = (GameUIArg *)arg;
     int pipe_fd_write = ui_arg->pipe_fd_write;
@@ -499,10 +567,14 @@ void *game_ui_thread(void *arg) {
     screen.game_screen_state = GAME_SCREEN_STATE_PLACING_SHIPS;
     pthread_mutex_unlock(&screen.mutex);
 
-    int ship_placed = 0;
-    ship.dim = SHIP_PLACEMENT_SEQUENCE[ship_placed];
+    pthread_mutex_lock(&screen.mutex);
+    screen.ships_placed = 0;
+    pthread_mutex_unlock(&screen.mutex);
+    ship.dim = SHIP_PLACEMENT_SEQUENCE[0];
     ship.vertical = 1;
 
+    unsigned int rng_state = (unsigned int)time(NULL) ^ (unsigned int)getpid(); // Per il piazzamento automatico
+
     while (1) {
         if (resized) {
             update_window_size(&screen);
@@ -555,38 +627,26 @@ void *game_ui_thread(void *arg) {
                         break;
                     case '\n':
                         pthread_mutex_lock(&screen.mutex);
-                        if (screen.game_screen_state == GAME_SCREEN_STATE_PLACING_SHIPS && ship_placed < NUM_SHIPS) {
+                        if (screen.game_screen_state == GAME_SCREEN_STATE_PLACING_SHIPS && screen.ships_placed < NUM_SHIPS) {
                             pthread_mutex_unlock(&screen.mutex);
                             int placed_ok = 0;
+                            int ships_placed = 0;
                             pthread_mutex_lock(&game_state_mutex);
+                            pthread_mutex_lock(&screen.mutex);
                             if (!place_ship(&game->players[0].board, &ship)) {
-                                game->players[0].fleet->ships[ship_placed++] = ship; // Salva la nave piazzata
+                                game->players[0].fleet->ships[screen.ships_placed++] = ship; // Salva la nave piazzata
                                 placed_ok = 1;
                             }
+                            ships_placed = screen.ships_placed;
+                            pthread_mutex_unlock(&screen.mutex);
                             pthread_mutex_unlock(&game_state_mutex);
 
                             if (placed_ok) {
-                                if (ship_placed >= NUM_SHIPS) {
-                                    // screen.game_screen_state = GAME_SCREEN_STATE_PLAYING;
-
-                                    pthread_mutex_lock(&screen.mutex);
-                                    screen.cursor.show = 0; // Nascondi il cursore
-                                    pthread_mutex_unlock(&screen.mutex);
-
-                                    if (is_owner) {
-                                        log_game_message("Flotta schierata! Premi 'S' per iniziare la partita.");
-                                    } else {
-                                        log_game_message("Flotta schierata! Attendi che il proprietario avvii la partita.");
-                                    }
-
-                                    GameUISignal sig;
-                                    memset(&sig, 0, sizeof(sig));
-                                    sig.type = GAME_UI_SIGNAL_FLEET_DEPLOYED;
-                                    sig.data = NULL;
-                                    write(pipe_fd_write, &sig, sizeof(GameUISignal));
+                                if (ships_placed >= NUM_SHIPS) {
+                                    send_fleet_deployed(pipe_fd_write);
                                 } else {
                                     int old_dim = ship.dim;
-                                    ship.dim = SHIP_PLACEMENT_SEQUENCE[ship_placed]; // Aggiorna alla dimensione della nave successiva
+                                    ship.dim = SHIP_PLACEMENT_SEQUENCE[ships_placed]; // Aggiorna alla dimensione della nave successiva
                                     log_game_message("Nave da %d piazzata. Ora posiziona la nave da %d.", old_dim, ship.dim);
                                 }
                             } else {
@@ -617,19 +677,34 @@ void *game_ui_thread(void *arg) {
                                 }
 
                                 if(current_player->board.grid[screen.cursor.x][screen.cursor.y] == '.'){
-                                    AttackPosition *attack_position = malloc(sizeof(AttackPosition));
-                                    attack_position->player_id = player_id;
-                                    attack_position->x = screen.cursor.x;
-                                    attack_position->y = screen.cursor.y;
-
-                                    GameUISignal sig;
-                                    memset(&sig, 0, sizeof(sig));
-                                    sig.type = GAME_UI_SIGNAL_ATTACK;
-                                    sig.data = attack_position;
-                                    write(pipe_fd_write, &sig, sizeof(GameUISignal));
-
-                                    screen.cursor.show = 0; // Nascondi il cursore dopo l'attacco
-                                    refresh_board();
+                                    // Se la cella è già nella salva la deseleziona, altrimenti la aggiunge
+                                    int selected = -1;
+                                    for (int i = 0; i < screen.salvo.count; i++) {
+                                        AttackPosition *shot = &screen.salvo.shots[i];
+                                        if (shot->player_id == player_id && shot->x == screen.cursor.x && shot->y == screen.cursor.y) {
+                                            selected = i;
+                                            break;
+                                        }
+                                    }
+
+                                    if (selected >= 0) {
+                                        screen.salvo.shots[selected] = screen.salvo.shots[--screen.salvo.count];
+                                        refresh_board();
+                                    } else {
+                                        AttackPosition *shot = &screen.salvo.shots[screen.salvo.count++];
+                                        shot->player_id = player_id;
+                                        shot->x = screen.cursor.x;
+                                        shot->y = screen.cursor.y;
+
+                                        if (screen.salvo.count >= game->rules->salvo_size) {
+                                            send_salvo(pipe_fd_write);
+                                        } else {
+                                            refresh_board();
+                                            pthread_mutex_unlock(&screen.mutex);
+                                            log_game_message("Bersaglio %d/%d selezionato. Premi F per sparare la salva.", screen.salvo.count, game->rules->salvo_size);
+                                            pthread_mutex_lock(&screen.mutex);
+                                        }
+                                    }
                                 } else {
                                     pthread_mutex_unlock(&screen.mutex);
                                     log_game_message(SET_COLOR_TEXT_FORMAT "Cella già colpita!" RESET_FORMAT " Scegli un'altra coordinata.", COLOR_YELLOW);
@@ -654,6 +729,53 @@ void *game_ui_thread(void *arg) {
                         }
                         pthread_mutex_unlock(&screen.mutex);
                         break;
+                    case 'A':
+                    case 'a': {
+                        // Completa la flotta con piazzamenti casuali, mantenendo le navi già piazzate
+                        int completed = 0;
+                        pthread_mutex_lock(&game_state_mutex);
+                        pthread_mutex_lock(&screen.mutex);
+                        if (screen.game_screen_state == GAME_SCREEN_STATE_PLACING_SHIPS && screen.ships_placed < NUM_SHIPS) {
+                            PlayerState *local_player = &game->players[0];
+                            if (complete_random_fleet(local_player->fleet, screen.ships_placed, game->rules->fleet, &rng_state) == 0) {
+                                init_board(&local_player->board);
+                                for (int i = 0; i < NUM_SHIPS; i++) {
+                                    place_ship(&local_player->board, &local_player->fleet->ships[i]);
+                                }
+                                screen.ships_placed = NUM_SHIPS;
+                                completed = 1;
+                            }
+                        }
+                        pthread_mutex_unlock(&screen.mutex);
+                        pthread_mutex_unlock(&game_state_mutex);
+
+                        if (completed) {
+                            send_fleet_deployed(pipe_fd_write);
+                        }
+                        break;
+                    }
+                    case 'B':
+                    case 'b':
+                        pthread_mutex_lock(&screen.mutex);
+                        if(is_owner && screen.game_screen_state == GAME_SCREEN_STATE_PLACING_SHIPS) {
+                            GameUISignal sig;
+                            memset(&sig, 0, sizeof(sig));
+                            sig.type = GAME_UI_SIGNAL_ADD_BOT;
+                            sig.data = NULL;
+                            write(pipe_fd_write, &sig, sizeof(GameUISignal));
+                        }
+                        pthread_mutex_unlock(&screen.mutex);
+                        break;
+                    case 'F':
+                    case 'f':
+                        pthread_mutex_lock(&game_state_mutex);
+                        pthread_mutex_lock(&screen.mutex);
+                        if(screen.game_screen_state == GAME_SCREEN_STATE_PLAYING && game->player_turn == local_player_turn_index && screen.cursor.show && screen.salvo.count > 0) {
+                            send_salvo(pipe_fd_write);
+                        }
+                        pthread_mutex_unlock(&screen.mutex);
+                        pthread_mutex_unlock(&game_state_mutex);
+                        break;
                     case 'Q':
                     case 'q':
                         pthread_mutex_lock(&game_state_mutex);
@@ -2,6 +2,7 @@
 #define GAME_UI_H
 
 #include "pthread.h"
+#include "common/game.h"
 
 #define MOVE_CURSOR_FORMAT "\x1b[%d;%dH"
 #define SET_COLOR_TEXT_FORMAT "\x1b[%dm"
@@ -80,6 +81,8 @@ typedef struct {
     GameCursor cursor; // Cursore per la selezione delle celle
 
     unsigned int current_showed_player; // Indice del giocatore attualmente visualizzato
+    AttackSalvo salvo; // Bersagli già selezionati per la salva del turno corrente
+    int ships_placed; // Navi della flotta locale già piazzate
 
     GameLog game_log; // Log degli eventi di gioco
 } GameScreen;
@@ -99,7 +102,8 @@ typedef struct {
 typedef enum {
     GAME_UI_SIGNAL_FLEET_DEPLOYED,
     GAME_UI_SIGNAL_START_GAME,
-    GAME_UI_SIGNAL_ATTACK
+    GAME_UI_SIGNAL_ATTACK,
+    GAME_UI_SIGNAL_ADD_BOT
 } GameUISignalType;
 
 typedef struct {
@@ -0,0 +1,275 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/bot.h"
+#include "utils/debug.h"
+
+#define BOT_HIT_WEIGHT 50 // Peso aggiuntivo di un piazzamento per ogni cella colpita che copre
+#define BOT_TIE_BITS 10 // Bit casuali usati per rompere i pareggi tra celle con la stessa densità
+
+typedef struct {
+    long score;
+    int player_id;
+    int x, y;
+} BotCandidate;
+
+/**
+ * Crea un nuovo bot.
+ * @param player_id ID del giocatore controllato dal bot.
+ * @param seed Seme del generatore casuale del bot.
+ * @return Puntatore al nuovo BotState, o NULL in caso di errore.
+ */
+BotState *create_bot(int player_id, unsigned int seed) {
+    BotState *bot = (BotState *)malloc(sizeof(BotState));
+    if (bot == NULL) {
+        LOG_ERROR("Allocazione del bot fallita");
+        return NULL;
+    }
+
+    bot->player_id = player_id;
+    bot->rng_state = seed;
+    bot->opponents = NULL;
+    bot->opponents_count = 0;
+    bot->opponents_capacity = 0;
+    return bot;
+}
+
+void free_bot(BotState *bot) {
+    if (bot == NULL) return;
+    free(bot->opponents);
+    free(bot);
+}
+
+/**
+ * Restituisce la vista di un avversario, creandola se non esiste.
+ * Se l'array delle viste è pieno, raddoppia la sua capacità.
+ * @return Puntatore alla vista, o NULL in caso di errore di allocazione.
+ */
+static BotOpponentView *get_opponent_view(BotState *bot, GameState *game, int player_id) {
+    for (unsigned int i = 0; i < bot->opponents_count; i++) {
+        if (bot->opponents[i].player_id == player_id) {
+            return &bot->opponents[i];
+        }
+    }
+
+    if (bot->opponents_count >= bot->opponents_capacity) {
+        unsigned int new_capacity = bot->opponents_capacity ? bot->opponents_capacity * 2 : 4;
+        BotOpponentView *new_opponents = (BotOpponentView *)realloc(bot->opponents, new_capacity * sizeof(BotOpponentView));
+        if (new_opponents == NULL) {
+            LOG_ERROR("Allocazione della vista dell'avversario %d fallita", player_id);
+            return NULL;
+        }
+        bot->opponents = new_opponents;
+        bot->opponents_capacity = new_capacity;
+    }
+
+    BotOpponentView *view = &bot->opponents[bot->opponents_count++];
+    view->player_id = player_id;
+    memset(view->cells, BOT_CELL_UNKNOWN, sizeof(view->cells));
+    memset(view->ships_left, 0, sizeof(view->ships_left));
+    for (int i = 0; i < NUM_SHIPS; i++) {
+        view->ships_left[game->rules->fleet[i]]++;
+    }
+    view->hits_pending = 0;
+    return view;
+}
+
+/**
+ * Aggiorna la vista del bot con l'esito di un attacco, di qualunque giocatore.
+ * Come nel gioco da tavolo, quando una nave viene affondata ne vengono rivelate le celle:
+ * il bot le legge dalla flotta del giocatore colpito.
+ * @param bot Bot da aggiornare.
+ * @param game Stato della partita.
+ * @param event Evento GAME_EVENT_ATTACK da osservare, gli altri eventi sono ignorati.
+ */
+void bot_observe_attack(BotState *bot, GameState *game, const GameEvent *event) {
+    if (event->type != GAME_EVENT_ATTACK || event->target_id == bot->player_id) return;
+
+    BotOpponentView *view = get_opponent_view(bot, game, event->target_id);
+    if (view == NULL) return;
+
+    if (event->result == 0) {
+        view->cells[event->x][event->y] = BOT_CELL_MISS;
+        return;
+    }
+
+    if (view->cells[event->x][event->y] != BOT_CELL_HIT) {
+        view->cells[event->x][event->y] = BOT_CELL_HIT;
+        view->hits_pending++;
+    }
+    if (event->result == 1) return;
+
+    // Nave affondata: tutte le sue celle diventano BOT_CELL_SUNK
+    PlayerState *target = get_player_state(game, event->target_id);
+    if (target == NULL || target->fleet == NULL) return;
+
+    for (int i = 0; i < NUM_SHIPS; i++) {
+        ShipPlacement *ship = &target->fleet->ships[i];
+        int dx = ship->vertical ? 0 : 1;
+        int dy = ship->vertical ? 1 : 0;
+        int covers = ship->vertical
+            ? (ship->x == event->x && ship->y <= event->y && event->y < ship->y + ship->dim)
+            : (ship->y == event->y && ship->x <= event->x && event->x < ship->x + ship->dim);
+        if (!covers) continue;
+
+        for (int j = 0; j < ship->dim; j++) {
+            unsigned char *cell = &view->cells[ship->x + j * dx][ship->y + j * dy];
+            if (*cell == BOT_CELL_HIT) view->hits_pending--;
+            *cell = BOT_CELL_SUNK;
+        }
+        if (view->ships_left[ship->dim] > 0) view->ships_left[ship->dim]--;
+        break;
+    }
+}
+
+/**
+ * Ricostruisce la vista di un avversario dalla sua griglia, come se il bot avesse osservato
+ * tutti gli attacchi già subiti. Usata quando una partita viene ripristinata da un checkpoint.
+ * @param bot Bot da aggiornare.
+ * @param game Stato della partita.
+ * @param target_id ID dell'avversario.
+ */
+void bot_observe_board(BotState *bot, GameState *game, int target_id) {
+    PlayerState *target = get_player_state(game, target_id);
+    if (target == NULL || target->fleet == NULL || target_id == bot->player_id) return;
+
+    GameEvent event = {GAME_EVENT_ATTACK, -1, target_id, 0, 0, 0};
+    for (int x = 0; x < GRID_SIZE; x++) {
+        for (int y = 0; y < GRID_SIZE; y++) {
+            char cell = target->board.grid[x][y];
+            if (cell != 'X' && cell != '*') continue;
+            event.x = x;
+            event.y = y;
+            event.result = (cell == 'X');
+            bot_observe_attack(bot, game, &event);
+        }
+    }
+
+    // Le navi colpite in ogni cella sono affondate e vengono rivelate
+    for (int i = 0; i < NUM_SHIPS; i++) {
+        ShipPlacement *ship = &target->fleet->ships[i];
+        int hits = 0;
+        for (int j = 0; j < ship->dim; j++) {
+            int x = ship->x + (ship->vertical ? 0 : j);
+            int y = ship->y + (ship->vertical ? j : 0);
+            if (target->board.grid[x][y] == 'X') hits++;
+        }
+        if (hits < ship->dim) continue;
+
+        event.x = ship->x;
+        event.y = ship->y;
+        event.result = 2;
+        bot_observe_attack(bot, game, &event);
+    }
+}
+
+/**
+ * Calcola la mappa di densità di una vista avversaria.
+ * @param view Vista dell'avversario.
+ * @param density Mappa da riempire, per le sole celle BOT_CELL_UNKNOWN.
+ * @param target_mode Se 1 considera solo i piazzamenti che coprono almeno una cella colpita.
+ * @return Somma dei pesi dei piazzamenti considerati, 0 se nessun piazzamento è possibile.
+ */
+static long compute_density(const BotOpponentView *view, long density[GRID_SIZE][GRID_SIZE], int target_mode) {
+    long total = 0;
+    memset(density, 0, sizeof(long) * GRID_SIZE * GRID_SIZE);
+
+    for (int dim = 1; dim <= GRID_SIZE; dim++) {
+        if (view->ships_left[dim] == 0) continue;
+
+        for (int vertical = 0; vertical <= 1; vertical++) {
+            int dx = vertical ? 0 : 1;
+            int dy = vertical ? 1 : 0;
+            int max_x = vertical ? GRID_SIZE : GRID_SIZE - dim + 1;
+            int max_y = vertical ? GRID_SIZE - dim + 1 : GRID_SIZE;
+
+            for (int x = 0; x < max_x; x++) {
+                for (int y = 0; y < max_y; y++) {
+                    int hits = 0;
+                    int blocked = 0;
+                    for (int i = 0; i < dim && !blocked; i++) {
+                        unsigned char cell = view->cells[x + i * dx][y + i * dy];
+                        if (cell == BOT_CELL_MISS || cell == BOT_CELL_SUNK) blocked = 1;
+                        else if (cell == BOT_CELL_HIT) hits++;
+                    }
+                    if (blocked || (target_mode && hits == 0)) continue;
+
+                    long weight = (long)view->ships_left[dim] * (1 + BOT_HIT_WEIGHT * hits);
+                    for (int i = 0; i < dim; i++) {
+                        if (view->cells[x + i * dx][y + i * dy] == BOT_CELL_UNKNOWN) {
+                            density[x + i * dx][y + i * dy] += weight;
+                        }
+                    }
+                    total += weight;
+                }
+            }
+        }
+    }
+    return total;
+}
+
+/**
+ * Inserisce un candidato nella lista ordinata dei migliori `size` candidati.
+ */
+static void insert_candidate(BotCandidate *best, int *count, int size, BotCandidate candidate) {
+    if (*count == size && best[size - 1].score >= candidate.score) return;
+
+    int i = (*count < size) ? (*count)++ : size - 1;
+    while (i > 0 && best[i - 1].score < candidate.score) {
+        best[i] = best[i - 1];
+        i--;
+    }
+    best[i] = candidate;
+}
+
+/**
+ * Sceglie i bersagli del bot per il turno corrente.
+ * Vengono scelte le `rules->salvo_size` celle con densità più alta tra tutti gli avversari attivi;
+ * le celle con la stessa densità sono scelte a caso.
+ * @param bot Bot di turno.
+ * @param game Stato della partita.
+ * @param shots Array di almeno MAX_SALVO_SIZE colpi da riempire.
+ * @return Numero di colpi scelti, 0 se non c'è nessun bersaglio valido.
+ */
+int bot_choose_salvo(BotState *bot, GameState *game, AttackPosition *shots) {
+    BotCandidate best[MAX_SALVO_SIZE];
+    int best_count = 0;
+    int salvo_size = game->rules->salvo_size;
+    long density[GRID_SIZE][GRID_SIZE];
+
+    for (unsigned int i = 0; i < game->player_turn_order_count; i++) {
+        int player_id = game->player_turn_order[i];
+        if (player_id == -1 || player_id == bot->player_id) continue;
+
+        PlayerState *target = get_player_state(game, player_id);
+        BotOpponentView *view = get_opponent_view(bot, game, player_id);
+        if (target == NULL || target->fleet == NULL || view == NULL) continue;
+
+        // Se la vista non ammette piazzamenti sulle celle colpite si torna alla caccia
+        if (view->hits_pending == 0 || compute_density(view, density, 1) == 0) {
+            compute_density(view, density, 0);
+        }
+
+        for (int x = 0; x < GRID_SIZE; x++) {
+            for (int y = 0; y < GRID_SIZE; y++) {
+                char cell = target->board.grid[x][y];
+                if (view->cells[x][y] != BOT_CELL_UNKNOWN || cell == 'X' || cell == '*') continue;
+
+                BotCandidate candidate;
+                candidate.score = (density[x][y] << BOT_TIE_BITS) | (rand_r(&bot->rng_state) & ((1 << BOT_TIE_BITS) - 1));
+                candidate.player_id = player_id;
+                candidate.x = x;
+                candidate.y = y;
+                insert_candidate(best, &best_count, salvo_size, candidate);
+            }
+        }
+    }
+
+    for (int i = 0; i < best_count; i++) {
+        shots[i].player_id = best[i].player_id;
+        shots[i].x = best[i].x;
+        shots[i].y = best[i].y;
+    }
+    return best_count;
+}
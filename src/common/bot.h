@@ -0,0 +1,46 @@
+#ifndef BOT_H
+#define BOT_H
+
+#include "common/game.h"
+#include "common/gameEngine.h"
+
+/**
+ * Giocatore automatico.
+ * Il bot tiene una propria vista delle griglie avversarie costruita solo dagli esiti degli attacchi
+ * (come un giocatore umano) e sceglie i bersagli con una mappa di densità: per ogni cella conta
+ * in quanti piazzamenti ancora possibili delle navi non affondate compare. I piazzamenti che coprono
+ * celle colpite ma non affondate pesano molto di più, così il bot passa da "caccia" a "bersaglio"
+ * senza stati espliciti.
+ */
+
+typedef enum {
+    BOT_CELL_UNKNOWN,   // Cella mai attaccata
+    BOT_CELL_MISS,      // Colpo in acqua
+    BOT_CELL_HIT,       // Nave colpita ma non ancora affondata
+    BOT_CELL_SUNK       // Cella di una nave affondata
+} BotCellState;
+
+typedef struct {
+    int player_id; // ID dell'avversario
+    unsigned char cells[GRID_SIZE][GRID_SIZE]; // Vista della griglia avversaria (BotCellState)
+    int ships_left[GRID_SIZE + 1]; // Navi non ancora affondate, per dimensione
+    int hits_pending; // Celle BOT_CELL_HIT presenti nella vista
+} BotOpponentView;
+
+typedef struct BotState {
+    int player_id; // ID del giocatore controllato dal bot
+    unsigned int rng_state; // Stato del generatore casuale del bot (rand_r)
+
+    BotOpponentView *opponents; // Viste degli avversari, create al primo attacco osservato
+    unsigned int opponents_count; // Numero di viste presenti
+    unsigned int opponents_capacity; // Capacità attuale dell'array delle viste
+} BotState;
+
+BotState *create_bot(int player_id, unsigned int seed);
+void free_bot(BotState *bot);
+
+void bot_observe_attack(BotState *bot, GameState *game, const GameEvent *event);
+void bot_observe_board(BotState *bot, GameState *game, int target_id);
+int bot_choose_salvo(BotState *bot, GameState *game, AttackPosition *shots);
+
+#endif // BOT_H
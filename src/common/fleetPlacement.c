@@ -0,0 +1,186 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <pthread.h>
+
+#include "common/fleetPlacement.h"
+#include "utils/debug.h"
+
+#define MAX_PLACEMENTS_PER_DIM (2 * GRID_SIZE * GRID_SIZE)
+#define MAX_FLEET_RULES 8 // Regolamenti di cui viene precalcolata la composizione della flotta
+
+// Piazzamenti legali per ogni dimensione di nave, calcolati una volta sola da init_placement_tables
+static FleetPlacement placement_tables[GRID_SIZE + 1][MAX_PLACEMENTS_PER_DIM];
+static int placement_counts[GRID_SIZE + 1];
+static pthread_once_t placement_tables_once = PTHREAD_ONCE_INIT;
+
+// Composizione della flotta di ogni regolamento, indicizzata come GAME_RULESETS
+static FleetRules compiled_fleet_rules[MAX_FLEET_RULES];
+
+/**
+ * Calcola le tabelle dei piazzamenti: per ogni dimensione, tutte le posizioni e
+ * orientamenti in cui la nave è interamente dentro la griglia.
+ */
+static void init_placement_tables(void) {
+    for (int dim = 1; dim <= GRID_SIZE; dim++) {
+        int count = 0;
+        for (int vertical = 0; vertical <= 1; vertical++) {
+            int max_x = vertical ? GRID_SIZE : GRID_SIZE - dim + 1;
+            int max_y = vertical ? GRID_SIZE - dim + 1 : GRID_SIZE;
+
+            for (int x = 0; x < max_x; x++) {
+                for (int y = 0; y < max_y; y++) {
+                    FleetPlacement *placement = &placement_tables[dim][count++];
+                    placement->ship.x = x;
+                    placement->ship.y = y;
+                    placement->ship.dim = dim;
+                    placement->ship.vertical = vertical;
+
+                    mask_clear(&placement->mask);
+                    for (int i = 0; i < dim; i++) {
+                        mask_set_cell(&placement->mask, vertical ? x : x + i, vertical ? y + i : y);
+                    }
+                }
+            }
+        }
+        placement_counts[dim] = count;
+    }
+
+    for (int r = 0; r < NUM_GAME_RULESETS && r < MAX_FLEET_RULES; r++) {
+        memset(&compiled_fleet_rules[r], 0, sizeof(FleetRules));
+        for (int i = 0; i < NUM_SHIPS; i++) {
+            compiled_fleet_rules[r].ship_counts[GAME_RULESETS[r].fleet[i]]++;
+        }
+    }
+}
+
+/**
+ * Restituisce la tabella dei piazzamenti legali per una dimensione di nave.
+ * @param dim Dimensione della nave.
+ * @param count Se non NULL, riceve il numero di piazzamenti nella tabella.
+ * @return Puntatore alla tabella, o NULL se la dimensione non è valida.
+ */
+const FleetPlacement *get_ship_placements(int dim, int *count) {
+    pthread_once(&placement_tables_once, init_placement_tables);
+
+    if (dim <= 0 || dim > GRID_SIZE) {
+        if (count) *count = 0;
+        return NULL;
+    }
+    if (count) *count = placement_counts[dim];
+    return placement_tables[dim];
+}
+
+/**
+ * Calcola la maschera delle celle occupate da una nave.
+ * @param ship Nave da convertire.
+ * @param mask Maschera da riempire.
+ * @return 0 se la nave è dentro la griglia, -1 altrimenti.
+ */
+int get_ship_mask(const ShipPlacement *ship, BoardMask *mask) {
+    if (ship->dim <= 0 || ship->dim > GRID_SIZE || ship->x < 0 || ship->y < 0) return -1;
+    if (ship->vertical ? (ship->x >= GRID_SIZE || ship->y + ship->dim > GRID_SIZE)
+                       : (ship->y >= GRID_SIZE || ship->x + ship->dim > GRID_SIZE)) return -1;
+
+    mask_clear(mask);
+    for (int i = 0; i < ship->dim; i++) {
+        mask_set_cell(mask, ship->vertical ? ship->x : ship->x + i, ship->vertical ? ship->y + i : ship->y);
+    }
+    return 0;
+}
+
+/**
+ * Restituisce la composizione della flotta richiesta da un regolamento.
+ * @param rules Regolamento, deve essere un elemento di GAME_RULESETS.
+ * @return Puntatore alla composizione precalcolata, o NULL se il regolamento non è noto.
+ */
+const FleetRules *get_fleet_rules(const GameRules *rules) {
+    pthread_once(&placement_tables_once, init_placement_tables);
+
+    if (rules < GAME_RULESETS || rules >= GAME_RULESETS + NUM_GAME_RULESETS) return NULL;
+    if (rules - GAME_RULESETS >= MAX_FLEET_RULES) return NULL;
+    return &compiled_fleet_rules[rules - GAME_RULESETS];
+}
+
+/**
+ * Valida una flotta in un'unica passata: ogni nave deve essere dentro la griglia,
+ * non sovrapporsi alle precedenti e avere una dimensione ancora richiesta dal regolamento.
+ * Con NUM_SHIPS navi tutte accettate la composizione coincide con quella richiesta.
+ * @param fleet Flotta da validare.
+ * @param fleet_rules Composizione richiesta.
+ * @param occupied Se non NULL, riceve la maschera delle celle occupate dalla flotta.
+ * @return 0 se la flotta è valida, -1 altrimenti.
+ */
+int validate_fleet(const FleetSetup *fleet, const FleetRules *fleet_rules, BoardMask *occupied) {
+    int remaining[GRID_SIZE + 1];
+    memcpy(remaining, fleet_rules->ship_counts, sizeof(remaining));
+
+    BoardMask fleet_mask;
+    mask_clear(&fleet_mask);
+
+    for (int i = 0; i < NUM_SHIPS; i++) {
+        BoardMask ship_mask;
+        if (get_ship_mask(&fleet->ships[i], &ship_mask) < 0) return -1;
+        if (remaining[fleet->ships[i].dim]-- == 0) return -1;
+        if (mask_intersects(&fleet_mask, &ship_mask)) return -1;
+        mask_add(&fleet_mask, &ship_mask);
+    }
+
+    if (occupied) *occupied = fleet_mask;
+    return 0;
+}
+
+/**
+ * Completa una flotta con piazzamenti casuali.
+ * Le prime `ships_placed` navi vengono mantenute; per ogni nave mancante si contano i piazzamenti
+ * compatibili con le celle già occupate e se ne estrae uno in modo uniforme, senza tentativi a vuoto.
+ * @param fleet Flotta da completare.
+ * @param ships_placed Numero di navi già piazzate all'inizio di `fleet->ships`.
+ * @param ship_dims Dimensioni delle NUM_SHIPS navi richieste, nell'ordine di piazzamento.
+ * @param rng_state Stato del generatore casuale.
+ * @return 0 in caso di successo, -1 se le navi già piazzate non sono valide o non lasciano spazio.
+ */
+int complete_random_fleet(FleetSetup *fleet, int ships_placed, const int *ship_dims, unsigned int *rng_state) {
+    BoardMask occupied;
+    mask_clear(&occupied);
+
+    for (int i = 0; i < ships_placed; i++) {
+        BoardMask ship_mask;
+        if (get_ship_mask(&fleet->ships[i], &ship_mask) < 0 || mask_intersects(&occupied, &ship_mask)) {
+            return -1;
+        }
+        mask_add(&occupied, &ship_mask);
+    }
+
+    for (int i = ships_placed; i < NUM_SHIPS; i++) {
+        int count;
+        const FleetPlacement *placements = get_ship_placements(ship_dims[i], &count);
+        if (placements == NULL) return -1;
+
+        int compatible = 0;
+        for (int j = 0; j < count; j++) {
+            if (!mask_intersects(&occupied, &placements[j].mask)) compatible++;
+        }
+        if (compatible == 0) return -1;
+
+        int chosen = rand_r(rng_state) % compatible;
+        for (int j = 0; j < count; j++) {
+            if (mask_intersects(&occupied, &placements[j].mask)) continue;
+            if (chosen-- == 0) {
+                fleet->ships[i] = placements[j].ship;
+                mask_add(&occupied, &placements[j].mask);
+                break;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * Genera una flotta casuale completa.
+ * @return 0 in caso di successo, -1 in caso di errore.
+ */
+int generate_random_fleet(FleetSetup *fleet, const int *ship_dims, unsigned int *rng_state) {
+    return complete_random_fleet(fleet, 0, ship_dims, rng_state);
+}
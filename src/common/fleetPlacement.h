@@ -0,0 +1,62 @@
+#ifndef FLEET_PLACEMENT_H
+#define FLEET_PLACEMENT_H
+
+#include <stdint.h>
+
+#include "common/game.h"
+
+/**
+ * Maschere di occupazione della griglia e tabelle dei piazzamenti legali.
+ * Ogni cella (x, y) corrisponde al bit x * GRID_SIZE + y di una BoardMask; per ogni dimensione
+ * di nave le tabelle contengono tutti i piazzamenti dentro la griglia con la relativa maschera,
+ * calcolati una sola volta per processo.
+ */
+
+#define BOARD_MASK_WORDS 2
+
+#if GRID_SIZE * GRID_SIZE > BOARD_MASK_WORDS * 64
+#error "BoardMask non può rappresentare una griglia di queste dimensioni"
+#endif
+
+typedef struct {
+    uint64_t w[BOARD_MASK_WORDS];
+} BoardMask;
+
+typedef struct {
+    BoardMask mask; // Celle occupate dalla nave
+    ShipPlacement ship; // Piazzamento corrispondente
+} FleetPlacement;
+
+typedef struct {
+    int ship_counts[GRID_SIZE + 1]; // Navi richieste dal regolamento, per dimensione
+} FleetRules;
+
+static inline void mask_clear(BoardMask *mask) {
+    for (int i = 0; i < BOARD_MASK_WORDS; i++) mask->w[i] = 0;
+}
+
+static inline void mask_set_cell(BoardMask *mask, int x, int y) {
+    int bit = x * GRID_SIZE + y;
+    mask->w[bit / 64] |= (uint64_t)1 << (bit % 64);
+}
+
+static inline int mask_intersects(const BoardMask *a, const BoardMask *b) {
+    uint64_t any = 0;
+    for (int i = 0; i < BOARD_MASK_WORDS; i++) any |= a->w[i] & b->w[i];
+    return any != 0;
+}
+
+static inline void mask_add(BoardMask *dest, const BoardMask *src) {
+    for (int i = 0; i < BOARD_MASK_WORDS; i++) dest->w[i] |= src->w[i];
+}
+
+const FleetPlacement *get_ship_placements(int dim, int *count);
+int get_ship_mask(const ShipPlacement *ship, BoardMask *mask);
+
+const FleetRules *get_fleet_rules(const GameRules *rules);
+int validate_fleet(const FleetSetup *fleet, const FleetRules *fleet_rules, BoardMask *occupied);
+
+int complete_random_fleet(FleetSetup *fleet, int ships_placed, const int *ship_dims, unsigned int *rng_state);
+int generate_random_fleet(FleetSetup *fleet, const int *ship_dims, unsigned int *rng_state);
+
+#endif // FLEET_PLACEMENT_H
@@ -1,14 +1,69 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <time.h>
 
 #include <pthread.h>
 
 #include "game.h"
+#include "common/bot.h"
 #include "utils/debug.h"
+#include "utils/slab.h"
+
+#define NAME_SLOT_SIZE 32 // Nomi di utenti e partite (max 30 caratteri + terminatore) copiati in un oggetto del pool
+
+/**
+ * Oggetto del pool degli stati di partita: lo stato e l'array dei primi GAME_POOL_PLAYERS
+ * giocatori, riusati insieme da una partita all'altra.
+ */
+typedef struct {
+    GameState state;
+    PlayerState players[GAME_POOL_PLAYERS];
+} GameStateSlot;
+
+typedef char NameSlot[NAME_SLOT_SIZE];
+
+static SlabPool game_state_pool = SLAB_POOL_INITIALIZER("game_state", GameStateSlot);
+static SlabPool fleet_pool = SLAB_POOL_INITIALIZER("fleet_setup", FleetSetup);
+static SlabPool name_pool = SLAB_POOL_INITIALIZER("name", NameSlot);
 
 const int SHIP_PLACEMENT_SEQUENCE[NUM_SHIPS] = {5, 4, 3, 3, 2}; // Requisiti di flotta per la partita
 
+// Regolamenti disponibili, l'indice nell'array è l'ID del regolamento
+const GameRules GAME_RULESETS[] = {
+    {"classic", 1, 1, SHIP_PLACEMENT_SEQUENCE},         // Un colpo per turno, chi colpisce tira ancora
+    {"salvo", MAX_SALVO_SIZE, 0, SHIP_PLACEMENT_SEQUENCE} // Una salva per turno, il turno passa sempre
+};
+const int NUM_GAME_RULESETS = sizeof(GAME_RULESETS) / sizeof(GAME_RULESETS[0]);
+
+/**
+ * Restituisce il regolamento associato a un ID.
+ * @param ruleset_id ID del regolamento.
+ * @return Puntatore al regolamento, o al regolamento "classic" se l'ID non è valido.
+ */
+const GameRules *get_game_rules(int ruleset_id) {
+    if (ruleset_id < 0 || ruleset_id >= NUM_GAME_RULESETS) {
+        return &GAME_RULESETS[0];
+    }
+    return &GAME_RULESETS[ruleset_id];
+}
+
+/**
+ * Cerca un regolamento per nome.
+ * @param name Nome del regolamento.
+ * @return ID del regolamento, o -1 se non esiste.
+ */
+int find_game_rules(const char *name) {
+    if (name == NULL) return -1;
+    for (int i = 0; i < NUM_GAME_RULESETS; i++) {
+        if (strcmp(GAME_RULESETS[i].name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
 /**
  * Crea e inizializza lo stato di una partita.
  * @param game_id ID della partita.
@@ -16,29 +71,28 @@ const int SHIP_PLACEMENT_SEQUENCE[NUM_SHIPS] = {5, 4, 3, 3, 2}; // Requisiti di
  * @return Puntatore a GameState se la creazione è riuscita, NULL altrimenti.
  */
 GameState *create_game_state(unsigned int game_id, const char *game_name) {
-    GameState *game = (GameState *)malloc(sizeof(GameState));
-    if (!game) {
+    GameStateSlot *slot = (GameStateSlot *)slab_alloc(&game_state_pool);
+    if (!slot) {
         LOG_ERROR("Memory allocation for GameState failed");
         return NULL;
     }
+    GameState *game = &slot->state;
 
     game->game_id = game_id;
-    game->game_name = (game_name) ? strdup(game_name) : NULL;
+    game->game_name = (game_name) ? alloc_name(game_name) : NULL;
     if (game->game_name == NULL && game_name != NULL) {
         LOG_ERROR("Memory allocation for game_name failed");
-        free(game);
+        slab_free(&game_state_pool, slot);
         return NULL;
     }
 
-    game->players_count = 0;
-    game->players_capacity = 4; // Initial capacity
+    game->rules = get_game_rules(0);
+    game->state_type = GAME_WAITING_FOR_PLAYERS;
+    game->rng_state = (unsigned int)time(NULL) ^ (unsigned int)(uintptr_t)game ^ game_id;
 
-    game->players = (PlayerState *)malloc(game->players_capacity * sizeof(PlayerState));
-    if (!game->players) {
-        free(game->game_name);
-        free(game);
-        return NULL;
-    }
+    game->players_count = 0;
+    game->players_capacity = GAME_POOL_PLAYERS;
+    game->players = slot->players;
 
     game->player_turn_order = NULL;
     game->player_turn_order_count = 0;
@@ -65,11 +119,18 @@ int add_player_to_game_state(GameState *game, int player_id, char *username) {
         return -1;
     }
 
-    // Se l'array dei giocatori è pieno, raddoppia la sua capacità
+    // Se l'array dei giocatori è pieno, raddoppia la sua capacità: la prima volta lascia l'array
+    // dell'oggetto del pool e passa allo heap
     if (game->players_count >= game->players_capacity) {
         size_t new_capacity = game->players_capacity * 2;
-        PlayerState *new_players = (PlayerState *)realloc(game->players, new_capacity * sizeof(PlayerState));
+        PlayerState *pooled_players = ((GameStateSlot *)game)->players;
+        PlayerState *new_players = game->players == pooled_players
+            ? (PlayerState *)malloc(new_capacity * sizeof(PlayerState))
+            : (PlayerState *)realloc(game->players, new_capacity * sizeof(PlayerState));
         if (new_players) {
+            if (game->players == pooled_players) {
+                memcpy(new_players, pooled_players, game->players_count * sizeof(PlayerState));
+            }
             game->players = new_players;
             game->players_capacity = new_capacity;
         } else {
@@ -80,12 +141,13 @@ int add_player_to_game_state(GameState *game, int player_id, char *username) {
     
     // Aggiungi il giocatore
     game->players[game->players_count].user.user_id = player_id;
-    game->players[game->players_count].user.username = strdup(username);
+    game->players[game->players_count].user.username = alloc_name(username);
     if (!game->players[game->players_count].user.username) {
         LOG_ERROR("Errore durante l'allocazione della memoria per il nome utente");
         return -1;
     }
     game->players[game->players_count].fleet = NULL;
+    game->players[game->players_count].bot = NULL;
     init_board(&game->players[game->players_count].board); // Inizializza la griglia di gioco del nuovo giocatore
     game->players_count++;
     
@@ -108,8 +170,9 @@ int remove_player_from_game_state(GameState *game, unsigned int player_id) {
 
     for (unsigned int i = 0; i < game->players_count; i++) {
         if (game->players[i].user.user_id == player_id) {
-            free(game->players[i].user.username); // Libera il nome utente
-            free(game->players[i].fleet); // Libera la flotta se allocata
+            free_name(game->players[i].user.username); // Libera il nome utente
+            free_fleet_setup(game->players[i].fleet); // Libera la flotta se allocata
+            free_bot(game->players[i].bot);
 
             // Sposta l'ultimo giocatore nella posizione corrente
             game->players[i] = game->players[game->players_count - 1];
@@ -154,13 +217,40 @@ void free_game_state(GameState *game) {
     if (game == NULL) return;
 
     for (unsigned int i = 0; i < game->players_count; i++) {
-        free(game->players[i].user.username);
-        free(game->players[i].fleet);
+        free_name(game->players[i].user.username);
+        free_fleet_setup(game->players[i].fleet);
+        free_bot(game->players[i].bot);
+    }
+    free_name(game->game_name);
+    if (game->players != ((GameStateSlot *)game)->players) {
+        free(game->players);
     }
-    free(game->game_name);
-    free(game->players);
     free(game->player_turn_order);
-    free(game);
+    slab_free(&game_state_pool, game);
+}
+
+/**
+ * Alloca la flotta di un giocatore dal pool delle flotte.
+ * @return La flotta, da liberare con free_fleet_setup (o free_game_state), o NULL se manca la memoria.
+ */
+FleetSetup *alloc_fleet_setup(void) {
+    return (FleetSetup *)slab_alloc(&fleet_pool);
+}
+
+void free_fleet_setup(FleetSetup *fleet) {
+    slab_free(&fleet_pool, fleet);
+}
+
+/**
+ * Copia il nome di un utente o di una partita, dal pool dei nomi se non supera i 31 caratteri.
+ * @return La copia, da liberare con free_name, o NULL se manca la memoria.
+ */
+char *alloc_name(const char *name) {
+    return slab_strdup(&name_pool, name);
+}
+
+void free_name(char *name) {
+    slab_free_string(&name_pool, name);
 }
 
 /**
@@ -333,10 +423,11 @@ int attack(PlayerState *player_state, int x, int y) {
  * Algoritmo di Fisher-Yates (o Knuth shuffle).
  * @param array Puntatore all'array di interi da mescolare.
  * @param size Dimensione dell'array.
+ * @param rng_state Stato del generatore casuale da usare.
  */
-static void shuffle_array(int *array, unsigned int size) {
+static void shuffle_array(int *array, unsigned int size, unsigned int *rng_state) {
     for (unsigned int i = size - 1; i > 0; i--) {
-        unsigned int j = rand() % (i + 1);
+        unsigned int j = rand_r(rng_state) % (i + 1);
         int temp = array[i];
         array[i] = array[j];
         array[j] = temp;
@@ -353,6 +444,7 @@ void generate_turn_order(GameState *game) {
         return; // Nessun giocatore da ordinare
     }
 
+    free(game->player_turn_order);
     game->player_turn_order = (int *)malloc(game->players_count * sizeof(int));
     if (game->player_turn_order == NULL) {
         LOG_ERROR("Allocazione di memoria per player_turn_order fallita");
@@ -364,7 +456,7 @@ void generate_turn_order(GameState *game) {
     for (unsigned int i = 0; i < game->players_count; i++) {
         game->player_turn_order[i] = game->players[i].user.user_id;
     }
-    shuffle_array(game->player_turn_order, game->players_count); // Mescola l'ordine dei giocatori
+    shuffle_array(game->player_turn_order, game->players_count, &game->rng_state); // Mescola l'ordine dei giocatori
     
     // Inizializza l'ordine di turno
     game->player_turn = 0;
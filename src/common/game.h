@@ -6,6 +6,20 @@
 #define NUM_SHIPS 5
 extern const int SHIP_PLACEMENT_SEQUENCE[NUM_SHIPS]; // Requisiti di flotta per la partita
 
+#define MAX_SALVO_SIZE NUM_SHIPS // Numero massimo di colpi in un singolo MSG_ATTACK
+
+#define GAME_POOL_PLAYERS 8 // Giocatori con spazio già riservato negli oggetti dei pool delle partite, oltre si passa allo heap
+
+typedef struct {
+    const char *name; // Nome del regolamento, usato nel protocollo (es. "classic")
+    int salvo_size; // Numero massimo di colpi che un giocatore può sparare in un turno
+    int extra_turn_on_hit; // 1 se un colpo andato a segno concede un altro turno
+    const int *fleet; // Dimensioni delle NUM_SHIPS navi richieste, nell'ordine di piazzamento
+} GameRules;
+
+extern const GameRules GAME_RULESETS[];
+extern const int NUM_GAME_RULESETS;
+
 typedef struct {
     unsigned int user_id; // ID dell'utente
     char *username; // Nome utente (max 30 caratteri + terminatore), NULL se non impostato
@@ -31,15 +45,31 @@ typedef struct {
     int x, y;
 } AttackPosition;
 
+typedef struct {
+    int count; // Numero di colpi validi in `shots`
+    AttackPosition shots[MAX_SALVO_SIZE]; // Bersagli della salva, anche su avversari diversi
+} AttackSalvo;
+
+typedef enum {
+    GAME_WAITING_FOR_PLAYERS,
+    GAME_WAITING_FLEET_SETUP,
+    GAME_IN_PROGRESS,
+    GAME_FINISHED
+} GameStateType;
+
 typedef struct {
     UserInfo user; // Informazioni sull'utente
     GameBoard board; // La griglia di gioco dell'utente
     FleetSetup *fleet; // Posizioni delle navi piazzate
+    struct BotState *bot; // Bot che controlla il giocatore, NULL per i giocatori umani
 } PlayerState;
 
 typedef struct {
     char *game_name; // Nome della partita (max 30 caratteri + terminatore), NULL se non impostato
     int game_id; // ID della partita
+    const GameRules *rules; // Regolamento della partita, mai NULL
+    GameStateType state_type; // Fase corrente della partita
+    unsigned int rng_state; // Stato del generatore casuale della partita (rand_r)
     
     PlayerState *players; // Array di giocatori nella partita
     unsigned int players_count; // Numero attuale di giocatori nella partita
@@ -51,12 +81,19 @@ typedef struct {
 } GameState;
 
 
+const GameRules *get_game_rules(int ruleset_id);
+int find_game_rules(const char *name);
+
 GameState *create_game_state(unsigned int game_id, const char *game_name);
 int add_player_to_game_state(GameState *game, int player_id, char *username);
 int remove_player_from_game_state(GameState *game, unsigned int player_id);
 PlayerState *get_player_state(GameState *game, unsigned int player_id);
 char *get_player_username(GameState *game, unsigned int player_id);
 void free_game_state(GameState *game);
+FleetSetup *alloc_fleet_setup(void);
+void free_fleet_setup(FleetSetup *fleet);
+char *alloc_name(const char *name);
+void free_name(char *name);
 
 int init_board(GameBoard *board);
 int set_cell(GameBoard *board, int x, int y, char value);
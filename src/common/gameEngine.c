@@ -0,0 +1,427 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/gameEngine.h"
+#include "common/fleetPlacement.h"
+#include "utils/debug.h"
+
+/**
+ * Inizializza una lista di eventi vuota.
+ * @param list Lista da inizializzare.
+ */
+void init_game_event_list(GameEventList *list) {
+    list->events = NULL;
+    list->count = 0;
+    list->capacity = 0;
+}
+
+/**
+ * Svuota una lista di eventi mantenendo la memoria già allocata.
+ * @param list Lista da svuotare.
+ */
+void clear_game_event_list(GameEventList *list) {
+    list->count = 0;
+}
+
+/**
+ * Libera la memoria di una lista di eventi.
+ * @param list Lista da liberare.
+ */
+void free_game_event_list(GameEventList *list) {
+    free(list->events);
+    init_game_event_list(list);
+}
+
+/**
+ * Aggiunge un evento in coda alla lista.
+ * Se la lista è piena, raddoppia la sua capacità.
+ * @return 0 in caso di successo, -1 in caso di errore di allocazione.
+ */
+static int push_event(GameEventList *list, GameEventType type, int player_id, int target_id, int x, int y, int result) {
+    if (list == NULL) return 0; // Il chiamante non è interessato agli eventi
+
+    if (list->count >= list->capacity) {
+        unsigned int new_capacity = list->capacity ? list->capacity * 2 : 16;
+        GameEvent *new_events = (GameEvent *)realloc(list->events, new_capacity * sizeof(GameEvent));
+        if (new_events == NULL) {
+            LOG_ERROR("Allocazione della lista di eventi fallita");
+            return -1;
+        }
+        list->events = new_events;
+        list->capacity = new_capacity;
+    }
+
+    GameEvent *event = &list->events[list->count++];
+    event->type = type;
+    event->player_id = player_id;
+    event->target_id = target_id;
+    event->x = x;
+    event->y = y;
+    event->result = result;
+    return 0;
+}
+
+/**
+ * Crea lo stato di una nuova partita.
+ * @param game_id ID della partita.
+ * @param game_name Nome della partita.
+ * @param ruleset_id ID del regolamento (vedi GAME_RULESETS).
+ * @param seed Seme del generatore casuale della partita, 0 per mantenere quello predefinito.
+ * @return Puntatore al nuovo GameState, o NULL in caso di errore.
+ */
+GameState *engine_create_game(unsigned int game_id, const char *game_name, int ruleset_id, unsigned int seed) {
+    GameState *game = create_game_state(game_id, game_name);
+    if (game == NULL) return NULL;
+
+    game->rules = get_game_rules(ruleset_id);
+    if (seed != 0) {
+        game->rng_state = seed;
+    }
+    return game;
+}
+
+/**
+ * Restituisce l'ID del giocatore di turno.
+ * @return ID del giocatore, o -1 se la partita non è in corso.
+ */
+int engine_current_player(GameState *game) {
+    if (game->state_type != GAME_IN_PROGRESS || game->player_turn_order == NULL || game->player_turn < 0) {
+        return -1;
+    }
+    return game->player_turn_order[game->player_turn];
+}
+
+/**
+ * Verifica se tutti i giocatori della partita hanno piazzato la flotta.
+ * @return 1 se tutte le flotte sono pronte, 0 altrimenti.
+ */
+int engine_all_fleets_placed(GameState *game) {
+    for (unsigned int i = 0; i < game->players_count; i++) {
+        if (game->players[i].fleet == NULL) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * Verifica se un giocatore è ancora nell'ordine dei turni (non eliminato né uscito).
+ * @return 1 se il giocatore è attivo, 0 altrimenti.
+ */
+int engine_is_active_player(GameState *game, int player_id) {
+    for (unsigned int i = 0; i < game->player_turn_order_count; i++) {
+        if (game->player_turn_order[i] == player_id) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Rimuove un giocatore dall'ordine dei turni, se presente.
+ */
+static void remove_from_turn_order(GameState *game, int player_id) {
+    for (unsigned int i = 0; i < game->player_turn_order_count; i++) {
+        if (game->player_turn_order[i] == player_id) {
+            game->player_turn_order[i] = -1;
+            return;
+        }
+    }
+}
+
+/**
+ * Controlla le condizioni di vittoria: se al più un giocatore è ancora attivo la partita termina.
+ * @return 1 se la partita è terminata, 0 altrimenti.
+ */
+static int check_victory(GameState *game, GameEventList *events) {
+    if (game->state_type != GAME_IN_PROGRESS) return 0;
+
+    int active_players_count = 0;
+    int winner_id = -1;
+    for (unsigned int i = 0; i < game->player_turn_order_count; i++) {
+        if (game->player_turn_order[i] != -1) {
+            active_players_count++;
+            winner_id = game->player_turn_order[i];
+        }
+    }
+
+    if (active_players_count > 1) return 0;
+
+    game->state_type = GAME_FINISHED;
+    push_event(events, GAME_EVENT_GAME_FINISHED, winner_id, -1, 0, 0, 0);
+    return 1;
+}
+
+/**
+ * Aggiunge un giocatore a una partita in attesa di giocatori.
+ * @return ENGINE_OK o un codice di errore EngineResult.
+ */
+int engine_join(GameState *game, int player_id, char *username, GameEventList *events) {
+    if (game->state_type != GAME_WAITING_FOR_PLAYERS) {
+        return ENGINE_ERROR_STATE;
+    }
+    if (get_player_state(game, player_id) != NULL) {
+        return ENGINE_ERROR_INVALID;
+    }
+    if (add_player_to_game_state(game, player_id, username) < 0) {
+        return ENGINE_ERROR_MEMORY;
+    }
+
+    push_event(events, GAME_EVENT_PLAYER_JOINED, player_id, -1, 0, 0, 0);
+    return ENGINE_OK;
+}
+
+/**
+ * Rimuove un giocatore dalla partita, in qualunque fase.
+ * Se la partita è in corso il giocatore esce dall'ordine dei turni: questo può concludere
+ * la partita o, se era il suo turno, passare il turno al giocatore successivo.
+ * @return ENGINE_OK, o ENGINE_ERROR_INVALID se il giocatore non è nella partita.
+ */
+int engine_leave(GameState *game, int player_id, GameEventList *events) {
+    int was_current = (engine_current_player(game) == player_id);
+
+    if (remove_player_from_game_state(game, player_id) < 0) {
+        return ENGINE_ERROR_INVALID;
+    }
+    remove_from_turn_order(game, player_id);
+    push_event(events, GAME_EVENT_PLAYER_LEFT, player_id, -1, 0, 0, 0);
+
+    if (game->state_type == GAME_IN_PROGRESS) {
+        if (check_victory(game, events)) {
+            return ENGINE_OK;
+        }
+        if (was_current) {
+            engine_advance_turn(game, events);
+        }
+    } else if (game->state_type == GAME_WAITING_FLEET_SETUP && game->players_count > 0 && engine_all_fleets_placed(game)) {
+        // Chi mancava all'appello è uscito, la partita può iniziare
+        engine_begin_game(game, events);
+    }
+
+    return ENGINE_OK;
+}
+
+/**
+ * Valida e piazza la flotta di un giocatore.
+ * La flotta viene validata con le maschere di occupazione e la composizione precalcolata del
+ * regolamento; la griglia del giocatore viene costruita solo se la flotta è valida.
+ * Se la partita attendeva solo questa flotta, la partita inizia.
+ * @return ENGINE_OK o un codice di errore EngineResult.
+ */
+int engine_place_fleet(GameState *game, int player_id, const FleetSetup *fleet, GameEventList *events) {
+    if (game->state_type != GAME_WAITING_FOR_PLAYERS && game->state_type != GAME_WAITING_FLEET_SETUP) {
+        return ENGINE_ERROR_STATE;
+    }
+
+    PlayerState *player_state = get_player_state(game, player_id);
+    if (player_state == NULL) {
+        return ENGINE_ERROR_INVALID;
+    }
+    if (player_state->fleet != NULL) {
+        return ENGINE_ERROR_STATE;
+    }
+
+    const FleetRules *fleet_rules = get_fleet_rules(game->rules);
+    if (fleet_rules == NULL || validate_fleet(fleet, fleet_rules, NULL) < 0) {
+        return ENGINE_ERROR_INVALID;
+    }
+
+    player_state->fleet = alloc_fleet_setup();
+    if (player_state->fleet == NULL) {
+        return ENGINE_ERROR_MEMORY;
+    }
+    *player_state->fleet = *fleet;
+
+    // La flotta è già stata validata, il piazzamento non può fallire
+    init_board(&player_state->board);
+    for (int i = 0; i < NUM_SHIPS; i++) {
+        place_ship(&player_state->board, &player_state->fleet->ships[i]);
+    }
+
+    push_event(events, GAME_EVENT_FLEET_PLACED, player_id, -1, 0, 0, 0);
+
+    if (game->state_type == GAME_WAITING_FLEET_SETUP && engine_all_fleets_placed(game)) {
+        engine_begin_game(game, events);
+    }
+    return ENGINE_OK;
+}
+
+/**
+ * Avvia la partita su richiesta del proprietario.
+ * Se tutte le flotte sono pronte la partita inizia subito, altrimenti entra nella fase
+ * GAME_WAITING_FLEET_SETUP e viene emesso GAME_EVENT_FLEET_SETUP_STARTED.
+ * @return ENGINE_OK o ENGINE_ERROR_STATE se la partita non è in attesa di giocatori.
+ */
+int engine_start(GameState *game, GameEventList *events) {
+    if (game->state_type != GAME_WAITING_FOR_PLAYERS) {
+        return ENGINE_ERROR_STATE;
+    }
+
+    if (engine_all_fleets_placed(game)) {
+        return engine_begin_game(game, events);
+    }
+
+    game->state_type = GAME_WAITING_FLEET_SETUP;
+    push_event(events, GAME_EVENT_FLEET_SETUP_STARTED, -1, -1, 0, 0, 0);
+    return ENGINE_OK;
+}
+
+/**
+ * Porta la partita in GAME_IN_PROGRESS, genera l'ordine dei turni e assegna il primo turno.
+ * I giocatori senza flotta devono essere già stati rimossi dal chiamante.
+ * Con meno di due giocatori la partita termina subito.
+ * @return ENGINE_OK o un codice di errore EngineResult.
+ */
+int engine_begin_game(GameState *game, GameEventList *events) {
+    if (game->state_type != GAME_WAITING_FOR_PLAYERS && game->state_type != GAME_WAITING_FLEET_SETUP) {
+        return ENGINE_ERROR_STATE;
+    }
+
+    game->state_type = GAME_IN_PROGRESS;
+    if (game->players_count < 2) {
+        int winner_id = game->players_count == 1 ? (int)game->players[0].user.user_id : -1;
+        game->state_type = GAME_FINISHED;
+        push_event(events, GAME_EVENT_GAME_FINISHED, winner_id, -1, 0, 0, 0);
+        return ENGINE_OK;
+    }
+
+    generate_turn_order(game);
+    if (game->player_turn_order == NULL) {
+        return ENGINE_ERROR_MEMORY;
+    }
+    push_event(events, GAME_EVENT_GAME_STARTED, -1, -1, 0, 0, 0);
+
+    game->player_turn = 0;
+    push_event(events, GAME_EVENT_TURN, game->player_turn_order[0], -1, 0, 0, 0);
+    return ENGINE_OK;
+}
+
+/**
+ * Applica una salva del giocatore di turno.
+ * Tutti i colpi vengono validati prima di modificare le griglie; se anche uno solo non è valido
+ * la salva viene rifiutata e lo stato della partita resta invariato.
+ * Dopo la salva vengono controllate le condizioni di vittoria e viene assegnato il turno successivo
+ * (o un turno aggiuntivo, se il regolamento lo prevede).
+ * @param shots Colpi della salva.
+ * @param shots_count Numero di colpi, al massimo `rules->salvo_size`.
+ * @return ENGINE_OK o un codice di errore EngineResult.
+ */
+int engine_apply_attack(GameState *game, int attacker_id, const AttackPosition *shots, int shots_count, GameEventList *events) {
+    if (game->state_type != GAME_IN_PROGRESS) {
+        return ENGINE_ERROR_STATE;
+    }
+    if (engine_current_player(game) != attacker_id) {
+        return ENGINE_ERROR_NOT_YOUR_TURN;
+    }
+    if (shots_count <= 0 || shots_count > game->rules->salvo_size) {
+        return ENGINE_ERROR_MALFORMED;
+    }
+
+    PlayerState *targets[MAX_SALVO_SIZE];
+    for (int i = 0; i < shots_count; i++) {
+        const AttackPosition *shot = &shots[i];
+
+        if (shot->player_id == attacker_id) {
+            return ENGINE_ERROR_INVALID; // Auto-attacco
+        }
+
+        targets[i] = get_player_state(game, shot->player_id);
+        if (targets[i] == NULL || targets[i]->fleet == NULL) {
+            return ENGINE_ERROR_INVALID;
+        }
+
+        if (shot->x < 0 || shot->x >= GRID_SIZE || shot->y < 0 || shot->y >= GRID_SIZE) {
+            return ENGINE_ERROR_INVALID;
+        }
+
+        char cell = targets[i]->board.grid[shot->x][shot->y];
+        if (cell == 'X' || cell == '*') {
+            return ENGINE_ERROR_INVALID; // Cella già colpita
+        }
+
+        for (int j = 0; j < i; j++) {
+            if (shots[j].player_id == shot->player_id && shots[j].x == shot->x && shots[j].y == shot->y) {
+                return ENGINE_ERROR_INVALID; // Cella ripetuta nella stessa salva
+            }
+        }
+    }
+
+    int any_hit = 0;
+    int eliminated[MAX_SALVO_SIZE];
+    int eliminated_count = 0;
+    for (int i = 0; i < shots_count; i++) {
+        int ret = attack(targets[i], shots[i].x, shots[i].y);
+        if (ret < 0) continue; // Non può accadere dopo la validazione
+
+        if (ret > 0) any_hit = 1;
+        if (ret == 3) eliminated[eliminated_count++] = shots[i].player_id;
+        push_event(events, GAME_EVENT_ATTACK, attacker_id, shots[i].player_id, shots[i].x, shots[i].y, ret);
+    }
+
+    for (int i = 0; i < eliminated_count; i++) {
+        remove_from_turn_order(game, eliminated[i]);
+        push_event(events, GAME_EVENT_PLAYER_ELIMINATED, eliminated[i], -1, 0, 0, 0);
+    }
+
+    if (check_victory(game, events)) {
+        return ENGINE_OK;
+    }
+
+    if (any_hit && game->rules->extra_turn_on_hit) {
+        push_event(events, GAME_EVENT_TURN, attacker_id, -1, 0, 0, 1);
+        return ENGINE_OK;
+    }
+    return engine_advance_turn(game, events);
+}
+
+/**
+ * Passa il turno al prossimo giocatore attivo nell'ordine dei turni.
+ * Se non restano almeno due giocatori attivi la partita termina.
+ * @return ENGINE_OK o ENGINE_ERROR_STATE se la partita non è in corso.
+ */
+int engine_advance_turn(GameState *game, GameEventList *events) {
+    if (game->state_type != GAME_IN_PROGRESS || game->player_turn_order_count == 0) {
+        return ENGINE_ERROR_STATE;
+    }
+
+    if (check_victory(game, events)) {
+        return ENGINE_OK;
+    }
+
+    do {
+        game->player_turn = (game->player_turn + 1) % game->player_turn_order_count;
+    } while (game->player_turn_order[game->player_turn] == -1);
+
+    push_event(events, GAME_EVENT_TURN, game->player_turn_order[game->player_turn], -1, 0, 0, 0);
+    return ENGINE_OK;
+}
+
+/**
+ * Riprende una partita ricostruita da un checkpoint, ripetendo l'ultimo evento da cui i
+ * giocatori ripartono: il turno corrente se la partita è in corso, l'attesa delle flotte
+ * mancanti se la partita era in fase di piazzamento.
+ * @return ENGINE_OK, anche se la partita è ancora in attesa di giocatori e non serve alcun evento.
+ */
+int engine_resume(GameState *game, GameEventList *events) {
+    switch (game->state_type) {
+        case GAME_WAITING_FLEET_SETUP:
+            if (engine_all_fleets_placed(game)) {
+                return engine_begin_game(game, events);
+            }
+            push_event(events, GAME_EVENT_FLEET_SETUP_STARTED, -1, -1, 0, 0, 0);
+            return ENGINE_OK;
+
+        case GAME_IN_PROGRESS: {
+            int current_player = engine_current_player(game);
+            if (current_player == -1) {
+                return engine_advance_turn(game, events);
+            }
+            push_event(events, GAME_EVENT_TURN, current_player, -1, 0, 0, 0);
+            return ENGINE_OK;
+        }
+
+        default:
+            return ENGINE_OK;
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef GAME_ENGINE_H
+#define GAME_ENGINE_H
+
+#include "common/game.h"
+
+/**
+ * Motore di gioco senza I/O.
+ * Tutte le funzioni operano solo su GameState e descrivono cosa è successo aggiungendo
+ * eventi a una GameEventList: è compito di chi le chiama (server, simulatore, replay)
+ * tradurre gli eventi in messaggi, log o statistiche.
+ */
+
+typedef enum {
+    GAME_EVENT_PLAYER_JOINED,       // player_id si è unito alla partita
+    GAME_EVENT_PLAYER_LEFT,         // player_id ha lasciato la partita
+    GAME_EVENT_FLEET_PLACED,        // player_id ha piazzato la flotta
+    GAME_EVENT_FLEET_SETUP_STARTED, // la partita attende le flotte dei giocatori ritardatari
+    GAME_EVENT_GAME_STARTED,        // ordine dei turni generato, vedi GameState.player_turn_order
+    GAME_EVENT_ATTACK,              // colpo di player_id su target_id in (x, y), esito in result
+    GAME_EVENT_PLAYER_ELIMINATED,   // player_id ha perso tutte le navi
+    GAME_EVENT_TURN,                // è il turno di player_id, result = 1 se è un turno aggiuntivo
+    GAME_EVENT_GAME_FINISHED        // partita terminata, player_id è il vincitore (-1 se nessuno)
+} GameEventType;
+
+typedef struct {
+    GameEventType type;
+    int player_id;
+    int target_id;
+    int x, y;
+    int result; // Per GAME_EVENT_ATTACK: valore restituito da attack() (0 mancato, 1 colpito, 2 affondato, 3 eliminato)
+} GameEvent;
+
+typedef struct {
+    GameEvent *events; // Array di eventi, riutilizzabile tra più chiamate
+    unsigned int count; // Numero di eventi presenti
+    unsigned int capacity; // Capacità attuale dell'array
+} GameEventList;
+
+typedef enum {
+    ENGINE_OK = 0,
+    ENGINE_ERROR_STATE = -1,        // Azione non ammessa nello stato attuale della partita
+    ENGINE_ERROR_NOT_YOUR_TURN = -2,// Il giocatore ha agito fuori dal proprio turno
+    ENGINE_ERROR_MALFORMED = -3,    // Parametri non validi (es. salva troppo lunga)
+    ENGINE_ERROR_INVALID = -4,      // Azione ben formata ma non valida (es. cella già colpita)
+    ENGINE_ERROR_MEMORY = -5        // Errore di allocazione
+} EngineResult;
+
+void init_game_event_list(GameEventList *list);
+void clear_game_event_list(GameEventList *list);
+void free_game_event_list(GameEventList *list);
+
+GameState *engine_create_game(unsigned int game_id, const char *game_name, int ruleset_id, unsigned int seed);
+int engine_join(GameState *game, int player_id, char *username, GameEventList *events);
+int engine_leave(GameState *game, int player_id, GameEventList *events);
+int engine_place_fleet(GameState *game, int player_id, const FleetSetup *fleet, GameEventList *events);
+int engine_start(GameState *game, GameEventList *events);
+int engine_begin_game(GameState *game, GameEventList *events);
+int engine_apply_attack(GameState *game, int attacker_id, const AttackPosition *shots, int shots_count, GameEventList *events);
+int engine_advance_turn(GameState *game, GameEventList *events);
+int engine_resume(GameState *game, GameEventList *events);
+
+int engine_current_player(GameState *game);
+int engine_all_fleets_placed(GameState *game);
+int engine_is_active_player(GameState *game, int player_id);
+
+#endif // GAME_ENGINE_H
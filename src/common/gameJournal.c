@@ -0,0 +1,415 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#include "common/gameJournal.h"
+#include "utils/debug.h"
+
+/**
+ * Restituisce spazio per `size` byte contigui nei blocchi in attesa.
+ * Se l'ultimo blocco non ha spazio sufficiente passa al successivo, allocandolo se necessario;
+ * se tutti i JOURNAL_MAX_BLOCKS blocchi sono pieni, li scrive prima su file.
+ * @return Puntatore allo spazio riservato, o NULL in caso di errore.
+ */
+static unsigned char *reserve_bytes(GameJournal *journal, size_t size) {
+    if (size > JOURNAL_BLOCK_SIZE) return NULL;
+
+    int last = journal->blocks_used - 1;
+    if (last < 0 || journal->block_sizes[last] + size > JOURNAL_BLOCK_SIZE) {
+        if (journal->blocks_used == JOURNAL_MAX_BLOCKS && journal_flush(journal) < 0) {
+            return NULL;
+        }
+
+        last = journal->blocks_used;
+        if (journal->blocks[last] == NULL) {
+            journal->blocks[last] = (char *)malloc(JOURNAL_BLOCK_SIZE);
+            if (journal->blocks[last] == NULL) return NULL;
+        }
+        journal->block_sizes[last] = 0;
+        journal->blocks_used++;
+    }
+
+    unsigned char *dest = (unsigned char *)journal->blocks[last] + journal->block_sizes[last];
+    journal->block_sizes[last] += size;
+    return dest;
+}
+
+/**
+ * Crea il journal di una partita e vi accoda l'header.
+ * Il file non deve esistere.
+ * @param path Percorso del file.
+ * @param game Partita da registrare.
+ * @return Puntatore al nuovo GameJournal, o NULL in caso di errore.
+ */
+GameJournal *journal_create(const char *path, const GameState *game) {
+    GameJournal *journal = (GameJournal *)calloc(1, sizeof(GameJournal));
+    if (journal == NULL) {
+        LOG_ERROR("Allocazione del journal fallita");
+        return NULL;
+    }
+
+    journal->fd = open(path, O_WRONLY | O_CREAT | O_EXCL | O_APPEND | O_CLOEXEC, 0644);
+    if (journal->fd < 0) {
+        LOG_ERROR("Impossibile creare il journal `%s`: %s", path, strerror(errno));
+        free(journal);
+        return NULL;
+    }
+
+    JournalFileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = JOURNAL_MAGIC;
+    header.version = JOURNAL_VERSION;
+    header.ruleset_id = (uint16_t)(game->rules - GAME_RULESETS);
+    header.game_id = game->game_id;
+    header.created_at = (int64_t)time(NULL);
+    if (game->game_name != NULL) {
+        strncpy(header.game_name, game->game_name, JOURNAL_NAME_SIZE - 1);
+    }
+
+    unsigned char *dest = reserve_bytes(journal, sizeof(header));
+    if (dest == NULL) {
+        journal_close(journal);
+        return NULL;
+    }
+    memcpy(dest, &header, sizeof(header));
+    return journal;
+}
+
+/**
+ * Riprende la scrittura di un journal già aperto e con l'header già scritto, ad esempio
+ * ricevuto da un altro processo server insieme alla sua partita.
+ * @param fd File descriptor del journal, aperto in append; il journal ne diventa proprietario.
+ * @return Puntatore al journal, o NULL in caso di errore.
+ */
+GameJournal *journal_adopt(int fd) {
+    GameJournal *journal = (GameJournal *)calloc(1, sizeof(GameJournal));
+    if (journal == NULL) {
+        LOG_ERROR("Allocazione del journal fallita");
+        return NULL;
+    }
+    journal->fd = fd;
+    return journal;
+}
+
+/**
+ * Accoda gli eventi prodotti dal motore di gioco, senza scriverli su file.
+ * I dati aggiuntivi (nome utente, flotta, ordine dei turni) sono letti da `game`, che deve
+ * essere lo stato della partita subito dopo la chiamata al motore che ha prodotto gli eventi.
+ * @param journal Journal della partita, può essere NULL.
+ * @param game Stato della partita.
+ * @param events Eventi da accodare.
+ * @return 0 in caso di successo, -1 in caso di errore.
+ */
+int journal_append_events(GameJournal *journal, GameState *game, const GameEventList *events) {
+    if (journal == NULL || journal->fd < 0) return 0;
+
+    for (unsigned int i = 0; i < events->count; i++) {
+        const GameEvent *event = &events->events[i];
+        const char *username = NULL;
+        PlayerState *player_state = NULL;
+        size_t extra_size = 0;
+
+        switch (event->type) {
+            case GAME_EVENT_PLAYER_JOINED:
+                username = get_player_username(game, event->player_id);
+                extra_size = username ? strnlen(username, JOURNAL_NAME_SIZE - 1) : 0;
+                break;
+            case GAME_EVENT_FLEET_PLACED:
+                player_state = get_player_state(game, event->player_id);
+                extra_size = (player_state && player_state->fleet) ? NUM_SHIPS * sizeof(JournalShip) : 0;
+                break;
+            case GAME_EVENT_GAME_STARTED:
+                extra_size = game->player_turn_order_count * sizeof(int32_t);
+                break;
+            default:
+                break;
+        }
+
+        unsigned char *dest = reserve_bytes(journal, sizeof(JournalRecord) + extra_size);
+        if (dest == NULL) {
+            LOG_ERROR("Spazio esaurito nel journal della partita %d", game->game_id);
+            return -1;
+        }
+
+        JournalRecord record;
+        memset(&record, 0, sizeof(record));
+        record.type = (uint8_t)event->type;
+        record.result = (int8_t)event->result;
+        record.x = (uint8_t)event->x;
+        record.y = (uint8_t)event->y;
+        record.player_id = event->player_id;
+        record.target_id = event->target_id;
+        record.extra_size = (uint16_t)extra_size;
+        memcpy(dest, &record, sizeof(record));
+        dest += sizeof(record);
+
+        if (event->type == GAME_EVENT_PLAYER_JOINED) {
+            memcpy(dest, username, extra_size);
+        } else if (event->type == GAME_EVENT_FLEET_PLACED && extra_size > 0) {
+            for (int j = 0; j < NUM_SHIPS; j++) {
+                const ShipPlacement *ship = &player_state->fleet->ships[j];
+                JournalShip journal_ship = {(uint8_t)ship->x, (uint8_t)ship->y, (uint8_t)ship->dim, (uint8_t)ship->vertical};
+                memcpy(dest + j * sizeof(JournalShip), &journal_ship, sizeof(JournalShip));
+            }
+        } else if (event->type == GAME_EVENT_GAME_STARTED) {
+            for (unsigned int j = 0; j < game->player_turn_order_count; j++) {
+                int32_t player_id = game->player_turn_order[j];
+                memcpy(dest + j * sizeof(int32_t), &player_id, sizeof(int32_t));
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * Scrive su file tutti i blocchi in attesa con una sola writev.
+ * In caso di errore la scrittura del journal viene disabilitata: la partita continua
+ * senza journal.
+ * @param journal Journal della partita, può essere NULL.
+ * @return 0 in caso di successo, -1 in caso di errore.
+ */
+int journal_flush(GameJournal *journal) {
+    if (journal == NULL || journal->blocks_used == 0) return 0;
+    if (journal->fd < 0) {
+        journal->blocks_used = 0;
+        return -1;
+    }
+
+    struct iovec iov[JOURNAL_MAX_BLOCKS];
+    for (int i = 0; i < journal->blocks_used; i++) {
+        iov[i].iov_base = journal->blocks[i];
+        iov[i].iov_len = journal->block_sizes[i];
+    }
+
+    int iov_count = journal->blocks_used;
+    int iov_index = 0;
+    while (iov_index < iov_count) {
+        ssize_t written = writev(journal->fd, &iov[iov_index], iov_count - iov_index);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            LOG_ERROR("Errore durante la scrittura del journal: %s, journal disabilitato", strerror(errno));
+            close(journal->fd);
+            journal->fd = -1;
+            journal->blocks_used = 0;
+            return -1;
+        }
+
+        while (iov_index < iov_count && (size_t)written >= iov[iov_index].iov_len) {
+            written -= iov[iov_index].iov_len;
+            iov_index++;
+        }
+        if (iov_index < iov_count) {
+            iov[iov_index].iov_base = (char *)iov[iov_index].iov_base + written;
+            iov[iov_index].iov_len -= written;
+        }
+    }
+
+    journal->blocks_used = 0;
+    return 0;
+}
+
+/**
+ * Scrive i record in attesa, chiude il file e libera il journal.
+ * @param journal Journal della partita, può essere NULL.
+ */
+void journal_close(GameJournal *journal) {
+    if (journal == NULL) return;
+
+    journal_flush(journal);
+    if (journal->fd >= 0) {
+        close(journal->fd);
+    }
+    for (int i = 0; i < JOURNAL_MAX_BLOCKS; i++) {
+        free(journal->blocks[i]);
+    }
+    free(journal);
+}
+
+/**
+ * Apre un journal in lettura mappandolo in memoria.
+ * @param path Percorso del file.
+ * @param reader Lettore da inizializzare.
+ * @return 0 in caso di successo, -1 se il file non esiste o non è un journal valido.
+ */
+int journal_open_reader(const char *path, JournalReader *reader) {
+    memset(reader, 0, sizeof(JournalReader));
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        LOG_ERROR("Impossibile aprire il journal `%s`: %s", path, strerror(errno));
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(JournalFileHeader)) {
+        LOG_ERROR("Il file `%s` è troppo corto per essere un journal", path);
+        close(fd);
+        return -1;
+    }
+
+    void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // La mappatura resta valida anche dopo la chiusura del file
+    if (map == MAP_FAILED) {
+        LOG_ERROR("Errore durante la mmap del journal `%s`: %s", path, strerror(errno));
+        return -1;
+    }
+
+    reader->map = (const unsigned char *)map;
+    reader->size = st.st_size;
+    reader->header = (const JournalFileHeader *)map;
+    reader->offset = sizeof(JournalFileHeader);
+    reader->index = 0;
+
+    if (reader->header->magic != JOURNAL_MAGIC || reader->header->version != JOURNAL_VERSION) {
+        LOG_ERROR("Il file `%s` non è un journal supportato", path);
+        journal_close_reader(reader);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Restituisce il prossimo record del journal.
+ * @param reader Lettore del journal.
+ * @param extra Se non NULL, riceve il puntatore ai dati aggiuntivi del record.
+ * @return Puntatore al record, o NULL alla fine del journal o se l'ultimo record è troncato.
+ */
+const JournalRecord *journal_next_record(JournalReader *reader, const void **extra) {
+    if (reader->offset + sizeof(JournalRecord) > reader->size) return NULL;
+
+    const JournalRecord *record = (const JournalRecord *)(reader->map + reader->offset);
+    if (reader->offset + sizeof(JournalRecord) + record->extra_size > reader->size) return NULL;
+
+    if (extra) *extra = reader->map + reader->offset + sizeof(JournalRecord);
+    reader->offset += sizeof(JournalRecord) + record->extra_size;
+    reader->index++;
+    return record;
+}
+
+void journal_close_reader(JournalReader *reader) {
+    if (reader->map != NULL) {
+        munmap((void *)reader->map, reader->size);
+    }
+    memset(reader, 0, sizeof(JournalReader));
+}
+
+/**
+ * Crea una partita vuota con i dati dell'header del journal.
+ * @return Puntatore al nuovo GameState, o NULL in caso di errore.
+ */
+GameState *journal_create_game(const JournalReader *reader) {
+    char game_name[JOURNAL_NAME_SIZE];
+    memcpy(game_name, reader->header->game_name, JOURNAL_NAME_SIZE);
+    game_name[JOURNAL_NAME_SIZE - 1] = '\0';
+    return engine_create_game(reader->header->game_id, game_name, reader->header->ruleset_id, 0);
+}
+
+/**
+ * Applica un record del journal a una partita, ripetendo l'effetto dell'evento originale.
+ * Gli attacchi vengono rigiocati sulle griglie: se l'esito non coincide con quello registrato
+ * il journal non è coerente.
+ * @param game Partita ricostruita fino al record precedente.
+ * @param record Record da applicare.
+ * @param extra Dati aggiuntivi del record.
+ * @return 0 in caso di successo, -1 se il record non è coerente con lo stato della partita.
+ */
+int journal_apply_record(GameState *game, const JournalRecord *record, const void *extra) {
+    switch (record->type) {
+        case GAME_EVENT_PLAYER_JOINED: {
+            char username[JOURNAL_NAME_SIZE];
+            size_t length = record->extra_size < JOURNAL_NAME_SIZE ? record->extra_size : JOURNAL_NAME_SIZE - 1;
+            memcpy(username, extra, length);
+            username[length] = '\0';
+            return add_player_to_game_state(game, record->player_id, username) < 0 ? -1 : 0;
+        }
+
+        case GAME_EVENT_PLAYER_LEFT:
+            for (unsigned int i = 0; i < game->player_turn_order_count; i++) {
+                if (game->player_turn_order[i] == record->player_id) {
+                    game->player_turn_order[i] = -1;
+                }
+            }
+            return remove_player_from_game_state(game, record->player_id) < 0 ? -1 : 0;
+
+        case GAME_EVENT_FLEET_PLACED: {
+            PlayerState *player_state = get_player_state(game, record->player_id);
+            if (player_state == NULL || player_state->fleet != NULL || record->extra_size != NUM_SHIPS * sizeof(JournalShip)) {
+                return -1;
+            }
+            player_state->fleet = alloc_fleet_setup();
+            if (player_state->fleet == NULL) return -1;
+
+            init_board(&player_state->board);
+            for (int i = 0; i < NUM_SHIPS; i++) {
+                JournalShip journal_ship;
+                memcpy(&journal_ship, (const unsigned char *)extra + i * sizeof(JournalShip), sizeof(JournalShip));
+                ShipPlacement *ship = &player_state->fleet->ships[i];
+                ship->x = journal_ship.x;
+                ship->y = journal_ship.y;
+                ship->dim = journal_ship.dim;
+                ship->vertical = journal_ship.vertical;
+                if (place_ship(&player_state->board, ship) != 0) return -1;
+            }
+            return 0;
+        }
+
+        case GAME_EVENT_FLEET_SETUP_STARTED:
+            game->state_type = GAME_WAITING_FLEET_SETUP;
+            return 0;
+
+        case GAME_EVENT_GAME_STARTED: {
+            unsigned int count = record->extra_size / sizeof(int32_t);
+            int *turn_order = (int *)malloc((count ? count : 1) * sizeof(int));
+            if (turn_order == NULL) return -1;
+            for (unsigned int i = 0; i < count; i++) {
+                int32_t player_id;
+                memcpy(&player_id, (const unsigned char *)extra + i * sizeof(int32_t), sizeof(int32_t));
+                turn_order[i] = player_id;
+            }
+            free(game->player_turn_order);
+            game->player_turn_order = turn_order;
+            game->player_turn_order_count = count;
+            game->player_turn = 0;
+            game->state_type = GAME_IN_PROGRESS;
+            return 0;
+        }
+
+        case GAME_EVENT_ATTACK: {
+            PlayerState *target = get_player_state(game, record->target_id);
+            if (target == NULL) return -1;
+            return attack(target, record->x, record->y) == record->result ? 0 : -1;
+        }
+
+        case GAME_EVENT_PLAYER_ELIMINATED:
+            for (unsigned int i = 0; i < game->player_turn_order_count; i++) {
+                if (game->player_turn_order[i] == record->player_id) {
+                    game->player_turn_order[i] = -1;
+                }
+            }
+            return 0;
+
+        case GAME_EVENT_TURN:
+            for (unsigned int i = 0; i < game->player_turn_order_count; i++) {
+                if (game->player_turn_order[i] == record->player_id) {
+                    game->player_turn = i;
+                    return 0;
+                }
+            }
+            return -1;
+
+        case GAME_EVENT_GAME_FINISHED:
+            game->state_type = GAME_FINISHED;
+            return 0;
+
+        default:
+            return -1;
+    }
+}
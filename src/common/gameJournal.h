@@ -0,0 +1,88 @@
+#ifndef GAME_JOURNAL_H
+#define GAME_JOURNAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "common/game.h"
+#include "common/gameEngine.h"
+
+/**
+ * Journal binario di una partita.
+ * Il file contiene un JournalFileHeader seguito dagli eventi del motore di gioco nell'ordine
+ * in cui sono stati prodotti, ciascuno come JournalRecord più eventuali dati aggiuntivi
+ * (nome utente, flotta, ordine dei turni). Riapplicando i record da capo si ricostruisce
+ * il GameState della partita a qualunque evento.
+ *
+ * La scrittura accoda i record in blocchi di memoria e li scrive con una sola writev quando
+ * il thread di gioco non ha altro da fare (journal_flush) o quando i blocchi sono esauriti;
+ * la lettura mappa il file in memoria con mmap.
+ */
+
+#define JOURNAL_MAGIC 0x314A4E42 // "BNJ1"
+#define JOURNAL_VERSION 1
+#define JOURNAL_NAME_SIZE 32 // Spazio per il nome della partita nell'header (max 30 caratteri + terminatore)
+
+#define JOURNAL_BLOCK_SIZE 4096 // Dimensione di un blocco di record in attesa di scrittura
+#define JOURNAL_MAX_BLOCKS 16 // Blocchi in attesa oltre i quali la scrittura è forzata
+
+typedef struct {
+    uint32_t magic; // JOURNAL_MAGIC
+    uint16_t version; // JOURNAL_VERSION
+    uint16_t ruleset_id; // Indice del regolamento in GAME_RULESETS
+    int32_t game_id; // ID della partita sul server che l'ha registrata
+    uint32_t reserved;
+    int64_t created_at; // Istante di creazione del journal (secondi dall'epoch)
+    char game_name[JOURNAL_NAME_SIZE]; // Nome della partita, terminato da '\0'
+} JournalFileHeader;
+
+typedef struct {
+    uint8_t type; // GameEventType
+    int8_t result; // GameEvent.result
+    uint8_t x, y; // GameEvent.x, GameEvent.y
+    int32_t player_id; // GameEvent.player_id
+    int32_t target_id; // GameEvent.target_id
+    uint16_t extra_size; // Byte di dati aggiuntivi che seguono il record
+    uint16_t reserved;
+} JournalRecord;
+
+typedef struct {
+    uint8_t x, y, dim, vertical;
+} JournalShip;
+
+/*
+ * Dati aggiuntivi per tipo di evento:
+ * - GAME_EVENT_PLAYER_JOINED: nome utente, senza terminatore
+ * - GAME_EVENT_FLEET_PLACED: NUM_SHIPS JournalShip
+ * - GAME_EVENT_GAME_STARTED: ordine dei turni, un int32_t per giocatore
+ */
+
+typedef struct {
+    int fd; // File descriptor del journal, -1 se la scrittura è stata disabilitata
+    char *blocks[JOURNAL_MAX_BLOCKS]; // Blocchi di record, allocati al primo uso e riutilizzati dopo ogni scrittura
+    size_t block_sizes[JOURNAL_MAX_BLOCKS]; // Byte occupati in ogni blocco in uso
+    int blocks_used; // Blocchi con record in attesa di scrittura
+} GameJournal;
+
+typedef struct {
+    const unsigned char *map; // File mappato in memoria
+    size_t size; // Dimensione del file
+    size_t offset; // Offset del prossimo record
+    unsigned long index; // Indice del prossimo record
+    const JournalFileHeader *header;
+} JournalReader;
+
+GameJournal *journal_create(const char *path, const GameState *game);
+GameJournal *journal_adopt(int fd);
+int journal_append_events(GameJournal *journal, GameState *game, const GameEventList *events);
+int journal_flush(GameJournal *journal);
+void journal_close(GameJournal *journal);
+
+int journal_open_reader(const char *path, JournalReader *reader);
+const JournalRecord *journal_next_record(JournalReader *reader, const void **extra);
+void journal_close_reader(JournalReader *reader);
+
+GameState *journal_create_game(const JournalReader *reader);
+int journal_apply_record(GameState *game, const JournalRecord *record, const void *extra);
+
+#endif // GAME_JOURNAL_H
@@ -0,0 +1,265 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "common/messages.h"
+#include "utils/userInput.h"
+
+const char *const ATTACK_RESULT_NAMES[] = {"miss", "hit", "sunk", "eliminated", NULL};
+
+typedef struct {
+    const char *key; // Nome del campo sul filo
+    size_t offset; // Posizione dell'intero nel record
+    const char *const *names; // Nomi ammessi per un campo ENUM, NULL per un intero
+} SchemaField;
+
+typedef struct {
+    const SchemaField *fields;
+    int fields_count;
+    size_t record_size;
+} RecordSchema;
+
+#define SCHEMA_FIELD_INT(Record, field) {#field, offsetof(Record, field), NULL},
+#define SCHEMA_FIELD_ENUM(Record, field, names) {#field, offsetof(Record, field), names},
+#define SCHEMA_DEFINE_RECORD(Record, FIELDS) \
+    static const SchemaField Record##_fields[] = { FIELDS(SCHEMA_FIELD_INT, SCHEMA_FIELD_ENUM, Record) }; \
+    static const RecordSchema Record##_schema = { \
+        Record##_fields, sizeof(Record##_fields) / sizeof(Record##_fields[0]), sizeof(Record) \
+    };
+MESSAGE_RECORDS(SCHEMA_DEFINE_RECORD)
+
+/**
+ * Cerca il valore di un campo in una lista del payload, provando prima la posizione che il campo
+ * ha nello schema: è quella scritta dall'encoder, quindi di solito basta un confronto.
+ * @return Il valore, che appartiene al payload, o NULL se il campo manca.
+ */
+static const char *findFieldValue(const PayloadList *list, const SchemaField *field, int position) {
+    if (position < list->count && strcmp(list->nodes[position].key, field->key) == 0) {
+        return list->nodes[position].value;
+    }
+    for (int i = 0; i < list->count; i++) {
+        if (i != position && strcmp(list->nodes[i].key, field->key) == 0) {
+            return list->nodes[i].value;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Converte il valore di un campo: un intero, o l'indice del nome per un campo ENUM.
+ * @return 0 in caso di successo, -1 se il valore non è valido.
+ */
+static int decodeField(const SchemaField *field, const char *value, int *value_out) {
+    if (field->names == NULL) {
+        return getIntFromString((char *)value, value_out);
+    }
+    for (int i = 0; field->names[i] != NULL; i++) {
+        if (strcmp(field->names[i], value) == 0) {
+            *value_out = i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/**
+ * Decodifica una lista del payload in un record.
+ * @param first_position Posizione del primo campo dello schema nella lista (1 se la precede `type`).
+ * @return 0 in caso di successo, -1 se manca un campo o un valore non è valido.
+ */
+static int decodeRecord(const PayloadList *list, const RecordSchema *schema, int first_position, char *record) {
+    for (int f = 0; f < schema->fields_count; f++) {
+        const SchemaField *field = &schema->fields[f];
+        const char *value = findFieldValue(list, field, first_position + f);
+        if (value == NULL || decodeField(field, value, (int *)(record + field->offset)) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Decodifica e valida un payload con un record per lista.
+ * @param records_out Puntatore per i record, allocati dall'arena del payload.
+ * @return Il numero di record, o -1 se il payload non rispetta lo schema.
+ */
+static int decodeRecords(Payload *payload, const RecordSchema *schema, int min_records, int max_records, void **records_out) {
+    if (payload == NULL || payload->size < min_records || payload->size > max_records) {
+        return -1;
+    }
+
+    char *records = (char *)arena_alloc(&payload->arena, (size_t)payload->size * schema->record_size);
+    if (records == NULL) return -1;
+
+    for (int r = 0; r < payload->size; r++) {
+        if (decodeRecord(&payload->lists[r], schema, 0, records + (size_t)r * schema->record_size) < 0) {
+            return -1; // La memoria dei record resta all'arena fino a freePayload
+        }
+    }
+
+    *records_out = records;
+    return payload->size;
+}
+
+/**
+ * Aggiunge i campi di un record alla lista corrente del payload, nell'ordine dello schema.
+ * @return 0 in caso di successo, -1 se un campo ENUM non è valido o manca la memoria.
+ */
+static int encodeRecord(Payload *payload, const RecordSchema *schema, const char *record) {
+    for (int f = 0; f < schema->fields_count; f++) {
+        const SchemaField *field = &schema->fields[f];
+        int value = *(const int *)(record + field->offset);
+        if (field->names == NULL) {
+            if (addPayloadKeyValuePairInt(payload, field->key, value) != 0) return -1;
+            continue;
+        }
+
+        int names_count = 0;
+        while (field->names[names_count] != NULL) names_count++;
+        if (value < 0 || value >= names_count ||
+            addPayloadKeyValuePair(payload, field->key, field->names[value]) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Costruisce un payload con una lista per record, con i campi nell'ordine dello schema.
+ * @return Il payload, o NULL se il numero di record o un campo ENUM non sono validi o manca la memoria.
+ */
+static Payload *encodeRecords(const RecordSchema *schema, const void *records, int count, int min_records, int max_records) {
+    if (count < min_records || count > max_records) {
+        return NULL;
+    }
+
+    Payload *payload = createEmptyPayload();
+    if (payload == NULL) return NULL;
+
+    for (int r = 0; r < count; r++) {
+        const char *record = (const char *)records + (size_t)r * schema->record_size;
+        if (addPayloadList(payload) != 0 || encodeRecord(payload, schema, record) != 0) goto error;
+    }
+    return payload;
+
+error:
+    freePayload(payload);
+    return NULL;
+}
+
+#define SCHEMA_DEFINE_CODEC(name, Record, min_records, max_records) \
+    Payload *encode_##name(const Record *records, int count) { \
+        return encodeRecords(&Record##_schema, records, count, min_records, max_records); \
+    } \
+    int decode_##name(Payload *payload, Record **records_out) { \
+        return decodeRecords(payload, &Record##_schema, min_records, max_records, (void **)records_out); \
+    }
+MESSAGE_SCHEMAS(SCHEMA_DEFINE_CODEC)
+
+typedef struct {
+    const char *type; // Valore del campo `type` delle liste della sezione
+    const RecordSchema *schema;
+    int min_records;
+    int max_records;
+    size_t records_offset; // Posizione di `Record *tipo` nel messaggio
+    size_t count_offset; // Posizione di `int tipo_count` nel messaggio
+} SectionSchema;
+
+static const SchemaField type_field = {"type", 0, NULL};
+
+#define SECTION_RECORDS(msg, section) ((char **)((char *)(msg) + (section)->records_offset))
+#define SECTION_COUNT(msg, section) ((int *)((char *)(msg) + (section)->count_offset))
+
+/**
+ * @return L'indice della sezione a cui appartiene una lista, o -1 se il tipo manca o è sconosciuto.
+ */
+static int findSection(const PayloadList *list, const SectionSchema *sections, int sections_count) {
+    const char *type = findFieldValue(list, &type_field, 0);
+    for (int s = 0; type != NULL && s < sections_count; s++) {
+        if (strcmp(sections[s].type, type) == 0) return s;
+    }
+    return -1;
+}
+
+/**
+ * Decodifica e valida un payload a sezioni: conta le liste di ogni sezione, alloca i record
+ * dall'arena del payload e li decodifica.
+ * @param msg_out Messaggio da riempire.
+ * @return 0 in caso di successo, -1 se il payload non rispetta lo schema.
+ */
+static int decodeSections(Payload *payload, const SectionSchema *sections, int sections_count, void *msg_out) {
+    if (payload == NULL) return -1;
+    for (int s = 0; s < sections_count; s++) {
+        *SECTION_RECORDS(msg_out, &sections[s]) = NULL;
+        *SECTION_COUNT(msg_out, &sections[s]) = 0;
+    }
+
+    for (int r = 0; r < payload->size; r++) {
+        int s = findSection(&payload->lists[r], sections, sections_count);
+        if (s < 0) return -1;
+        (*SECTION_COUNT(msg_out, &sections[s]))++;
+    }
+
+    for (int s = 0; s < sections_count; s++) {
+        const SectionSchema *section = &sections[s];
+        int count = *SECTION_COUNT(msg_out, section);
+        if (count < section->min_records || count > section->max_records) return -1;
+        if (count > 0) {
+            char *records = (char *)arena_alloc(&payload->arena, (size_t)count * section->schema->record_size);
+            if (records == NULL) return -1;
+            *SECTION_RECORDS(msg_out, section) = records;
+        }
+        *SECTION_COUNT(msg_out, section) = 0; // Riconteggiato mentre i record vengono decodificati
+    }
+
+    for (int r = 0; r < payload->size; r++) {
+        const PayloadList *list = &payload->lists[r];
+        const SectionSchema *section = &sections[findSection(list, sections, sections_count)];
+        int *count = SECTION_COUNT(msg_out, section);
+        char *record = *SECTION_RECORDS(msg_out, section) + (size_t)*count * section->schema->record_size;
+        if (decodeRecord(list, section->schema, 1, record) < 0) return -1;
+        (*count)++;
+    }
+    return 0;
+}
+
+/**
+ * Costruisce un payload a sezioni: una lista per record, che inizia con il campo `type` della
+ * sua sezione, con le sezioni nell'ordine dello schema.
+ * @return Il payload, o NULL se il numero di record di una sezione o un campo ENUM non sono validi o manca la memoria.
+ */
+static Payload *encodeSections(const SectionSchema *sections, int sections_count, const void *msg) {
+    Payload *payload = createEmptyPayload();
+    if (payload == NULL) return NULL;
+
+    for (int s = 0; s < sections_count; s++) {
+        const SectionSchema *section = &sections[s];
+        const char *records = *SECTION_RECORDS(msg, section);
+        int count = *SECTION_COUNT(msg, section);
+        if (count < section->min_records || count > section->max_records) goto error;
+
+        for (int r = 0; r < count; r++) {
+            if (addPayloadList(payload) != 0 ||
+                addPayloadKeyValuePair(payload, type_field.key, section->type) != 0 ||
+                encodeRecord(payload, section->schema, records + (size_t)r * section->schema->record_size) != 0) {
+                goto error;
+            }
+        }
+    }
+    return payload;
+
+error:
+    freePayload(payload);
+    return NULL;
+}
+
+#define SCHEMA_SECTION(Msg, type, Record, min_records, max_records) \
+    {#type, &Record##_schema, min_records, max_records, offsetof(Msg, type), offsetof(Msg, type##_count)},
+#define SCHEMA_DEFINE_SECTIONED_CODEC(name, Msg, SECTIONS) \
+    static const SectionSchema name##_sections[] = { SECTIONS(SCHEMA_SECTION, Msg) }; \
+    Payload *encode_##name(const Msg *msg) { \
+        return encodeSections(name##_sections, sizeof(name##_sections) / sizeof(name##_sections[0]), msg); \
+    } \
+    int decode_##name(Payload *payload, Msg *msg_out) { \
+        return decodeSections(payload, name##_sections, sizeof(name##_sections) / sizeof(name##_sections[0]), msg_out); \
+    }
+MESSAGE_SECTIONED_SCHEMAS(SCHEMA_DEFINE_SECTIONED_CODEC)
@@ -0,0 +1,143 @@
+#ifndef MESSAGES_H
+#define MESSAGES_H
+
+#include <limits.h>
+#include <stddef.h>
+
+#include "common/protocol.h"
+#include "common/game.h"
+
+/**
+ * Schemi dei messaggi di gioco. Ogni messaggio è un Payload con una lista per record, e ogni
+ * record ha gli stessi campi: lo schema descrive i campi una volta sola e da qui vengono
+ * generati la struct del record, l'encoder e il decoder del messaggio.
+ *
+ * I campi di un record si elencano con una macro FIELDS(INT, ENUM, Record):
+ *   INT(Record, campo)          intero, nella struct come `int campo`
+ *   ENUM(Record, campo, nomi)   stringa tra quelle di `nomi` (array terminato da NULL),
+ *                               nella struct come `int campo`, l'indice del nome
+ * i record con MESSAGE_RECORDS, che per ogni R(Record, FIELDS) dichiara la struct Record, e i
+ * messaggi con MESSAGE_SCHEMAS, che per ogni X(nome, Record, min_records, max_records) dichiara
+ *   Payload *encode_<nome>(const Record *records, int count);
+ *   int decode_<nome>(Payload *payload, Record **records_out);
+ *
+ * Il decoder legge ogni campo una sola volta e valida il messaggio: numero di record tra
+ * min_records e max_records, tutti i campi presenti, interi validi e nomi conosciuti. I record
+ * decodificati sono allocati dall'arena del payload e restano validi fino a freePayload.
+ * L'encoder scrive i campi nell'ordine dello schema, che è anche l'ordine in cui il decoder li
+ * cerca per primo.
+ *
+ * Un messaggio a sezioni (MSG_GAME_RESUMED) contiene record di tipi diversi: ogni lista inizia
+ * con un campo `type` che indica la sezione a cui appartiene. Le sezioni si elencano con una
+ * macro SECTIONS(S, Msg), con S(Msg, tipo, Record, min_records, max_records) per ogni sezione,
+ * e MESSAGE_SECTIONED_SCHEMAS dichiara per ogni X(nome, Msg, SECTIONS) la struct Msg, con
+ * `Record *tipo` e `int tipo_count` per ogni sezione, e
+ *   Payload *encode_<nome>(const Msg *msg);
+ *   int decode_<nome>(Payload *payload, Msg *msg_out);
+ * L'encoder scrive le sezioni nell'ordine in cui sono elencate; il decoder accetta le liste in
+ * qualsiasi ordine e rifiuta i tipi sconosciuti.
+ *
+ * I nomi dei campi sul filo dei messaggi di gioco con soli campi interi compaiono solo qui.
+ * Restano costruiti a mano i messaggi con campi di testo, che gli schemi non descrivono: quelli
+ * della lobby, MSG_GAME_STATE_UPDATE e MSG_PLAYER_JOINED.
+ */
+
+// Esiti di un colpo, con i valori restituiti da attack()
+enum { ATTACK_RESULT_MISS, ATTACK_RESULT_HIT, ATTACK_RESULT_SUNK, ATTACK_RESULT_ELIMINATED };
+extern const char *const ATTACK_RESULT_NAMES[]; // Nomi degli esiti sul filo, indicizzati dai valori sopra
+
+#define SHOT_FIELDS(INT, ENUM, Record) \
+    INT(Record, player_id) \
+    INT(Record, x) \
+    INT(Record, y)
+
+#define SHIP_FIELDS(INT, ENUM, Record) \
+    INT(Record, dim) \
+    INT(Record, vertical) \
+    INT(Record, x) \
+    INT(Record, y)
+
+#define ATTACK_RESULT_FIELDS(INT, ENUM, Record) \
+    INT(Record, attacker_id) \
+    INT(Record, attacked_id) \
+    INT(Record, x) \
+    INT(Record, y) \
+    ENUM(Record, result, ATTACK_RESULT_NAMES)
+
+#define PLAYER_ID_FIELDS(INT, ENUM, Record) \
+    INT(Record, player_id)
+
+#define PLAYER_TURN_FIELDS(INT, ENUM, Record) \
+    INT(Record, player_turn)
+
+#define WINNER_FIELDS(INT, ENUM, Record) \
+    INT(Record, winner_id)
+
+#define RESUME_INFO_FIELDS(INT, ENUM, Record) \
+    INT(Record, state) \
+    INT(Record, player_turn)
+
+#define BOARD_FIELDS(INT, ENUM, Record) \
+    INT(Record, player_id) \
+    INT(Record, ships_left)
+
+#define BOARD_SHOT_FIELDS(INT, ENUM, Record) \
+    INT(Record, player_id) \
+    INT(Record, x) \
+    INT(Record, y) \
+    INT(Record, hit)
+
+#define MESSAGE_RECORDS(R) \
+    R(ShotRecord,         SHOT_FIELDS) \
+    R(ShipRecord,         SHIP_FIELDS) \
+    R(AttackResultRecord, ATTACK_RESULT_FIELDS) \
+    R(PlayerIdRecord,     PLAYER_ID_FIELDS) \
+    R(PlayerTurnRecord,   PLAYER_TURN_FIELDS) \
+    R(WinnerRecord,       WINNER_FIELDS) \
+    R(ResumeInfoRecord,   RESUME_INFO_FIELDS) \
+    R(BoardRecord,        BOARD_FIELDS) \
+    R(BoardShotRecord,    BOARD_SHOT_FIELDS)
+
+#define MESSAGE_SCHEMAS(X) \
+    X(attack_msg,            ShotRecord,         1,         MAX_SALVO_SIZE) /* MSG_ATTACK */ \
+    X(fleet_msg,             ShipRecord,         NUM_SHIPS, NUM_SHIPS)      /* MSG_SETUP_FLEET, MSG_FLEET_AUTO_PLACED */ \
+    X(attack_update_msg,     AttackResultRecord, 1,         INT_MAX)        /* MSG_ATTACK_UPDATE */ \
+    X(game_started_msg,      PlayerIdRecord,     1,         INT_MAX)        /* MSG_GAME_STARTED, ordine dei turni */ \
+    X(player_left_msg,       PlayerIdRecord,     1,         1)              /* MSG_PLAYER_LEFT */ \
+    X(turn_order_update_msg, PlayerTurnRecord,   1,         1)              /* MSG_TURN_ORDER_UPDATE */ \
+    X(game_finished_msg,     WinnerRecord,       1,         1)              /* MSG_GAME_FINISHED */
+
+// Stato di una partita ripristinata: fase e turno, flotta del giocatore (assente se non è ancora
+// piazzata), ordine dei turni, navi rimaste di ogni giocatore e colpi già sparati su ogni griglia
+#define GAME_RESUMED_SECTIONS(S, Msg) \
+    S(Msg, resume_info, ResumeInfoRecord, 1, 1) \
+    S(Msg, ship,        ShipRecord,       0, NUM_SHIPS) \
+    S(Msg, turn_order,  PlayerIdRecord,   0, INT_MAX) \
+    S(Msg, board,       BoardRecord,      0, INT_MAX) \
+    S(Msg, shot,        BoardShotRecord,  0, INT_MAX)
+
+#define MESSAGE_SECTIONED_SCHEMAS(X) \
+    X(game_resumed_msg, GameResumedMsg, GAME_RESUMED_SECTIONS) /* MSG_GAME_RESUMED */
+
+#define SCHEMA_STRUCT_INT(Record, field) int field;
+#define SCHEMA_STRUCT_ENUM(Record, field, names) int field;
+#define SCHEMA_DECLARE_RECORD(Record, FIELDS) \
+    typedef struct { FIELDS(SCHEMA_STRUCT_INT, SCHEMA_STRUCT_ENUM, Record) } Record;
+MESSAGE_RECORDS(SCHEMA_DECLARE_RECORD)
+#undef SCHEMA_DECLARE_RECORD
+
+#define SCHEMA_DECLARE_CODEC(name, Record, min_records, max_records) \
+    Payload *encode_##name(const Record *records, int count); \
+    int decode_##name(Payload *payload, Record **records_out);
+MESSAGE_SCHEMAS(SCHEMA_DECLARE_CODEC)
+#undef SCHEMA_DECLARE_CODEC
+
+#define SCHEMA_STRUCT_SECTION(Msg, type, Record, min_records, max_records) Record *type; int type##_count;
+#define SCHEMA_DECLARE_SECTIONED_CODEC(name, Msg, SECTIONS) \
+    typedef struct { SECTIONS(SCHEMA_STRUCT_SECTION, Msg) } Msg; \
+    Payload *encode_##name(const Msg *msg); \
+    int decode_##name(Payload *payload, Msg *msg_out);
+MESSAGE_SECTIONED_SCHEMAS(SCHEMA_DECLARE_SECTIONED_CODEC)
+#undef SCHEMA_DECLARE_SECTIONED_CODEC
+
+#endif // MESSAGES_H
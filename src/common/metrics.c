@@ -0,0 +1,194 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <pthread.h>
+
+#include "common/metrics.h"
+#include "utils/debug.h"
+
+const MetricInfo METRIC_INFO[METRIC_COUNT] = {
+    [METRIC_CONNECTIONS_ACCEPTED] = {"battleship_connections_accepted_total", "counter", "Connessioni accettate"},
+    [METRIC_LOGINS] = {"battleship_logins_total", "counter", "Login completati"},
+    [METRIC_GAMES_CREATED] = {"battleship_games_created_total", "counter", "Partite create"},
+    [METRIC_GAMES_STARTED] = {"battleship_games_started_total", "counter", "Partite avviate"},
+    [METRIC_GAMES_FINISHED] = {"battleship_games_finished_total", "counter", "Partite finite"},
+    [METRIC_GAME_THREADS] = {"battleship_game_threads", "gauge", "Thread di gioco in esecuzione"},
+    [METRIC_BYTES_IN] = {"battleship_bytes_received_total", "counter", "Byte ricevuti dai client, header compreso"},
+    [METRIC_BYTES_OUT] = {"battleship_bytes_sent_total", "counter", "Byte inviati ai client, header compreso"},
+    [METRIC_SEND_FAILURES] = {"battleship_send_failures_total", "counter", "Invii non riusciti"},
+    [METRIC_CLIENTS_DROPPED] = {"battleship_clients_dropped_total", "counter", "Client disconnessi e rimossi"},
+    [METRIC_SOCKET_SYSCALLS] = {"battleship_socket_syscalls_total", "counter", "Chiamate recv e send sulle connessioni"},
+};
+
+const char *const METRIC_STAGE_NAMES[METRIC_STAGES] = {"queue", "parse", "handle", "fanout", "total"};
+
+__thread MetricsShard *metrics_local_shard = NULL;
+__thread MetricsMsgTimer metrics_msg_timer;
+
+static pthread_mutex_t registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+static MetricsShard *registry_head = NULL;
+static pthread_once_t registry_once = PTHREAD_ONCE_INIT;
+static pthread_key_t registry_key;
+
+/**
+ * Restituisce lo shard di un thread che termina: resta nel registro con i suoi valori e verrà
+ * riusato dal prossimo thread che si registra.
+ * @param arg Shard del thread.
+ */
+static void detach_thread(void *arg) {
+    MetricsShard *shard = (MetricsShard *)arg;
+    pthread_mutex_lock(&registry_mutex);
+    shard->in_use = 0;
+    pthread_mutex_unlock(&registry_mutex);
+}
+
+static void init_registry(void) {
+    pthread_key_create(&registry_key, detach_thread);
+}
+
+/**
+ * Registra lo shard del thread corrente, riusandone uno lasciato da un thread terminato se c'è.
+ * Viene chiamata alla prima metrica aggiornata dal thread.
+ * @return Lo shard del thread; in mancanza di memoria uno shard statico condiviso, che non
+ *         rende conto esattamente dei valori ma evita di fermare il server.
+ */
+MetricsShard *metrics_attach_thread(void) {
+    static MetricsShard fallback_shard;
+
+    pthread_once(&registry_once, init_registry);
+    pthread_mutex_lock(&registry_mutex);
+
+    MetricsShard *shard = registry_head;
+    while (shard != NULL && shard->in_use) {
+        shard = shard->next;
+    }
+    if (shard == NULL) {
+        shard = (MetricsShard *)aligned_alloc(_Alignof(MetricsShard), sizeof(MetricsShard));
+        if (shard != NULL) {
+            memset(shard, 0, sizeof(MetricsShard));
+            shard->next = registry_head;
+            registry_head = shard;
+        }
+    }
+    if (shard != NULL) {
+        shard->in_use = 1;
+    }
+
+    pthread_mutex_unlock(&registry_mutex);
+
+    if (shard == NULL) {
+        LOG_ERROR("Memoria insufficiente per le metriche del thread");
+        metrics_local_shard = &fallback_shard;
+        return &fallback_shard;
+    }
+    pthread_setspecific(registry_key, shard);
+    metrics_local_shard = shard;
+    return shard;
+}
+
+/**
+ * Somma i valori di tutti gli shard registrati, compresi quelli dei thread terminati.
+ * @param snapshot Struttura in cui scrivere i valori aggregati.
+ */
+void metrics_snapshot(MetricsSnapshot *snapshot) {
+    memset(snapshot, 0, sizeof(MetricsSnapshot));
+
+    pthread_mutex_lock(&registry_mutex);
+    for (MetricsShard *shard = registry_head; shard != NULL; shard = shard->next) {
+        for (int i = 0; i < METRIC_COUNT; i++) {
+            snapshot->values[i] += atomic_load_explicit(&shard->values[i], memory_order_relaxed);
+        }
+        for (int i = 0; i < METRICS_MSG_TYPES; i++) {
+            snapshot->msgs_in[i] += atomic_load_explicit(&shard->msgs_in[i], memory_order_relaxed);
+            snapshot->msgs_out[i] += atomic_load_explicit(&shard->msgs_out[i], memory_order_relaxed);
+        }
+        snapshot->threads += shard->in_use;
+    }
+    pthread_mutex_unlock(&registry_mutex);
+}
+
+/**
+ * Alloca l'istogramma di una fase e di un tipo di messaggio nello shard del thread corrente.
+ * L'istogramma resta allo shard anche quando passa a un altro thread.
+ * @return L'istogramma, o NULL se manca la memoria (la misura viene persa).
+ */
+MetricsHistogram *metrics_alloc_histogram(MetricsShard *shard, MetricStage stage, uint16_t msg_type) {
+    MetricsHistogram *histogram = (MetricsHistogram *)calloc(1, sizeof(MetricsHistogram));
+    if (histogram != NULL) {
+        // Chi aggrega legge il puntatore solo dopo che l'istogramma è stato azzerato
+        atomic_store_explicit(&shard->latency[stage][msg_type], histogram, memory_order_release);
+    }
+    return histogram;
+}
+
+/**
+ * Somma gli istogrammi di una fase e di un tipo di messaggio di tutti gli shard.
+ * @param stage Fase.
+ * @param msg_type Tipo del messaggio ricevuto.
+ * @param merged Istogramma in cui scrivere la somma.
+ * @return Numero di misure sommate.
+ */
+int64_t metrics_merge_latency(MetricStage stage, uint16_t msg_type, MetricsHistogram *merged) {
+    memset(merged, 0, sizeof(MetricsHistogram));
+    if (msg_type >= METRICS_MSG_TYPES) msg_type = METRICS_MSG_TYPES - 1;
+
+    int64_t count = 0, sum_ns = 0, max_ns = 0;
+    pthread_mutex_lock(&registry_mutex);
+    for (MetricsShard *shard = registry_head; shard != NULL; shard = shard->next) {
+        MetricsHistogram *histogram = atomic_load_explicit(&shard->latency[stage][msg_type], memory_order_acquire);
+        if (histogram == NULL) continue;
+
+        for (int i = 0; i < METRICS_HIST_BUCKETS; i++) {
+            int64_t bucket = atomic_load_explicit(&histogram->buckets[i], memory_order_relaxed);
+            atomic_store_explicit(&merged->buckets[i], atomic_load_explicit(&merged->buckets[i], memory_order_relaxed) + bucket, memory_order_relaxed);
+        }
+        count += atomic_load_explicit(&histogram->count, memory_order_relaxed);
+        sum_ns += atomic_load_explicit(&histogram->sum_ns, memory_order_relaxed);
+        int64_t shard_max_ns = atomic_load_explicit(&histogram->max_ns, memory_order_relaxed);
+        if (shard_max_ns > max_ns) max_ns = shard_max_ns;
+    }
+    pthread_mutex_unlock(&registry_mutex);
+
+    atomic_store_explicit(&merged->count, count, memory_order_relaxed);
+    atomic_store_explicit(&merged->sum_ns, sum_ns, memory_order_relaxed);
+    atomic_store_explicit(&merged->max_ns, max_ns, memory_order_relaxed);
+    return count;
+}
+
+/**
+ * Valore massimo contenuto in un intervallo di un istogramma.
+ */
+static int64_t histogram_bucket_limit(int bucket) {
+    if (bucket < METRICS_HIST_SUB_BUCKETS) return bucket;
+    int exponent = bucket / METRICS_HIST_SUB_BUCKETS + 2;
+    int64_t low = (int64_t)(METRICS_HIST_SUB_BUCKETS + bucket % METRICS_HIST_SUB_BUCKETS) << (exponent - 3);
+    return low + ((int64_t)1 << (exponent - 3)) - 1;
+}
+
+/**
+ * Quantile di un istogramma, approssimato per eccesso al limite del suo intervallo.
+ * Il conteggio totale è la somma degli intervalli, che un thread può aggiornare mentre si legge.
+ * @param histogram Istogramma, di solito ottenuto con metrics_merge_latency.
+ * @param quantile Quantile tra 0 e 1.
+ * @return Il quantile in nanosecondi, 0 se l'istogramma è vuoto.
+ */
+int64_t metrics_histogram_quantile(const MetricsHistogram *histogram, double quantile) {
+    int64_t total = 0;
+    for (int i = 0; i < METRICS_HIST_BUCKETS; i++) {
+        total += atomic_load_explicit(&histogram->buckets[i], memory_order_relaxed);
+    }
+    if (total == 0) return 0;
+
+    int64_t max_ns = atomic_load_explicit(&histogram->max_ns, memory_order_relaxed);
+    int64_t rank = (int64_t)(total * quantile);
+    if (rank >= total) rank = total - 1;
+    int64_t seen = 0;
+    for (int i = 0; i < METRICS_HIST_BUCKETS; i++) {
+        seen += atomic_load_explicit(&histogram->buckets[i], memory_order_relaxed);
+        if (seen > rank) {
+            int64_t limit = histogram_bucket_limit(i);
+            return limit < max_ns ? limit : max_ns;
+        }
+    }
+    return max_ns;
+}
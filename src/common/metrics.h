@@ -0,0 +1,237 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+
+/**
+ * Metriche del processo: contatori e gauge tenuti separatamente da ciascun thread.
+ * Ogni thread scrive solo nel proprio shard, allineato a una linea di cache, che registra alla
+ * prima metrica aggiornata: l'aggiornamento è una lettura e una scrittura relaxed, senza lock né
+ * istruzioni atomiche read-modify-write, e non contende linee di cache con gli altri thread.
+ * I valori dei thread vengono sommati solo quando qualcuno li chiede (metrics_snapshot): un
+ * gauge può essere incrementato da un thread e decrementato da un altro, conta solo la somma.
+ * Lo shard di un thread che termina passa al prossimo thread che si registra, con i valori
+ * accumulati fino a quel momento, così i contatori non tornano indietro.
+ *
+ * Per ogni tipo di messaggio ricevuto lo shard tiene anche degli istogrammi log-lineari della
+ * latenza, uno per fase (MetricStage), allocati alla prima misura del tipo nel thread: ogni
+ * handler gestisce un solo tipo di messaggio, quindi il tipo individua anche l'handler. Le fasi
+ * di un messaggio sono misurate con metrics_loop_woke, metrics_msg_begin, metrics_msg_parsed,
+ * metrics_fanout_begin/end e metrics_msg_end, che leggono CLOCK_MONOTONIC (vDSO, senza
+ * chiamate di sistema). Gli istogrammi dei thread si sommano con metrics_merge_latency.
+ */
+
+#define METRICS_MSG_TYPES 32 // Tipi di messaggio contati singolarmente, i tipi oltre finiscono nell'ultimo
+
+typedef enum {
+    METRIC_CONNECTIONS_ACCEPTED,    // Connessioni accettate dal server
+    METRIC_LOGINS,                  // Login completati con il messaggio di benvenuto
+    METRIC_GAMES_CREATED,           // Partite create dalla lobby
+    METRIC_GAMES_STARTED,           // Partite avviate dal proprietario
+    METRIC_GAMES_FINISHED,          // Partite arrivate alla fine
+    METRIC_GAME_THREADS,            // Gauge: thread di gioco in esecuzione
+    METRIC_BYTES_IN,                // Byte ricevuti, header compreso
+    METRIC_BYTES_OUT,               // Byte inviati, header compreso
+    METRIC_SEND_FAILURES,           // Invii non riusciti
+    METRIC_CLIENTS_DROPPED,         // Client disconnessi e rimossi da lobby o partita
+    METRIC_SOCKET_SYSCALLS,         // Chiamate recv e send fatte da protocol.c sulle connessioni
+    METRIC_COUNT
+} MetricId;
+
+typedef enum {
+    METRIC_STAGE_QUEUE,     // Dal risveglio del reactor all'inizio della lettura del messaggio
+    METRIC_STAGE_PARSE,     // Parsing del payload
+    METRIC_STAGE_HANDLE,    // Handler del messaggio, esclusi gli invii a tutti i giocatori
+    METRIC_STAGE_FANOUT,    // Invii a tutti i giocatori (send_to_all_players) causati dal messaggio
+    METRIC_STAGE_TOTAL,     // Dal risveglio del reactor all'ultimo byte inviato dall'handler
+    METRIC_STAGES
+} MetricStage;
+
+#define METRICS_HIST_SUB_BUCKETS 8 // Intervalli per ogni potenza di 2: errore massimo del 12.5%
+#define METRICS_HIST_MAX_NS ((INT64_C(1) << 36) - 1) // Valori più grandi (oltre 68 s) finiscono nell'ultimo intervallo
+#define METRICS_HIST_BUCKETS ((36 - 2) * METRICS_HIST_SUB_BUCKETS)
+
+typedef struct {
+    _Atomic int64_t count;
+    _Atomic int64_t sum_ns;
+    _Atomic int64_t max_ns;
+    _Atomic int64_t buckets[METRICS_HIST_BUCKETS];
+} MetricsHistogram;
+
+typedef struct {
+    int64_t wakeup_ns; // Ultimo risveglio del reactor del thread
+    int64_t received_ns; // Inizio della lettura del messaggio in corso
+    int64_t parsed_ns; // Fine del parsing del messaggio in corso
+    int64_t fanout_ns; // Tempo speso finora negli invii a tutti i giocatori
+    int64_t fanout_start_ns; // Inizio dell'invio a tutti i giocatori in corso
+} MetricsMsgTimer;
+
+extern const char *const METRIC_STAGE_NAMES[METRIC_STAGES];
+
+typedef struct {
+    const char *name;
+    const char *type; // "counter" o "gauge", come nel formato di Prometheus
+    const char *help;
+} MetricInfo;
+
+extern const MetricInfo METRIC_INFO[METRIC_COUNT];
+
+typedef struct _MetricsShard {
+    _Alignas(64) _Atomic int64_t values[METRIC_COUNT];
+    _Atomic int64_t msgs_in[METRICS_MSG_TYPES];
+    _Atomic int64_t msgs_out[METRICS_MSG_TYPES];
+    MetricsHistogram *_Atomic latency[METRIC_STAGES][METRICS_MSG_TYPES]; // Allocati alla prima misura
+    struct _MetricsShard *next; // Shard registrati, modificato solo sotto il lock del registro
+    int in_use; // 1 finché il thread proprietario è in esecuzione
+} MetricsShard;
+
+typedef struct {
+    int64_t values[METRIC_COUNT];
+    int64_t msgs_in[METRICS_MSG_TYPES];
+    int64_t msgs_out[METRICS_MSG_TYPES];
+    int threads; // Thread che hanno registrato uno shard e sono ancora in esecuzione
+} MetricsSnapshot;
+
+extern __thread MetricsShard *metrics_local_shard;
+extern __thread MetricsMsgTimer metrics_msg_timer;
+
+MetricsShard *metrics_attach_thread(void);
+void metrics_snapshot(MetricsSnapshot *snapshot);
+MetricsHistogram *metrics_alloc_histogram(MetricsShard *shard, MetricStage stage, uint16_t msg_type);
+int64_t metrics_merge_latency(MetricStage stage, uint16_t msg_type, MetricsHistogram *merged);
+int64_t metrics_histogram_quantile(const MetricsHistogram *histogram, double quantile);
+
+/**
+ * Aggiunge un valore a una metrica dello shard del thread corrente.
+ * Nello shard scrive solo il thread proprietario, quindi bastano una lettura e una scrittura
+ * relaxed: chi aggrega vede comunque un valore intero, al più non aggiornatissimo.
+ */
+static inline void metrics_add_value(_Atomic int64_t *value, int64_t delta) {
+    atomic_store_explicit(value, atomic_load_explicit(value, memory_order_relaxed) + delta, memory_order_relaxed);
+}
+
+static inline MetricsShard *metrics_shard(void) {
+    MetricsShard *shard = metrics_local_shard;
+    return shard != NULL ? shard : metrics_attach_thread();
+}
+
+static inline void metrics_add(MetricId id, int64_t delta) {
+    metrics_add_value(&metrics_shard()->values[id], delta);
+}
+
+static inline void metrics_inc(MetricId id) {
+    metrics_add(id, 1);
+}
+
+/**
+ * Conta un messaggio ricevuto e i suoi byte.
+ * @param msg_type Tipo del messaggio.
+ * @param bytes Byte del messaggio, header compreso.
+ */
+static inline void metrics_count_msg_in(uint16_t msg_type, size_t bytes) {
+    MetricsShard *shard = metrics_shard();
+    metrics_add_value(&shard->msgs_in[msg_type < METRICS_MSG_TYPES ? msg_type : METRICS_MSG_TYPES - 1], 1);
+    metrics_add_value(&shard->values[METRIC_BYTES_IN], (int64_t)bytes);
+}
+
+/**
+ * Conta un messaggio inviato e i suoi byte.
+ * @param msg_type Tipo del messaggio.
+ * @param bytes Byte del messaggio, header compreso.
+ */
+static inline void metrics_count_msg_out(uint16_t msg_type, size_t bytes) {
+    MetricsShard *shard = metrics_shard();
+    metrics_add_value(&shard->msgs_out[msg_type < METRICS_MSG_TYPES ? msg_type : METRICS_MSG_TYPES - 1], 1);
+    metrics_add_value(&shard->values[METRIC_BYTES_OUT], (int64_t)bytes);
+}
+
+static inline int64_t metrics_now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/**
+ * Indice dell'intervallo di un istogramma: valori esatti fino a METRICS_HIST_SUB_BUCKETS, poi
+ * METRICS_HIST_SUB_BUCKETS intervalli uguali per ogni potenza di 2.
+ */
+static inline int metrics_histogram_bucket(int64_t value_ns) {
+    if (value_ns < METRICS_HIST_SUB_BUCKETS) return (int)value_ns;
+    int exponent = 63 - __builtin_clzll((uint64_t)value_ns);
+    int sub = (int)(value_ns >> (exponent - 3)) - METRICS_HIST_SUB_BUCKETS;
+    return (exponent - 2) * METRICS_HIST_SUB_BUCKETS + sub;
+}
+
+/**
+ * Registra una misura di latenza nell'istogramma del thread corrente.
+ * @param stage Fase misurata.
+ * @param msg_type Tipo del messaggio ricevuto.
+ * @param value_ns Durata in nanosecondi.
+ */
+static inline void metrics_observe(MetricStage stage, uint16_t msg_type, int64_t value_ns) {
+    MetricsShard *shard = metrics_shard();
+    if (msg_type >= METRICS_MSG_TYPES) msg_type = METRICS_MSG_TYPES - 1;
+    MetricsHistogram *histogram = atomic_load_explicit(&shard->latency[stage][msg_type], memory_order_relaxed);
+    if (histogram == NULL && (histogram = metrics_alloc_histogram(shard, stage, msg_type)) == NULL) {
+        return;
+    }
+
+    if (value_ns < 0) value_ns = 0;
+    if (value_ns > METRICS_HIST_MAX_NS) value_ns = METRICS_HIST_MAX_NS;
+    metrics_add_value(&histogram->buckets[metrics_histogram_bucket(value_ns)], 1);
+    metrics_add_value(&histogram->count, 1);
+    metrics_add_value(&histogram->sum_ns, value_ns);
+    if (value_ns > atomic_load_explicit(&histogram->max_ns, memory_order_relaxed)) {
+        atomic_store_explicit(&histogram->max_ns, value_ns, memory_order_relaxed);
+    }
+}
+
+/** Segna il risveglio del reactor del thread, da cui parte l'attesa dei messaggi letti dopo. */
+static inline void metrics_loop_woke(void) {
+    metrics_msg_timer.wakeup_ns = metrics_now_ns();
+}
+
+/** Segna l'inizio della lettura di un messaggio. */
+static inline void metrics_msg_begin(void) {
+    metrics_msg_timer.received_ns = metrics_now_ns();
+    metrics_msg_timer.parsed_ns = metrics_msg_timer.received_ns;
+    metrics_msg_timer.fanout_ns = 0;
+}
+
+/**
+ * Registra il parsing di un messaggio appena letto.
+ * @param msg_type Tipo del messaggio.
+ * @param parse_start_ns Inizio del parsing.
+ */
+static inline void metrics_msg_parsed(uint16_t msg_type, int64_t parse_start_ns) {
+    metrics_msg_timer.parsed_ns = metrics_now_ns();
+    metrics_observe(METRIC_STAGE_PARSE, msg_type, metrics_msg_timer.parsed_ns - parse_start_ns);
+}
+
+static inline void metrics_fanout_begin(void) {
+    metrics_msg_timer.fanout_start_ns = metrics_now_ns();
+}
+
+static inline void metrics_fanout_end(void) {
+    metrics_msg_timer.fanout_ns += metrics_now_ns() - metrics_msg_timer.fanout_start_ns;
+}
+
+/**
+ * Registra le fasi di un messaggio il cui handler è appena terminato.
+ * @param msg_type Tipo del messaggio.
+ */
+static inline void metrics_msg_end(uint16_t msg_type) {
+    int64_t end_ns = metrics_now_ns();
+    const MetricsMsgTimer *timer = &metrics_msg_timer;
+    metrics_observe(METRIC_STAGE_QUEUE, msg_type, timer->received_ns - timer->wakeup_ns);
+    metrics_observe(METRIC_STAGE_HANDLE, msg_type, end_ns - timer->parsed_ns - timer->fanout_ns);
+    if (timer->fanout_ns > 0) {
+        metrics_observe(METRIC_STAGE_FANOUT, msg_type, timer->fanout_ns);
+    }
+    metrics_observe(METRIC_STAGE_TOTAL, msg_type, end_ns - timer->wakeup_ns);
+}
+
+#endif // METRICS_H
@@ -3,10 +3,16 @@
 #include <unistd.h>
 #include <string.h>
 #include <errno.h>
+#include <pthread.h>
 
+#include <sys/resource.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <arpa/inet.h>
 #include "common/protocol.h"
+#include "common/shmTransport.h"
+#include "common/metrics.h"
+#include "common/trace.h"
 #include "utils/userInput.h"
 
 
@@ -23,6 +29,7 @@ int sendByteStream(int socket_fd, char *buffer, size_t num_bytes){
     int result;
 
     while(bytes_sent < num_bytes){
+        metrics_inc(METRIC_SOCKET_SYSCALLS);
         result = send(socket_fd, buffer + bytes_sent, num_bytes - bytes_sent, 0);
         if(result < 0){
             if(errno == EINTR) continue;
@@ -47,6 +54,7 @@ int recvByteStream(int socket_fd, char *buffer, size_t num_bytes){
     int result;
 
     while(bytes_received < num_bytes){
+        metrics_inc(METRIC_SOCKET_SYSCALLS);
         result = recv(socket_fd, buffer + bytes_received, num_bytes - bytes_received, 0);
         if(result <= 0){
             if(errno == EINTR) continue;
@@ -59,55 +67,592 @@ int recvByteStream(int socket_fd, char *buffer, size_t num_bytes){
     return 0;
 }
 
+#define MAX_MSG_FDS 4 // Descrittori che possono accompagnare un messaggio
+#define PAYLOAD_INITIAL_CAPACITY 4 // Liste o coppie allocate alla prima aggiunta, poi la capacità raddoppia
+#define PARTIAL_FRAME_INITIAL_CAPACITY 4096 // Byte di payload allocati per un frame parziale, poi la capacità raddoppia
+#define CONNECTION_QUEUE_INITIAL_CAPACITY 4096 // Byte allocati per la coda di ricezione o di invio, poi la capacità raddoppia
+
+/*
+ * Messaggio arrivato solo in parte su una socket: tryRecvMsg lo conserva e riprende la lettura
+ * quando la socket torna leggibile, invece di attendere il resto bloccando il thread. Il buffer
+ * del payload cresce con i byte davvero arrivati, non con la dimensione annunciata dall'header.
+ */
+typedef struct {
+    char wire_header[WIRE_HEADER_SIZE];
+    uint32_t header_received;
+    Header header; // Valido quando l'header è completo
+    char *payload;
+    uint32_t payload_received;
+    uint32_t payload_capacity;
+} PartialFrame;
+
+/*
+ * Code di una connessione letta e scritta dal reactor con io_uring (vedi attachConnectionQueue).
+ * I byte ricevuti restano in `input` finché tryRecvMsg non li legge; i messaggi inviati si
+ * accumulano in `output` e il reactor li trasmette dal buffer `sending`, che resta fermo finché
+ * la SEND non è completata. Staccata dal reactor, la coda sopravvive solo finché ha byte
+ * ricevuti da leggere, che precedono quelli ancora nella socket.
+ */
+typedef struct {
+    char *input;
+    size_t input_start; // Primo byte non ancora letto
+    size_t input_end;
+    size_t input_capacity;
+    int input_closed; // 1 dopo la disconnessione o un errore della socket visti dal reactor
+    ConnectionOutputList *ready; // Lista del reactor per le socket con byte da inviare, NULL se la coda è staccata
+    char *output;
+    size_t output_size;
+    size_t output_capacity;
+    char *sending;
+    size_t sending_size; // 0 se non c'è una SEND in corso
+    size_t sending_capacity;
+} ConnectionQueue;
+
+typedef struct {
+    PartialFrame *frame;
+    ConnectionQueue *queue;
+} ConnectionSlot;
+
+// Stato delle connessioni indicizzato dalla socket. Come la tabella dei canali in memoria condivisa
+// viene allocata una sola volta; frame e code appartengono al thread che legge la connessione
+static ConnectionSlot *connections = NULL;
+static int connections_capacity = 0;
+static pthread_mutex_t connections_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 /**
- * Legge un messaggio da socket nella sua interezza.
- * @param sock_fd File descriptor della socket da cui leggere.
- * @return Puntatore a struttura Msg contenente header e payload ricevuti, o NULL in caso di errore.
- * 
+ * Alloca dall'arena indicata o, se è NULL, con malloc.
  */
-Msg *recvMsg(int socket_fd){
-    uint16_t msgType_net;
-    uint32_t payloadSize_net;
+static void *allocFrom(Arena *arena, size_t size){
+    return arena != NULL ? arena_alloc(arena, size) : malloc(size);
+}
 
-    if (recvByteStream(socket_fd, (char *)&msgType_net, sizeof(uint16_t)) == -1) {
+static ConnectionSlot *lookupConnection(int socket_fd){
+    ConnectionSlot *table = __atomic_load_n(&connections, __ATOMIC_ACQUIRE);
+    if (table == NULL || socket_fd < 0 || socket_fd >= connections_capacity) {
         return NULL;
     }
+    return &table[socket_fd];
+}
+
+static PartialFrame *lookupPartialFrame(int socket_fd){
+    ConnectionSlot *slot = lookupConnection(socket_fd);
+    return slot != NULL ? __atomic_load_n(&slot->frame, __ATOMIC_ACQUIRE) : NULL;
+}
+
+static ConnectionQueue *lookupConnectionQueue(int socket_fd){
+    ConnectionSlot *slot = lookupConnection(socket_fd);
+    return slot != NULL ? __atomic_load_n(&slot->queue, __ATOMIC_ACQUIRE) : NULL;
+}
+
+/**
+ * Restituisce lo stato di una socket, allocando la tabella alla prima chiamata.
+ * @return Stato della socket, o NULL se la tabella non può essere allocata o la socket è oltre
+ *         il limite di file descriptor del processo.
+ */
+static ConnectionSlot *connectionSlot(int socket_fd){
+    pthread_mutex_lock(&connections_mutex);
+    if (connections == NULL) {
+        struct rlimit limit;
+        int capacity = 1024;
+        if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY && limit.rlim_cur > 1024) {
+            capacity = (int)limit.rlim_cur;
+        }
+        ConnectionSlot *table = (ConnectionSlot *)calloc(capacity, sizeof(ConnectionSlot));
+        if (table != NULL) {
+            connections_capacity = capacity;
+            __atomic_store_n(&connections, table, __ATOMIC_RELEASE);
+        }
+    }
+    pthread_mutex_unlock(&connections_mutex);
+    return lookupConnection(socket_fd);
+}
+
+/**
+ * Associa un frame parziale alla sua socket.
+ * @return 0 in caso di successo, -1 se la socket non ha uno stato (vedi connectionSlot).
+ */
+static int registerPartialFrame(int socket_fd, PartialFrame *frame){
+    ConnectionSlot *slot = connectionSlot(socket_fd);
+    if (slot == NULL) {
+        return -1;
+    }
+    __atomic_store_n(&slot->frame, frame, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/**
+ * Scarta il frame parziale di una socket, se ne ha uno.
+ */
+static void dropPartialFrame(int socket_fd){
+    PartialFrame *frame = lookupPartialFrame(socket_fd);
+    if (frame == NULL) {
+        return;
+    }
+    __atomic_store_n(&connections[socket_fd].frame, NULL, __ATOMIC_RELEASE);
+    free(frame->payload);
+    free(frame);
+}
 
-    if (recvByteStream(socket_fd, (char *)&payloadSize_net, sizeof(uint32_t)) == -1) {
+/**
+ * Restituisce la coda di una socket, creandola staccata se non ne ha una.
+ * @return La coda, o NULL se manca la memoria o la socket non ha uno stato.
+ */
+static ConnectionQueue *connectionQueue(int socket_fd){
+    ConnectionQueue *queue = lookupConnectionQueue(socket_fd);
+    if (queue != NULL) {
+        return queue;
+    }
+    ConnectionSlot *slot = connectionSlot(socket_fd);
+    if (slot == NULL) {
         return NULL;
     }
+    queue = (ConnectionQueue *)calloc(1, sizeof(ConnectionQueue));
+    if (queue != NULL) {
+        __atomic_store_n(&slot->queue, queue, __ATOMIC_RELEASE);
+    }
+    return queue;
+}
 
-    Header header;
-    header.msgType = ntohs(msgType_net);
-    header.payloadSize = ntohl(payloadSize_net);
+/**
+ * Scarta la coda di una socket, se ne ha una, con i byte ancora da leggere o da inviare.
+ */
+static void dropConnectionQueue(int socket_fd){
+    ConnectionQueue *queue = lookupConnectionQueue(socket_fd);
+    if (queue == NULL) {
+        return;
+    }
+    __atomic_store_n(&connections[socket_fd].queue, NULL, __ATOMIC_RELEASE);
+    free(queue->input);
+    free(queue->output);
+    free(queue->sending);
+    free(queue);
+}
+
+/**
+ * Garantisce spazio per altri `size` byte in un buffer che raddoppia quando è pieno.
+ * @return 0 in caso di successo, -1 se manca la memoria.
+ */
+static int reserveBytes(char **buffer, size_t *capacity, size_t used, size_t size){
+    if (used + size <= *capacity) {
+        return 0;
+    }
+    size_t new_capacity = *capacity ? *capacity : CONNECTION_QUEUE_INITIAL_CAPACITY;
+    while (new_capacity < used + size) new_capacity *= 2;
+    char *new_buffer = (char *)realloc(*buffer, new_capacity);
+    if (new_buffer == NULL) {
+        return -1;
+    }
+    *buffer = new_buffer;
+    *capacity = new_capacity;
+    return 0;
+}
+
+/**
+ * Converte un header dal formato di rete.
+ * @return 0 in caso di successo, -1 se il payload annunciato supera MAX_PAYLOAD_SIZE.
+ */
+static int decodeWireHeader(const char *wire_header, Header *header_out){
+    uint16_t msgType_net;
+    uint32_t payloadSize_net;
+    memcpy(&msgType_net, wire_header, sizeof(uint16_t));
+    memcpy(&payloadSize_net, wire_header + sizeof(uint16_t), sizeof(uint32_t));
+
+    header_out->msgType = ntohs(msgType_net);
+    header_out->payloadSize = ntohl(payloadSize_net);
+    return header_out->payloadSize >= MAX_PAYLOAD_SIZE ? -1 : 0; // Payload troppo grande, errore di sicurezza
+}
 
-    uint32_t payload_size = header.payloadSize;
+/**
+ * Costruisce il messaggio attorno a un payload già ricevuto per intero.
+ * @param payload_buffer Payload di almeno header->payloadSize + 1 byte, allocato come indicato da `arena`.
+ * @return Il messaggio, o NULL se l'allocazione fallisce (in quel caso il payload è già stato liberato).
+ */
+static Msg *buildMsg(const Header *header, char *payload_buffer, Arena *arena){
+    payload_buffer[header->payloadSize] = '\0'; // Assicura che il payload sia una stringa C valida
 
-    if(header.payloadSize >= (1 << 20)) {
-        return NULL; // Payload troppo grande, errore di sicurezza
+    Msg *msg = (Msg *)allocFrom(arena, sizeof(Msg));
+    if(msg == NULL) {
+        if (arena == NULL) free(payload_buffer);
+        return NULL; // Errore di allocazione
     }
-    
-    char *payload_buffer = (char *)malloc(payload_size + 1);
+
+    msg->header = *header;
+    msg->payload = payload_buffer;
+    return msg;
+}
+
+/**
+ * Completa la lettura di un messaggio di cui è già stato ricevuto l'header.
+ * @param socket_fd File descriptor della socket da cui leggere.
+ * @param wire_header Header ricevuto, nel formato di rete.
+ * @param arena Arena da cui allocare il messaggio, NULL per allocarlo con malloc (da liberare con freeMsg).
+ * @return Puntatore a struttura Msg contenente header e payload ricevuti, o NULL in caso di errore.
+ */
+static Msg *recvMsgPayload(int socket_fd, const char *wire_header, Arena *arena){
+    Header header;
+    if (decodeWireHeader(wire_header, &header) < 0) {
+        return NULL;
+    }
+
+    char *payload_buffer = (char *)allocFrom(arena, header.payloadSize + 1);
     if(payload_buffer == NULL) {
         return NULL; // Errore di allocazione
     }
-    if(recvByteStream(socket_fd, payload_buffer, payload_size) == -1){
-        free(payload_buffer);
+    if(recvByteStream(socket_fd, payload_buffer, header.payloadSize) == -1){
+        if (arena == NULL) free(payload_buffer);
         return NULL;
     }
-    payload_buffer[payload_size] = '\0'; // Assicura che il payload sia una stringa C valida
 
     // a questo punto dispongo del messaggio completo
-    Msg *msg = (Msg *)malloc(sizeof(Msg));
-    if(msg == NULL) {
-        free(payload_buffer);
-        return NULL; // Errore di allocazione
+    return buildMsg(&header, payload_buffer, arena);
+}
+
+/**
+ * Legge con una sola recv i byte già disponibili sulla socket, al massimo `num_bytes`.
+ * Se la connessione ha una coda di ricezione, i byte vengono prima da lì; finché la coda è
+ * collegata a un reactor la socket non viene mai letta direttamente.
+ * @param flags MSG_DONTWAIT per non attendere, 0 per attendere almeno un byte.
+ * @return Byte letti, 0 se la socket non ha dati (solo con MSG_DONTWAIT), -1 in caso di errore
+ *         o disconnessione (errno EWOULDBLOCK se si chiede di attendere con la coda collegata).
+ */
+static ssize_t recvAvailable(int socket_fd, char *buffer, size_t num_bytes, int flags){
+    ConnectionQueue *queue = lookupConnectionQueue(socket_fd);
+    if (queue != NULL) {
+        size_t available = queue->input_end - queue->input_start;
+        if (available > 0) {
+            size_t count = available < num_bytes ? available : num_bytes;
+            memcpy(buffer, queue->input + queue->input_start, count);
+            queue->input_start += count;
+            if (queue->input_start == queue->input_end) {
+                queue->input_start = queue->input_end = 0;
+                if (queue->ready == NULL && !queue->input_closed) {
+                    dropConnectionQueue(socket_fd); // Da qui in avanti si legge dalla socket
+                }
+            }
+            return (ssize_t)count;
+        }
+        if (queue->input_closed) {
+            return -1;
+        }
+        if (queue->ready != NULL) {
+            if (flags & MSG_DONTWAIT) return 0;
+            errno = EWOULDBLOCK;
+            return -1;
+        }
     }
 
-    msg->header = header;
-    msg->payload = payload_buffer;
+    ssize_t received;
+    do {
+        metrics_inc(METRIC_SOCKET_SYSCALLS);
+        received = recv(socket_fd, buffer, num_bytes, flags);
+    } while (received < 0 && errno == EINTR);
 
-    return msg;
+    if (received < 0) {
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+    }
+    return received == 0 ? -1 : received; // 0 byte letti: disconnessione
+}
+
+/**
+ * Conserva un messaggio arrivato solo in parte, copiando i byte già letti.
+ * @param wire_header Header, completo o parziale.
+ * @param header_received Byte validi in `wire_header`.
+ * @param header Header decodificato, NULL se non è ancora completo.
+ * @param payload Parte del payload già letta, NULL se nessuna.
+ * @param payload_received Byte validi in `payload`.
+ * @return 0 in caso di successo, -1 se manca la memoria.
+ */
+static int savePartialFrame(int socket_fd, const char *wire_header, uint32_t header_received,
+                            const Header *header, const char *payload, uint32_t payload_received){
+    PartialFrame *frame = (PartialFrame *)calloc(1, sizeof(PartialFrame));
+    if (frame == NULL) {
+        return -1;
+    }
+    memcpy(frame->wire_header, wire_header, header_received);
+    frame->header_received = header_received;
+
+    if (header != NULL) {
+        frame->header = *header;
+        uint32_t capacity = header->payloadSize < PARTIAL_FRAME_INITIAL_CAPACITY ? header->payloadSize : PARTIAL_FRAME_INITIAL_CAPACITY;
+        if (capacity < payload_received) capacity = payload_received;
+        frame->payload = (char *)malloc(capacity + 1);
+        if (frame->payload == NULL) {
+            free(frame);
+            return -1;
+        }
+        if (payload_received > 0) memcpy(frame->payload, payload, payload_received);
+        frame->payload_received = payload_received;
+        frame->payload_capacity = capacity;
+    }
+
+    if (registerPartialFrame(socket_fd, frame) < 0) {
+        free(frame->payload);
+        free(frame);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Prosegue la lettura di un frame parziale.
+ * @param flags MSG_DONTWAIT per fermarsi quando la socket non ha altri dati, 0 per attendere il
+ *              messaggio completo.
+ * @param arena Arena da cui allocare il messaggio completo, NULL per allocarlo con malloc.
+ * @return 1 se il messaggio è completo, 0 se la socket non ha altri dati, -1 in caso di errore
+ *         o disconnessione.
+ */
+static int resumePartialFrame(int socket_fd, PartialFrame *frame, int flags, Msg **msg_out, Arena *arena){
+    while (frame->header_received < WIRE_HEADER_SIZE) {
+        ssize_t received = recvAvailable(socket_fd, frame->wire_header + frame->header_received,
+                                         WIRE_HEADER_SIZE - frame->header_received, flags);
+        if (received <= 0) return (int)received;
+        frame->header_received += received;
+        if (frame->header_received < WIRE_HEADER_SIZE) continue;
+
+        if (decodeWireHeader(frame->wire_header, &frame->header) < 0) return -1;
+        frame->payload_capacity = frame->header.payloadSize < PARTIAL_FRAME_INITIAL_CAPACITY ? frame->header.payloadSize : PARTIAL_FRAME_INITIAL_CAPACITY;
+        frame->payload = (char *)malloc(frame->payload_capacity + 1);
+        if (frame->payload == NULL) return -1;
+    }
+
+    while (frame->payload_received < frame->header.payloadSize) {
+        if (frame->payload_received == frame->payload_capacity) {
+            uint32_t capacity = frame->payload_capacity * 2;
+            if (capacity > frame->header.payloadSize) capacity = frame->header.payloadSize;
+            char *payload = (char *)realloc(frame->payload, capacity + 1);
+            if (payload == NULL) return -1;
+            frame->payload = payload;
+            frame->payload_capacity = capacity;
+        }
+        ssize_t received = recvAvailable(socket_fd, frame->payload + frame->payload_received,
+                                         frame->payload_capacity - frame->payload_received, flags);
+        if (received <= 0) return (int)received;
+        frame->payload_received += received;
+    }
+
+    char *payload_buffer = (char *)allocFrom(arena, frame->header.payloadSize + 1);
+    if (payload_buffer == NULL) return -1;
+    memcpy(payload_buffer, frame->payload, frame->header.payloadSize);
+    *msg_out = buildMsg(&frame->header, payload_buffer, arena);
+    return *msg_out != NULL ? 1 : -1;
+}
+
+/**
+ * Legge un messaggio da socket nella sua interezza, allocandolo dall'arena indicata.
+ * Se tryRecvMsg ne aveva già letto una parte, la lettura riprende da lì, e i byte nella coda
+ * della connessione vengono letti prima della socket.
+ * @param arena Arena da cui allocare il messaggio, NULL per allocarlo con malloc.
+ */
+static Msg *recvMsgFrom(int socket_fd, Arena *arena){
+    if (shm_is_channel(socket_fd)) {
+        return shm_recv_msg(socket_fd, arena);
+    }
+
+    PartialFrame *partial = lookupPartialFrame(socket_fd);
+    if (partial != NULL) {
+        Msg *msg = NULL;
+        resumePartialFrame(socket_fd, partial, 0, &msg, arena);
+        dropPartialFrame(socket_fd);
+        return msg;
+    }
+    if (lookupConnectionQueue(socket_fd) != NULL) {
+        // I byte già ricevuti nella coda precedono quelli ancora nella socket
+        PartialFrame frame;
+        memset(&frame, 0, sizeof(frame));
+        Msg *msg = NULL;
+        resumePartialFrame(socket_fd, &frame, 0, &msg, arena);
+        free(frame.payload);
+        return msg;
+    }
+
+    char wire_header[WIRE_HEADER_SIZE];
+    if (recvByteStream(socket_fd, wire_header, sizeof(wire_header)) == -1) {
+        return NULL;
+    }
+    return recvMsgPayload(socket_fd, wire_header, arena);
+}
+
+/**
+ * Legge un messaggio da socket nella sua interezza.
+ * @param sock_fd File descriptor della socket da cui leggere.
+ * @return Puntatore a struttura Msg contenente header e payload ricevuti, o NULL in caso di errore.
+ * 
+ */
+Msg *recvMsg(int socket_fd){
+    return recvMsgFrom(socket_fd, NULL);
+}
+
+/**
+ * Legge il prossimo messaggio da socket senza mai bloccarsi.
+ * Se il messaggio non è ancora arrivato per intero, i byte letti restano in un frame parziale
+ * della socket e la funzione ritorna 0: la lettura riprende dalla chiamata successiva, quando la
+ * socket torna leggibile. Non legge mai oltre la fine del messaggio, così i byte successivi
+ * restano nella coda della socket o in quella della connessione.
+ * @param socket_fd File descriptor della socket da cui leggere.
+ * @param msg_out Puntatore per il messaggio ricevuto.
+ * @param arena Arena da cui allocare il messaggio.
+ * @return 1 se è stato letto un messaggio, 0 se non ci sono altri dati, -1 in caso di errore o
+ *         disconnessione.
+ */
+static int tryRecvMsg(int socket_fd, Msg **msg_out, Arena *arena){
+    if (shm_is_channel(socket_fd)) {
+        return shm_try_recv_msg(socket_fd, msg_out, arena);
+    }
+
+    PartialFrame *partial = lookupPartialFrame(socket_fd);
+    if (partial != NULL) {
+        int result = resumePartialFrame(socket_fd, partial, MSG_DONTWAIT, msg_out, arena);
+        if (result != 0) {
+            dropPartialFrame(socket_fd);
+        }
+        return result;
+    }
+
+    // Caso comune: il messaggio è già arrivato tutto e non serve nessun frame parziale
+    char wire_header[WIRE_HEADER_SIZE];
+    ssize_t received = recvAvailable(socket_fd, wire_header, sizeof(wire_header), MSG_DONTWAIT);
+    if (received <= 0) {
+        return (int)received;
+    }
+    if ((size_t)received < sizeof(wire_header)) {
+        return savePartialFrame(socket_fd, wire_header, received, NULL, NULL, 0);
+    }
+
+    Header header;
+    if (decodeWireHeader(wire_header, &header) < 0) {
+        return -1;
+    }
+    char *payload_buffer = (char *)allocFrom(arena, header.payloadSize + 1);
+    if (payload_buffer == NULL) {
+        return -1;
+    }
+
+    uint32_t payload_received = 0;
+    while (payload_received < header.payloadSize) {
+        received = recvAvailable(socket_fd, payload_buffer + payload_received, header.payloadSize - payload_received, MSG_DONTWAIT);
+        if (received <= 0) {
+            int result = received < 0 ? -1 : savePartialFrame(socket_fd, wire_header, sizeof(wire_header), &header, payload_buffer, payload_received);
+            if (arena == NULL) free(payload_buffer);
+            return result;
+        }
+        payload_received += received;
+    }
+
+    *msg_out = buildMsg(&header, payload_buffer, arena);
+    return *msg_out != NULL ? 1 : -1;
+}
+
+/**
+ * Aggiunge una socket alla lista di quelle con byte da inviare.
+ * @return 0 in caso di successo, -1 se manca la memoria.
+ */
+static int pushReadyOutput(ConnectionOutputList *ready, int socket_fd){
+    if (ready->count == ready->capacity) {
+        size_t new_capacity = ready->capacity ? ready->capacity * 2 : 64;
+        int *new_fds = (int *)realloc(ready->fds, new_capacity * sizeof(int));
+        if (new_fds == NULL) return -1;
+        ready->fds = new_fds;
+        ready->capacity = new_capacity;
+    }
+    ready->fds[ready->count++] = socket_fd;
+    return 0;
+}
+
+/**
+ * Accoda un messaggio a una connessione collegata a un reactor, che lo trasmetterà con le sue
+ * SEND. La socket entra nella lista del reactor quando la sua coda di invio smette di essere vuota.
+ * @return 0 in caso di successo, -1 se il messaggio ha descrittori allegati (la socket va prima
+ *         tolta dal reactor), la connessione è chiusa, il client ha già CONNECTION_OUTPUT_LIMIT
+ *         byte da ricevere o manca la memoria.
+ */
+static int queueWireMsg(int socket_fd, ConnectionQueue *queue, const char *wire_header, const Msg *msg, int fds_count){
+    size_t size = WIRE_HEADER_SIZE + msg->header.payloadSize;
+    if (fds_count > 0 || queue->input_closed) {
+        return -1;
+    }
+    if (queue->output_size > 0 && queue->output_size + size > CONNECTION_OUTPUT_LIMIT) {
+        return -1; // Il client non legge: come con un ring in memoria condivisa pieno, non lo si attende
+    }
+    if (reserveBytes(&queue->output, &queue->output_capacity, queue->output_size, size) < 0) {
+        return -1;
+    }
+    if (queue->output_size == 0 && queue->sending_size == 0 && pushReadyOutput(queue->ready, socket_fd) < 0) {
+        return -1;
+    }
+    memcpy(queue->output + queue->output_size, wire_header, WIRE_HEADER_SIZE);
+    memcpy(queue->output + queue->output_size + WIRE_HEADER_SIZE, msg->payload, msg->header.payloadSize);
+    queue->output_size += size;
+    return 0;
+}
+
+/**
+ * Invia header e payload di un messaggio con una sola sendmsg, più eventuali file descriptor
+ * (SCM_RIGHTS) che arrivano con il primo byte. Se la socket accetta solo una parte del messaggio,
+ * il resto segue con sendByteStream.
+ * Un'unica scrittura evita che l'algoritmo di Nagle trattenga payload e header separati in
+ * attesa dell'ACK ritardato del client (circa 40 ms per messaggio su TCP).
+ * Se la connessione ha una coda collegata a un reactor il messaggio viene accodato (queueWireMsg).
+ * @param socket_fd File descriptor della socket su cui inviare.
+ * @param msg Messaggio da inviare.
+ * @param fds Descrittori da passare, NULL se nessuno.
+ * @param fds_count Numero di descrittori, al massimo MAX_MSG_FDS.
+ * @return 0 se il messaggio è stato inviato correttamente, -1 in caso di errore o disconnessione.
+ */
+static int sendWireMsg(int socket_fd, Msg *msg, const int *fds, int fds_count){
+    char wire_header[WIRE_HEADER_SIZE];
+    uint16_t msgType_net = htons(msg->header.msgType);
+    uint32_t payloadSize_net = htonl(msg->header.payloadSize);
+    memcpy(wire_header, &msgType_net, sizeof(uint16_t));
+    memcpy(wire_header + sizeof(uint16_t), &payloadSize_net, sizeof(uint32_t));
+
+    ConnectionQueue *queue = lookupConnectionQueue(socket_fd);
+    if (queue != NULL && queue->ready != NULL) {
+        return queueWireMsg(socket_fd, queue, wire_header, msg, fds_count);
+    }
+
+    struct iovec iov[2] = {
+        {wire_header, sizeof(wire_header)},
+        {msg->payload, msg->header.payloadSize}
+    };
+    union {
+        struct cmsghdr align;
+        char buffer[CMSG_SPACE(sizeof(int) * MAX_MSG_FDS)];
+    } control;
+
+    struct msghdr hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.msg_iov = iov;
+    hdr.msg_iovlen = 2;
+    if (fds_count > 0) {
+        memset(&control, 0, sizeof(control));
+        hdr.msg_control = control.buffer;
+        hdr.msg_controllen = CMSG_SPACE(sizeof(int) * fds_count);
+
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fds_count);
+        memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * fds_count);
+    }
+
+    ssize_t sent;
+    do {
+        metrics_inc(METRIC_SOCKET_SYSCALLS);
+        sent = sendmsg(socket_fd, &hdr, MSG_NOSIGNAL);
+    } while (sent < 0 && errno == EINTR);
+    if (sent < 0) {
+        return -1;
+    }
+
+    // Gli eventuali descrittori sono già partiti con il primo byte, il resto del messaggio segue normalmente
+    if ((size_t)sent < sizeof(wire_header)) {
+        if (sendByteStream(socket_fd, wire_header + sent, sizeof(wire_header) - sent) == -1) {
+            return -1;
+        }
+        sent = sizeof(wire_header);
+    }
+    size_t payload_sent = sent - sizeof(wire_header);
+    return sendByteStream(socket_fd, msg->payload + payload_sent, msg->header.payloadSize - payload_sent);
 }
 
 /**
@@ -117,27 +662,333 @@ Msg *recvMsg(int socket_fd){
  * @param msg Puntatore alla struttura Msg contenente header e payload da inviare.
  * @return 0 se il messaggio è stato inviato correttamente, -1 in caso di errore o disconnessione.
  *
- * La funzione invia prima l'header e poi il payload, assicurandosi che tutti i byte vengano trasmessi.
+ * Header e payload partono con una sola scrittura (vedi sendWireMsg).
  */
 int sendMsg(int socket_fd, Msg *msg){
-    uint16_t msgType_net = htons(msg->header.msgType);
-    uint32_t payloadSize_net = htonl(msg->header.payloadSize);
+    if (shm_is_channel(socket_fd)) {
+        return shm_send_msg(socket_fd, msg);
+    }
+    return sendWireMsg(socket_fd, msg, NULL, 0);
+}
+
+
+/**
+ * Invia un messaggio completo su una socket UNIX insieme a dei file descriptor (SCM_RIGHTS),
+ * che arrivano con il primo byte del messaggio. Non passa mai dalla memoria condivisa.
+ * @param socket_fd File descriptor della socket su cui inviare.
+ * @param msg Messaggio da inviare.
+ * @param fds Descrittori da passare.
+ * @param fds_count Numero di descrittori, al massimo MAX_MSG_FDS.
+ * @return 0 se il messaggio è stato inviato correttamente, -1 in caso di errore o disconnessione.
+ */
+int sendMsgWithFds(int socket_fd, Msg *msg, const int *fds, int fds_count){
+    if (fds_count <= 0 || fds_count > MAX_MSG_FDS) {
+        return -1;
+    }
+    return sendWireMsg(socket_fd, msg, fds, fds_count);
+}
+
+/**
+ * Legge un messaggio completo da una socket UNIX insieme ai file descriptor che lo accompagnano.
+ * I descrittori oltre `max_fds` vengono chiusi.
+ * @param socket_fd File descriptor della socket da cui leggere.
+ * @param fds_out Array per i descrittori ricevuti.
+ * @param max_fds Dimensione di `fds_out`.
+ * @param fds_count_out Puntatore per il numero di descrittori ricevuti.
+ * @return Puntatore a struttura Msg con il messaggio ricevuto, o NULL in caso di errore
+ *         (in quel caso i descrittori ricevuti sono già stati chiusi).
+ */
+Msg *recvMsgWithFds(int socket_fd, int *fds_out, int max_fds, int *fds_count_out){
+    char wire_header[WIRE_HEADER_SIZE];
+    struct iovec iov = {wire_header, sizeof(wire_header)};
+    union {
+        struct cmsghdr align;
+        char buffer[CMSG_SPACE(sizeof(int) * MAX_MSG_FDS)];
+    } control;
+
+    struct msghdr hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    hdr.msg_control = control.buffer;
+    hdr.msg_controllen = sizeof(control.buffer);
+
+    *fds_count_out = 0;
+    ssize_t received;
+    do {
+        metrics_inc(METRIC_SOCKET_SYSCALLS);
+        received = recvmsg(socket_fd, &hdr, MSG_CMSG_CLOEXEC);
+    } while (received < 0 && errno == EINTR);
+    if (received <= 0) {
+        return NULL;
+    }
+
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr); cmsg != NULL; cmsg = CMSG_NXTHDR(&hdr, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) continue;
+        int count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        for (int i = 0; i < count; i++) {
+            int fd;
+            memcpy(&fd, CMSG_DATA(cmsg) + i * sizeof(int), sizeof(int));
+            if (*fds_count_out < max_fds) {
+                fds_out[(*fds_count_out)++] = fd;
+            } else {
+                close(fd);
+            }
+        }
+    }
+
+    Msg *msg = NULL;
+    if ((size_t)received == sizeof(wire_header) ||
+        recvByteStream(socket_fd, wire_header + received, sizeof(wire_header) - received) == 0) {
+        msg = recvMsgPayload(socket_fd, wire_header, NULL);
+    }
+    if (msg == NULL) {
+        for (int i = 0; i < *fds_count_out; i++) {
+            close(fds_out[i]);
+        }
+        *fds_count_out = 0;
+    }
+    return msg;
+}
+
+/**
+ * Chiude la connessione con un client o con il server, rilasciando anche l'eventuale canale in
+ * memoria condivisa, il frame parziale e le code associati alla socket, il cui numero potrebbe
+ * essere riassegnato a un'altra connessione. La socket non deve essere in un reactor.
+ * @param socket_fd File descriptor della socket da chiudere.
+ */
+void closeConnection(int socket_fd){
+    shm_close_channel(socket_fd);
+    dropPartialFrame(socket_fd);
+    dropConnectionQueue(socket_fd);
+    close(socket_fd);
+}
+
+/**
+ * Collega la connessione alle code lette e scritte da un reactor con io_uring: da qui in avanti
+ * il reactor riceve i byte della socket e li aggiunge con pushConnectionInput, tryRecvMsg li
+ * legge dalla coda, e i messaggi inviati vengono accodati e aggiunti a `ready`, da cui il reactor
+ * li trasmette (startConnectionSend). I byte già in coda restano da leggere.
+ * @param socket_fd Socket della connessione.
+ * @param ready Lista del reactor per le socket con byte da inviare.
+ * @return 0 in caso di successo, -1 se manca la memoria.
+ */
+int attachConnectionQueue(int socket_fd, ConnectionOutputList *ready){
+    ConnectionQueue *queue = connectionQueue(socket_fd);
+    if (queue == NULL) {
+        return -1;
+    }
+    queue->ready = ready;
+    return 0;
+}
 
-    if (sendByteStream(socket_fd, (char *)&msgType_net, sizeof(uint16_t)) == -1) {
+/**
+ * Stacca la connessione dal reactor, dopo che le sue richieste nel kernel sono terminate:
+ * i byte da inviare vengono scritti sulla socket, attendendo se serve, mentre quelli ricevuti
+ * restano da leggere per chi riceve la socket.
+ * @param socket_fd Socket della connessione.
+ * @param sent Byte della SEND in corso già trasmessi dal reactor.
+ * @return 0 in caso di successo, -1 se l'invio dei byte rimasti fallisce.
+ */
+int detachConnectionQueue(int socket_fd, size_t sent){
+    ConnectionQueue *queue = lookupConnectionQueue(socket_fd);
+    if (queue == NULL) {
+        return 0;
+    }
+    int result = 0;
+    if (queue->sending_size > sent) {
+        result = sendByteStream(socket_fd, queue->sending + sent, queue->sending_size - sent);
+    }
+    if (result == 0 && queue->output_size > 0) {
+        result = sendByteStream(socket_fd, queue->output, queue->output_size);
+    }
+    free(queue->output);
+    free(queue->sending);
+    queue->output = queue->sending = NULL;
+    queue->output_size = queue->output_capacity = 0;
+    queue->sending_size = queue->sending_capacity = 0;
+    queue->ready = NULL;
+    if (queue->input_end == queue->input_start && !queue->input_closed) {
+        dropConnectionQueue(socket_fd);
+    }
+    return result;
+}
+
+/**
+ * Aggiunge alla coda di una connessione i byte ricevuti dal reactor.
+ * @return 0 in caso di successo, -1 se la coda supererebbe CONNECTION_INPUT_MAX o manca la memoria.
+ */
+int pushConnectionInput(int socket_fd, const char *bytes, size_t size){
+    ConnectionQueue *queue = lookupConnectionQueue(socket_fd);
+    if (queue == NULL) {
         return -1;
     }
+    size_t pending = queue->input_end - queue->input_start;
+    if (pending + size > CONNECTION_INPUT_MAX) {
+        return -1;
+    }
+    if (queue->input_start > 0 && queue->input_end + size > queue->input_capacity) {
+        memmove(queue->input, queue->input + queue->input_start, pending);
+        queue->input_start = 0;
+        queue->input_end = pending;
+    }
+    if (reserveBytes(&queue->input, &queue->input_capacity, queue->input_end, size) < 0) {
+        return -1;
+    }
+    memcpy(queue->input + queue->input_end, bytes, size);
+    queue->input_end += size;
+    return 0;
+}
+
+/**
+ * Segnala che la socket non riceverà altri byte, per disconnessione o errore: letti quelli in
+ * coda, la prossima lettura fallisce.
+ */
+void closeConnectionInput(int socket_fd){
+    ConnectionQueue *queue = connectionQueue(socket_fd);
+    if (queue != NULL) {
+        queue->input_closed = 1;
+    }
+}
+
+/**
+ * @return Byte ricevuti dalla connessione e non ancora letti, 0 se non ha una coda.
+ */
+size_t pendingConnectionInput(int socket_fd){
+    ConnectionQueue *queue = lookupConnectionQueue(socket_fd);
+    return queue != NULL ? queue->input_end - queue->input_start : 0;
+}
+
+/**
+ * Passa i byte accodati per l'invio a una nuova SEND del reactor. Il buffer restituito resta
+ * valido e invariato fino a finishConnectionSend o detachConnectionQueue.
+ * @param size_out Puntatore per il numero di byte da inviare.
+ * @return Byte da inviare, o NULL se non ce ne sono o una SEND è già in corso.
+ */
+const char *startConnectionSend(int socket_fd, size_t *size_out){
+    ConnectionQueue *queue = lookupConnectionQueue(socket_fd);
+    if (queue == NULL || queue->sending_size > 0 || queue->output_size == 0) {
+        return NULL;
+    }
+    // I due buffer si scambiano: i messaggi successivi si accodano mentre il primo viene inviato
+    char *buffer = queue->sending;
+    size_t capacity = queue->sending_capacity;
+    queue->sending = queue->output;
+    queue->sending_capacity = queue->output_capacity;
+    queue->sending_size = queue->output_size;
+    queue->output = buffer;
+    queue->output_capacity = capacity;
+    queue->output_size = 0;
+    *size_out = queue->sending_size;
+    return queue->sending;
+}
 
-    if (sendByteStream(socket_fd, (char *)&payloadSize_net, sizeof(uint32_t)) == -1) {
+/**
+ * Segnala che la SEND iniziata con startConnectionSend è terminata.
+ */
+void finishConnectionSend(int socket_fd){
+    ConnectionQueue *queue = lookupConnectionQueue(socket_fd);
+    if (queue != NULL) {
+        queue->sending_size = 0;
+    }
+}
+
+/**
+ * Copia i byte ricevuti da una socket e non ancora gestiti, cioè l'inizio di un messaggio che
+ * tryRecvMsg ha letto solo in parte seguito da quelli nella coda della connessione, per passarli
+ * insieme alla socket a un altro processo (vedi handoff.h e workers.h). La socket non deve essere
+ * in un reactor.
+ * @param socket_fd Socket della connessione.
+ * @param bytes_out Puntatore per i byte, da liberare con free(); NULL se non ce ne sono.
+ * @param size_out Puntatore per il numero di byte.
+ * @return 0 in caso di successo, -1 se manca la memoria.
+ */
+int exportConnectionInput(int socket_fd, char **bytes_out, uint32_t *size_out){
+    *bytes_out = NULL;
+    *size_out = 0;
+    PartialFrame *frame = lookupPartialFrame(socket_fd);
+    uint32_t frame_size = frame != NULL ? frame->header_received + frame->payload_received : 0;
+    uint32_t queued = (uint32_t)pendingConnectionInput(socket_fd);
+    if (frame_size + queued == 0) {
+        return 0;
+    }
+
+    char *bytes = (char *)malloc(frame_size + queued);
+    if (bytes == NULL) {
         return -1;
     }
+    if (frame != NULL) {
+        memcpy(bytes, frame->wire_header, frame->header_received);
+        if (frame->payload_received > 0) memcpy(bytes + frame->header_received, frame->payload, frame->payload_received);
+    }
+    if (queued > 0) {
+        ConnectionQueue *queue = lookupConnectionQueue(socket_fd);
+        memcpy(bytes + frame_size, queue->input + queue->input_start, queued);
+    }
+    *bytes_out = bytes;
+    *size_out = frame_size + queued;
+    return 0;
+}
 
-    if(sendByteStream(socket_fd, msg->payload, msg->header.payloadSize) == -1){
+/**
+ * Riprende i byte ricevuti da un altro processo, prima che la socket venga letta: le prossime
+ * letture li restituiscono prima di quelli ancora nella coda della socket. Se la socket viene
+ * registrata con reactor_add_edge, il reactor la segnala subito.
+ * @param socket_fd Socket della connessione.
+ * @param bytes Byte restituiti da exportConnectionInput.
+ * @param size Numero di byte, maggiore di 0 e al massimo MAX_CONNECTION_INPUT_EXPORT.
+ * @return 0 in caso di successo, -1 se la socket ha già dei byte da leggere, i byte sono troppi
+ *         o manca la memoria.
+ */
+int importConnectionInput(int socket_fd, const char *bytes, uint32_t size){
+    if (size == 0 || size > MAX_CONNECTION_INPUT_EXPORT ||
+        lookupPartialFrame(socket_fd) != NULL || lookupConnectionQueue(socket_fd) != NULL) {
+        return -1;
+    }
+    ConnectionQueue *queue = connectionQueue(socket_fd);
+    if (queue == NULL) {
+        return -1;
+    }
+    if (reserveBytes(&queue->input, &queue->input_capacity, 0, size) < 0) {
+        dropConnectionQueue(socket_fd);
         return -1;
     }
+    memcpy(queue->input, bytes, size);
+    queue->input_end = size;
     return 0;
 }
 
 
+/**
+ * Restituisce il nome di un tipo di messaggio inviato dal client, per log e metriche.
+ * @param msg_type Tipo del messaggio (PlayerMsgType).
+ * @return Nome del tipo, o NULL se il tipo non esiste.
+ */
+const char *playerMsgTypeName(uint16_t msg_type){
+    static const char *const names[] = {
+        "MSG_LOGIN", "MSG_CREATE_GAME", "MSG_JOIN_GAME", "MSG_LEAVE_GAME", "MSG_READY_TO_PLAY",
+        "MSG_START_GAME", "MSG_ATTACK", "MSG_SETUP_FLEET", "MSG_ADD_BOT", "MSG_ATTACH_SHARED_MEMORY"
+    };
+    return msg_type < sizeof(names) / sizeof(names[0]) ? names[msg_type] : NULL;
+}
+
+/**
+ * Restituisce il nome di un tipo di messaggio inviato dal server, per log e metriche.
+ * @param msg_type Tipo del messaggio (GameMsgType).
+ * @return Nome del tipo, o NULL se il tipo non esiste.
+ */
+const char *gameMsgTypeName(uint16_t msg_type){
+    static const char *const names[] = {
+        "MSG_WELCOME", "MSG_GAME_CREATED", "MSG_GAME_JOINED", "MSG_ERROR_CREATE_GAME",
+        "MSG_ERROR_JOIN_GAME", "MSG_ERROR_NOT_AUTHENTICATED", "MSG_GAME_STATE_UPDATE",
+        "MSG_PLAYER_JOINED", "MSG_PLAYER_LEFT", "MSG_FLEET_SETUP_REMINDER", "MSG_GAME_STARTED",
+        "MSG_TURN_ORDER_UPDATE", "MSG_YOUR_TURN", "MSG_ATTACK_UPDATE", "MSG_YOU_ARE_ELIMINATED",
+        "MSG_GAME_FINISHED", "MSG_ERROR_START_GAME", "MSG_ERROR_PLAYER_ACTION",
+        "MSG_ERROR_NOT_YOUR_TURN", "MSG_ERROR_UNEXPECTED_MESSAGE", "MSG_ERROR_MALFORMED_MESSAGE",
+        "MSG_FLEET_AUTO_PLACED", "MSG_GAME_RESUMED", "MSG_REDIRECT", "MSG_SHARED_MEMORY_ATTACHED"
+    };
+    return msg_type < sizeof(names) / sizeof(names[0]) ? names[msg_type] : NULL;
+}
 
 /**
  * Crea una nuova struttura Msg, allocando memoria e copiando il payload.
@@ -169,6 +1020,57 @@ void freeMsg(Msg *msg){
     free(msg);
 }
 
+/**
+ * Indica se un carattere va preceduto da un escape nel formato testuale dei payload.
+ */
+static inline int isSpecialChar(char c){
+    return c == '|' || c == ':' || c == '[' || c == ']' || c == ',' || c == '\\';
+}
+
+/**
+ * Restituisce la lunghezza di una stringa dopo l'escape, senza terminatore.
+ */
+static size_t escapedLength(const char *src){
+    size_t length = 0;
+    for (; *src; src++) {
+        length += isSpecialChar(*src) ? 2 : 1;
+    }
+    return length;
+}
+
+/**
+ * Scrive l'escape di una stringa in `dst`, che deve avere spazio per escapedLength(src) byte.
+ * @return Puntatore al byte successivo all'ultimo scritto (non aggiunge il terminatore).
+ */
+static char *escapeInto(char *dst, const char *src){
+    for (; *src; src++) {
+        if (isSpecialChar(*src)) {
+            *dst++ = '\\'; // aggiungi il backslash
+            *dst++ = *src ^ 0x7f;
+        } else {
+            *dst++ = *src;
+        }
+    }
+    return dst;
+}
+
+/**
+ * Scrive in `dst` una stringa senza le sequenze di escape, con il terminatore. `dst` può
+ * coincidere con `src`, perché il risultato non è mai più lungo.
+ */
+static void unescapeInto(char *dst, const char *src){
+    while (*src) {
+        if (*src == '\\') {
+            src++; // salta il backslash
+            if (*src == '\0') break;
+            *dst++ = *src++ ^ 0x7f;
+        } else {
+            *dst++ = *src++;
+        }
+    }
+    *dst = '\0';
+}
+
 /**
  *  Restituisce una nuova stringa in cui tutti i caratteri speciali ('|', ':', '[', ']', '\\')
  *  presenti nella stringa di input vengono preceduti da un carattere di escape '\\'.
@@ -180,29 +1082,11 @@ void freeMsg(Msg *msg){
  * @return Puntatore a nuova stringa allocata dinamicamente, o NULL in caso di errore.
  */
 char *escapeString(const char *src){
-    int len = strlen(src);
-    int count = 0;
-    for(int i = 0; i < len; i++){
-        if(src[i] == '|' || src[i] == ':' || src[i] == '[' || src[i] == ']' || src[i] == ',' || src[i] == '\\') count++;
-    }
-
-    char *dst = (char *)malloc(len + count + 1);
+    char *dst = (char *)malloc(escapedLength(src) + 1);
     if(dst == NULL) {
         return NULL; // Errore di allocazione
     }
-
-    int i = 0, j = 0;
-    while(i < len){
-        if(src[i] == '|' || src[i] == ':' || src[i] == '[' || src[i] == ']' || src[i] == ',' || src[i] == '\\'){
-            dst[j++] = '\\'; // aggiungi il backslash
-            dst[j++] = src[i++] ^ 0x7f;
-        } else {
-            dst[j++] = src[i++];
-        }
-        
-    }
-
-    dst[j] = '\0';
+    *escapeInto(dst, src) = '\0';
     return dst;
 }
 
@@ -215,35 +1099,60 @@ char *escapeString(const char *src){
  * @return Puntatore a nuova stringa allocata dinamicamente, o NULL in caso di errore.
  */
 char *unescapeString(const char *src){
-    int len = strlen(src);
-    char *dst = (char *)malloc(len+1);
+    char *dst = (char *)malloc(strlen(src) + 1);
     if(dst == NULL) {
         return NULL; // Errore di allocazione
     }
-
-    int i = 0, j = 0;
-    while(i < len){
-        if(src[i] == '\\'){
-            i++; // salta il backslash
-            dst[j++] = src[i++] ^ 0x7f;
-        } else{
-            dst[j++] = src[i++];
-        }
-    }
-
-    dst[j] = '\0';
+    unescapeInto(dst, src);
     return dst;
 }
 
 /**
- * Crea un nuovo Payload vuoto.
+ * Crea un nuovo Payload vuoto, all'inizio del primo blocco della sua arena.
  * @return Un puntatore a un nuovo Payload, o NULL in caso di errore.
  */
 Payload *createEmptyPayload() {
-    Payload *payload = calloc(1, sizeof(Payload));
+    Arena arena = {NULL};
+    Payload *payload = (Payload *)arena_alloc(&arena, sizeof(Payload));
+    if (!payload) return NULL;
+    memset(payload, 0, sizeof(Payload));
+    payload->arena = arena;
     return payload;
 }
 
+/**
+ * Porta un array dell'arena del Payload ad almeno `min_capacity` elementi, copiando i primi
+ * `count`. Il vecchio array resta all'arena fino a freePayload: raddoppiando la capacità, lo
+ * spazio perso non supera quello dell'array finale.
+ * @param items Puntatore all'array, aggiornato in caso di successo.
+ * @param capacity Puntatore alla capacità dell'array, aggiornata in caso di successo.
+ * @return 0 in caso di successo, -1 se manca la memoria.
+ */
+static int reservePayloadArray(Payload *payload, void **items, int count, int *capacity, int min_capacity, size_t item_size) {
+    if (*capacity >= min_capacity) return 0;
+
+    int new_capacity = *capacity > 0 ? *capacity * 2 : PAYLOAD_INITIAL_CAPACITY;
+    while (new_capacity < min_capacity) {
+        new_capacity *= 2;
+    }
+    void *new_items = arena_alloc(&payload->arena, (size_t)new_capacity * item_size);
+    if (!new_items) return -1;
+    if (count > 0) {
+        memcpy(new_items, *items, (size_t)count * item_size);
+    }
+    *items = new_items;
+    *capacity = new_capacity;
+    return 0;
+}
+
+static int reservePayloadLists(Payload *payload, int min_capacity) {
+    return reservePayloadArray(payload, (void **)&payload->lists, payload->size, &payload->capacity, min_capacity, sizeof(PayloadList));
+}
+
+static int reservePayloadNodes(Payload *payload, PayloadList *list, int min_capacity) {
+    return reservePayloadArray(payload, (void **)&list->nodes, list->count, &list->capacity, min_capacity, sizeof(PayloadNode));
+}
+
 /**
  * Aggiunge una coppia chiave-valore all'ultima lista del Payload.
  * Se il Payload non ha liste, ne crea una nuova.
@@ -256,35 +1165,20 @@ int addPayloadKeyValuePair(Payload *payload, const char *key, const char *value)
     if (!payload || !key || !value) return -1;
 
     // Se il payload è vuoto, aggiungi la prima lista
-    if (payload->tail == NULL) {
+    if (payload->size == 0) {
         if (addPayloadList(payload) != 0) return -1;
     }
 
-    // Crea il nuovo nodo
-    PayloadNode *newNode = malloc(sizeof(PayloadNode));
-    if (!newNode) return -1;
-    newNode->key = strdup(key);
-    newNode->value = strdup(value);
-    newNode->next = NULL;
+    PayloadList *list = &payload->lists[payload->size - 1];
+    if (reservePayloadNodes(payload, list, list->count + 1) != 0) return -1;
 
+    PayloadNode *newNode = &list->nodes[list->count];
+    newNode->key = arena_strdup(&payload->arena, key);
+    newNode->value = arena_strdup(&payload->arena, value);
     if (!newNode->key || !newNode->value) {
-        free(newNode->key);
-        free(newNode->value);
-        free(newNode);
-        return -1;
-    }
-
-    // Aggiungi il nodo alla fine della lista corrente (nell'ultima PayloadList)
-    PayloadNode *current = payload->tail->head;
-    if (current == NULL) {
-        payload->tail->head = newNode;
-    } else {
-        while (current->next != NULL) {
-            current = current->next;
-        }
-        current->next = newNode;
+        return -1; // La memoria già presa resta all'arena fino a freePayload
     }
-    
+    list->count++;
     return 0;
 }
 
@@ -293,7 +1187,7 @@ int addPayloadKeyValuePairInt(Payload *payload, const char *key, int value) {
 
     char value_str[12];
     snprintf(value_str, sizeof(value_str), "%d", value);
-    
+
     return addPayloadKeyValuePair(payload, key, value_str);
 }
 
@@ -306,19 +1200,34 @@ int addPayloadKeyValuePairInt(Payload *payload, const char *key, int value) {
 int addPayloadList(Payload *payload) {
     if (!payload) return -1;
 
-    PayloadList *newList = calloc(1, sizeof(PayloadList));
-    if (!newList) return -1;
+    if (reservePayloadLists(payload, payload->size + 1) != 0) return -1;
 
-    if (payload->tail == NULL) {
-        payload->head = payload->tail = newList;
-    } else {
-        payload->tail->next = newList;
-        payload->tail = newList;
-    }
+    PayloadList *newList = &payload->lists[payload->size];
+    newList->nodes = NULL;
+    newList->count = 0;
+    newList->capacity = 0;
     payload->size++;
     return 0;
 }
 
+/**
+ * Cerca il valore associato a una chiave in una specifica lista del Payload, senza copiarlo.
+ * @return Il valore, che appartiene al Payload, o NULL se non esiste.
+ */
+static char *findPayloadValue(Payload *payload, int index, const char *key) {
+    if (!payload || index < 0 || index >= payload->size) {
+        return NULL;
+    }
+
+    PayloadList *list = &payload->lists[index];
+    for (int i = 0; i < list->count; i++) {
+        if (strcmp(list->nodes[i].key, key) == 0) {
+            return list->nodes[i].value;
+        }
+    }
+    return NULL; // Chiave non trovata in quella lista
+}
+
  /**
  * Restituisce il valore associato a una chiave in una specifica lista del Payload.
  * @param payload Il Payload in cui cercare.
@@ -327,24 +1236,8 @@ int addPayloadList(Payload *payload) {
  * @return Una copia del valore se trovato, altrimenti NULL. Il chiamante deve liberare la memoria.
  */
 char *getPayloadValue(Payload *payload, int index, const char *key) {
-    if (!payload || !payload->head || index < 0 || index >= payload->size) {
-        return NULL;
-    }
-
-    PayloadList *current_list = payload->head;
-    for (int i = 0; i < index; i++) {
-        current_list = current_list->next;
-    }
-
-    PayloadNode *current_node = current_list->head;
-    while (current_node) {
-        if (strcmp(current_node->key, key) == 0) {
-            return strdup(current_node->value);
-        }
-        current_node = current_node->next;
-    }
-
-    return NULL; // Chiave non trovata in quella lista
+    char *value = findPayloadValue(payload, index, key);
+    return value != NULL ? strdup(value) : NULL;
 }
 
 /**
@@ -358,12 +1251,10 @@ char *getPayloadValue(Payload *payload, int index, const char *key) {
 int getPayloadIntValue(Payload *payload, int index, const char *key, int *value_out) {
     if (!payload || !key || !value_out) return -1;
 
-    char *value_str = getPayloadValue(payload, index, key);
+    char *value_str = findPayloadValue(payload, index, key);
     if (!value_str) return -1;
 
-    int ret = getIntFromString(value_str, value_out);
-    free(value_str);
-    return ret;
+    return getIntFromString(value_str, value_out);
 }
 
 /**
@@ -378,16 +1269,44 @@ int getPayloadListSize(Payload *payload) {
 
 
 /**
- * Parsa una stringa "key1:value1|key2:value2" in una lista di PayloadNode.
+ * Copia una stringa nell'arena del Payload togliendo le sequenze di escape.
+ * @return La copia, o NULL se manca la memoria.
+ */
+static char *unescapeIntoArena(Arena *arena, const char *src) {
+    char *dst = (char *)arena_alloc(arena, strlen(src) + 1);
+    if (dst != NULL) {
+        unescapeInto(dst, src);
+    }
+    return dst;
+}
+
+/**
+ * Conta le occorrenze di un carattere in una stringa. I caratteri speciali dentro chiavi e
+ * valori hanno sempre un escape, quindi nel formato serializzato contano solo i separatori.
+ */
+static int countChar(const char *str, char c) {
+    int count = 0;
+    for (const char *found = strchr(str, c); found; found = strchr(found + 1, c)) {
+        count++;
+    }
+    return count;
+}
+
+/**
+ * Parsa una stringa "key1:value1|key2:value2" nelle coppie di una lista del Payload.
  * Helper interno per parsePayload.
- * @param list_str La stringa che rappresenta una singola lista di chiavi e valori.
- * @param target_list Puntatore dove verrà memorizzata la testa della lista di nodi creata.
+ * @param payload Il Payload da cui allocare le coppie, le chiavi e i valori.
+ * @param list_str La stringa che rappresenta una singola lista di chiavi e valori (viene modificata).
+ * @param target_list Lista del Payload a cui aggiungere le coppie.
+ * @param expected_pairs Coppie previste nella lista, per allocare l'array una volta sola: le liste
+ *        di un messaggio hanno di solito le stesse chiavi, quindi basta la dimensione della precedente.
  * @return 0 in caso di successo, -1 in caso di errore.
  */
-static int parsePayloadListFromString(char *list_str, PayloadList *target_list) {
+static int parsePayloadListFromString(Payload *payload, char *list_str, PayloadList *target_list, int expected_pairs) {
+    if (reservePayloadNodes(payload, target_list, expected_pairs) != 0) return -1;
+
     char *pair_saveptr;
     char *pair = strtok_r(list_str, "|", &pair_saveptr);
-    PayloadNode *current_node = NULL;
 
     while (pair) {
         char *sep = strchr(pair, ':');
@@ -397,32 +1316,17 @@ static int parsePayloadListFromString(char *list_str, PayloadList *target_list)
         }
         *sep = '\0';
 
-        char *key_unescaped = unescapeString(pair);
-        char *value_unescaped = unescapeString(sep + 1);
-        if (!key_unescaped || !value_unescaped) {
-             free(key_unescaped);
-             free(value_unescaped);
-             return -1; // Errore di unescape
-        }
-
-        PayloadNode *newNode = malloc(sizeof(PayloadNode));
-        if (!newNode) {
-            free(key_unescaped);
-            free(value_unescaped);
+        if (target_list->count == target_list->capacity &&
+            reservePayloadNodes(payload, target_list, target_list->count + 1) != 0) {
             return -1;
         }
-        newNode->key = key_unescaped;
-        newNode->value = value_unescaped;
-        newNode->next = NULL;
-
-        // Aggiungi il nodo alla lista
-        if (target_list->head == NULL) {
-            target_list->head = newNode;
-            current_node = newNode;
-        } else {
-            current_node->next = newNode;
-            current_node = newNode;
+        PayloadNode *newNode = &target_list->nodes[target_list->count];
+        newNode->key = unescapeIntoArena(&payload->arena, pair);
+        newNode->value = unescapeIntoArena(&payload->arena, sep + 1);
+        if (!newNode->key || !newNode->value) {
+            return -1; // Errore di unescape
         }
+        target_list->count++;
 
         pair = strtok_r(NULL, "|", &pair_saveptr);
     }
@@ -430,24 +1334,23 @@ static int parsePayloadListFromString(char *list_str, PayloadList *target_list)
 }
 
 /**
- * Parsa un buffer serializzato in una struttura Payload.
- * Formato atteso: "[k1:v1|k2:v2],[k3:v3|k4:v4]"
- * @param buffer La stringa serializzata.
- * @return Un puntatore a un nuovo Payload, o NULL in caso di errore.
+ * Parsa un buffer serializzato in una struttura Payload, usando il buffer stesso come spazio
+ * di lavoro: il contenuto del buffer non è più valido dopo la chiamata.
  */
-Payload *parsePayload(char *buffer) {
-    if (!buffer) return NULL;
-
-    char *buf_copy = strdup(buffer);
-    if (!buf_copy) return NULL;
-
+static Payload *parsePayloadInPlace(char *buffer) {
     Payload *payload = createEmptyPayload();
     if (!payload) {
-        free(buf_copy);
+        return NULL;
+    }
+    // Ogni lista inizia con un '[': l'array delle liste viene allocato una volta sola
+    int lists_count = countChar(buffer, '[');
+    if (lists_count > 0 && reservePayloadLists(payload, lists_count) != 0) {
+        freePayload(payload);
         return NULL;
     }
 
-    char *cursor = buf_copy;
+    int expected_pairs = PAYLOAD_INITIAL_CAPACITY;
+    char *cursor = buffer;
     while (*cursor) {
         // Salta le virgole iniziali
         if (*cursor == ',') cursor++;
@@ -463,148 +1366,105 @@ Payload *parsePayload(char *buffer) {
         *end = '\0'; // Termina la stringa della lista
         char *list_content = start + 1;
 
-        // Aggiungi una nuova PayloadList al payload
-        if (addPayloadList(payload) != 0) {
+        // Aggiungi una nuova PayloadList al payload e popolala con il contenuto della lista
+        if (addPayloadList(payload) != 0 ||
+            parsePayloadListFromString(payload, list_content, &payload->lists[payload->size - 1], expected_pairs) != 0) {
             freePayload(payload);
-            free(buf_copy);
             return NULL;
         }
 
-        // Parsa il contenuto della lista e popola l'ultima PayloadList aggiunta
-        if (parsePayloadListFromString(list_content, payload->tail) != 0) {
-            freePayload(payload);
-            free(buf_copy);
-            return NULL;
-        }
-        
+        expected_pairs = payload->lists[payload->size - 1].count;
         cursor = end + 1;
     }
 
-    free(buf_copy);
     return payload;
 }
 
-
 /**
- * Serializza una struttura Payload in una stringa.
- * Formato di output: "[k1:v1|k2:v2],[k3:v3]"
- * @param payload La struttura Payload da serializzare.
- * @return Una stringa allocata dinamicamente, o NULL in caso di errore.
+ * Parsa un buffer serializzato in una struttura Payload.
+ * Formato atteso: "[k1:v1|k2:v2],[k3:v3|k4:v4]"
+ * @param buffer La stringa serializzata.
+ * @return Un puntatore a un nuovo Payload, o NULL in caso di errore.
  */
-char *serializePayload(Payload *payload) {
-    if (!payload || !payload->head) {
-        return strdup(""); // Payload vuoto o non inizializzato
-    }
-
-    size_t total_size = 0;
-    PayloadList *current_list = payload->head;
-
-    // Calcola la dimensione totale necessaria, effettuando l'escape
-    while (current_list) {
-        total_size += 3; // Per '[', ']' e la virgola di separazione
-        PayloadNode *current_node = current_list->head;
+Payload *parsePayload(char *buffer) {
+    if (!buffer) return NULL;
 
-        while (current_node) {
-            char *key_esc = escapeString(current_node->key);
-            char *val_esc = escapeString(current_node->value);
+    // La copia su cui lavorare sta nell'arena temporanea del thread
+    Arena *scratch = arena_scratch();
+    ArenaMark mark = arena_mark(scratch);
+    char *buf_copy = arena_strdup(scratch, buffer);
+    Payload *payload = buf_copy != NULL ? parsePayloadInPlace(buf_copy) : NULL;
+    arena_rewind(scratch, mark);
+    return payload;
+}
 
-            if (!key_esc || !val_esc) { // Gestione errore
-                 free(key_esc);
-                 free(val_esc);
-                 return NULL;
+/**
+ * Serializza una struttura Payload in un buffer allocato dall'arena indicata.
+ * La dimensione viene calcolata prima, così la stringa viene scritta in una sola passata.
+ * @param arena Arena da cui allocare il buffer, NULL per allocarlo con malloc.
+ * @param length_out Puntatore per la lunghezza della stringa, senza terminatore.
+ * @return La stringa, o NULL in caso di errore.
+ */
+static char *serializePayloadInto(Payload *payload, Arena *arena, size_t *length_out) {
+    size_t total_size = 0;
+    if (payload) {
+        for (int l = 0; l < payload->size; l++) {
+            const PayloadList *list = &payload->lists[l];
+            total_size += 2 + (l > 0 ? 1 : 0); // '[', ']' e la virgola di separazione
+            for (int i = 0; i < list->count; i++) {
+                total_size += escapedLength(list->nodes[i].key) + 1 + escapedLength(list->nodes[i].value) + (i > 0 ? 1 : 0); // ':' e '|'
             }
-
-            total_size += strlen(key_esc) + strlen(val_esc) + 2; // +2 per ':' e '|'
-
-            free(key_esc);
-            free(val_esc);
-            current_node = current_node->next;
         }
-        current_list = current_list->next;
     }
 
-    if (total_size == 0) return strdup("");
-
-    // Alloca il buffer e costruisci la stringa
-    char *buffer = malloc(total_size + 1);
+    char *buffer = (char *)allocFrom(arena, total_size + 1);
     if (!buffer) return NULL;
-    buffer[0] = '\0';
-
-    current_list = payload->head;
-    while (current_list) {
-        strcat(buffer, "[");
-        PayloadNode *current_node = current_list->head;
-
-        while (current_node) {
-            char *key_esc = escapeString(current_node->key);
-            char *val_esc = escapeString(current_node->value);
-
-            if (!key_esc || !val_esc) {
-                 free(key_esc);
-                 free(val_esc);
-                 free(buffer);
-                 return NULL;
-            }
-
-            strcat(buffer, key_esc);
-            strcat(buffer, ":");
-            strcat(buffer, val_esc);
 
-            free(key_esc);
-            free(val_esc);
-
-            if (current_node->next) {
-                strcat(buffer, "|");
+    char *cursor = buffer;
+    if (payload) {
+        for (int l = 0; l < payload->size; l++) {
+            const PayloadList *list = &payload->lists[l];
+            if (l > 0) {
+                *cursor++ = ',';
             }
-            current_node = current_node->next;
-        }
-
-        strcat(buffer, "]");
-        if (current_list->next) {
-            strcat(buffer, ",");
+            *cursor++ = '[';
+            for (int i = 0; i < list->count; i++) {
+                if (i > 0) {
+                    *cursor++ = '|';
+                }
+                cursor = escapeInto(cursor, list->nodes[i].key);
+                *cursor++ = ':';
+                cursor = escapeInto(cursor, list->nodes[i].value);
+            }
+            *cursor++ = ']';
         }
-
-        current_list = current_list->next;
     }
+    *cursor = '\0';
 
+    *length_out = total_size;
     return buffer;
 }
 
-
 /**
- * Libera la memoria per una lista di PayloadNode.
+ * Serializza una struttura Payload in una stringa.
+ * Formato di output: "[k1:v1|k2:v2],[k3:v3]"
+ * @param payload La struttura Payload da serializzare.
+ * @return Una stringa allocata dinamicamente, o NULL in caso di errore.
  */
-static void freePayloadNode(PayloadNode *head) {
-    PayloadNode *current = head;
-    while (current) {
-        PayloadNode *next = current->next;
-        free(current->key);
-        free(current->value);
-        free(current);
-        current = next;
-    }
+char *serializePayload(Payload *payload) {
+    size_t length;
+    return serializePayloadInto(payload, NULL, &length);
 }
 
-/**
- * Libera la memoria per una lista di PayloadList.
- */
-static void freePayloadList(PayloadList *head) {
-    PayloadList *current = head;
-    while (current) {
-        PayloadList *next = current->next;
-        freePayloadNode(current->head);
-        free(current);
-        current = next;
-    }
-}
 
 /**
- * Libera la memoria per un'intera struttura Payload.
+ * Libera la memoria per un'intera struttura Payload: array delle liste e delle coppie, chiavi e
+ * valori stanno tutti nella sua arena.
  */
 void freePayload(Payload *payload) {
     if (!payload) return;
-    freePayloadList(payload->head);
-    free(payload);
+    Arena arena = payload->arena; // Il Payload sta nel primo blocco dell'arena
+    arena_release(&arena);
 }
 
 
@@ -612,29 +1472,36 @@ void freePayload(Payload *payload) {
  * Invia un messaggio a un client in modo sicuro, gestendo errori e cleanup automatico.
  * Se l'invio fallisce, libera le risorse.
  * Non libera automaticamente la memoria allocata per il payload dopo l'invio.
+ * Il payload viene serializzato nell'arena temporanea del thread, svuotata prima di ritornare.
  * @param client_fd File descriptor.
  * @param msg_type Tipo del messaggio da inviare.
  * @param payload Puntatore al Payload da inviare.
  * @return 0 in caso di successo, -1 in caso di errore.
  */
 int safeSendMsgWithoutCleanup(int client_fd, uint16_t msg_type, Payload *payload) {
-    char *serialized_payload = serializePayload(payload);
+    Arena *scratch = arena_scratch();
+    ArenaMark mark = arena_mark(scratch);
+
+    int64_t span_start_ns = trace_begin();
+    size_t payload_size;
+    char *serialized_payload = serializePayloadInto(payload, scratch, &payload_size);
+    trace_end(TRACE_SERIALIZE, msg_type, span_start_ns);
     if (!serialized_payload) {
+        arena_rewind(scratch, mark);
         return -1;
     }
 
-    Msg *msg = createMsg(msg_type, strlen(serialized_payload), serialized_payload);
-    if (!msg) {
-        free(serialized_payload);
-        return -1;
+    Msg msg = {{msg_type, (uint32_t)payload_size}, serialized_payload};
+    span_start_ns = trace_begin();
+    int result = sendMsg(client_fd, &msg);
+    trace_end(TRACE_SEND, msg_type, span_start_ns);
+    if (result == 0) {
+        metrics_count_msg_out(msg_type, WIRE_HEADER_SIZE + msg.header.payloadSize);
+    } else {
+        metrics_inc(METRIC_SEND_FAILURES);
     }
-    
-    int result = sendMsg(client_fd, msg);
 
-    // Cleanup
-    freeMsg(msg);
-    free(serialized_payload);
-    
+    arena_rewind(scratch, mark);
     return result;
 }
 
@@ -652,29 +1519,79 @@ int safeSendMsg(int client_fd, uint16_t msg_type, Payload *payload) {
     return result;
 }
 
+/**
+ * Parsa il payload di un messaggio ricevuto, aggiornando metriche e tracing.
+ * Il buffer del messaggio, che sta nell'arena temporanea, viene usato come spazio di lavoro.
+ * @return 0 in caso di successo, -1 in caso di errore di parsing.
+ */
+static int parseReceivedMsg(Msg *received_msg, uint16_t *msg_type_out, Payload **payload_out) {
+    *msg_type_out = received_msg->header.msgType;
+    int64_t parse_start_ns = metrics_now_ns();
+    *payload_out = parsePayloadInPlace(received_msg->payload);
+    metrics_msg_parsed(received_msg->header.msgType, parse_start_ns);
+    if (trace_sampled) {
+        trace_record(TRACE_PARSE, received_msg->header.msgType, parse_start_ns);
+    }
+    metrics_count_msg_in(received_msg->header.msgType, WIRE_HEADER_SIZE + received_msg->header.payloadSize);
+
+    if (*payload_out == NULL && received_msg->header.payloadSize > 0) {
+        return -1; // Errore di parsing
+    }
+    return 0;
+}
+
 /**
  * Riceve un messaggio da un client in modo sicuro, gestendo errori e cleanup automatico.
  * In caso di errore o disconnessione, libera le risorse.
+ * Il messaggio viene letto nell'arena temporanea del thread, svuotata prima di ritornare:
+ * resta allocato solo il Payload.
  * @param client_fd File descriptor.
  * @param msg_type_out Puntatore per il tipo di messaggio ricevuto.
  * @param payload_out Puntatore per il Payload deserializzato.
  * @return 0 in caso di successo, -1 in caso di errore o disconnessione.
  */
 int safeRecvMsg(int client_fd, uint16_t *msg_type_out, Payload **payload_out) {
-    Msg *received_msg = recvMsg(client_fd);
+    Arena *scratch = arena_scratch();
+    ArenaMark mark = arena_mark(scratch);
+
+    int64_t span_start_ns = trace_begin();
+    Msg *received_msg = recvMsgFrom(client_fd, scratch);
     if (received_msg == NULL) {
+        arena_rewind(scratch, mark);
         return -1; // Errore o disconnessione
     }
+    trace_end(TRACE_RECV, received_msg->header.msgType, span_start_ns);
 
-    *msg_type_out = received_msg->header.msgType;
-    *payload_out = parsePayload(received_msg->payload);
+    int result = parseReceivedMsg(received_msg, msg_type_out, payload_out);
+    arena_rewind(scratch, mark);
+    return result;
+}
 
-    if (*payload_out == NULL && received_msg->header.payloadSize > 0) {
-        // Errore di parsing
-        freeMsg(received_msg);
-        return -1;
+/**
+ * Riceve il prossimo messaggio di un client se ha già iniziato ad arrivare, senza attendere
+ * che la socket diventi leggibile. Serve per svuotare una socket registrata in modalità
+ * edge-triggered, un messaggio alla volta.
+ * Come safeRecvMsg, usa l'arena temporanea del thread per il messaggio.
+ * @param client_fd File descriptor.
+ * @param msg_type_out Puntatore per il tipo di messaggio ricevuto.
+ * @param payload_out Puntatore per il Payload deserializzato.
+ * @return 1 se è stato ricevuto un messaggio, 0 se sulla socket non ci sono dati,
+ *         -1 in caso di errore o disconnessione.
+ */
+int safeTryRecvMsg(int client_fd, uint16_t *msg_type_out, Payload **payload_out) {
+    Arena *scratch = arena_scratch();
+    ArenaMark mark = arena_mark(scratch);
+
+    Msg *received_msg = NULL;
+    int64_t span_start_ns = trace_begin();
+    int result = tryRecvMsg(client_fd, &received_msg, scratch);
+    if (result <= 0) {
+        arena_rewind(scratch, mark);
+        return result;
     }
+    trace_end(TRACE_RECV, received_msg->header.msgType, span_start_ns);
 
-    freeMsg(received_msg);
-    return 0;
-}
\ No newline at end of file
+    result = parseReceivedMsg(received_msg, msg_type_out, payload_out) < 0 ? -1 : 1;
+    arena_rewind(scratch, mark);
+    return result;
+}
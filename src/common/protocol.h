@@ -1,8 +1,11 @@
 #ifndef PROTOCOL_H
 #define PROTOCOL_H
 
+#include <stddef.h>
 #include <stdint.h>
 
+#include "utils/arena.h"
+
 /**
  * PlayerMsgType:
  * Enumera i tipi di messaggi che possono essere inviati dal client al server.
@@ -16,7 +19,9 @@ typedef enum {
     MSG_READY_TO_PLAY,              // Il client segnala di aver completato la configurazione e di essere pronto a ricevere dati sulla partita.
     MSG_START_GAME,                 // Il proprietario della partita invia questo messaggio per avviare la partita quando tutti sono pronti.
     MSG_ATTACK,                     // Il client effettua una mossa di attacco, specificando le coordinate e il bersaglio.
-    MSG_SETUP_FLEET                 // Il client invia la configurazione della propria flotta (posizionamento delle navi) al server.
+    MSG_SETUP_FLEET,                // Il client invia la configurazione della propria flotta (posizionamento delle navi) al server.
+    MSG_ADD_BOT,                    // Il proprietario aggiunge un giocatore automatico alla partita prima di avviarla.
+    MSG_ATTACH_SHARED_MEMORY        // Un client connesso alla socket UNIX chiede di scambiare i messaggi in memoria condivisa (vedi shmTransport.h).
 } PlayerMsgType;
 
 
@@ -51,11 +56,22 @@ typedef enum {
 
     
     MSG_ERROR_UNEXPECTED_MESSAGE,   // Messaggio inaspettato ricevuto.
-    MSG_ERROR_MALFORMED_MESSAGE     // Messaggio malformato ricevuto.
+    MSG_ERROR_MALFORMED_MESSAGE,    // Messaggio malformato ricevuto.
+
+    MSG_FLEET_AUTO_PLACED,          // Il tempo per piazzare le navi è scaduto e il server ha piazzato la flotta del client (stesso formato di MSG_SETUP_FLEET).
+    MSG_GAME_RESUMED,               // Stato completo di una partita ripristinata dopo un riavvio del server, inviato al giocatore che si riconnette.
+    MSG_REDIRECT,                   // La partita richiesta è ospitata da un altro nodo del cluster (host, port, token, game_id): il client vi rifà il login con il token.
+    MSG_SHARED_MEMORY_ATTACHED      // Risposta a MSG_ATTACH_SHARED_MEMORY (ring_size), con il memfd dei ring e l'eventfd passati con SCM_RIGHTS.
 } GameMsgType;
 
 
 #define HEADER_SIZE sizeof(Header)
+#define WIRE_HEADER_SIZE (sizeof(uint16_t) + sizeof(uint32_t)) // Tipo e dimensione del payload sulla rete
+#define MAX_PAYLOAD_SIZE (1 << 20) // Payload più grandi sono rifiutati in ricezione
+#define CONNECTION_INPUT_LIMIT (256 * 1024) // Byte ricevuti e non letti oltre i quali il reactor smette di ricevere da una connessione
+#define CONNECTION_INPUT_MAX (2 * CONNECTION_INPUT_LIMIT) // Oltre questa soglia la connessione viene chiusa
+#define CONNECTION_OUTPUT_LIMIT (4 * 1024 * 1024) // Byte accodati per un client oltre i quali gli invii falliscono
+#define MAX_CONNECTION_INPUT_EXPORT (WIRE_HEADER_SIZE + MAX_PAYLOAD_SIZE + CONNECTION_INPUT_MAX) // Massimo di exportConnectionInput
 
 typedef struct {
     uint16_t msgType;
@@ -68,26 +84,58 @@ typedef struct {
 } Msg;
 
 
-typedef struct _PayloadNode {
+typedef struct {
     char *key;
     char *value;
-    struct _PayloadNode *next;
 } PayloadNode;
 
-typedef struct _PayloadList {
-    PayloadNode *head;
-    struct _PayloadList *next;
+typedef struct {
+    PayloadNode *nodes; // Coppie chiave-valore della lista, nell'ordine di inserimento
+    int count;
+    int capacity;
 } PayloadList;
 
+/**
+ * Le liste di un Payload stanno in un array contiguo, così come le coppie di ogni lista: l'accesso
+ * a una lista per indice e l'aggiunta in coda costano O(1), e gli array raddoppiano quando sono
+ * pieni. Array, chiavi e valori sono allocati dalla sua arena, che contiene anche il Payload
+ * stesso: freePayload libera tutto in una volta.
+ */
 typedef struct {
-    PayloadList *head;
-    PayloadList *tail;
-    int size;
+    PayloadList *lists;
+    int size; // Liste valide in `lists`
+    int capacity;
+    Arena arena;
 } Payload;
 
+/**
+ * Socket con byte da inviare raccolte per il reactor che le trasmette (vedi attachConnectionQueue).
+ */
+typedef struct {
+    int *fds;
+    size_t count;
+    size_t capacity;
+} ConnectionOutputList;
+
 
 Msg *recvMsg(int socket_fd);
 int sendMsg(int socket_fd, Msg *msg);
+Msg *recvMsgWithFds(int socket_fd, int *fds_out, int max_fds, int *fds_count_out);
+int sendMsgWithFds(int socket_fd, Msg *msg, const int *fds, int fds_count);
+void closeConnection(int socket_fd);
+int exportConnectionInput(int socket_fd, char **bytes_out, uint32_t *size_out);
+int importConnectionInput(int socket_fd, const char *bytes, uint32_t size);
+
+int attachConnectionQueue(int socket_fd, ConnectionOutputList *ready);
+int detachConnectionQueue(int socket_fd, size_t sent);
+int pushConnectionInput(int socket_fd, const char *bytes, size_t size);
+void closeConnectionInput(int socket_fd);
+size_t pendingConnectionInput(int socket_fd);
+const char *startConnectionSend(int socket_fd, size_t *size_out);
+void finishConnectionSend(int socket_fd);
+
+const char *playerMsgTypeName(uint16_t msg_type);
+const char *gameMsgTypeName(uint16_t msg_type);
 
 Msg *createMsg(uint16_t header_type, uint32_t payload_size, char *payload);
 void freeMsg(Msg *msg);
@@ -103,11 +151,14 @@ int getPayloadListSize(Payload *payload);
 
 Payload *parsePayload(char *buffer);
 char *serializePayload(Payload *payload);
+char *escapeString(const char *src);
+char *unescapeString(const char *src);
 
 void freePayload(Payload *payload);
 
 int safeSendMsgWithoutCleanup(int client_fd, uint16_t msg_type, Payload *payload);
 int safeSendMsg(int client_fd, uint16_t msg_type, Payload *payload);
 int safeRecvMsg(int client_fd, uint16_t *msg_type_out, Payload **payload_out);
+int safeTryRecvMsg(int client_fd, uint16_t *msg_type_out, Payload **payload_out);
 
 #endif // PROTOCOL_H
\ No newline at end of file
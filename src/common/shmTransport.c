@@ -0,0 +1,604 @@
+#define _GNU_SOURCE // memfd_create
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+
+#include <arpa/inet.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+#include "common/shmTransport.h"
+#include "utils/debug.h"
+
+#define SHM_LAYOUT_SIZE 4096 // Spazio riservato a ShmLayout prima dei dati dei ring
+#define SHM_FRAME_HEADER_SIZE (sizeof(uint16_t) + sizeof(uint32_t)) // Stesso header dei messaggi sulla socket
+#define SHM_TO_SERVER 0 // Indice del ring scritto dal client
+#define SHM_TO_CLIENT 1 // Indice del ring scritto dal server
+#define SHM_SEND_RETRY_NS 100000 // Pausa del client tra due controlli dello spazio in un ring pieno
+
+/*
+ * Indici di un ring nella memoria condivisa. head e tail contano i byte letti e scritti dall'inizio
+ * e stanno su linee di cache diverse, così produttore e consumatore non si contendono la stessa.
+ */
+typedef struct {
+    _Alignas(64) atomic_uint tail; // Scritto dal produttore
+    atomic_uint consumer_waiting; // 1 se il consumatore ha trovato il ring vuoto e attende una sveglia
+    _Alignas(64) atomic_uint head; // Scritto dal consumatore
+} ShmRing;
+
+typedef struct {
+    uint32_t magic; // SHM_MAGIC
+    uint32_t ring_size; // SHM_RING_SIZE
+    ShmRing rings[2]; // SHM_TO_SERVER, SHM_TO_CLIENT
+} ShmLayout;
+
+_Static_assert(sizeof(ShmLayout) <= SHM_LAYOUT_SIZE, "ShmLayout non entra nello spazio riservato");
+_Static_assert((SHM_RING_SIZE & (SHM_RING_SIZE - 1)) == 0, "SHM_RING_SIZE deve essere una potenza di 2");
+
+typedef struct {
+    ShmLayout *layout;
+    ShmRing *rx, *tx; // Ring letto e ring scritto da questo processo
+    char *rx_data, *tx_data;
+    int socket_fd;
+    int event_fd; // Sveglia del client
+    int is_server;
+    pthread_mutex_t send_mutex; // Serializza i produttori del ring in scrittura
+} ShmChannel;
+
+// Canali attivi indicizzati dalla socket della connessione. La tabella viene allocata una sola
+// volta, così shm_is_channel la legge senza lock mentre la lobby vi aggiunge canali.
+// Chi usa un canale tiene channels_lock in lettura dalla ricerca alla fine dell'uso, e
+// shm_close_channel lo prende in scrittura prima di liberarlo: un canale non viene mai liberato
+// sotto un altro thread. Durante il passaggio di un giocatore dalla lobby al thread di gioco
+// entrambi possono inviargli messaggi, quindi anche gli invii sullo stesso canale sono
+// serializzati (send_mutex). Il ring in lettura ha invece un solo consumatore: lo legge solo il
+// thread che possiede la connessione, e la lobby smette di leggerlo prima di cederla.
+static ShmChannel **channels = NULL;
+static int channels_capacity = 0;
+static pthread_mutex_t channels_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_rwlock_t channels_lock = PTHREAD_RWLOCK_WRITER_NONRECURSIVE_INITIALIZER_NP; // La chiusura non attende un flusso continuo di lettori
+
+static size_t shm_map_size(void) {
+    return SHM_LAYOUT_SIZE + 2 * (size_t)SHM_RING_SIZE;
+}
+
+static ShmChannel *lookup_channel(int socket_fd) {
+    ShmChannel **table = __atomic_load_n(&channels, __ATOMIC_ACQUIRE);
+    if (table == NULL || socket_fd < 0 || socket_fd >= channels_capacity) {
+        return NULL;
+    }
+    return __atomic_load_n(&table[socket_fd], __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Cerca il canale di una connessione e lo protegge da shm_close_channel fino a release_channel,
+ * da chiamare anche quando il canale non esiste.
+ * @return Il canale, o NULL se la connessione non ne ha uno.
+ */
+static ShmChannel *acquire_channel(int socket_fd) {
+    pthread_rwlock_rdlock(&channels_lock);
+    return lookup_channel(socket_fd);
+}
+
+static void release_channel(void) {
+    pthread_rwlock_unlock(&channels_lock);
+}
+
+/**
+ * Associa un canale alla socket della sua connessione.
+ * @param channel Canale da registrare.
+ * @return 0 in caso di successo, -1 se la tabella non può essere allocata o la socket è oltre
+ *         il limite di file descriptor del processo.
+ */
+static int register_channel(ShmChannel *channel) {
+    pthread_mutex_lock(&channels_mutex);
+    if (channels == NULL) {
+        struct rlimit limit;
+        int capacity = 1024;
+        if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY && limit.rlim_cur > 1024) {
+            capacity = (int)limit.rlim_cur;
+        }
+        ShmChannel **table = (ShmChannel **)calloc(capacity, sizeof(ShmChannel *));
+        if (table == NULL) {
+            pthread_mutex_unlock(&channels_mutex);
+            return -1;
+        }
+        channels_capacity = capacity;
+        __atomic_store_n(&channels, table, __ATOMIC_RELEASE);
+    }
+
+    int result = -1;
+    if (channel->socket_fd < channels_capacity) {
+        __atomic_store_n(&channels[channel->socket_fd], channel, __ATOMIC_RELEASE);
+        result = 0;
+    }
+    pthread_mutex_unlock(&channels_mutex);
+    return result;
+}
+
+/**
+ * Mappa la memoria condivisa di un canale.
+ * @param memfd File descriptor del memfd, che può essere chiuso dopo la chiamata.
+ * @param event_fd Eventfd che sveglia il client.
+ * @param socket_fd Socket della connessione.
+ * @param is_server 1 per il lato server, che inizializza la memoria, 0 per il client.
+ * @return Il canale, o NULL in caso di errore.
+ */
+static ShmChannel *map_channel(int memfd, int event_fd, int socket_fd, int is_server) {
+    ShmChannel *channel = (ShmChannel *)calloc(1, sizeof(ShmChannel));
+    if (channel == NULL) {
+        return NULL;
+    }
+
+    void *base = mmap(NULL, shm_map_size(), PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+    if (base == MAP_FAILED) {
+        LOG_ERROR("Errore durante la mmap della memoria condivisa: %s", strerror(errno));
+        free(channel);
+        return NULL;
+    }
+
+    channel->layout = (ShmLayout *)base;
+    if (is_server) {
+        // Il memfd appena creato è azzerato: entrambi i consumatori partono in attesa
+        channel->layout->magic = SHM_MAGIC;
+        channel->layout->ring_size = SHM_RING_SIZE;
+        atomic_store(&channel->layout->rings[SHM_TO_SERVER].consumer_waiting, 1);
+        atomic_store(&channel->layout->rings[SHM_TO_CLIENT].consumer_waiting, 1);
+    } else if (channel->layout->magic != SHM_MAGIC || channel->layout->ring_size != SHM_RING_SIZE) {
+        LOG_ERROR("La memoria condivisa ricevuta dal server non è valida");
+        munmap(base, shm_map_size());
+        free(channel);
+        return NULL;
+    }
+
+    int rx_index = is_server ? SHM_TO_SERVER : SHM_TO_CLIENT;
+    int tx_index = is_server ? SHM_TO_CLIENT : SHM_TO_SERVER;
+    channel->rx = &channel->layout->rings[rx_index];
+    channel->tx = &channel->layout->rings[tx_index];
+    channel->rx_data = (char *)base + SHM_LAYOUT_SIZE + (size_t)rx_index * SHM_RING_SIZE;
+    channel->tx_data = (char *)base + SHM_LAYOUT_SIZE + (size_t)tx_index * SHM_RING_SIZE;
+    channel->socket_fd = socket_fd;
+    channel->event_fd = event_fd;
+    channel->is_server = is_server;
+    pthread_mutex_init(&channel->send_mutex, NULL);
+    return channel;
+}
+
+static void unmap_channel(ShmChannel *channel) {
+    munmap(channel->layout, shm_map_size());
+    close(channel->event_fd);
+    pthread_mutex_destroy(&channel->send_mutex);
+    free(channel);
+}
+
+static void ring_copy_out(const char *data, uint32_t position, char *dst, uint32_t size) {
+    uint32_t offset = position & (SHM_RING_SIZE - 1);
+    uint32_t first = size < SHM_RING_SIZE - offset ? size : SHM_RING_SIZE - offset;
+    memcpy(dst, data + offset, first);
+    memcpy(dst + first, data, size - first);
+}
+
+static void ring_copy_in(char *data, uint32_t position, const char *src, uint32_t size) {
+    uint32_t offset = position & (SHM_RING_SIZE - 1);
+    uint32_t first = size < SHM_RING_SIZE - offset ? size : SHM_RING_SIZE - offset;
+    memcpy(data + offset, src, first);
+    memcpy(data, src + first, size - first);
+}
+
+static int ring_has_data(ShmRing *ring) {
+    return atomic_load(&ring->tail) != atomic_load_explicit(&ring->head, memory_order_relaxed);
+}
+
+/**
+ * Sveglia l'altro lato del canale dopo avergli scritto un messaggio.
+ * Il server scrive sull'eventfd del client; il client scrive un byte sulla socket, che fa
+ * arrivare un evento al reactor del server. Se la socket è piena di sveglie non lette il
+ * server ne ha già una in attesa.
+ */
+static void wake_peer(ShmChannel *channel) {
+    if (channel->is_server) {
+        uint64_t one = 1;
+        if (write(channel->event_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+            LOG_WARNING("Errore durante la sveglia del client sull'eventfd: %s", strerror(errno));
+        }
+    } else {
+        char doorbell = 0;
+        send(channel->socket_fd, &doorbell, sizeof(doorbell), MSG_DONTWAIT | MSG_NOSIGNAL);
+    }
+}
+
+/**
+ * Svuota la socket della connessione senza bloccarsi. Per il server contiene solo le sveglie del
+ * client; per il client resta vuota e serve solo a rilevare la chiusura del server.
+ * @return 0 se la connessione è ancora aperta, -1 in caso di disconnessione o errore.
+ */
+static int drain_socket(ShmChannel *channel) {
+    char buffer[64];
+    while (1) {
+        ssize_t received = recv(channel->socket_fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (received > 0) continue;
+        if (received == 0) return -1; // Disconnessione
+        if (errno == EINTR) continue;
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+    }
+}
+
+/**
+ * Segnala che il ring in lettura è vuoto e il consumatore sta per attendere.
+ * Il produttore scrive tail e poi legge consumer_waiting, il consumatore fa l'opposto: con
+ * operazioni sequenzialmente consistenti almeno uno dei due vede l'altro, quindi un messaggio
+ * scritto in quel momento o viene trovato qui o produce una sveglia.
+ * Il client prima azzera l'eventfd: resta leggibile solo finché ci sono messaggi da leggere,
+ * così può essere usato con epoll in modalità level-triggered (vedi shm_wakeup_fd).
+ * @return 0 se il ring è vuoto, 1 se nel frattempo è arrivato un messaggio.
+ */
+static int prepare_wait(ShmChannel *channel) {
+    if (!channel->is_server) {
+        uint64_t value;
+        if (read(channel->event_fd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+            LOG_WARNING("Errore durante la lettura dell'eventfd: %s", strerror(errno));
+        }
+    }
+
+    atomic_store(&channel->rx->consumer_waiting, 1);
+    if (!ring_has_data(channel->rx)) {
+        return 0;
+    }
+
+    atomic_store(&channel->rx->consumer_waiting, 0);
+    if (!channel->is_server) {
+        uint64_t one = 1;
+        if (write(channel->event_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+            LOG_WARNING("Errore durante la scrittura dell'eventfd: %s", strerror(errno));
+        }
+    }
+    return 1;
+}
+
+/**
+ * Legge il prossimo messaggio dal ring, se c'è. Il produttore pubblica solo messaggi completi,
+ * quindi un messaggio incompleto o più grande del ring indica memoria danneggiata dall'altro
+ * processo.
+ * @return 1 se è stato letto un messaggio, 0 se il ring è vuoto, -1 in caso di errore.
+ */
+static int ring_read_msg(ShmChannel *channel, Msg **msg_out, Arena *arena) {
+    uint32_t head = atomic_load_explicit(&channel->rx->head, memory_order_relaxed);
+    uint32_t available = atomic_load_explicit(&channel->rx->tail, memory_order_acquire) - head;
+    if (available == 0) {
+        return 0;
+    }
+    if (available < SHM_FRAME_HEADER_SIZE || available > SHM_RING_SIZE) {
+        return -1;
+    }
+
+    char wire_header[SHM_FRAME_HEADER_SIZE];
+    uint16_t msgType_net;
+    uint32_t payloadSize_net;
+    ring_copy_out(channel->rx_data, head, wire_header, sizeof(wire_header));
+    memcpy(&msgType_net, wire_header, sizeof(uint16_t));
+    memcpy(&payloadSize_net, wire_header + sizeof(uint16_t), sizeof(uint32_t));
+
+    uint32_t payload_size = ntohl(payloadSize_net);
+    if (payload_size > available - SHM_FRAME_HEADER_SIZE) {
+        return -1;
+    }
+
+    Msg *msg;
+    char *payload_buffer;
+    if (arena != NULL) {
+        msg = (Msg *)arena_alloc(arena, sizeof(Msg));
+        payload_buffer = (char *)arena_alloc(arena, payload_size + 1);
+    } else {
+        msg = (Msg *)malloc(sizeof(Msg));
+        payload_buffer = (char *)malloc(payload_size + 1);
+    }
+    if (msg == NULL || payload_buffer == NULL) {
+        if (arena == NULL) {
+            free(msg);
+            free(payload_buffer);
+        }
+        return -1;
+    }
+    ring_copy_out(channel->rx_data, head + SHM_FRAME_HEADER_SIZE, payload_buffer, payload_size);
+    payload_buffer[payload_size] = '\0';
+    atomic_store_explicit(&channel->rx->head, head + SHM_FRAME_HEADER_SIZE + payload_size, memory_order_release);
+
+    msg->header.msgType = ntohs(msgType_net);
+    msg->header.payloadSize = payload_size;
+    msg->payload = payload_buffer;
+    *msg_out = msg;
+    return 1;
+}
+
+/**
+ * Crea il canale in memoria condivisa di una connessione e lo offre al client, inviandogli
+ * MSG_SHARED_MEMORY_ATTACHED con il memfd e l'eventfd. Da questo momento i messaggi della
+ * connessione passano dai ring.
+ * @param socket_fd Socket UNIX del client.
+ * @return 0 in caso di successo, -1 in caso di errore (la connessione resta sulla socket).
+ */
+int shm_offer_channel(int socket_fd) {
+    if (lookup_channel(socket_fd) != NULL) {
+        return -1;
+    }
+
+    int memfd = memfd_create("battleship-shm", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (memfd < 0) {
+        LOG_ERROR("Errore nella creazione della memoria condivisa: %s", strerror(errno));
+        return -1;
+    }
+    // Sigillata, così il client non può ridurla e far fallire gli accessi del server
+    if (ftruncate(memfd, shm_map_size()) < 0 ||
+        fcntl(memfd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) < 0) {
+        LOG_ERROR("Errore nel dimensionamento della memoria condivisa: %s", strerror(errno));
+        close(memfd);
+        return -1;
+    }
+
+    int event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (event_fd < 0) {
+        LOG_ERROR("Errore nella creazione dell'eventfd: %s", strerror(errno));
+        close(memfd);
+        return -1;
+    }
+
+    ShmChannel *channel = map_channel(memfd, event_fd, socket_fd, 1);
+    if (channel == NULL) {
+        close(event_fd);
+        close(memfd);
+        return -1;
+    }
+    if (register_channel(channel) < 0) {
+        unmap_channel(channel);
+        close(memfd);
+        return -1;
+    }
+
+    // La risposta parte ancora sulla socket, insieme ai descrittori
+    int result = -1;
+    Payload *payload = createEmptyPayload();
+    addPayloadKeyValuePairInt(payload, "ring_size", SHM_RING_SIZE);
+    char *serialized_payload = serializePayload(payload);
+    freePayload(payload);
+    if (serialized_payload != NULL) {
+        Msg msg = {{MSG_SHARED_MEMORY_ATTACHED, (uint32_t)strlen(serialized_payload)}, serialized_payload};
+        int fds[2] = {memfd, event_fd};
+        result = sendMsgWithFds(socket_fd, &msg, fds, 2);
+        free(serialized_payload);
+    }
+    close(memfd); // La mappatura resta valida
+    if (result < 0) {
+        shm_close_channel(socket_fd);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Chiede al server di passare la connessione in memoria condivisa e attende la risposta.
+ * Va chiamata quando non ci sono altri messaggi in arrivo, per esempio prima del login.
+ * @param socket_fd Socket UNIX connessa al server.
+ * @return 0 se la connessione usa la memoria condivisa, 1 se il server non la offre e la
+ *         connessione prosegue sulla socket, -1 in caso di errore o disconnessione.
+ */
+int shm_request_channel(int socket_fd) {
+    if (safeSendMsg(socket_fd, MSG_ATTACH_SHARED_MEMORY, NULL) < 0) {
+        return -1;
+    }
+
+    int fds[2];
+    int fds_count = 0;
+    Msg *reply = recvMsgWithFds(socket_fd, fds, 2, &fds_count);
+    if (reply == NULL) {
+        return -1;
+    }
+
+    uint16_t msg_type = reply->header.msgType;
+    freeMsg(reply);
+    struct stat memfd_stat;
+    if (msg_type != MSG_SHARED_MEMORY_ATTACHED || fds_count != 2 ||
+        fstat(fds[0], &memfd_stat) < 0 || (size_t)memfd_stat.st_size != shm_map_size()) {
+        for (int i = 0; i < fds_count; i++) {
+            close(fds[i]);
+        }
+        return msg_type == MSG_SHARED_MEMORY_ATTACHED ? -1 : 1;
+    }
+
+    ShmChannel *channel = map_channel(fds[0], fds[1], socket_fd, 0);
+    close(fds[0]);
+    if (channel == NULL) {
+        close(fds[1]);
+        return -1;
+    }
+    if (register_channel(channel) < 0) {
+        unmap_channel(channel);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @param socket_fd Socket di una connessione.
+ * @return 1 se i messaggi della connessione passano dalla memoria condivisa, 0 altrimenti.
+ */
+int shm_is_channel(int socket_fd) {
+    return lookup_channel(socket_fd) != NULL;
+}
+
+/**
+ * Restituisce il descrittore da attendere (con poll o epoll, anche level-triggered) per sapere
+ * quando la connessione ha messaggi da leggere: l'eventfd per un client in memoria condivisa, la
+ * socket stessa altrimenti. Il client in memoria condivisa deve attendere anche la socket, che
+ * diventa leggibile quando il server chiude la connessione.
+ * @param socket_fd Socket della connessione.
+ * @return Il descrittore da attendere.
+ */
+int shm_wakeup_fd(int socket_fd) {
+    ShmChannel *channel = acquire_channel(socket_fd);
+    int wakeup_fd = channel != NULL && !channel->is_server ? channel->event_fd : socket_fd;
+    release_channel();
+    return wakeup_fd;
+}
+
+/**
+ * Rilascia il canale in memoria condivisa di una connessione, se ne ha uno. Va chiamata prima di
+ * chiudere la socket, il cui numero potrebbe essere riassegnato a un'altra connessione.
+ * Attende che gli altri thread abbiano finito di usare il canale (vedi channels_lock).
+ * @param socket_fd Socket della connessione.
+ */
+void shm_close_channel(int socket_fd) {
+    if (lookup_channel(socket_fd) == NULL) {
+        return; // Caso comune: connessione sulla socket, nessun lock
+    }
+
+    pthread_rwlock_wrlock(&channels_lock);
+    ShmChannel *channel = lookup_channel(socket_fd);
+    if (channel != NULL) {
+        __atomic_store_n(&channels[socket_fd], NULL, __ATOMIC_RELEASE);
+    }
+    pthread_rwlock_unlock(&channels_lock);
+
+    if (channel != NULL) {
+        unmap_channel(channel);
+    }
+}
+
+/**
+ * Scrive un messaggio nel ring verso l'altro lato della connessione e lo sveglia se lo stava
+ * attendendo.
+ * Il server non attende mai un ring pieno, che indica un client troppo lento a leggere: lo
+ * disconnette con shutdown, come il comando `kick` della socket di amministrazione, e il thread
+ * che possiede la connessione la chiude al prossimo evento come se l'avesse chiusa il client.
+ * Il client invece attende che si liberi per al massimo SHM_SEND_TIMEOUT_MS.
+ * @param socket_fd Socket della connessione.
+ * @param msg Messaggio da inviare.
+ * @return 0 in caso di successo, -1 se il messaggio non entra nel ring, se l'altro lato non lo
+ *         svuota in tempo o se la memoria condivisa è danneggiata.
+ */
+int shm_send_msg(int socket_fd, Msg *msg) {
+    ShmChannel *channel = acquire_channel(socket_fd);
+    if (channel == NULL || msg->header.payloadSize > SHM_RING_SIZE - SHM_FRAME_HEADER_SIZE) {
+        release_channel();
+        return -1;
+    }
+
+    pthread_mutex_lock(&channel->send_mutex);
+    int result = 0;
+    uint32_t frame_size = SHM_FRAME_HEADER_SIZE + msg->header.payloadSize;
+    uint32_t tail = atomic_load_explicit(&channel->tx->tail, memory_order_relaxed);
+    struct timespec retry = {0, SHM_SEND_RETRY_NS};
+    long retries = 0;
+    while (1) {
+        uint32_t used = tail - atomic_load_explicit(&channel->tx->head, memory_order_acquire);
+        if (used > SHM_RING_SIZE) {
+            result = -1;
+            break;
+        }
+        if (SHM_RING_SIZE - used >= frame_size) {
+            break;
+        }
+        if (channel->is_server) {
+            LOG_WARNING("Ring in memoria condivisa della socket %d pieno: il client non legge i messaggi e viene disconnesso", socket_fd);
+            shutdown(socket_fd, SHUT_RDWR);
+            result = -1;
+            break;
+        }
+        if (retries++ >= SHM_SEND_TIMEOUT_MS * (1000000L / SHM_SEND_RETRY_NS)) {
+            LOG_WARNING("Ring in memoria condivisa della socket %d pieno da %d ms", socket_fd, SHM_SEND_TIMEOUT_MS);
+            result = -1;
+            break;
+        }
+        nanosleep(&retry, NULL);
+    }
+
+    if (result == 0) {
+        char wire_header[SHM_FRAME_HEADER_SIZE];
+        uint16_t msgType_net = htons(msg->header.msgType);
+        uint32_t payloadSize_net = htonl(msg->header.payloadSize);
+        memcpy(wire_header, &msgType_net, sizeof(uint16_t));
+        memcpy(wire_header + sizeof(uint16_t), &payloadSize_net, sizeof(uint32_t));
+        ring_copy_in(channel->tx_data, tail, wire_header, sizeof(wire_header));
+        ring_copy_in(channel->tx_data, tail + SHM_FRAME_HEADER_SIZE, msg->payload, msg->header.payloadSize);
+
+        atomic_store(&channel->tx->tail, tail + frame_size);
+        if (atomic_load(&channel->tx->consumer_waiting) && atomic_exchange(&channel->tx->consumer_waiting, 0)) {
+            wake_peer(channel);
+        }
+    }
+    pthread_mutex_unlock(&channel->send_mutex);
+    release_channel();
+    return result;
+}
+
+/**
+ * Legge il prossimo messaggio dal ring senza bloccarsi.
+ * Con il ring vuoto il server legge le sveglie arrivate sulla socket, che così torna a segnalare
+ * il prossimo messaggio, e rileva la chiusura della connessione.
+ * @param socket_fd Socket della connessione.
+ * @param msg_out Puntatore per il messaggio ricevuto.
+ * @param arena Arena da cui allocare il messaggio, NULL per allocarlo con malloc (da liberare con freeMsg).
+ * @return 1 se è stato letto un messaggio, 0 se non ci sono messaggi, -1 in caso di errore o
+ *         disconnessione.
+ */
+int shm_try_recv_msg(int socket_fd, Msg **msg_out, Arena *arena) {
+    ShmChannel *channel = acquire_channel(socket_fd);
+    if (channel == NULL) {
+        release_channel();
+        return -1;
+    }
+
+    int result = ring_read_msg(channel, msg_out, arena);
+    if (result > 0 && !channel->is_server && !ring_has_data(channel->rx)) {
+        prepare_wait(channel); // Se nel frattempo arriva un messaggio l'eventfd resta leggibile
+    }
+    if (result == 0) {
+        if (drain_socket(channel) < 0) {
+            result = -1;
+        } else if (prepare_wait(channel) > 0) {
+            result = ring_read_msg(channel, msg_out, arena);
+        }
+    }
+    release_channel();
+    return result;
+}
+
+/**
+ * Legge il prossimo messaggio dal ring, attendendo che arrivi.
+ * @param socket_fd Socket della connessione.
+ * @param arena Arena da cui allocare il messaggio, NULL per allocarlo con malloc.
+ * @return Il messaggio ricevuto, o NULL in caso di errore o disconnessione.
+ */
+Msg *shm_recv_msg(int socket_fd, Arena *arena) {
+    while (1) {
+        Msg *msg = NULL;
+        int result = shm_try_recv_msg(socket_fd, &msg, arena);
+        if (result != 0) {
+            return result > 0 ? msg : NULL;
+        }
+
+        // L'attesa avviene senza tenere il canale: i descrittori restano validi finché la
+        // connessione non viene chiusa, cosa che spetta a questo stesso thread
+        ShmChannel *channel = acquire_channel(socket_fd);
+        struct pollfd fds[2] = {
+            {socket_fd, POLLIN, 0},
+            {channel != NULL && !channel->is_server ? channel->event_fd : -1, POLLIN, 0}
+        };
+        release_channel();
+        if (channel == NULL) {
+            return NULL;
+        }
+        if (poll(fds, 2, -1) < 0 && errno != EINTR) {
+            return NULL;
+        }
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef SHM_TRANSPORT_H
+#define SHM_TRANSPORT_H
+
+#include <stdint.h>
+
+#include "common/protocol.h"
+
+/**
+ * Trasporto in memoria condivisa per i client sulla stessa macchina del server.
+ * Un client connesso alla socket UNIX del server (`-unix`) invia MSG_ATTACH_SHARED_MEMORY e
+ * attende la risposta senza inviare altro: il server crea un memfd con due ring
+ * single-producer/single-consumer, uno per direzione, e un eventfd, e li passa al client con
+ * SCM_RIGHTS insieme a MSG_SHARED_MEMORY_ATTACHED. Da lì in avanti i messaggi, con lo stesso
+ * formato (header e payload) usato sulle socket, vengono copiati nei ring senza passare dal
+ * kernel; sendMsg, recvMsg e le funzioni safe* di protocol.c scelgono il trasporto in base alla
+ * socket, che resta l'identificativo della connessione.
+ *
+ * Chi consuma un ring vuoto lo segnala nel ring prima di attendere, e chi scrive lo sveglia solo
+ * in quel caso:
+ * - il server sveglia il client scrivendo sull'eventfd;
+ * - il client sveglia il server scrivendo un byte sulla socket, che resta l'unico descrittore
+ *   della connessione registrato nel reactor e segnala anche la disconnessione del client.
+ * Il server non attende mai un ring pieno: il client che non lo svuota viene disconnesso come
+ * con il comando `kick`. Il client invece attende che si liberi per al massimo SHM_SEND_TIMEOUT_MS.
+ *
+ * La memoria condivisa resta legata al processo che l'ha creata: il server non la offre quando
+ * le connessioni possono passare a un altro processo (-handoff, -workers).
+ */
+
+#define SHM_MAGIC 0x314D4853 // "SHM1"
+#define SHM_RING_SIZE (64 * 1024) // Byte di ciascun ring, potenza di 2: limita anche la dimensione di un messaggio
+#define SHM_SEND_TIMEOUT_MS 5000 // Attesa massima del client per lo spazio in un ring pieno
+
+int shm_offer_channel(int socket_fd);
+int shm_request_channel(int socket_fd);
+
+int shm_is_channel(int socket_fd);
+int shm_wakeup_fd(int socket_fd);
+void shm_close_channel(int socket_fd);
+
+int shm_send_msg(int socket_fd, Msg *msg);
+int shm_try_recv_msg(int socket_fd, Msg **msg_out, Arena *arena);
+Msg *shm_recv_msg(int socket_fd, Arena *arena);
+
+#endif // SHM_TRANSPORT_H
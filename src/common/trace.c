@@ -0,0 +1,285 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+
+#include <sys/syscall.h>
+#include <pthread.h>
+
+#include "common/trace.h"
+#include "common/protocol.h"
+#include "utils/debug.h"
+
+#define TRACE_EVENT_WORDS 3 // Tipo, argomento e thread; inizio; durata
+
+typedef struct _TraceRing {
+    _Atomic uint64_t claimed; // Eventi di cui è iniziata la scrittura
+    _Atomic uint64_t committed; // Eventi scritti per intero
+    _Atomic uint64_t words[TRACE_RING_EVENTS * TRACE_EVENT_WORDS];
+    int tid; // Thread che usa o ha usato per ultimo il ring
+    int in_use;
+    char thread_name[TRACE_THREAD_NAME_SIZE];
+    struct _TraceRing *next; // Modificato solo sotto il lock del registro
+} TraceRing;
+
+static const char *const TRACE_KIND_NAMES[TRACE_KINDS] = {"recv", "parse", "handler", "serialize", "send", "fanout", "timer"};
+
+_Atomic int trace_sample_rate = 0;
+__thread int trace_sampled = 0;
+__thread unsigned int trace_msg_counter = 0;
+
+static __thread TraceRing *local_ring = NULL;
+static __thread char local_thread_name[TRACE_THREAD_NAME_SIZE];
+
+static pthread_mutex_t registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+static TraceRing *registry_head = NULL;
+static pthread_once_t registry_once = PTHREAD_ONCE_INIT;
+static pthread_key_t registry_key;
+
+/**
+ * Imposta il campionamento del tracing.
+ * @param rate Un messaggio ogni `rate` viene tracciato, 0 per spegnere il tracing.
+ */
+void trace_set_sample_rate(int rate) {
+    atomic_store_explicit(&trace_sample_rate, rate > 0 ? rate : 0, memory_order_relaxed);
+}
+
+/**
+ * Assegna un nome al thread corrente, mostrato nella traccia esportata.
+ * @param name Nome del thread, troncato a TRACE_THREAD_NAME_SIZE - 1 caratteri.
+ */
+void trace_set_thread_name(const char *name) {
+    snprintf(local_thread_name, sizeof(local_thread_name), "%s", name);
+    if (local_ring != NULL) {
+        pthread_mutex_lock(&registry_mutex);
+        memcpy(local_ring->thread_name, local_thread_name, sizeof(local_thread_name));
+        pthread_mutex_unlock(&registry_mutex);
+    }
+}
+
+static void detach_thread(void *arg) {
+    TraceRing *ring = (TraceRing *)arg;
+    pthread_mutex_lock(&registry_mutex);
+    ring->in_use = 0;
+    pthread_mutex_unlock(&registry_mutex);
+}
+
+static void init_registry(void) {
+    pthread_key_create(&registry_key, detach_thread);
+}
+
+/**
+ * Assegna un ring al thread corrente, riusando quello di un thread terminato se c'è.
+ * @return Il ring, o NULL se manca la memoria.
+ */
+static TraceRing *attach_thread(void) {
+    pthread_once(&registry_once, init_registry);
+    pthread_mutex_lock(&registry_mutex);
+
+    TraceRing *ring = registry_head;
+    while (ring != NULL && ring->in_use) {
+        ring = ring->next;
+    }
+    if (ring == NULL) {
+        ring = (TraceRing *)calloc(1, sizeof(TraceRing));
+        if (ring != NULL) {
+            ring->next = registry_head;
+            registry_head = ring;
+        }
+    }
+    if (ring != NULL) {
+        ring->in_use = 1;
+        ring->tid = (int)syscall(SYS_gettid);
+        memcpy(ring->thread_name, local_thread_name, sizeof(local_thread_name));
+    }
+
+    pthread_mutex_unlock(&registry_mutex);
+
+    if (ring == NULL) {
+        LOG_ERROR("Memoria insufficiente per il ring di tracing del thread");
+        return NULL;
+    }
+    pthread_setspecific(registry_key, ring);
+    local_ring = ring;
+    return ring;
+}
+
+/**
+ * Registra uno span terminato adesso nel ring del thread corrente.
+ * Lo span viene prima dichiarato (claimed), poi scritto e infine pubblicato (committed), così
+ * chi esporta riconosce gli eventi sovrascritti mentre li copiava.
+ * @param kind Tipo di span.
+ * @param arg Argomento dello span.
+ * @param start_ns Inizio dello span (CLOCK_MONOTONIC).
+ */
+void trace_record(TraceKind kind, uint16_t arg, int64_t start_ns) {
+    int64_t end_ns = metrics_now_ns();
+    TraceRing *ring = local_ring != NULL ? local_ring : attach_thread();
+    if (ring == NULL) return;
+
+    uint64_t index = atomic_load_explicit(&ring->claimed, memory_order_relaxed);
+    atomic_store_explicit(&ring->claimed, index + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    _Atomic uint64_t *event = &ring->words[(index % TRACE_RING_EVENTS) * TRACE_EVENT_WORDS];
+    atomic_store_explicit(&event[0], (uint64_t)kind | (uint64_t)arg << 16 | (uint64_t)(uint32_t)ring->tid << 32, memory_order_relaxed);
+    atomic_store_explicit(&event[1], (uint64_t)start_ns, memory_order_relaxed);
+    atomic_store_explicit(&event[2], (uint64_t)(end_ns - start_ns), memory_order_relaxed);
+
+    atomic_store_explicit(&ring->committed, index + 1, memory_order_release);
+}
+
+/**
+ * Scrive un evento nel formato JSON di Chrome.
+ * @return 0 in caso di successo, -1 in caso di errore di scrittura.
+ */
+static int export_event(FILE *out, int pid, const uint64_t *event, int *first) {
+    TraceKind kind = (TraceKind)(event[0] & 0xFFFF);
+    uint16_t arg = (uint16_t)(event[0] >> 16);
+    int tid = (int)(uint32_t)(event[0] >> 32);
+    if (kind >= TRACE_KINDS) return 0;
+
+    // I messaggi ricevuti sono del client, quelli inviati del server
+    const char *type_name = kind <= TRACE_HANDLER ? playerMsgTypeName(arg) : gameMsgTypeName(arg);
+    const char *name = kind == TRACE_HANDLER && type_name != NULL ? type_name : TRACE_KIND_NAMES[kind];
+
+    int written = fprintf(out, "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d",
+                          *first ? "" : ",", name, TRACE_KIND_NAMES[kind], event[1] / 1e3, event[2] / 1e3, pid, tid);
+    *first = 0;
+    if (kind != TRACE_TIMER) {
+        if (type_name != NULL) {
+            written = fprintf(out, ",\"args\":{\"type\":\"%s\"}}", type_name);
+        } else {
+            written = fprintf(out, ",\"args\":{\"type\":%u}}", arg);
+        }
+    } else {
+        written = fprintf(out, "}");
+    }
+    return written < 0 ? -1 : 0;
+}
+
+/**
+ * Esporta gli eventi di tutti i ring nel formato JSON di Chrome, con i nomi dei thread.
+ * I thread continuano a scrivere durante l'esportazione: di ogni ring vengono copiati gli eventi
+ * pubblicati e poi scartati quelli che nel frattempo potrebbero essere stati sovrascritti.
+ * Il lock del registro serve solo a elencare i ring, che non vengono mai liberati: un lettore
+ * lento non ferma i thread che si registrano.
+ * @param out Stream su cui scrivere.
+ * @return Numero di eventi esportati, o -1 in caso di errore.
+ */
+int trace_export(FILE *out) {
+    typedef struct {
+        TraceRing *ring;
+        int tid;
+        char thread_name[TRACE_THREAD_NAME_SIZE];
+    } RingInfo;
+
+    pthread_mutex_lock(&registry_mutex);
+    int rings_count = 0;
+    for (TraceRing *ring = registry_head; ring != NULL; ring = ring->next) rings_count++;
+    RingInfo *rings = (RingInfo *)malloc(sizeof(RingInfo) * (rings_count > 0 ? rings_count : 1));
+    if (rings != NULL) {
+        int i = 0;
+        for (TraceRing *ring = registry_head; ring != NULL; ring = ring->next, i++) {
+            rings[i].ring = ring;
+            rings[i].tid = ring->tid;
+            memcpy(rings[i].thread_name, ring->thread_name, TRACE_THREAD_NAME_SIZE);
+        }
+    }
+    pthread_mutex_unlock(&registry_mutex);
+
+    uint64_t *copy = (uint64_t *)malloc(sizeof(uint64_t) * TRACE_RING_EVENTS * TRACE_EVENT_WORDS);
+    if (!rings || !copy) {
+        free(rings);
+        free(copy);
+        return -1;
+    }
+
+    int pid = (int)getpid();
+    int exported = 0, first = 1, failed = 0;
+    fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+
+    for (int r = 0; r < rings_count && !failed; r++) {
+        TraceRing *ring = rings[r].ring;
+        uint64_t committed = atomic_load_explicit(&ring->committed, memory_order_acquire);
+        uint64_t from = committed > TRACE_RING_EVENTS ? committed - TRACE_RING_EVENTS : 0;
+        for (uint64_t i = from; i < committed; i++) {
+            const _Atomic uint64_t *event = &ring->words[(i % TRACE_RING_EVENTS) * TRACE_EVENT_WORDS];
+            for (int w = 0; w < TRACE_EVENT_WORDS; w++) {
+                copy[(i % TRACE_RING_EVENTS) * TRACE_EVENT_WORDS + w] = atomic_load_explicit(&event[w], memory_order_relaxed);
+            }
+        }
+        atomic_thread_fence(memory_order_acquire);
+        uint64_t claimed = atomic_load_explicit(&ring->claimed, memory_order_relaxed);
+        if (claimed > TRACE_RING_EVENTS && claimed - TRACE_RING_EVENTS > from) {
+            from = claimed - TRACE_RING_EVENTS;
+        }
+
+        // Un thread terminato conserva il nome, finché il suo ring non passa a un altro thread
+        if (rings[r].thread_name[0] != '\0') {
+            fprintf(out, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                    first ? "" : ",", pid, rings[r].tid, rings[r].thread_name);
+            first = 0;
+        }
+        for (uint64_t i = from; i < committed && !failed; i++) {
+            failed = export_event(out, pid, &copy[(i % TRACE_RING_EVENTS) * TRACE_EVENT_WORDS], &first) < 0;
+            exported++;
+        }
+    }
+
+    free(rings);
+    free(copy);
+    if (fprintf(out, "\n]}\n") < 0 || failed) {
+        return -1;
+    }
+    return exported;
+}
+
+/**
+ * Attende SIGUSR2 e a ogni segnale scrive la traccia in un nuovo file nella directory corrente.
+ */
+static void *signal_thread_main(void *arg) {
+    sigset_t *signals = (sigset_t *)arg;
+    int dumps = 0;
+
+    while (1) {
+        int signal_number;
+        if (sigwait(signals, &signal_number) != 0) continue;
+
+        char path[64];
+        snprintf(path, sizeof(path), "trace-%d-%d.json", (int)getpid(), dumps++);
+        FILE *out = fopen(path, "w");
+        if (out == NULL) {
+            LOG_ERROR("Impossibile creare il file di traccia `%s`: %s", path, strerror(errno));
+            continue;
+        }
+        int exported = trace_export(out);
+        fclose(out);
+        LOG_INFO("Traccia scritta in `%s` (%d eventi)", path, exported);
+    }
+
+    return NULL;
+}
+
+/**
+ * Blocca SIGUSR2 e avvia il thread che lo attende per esportare la traccia.
+ * Va chiamata prima di creare altri thread, che ereditano il segnale bloccato.
+ * @return 0 in caso di successo, -1 in caso di errore.
+ */
+int trace_start_signal_thread(void) {
+    static sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGUSR2);
+    if (pthread_sigmask(SIG_BLOCK, &signals, NULL) != 0) {
+        return -1;
+    }
+
+    pthread_t thread_id;
+    if (pthread_create(&thread_id, NULL, signal_thread_main, &signals) != 0) {
+        LOG_ERROR("Errore durante la creazione del thread di esportazione della traccia");
+        return -1;
+    }
+    pthread_detach(thread_id);
+    return 0;
+}
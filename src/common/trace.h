@@ -0,0 +1,88 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "common/metrics.h"
+
+/**
+ * Tracing a campione di lobby, partite e protocollo, esportato nel formato JSON di Chrome
+ * (chrome://tracing, Perfetto).
+ * Il campionamento si decide per messaggio: trace_msg_begin, chiamata dai thread prima di leggere
+ * un messaggio, sceglie un messaggio ogni `trace_sample_rate` e da lì a trace_msg_end ogni span
+ * (lettura, parsing, handler, serializzazione, invio) viene registrato. Con il tracing spento
+ * (rate 0) ogni span costa il controllo di una variabile thread-local.
+ *
+ * Gli span finiscono in un ring per thread di TRACE_RING_EVENTS eventi, allocato al primo span
+ * registrato dal thread e scritto senza lock: gli eventi più vecchi vengono sovrascritti. Chi
+ * esporta copia i ring mentre i thread continuano a scrivere e scarta gli eventi che potrebbero
+ * essere stati sovrascritti durante la copia. Il ring di un thread che termina passa al prossimo
+ * thread, con i suoi eventi.
+ *
+ * Il tracing si accende e si spegne a runtime (trace_set_sample_rate, comando `trace` della
+ * socket di amministrazione); SIGUSR2 scrive gli eventi in `trace-<pid>-<n>.json`.
+ */
+
+#define TRACE_RING_EVENTS 8192 // Eventi per thread, potenza di 2
+#define TRACE_THREAD_NAME_SIZE 32
+
+typedef enum {
+    TRACE_RECV,         // Lettura di un messaggio dalla socket, argomento il tipo ricevuto
+    TRACE_PARSE,        // Parsing del payload, argomento il tipo ricevuto
+    TRACE_HANDLER,      // Handler di un messaggio, argomento il tipo ricevuto
+    TRACE_SERIALIZE,    // Serializzazione di un payload, argomento il tipo inviato
+    TRACE_SEND,         // Invio di un messaggio, argomento il tipo inviato
+    TRACE_FANOUT,       // Invio di un messaggio a tutti i giocatori, argomento il tipo inviato
+    TRACE_TIMER,        // Gestione di un timeout della partita
+    TRACE_KINDS
+} TraceKind;
+
+extern _Atomic int trace_sample_rate;
+extern __thread int trace_sampled;
+extern __thread unsigned int trace_msg_counter;
+
+void trace_set_sample_rate(int rate);
+void trace_set_thread_name(const char *name);
+void trace_record(TraceKind kind, uint16_t arg, int64_t start_ns);
+int trace_export(FILE *out);
+int trace_start_signal_thread(void);
+
+/**
+ * Decide se tracciare il prossimo messaggio del thread, uno ogni `trace_sample_rate`.
+ * Il conteggio avanza solo con trace_msg_end, così le letture che non trovano un messaggio non
+ * consumano il campione.
+ */
+static inline void trace_msg_begin(void) {
+    int rate = atomic_load_explicit(&trace_sample_rate, memory_order_relaxed);
+    trace_sampled = rate > 0 && trace_msg_counter % (unsigned int)rate == 0;
+}
+
+/** Chiude il messaggio corrente, dopo il suo handler. */
+static inline void trace_msg_end(void) {
+    trace_msg_counter++;
+    trace_sampled = 0;
+}
+
+/**
+ * Apre uno span se il messaggio corrente è campionato.
+ * @return L'istante di inizio, da passare a trace_end, o 0 se lo span non va registrato.
+ */
+static inline int64_t trace_begin(void) {
+    return trace_sampled ? metrics_now_ns() : 0;
+}
+
+/**
+ * Chiude uno span aperto con trace_begin.
+ * @param kind Tipo di span.
+ * @param arg Argomento dello span, di solito il tipo del messaggio.
+ * @param start_ns Valore restituito da trace_begin.
+ */
+static inline void trace_end(TraceKind kind, uint16_t arg, int64_t start_ns) {
+    if (start_ns != 0) {
+        trace_record(kind, arg, start_ns);
+    }
+}
+
+#endif // TRACE_H
@@ -0,0 +1,1115 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "utils/cmdLineParser.h"
+#include "utils/debug.h"
+#include "common/protocol.h"
+#include "common/game.h"
+#include "common/messages.h"
+#include "common/fleetPlacement.h"
+
+/**
+ * Generatore di carico: apre molte connessioni verso un server in esecuzione e parla il
+ * protocollo reale, come farebbero altrettanti client.
+ * Le connessioni sono divise tra pochi thread, ognuno con la propria epoll e connessioni non
+ * bloccanti; i giocatori di una stessa partita stanno sempre nello stesso thread.
+ * Ogni giocatore fa il login, il primo della partita la crea e gli altri vi si uniscono, tutti
+ * inviano una flotta casuale valida; il proprietario avvia la partita quando ha visto entrare
+ * tutti, e a ogni MSG_YOUR_TURN il giocatore spara una salva su celle non ancora colpite.
+ *
+ * Scenari (`-scenario`):
+ * - login: tutte le connessioni si aprono insieme, fanno il login e si chiudono;
+ * - small: molte partite piccole (2 giocatori di default);
+ * - huge: poche partite con molti giocatori (100 di default);
+ * - slow: partite da 4 giocatori in cui l'ultimo legge pochi byte ogni `-delay` ms, con un
+ *   buffer di ricezione ridotto, per osservare l'effetto di un client lento sugli altri.
+ *
+ * Riporta connessioni al secondo, messaggi al secondo e gli istogrammi della latenza di
+ * connessione, login, creazione/unione e attacco (dall'invio di MSG_ATTACK al MSG_ATTACK_UPDATE
+ * con il proprio colpo).
+ */
+
+#define MAX_LOADGEN_EVENTS 256
+#define READ_CHUNK 16384 // Byte letti per chiamata dai client normali
+#define SLOW_READ_CHUNK 64 // Byte letti dal client lento a ogni risveglio
+#define SLOW_RCVBUF 4096 // Buffer di ricezione della socket del client lento
+#define HISTOGRAM_SUB_BUCKETS 8 // Intervalli per ogni potenza di 2: errore massimo del 12.5%
+#define HISTOGRAM_BUCKETS (64 * HISTOGRAM_SUB_BUCKETS)
+
+typedef enum {
+    SCENARIO_LOGIN,
+    SCENARIO_SMALL,
+    SCENARIO_HUGE,
+    SCENARIO_SLOW
+} Scenario;
+
+typedef enum {
+    CONN_CONNECTING,
+    CONN_LOGGING_IN,
+    CONN_CREATING, // Il proprietario attende MSG_GAME_CREATED
+    CONN_WAITING_GAME, // Chi si unisce attende che la partita sia stata creata
+    CONN_JOINING,
+    CONN_PLAYING,
+    CONN_CLOSED
+} ConnState;
+
+typedef enum {
+    LATENCY_CONNECT,
+    LATENCY_LOGIN,
+    LATENCY_JOIN,
+    LATENCY_ATTACK,
+    LATENCY_KINDS
+} LatencyKind;
+
+static const char *LATENCY_NAMES[LATENCY_KINDS] = {"connect", "login", "create/join", "attack"};
+
+typedef struct {
+    uint64_t counts[HISTOGRAM_BUCKETS];
+    uint64_t total;
+    long max_ns;
+} LatencyHistogram;
+
+typedef struct LoadGame LoadGame;
+
+typedef struct {
+    int fd;
+    ConnState state;
+    LoadGame *game; // NULL nello scenario login
+    int member_index; // Posizione nella partita, 0 per il proprietario
+    int user_id;
+    int is_slow;
+    uint32_t epoll_events; // Eventi attualmente registrati nella epoll
+
+    char *in; // Byte ricevuti e non ancora consumati
+    size_t in_len, in_capacity;
+    char *out; // Byte da inviare
+    size_t out_len, out_capacity;
+
+    long request_ns; // Istante di invio della richiesta di cui si attende la risposta
+    int pending_latency; // LatencyKind della richiesta in corso, -1 se nessuna
+    long next_read_ns; // Client lento: prossima lettura consentita
+    int throttled; // Client lento in attesa della prossima lettura
+
+    int salvo_size;
+    int *opponents; // ID degli avversari, ordinati per la ricerca binaria
+    BoardMask *shot; // Celle già colpite di ogni avversario
+    char *eliminated;
+    int opponents_count;
+    int opponents_alive;
+    int finished; // La partita è terminata per questo giocatore
+} LoadConn;
+
+struct LoadGame {
+    int game_id; // -1 finché il server non conferma la creazione
+    LoadConn **members; // members[0] è il proprietario
+    int players;
+    int expected_players; // Giocatori ancora attesi, diminuisce se qualcuno non riesce a entrare
+    char *seen; // Giocatori visti entrare dal proprietario
+    int seen_count;
+    int start_sent;
+};
+
+typedef struct {
+    int thread_index;
+    int epoll_fd;
+    unsigned int rng_state;
+
+    LoadConn *conns;
+    long conns_count;
+    long open_conns;
+    LoadGame *games;
+    long games_count;
+
+    LoadConn **throttled; // Client lenti che non leggono fino a next_read_ns
+    long throttled_count;
+
+    // Risultati
+    unsigned long connected;
+    unsigned long connect_failures;
+    unsigned long logged_in;
+    unsigned long games_finished;
+    unsigned long msgs_sent;
+    unsigned long msgs_received;
+    unsigned long protocol_errors;
+    unsigned long disconnects;
+    long last_connect_ns;
+    LatencyHistogram latency[LATENCY_KINDS];
+} LoadThread;
+
+static Scenario scenario;
+static struct sockaddr_storage server_addr;
+static socklen_t server_addr_len;
+static int ruleset_id;
+static const char *ruleset_name;
+static long slow_delay_ns;
+static long deadline_ns;
+
+static long now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000L + now.tv_nsec;
+}
+
+/**
+ * Indice dell'intervallo dell'istogramma: valori esatti fino a HISTOGRAM_SUB_BUCKETS, poi
+ * HISTOGRAM_SUB_BUCKETS intervalli uguali per ogni potenza di 2.
+ */
+static int histogram_bucket(uint64_t value) {
+    if (value < HISTOGRAM_SUB_BUCKETS) return (int)value;
+    int exponent = 63 - __builtin_clzll(value);
+    int sub = (int)(value >> (exponent - 3)) - HISTOGRAM_SUB_BUCKETS;
+    return (exponent - 2) * HISTOGRAM_SUB_BUCKETS + sub;
+}
+
+/**
+ * Valore massimo contenuto in un intervallo dell'istogramma.
+ */
+static uint64_t histogram_bucket_limit(int bucket) {
+    if (bucket < HISTOGRAM_SUB_BUCKETS) return (uint64_t)bucket;
+    int exponent = bucket / HISTOGRAM_SUB_BUCKETS + 2;
+    uint64_t low = (uint64_t)(HISTOGRAM_SUB_BUCKETS + bucket % HISTOGRAM_SUB_BUCKETS) << (exponent - 3);
+    return low + ((uint64_t)1 << (exponent - 3)) - 1;
+}
+
+static void histogram_record(LatencyHistogram *histogram, long value_ns) {
+    if (value_ns < 0) value_ns = 0;
+    histogram->counts[histogram_bucket((uint64_t)value_ns)]++;
+    histogram->total++;
+    if (value_ns > histogram->max_ns) histogram->max_ns = value_ns;
+}
+
+static void histogram_merge(LatencyHistogram *dest, const LatencyHistogram *src) {
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) dest->counts[i] += src->counts[i];
+    dest->total += src->total;
+    if (src->max_ns > dest->max_ns) dest->max_ns = src->max_ns;
+}
+
+/**
+ * Percentile dell'istogramma, approssimato per eccesso al limite del suo intervallo.
+ */
+static long histogram_percentile(const LatencyHistogram *histogram, double percentile) {
+    uint64_t rank = (uint64_t)(histogram->total * percentile / 100.0);
+    if (rank >= histogram->total) rank = histogram->total - 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += histogram->counts[i];
+        if (seen > rank) {
+            long limit = (long)histogram_bucket_limit(i);
+            return limit < histogram->max_ns ? limit : histogram->max_ns;
+        }
+    }
+    return histogram->max_ns;
+}
+
+/**
+ * Stampa la distribuzione per potenze di 2 dei microsecondi, una riga per intervallo non vuoto.
+ */
+static void print_histogram(const char *name, const LatencyHistogram *histogram) {
+    uint64_t rows[64] = {0};
+    int last_row = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        if (histogram->counts[i] == 0) continue;
+        uint64_t us = histogram_bucket_limit(i) / 1000;
+        int row = us == 0 ? 0 : 64 - __builtin_clzll(us);
+        rows[row] += histogram->counts[i];
+        if (row > last_row) last_row = row;
+    }
+
+    printf("\nistogramma %s:\n", name);
+    for (int row = 0; row <= last_row; row++) {
+        if (rows[row] == 0) continue;
+        double share = 100.0 * rows[row] / histogram->total;
+        char bar[41];
+        int width = (int)(share * 40 / 100 + 0.5);
+        memset(bar, '#', width);
+        bar[width] = '\0';
+        printf("  < %8lu us  %10lu  %5.1f%%  %s\n", row == 0 ? 1UL : 1UL << row, (unsigned long)rows[row], share, bar);
+    }
+}
+
+static void record_latency(LoadThread *thread, LoadConn *conn, LatencyKind kind) {
+    if (conn->pending_latency != (int)kind) return;
+    histogram_record(&thread->latency[kind], now_ns() - conn->request_ns);
+    conn->pending_latency = -1;
+}
+
+/**
+ * Aggiorna gli eventi registrati nella epoll: scrittura solo con dati in uscita (o connessione
+ * in corso), lettura tranne per un client lento che sta aspettando.
+ */
+static void update_interest(LoadThread *thread, LoadConn *conn) {
+    uint32_t events = 0;
+    if (!conn->throttled) events |= EPOLLIN;
+    if (conn->state == CONN_CONNECTING || conn->out_len > 0) events |= EPOLLOUT;
+    if (events == conn->epoll_events) return;
+
+    struct epoll_event event = {.events = events, .data.ptr = conn};
+    epoll_ctl(thread->epoll_fd, EPOLL_CTL_MOD, conn->fd, &event);
+    conn->epoll_events = events;
+}
+
+static void game_member_lost(LoadThread *thread, LoadConn *conn);
+
+/**
+ * Chiude una connessione. Una chiusura prima della fine della partita è contata come
+ * disconnessione inattesa.
+ */
+static void close_conn(LoadThread *thread, LoadConn *conn) {
+    if (conn->state == CONN_CLOSED) return;
+    int was_playing = conn->state >= CONN_CREATING;
+    if (!conn->finished && scenario != SCENARIO_LOGIN) {
+        thread->disconnects++;
+    }
+
+    epoll_ctl(thread->epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+    close(conn->fd);
+    conn->state = CONN_CLOSED;
+    thread->open_conns--;
+
+    free(conn->in);
+    free(conn->out);
+    free(conn->opponents);
+    free(conn->shot);
+    free(conn->eliminated);
+    conn->in = conn->out = NULL;
+    conn->opponents = NULL;
+    conn->shot = NULL;
+    conn->eliminated = NULL;
+    conn->in_len = conn->out_len = 0;
+
+    if (conn->game != NULL && !conn->finished && was_playing) {
+        game_member_lost(thread, conn);
+    }
+}
+
+/**
+ * Invia quanto possibile del buffer in uscita senza bloccare.
+ * @return 0 se la connessione è ancora aperta, -1 se è stata chiusa.
+ */
+static int flush_conn(LoadThread *thread, LoadConn *conn) {
+    size_t sent_total = 0;
+    while (sent_total < conn->out_len) {
+        ssize_t sent = send(conn->fd, conn->out + sent_total, conn->out_len - sent_total, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            close_conn(thread, conn);
+            return -1;
+        }
+        sent_total += sent;
+    }
+
+    memmove(conn->out, conn->out + sent_total, conn->out_len - sent_total);
+    conn->out_len -= sent_total;
+    update_interest(thread, conn);
+    return 0;
+}
+
+/**
+ * Accoda un messaggio nel formato del protocollo e prova a inviarlo subito.
+ * Libera il payload.
+ * @return 0 se la connessione è ancora aperta, -1 se è stata chiusa.
+ */
+static int queue_msg(LoadThread *thread, LoadConn *conn, uint16_t msg_type, Payload *payload) {
+    char *serialized = serializePayload(payload);
+    freePayload(payload);
+    if (serialized == NULL) {
+        close_conn(thread, conn);
+        return -1;
+    }
+
+    uint32_t payload_size = strlen(serialized);
+    size_t needed = conn->out_len + WIRE_HEADER_SIZE + payload_size;
+    if (needed > conn->out_capacity) {
+        size_t new_capacity = conn->out_capacity ? conn->out_capacity : 256;
+        while (new_capacity < needed) new_capacity *= 2;
+        char *new_out = (char *)realloc(conn->out, new_capacity);
+        if (new_out == NULL) {
+            free(serialized);
+            close_conn(thread, conn);
+            return -1;
+        }
+        conn->out = new_out;
+        conn->out_capacity = new_capacity;
+    }
+
+    uint16_t msg_type_net = htons(msg_type);
+    uint32_t payload_size_net = htonl(payload_size);
+    memcpy(conn->out + conn->out_len, &msg_type_net, sizeof(uint16_t));
+    memcpy(conn->out + conn->out_len + sizeof(uint16_t), &payload_size_net, sizeof(uint32_t));
+    memcpy(conn->out + conn->out_len + WIRE_HEADER_SIZE, serialized, payload_size);
+    conn->out_len = needed;
+    free(serialized);
+    thread->msgs_sent++;
+
+    if (conn->state == CONN_CONNECTING) {
+        return 0; // Partirà quando la connessione sarà stabilita
+    }
+    return flush_conn(thread, conn);
+}
+
+static int send_request(LoadThread *thread, LoadConn *conn, uint16_t msg_type, Payload *payload, LatencyKind kind) {
+    conn->request_ns = now_ns();
+    conn->pending_latency = kind;
+    return queue_msg(thread, conn, msg_type, payload);
+}
+
+static void send_join(LoadThread *thread, LoadConn *conn) {
+    Payload *payload = createEmptyPayload();
+    addPayloadKeyValuePairInt(payload, "game_id", conn->game->game_id);
+    conn->state = CONN_JOINING;
+    send_request(thread, conn, MSG_JOIN_GAME, payload, LATENCY_JOIN);
+}
+
+/**
+ * Il proprietario avvia la partita quando ha visto entrare tutti i giocatori attesi.
+ */
+static void maybe_start_game(LoadThread *thread, LoadGame *game) {
+    LoadConn *owner = game->members[0];
+    if (game->start_sent || owner->state != CONN_PLAYING || game->seen_count < game->expected_players - 1) {
+        return;
+    }
+    game->start_sent = 1;
+    queue_msg(thread, owner, MSG_START_GAME, NULL);
+}
+
+/**
+ * Un giocatore non è riuscito a entrare o ha lasciato la partita: se non era ancora iniziata,
+ * il proprietario non lo aspetta più. Se era il proprietario, chi attende la creazione non
+ * può più entrare.
+ */
+static void game_member_lost(LoadThread *thread, LoadConn *conn) {
+    LoadGame *game = conn->game;
+    if (game->start_sent) return;
+
+    if (conn->member_index == 0) {
+        for (int i = 1; i < game->players; i++) {
+            if (game->members[i]->state == CONN_WAITING_GAME) {
+                close_conn(thread, game->members[i]);
+            }
+        }
+        return;
+    }
+
+    game->expected_players--;
+    if (game->seen[conn->member_index]) {
+        game->seen[conn->member_index] = 0;
+        game->seen_count--;
+    }
+    maybe_start_game(thread, game);
+}
+
+static void mark_player_seen(LoadThread *thread, LoadGame *game, int player_id) {
+    for (int i = 1; i < game->players; i++) {
+        if (game->members[i]->user_id == player_id && !game->seen[i] && game->members[i]->state != CONN_CLOSED) {
+            game->seen[i] = 1;
+            game->seen_count++;
+            break;
+        }
+    }
+    maybe_start_game(thread, game);
+}
+
+/**
+ * Entra nella partita appena creata o raggiunta: pronto a giocare e flotta casuale valida.
+ */
+static void enter_game(LoadThread *thread, LoadConn *conn) {
+    conn->state = CONN_PLAYING;
+    if (queue_msg(thread, conn, MSG_READY_TO_PLAY, NULL) < 0) return;
+
+    FleetSetup fleet;
+    generate_random_fleet(&fleet, get_game_rules(ruleset_id)->fleet, &thread->rng_state);
+    ShipRecord ships[NUM_SHIPS];
+    for (int i = 0; i < NUM_SHIPS; i++) {
+        ships[i] = (ShipRecord){fleet.ships[i].dim, fleet.ships[i].vertical, fleet.ships[i].x, fleet.ships[i].y};
+    }
+    queue_msg(thread, conn, MSG_SETUP_FLEET, encode_fleet_msg(ships, NUM_SHIPS));
+}
+
+static int compare_int(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+static int find_opponent(LoadConn *conn, int player_id) {
+    int *found = (int *)bsearch(&player_id, conn->opponents, conn->opponents_count, sizeof(int), compare_int);
+    return found != NULL ? (int)(found - conn->opponents) : -1;
+}
+
+static void eliminate_opponent(LoadConn *conn, int index) {
+    if (index < 0 || conn->eliminated[index]) return;
+    conn->eliminated[index] = 1;
+    conn->opponents_alive--;
+}
+
+static int is_cell_shot(const BoardMask *mask, int cell) {
+    return (mask->w[cell / 64] >> (cell % 64)) & 1;
+}
+
+/**
+ * Prepara gli avversari dall'ordine dei turni di MSG_GAME_STARTED.
+ */
+static void on_game_started(LoadThread *thread, LoadConn *conn, Payload *payload) {
+    PlayerIdRecord *turn_order;
+    int lists = decode_game_started_msg(payload, &turn_order);
+    if (lists < 0) thread->protocol_errors++;
+    conn->opponents = (int *)malloc((lists > 0 ? lists : 1) * sizeof(int));
+    conn->shot = (BoardMask *)calloc(lists > 0 ? lists : 1, sizeof(BoardMask));
+    conn->eliminated = (char *)calloc(lists > 0 ? lists : 1, 1);
+    if (conn->opponents == NULL || conn->shot == NULL || conn->eliminated == NULL) {
+        close_conn(thread, conn);
+        return;
+    }
+
+    conn->opponents_count = 0;
+    for (int i = 0; i < lists; i++) {
+        if (turn_order[i].player_id != conn->user_id) {
+            conn->opponents[conn->opponents_count++] = turn_order[i].player_id;
+        }
+    }
+    qsort(conn->opponents, conn->opponents_count, sizeof(int), compare_int);
+    conn->opponents_alive = conn->opponents_count;
+}
+
+/**
+ * Spara una salva su celle non ancora colpite di avversari ancora in gioco scelti a caso.
+ */
+static void send_salvo(LoadThread *thread, LoadConn *conn) {
+    ShotRecord salvo[MAX_SALVO_SIZE];
+    int shots = 0;
+
+    while (shots < conn->salvo_size && shots < MAX_SALVO_SIZE && conn->opponents_alive > 0) {
+        int target = rand_r(&thread->rng_state) % conn->opponents_count;
+        while (conn->eliminated[target]) {
+            target = (target + 1) % conn->opponents_count;
+        }
+
+        int start = rand_r(&thread->rng_state) % (GRID_SIZE * GRID_SIZE);
+        int cell = -1;
+        for (int k = 0; k < GRID_SIZE * GRID_SIZE; k++) {
+            int candidate = (start + k) % (GRID_SIZE * GRID_SIZE);
+            if (!is_cell_shot(&conn->shot[target], candidate)) {
+                cell = candidate;
+                break;
+            }
+        }
+        if (cell < 0) {
+            eliminate_opponent(conn, target); // Griglia esaurita, non può avere navi
+            continue;
+        }
+
+        mask_set_cell(&conn->shot[target], cell / GRID_SIZE, cell % GRID_SIZE);
+        salvo[shots++] = (ShotRecord){conn->opponents[target], cell / GRID_SIZE, cell % GRID_SIZE};
+    }
+
+    if (shots == 0) return;
+    send_request(thread, conn, MSG_ATTACK, encode_attack_msg(salvo, shots), LATENCY_ATTACK);
+}
+
+static void on_attack_update(LoadThread *thread, LoadConn *conn, Payload *payload) {
+    if (conn->opponents == NULL) return;
+
+    AttackResultRecord *shots;
+    int lists = decode_attack_update_msg(payload, &shots);
+    if (lists < 0) {
+        thread->protocol_errors++;
+        return;
+    }
+    for (int i = 0; i < lists; i++) {
+        const AttackResultRecord *shot = &shots[i];
+        if (shot->x < 0 || shot->x >= GRID_SIZE || shot->y < 0 || shot->y >= GRID_SIZE) {
+            thread->protocol_errors++;
+            continue;
+        }
+        if (shot->attacker_id == conn->user_id) {
+            record_latency(thread, conn, LATENCY_ATTACK);
+        }
+
+        int index = find_opponent(conn, shot->attacked_id);
+        if (index < 0) continue;
+        mask_set_cell(&conn->shot[index], shot->x, shot->y);
+
+        if (shot->result == ATTACK_RESULT_ELIMINATED) {
+            eliminate_opponent(conn, index);
+        }
+    }
+}
+
+/**
+ * Reagisce a un messaggio del server secondo lo stato della connessione.
+ */
+static void handle_msg(LoadThread *thread, LoadConn *conn, uint16_t msg_type, Payload *payload) {
+    LoadGame *game = conn->game;
+
+    switch (msg_type) {
+        case MSG_WELCOME:
+            if (conn->state != CONN_LOGGING_IN) break;
+            record_latency(thread, conn, LATENCY_LOGIN);
+            getPayloadIntValue(payload, 0, "user_id", &conn->user_id);
+            thread->logged_in++;
+
+            if (game == NULL) {
+                close_conn(thread, conn);
+            } else if (conn->member_index == 0) {
+                char game_name[32];
+                snprintf(game_name, sizeof(game_name), "load_%d_%ld", thread->thread_index, (long)(game - thread->games));
+                Payload *create_payload = createEmptyPayload();
+                addPayloadKeyValuePair(create_payload, "game_name", game_name);
+                addPayloadKeyValuePair(create_payload, "ruleset", ruleset_name);
+                conn->state = CONN_CREATING;
+                send_request(thread, conn, MSG_CREATE_GAME, create_payload, LATENCY_JOIN);
+            } else if (game->game_id >= 0) {
+                send_join(thread, conn);
+            } else {
+                conn->state = CONN_WAITING_GAME;
+            }
+            break;
+
+        case MSG_GAME_CREATED:
+            if (conn->state != CONN_CREATING) break;
+            record_latency(thread, conn, LATENCY_JOIN);
+            getPayloadIntValue(payload, 0, "salvo_size", &conn->salvo_size);
+            if (getPayloadIntValue(payload, 0, "game_id", &game->game_id) < 0) {
+                thread->protocol_errors++;
+                close_conn(thread, conn);
+                break;
+            }
+            enter_game(thread, conn);
+            for (int i = 1; i < game->players; i++) {
+                if (game->members[i]->state == CONN_WAITING_GAME) {
+                    send_join(thread, game->members[i]);
+                }
+            }
+            break;
+
+        case MSG_GAME_JOINED:
+            if (conn->state != CONN_JOINING) break;
+            record_latency(thread, conn, LATENCY_JOIN);
+            enter_game(thread, conn);
+            break;
+
+        case MSG_GAME_STATE_UPDATE: {
+            getPayloadIntValue(payload, 0, "salvo_size", &conn->salvo_size);
+            if (conn->member_index != 0) break;
+            int lists = getPayloadListSize(payload);
+            for (int i = 1; i < lists && conn->state == CONN_PLAYING; i++) {
+                int player_id;
+                if (getPayloadIntValue(payload, i, "player_id", &player_id) == 0) {
+                    mark_player_seen(thread, game, player_id);
+                }
+            }
+            break;
+        }
+
+        case MSG_PLAYER_JOINED: {
+            int player_id;
+            if (conn->member_index == 0 && getPayloadIntValue(payload, 0, "player_id", &player_id) == 0) {
+                mark_player_seen(thread, game, player_id);
+            }
+            break;
+        }
+
+        case MSG_GAME_STARTED:
+            on_game_started(thread, conn, payload);
+            break;
+
+        case MSG_YOUR_TURN:
+            if (conn->opponents != NULL) send_salvo(thread, conn);
+            break;
+
+        case MSG_ATTACK_UPDATE:
+            on_attack_update(thread, conn, payload);
+            break;
+
+        case MSG_PLAYER_LEFT: {
+            PlayerIdRecord *left;
+            if (conn->opponents != NULL && decode_player_left_msg(payload, &left) == 1) {
+                eliminate_opponent(conn, find_opponent(conn, left->player_id));
+            }
+            break;
+        }
+
+        case MSG_GAME_FINISHED:
+            conn->finished = 1;
+            if (conn->member_index == 0) thread->games_finished++;
+            close_conn(thread, conn);
+            break;
+
+        case MSG_YOU_ARE_ELIMINATED:
+        case MSG_TURN_ORDER_UPDATE:
+        case MSG_FLEET_SETUP_REMINDER:
+        case MSG_FLEET_AUTO_PLACED:
+            break;
+
+        case MSG_ERROR_CREATE_GAME:
+        case MSG_ERROR_JOIN_GAME:
+        case MSG_ERROR_NOT_AUTHENTICATED:
+        case MSG_REDIRECT:
+            thread->protocol_errors++;
+            close_conn(thread, conn);
+            break;
+
+        default:
+            thread->protocol_errors++;
+            break;
+    }
+}
+
+/**
+ * Consuma i messaggi completi nel buffer in ingresso.
+ */
+static void parse_messages(LoadThread *thread, LoadConn *conn) {
+    size_t offset = 0;
+    while (conn->in_len - offset >= WIRE_HEADER_SIZE) {
+        uint16_t msg_type_net;
+        uint32_t payload_size_net;
+        memcpy(&msg_type_net, conn->in + offset, sizeof(uint16_t));
+        memcpy(&payload_size_net, conn->in + offset + sizeof(uint16_t), sizeof(uint32_t));
+        uint16_t msg_type = ntohs(msg_type_net);
+        uint32_t payload_size = ntohl(payload_size_net);
+
+        if (payload_size >= MAX_PAYLOAD_SIZE) {
+            thread->protocol_errors++;
+            close_conn(thread, conn);
+            return;
+        }
+        if (conn->in_len - offset < WIRE_HEADER_SIZE + payload_size) break;
+
+        // Il buffer ha sempre un byte libero dopo i dati: il payload viene terminato sul posto
+        char *payload_string = conn->in + offset + WIRE_HEADER_SIZE;
+        char saved = payload_string[payload_size];
+        payload_string[payload_size] = '\0';
+        Payload *payload = parsePayload(payload_string);
+        payload_string[payload_size] = saved;
+        offset += WIRE_HEADER_SIZE + payload_size;
+        thread->msgs_received++;
+
+        handle_msg(thread, conn, msg_type, payload);
+        freePayload(payload);
+        if (conn->state == CONN_CLOSED) return;
+    }
+
+    memmove(conn->in, conn->in + offset, conn->in_len - offset);
+    conn->in_len -= offset;
+}
+
+/**
+ * Legge i dati disponibili. Un client normale svuota la socket; il client lento legge al massimo
+ * SLOW_READ_CHUNK byte e poi smette di leggere per `-delay` ms.
+ */
+static void on_readable(LoadThread *thread, LoadConn *conn) {
+    size_t chunk = conn->is_slow ? SLOW_READ_CHUNK : READ_CHUNK;
+    while (1) {
+        if (conn->in_len + chunk + 1 > conn->in_capacity) {
+            size_t new_capacity = conn->in_capacity ? conn->in_capacity : 256;
+            while (new_capacity < conn->in_len + chunk + 1) new_capacity *= 2;
+            char *new_in = (char *)realloc(conn->in, new_capacity);
+            if (new_in == NULL) {
+                close_conn(thread, conn);
+                return;
+            }
+            conn->in = new_in;
+            conn->in_capacity = new_capacity;
+        }
+
+        ssize_t received = recv(conn->fd, conn->in + conn->in_len, chunk, 0);
+        if (received < 0 && errno == EINTR) continue;
+        if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (received <= 0) {
+            close_conn(thread, conn);
+            return;
+        }
+        conn->in_len += received;
+
+        parse_messages(thread, conn);
+        if (conn->state == CONN_CLOSED) return;
+
+        if (conn->is_slow) {
+            conn->throttled = 1;
+            conn->next_read_ns = now_ns() + slow_delay_ns;
+            thread->throttled[thread->throttled_count++] = conn;
+            update_interest(thread, conn);
+            return;
+        }
+    }
+}
+
+static void on_connected(LoadThread *thread, LoadConn *conn) {
+    int error = 0;
+    socklen_t len = sizeof(error);
+    if (getsockopt(conn->fd, SOL_SOCKET, SO_ERROR, &error, &len) < 0 || error != 0) {
+        thread->connect_failures++;
+        conn->finished = 1; // Non è una disconnessione: la connessione non è mai esistita
+        close_conn(thread, conn);
+        return;
+    }
+
+    record_latency(thread, conn, LATENCY_CONNECT);
+    thread->connected++;
+    thread->last_connect_ns = now_ns();
+    conn->state = CONN_LOGGING_IN;
+    conn->request_ns = thread->last_connect_ns; // Il login era già in coda
+    conn->pending_latency = LATENCY_LOGIN;
+    flush_conn(thread, conn);
+}
+
+/**
+ * Apre la connessione in modo non bloccante e accoda il login.
+ */
+static void start_conn(LoadThread *thread, LoadConn *conn, long index) {
+    conn->state = CONN_CONNECTING;
+    conn->pending_latency = -1;
+    conn->user_id = -1;
+    conn->salvo_size = 1;
+    conn->fd = socket(server_addr.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (conn->fd < 0) {
+        LOG_ERROR("Errore nella creazione della socket: %s", strerror(errno));
+        conn->state = CONN_CLOSED;
+        thread->connect_failures++;
+        return;
+    }
+    if (conn->is_slow) {
+        int size = SLOW_RCVBUF;
+        setsockopt(conn->fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    }
+
+    struct epoll_event event = {.events = EPOLLOUT, .data.ptr = conn};
+    epoll_ctl(thread->epoll_fd, EPOLL_CTL_ADD, conn->fd, &event);
+    conn->epoll_events = EPOLLOUT;
+    thread->open_conns++;
+
+    char username[32];
+    snprintf(username, sizeof(username), "lg%d_%ld", thread->thread_index, index);
+    Payload *payload = createEmptyPayload();
+    addPayloadKeyValuePair(payload, "username", username);
+    queue_msg(thread, conn, MSG_LOGIN, payload);
+
+    conn->request_ns = now_ns();
+    conn->pending_latency = LATENCY_CONNECT;
+    if (connect(conn->fd, (struct sockaddr *)&server_addr, server_addr_len) == 0) {
+        on_connected(thread, conn);
+    } else if (errno != EINPROGRESS && errno != EAGAIN) {
+        thread->connect_failures++;
+        conn->finished = 1;
+        close_conn(thread, conn);
+    }
+}
+
+/**
+ * Riattiva la lettura dei client lenti il cui intervallo è trascorso.
+ * @return Millisecondi fino al prossimo risveglio, -1 se nessun client attende.
+ */
+static int wake_throttled(LoadThread *thread, long now) {
+    long next = -1;
+    for (long i = 0; i < thread->throttled_count; i++) {
+        LoadConn *conn = thread->throttled[i];
+        if (conn->state != CONN_CLOSED && conn->next_read_ns > now) {
+            if (next < 0 || conn->next_read_ns < next) next = conn->next_read_ns;
+            continue;
+        }
+        if (conn->state != CONN_CLOSED) {
+            conn->throttled = 0;
+            update_interest(thread, conn);
+        }
+        thread->throttled[i--] = thread->throttled[--thread->throttled_count];
+    }
+    return next < 0 ? -1 : (int)((next - now) / 1000000 + 1);
+}
+
+void *loadgen_thread(void *arg) {
+    LoadThread *thread = (LoadThread *)arg;
+
+    for (long i = 0; i < thread->conns_count; i++) {
+        start_conn(thread, &thread->conns[i], i);
+    }
+
+    while (thread->open_conns > 0) {
+        long now = now_ns();
+        if (now >= deadline_ns) {
+            LOG_WARNING("Thread %d: tempo scaduto con %ld connessioni ancora aperte", thread->thread_index, thread->open_conns);
+            for (long i = 0; i < thread->conns_count; i++) {
+                close_conn(thread, &thread->conns[i]);
+            }
+            break;
+        }
+
+        int timeout = wake_throttled(thread, now);
+        int deadline_timeout = (int)((deadline_ns - now) / 1000000 + 1);
+        if (timeout < 0 || timeout > deadline_timeout) timeout = deadline_timeout;
+
+        struct epoll_event events[MAX_LOADGEN_EVENTS];
+        int nfds = epoll_wait(thread->epoll_fd, events, MAX_LOADGEN_EVENTS, timeout);
+        if (nfds < 0 && errno != EINTR) {
+            LOG_ERROR("Errore in epoll_wait: %s", strerror(errno));
+            break;
+        }
+
+        for (int n = 0; n < nfds; n++) {
+            LoadConn *conn = (LoadConn *)events[n].data.ptr;
+            if (conn->state == CONN_CLOSED) continue;
+
+            if (conn->state == CONN_CONNECTING) {
+                on_connected(thread, conn);
+                continue;
+            }
+            if (events[n].events & EPOLLOUT) {
+                if (flush_conn(thread, conn) < 0) continue;
+            }
+            if (events[n].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                on_readable(thread, conn);
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static long parse_long_param(ArgvParam *args, char *name, long default_value, long min_value) {
+    char *value = getArgvParamValue(name, args);
+    if (value == NULL) return default_value;
+
+    char *endPtr;
+    long result = strtol(value, &endPtr, 0);
+    if (*endPtr || result < min_value) {
+        LOG_ERROR("Valore non valido per -%s: %s", name, value);
+        exit(EXIT_FAILURE);
+    }
+    return result;
+}
+
+/**
+ * Risolve l'indirizzo del server: socket UNIX con `-unix`, altrimenti TCP su `-address` e `-port`.
+ */
+static void resolve_server_address(ArgvParam *args) {
+    memset(&server_addr, 0, sizeof(server_addr));
+    char *unix_path = getArgvParamValue("unix", args);
+    if (unix_path != NULL) {
+        struct sockaddr_un *addr = (struct sockaddr_un *)&server_addr;
+        if (strlen(unix_path) >= sizeof(addr->sun_path)) {
+            LOG_ERROR("Percorso della socket UNIX troppo lungo: %s", unix_path);
+            exit(EXIT_FAILURE);
+        }
+        addr->sun_family = AF_UNIX;
+        strcpy(addr->sun_path, unix_path);
+        server_addr_len = sizeof(struct sockaddr_un);
+        return;
+    }
+
+    if (getArgvParamValue("port", args) == NULL) {
+        LOG_ERROR("Specificare -port (e -address, 127.0.0.1 di default) oppure -unix con il percorso della socket UNIX del server");
+        exit(EXIT_FAILURE);
+    }
+    char *address = getArgvParamValue("address", args);
+    struct sockaddr_in *addr = (struct sockaddr_in *)&server_addr;
+    addr->sin_family = AF_INET;
+    addr->sin_port = htons((uint16_t)parse_long_param(args, "port", 0, 1));
+    if (inet_pton(AF_INET, address != NULL ? address : "127.0.0.1", &addr->sin_addr) != 1) {
+        LOG_ERROR("Indirizzo non valido: %s", address);
+        exit(EXIT_FAILURE);
+    }
+    server_addr_len = sizeof(struct sockaddr_in);
+}
+
+int main(int argc, char *argv[]) {
+    ArgvParam *allowedArgs = setArgvParams("-Vaddress,-Vport,-Vunix,-Vscenario,-Vconnections,-Vplayers,-Vthreads,-Vruleset,-Vdelay,-Vtimeout,-Vseed");
+    parseCmdLine(argc, argv, allowedArgs);
+
+    char *scenario_name = getArgvParamValue("scenario", allowedArgs);
+    if (scenario_name == NULL || strcmp(scenario_name, "small") == 0) {
+        scenario = SCENARIO_SMALL;
+        scenario_name = "small";
+    } else if (strcmp(scenario_name, "login") == 0) {
+        scenario = SCENARIO_LOGIN;
+    } else if (strcmp(scenario_name, "huge") == 0) {
+        scenario = SCENARIO_HUGE;
+    } else if (strcmp(scenario_name, "slow") == 0) {
+        scenario = SCENARIO_SLOW;
+    } else {
+        LOG_ERROR("Scenario sconosciuto: %s (login, small, huge, slow)", scenario_name);
+        exit(EXIT_FAILURE);
+    }
+
+    long default_players = scenario == SCENARIO_HUGE ? 100 : scenario == SCENARIO_SLOW ? 4 : 2;
+    long connections = parse_long_param(allowedArgs, "connections", 1000, 1);
+    long players = parse_long_param(allowedArgs, "players", default_players, 2);
+    long threads = parse_long_param(allowedArgs, "threads", sysconf(_SC_NPROCESSORS_ONLN) < 4 ? sysconf(_SC_NPROCESSORS_ONLN) : 4, 1);
+    long timeout = parse_long_param(allowedArgs, "timeout", 300, 1);
+    long seed = parse_long_param(allowedArgs, "seed", time(NULL), 0);
+    slow_delay_ns = parse_long_param(allowedArgs, "delay", 20, 0) * 1000000L;
+    resolve_server_address(allowedArgs);
+
+    ruleset_name = getArgvParamValue("ruleset", allowedArgs);
+    if (ruleset_name == NULL) ruleset_name = get_game_rules(0)->name;
+    if ((ruleset_id = find_game_rules(ruleset_name)) < 0) {
+        LOG_ERROR("Regolamento sconosciuto: %s", ruleset_name);
+        exit(EXIT_FAILURE);
+    }
+
+    // Ogni connessione usa un descrittore: si alza il limite fin dove consentito
+    struct rlimit limit;
+    getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+    long max_connections = (long)limit.rlim_cur - 64;
+    if (connections > max_connections) {
+        LOG_WARNING("Limite di %ld descrittori: le connessioni passano da %ld a %ld", (long)limit.rlim_cur, connections, max_connections);
+        connections = max_connections;
+    }
+
+    long games = 0;
+    if (scenario != SCENARIO_LOGIN) {
+        games = connections / players;
+        if (games == 0) {
+            LOG_ERROR("Servono almeno %ld connessioni per una partita da %ld giocatori", players, players);
+            exit(EXIT_FAILURE);
+        }
+        connections = games * players;
+    }
+    if (scenario == SCENARIO_LOGIN && threads > connections) threads = connections;
+    if (scenario != SCENARIO_LOGIN && threads > games) threads = games;
+
+    LoadThread *thread_args = (LoadThread *)calloc(threads, sizeof(LoadThread));
+    pthread_t *tids = (pthread_t *)malloc(threads * sizeof(pthread_t));
+    if (thread_args == NULL || tids == NULL) {
+        LOG_ERROR("Allocazione dei thread del generatore fallita");
+        exit(EXIT_FAILURE);
+    }
+
+    // Le partite (o le connessioni dello scenario login) sono divise tra i thread
+    for (long t = 0; t < threads; t++) {
+        LoadThread *thread = &thread_args[t];
+        thread->thread_index = t;
+        thread->rng_state = (unsigned int)seed + t * 7919;
+        thread->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+
+        if (scenario == SCENARIO_LOGIN) {
+            thread->conns_count = connections / threads + (t < connections % threads ? 1 : 0);
+        } else {
+            thread->games_count = games / threads + (t < games % threads ? 1 : 0);
+            thread->conns_count = thread->games_count * players;
+            thread->games = (LoadGame *)calloc(thread->games_count, sizeof(LoadGame));
+        }
+        thread->conns = (LoadConn *)calloc(thread->conns_count, sizeof(LoadConn));
+        thread->throttled = (LoadConn **)malloc(thread->conns_count * sizeof(LoadConn *));
+        if (thread->epoll_fd < 0 || thread->conns == NULL || thread->throttled == NULL ||
+            (scenario != SCENARIO_LOGIN && thread->games == NULL)) {
+            LOG_ERROR("Allocazione del thread %ld fallita", t);
+            exit(EXIT_FAILURE);
+        }
+
+        for (long g = 0; g < thread->games_count; g++) {
+            LoadGame *game = &thread->games[g];
+            game->game_id = -1;
+            game->players = players;
+            game->expected_players = players;
+            game->members = (LoadConn **)malloc(players * sizeof(LoadConn *));
+            game->seen = (char *)calloc(players, 1);
+            if (game->members == NULL || game->seen == NULL) {
+                LOG_ERROR("Allocazione delle partite fallita");
+                exit(EXIT_FAILURE);
+            }
+            for (long p = 0; p < players; p++) {
+                LoadConn *conn = &thread->conns[g * players + p];
+                conn->game = game;
+                conn->member_index = p;
+                conn->is_slow = scenario == SCENARIO_SLOW && p == players - 1;
+                game->members[p] = conn;
+            }
+        }
+    }
+
+    if (scenario == SCENARIO_LOGIN) {
+        LOG_INFO("Scenario login: %ld connessioni su %ld thread", connections, threads);
+    } else {
+        LOG_INFO("Scenario %s: %ld partite da %ld giocatori (regolamento %s) su %ld thread",
+                 scenario_name, games, players, ruleset_name, threads);
+    }
+
+    long start = now_ns();
+    deadline_ns = start + timeout * 1000000000L;
+    for (long t = 0; t < threads; t++) {
+        if (pthread_create(&tids[t], NULL, loadgen_thread, &thread_args[t]) != 0) {
+            LOG_ERROR("Errore nella creazione del thread %ld", t);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    unsigned long connected = 0, connect_failures = 0, logged_in = 0, games_finished = 0;
+    unsigned long msgs_sent = 0, msgs_received = 0, protocol_errors = 0, disconnects = 0;
+    long last_connect_ns = start;
+    LatencyHistogram *latency = (LatencyHistogram *)calloc(LATENCY_KINDS, sizeof(LatencyHistogram));
+    for (long t = 0; t < threads; t++) {
+        LoadThread *thread = &thread_args[t];
+        pthread_join(tids[t], NULL);
+        connected += thread->connected;
+        connect_failures += thread->connect_failures;
+        logged_in += thread->logged_in;
+        games_finished += thread->games_finished;
+        msgs_sent += thread->msgs_sent;
+        msgs_received += thread->msgs_received;
+        protocol_errors += thread->protocol_errors;
+        disconnects += thread->disconnects;
+        if (thread->last_connect_ns > last_connect_ns) last_connect_ns = thread->last_connect_ns;
+        for (int k = 0; k < LATENCY_KINDS; k++) {
+            histogram_merge(&latency[k], &thread->latency[k]);
+        }
+    }
+
+    double elapsed = (now_ns() - start) / 1e9;
+    double connect_elapsed = (last_connect_ns - start) / 1e9;
+
+    printf("scenario:           %s\n", scenario_name);
+    printf("connessioni:        %lu (%lu fallite)\n", connected, connect_failures);
+    printf("connessioni/s:      %.0f\n", connect_elapsed > 0 ? connected / connect_elapsed : 0.0);
+    printf("login:              %lu\n", logged_in);
+    if (scenario != SCENARIO_LOGIN) {
+        printf("partite concluse:   %lu / %ld\n", games_finished, games);
+        printf("disconnessioni:     %lu\n", disconnects);
+    }
+    printf("errori protocollo:  %lu\n", protocol_errors);
+    printf("messaggi inviati:   %lu\n", msgs_sent);
+    printf("messaggi ricevuti:  %lu\n", msgs_received);
+    printf("messaggi/s:         %.0f\n", elapsed > 0 ? (msgs_sent + msgs_received) / elapsed : 0.0);
+    printf("tempo:              %.3f s\n", elapsed);
+
+    printf("\nlatenza (us)    %10s %10s %10s %10s %10s %10s\n", "campioni", "p50", "p90", "p99", "p99.9", "max");
+    for (int k = 0; k < LATENCY_KINDS; k++) {
+        if (latency[k].total == 0) continue;
+        printf("%-15s %10lu %10.1f %10.1f %10.1f %10.1f %10.1f\n", LATENCY_NAMES[k], (unsigned long)latency[k].total,
+               histogram_percentile(&latency[k], 50) / 1e3, histogram_percentile(&latency[k], 90) / 1e3,
+               histogram_percentile(&latency[k], 99) / 1e3, histogram_percentile(&latency[k], 99.9) / 1e3,
+               latency[k].max_ns / 1e3);
+    }
+    for (int k = 0; k < LATENCY_KINDS; k++) {
+        if (latency[k].total > 0) print_histogram(LATENCY_NAMES[k], &latency[k]);
+    }
+
+    int failed = connect_failures > 0 || protocol_errors > 0 || (scenario != SCENARIO_LOGIN && games_finished < (unsigned long)games);
+    for (long t = 0; t < threads; t++) {
+        for (long g = 0; g < thread_args[t].games_count; g++) {
+            free(thread_args[t].games[g].members);
+            free(thread_args[t].games[g].seen);
+        }
+        free(thread_args[t].games);
+        free(thread_args[t].conns);
+        free(thread_args[t].throttled);
+        close(thread_args[t].epoll_fd);
+    }
+    free(thread_args);
+    free(tids);
+    free(latency);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,148 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "common/game.h"
+#include "common/gameEngine.h"
+#include "common/gameJournal.h"
+#include "utils/cmdLineParser.h"
+#include "utils/debug.h"
+
+/**
+ * Strumento di replay dei journal delle partite.
+ * Ricostruisce il GameState di una partita applicando i record del journal fino all'indice
+ * richiesto, verificando l'esito di ogni attacco, e stampa lo stato risultante.
+ * Uso: replay -file <journal> [-at N] [-events]
+ */
+
+static const char *STATE_NAMES[] = {"in attesa di giocatori", "in attesa delle flotte", "in corso", "terminata"};
+static const char *RESULT_NAMES[] = {"mancato", "colpito", "affondato", "eliminato"};
+
+static void print_record(unsigned long index, const JournalRecord *record, const void *extra) {
+    printf("%6lu  ", index);
+    switch (record->type) {
+        case GAME_EVENT_PLAYER_JOINED:
+            printf("giocatore %d entra come `%.*s`\n", record->player_id, (int)record->extra_size, (const char *)extra);
+            break;
+        case GAME_EVENT_PLAYER_LEFT:
+            printf("giocatore %d esce\n", record->player_id);
+            break;
+        case GAME_EVENT_FLEET_PLACED:
+            printf("giocatore %d piazza la flotta\n", record->player_id);
+            break;
+        case GAME_EVENT_FLEET_SETUP_STARTED:
+            printf("attesa delle flotte mancanti\n");
+            break;
+        case GAME_EVENT_GAME_STARTED:
+            printf("partita avviata con %u giocatori\n", (unsigned int)(record->extra_size / sizeof(int32_t)));
+            break;
+        case GAME_EVENT_ATTACK:
+            printf("giocatore %d attacca %d in (%d,%d): %s\n", record->player_id, record->target_id, record->x, record->y,
+                   (record->result >= 0 && record->result <= 3) ? RESULT_NAMES[record->result] : "?");
+            break;
+        case GAME_EVENT_PLAYER_ELIMINATED:
+            printf("giocatore %d eliminato\n", record->player_id);
+            break;
+        case GAME_EVENT_TURN:
+            printf("turno di %d%s\n", record->player_id, record->result ? " (aggiuntivo)" : "");
+            break;
+        case GAME_EVENT_GAME_FINISHED:
+            printf("partita terminata, vincitore %d\n", record->player_id);
+            break;
+        default:
+            printf("record sconosciuto di tipo %d\n", record->type);
+            break;
+    }
+}
+
+static void print_game(GameState *game, unsigned long applied) {
+    printf("\nStato dopo %lu eventi: partita %s", applied, STATE_NAMES[game->state_type]);
+    int current_player = engine_current_player(game);
+    if (current_player != -1) {
+        printf(", turno di %d", current_player);
+    }
+    printf("\n");
+
+    for (unsigned int i = 0; i < game->players_count; i++) {
+        PlayerState *player = &game->players[i];
+        printf("\nGiocatore %u `%s`%s, navi rimaste: %d\n", player->user.user_id, player->user.username,
+               player->fleet ? "" : " (senza flotta)", player->fleet ? player->board.ships_left : 0);
+        if (player->fleet == NULL) continue;
+
+        printf("   ");
+        for (int x = 0; x < GRID_SIZE; x++) printf(" %c", 'A' + x);
+        printf("\n");
+        for (int y = 0; y < GRID_SIZE; y++) {
+            printf("%3d", y + 1);
+            for (int x = 0; x < GRID_SIZE; x++) {
+                char cell = player->board.grid[x][y];
+                printf(" %c", (cell >= 'A' && cell <= 'E') ? 'O' : cell);
+            }
+            printf("\n");
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    ArgvParam *allowedArgs = setArgvParams("RVfile,-Vat,--events");
+    parseCmdLine(argc, argv, allowedArgs);
+
+    char *path = getArgvParamValue("file", allowedArgs);
+    char *at_string = getArgvParamValue("at", allowedArgs);
+    int print_events = 0;
+    for (ArgvParam *param = allowedArgs->next; param != NULL; param = param->next) {
+        if (strcmp(param->paramName, "events") == 0) print_events = param->isSet;
+    }
+
+    unsigned long at = (unsigned long)-1;
+    if (at_string != NULL) {
+        char *endPtr;
+        long value = strtol(at_string, &endPtr, 0);
+        if (*endPtr || value < 0) {
+            LOG_ERROR("Valore non valido per -at: %s", at_string);
+            exit(EXIT_FAILURE);
+        }
+        at = (unsigned long)value;
+    }
+
+    JournalReader reader;
+    if (journal_open_reader(path, &reader) < 0) {
+        exit(EXIT_FAILURE);
+    }
+
+    GameState *game = journal_create_game(&reader);
+    if (game == NULL) {
+        LOG_ERROR("Errore durante la creazione della partita");
+        journal_close_reader(&reader);
+        exit(EXIT_FAILURE);
+    }
+
+    time_t created_at = (time_t)reader.header->created_at;
+    char created_string[32];
+    strftime(created_string, sizeof(created_string), "%Y-%m-%d %H:%M:%S", localtime(&created_at));
+    printf("Partita `%s` (ID %d, regolamento %s), registrata il %s\n\n", game->game_name, game->game_id, game->rules->name, created_string);
+
+    int errors = 0;
+    const JournalRecord *record;
+    const void *extra;
+    while (reader.index < at && (record = journal_next_record(&reader, &extra)) != NULL) {
+        if (print_events) {
+            print_record(reader.index - 1, record, extra);
+        }
+        if (journal_apply_record(game, record, extra) < 0) {
+            printf("%6lu  ERRORE: il record non è coerente con lo stato della partita\n", reader.index - 1);
+            errors++;
+        }
+    }
+
+    if (reader.index < at && reader.offset < reader.size) {
+        printf("Il journal termina con un record troncato di %zu byte\n", reader.size - reader.offset);
+    }
+
+    print_game(game, reader.index);
+
+    free_game_state(game);
+    journal_close_reader(&reader);
+    return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
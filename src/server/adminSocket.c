@@ -0,0 +1,561 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/ioctl.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <linux/tcp.h>
+#include <linux/sockios.h>
+#include <pthread.h>
+
+#include "server/adminSocket.h"
+#include "server/users.h"
+#include "server/flightRecorder.h"
+#include "common/metrics.h"
+#include "common/trace.h"
+#include "common/protocol.h"
+#include "common/game.h"
+#include "utils/debug.h"
+#include "utils/slab.h"
+
+typedef struct {
+    const char *name;
+    void (*handler)(FILE *out, const char *args);
+    const char *help;
+} AdminCommand;
+
+static void write_metrics(FILE *out, const char *args);
+static void write_latency(FILE *out, const char *args);
+static void run_trace(FILE *out, const char *args);
+static void run_loglevel(FILE *out, const char *args);
+static void write_flight(FILE *out, const char *args);
+static void write_games(FILE *out, const char *args);
+static void write_connections(FILE *out, const char *args);
+static void run_kick(FILE *out, const char *args);
+static void run_end(FILE *out, const char *args);
+static void run_drain(FILE *out, const char *args);
+static void write_help(FILE *out, const char *args);
+
+static const AdminCommand ADMIN_COMMANDS[] = {
+    {"metrics", write_metrics, "Metriche del processo nel formato testuale di Prometheus"},
+    {"games", write_games, "Partite registrate con stato e numero di giocatori"},
+    {"connections", write_connections, "Connessioni degli utenti con byte trasferiti e code della socket"},
+    {"kick", run_kick, "Disconnette un utente: `kick <id|nome>`"},
+    {"end", run_end, "Termina una partita senza vincitori: `end <id>`"},
+    {"drain", run_drain, "Smette di accettare connessioni e partite nuove, il server termina alla fine dell'ultima partita"},
+    {"latency", write_latency, "Percentili della latenza per tipo di messaggio e fase, in microsecondi"},
+    {"trace", run_trace, "Tracing: `trace on [N]` traccia un messaggio ogni N, `trace off`, `trace dump` esporta in JSON"},
+    {"flight", write_flight, "Ultimi eventi di ogni partita registrati dal flight recorder"},
+    {"loglevel", run_loglevel, "Livello minimo dei log: `loglevel [debug|info|warning|error]`"},
+    {"help", write_help, "Elenco dei comandi"},
+};
+
+#define ADMIN_COMMANDS_COUNT (sizeof(ADMIN_COMMANDS) / sizeof(ADMIN_COMMANDS[0]))
+
+_Atomic int server_draining = 0;
+
+static int drain_notify_fd = -1;
+
+/**
+ * Scrive i messaggi contati per tipo in una direzione.
+ * @param out Stream della connessione.
+ * @param name Nome della metrica.
+ * @param help Descrizione della metrica.
+ * @param counts Messaggi per tipo (vedi METRICS_MSG_TYPES).
+ * @param type_name Funzione che restituisce il nome di un tipo, NULL se il tipo non esiste.
+ */
+static void write_msg_counts(FILE *out, const char *name, const char *help, const int64_t *counts, const char *(*type_name)(uint16_t)) {
+    fprintf(out, "# HELP %s %s\n# TYPE %s counter\n", name, help, name);
+    for (uint16_t type = 0; type < METRICS_MSG_TYPES - 1 && type_name(type) != NULL; type++) {
+        fprintf(out, "%s{type=\"%s\"} %lld\n", name, type_name(type), (long long)counts[type]);
+    }
+    fprintf(out, "%s{type=\"other\"} %lld\n", name, (long long)counts[METRICS_MSG_TYPES - 1]);
+}
+
+/**
+ * Nome del tipo di messaggio ricevuto con cui sono etichettate le latenze.
+ * @return Il nome, o NULL oltre l'ultimo tipo (l'ultimo indice raccoglie i tipi sconosciuti).
+ */
+static const char *latency_type_name(uint16_t msg_type) {
+    if (msg_type == METRICS_MSG_TYPES - 1) return "other";
+    if (msg_type >= METRICS_MSG_TYPES) return NULL;
+    const char *name = playerMsgTypeName(msg_type);
+    return name != NULL ? name : "";
+}
+
+/**
+ * Scrive le latenze dei messaggi ricevuti come summary di Prometheus, solo per le coppie di
+ * tipo e fase con almeno una misura.
+ * @param out Stream della connessione.
+ */
+static void write_latency_summary(FILE *out) {
+    static const double QUANTILES[] = {0.5, 0.99, 0.999};
+    static MetricsHistogram merged; // Usato solo dal thread di amministrazione
+
+    fprintf(out, "# HELP battleship_message_latency_seconds Latenza dei messaggi ricevuti per tipo e fase\n");
+    fprintf(out, "# TYPE battleship_message_latency_seconds summary\n");
+    for (uint16_t type = 0; latency_type_name(type) != NULL; type++) {
+        const char *name = latency_type_name(type);
+        if (name[0] == '\0') continue;
+        for (int stage = 0; stage < METRIC_STAGES; stage++) {
+            int64_t count = metrics_merge_latency(stage, type, &merged);
+            if (count == 0) continue;
+
+            const char *stage_name = METRIC_STAGE_NAMES[stage];
+            for (size_t q = 0; q < sizeof(QUANTILES) / sizeof(QUANTILES[0]); q++) {
+                fprintf(out, "battleship_message_latency_seconds{type=\"%s\",stage=\"%s\",quantile=\"%g\"} %.9f\n",
+                        name, stage_name, QUANTILES[q], metrics_histogram_quantile(&merged, QUANTILES[q]) / 1e9);
+            }
+            fprintf(out, "battleship_message_latency_seconds_sum{type=\"%s\",stage=\"%s\"} %.9f\n",
+                    name, stage_name, atomic_load(&merged.sum_ns) / 1e9);
+            fprintf(out, "battleship_message_latency_seconds_count{type=\"%s\",stage=\"%s\"} %lld\n",
+                    name, stage_name, (long long)count);
+        }
+    }
+}
+
+/**
+ * Scrive l'occupazione dei pool di oggetti (vedi slab.h): oggetti in uso e liberi, e memoria
+ * trattenuta da ciascun pool.
+ * @param out Stream della connessione.
+ */
+static void write_pool_metrics(FILE *out) {
+    SlabPoolStats stats[SLAB_MAX_POOLS];
+    int count = slab_pool_stats(stats, SLAB_MAX_POOLS);
+
+    fprintf(out, "# HELP battleship_pool_objects Oggetti dei pool per stato\n# TYPE battleship_pool_objects gauge\n");
+    for (int i = 0; i < count; i++) {
+        fprintf(out, "battleship_pool_objects{pool=\"%s\",state=\"used\"} %lld\n", stats[i].name, (long long)stats[i].in_use);
+        fprintf(out, "battleship_pool_objects{pool=\"%s\",state=\"free\"} %lld\n", stats[i].name,
+                (long long)(stats[i].capacity - stats[i].in_use));
+    }
+    fprintf(out, "# HELP battleship_pool_bytes Memoria allocata dai pool\n# TYPE battleship_pool_bytes gauge\n");
+    for (int i = 0; i < count; i++) {
+        fprintf(out, "battleship_pool_bytes{pool=\"%s\"} %lld\n", stats[i].name,
+                (long long)(stats[i].capacity * (int64_t)stats[i].object_size));
+    }
+}
+
+/**
+ * Scrive una tabella con i percentili della latenza di ogni tipo di messaggio ricevuto, una
+ * riga per fase.
+ * @param out Stream della connessione.
+ */
+static void write_latency(FILE *out, const char *args) {
+    (void)args;
+    static MetricsHistogram merged; // Usato solo dal thread di amministrazione
+
+    fprintf(out, "%-26s %-7s %10s %10s %10s %10s %10s\n", "tipo", "fase", "misure", "p50", "p99", "p999", "max");
+    for (uint16_t type = 0; latency_type_name(type) != NULL; type++) {
+        const char *name = latency_type_name(type);
+        if (name[0] == '\0') continue;
+        for (int stage = 0; stage < METRIC_STAGES; stage++) {
+            int64_t count = metrics_merge_latency(stage, type, &merged);
+            if (count == 0) continue;
+
+            fprintf(out, "%-26s %-7s %10lld %10.1f %10.1f %10.1f %10.1f\n", name, METRIC_STAGE_NAMES[stage], (long long)count,
+                    metrics_histogram_quantile(&merged, 0.5) / 1e3, metrics_histogram_quantile(&merged, 0.99) / 1e3,
+                    metrics_histogram_quantile(&merged, 0.999) / 1e3, atomic_load(&merged.max_ns) / 1e3);
+        }
+    }
+}
+
+/**
+ * Scrive le metriche aggregate di tutti i thread, più i gauge calcolati dalle liste di utenti e
+ * partite al momento della richiesta.
+ * @param out Stream della connessione.
+ */
+static void write_metrics(FILE *out, const char *args) {
+    (void)args;
+    MetricsSnapshot snapshot;
+    metrics_snapshot(&snapshot);
+
+    for (int i = 0; i < METRIC_COUNT; i++) {
+        fprintf(out, "# HELP %s %s\n# TYPE %s %s\n%s %lld\n", METRIC_INFO[i].name, METRIC_INFO[i].help,
+                METRIC_INFO[i].name, METRIC_INFO[i].type, METRIC_INFO[i].name, (long long)snapshot.values[i]);
+    }
+    write_msg_counts(out, "battleship_messages_received_total", "Messaggi ricevuti dai client per tipo", snapshot.msgs_in, playerMsgTypeName);
+    write_msg_counts(out, "battleship_messages_sent_total", "Messaggi inviati ai client per tipo", snapshot.msgs_out, gameMsgTypeName);
+
+    unsigned int waiting, started;
+    count_games_by_state(&waiting, &started);
+    fprintf(out, "# HELP battleship_games Partite registrate per stato\n# TYPE battleship_games gauge\n");
+    fprintf(out, "battleship_games{state=\"waiting\"} %u\nbattleship_games{state=\"started\"} %u\n", waiting, started);
+    fprintf(out, "# HELP battleship_clients_connected Utenti con una connessione aperta\n# TYPE battleship_clients_connected gauge\n");
+    fprintf(out, "battleship_clients_connected %u\n", count_connected_users());
+    fprintf(out, "# HELP battleship_metrics_threads Thread che aggiornano le metriche\n# TYPE battleship_metrics_threads gauge\n");
+    fprintf(out, "battleship_metrics_threads %d\n", snapshot.threads);
+    fprintf(out, "# HELP battleship_draining 1 se il server non accetta più connessioni né partite\n# TYPE battleship_draining gauge\n");
+    fprintf(out, "battleship_draining %d\n", atomic_load(&server_draining));
+    write_pool_metrics(out);
+    write_latency_summary(out);
+}
+
+/**
+ * Accende, spegne o esporta il tracing (vedi trace.h). Senza argomenti scrive lo stato.
+ * @param out Stream della connessione.
+ * @param args `on [N]`, `off` o `dump`.
+ */
+static void run_trace(FILE *out, const char *args) {
+    if (strncmp(args, "on", 2) == 0 && (args[2] == '\0' || args[2] == ' ')) {
+        char *endPtr;
+        long sample_rate = args[2] == '\0' ? 1 : strtol(args + 3, &endPtr, 0);
+        if (sample_rate <= 0 || (args[2] != '\0' && *endPtr)) {
+            fprintf(out, "ERR frequenza di campionamento non valida `%s`\n", args + 3);
+            return;
+        }
+        trace_set_sample_rate((int)sample_rate);
+        fprintf(out, "OK tracing acceso, un messaggio ogni %ld\n", sample_rate);
+    } else if (strcmp(args, "off") == 0) {
+        trace_set_sample_rate(0);
+        fprintf(out, "OK tracing spento\n");
+    } else if (strcmp(args, "dump") == 0) {
+        if (trace_export(out) < 0) {
+            LOG_WARNING("Esportazione della traccia non riuscita");
+        }
+    } else if (args[0] == '\0') {
+        int sample_rate = atomic_load(&trace_sample_rate);
+        if (sample_rate > 0) {
+            fprintf(out, "tracing acceso, un messaggio ogni %d\n", sample_rate);
+        } else {
+            fprintf(out, "tracing spento\n");
+        }
+    } else {
+        fprintf(out, "ERR argomento sconosciuto `%s`, usa `trace on [N]`, `trace off` o `trace dump`\n", args);
+    }
+}
+
+/**
+ * Scrive gli eventi del flight recorder di tutte le partite, gli stessi scritti in caso di crash.
+ * @param out Stream della connessione.
+ */
+static void write_flight(FILE *out, const char *args) {
+    (void)args;
+    fflush(out);
+    if (flight_dump(fileno(out)) < 0) {
+        LOG_WARNING("Scrittura del flight recorder sulla socket di amministrazione non riuscita");
+    }
+}
+
+/**
+ * Cambia il livello minimo dei log, o lo scrive se manca l'argomento.
+ * @param out Stream della connessione.
+ * @param args Nuovo livello.
+ */
+static void run_loglevel(FILE *out, const char *args) {
+    if (args[0] == '\0') {
+        fprintf(out, "%s\n", log_level_name());
+    } else if (log_set_level(args) < 0) {
+        fprintf(out, "ERR livello sconosciuto `%s`, usa debug, info, warning o error\n", args);
+    } else {
+        fprintf(out, "OK livello di log %s\n", args);
+    }
+}
+
+/**
+ * Scrive le partite registrate, una per riga, dalla copia fatta da snapshot_games.
+ * @param out Stream della connessione.
+ */
+static void write_games(FILE *out, const char *args) {
+    (void)args;
+    GameSnapshot *games;
+    int count = snapshot_games(&games);
+    if (count < 0) {
+        fprintf(out, "ERR memoria insufficiente\n");
+        return;
+    }
+
+    fprintf(out, "%-6s %-10s %9s %12s %-12s %s\n", "id", "stato", "giocatori", "proprietario", "regolamento", "nome");
+    for (int i = 0; i < count; i++) {
+        const GameSnapshot *game = &games[i];
+        if (game->busy) {
+            fprintf(out, "%-6u %-10s\n", game->game_id, "occupata");
+            continue;
+        }
+        const GameRules *rules = get_game_rules(game->ruleset_id);
+        const char *state = game->remote ? "worker" : game->started ? "in corso" : "in attesa";
+        fprintf(out, "%-6u %-10s %9u %12u %-12s %s\n", game->game_id, state, game->players_count, game->owner_id,
+                rules != NULL ? rules->name : "?", game->game_name);
+    }
+    free(games);
+}
+
+/**
+ * Scrive i contatori di una connessione, letti dal kernel: byte inviati e confermati e byte
+ * ricevuti (solo TCP), byte in attesa di essere letti e di essere inviati o confermati.
+ * @param out Stream della connessione di amministrazione.
+ * @param socket_fd Socket dell'utente.
+ */
+static void write_socket_counters(FILE *out, int socket_fd) {
+    struct sockaddr_storage peer;
+    socklen_t peer_length = sizeof(peer);
+    char address[INET6_ADDRSTRLEN + 8] = "locale";
+    if (getpeername(socket_fd, (struct sockaddr *)&peer, &peer_length) < 0) {
+        fprintf(out, " %-22s\n", "chiusa");
+        return;
+    }
+    if (peer.ss_family == AF_INET) {
+        struct sockaddr_in *in = (struct sockaddr_in *)&peer;
+        char host[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &in->sin_addr, host, sizeof(host));
+        snprintf(address, sizeof(address), "%s:%u", host, ntohs(in->sin_port));
+    } else if (peer.ss_family == AF_INET6) {
+        struct sockaddr_in6 *in6 = (struct sockaddr_in6 *)&peer;
+        char host[INET6_ADDRSTRLEN];
+        inet_ntop(AF_INET6, &in6->sin6_addr, host, sizeof(host));
+        snprintf(address, sizeof(address), "[%s]:%u", host, ntohs(in6->sin6_port));
+    }
+    fprintf(out, " %-22s", address);
+
+    struct tcp_info info;
+    socklen_t info_length = sizeof(info);
+    if (peer.ss_family != AF_UNIX && getsockopt(socket_fd, IPPROTO_TCP, TCP_INFO, &info, &info_length) == 0) {
+        fprintf(out, " %12llu %12llu", (unsigned long long)info.tcpi_bytes_acked, (unsigned long long)info.tcpi_bytes_received);
+    } else {
+        fprintf(out, " %12s %12s", "-", "-");
+    }
+
+    int input_queue = 0, output_queue = 0;
+    if (ioctl(socket_fd, SIOCINQ, &input_queue) < 0) input_queue = -1;
+    if (ioctl(socket_fd, SIOCOUTQ, &output_queue) < 0) output_queue = -1;
+    fprintf(out, " %9d %9d\n", input_queue, output_queue);
+}
+
+/**
+ * Scrive gli utenti con una connessione aperta e i contatori delle loro socket.
+ * Le socket vengono interrogate dopo aver copiato la lista degli utenti, senza lock: una
+ * connessione chiusa nel frattempo compare come `chiusa`.
+ * @param out Stream della connessione.
+ */
+static void write_connections(FILE *out, const char *args) {
+    (void)args;
+    UserSnapshot *users;
+    int count = snapshot_users(&users);
+    if (count < 0) {
+        fprintf(out, "ERR memoria insufficiente\n");
+        return;
+    }
+
+    fprintf(out, "%-6s %-20s %-7s %-6s %-22s %12s %12s %9s %9s\n", "id", "utente", "partita", "socket", "indirizzo",
+            "inviati", "ricevuti", "coda_in", "coda_out");
+    for (int i = 0; i < count; i++) {
+        const UserSnapshot *user = &users[i];
+        if (user->busy) {
+            fprintf(out, "%-6u %-20s\n", user->user_id, "(occupato)");
+            continue;
+        }
+        if (user->socket_fd < 0) continue; // Bot, o giocatore che deve ancora riconnettersi
+
+        char game[16] = "-";
+        if (user->game_id != USER_NO_GAME) {
+            snprintf(game, sizeof(game), "%u", user->game_id);
+        }
+        fprintf(out, "%-6u %-20s %-7s %-6d", user->user_id, user->username[0] != '\0' ? user->username : "-", game, user->socket_fd);
+        write_socket_counters(out, user->socket_fd);
+    }
+    free(users);
+}
+
+/**
+ * Legge un ID di utente o di partita.
+ * @return L'ID, o -1 se `text` non è un numero valido.
+ */
+static int parse_id(const char *text) {
+    char *endPtr;
+    long id = strtol(text, &endPtr, 10);
+    if (text[0] == '\0' || *endPtr != '\0' || id < 0 || id > INT32_MAX) return -1;
+    return (int)id;
+}
+
+/**
+ * Disconnette un utente: il thread che lo gestisce lo rimuove come se avesse chiuso la
+ * connessione, quindi un giocatore lascia la partita con le stesse regole di un abbandono.
+ * @param out Stream della connessione.
+ * @param args ID o nome dell'utente.
+ */
+static void run_kick(FILE *out, const char *args) {
+    int user_id = parse_id(args);
+    if (user_id < 0 && args[0] != '\0') {
+        user_id = find_user_id_by_username(args);
+    }
+    if (user_id < 0) {
+        fprintf(out, "ERR utente sconosciuto `%s`, usa `kick <id|nome>`\n", args);
+        return;
+    }
+    if (disconnect_user((unsigned int)user_id) < 0) {
+        fprintf(out, "ERR l'utente %d non esiste o non ha una connessione\n", user_id);
+        return;
+    }
+    LOG_WARNING("Utente %d disconnesso dall'amministratore", user_id);
+    fprintf(out, "OK utente %d disconnesso\n", user_id);
+}
+
+/**
+ * Termina una partita gestita da un thread di questo processo: il thread la chiude tra un
+ * messaggio e l'altro (vedi GAME_END_SENTINEL).
+ * @param out Stream della connessione.
+ * @param args ID della partita.
+ */
+static void run_end(FILE *out, const char *args) {
+    int game_id = parse_id(args);
+    if (game_id < 0) {
+        fprintf(out, "ERR partita non valida `%s`, usa `end <id>`\n", args);
+        return;
+    }
+    if (notify_game((unsigned int)game_id, GAME_END_SENTINEL) < 0) {
+        fprintf(out, "ERR la partita %d non esiste o è affidata a un worker\n", game_id);
+        return;
+    }
+    fprintf(out, "OK partita %d terminata\n", game_id);
+}
+
+/**
+ * Avvia lo spegnimento controllato del server: il thread principale chiude le socket in ascolto,
+ * la lobby rifiuta le partite nuove e il processo termina quando non restano partite registrate.
+ * Le partite in attesa possono ancora ricevere giocatori e iniziare.
+ * @param out Stream della connessione.
+ */
+static void run_drain(FILE *out, const char *args) {
+    (void)args;
+    unsigned int waiting, started;
+    count_games_by_state(&waiting, &started);
+    if (atomic_exchange(&server_draining, 1)) {
+        fprintf(out, "OK spegnimento già in corso, partite rimaste: %u in attesa, %u in corso\n", waiting, started);
+        return;
+    }
+
+    char wake = 1;
+    if (drain_notify_fd >= 0 && write(drain_notify_fd, &wake, sizeof(wake)) < 0) {
+        LOG_ERROR("Impossibile avvisare il thread principale dello spegnimento: %s", strerror(errno));
+    }
+    LOG_WARNING("Spegnimento controllato richiesto dall'amministratore");
+    fprintf(out, "OK spegnimento avviato, partite rimaste: %u in attesa, %u in corso\n", waiting, started);
+}
+
+static void write_help(FILE *out, const char *args) {
+    (void)args;
+    for (size_t i = 0; i < ADMIN_COMMANDS_COUNT; i++) {
+        fprintf(out, "%-12s %s\n", ADMIN_COMMANDS[i].name, ADMIN_COMMANDS[i].help);
+    }
+}
+
+/**
+ * Legge la prima riga di una richiesta, senza il terminatore.
+ * @param conn_s Connessione, con il timeout di ricezione già impostato.
+ * @param line Buffer di ADMIN_MAX_REQUEST byte.
+ * @return 0 se la riga è stata letta (anche vuota, se il client chiude subito), -1 in caso di errore o timeout.
+ */
+static int read_request_line(int conn_s, char *line) {
+    size_t length = 0;
+    while (length < ADMIN_MAX_REQUEST - 1) {
+        ssize_t received = recv(conn_s, line + length, ADMIN_MAX_REQUEST - 1 - length, 0);
+        if (received < 0 && errno == EINTR) continue;
+        if (received < 0) return -1;
+        if (received == 0) break;
+        length += received;
+        if (memchr(line, '\n', length) != NULL) break;
+    }
+    line[length] = '\0';
+    line[strcspn(line, "\r\n")] = '\0';
+    return 0;
+}
+
+/**
+ * Serve una connessione alla socket di amministrazione: legge il comando, scrive la risposta e
+ * chiude la connessione.
+ * @param conn_s Connessione accettata.
+ */
+static void serve_connection(int conn_s) {
+    struct timeval timeout = {ADMIN_READ_TIMEOUT_MS / 1000, (ADMIN_READ_TIMEOUT_MS % 1000) * 1000};
+    setsockopt(conn_s, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    char line[ADMIN_MAX_REQUEST];
+    FILE *out;
+    if (read_request_line(conn_s, line) < 0 || (out = fdopen(conn_s, "w")) == NULL) {
+        close(conn_s);
+        return;
+    }
+
+    // Una richiesta HTTP indica il comando nel percorso: "GET /metrics HTTP/1.1", "GET /trace/dump"
+    char *command = line;
+    int http = strncmp(line, "GET /", 5) == 0;
+    if (http) {
+        command = line + 5;
+        command[strcspn(command, " ?")] = '\0';
+        for (char *c = command; *c != '\0'; c++) {
+            if (*c == '/') *c = ' ';
+        }
+    }
+    if (command[0] == '\0') {
+        command = "metrics";
+    }
+
+    // Il comando è la prima parola, il resto della riga sono i suoi argomenti
+    char *args = command + strcspn(command, " ");
+    if (*args != '\0') {
+        *args++ = '\0';
+    }
+
+    const AdminCommand *found = NULL;
+    for (size_t i = 0; i < ADMIN_COMMANDS_COUNT && found == NULL; i++) {
+        if (strcmp(command, ADMIN_COMMANDS[i].name) == 0) {
+            found = &ADMIN_COMMANDS[i];
+        }
+    }
+
+    if (http) {
+        fprintf(out, "HTTP/1.0 %s\r\nContent-Type: text/plain; version=0.0.4\r\nConnection: close\r\n\r\n",
+                found != NULL ? "200 OK" : "404 Not Found");
+    }
+    if (found != NULL) {
+        found->handler(out, args);
+    } else {
+        fprintf(out, "ERR comando sconosciuto `%s`, vedi `help`\n", command);
+    }
+    fclose(out); // Chiude anche la connessione
+}
+
+static void *admin_thread_main(void *arg) {
+    int admin_s = *(int *)arg;
+    free(arg);
+
+    while (1) {
+        int conn_s = accept(admin_s, NULL, NULL);
+        if (conn_s < 0) {
+            if (errno != EINTR) {
+                LOG_ERROR("Errore durante l'accept sulla socket di amministrazione: %s", strerror(errno));
+            }
+            continue;
+        }
+        serve_connection(conn_s);
+    }
+
+    return NULL;
+}
+
+/**
+ * Avvia il thread che serve la socket di amministrazione.
+ * @param admin_s Socket UNIX già in ascolto.
+ * @param drain_fd Descriptor su cui il comando `drain` scrive un byte per svegliare il thread principale.
+ * @return 0 in caso di successo, -1 in caso di errore.
+ */
+int admin_start(int admin_s, int drain_fd) {
+    drain_notify_fd = drain_fd;
+    int *arg = (int *)malloc(sizeof(int));
+    if (!arg) return -1;
+    *arg = admin_s;
+
+    pthread_t thread_id;
+    if (pthread_create(&thread_id, NULL, admin_thread_main, arg) != 0) {
+        LOG_ERROR("Errore durante la creazione del thread di amministrazione");
+        free(arg);
+        return -1;
+    }
+    pthread_detach(thread_id);
+    return 0;
+}
@@ -0,0 +1,40 @@
+#ifndef ADMIN_SOCKET_H
+#define ADMIN_SOCKET_H
+
+#include <stdatomic.h>
+
+/**
+ * Socket UNIX di amministrazione del server (`-admin PATH`).
+ * Ogni connessione invia un comando su una riga e riceve la risposta in testo, poi il server
+ * chiude la connessione. Le connessioni sono servite una alla volta da un thread dedicato, così
+ * lobby e partite non se ne accorgono. Comandi:
+ * - `metrics` (anche una riga vuota): metriche del processo nel formato testuale di Prometheus;
+ * - `latency`: percentili della latenza dei messaggi ricevuti per tipo e fase, in microsecondi;
+ * - `trace on [N]`, `trace off`, `trace dump`: accende il tracing di un messaggio ogni N (1 se
+ *   omesso), lo spegne o esporta gli eventi registrati nel formato JSON di Chrome (vedi trace.h);
+ * - `flight`: ultimi eventi di ogni partita registrati dal flight recorder (vedi flightRecorder.h);
+ * - `loglevel [livello]`: livello minimo dei log (vedi asyncLog.h), o quello attuale;
+ * - `games`: partite registrate con stato, giocatori, proprietario e regolamento;
+ * - `connections`: utenti connessi con indirizzo, byte inviati e ricevuti (solo TCP) e byte in
+ *   coda nella socket in ricezione e in invio;
+ * - `kick <id|nome>`: disconnette un utente, che viene rimosso come se avesse chiuso lui la connessione;
+ * - `end <id>`: termina una partita senza vincitori;
+ * - `drain`: il server chiude le socket in ascolto, rifiuta le partite nuove e termina quando
+ *   non restano partite.
+ * Le liste di utenti e partite vengono copiate nodo per nodo (snapshot_games, snapshot_users) e
+ * formattate dopo, senza lock: un nodo occupato a lungo da un altro thread non viene atteso ma
+ * compare come occupato.
+ * - `help`: elenco dei comandi.
+ * Una richiesta HTTP `GET /<comando>` riceve la stessa risposta con un header HTTP, per leggere
+ * le metriche con `curl --unix-socket PATH http://localhost/metrics`; gli argomenti seguono il
+ * comando nel percorso (`GET /trace/dump`).
+ */
+
+#define ADMIN_MAX_REQUEST 1024 // Byte letti di una richiesta, comprese le righe dopo la prima
+#define ADMIN_READ_TIMEOUT_MS 1000 // Attesa massima della richiesta
+
+extern _Atomic int server_draining; // 1 dopo il comando `drain`
+
+int admin_start(int admin_s, int drain_fd);
+
+#endif // ADMIN_SOCKET_H
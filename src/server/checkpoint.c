@@ -0,0 +1,568 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "server/checkpoint.h"
+#include "server/users.h"
+#include "common/gameEngine.h"
+#include "common/bot.h"
+#include "utils/debug.h"
+
+#define CHECKPOINT_FILE_SIZE (CHECKPOINT_HEADER_SIZE + (size_t)CHECKPOINT_MAX_GAMES * sizeof(CheckpointSlot))
+
+typedef struct {
+    char username[CHECKPOINT_NAME_SIZE]; // Nome con cui il giocatore deve rifare il login
+    unsigned int user_id; // ID dell'utente ricreato per il giocatore
+    unsigned int game_id; // ID della partita ripristinata
+} RestoredUser;
+
+static unsigned char *checkpoint_map = NULL; // File di checkpoint mappato in memoria, NULL se disabilitato
+static CheckpointSlot *checkpoint_slots = NULL;
+
+static pthread_mutex_t slots_mutex = PTHREAD_MUTEX_INITIALIZER;
+static unsigned char slot_used[CHECKPOINT_MAX_GAMES]; // 1 se lo slot appartiene a una partita attiva
+static int next_free_slot = 0; // Punto di partenza della ricerca di uno slot libero
+
+static pthread_mutex_t restored_users_mutex = PTHREAD_MUTEX_INITIALIZER;
+static RestoredUser *restored_users = NULL; // Giocatori ripristinati che non si sono ancora riconnessi
+static unsigned int restored_users_count = 0;
+static unsigned int restored_users_capacity = 0;
+
+/**
+ * Byte di una copia coperti dal checksum, per una partita con `players_count` giocatori.
+ */
+static size_t checkpoint_data_size(unsigned int players_count) {
+    return offsetof(CheckpointGame, players) - offsetof(CheckpointGame, game_id) + players_count * sizeof(CheckpointPlayer);
+}
+
+/**
+ * Calcola il checksum FNV-1a di una copia, dal campo game_id all'ultimo giocatore usato.
+ */
+static uint64_t checkpoint_checksum(const CheckpointGame *copy) {
+    const unsigned char *data = (const unsigned char *)&copy->game_id;
+    size_t size = checkpoint_data_size(copy->players_count);
+
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+/**
+ * Thread che sincronizza periodicamente il file di checkpoint sul disco.
+ * I thread di gioco scrivono solo in memoria: la latenza della scrittura su disco resta qui.
+ */
+static void *checkpoint_sync_thread(void *arg) {
+    (void)arg;
+    while (1) {
+        sleep(CHECKPOINT_SYNC_INTERVAL);
+        if (msync(checkpoint_map, CHECKPOINT_FILE_SIZE, MS_SYNC) < 0) {
+            LOG_WARNING("Errore durante la sincronizzazione del checkpoint: %s", strerror(errno));
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Apre il file di checkpoint, creandolo se non esiste, e lo mappa in memoria.
+ * Un file nuovo viene creato sparso, quindi occupa spazio solo per gli slot usati.
+ * @param path Percorso del file.
+ * @return 0 in caso di successo, -1 in caso di errore (i checkpoint restano disabilitati).
+ */
+int checkpoint_open(const char *path) {
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        LOG_ERROR("Impossibile aprire il file di checkpoint `%s`: %s", path, strerror(errno));
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        LOG_ERROR("Impossibile leggere la dimensione del checkpoint `%s`: %s", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    int is_new = (st.st_size == 0);
+    if (!is_new) {
+        CheckpointFileHeader header;
+        if (pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+            header.magic != CHECKPOINT_MAGIC || header.version != CHECKPOINT_VERSION ||
+            header.max_games != CHECKPOINT_MAX_GAMES || header.slot_size != sizeof(CheckpointSlot)) {
+            LOG_ERROR("Il file `%s` non è un checkpoint compatibile", path);
+            close(fd);
+            return -1;
+        }
+    }
+
+    if ((size_t)st.st_size < CHECKPOINT_FILE_SIZE && ftruncate(fd, CHECKPOINT_FILE_SIZE) < 0) {
+        LOG_ERROR("Impossibile ridimensionare il checkpoint `%s`: %s", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    void *map = mmap(NULL, CHECKPOINT_FILE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd); // La mappatura resta valida anche dopo la chiusura del file
+    if (map == MAP_FAILED) {
+        LOG_ERROR("Impossibile mappare il checkpoint `%s`: %s", path, strerror(errno));
+        return -1;
+    }
+
+    checkpoint_map = (unsigned char *)map;
+    checkpoint_slots = (CheckpointSlot *)(checkpoint_map + CHECKPOINT_HEADER_SIZE);
+
+    if (is_new) {
+        CheckpointFileHeader *header = (CheckpointFileHeader *)checkpoint_map;
+        header->magic = CHECKPOINT_MAGIC;
+        header->version = CHECKPOINT_VERSION;
+        header->max_games = CHECKPOINT_MAX_GAMES;
+        header->slot_size = sizeof(CheckpointSlot);
+    }
+
+    pthread_t thread_id;
+    if (pthread_create(&thread_id, NULL, checkpoint_sync_thread, NULL) != 0) {
+        LOG_ERROR("Errore durante la creazione del thread di sincronizzazione del checkpoint");
+        munmap(map, CHECKPOINT_FILE_SIZE);
+        checkpoint_map = NULL;
+        checkpoint_slots = NULL;
+        return -1;
+    }
+    pthread_detach(thread_id);
+
+    LOG_INFO("Checkpoint delle partite su `%s`", path);
+    return 0;
+}
+
+/**
+ * Riserva uno slot libero per una nuova partita.
+ * @return Indice dello slot, o -1 se i checkpoint sono disabilitati o non ci sono slot liberi.
+ */
+int checkpoint_claim_slot(void) {
+    if (checkpoint_map == NULL) return -1;
+
+    int slot = -1;
+    pthread_mutex_lock(&slots_mutex);
+    for (int i = 0; i < CHECKPOINT_MAX_GAMES; i++) {
+        int candidate = (next_free_slot + i) % CHECKPOINT_MAX_GAMES;
+        if (!slot_used[candidate]) {
+            slot_used[candidate] = 1;
+            next_free_slot = (candidate + 1) % CHECKPOINT_MAX_GAMES;
+            slot = candidate;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&slots_mutex);
+
+    if (slot == -1) {
+        LOG_WARNING("Slot di checkpoint esauriti, la partita non verrà salvata");
+    }
+    return slot;
+}
+
+/**
+ * Invalida le copie di uno slot, così la partita non viene ripristinata al prossimo avvio.
+ */
+static void invalidate_slot(int slot) {
+    __atomic_store_n(&checkpoint_slots[slot].copies[0].sequence, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&checkpoint_slots[slot].copies[1].sequence, 0, __ATOMIC_RELEASE);
+}
+
+/**
+ * Rilascia lo slot di una partita terminata.
+ * @param slot Indice dello slot, -1 per nessuno slot.
+ */
+void checkpoint_release_slot(int slot) {
+    if (checkpoint_map == NULL || slot < 0 || slot >= CHECKPOINT_MAX_GAMES) return;
+
+    invalidate_slot(slot);
+    pthread_mutex_lock(&slots_mutex);
+    slot_used[slot] = 0;
+    pthread_mutex_unlock(&slots_mutex);
+}
+
+/**
+ * Copia lo stato di una partita in un CheckpointGame, checksum compreso.
+ * La sequenza della copia non viene modificata.
+ * @param copy Copia da riempire.
+ * @param game Partita da salvare.
+ * @param owner_id ID del proprietario della partita, -1 se non è più presente.
+ * @return 0 in caso di successo, -1 se la partita ha troppi giocatori per essere salvata.
+ */
+int checkpoint_serialize_game(CheckpointGame *copy, const GameState *game, int owner_id) {
+    if (game->players_count > CHECKPOINT_MAX_PLAYERS || game->player_turn_order_count > CHECKPOINT_MAX_PLAYERS) {
+        return -1;
+    }
+
+    copy->game_id = game->game_id;
+    copy->ruleset_id = (uint16_t)(game->rules - GAME_RULESETS);
+    copy->state_type = (uint8_t)game->state_type;
+    copy->players_count = (uint8_t)game->players_count;
+    copy->rng_state = game->rng_state;
+    copy->player_turn = game->player_turn;
+    copy->turn_order_count = game->player_turn_order_count;
+    copy->reserved = 0;
+    copy->saved_at = (int64_t)time(NULL);
+    memset(copy->game_name, 0, sizeof(copy->game_name));
+    if (game->game_name != NULL) {
+        strncpy(copy->game_name, game->game_name, sizeof(copy->game_name) - 1);
+    }
+
+    for (unsigned int i = 0; i < game->player_turn_order_count; i++) {
+        copy->turn_order[i] = game->player_turn_order[i];
+    }
+    for (unsigned int i = game->player_turn_order_count; i < CHECKPOINT_MAX_PLAYERS; i++) {
+        copy->turn_order[i] = -1;
+    }
+
+    for (unsigned int i = 0; i < game->players_count; i++) {
+        const PlayerState *player = &game->players[i];
+        CheckpointPlayer *saved = &copy->players[i];
+
+        memset(saved, 0, sizeof(*saved));
+        saved->user_id = (int32_t)player->user.user_id;
+        if (player->user.username != NULL) {
+            strncpy(saved->username, player->user.username, sizeof(saved->username) - 1);
+        }
+        saved->is_bot = player->bot != NULL;
+        saved->has_fleet = player->fleet != NULL;
+        saved->is_owner = (int)player->user.user_id == owner_id;
+        saved->ships_left = player->board.ships_left;
+        saved->bot_rng_state = player->bot != NULL ? player->bot->rng_state : 0;
+        if (player->fleet != NULL) {
+            for (int j = 0; j < NUM_SHIPS; j++) {
+                const ShipPlacement *ship = &player->fleet->ships[j];
+                saved->ships[j] = (CheckpointShip){(uint8_t)ship->x, (uint8_t)ship->y, (uint8_t)ship->dim, (uint8_t)ship->vertical};
+            }
+        }
+        memcpy(saved->grid, player->board.grid, sizeof(saved->grid));
+    }
+
+    copy->checksum = checkpoint_checksum(copy);
+    return 0;
+}
+
+/**
+ * Salva lo stato di una partita nel suo slot.
+ * Viene sovrascritta la copia meno recente: la sequenza dispari marca la copia come incompleta
+ * finché dati e checksum non sono stati scritti.
+ * Deve essere chiamata solo dal thread proprietario dello slot.
+ * @param slot Indice dello slot della partita.
+ * @param game Partita da salvare.
+ * @param owner_id ID del proprietario della partita, -1 se non è più presente.
+ * @return 0 in caso di successo, -1 se la partita non può essere salvata.
+ */
+int checkpoint_save_game(int slot, const GameState *game, int owner_id) {
+    if (checkpoint_map == NULL || slot < 0 || slot >= CHECKPOINT_MAX_GAMES) return -1;
+
+    if (game->players_count > CHECKPOINT_MAX_PLAYERS || game->player_turn_order_count > CHECKPOINT_MAX_PLAYERS) {
+        invalidate_slot(slot);
+        return -1;
+    }
+
+    CheckpointSlot *checkpoint_slot = &checkpoint_slots[slot];
+    uint64_t sequence0 = checkpoint_slot->copies[0].sequence;
+    uint64_t sequence1 = checkpoint_slot->copies[1].sequence;
+    uint64_t next_sequence = ((sequence0 > sequence1 ? sequence0 : sequence1) | 1) + 1;
+    CheckpointGame *copy = &checkpoint_slot->copies[sequence0 <= sequence1 ? 0 : 1];
+
+    __atomic_store_n(&copy->sequence, next_sequence - 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    checkpoint_serialize_game(copy, game, owner_id);
+
+    __atomic_store_n(&copy->sequence, next_sequence, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/**
+ * Riassegna a una partita ricevuta da un altro processo server lo slot in cui si salvava.
+ * @param slot Indice dello slot, -1 per nessuno slot.
+ */
+void checkpoint_adopt_slot(int slot) {
+    if (checkpoint_map == NULL || slot < 0 || slot >= CHECKPOINT_MAX_GAMES) return;
+
+    pthread_mutex_lock(&slots_mutex);
+    slot_used[slot] = 1;
+    pthread_mutex_unlock(&slots_mutex);
+}
+
+/**
+ * Restituisce la copia valida più recente di uno slot.
+ * @return Puntatore alla copia, o NULL se lo slot non contiene una partita valida.
+ */
+static const CheckpointGame *read_slot(const CheckpointSlot *slot) {
+    const CheckpointGame *best = NULL;
+    for (int i = 0; i < 2; i++) {
+        const CheckpointGame *copy = &slot->copies[i];
+        if (copy->sequence == 0 || (copy->sequence & 1)) continue;
+        if (copy->players_count > CHECKPOINT_MAX_PLAYERS || copy->turn_order_count > CHECKPOINT_MAX_PLAYERS) continue;
+        if (copy->checksum != checkpoint_checksum(copy)) continue;
+        if (best == NULL || copy->sequence > best->sequence) {
+            best = copy;
+        }
+    }
+    return best;
+}
+
+/**
+ * Registra un giocatore ripristinato in attesa di riconnessione.
+ * Se l'array è pieno, raddoppia la sua capacità.
+ * @param username Nome con cui il giocatore deve rifare il login.
+ * @param user_id ID dell'utente ricreato per il giocatore.
+ * @param game_id ID della partita ripristinata.
+ * @return 0 in caso di successo, -1 in caso di errore.
+ */
+int checkpoint_expect_user(const char *username, unsigned int user_id, unsigned int game_id) {
+    pthread_mutex_lock(&restored_users_mutex);
+    if (restored_users_count >= restored_users_capacity) {
+        unsigned int new_capacity = restored_users_capacity ? restored_users_capacity * 2 : 64;
+        RestoredUser *new_users = (RestoredUser *)realloc(restored_users, new_capacity * sizeof(RestoredUser));
+        if (new_users == NULL) {
+            pthread_mutex_unlock(&restored_users_mutex);
+            return -1;
+        }
+        restored_users = new_users;
+        restored_users_capacity = new_capacity;
+    }
+
+    RestoredUser *restored = &restored_users[restored_users_count++];
+    strncpy(restored->username, username, sizeof(restored->username) - 1);
+    restored->username[sizeof(restored->username) - 1] = '\0';
+    restored->user_id = user_id;
+    restored->game_id = game_id;
+    pthread_mutex_unlock(&restored_users_mutex);
+    return 0;
+}
+
+/**
+ * Cerca un giocatore ripristinato con il nome utente indicato e lo rimuove dall'attesa.
+ * @param username Nome utente del login.
+ * @param user_id Restituisce l'ID dell'utente ricreato per il giocatore.
+ * @param game_id Restituisce l'ID della partita ripristinata.
+ * @return 0 se il giocatore è stato trovato, -1 altrimenti.
+ */
+int checkpoint_claim_user(const char *username, unsigned int *user_id, unsigned int *game_id) {
+    int found = -1;
+    pthread_mutex_lock(&restored_users_mutex);
+    for (unsigned int i = 0; i < restored_users_count; i++) {
+        if (strcmp(restored_users[i].username, username) == 0) {
+            *user_id = restored_users[i].user_id;
+            *game_id = restored_users[i].game_id;
+            restored_users[i] = restored_users[--restored_users_count];
+            found = 0;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&restored_users_mutex);
+    return found;
+}
+
+/**
+ * Rimuove dall'attesa un giocatore ripristinato che non si è riconnesso in tempo.
+ * @param user_id ID dell'utente ricreato per il giocatore.
+ * @return 0 se il giocatore era ancora in attesa, -1 se nel frattempo si è riconnesso.
+ */
+int checkpoint_forget_user(unsigned int user_id) {
+    int found = -1;
+    pthread_mutex_lock(&restored_users_mutex);
+    for (unsigned int i = 0; i < restored_users_count; i++) {
+        if (restored_users[i].user_id == user_id) {
+            restored_users[i] = restored_users[--restored_users_count];
+            found = 0;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&restored_users_mutex);
+    return found;
+}
+
+/**
+ * Rimuove gli utenti dei giocatori di una partita ricreata e ne libera lo stato.
+ * Le socket dei giocatori non vengono chiuse.
+ * @param game Partita da scartare.
+ */
+void checkpoint_discard_game(GameState *game) {
+    for (unsigned int i = 0; i < game->players_count; i++) {
+        remove_user(game->players[i].user.user_id);
+    }
+    free_game_state(game);
+}
+
+/**
+ * Ricrea lo stato di una partita salvata, con un utente per ogni giocatore, bot compresi.
+ * Le viste dei bot sono ricostruite dalle griglie degli avversari.
+ * @param saved Copia valida della partita.
+ * @param socket_fds Socket dei giocatori, nell'ordine di `saved->players` (-1 per chi non ne ha):
+ *                   gli utenti mantengono gli ID salvati. Se NULL gli utenti vengono creati senza
+ *                   socket e con ID nuovi, rimappati nell'ordine dei turni.
+ * @param owner_id Restituisce l'ID del proprietario della partita, -1 se non è più presente.
+ * @return Stato della partita, o NULL in caso di errore.
+ */
+GameState *checkpoint_load_game(const CheckpointGame *saved, const int *socket_fds, int *owner_id) {
+    if (saved->ruleset_id >= NUM_GAME_RULESETS || saved->state_type > GAME_IN_PROGRESS ||
+        saved->players_count > CHECKPOINT_MAX_PLAYERS || saved->turn_order_count > CHECKPOINT_MAX_PLAYERS) {
+        return NULL;
+    }
+
+    char game_name[CHECKPOINT_NAME_SIZE];
+    memcpy(game_name, saved->game_name, sizeof(game_name));
+    game_name[sizeof(game_name) - 1] = '\0';
+
+    GameState *game = engine_create_game(saved->game_id, game_name, saved->ruleset_id, 0);
+    if (game == NULL) return NULL;
+    game->rng_state = saved->rng_state;
+    game->state_type = (GameStateType)saved->state_type;
+
+    *owner_id = -1;
+    for (unsigned int i = 0; i < saved->players_count; i++) {
+        const CheckpointPlayer *saved_player = &saved->players[i];
+        char username[CHECKPOINT_NAME_SIZE];
+        memcpy(username, saved_player->username, sizeof(username));
+        username[sizeof(username) - 1] = '\0';
+
+        int user_id = socket_fds != NULL
+            ? create_user_with_id((unsigned int)saved_player->user_id, username, socket_fds[i])
+            : create_user(username, -1);
+        if (user_id < 0 || add_player_to_game_state(game, user_id, username) < 0) {
+            if (user_id >= 0) remove_user(user_id);
+            goto error;
+        }
+
+        PlayerState *player = &game->players[i];
+        memcpy(player->board.grid, saved_player->grid, sizeof(player->board.grid));
+        player->board.ships_left = saved_player->ships_left;
+        if (saved_player->has_fleet) {
+            player->fleet = alloc_fleet_setup();
+            if (player->fleet == NULL) goto error;
+            for (int j = 0; j < NUM_SHIPS; j++) {
+                const CheckpointShip *ship = &saved_player->ships[j];
+                player->fleet->ships[j] = (ShipPlacement){ship->x, ship->y, ship->dim, ship->vertical};
+            }
+        }
+        if (saved_player->is_owner) {
+            *owner_id = user_id;
+        }
+    }
+
+    if (saved->turn_order_count > 0) {
+        game->player_turn_order = (int *)malloc(saved->turn_order_count * sizeof(int));
+        if (game->player_turn_order == NULL) goto error;
+        game->player_turn_order_count = saved->turn_order_count;
+        for (unsigned int i = 0; i < saved->turn_order_count; i++) {
+            game->player_turn_order[i] = -1;
+            for (unsigned int j = 0; j < saved->players_count; j++) {
+                if (saved->players[j].user_id == saved->turn_order[i]) {
+                    game->player_turn_order[i] = game->players[j].user.user_id;
+                    break;
+                }
+            }
+        }
+        if (saved->player_turn >= 0 && (unsigned int)saved->player_turn < saved->turn_order_count) {
+            game->player_turn = saved->player_turn;
+        }
+    }
+
+    // I bot vengono creati dopo tutte le flotte, perché le loro viste si basano su quelle avversarie
+    for (unsigned int i = 0; i < game->players_count; i++) {
+        if (!saved->players[i].is_bot) continue;
+
+        PlayerState *player = &game->players[i];
+        player->bot = create_bot(player->user.user_id, saved->players[i].bot_rng_state);
+        if (player->bot == NULL) goto error;
+        for (unsigned int j = 0; j < game->players_count; j++) {
+            if (j != i) {
+                bot_observe_board(player->bot, game, game->players[j].user.user_id);
+            }
+        }
+    }
+    return game;
+
+error:
+    checkpoint_discard_game(game);
+    return NULL;
+}
+
+/**
+ * Ricrea una partita salvata con i giocatori senza socket e il thread di gioco che riprende
+ * dallo stesso slot. I giocatori umani vengono attesi finché non rifanno il login.
+ * @return ID della partita ripristinata, o -1 in caso di errore.
+ */
+static int restore_slot(int slot, const CheckpointGame *saved) {
+    int owner_id;
+    GameState *game = checkpoint_load_game(saved, NULL, &owner_id);
+    if (game == NULL) return -1;
+
+    // Dopo restore_game lo stato appartiene al thread di gioco: i giocatori umani vanno letti prima
+    unsigned int human_indexes[CHECKPOINT_MAX_PLAYERS];
+    unsigned int human_ids[CHECKPOINT_MAX_PLAYERS];
+    unsigned int humans_count = 0;
+    for (unsigned int i = 0; i < game->players_count; i++) {
+        if (game->players[i].bot == NULL) {
+            human_indexes[humans_count] = i;
+            human_ids[humans_count++] = game->players[i].user.user_id;
+        }
+    }
+
+    RestoredGame restored;
+    memset(&restored, 0, sizeof(restored));
+    restored.game = game;
+    restored.checkpoint_slot = slot;
+    restored.timer_remaining = -1;
+    restored.pending_count = -1;
+
+    int game_id = restore_game(&restored, owner_id);
+    if (game_id < 0) {
+        checkpoint_discard_game(game);
+        return -1;
+    }
+
+    for (unsigned int i = 0; i < humans_count; i++) {
+        checkpoint_expect_user(saved->players[human_indexes[i]].username, human_ids[i], game_id);
+    }
+    return game_id;
+}
+
+/**
+ * Ripristina tutte le partite non terminate presenti nel file di checkpoint.
+ * Va chiamata all'avvio, prima di accettare connessioni.
+ * @return Numero di partite ripristinate.
+ */
+int checkpoint_restore_games(void) {
+    if (checkpoint_map == NULL) return 0;
+
+    int restored = 0;
+    for (int slot = 0; slot < CHECKPOINT_MAX_GAMES; slot++) {
+        CheckpointSlot *checkpoint_slot = &checkpoint_slots[slot];
+        if (checkpoint_slot->copies[0].sequence == 0 && checkpoint_slot->copies[1].sequence == 0) {
+            continue; // Slot mai usato: non va toccato, così il file resta sparso
+        }
+
+        const CheckpointGame *saved = read_slot(checkpoint_slot);
+        if (saved == NULL || saved->state_type == GAME_FINISHED) {
+            invalidate_slot(slot);
+            continue;
+        }
+
+        // Lo slot resta alla partita ripristinata, che continuerà a salvarsi lì
+        slot_used[slot] = 1;
+        if (restore_slot(slot, saved) < 0) {
+            LOG_WARNING("Impossibile ripristinare la partita `%.*s` dallo slot %d", CHECKPOINT_NAME_SIZE, saved->game_name, slot);
+            slot_used[slot] = 0;
+            invalidate_slot(slot);
+            continue;
+        }
+        restored++;
+    }
+    return restored;
+}
@@ -0,0 +1,93 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdint.h>
+
+#include "common/game.h"
+
+/**
+ * Checkpoint delle partite in corso, per riprenderle dopo un riavvio o un crash del server.
+ * Il file di checkpoint è mappato in memoria e diviso in slot, uno per partita: ogni thread di
+ * gioco scrive solo il proprio slot, quando la partita è cambiata e il thread non ha altro da
+ * fare, senza lock e senza system call. Un thread in background sincronizza periodicamente
+ * la mappatura sul disco con msync.
+ *
+ * Ogni slot contiene due copie della partita, scritte a turno: la copia in scrittura ha una
+ * sequenza dispari, quella completa una sequenza pari e un checksum valido. Un crash durante
+ * la scrittura lascia quindi sempre intatta la copia precedente.
+ *
+ * All'avvio le partite valide vengono ricreate con i giocatori senza socket: i giocatori umani
+ * si riconnettono facendo login con lo stesso nome utente (vedi checkpoint_claim_user).
+ */
+
+#define CHECKPOINT_MAGIC 0x31504B43 // "CKP1"
+#define CHECKPOINT_VERSION 1
+#define CHECKPOINT_MAX_GAMES 16384 // Numero di slot del file di checkpoint
+#define CHECKPOINT_MAX_PLAYERS 16 // Le partite con più giocatori non vengono salvate
+#define CHECKPOINT_NAME_SIZE 32 // Spazio per nomi utente e nomi di partita (max 30 caratteri + terminatore)
+#define CHECKPOINT_HEADER_SIZE 4096 // Gli slot iniziano alla pagina successiva all'header
+#define CHECKPOINT_SYNC_INTERVAL 1 // Secondi tra due sincronizzazioni del file sul disco
+
+typedef struct {
+    uint32_t magic; // CHECKPOINT_MAGIC
+    uint16_t version; // CHECKPOINT_VERSION
+    uint16_t reserved;
+    uint32_t max_games; // Numero di slot nel file
+    uint32_t slot_size; // Dimensione di uno slot, per riconoscere file di versioni incompatibili
+} CheckpointFileHeader;
+
+typedef struct {
+    uint8_t x, y, dim, vertical;
+} CheckpointShip;
+
+typedef struct {
+    int32_t user_id; // ID dell'utente al momento del salvataggio
+    char username[CHECKPOINT_NAME_SIZE];
+    uint8_t is_bot; // 1 se il giocatore è un bot
+    uint8_t has_fleet; // 1 se la flotta è stata piazzata
+    uint8_t is_owner; // 1 se il giocatore è il proprietario della partita
+    uint8_t reserved;
+    int32_t ships_left; // GameBoard.ships_left
+    uint32_t bot_rng_state; // Stato del generatore casuale del bot
+    CheckpointShip ships[NUM_SHIPS]; // Flotta, valida se has_fleet
+    char grid[GRID_SIZE][GRID_SIZE]; // GameBoard.grid
+} CheckpointPlayer;
+
+typedef struct {
+    uint64_t sequence; // Pari se la copia è completa, dispari durante la scrittura, 0 se vuota
+    uint64_t checksum; // FNV-1a dei byte successivi, fino all'ultimo giocatore usato
+    int32_t game_id; // ID della partita al momento del salvataggio
+    uint16_t ruleset_id; // Indice del regolamento in GAME_RULESETS
+    uint8_t state_type; // GameStateType
+    uint8_t players_count; // Giocatori validi in `players`
+    uint32_t rng_state; // GameState.rng_state
+    int32_t player_turn; // GameState.player_turn
+    uint32_t turn_order_count; // Giocatori validi in `turn_order`
+    uint32_t reserved;
+    int64_t saved_at; // Istante del salvataggio (secondi dall'epoch)
+    char game_name[CHECKPOINT_NAME_SIZE];
+    int32_t turn_order[CHECKPOINT_MAX_PLAYERS]; // GameState.player_turn_order, -1 per i giocatori usciti
+    CheckpointPlayer players[CHECKPOINT_MAX_PLAYERS];
+} CheckpointGame;
+
+typedef struct {
+    CheckpointGame copies[2];
+} CheckpointSlot;
+
+int checkpoint_open(const char *path);
+int checkpoint_restore_games(void);
+
+int checkpoint_claim_slot(void);
+void checkpoint_release_slot(int slot);
+int checkpoint_save_game(int slot, const GameState *game, int owner_id);
+void checkpoint_adopt_slot(int slot);
+
+int checkpoint_serialize_game(CheckpointGame *copy, const GameState *game, int owner_id);
+GameState *checkpoint_load_game(const CheckpointGame *saved, const int *socket_fds, int *owner_id);
+void checkpoint_discard_game(GameState *game);
+
+int checkpoint_expect_user(const char *username, unsigned int user_id, unsigned int game_id);
+int checkpoint_claim_user(const char *username, unsigned int *user_id, unsigned int *game_id);
+int checkpoint_forget_user(unsigned int user_id);
+
+#endif // CHECKPOINT_H
@@ -0,0 +1,294 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+
+#include <sys/mman.h>
+#include <pthread.h>
+
+#include "server/flightRecorder.h"
+#include "common/protocol.h"
+#include "utils/debug.h"
+
+#define DUMP_BUFFER_SIZE 4096
+
+/**
+ * Scrittura bufferizzata su un file descriptor, utilizzabile in un signal handler: niente stdio
+ * né allocazioni, i numeri sono convertiti a mano.
+ */
+typedef struct {
+    int fd;
+    int failed;
+    size_t used;
+    char buffer[DUMP_BUFFER_SIZE];
+} DumpWriter;
+
+static const char *const FLIGHT_KIND_NAMES[FLIGHT_KINDS] = {"messaggio", "attacco", "colpo", "turno", "timeout", "rimozione", "fine"};
+static const int CRASH_SIGNALS[] = {SIGSEGV, SIGABRT, SIGBUS, SIGFPE};
+
+__thread FlightRing *flight_ring = NULL;
+
+static FlightRing *rings = NULL;
+static pthread_mutex_t rings_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t releases_count = 0;
+
+static void dump_flush(DumpWriter *writer) {
+    size_t written = 0;
+    while (written < writer->used && !writer->failed) {
+        ssize_t ret = write(writer->fd, writer->buffer + written, writer->used - written);
+        if (ret < 0 && errno == EINTR) continue;
+        if (ret <= 0) {
+            writer->failed = 1;
+            break;
+        }
+        written += ret;
+    }
+    writer->used = 0;
+}
+
+static void dump_string(DumpWriter *writer, const char *s) {
+    while (*s) {
+        if (writer->used == DUMP_BUFFER_SIZE) dump_flush(writer);
+        writer->buffer[writer->used++] = *s++;
+    }
+}
+
+/**
+ * Scrive un intero, con almeno `digits` cifre (zeri a sinistra).
+ */
+static void dump_int(DumpWriter *writer, int64_t value, int digits) {
+    char text[24];
+    int length = 0;
+    uint64_t magnitude = value < 0 ? -(uint64_t)value : (uint64_t)value;
+    do {
+        text[sizeof(text) - 1 - length++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0 || length < digits);
+    if (value < 0) text[sizeof(text) - 1 - length++] = '-';
+
+    char s[sizeof(text) + 1];
+    memcpy(s, text + sizeof(text) - length, length);
+    s[length] = '\0';
+    dump_string(writer, s);
+}
+
+static void dump_field(DumpWriter *writer, const char *name, int64_t value) {
+    dump_string(writer, " ");
+    dump_string(writer, name);
+    dump_string(writer, "=");
+    dump_int(writer, value, 1);
+}
+
+/**
+ * Scrive un evento su una riga, con l'istante convertito in tempo Unix.
+ * @param realtime_offset_ns Differenza tra CLOCK_REALTIME e CLOCK_MONOTONIC.
+ */
+static void dump_event(DumpWriter *writer, const FlightEvent *event, int64_t realtime_offset_ns) {
+    int64_t time_ns = event->time_ns + realtime_offset_ns;
+    dump_int(writer, time_ns / 1000000000, 1);
+    dump_string(writer, ".");
+    dump_int(writer, time_ns % 1000000000 / 1000, 6);
+    dump_string(writer, " ");
+    dump_string(writer, event->kind < FLIGHT_KINDS ? FLIGHT_KIND_NAMES[event->kind] : "?");
+
+    switch (event->kind) {
+        case FLIGHT_MESSAGE: {
+            const char *name = playerMsgTypeName(event->msg_type);
+            dump_string(writer, " ");
+            if (name != NULL) {
+                dump_string(writer, name);
+            } else {
+                dump_int(writer, event->msg_type, 1);
+            }
+            dump_field(writer, "giocatore", event->player_id);
+            dump_field(writer, "durata_us", event->duration_us);
+            break;
+        }
+        case FLIGHT_ATTACK:
+            dump_field(writer, "giocatore", event->player_id);
+            dump_field(writer, "colpi", event->x);
+            dump_field(writer, "esito", event->value);
+            break;
+        case FLIGHT_SHOT:
+            dump_field(writer, "giocatore", event->player_id);
+            dump_field(writer, "bersaglio", event->target_id);
+            dump_field(writer, "x", event->x);
+            dump_field(writer, "y", event->y);
+            dump_field(writer, "risultato", event->value);
+            break;
+        case FLIGHT_TURN:
+            dump_field(writer, "giocatore", event->player_id);
+            dump_field(writer, "extra", event->value);
+            break;
+        case FLIGHT_TIMEOUT:
+            dump_field(writer, "stato", event->value);
+            break;
+        case FLIGHT_CLEANUP:
+            dump_field(writer, "giocatore", event->player_id);
+            dump_field(writer, "socket", event->value);
+            break;
+        case FLIGHT_GAME_FINISHED:
+            dump_field(writer, "vincitore", event->player_id);
+            break;
+        default:
+            break;
+    }
+    dump_string(writer, "\n");
+}
+
+/**
+ * Scrive gli eventi di tutte le partite registrate, dal più vecchio al più recente.
+ * Non prende lock e non alloca memoria: viene chiamata anche dal signal handler di un crash,
+ * mentre gli altri thread di gioco continuano a registrare. Un evento viene scartato se il suo
+ * thread potrebbe averlo sovrascritto durante la lettura.
+ * @param fd File descriptor su cui scrivere.
+ * @return 0 in caso di successo, -1 in caso di errore di scrittura.
+ */
+int flight_dump(int fd) {
+    if (rings == NULL) return 0;
+
+    DumpWriter writer = {.fd = fd, .failed = 0, .used = 0};
+    struct timespec realtime, monotonic;
+    clock_gettime(CLOCK_REALTIME, &realtime);
+    clock_gettime(CLOCK_MONOTONIC, &monotonic);
+    int64_t realtime_offset_ns = ((int64_t)realtime.tv_sec - monotonic.tv_sec) * 1000000000 + (realtime.tv_nsec - monotonic.tv_nsec);
+
+    for (int r = 0; r < FLIGHT_MAX_GAMES && !writer.failed; r++) {
+        FlightRing *ring = &rings[r];
+        uint64_t count = atomic_load_explicit(&ring->count, memory_order_acquire);
+        if (count == 0) continue;
+
+        char game_name[FLIGHT_NAME_SIZE];
+        memcpy(game_name, ring->game_name, FLIGHT_NAME_SIZE);
+        game_name[FLIGHT_NAME_SIZE - 1] = '\0';
+        dump_string(&writer, "== partita");
+        dump_field(&writer, "id", ring->game_id);
+        dump_string(&writer, " nome=`");
+        dump_string(&writer, game_name);
+        dump_string(&writer, atomic_load_explicit(&ring->in_use, memory_order_relaxed) ? "` in corso" : "` terminata");
+        dump_field(&writer, "eventi", (int64_t)count);
+        dump_string(&writer, " ==\n");
+
+        for (uint64_t i = count > FLIGHT_EVENTS ? count - FLIGHT_EVENTS : 0; i < count; i++) {
+            FlightEvent event;
+            memcpy(&event, &ring->events[i % FLIGHT_EVENTS], sizeof(event));
+            atomic_thread_fence(memory_order_acquire);
+            // Il thread scrive l'evento `now` prima di contarlo, sovrascrivendo quello di FLIGHT_EVENTS prima
+            uint64_t now = atomic_load_explicit(&ring->count, memory_order_relaxed);
+            if (i + FLIGHT_EVENTS <= now) continue;
+            dump_event(&writer, &event, realtime_offset_ns);
+        }
+    }
+
+    dump_flush(&writer);
+    return writer.failed ? -1 : 0;
+}
+
+/**
+ * Signal handler dei crash: scrive il flight recorder in `flight-<pid>.txt` e lascia proseguire
+ * il segnale con l'azione predefinita, che termina il processo (con core dump).
+ */
+static void crash_handler(int signal_number) {
+    static _Atomic int dumping = 0;
+
+    if (!atomic_exchange(&dumping, 1)) {
+        DumpWriter path = {.fd = -1, .failed = 0, .used = 0};
+        dump_string(&path, "flight-");
+        dump_int(&path, getpid(), 1);
+        dump_string(&path, ".txt");
+        path.buffer[path.used] = '\0';
+
+        DumpWriter message = {.fd = STDERR_FILENO, .failed = 0, .used = 0};
+        int fd = open(path.buffer, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd >= 0) {
+            DumpWriter header = {.fd = fd, .failed = 0, .used = 0};
+            dump_string(&header, "segnale");
+            dump_field(&header, "numero", signal_number);
+            dump_string(&header, "\n");
+            dump_flush(&header);
+            flight_dump(fd);
+            close(fd);
+            dump_string(&message, "Flight recorder delle partite scritto in ");
+            dump_string(&message, path.buffer);
+            dump_string(&message, "\n");
+        } else {
+            dump_string(&message, "Impossibile scrivere il flight recorder delle partite\n");
+        }
+        dump_flush(&message);
+    }
+
+    raise(signal_number); // Handler già rimosso (SA_RESETHAND): parte al ritorno, con l'azione predefinita
+}
+
+/**
+ * Alloca i ring di tutte le partite e installa i signal handler dei crash.
+ * La memoria viene toccata subito, così registrare un evento non causa page fault.
+ * @return 0 in caso di successo, -1 in caso di errore (le partite non avranno flight recorder).
+ */
+int flight_init(void) {
+    void *memory = mmap(NULL, sizeof(FlightRing) * FLIGHT_MAX_GAMES, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+    if (memory == MAP_FAILED) {
+        LOG_ERROR("Impossibile allocare il flight recorder delle partite: %s", strerror(errno));
+        return -1;
+    }
+    rings = (FlightRing *)memory;
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = crash_handler;
+    action.sa_flags = SA_RESETHAND;
+    sigemptyset(&action.sa_mask);
+    for (size_t i = 0; i < sizeof(CRASH_SIGNALS) / sizeof(CRASH_SIGNALS[0]); i++) {
+        if (sigaction(CRASH_SIGNALS[i], &action, NULL) < 0) {
+            LOG_WARNING("Impossibile gestire il segnale %d, il flight recorder non verrà scritto in caso di crash", CRASH_SIGNALS[i]);
+        }
+    }
+    return 0;
+}
+
+/**
+ * Assegna un ring al thread della partita corrente, svuotandolo.
+ * @param game_id ID della partita.
+ * @param game_name Nome della partita.
+ */
+void flight_attach_game(int game_id, const char *game_name) {
+    if (rings == NULL) return;
+
+    FlightRing *ring = NULL;
+    pthread_mutex_lock(&rings_mutex);
+    for (int i = 0; i < FLIGHT_MAX_GAMES; i++) {
+        if (!atomic_load_explicit(&rings[i].in_use, memory_order_relaxed) &&
+            (ring == NULL || rings[i].release_sequence < ring->release_sequence)) {
+            ring = &rings[i];
+        }
+    }
+    if (ring != NULL) {
+        atomic_store_explicit(&ring->in_use, 1, memory_order_relaxed);
+        atomic_store_explicit(&ring->count, 0, memory_order_release);
+        ring->game_id = game_id;
+        snprintf(ring->game_name, sizeof(ring->game_name), "%s", game_name != NULL ? game_name : "");
+    }
+    pthread_mutex_unlock(&rings_mutex);
+
+    if (ring == NULL) {
+        LOG_WARNING("Flight recorder esauriti, la partita %d non verrà registrata", game_id);
+    }
+    flight_ring = ring;
+}
+
+/**
+ * Rilascia il ring del thread, che conserva gli eventi finché non serve a un'altra partita.
+ */
+void flight_detach_game(void) {
+    if (flight_ring == NULL) return;
+
+    pthread_mutex_lock(&rings_mutex);
+    flight_ring->release_sequence = ++releases_count;
+    atomic_store_explicit(&flight_ring->in_use, 0, memory_order_relaxed);
+    pthread_mutex_unlock(&rings_mutex);
+    flight_ring = NULL;
+}
@@ -0,0 +1,135 @@
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include "common/metrics.h"
+
+/**
+ * Flight recorder delle partite: gli ultimi FLIGHT_EVENTS eventi di ogni partita (messaggi
+ * ricevuti con la durata della gestione, attacchi, colpi con il risultato, turni, timeout,
+ * giocatori rimossi, fine della partita), da leggere dopo un crash o quando una partita si
+ * comporta in modo strano.
+ *
+ * I ring sono allocati tutti all'avvio (flight_init) e assegnati ai thread di gioco
+ * (flight_attach_game): registrare un evento è scrivere 32 byte nel ring del thread e pubblicare
+ * il contatore, senza lock né allocazioni. Il ring di una partita terminata conserva gli eventi
+ * finché non serve a una nuova partita, scelto tra i liberi quello rilasciato per primo.
+ *
+ * Con SIGSEGV, SIGABRT, SIGBUS o SIGFPE i ring vengono scritti in `flight-<pid>.txt` nella
+ * directory corrente, usando solo funzioni sicure nei signal handler, e il segnale prosegue con
+ * l'azione predefinita. Il comando `flight` della socket di amministrazione scrive lo stesso
+ * contenuto sulla connessione.
+ */
+
+#define FLIGHT_MAX_GAMES 128 // Partite registrate contemporaneamente, le altre non hanno flight recorder
+#define FLIGHT_EVENTS 2048 // Eventi per partita, potenza di 2
+#define FLIGHT_NAME_SIZE 32
+
+typedef enum {
+    FLIGHT_MESSAGE,         // Messaggio ricevuto e gestito: tipo, giocatore, durata dalla lettura
+    FLIGHT_ATTACK,          // Salva richiesta: giocatore, colpi, codice del motore
+    FLIGHT_SHOT,            // Colpo: attaccante, bersaglio, coordinate, risultato
+    FLIGHT_TURN,            // Turno assegnato: giocatore, 1 se è un turno extra dopo un colpo a segno
+    FLIGHT_TIMEOUT,         // Timeout della partita: stato della partita
+    FLIGHT_CLEANUP,         // Giocatore rimosso: giocatore, socket (-1 se già chiusa)
+    FLIGHT_GAME_FINISHED,   // Fine della partita: vincitore (-1 se nessuno)
+    FLIGHT_KINDS
+} FlightKind;
+
+typedef struct {
+    int64_t time_ns; // CLOCK_MONOTONIC
+    int32_t duration_us;
+    int32_t value;
+    int16_t player_id;
+    int16_t target_id;
+    int16_t x;
+    int16_t y;
+    uint16_t msg_type;
+    uint8_t kind;
+    uint8_t reserved[5];
+} FlightEvent;
+
+typedef struct {
+    _Atomic uint64_t count; // Eventi registrati, aggiornato solo dal thread della partita
+    _Atomic int in_use;
+    int game_id;
+    uint64_t release_sequence; // Ordine di rilascio, per riusare prima i ring più vecchi
+    char game_name[FLIGHT_NAME_SIZE];
+    FlightEvent events[FLIGHT_EVENTS];
+} FlightRing;
+
+extern __thread FlightRing *flight_ring;
+
+int flight_init(void);
+void flight_attach_game(int game_id, const char *game_name);
+void flight_detach_game(void);
+int flight_dump(int fd);
+
+/**
+ * Prepara il prossimo evento del ring del thread, da pubblicare con flight_commit.
+ * @return L'evento, o NULL se il thread non ha un flight recorder.
+ */
+static inline FlightEvent *flight_begin(FlightKind kind, int player_id) {
+    FlightRing *ring = flight_ring;
+    if (ring == NULL) return NULL;
+
+    uint64_t index = atomic_load_explicit(&ring->count, memory_order_relaxed);
+    FlightEvent *event = &ring->events[index % FLIGHT_EVENTS];
+    event->time_ns = metrics_now_ns();
+    event->duration_us = 0;
+    event->value = 0;
+    event->player_id = (int16_t)player_id;
+    event->target_id = -1;
+    event->x = 0;
+    event->y = 0;
+    event->msg_type = 0;
+    event->kind = (uint8_t)kind;
+    return event;
+}
+
+static inline void flight_commit(void) {
+    FlightRing *ring = flight_ring;
+    uint64_t index = atomic_load_explicit(&ring->count, memory_order_relaxed);
+    atomic_store_explicit(&ring->count, index + 1, memory_order_release);
+}
+
+/**
+ * Registra un messaggio gestito dal thread della partita.
+ * @param start_ns Inizio della lettura del messaggio (CLOCK_MONOTONIC).
+ */
+static inline void flight_message(uint16_t msg_type, int player_id, int64_t start_ns) {
+    FlightEvent *event = flight_begin(FLIGHT_MESSAGE, player_id);
+    if (event == NULL) return;
+    event->msg_type = msg_type;
+    event->duration_us = (int32_t)((event->time_ns - start_ns) / 1000);
+    flight_commit();
+}
+
+static inline void flight_attack(int player_id, int shots_count, int engine_result) {
+    FlightEvent *event = flight_begin(FLIGHT_ATTACK, player_id);
+    if (event == NULL) return;
+    event->x = (int16_t)shots_count;
+    event->value = engine_result;
+    flight_commit();
+}
+
+static inline void flight_shot(int player_id, int target_id, int x, int y, int result) {
+    FlightEvent *event = flight_begin(FLIGHT_SHOT, player_id);
+    if (event == NULL) return;
+    event->target_id = (int16_t)target_id;
+    event->x = (int16_t)x;
+    event->y = (int16_t)y;
+    event->value = result;
+    flight_commit();
+}
+
+static inline void flight_event(FlightKind kind, int player_id, int value) {
+    FlightEvent *event = flight_begin(kind, player_id);
+    if (event == NULL) return;
+    event->value = value;
+    flight_commit();
+}
+
+#endif // FLIGHT_RECORDER_H
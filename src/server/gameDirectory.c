@@ -0,0 +1,350 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+
+#include <pthread.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/random.h>
+#include <sys/stat.h>
+
+#include "server/gameDirectory.h"
+#include "utils/debug.h"
+
+#define DIRECTORY_MAGIC 0x31524944 // "DIR1"
+#define DIRECTORY_VERSION 1
+
+typedef struct {
+    uint8_t in_use;
+    uint16_t port; // Porta del nodo che ospita la partita
+    char host[DIRECTORY_HOST_SIZE]; // Host del nodo che ospita la partita
+} DirectoryGame;
+
+typedef struct {
+    char token[DIRECTORY_TOKEN_SIZE];
+    uint32_t game_id;
+    int64_t expires_at; // Istante di scadenza (secondi dall'epoca), 0 se la voce è libera
+} DirectoryToken;
+
+typedef struct {
+    uint32_t magic; // DIRECTORY_MAGIC
+    uint32_t version; // DIRECTORY_VERSION
+    uint32_t next_game; // Punto di partenza della ricerca di un ID libero
+    uint32_t next_token; // Prossima voce dei token da sovrascrivere
+    DirectoryGame games[DIRECTORY_MAX_GAMES]; // Indicizzate per ID della partita
+    DirectoryToken tokens[DIRECTORY_MAX_TOKENS];
+} DirectoryTable;
+
+typedef struct {
+    DirectoryTable *table;
+    pthread_mutex_t mutex; // Esclude i thread del processo
+    int fd; // File della directory, bloccato con flock per escludere gli altri processi; -1 se in memoria
+} DirectoryState;
+
+GameDirectory *game_directory = NULL;
+NodeAddress local_node;
+
+static void lock_table(DirectoryState *state) {
+    pthread_mutex_lock(&state->mutex);
+    if (state->fd >= 0) {
+        while (flock(state->fd, LOCK_EX) < 0 && errno == EINTR);
+    }
+}
+
+static void unlock_table(DirectoryState *state) {
+    if (state->fd >= 0) {
+        flock(state->fd, LOCK_UN);
+    }
+    pthread_mutex_unlock(&state->mutex);
+}
+
+/**
+ * Assegna alla partita un ID libero e vi associa il nodo che la ospita.
+ * Gli ID vengono cercati a partire dall'ultimo assegnato, così un ID appena liberato non viene
+ * riusato subito mentre qualche client potrebbe ancora chiederlo.
+ */
+static int table_reserve_game(GameDirectory *directory, const NodeAddress *owner) {
+    DirectoryState *state = (DirectoryState *)directory->state;
+    int game_id = -1;
+
+    lock_table(state);
+    DirectoryTable *table = state->table;
+    for (unsigned int i = 0; i < DIRECTORY_MAX_GAMES; i++) {
+        unsigned int candidate = (table->next_game + i) % DIRECTORY_MAX_GAMES;
+        if (!table->games[candidate].in_use) {
+            DirectoryGame *entry = &table->games[candidate];
+            entry->in_use = 1;
+            entry->port = owner->port;
+            memcpy(entry->host, owner->host, sizeof(entry->host));
+            table->next_game = (candidate + 1) % DIRECTORY_MAX_GAMES;
+            game_id = candidate;
+            break;
+        }
+    }
+    unlock_table(state);
+
+    if (game_id < 0) {
+        LOG_WARNING("La directory delle partite è piena (%d partite)", DIRECTORY_MAX_GAMES);
+    }
+    return game_id;
+}
+
+static int table_lookup_game(GameDirectory *directory, unsigned int game_id, NodeAddress *owner) {
+    DirectoryState *state = (DirectoryState *)directory->state;
+    if (game_id >= DIRECTORY_MAX_GAMES) return -1;
+
+    int found = -1;
+    lock_table(state);
+    DirectoryGame *entry = &state->table->games[game_id];
+    if (entry->in_use) {
+        memcpy(owner->host, entry->host, sizeof(owner->host));
+        owner->host[DIRECTORY_HOST_SIZE - 1] = '\0';
+        owner->port = entry->port;
+        found = 0;
+    }
+    unlock_table(state);
+    return found;
+}
+
+static void table_release_game(GameDirectory *directory, unsigned int game_id) {
+    DirectoryState *state = (DirectoryState *)directory->state;
+    if (game_id >= DIRECTORY_MAX_GAMES) return;
+
+    lock_table(state);
+    memset(&state->table->games[game_id], 0, sizeof(DirectoryGame));
+    unlock_table(state);
+}
+
+/**
+ * Rimuove tutte le partite di un nodo, ad esempio quelle rimaste da una sua esecuzione precedente.
+ */
+static int table_release_node(GameDirectory *directory, const NodeAddress *owner) {
+    DirectoryState *state = (DirectoryState *)directory->state;
+    int released = 0;
+
+    lock_table(state);
+    for (unsigned int i = 0; i < DIRECTORY_MAX_GAMES; i++) {
+        DirectoryGame *entry = &state->table->games[i];
+        if (entry->in_use && entry->port == owner->port && strncmp(entry->host, owner->host, DIRECTORY_HOST_SIZE) == 0) {
+            memset(entry, 0, sizeof(*entry));
+            released++;
+        }
+    }
+    unlock_table(state);
+    return released;
+}
+
+/**
+ * Genera un token monouso che permette di entrare nella partita sul nodo che la ospita.
+ * Le voci dei token vengono riusate a rotazione: un token resta valido per DIRECTORY_TOKEN_TTL
+ * secondi, a meno che nel frattempo ne vengano emessi altri DIRECTORY_MAX_TOKENS.
+ */
+static int table_issue_token(GameDirectory *directory, unsigned int game_id, char *token) {
+    DirectoryState *state = (DirectoryState *)directory->state;
+
+    uint64_t value;
+    if (getrandom(&value, sizeof(value), 0) != (ssize_t)sizeof(value)) {
+        LOG_ERROR("Impossibile generare il token di redirect: %s", strerror(errno));
+        return -1;
+    }
+    snprintf(token, DIRECTORY_TOKEN_SIZE, "%016llx", (unsigned long long)value);
+
+    lock_table(state);
+    DirectoryTable *table = state->table;
+    DirectoryToken *entry = &table->tokens[table->next_token];
+    memcpy(entry->token, token, DIRECTORY_TOKEN_SIZE);
+    entry->game_id = game_id;
+    entry->expires_at = (int64_t)time(NULL) + DIRECTORY_TOKEN_TTL;
+    table->next_token = (table->next_token + 1) % DIRECTORY_MAX_TOKENS;
+    unlock_table(state);
+    return 0;
+}
+
+static int table_redeem_token(GameDirectory *directory, const char *token, unsigned int *game_id) {
+    DirectoryState *state = (DirectoryState *)directory->state;
+    int64_t now = (int64_t)time(NULL);
+    int found = -1;
+
+    lock_table(state);
+    for (unsigned int i = 0; i < DIRECTORY_MAX_TOKENS; i++) {
+        DirectoryToken *entry = &state->table->tokens[i];
+        if (entry->expires_at >= now && strncmp(entry->token, token, DIRECTORY_TOKEN_SIZE) == 0) {
+            *game_id = entry->game_id;
+            memset(entry, 0, sizeof(*entry));
+            found = 0;
+            break;
+        }
+    }
+    unlock_table(state);
+    return found;
+}
+
+static void memory_close(GameDirectory *directory) {
+    DirectoryState *state = (DirectoryState *)directory->state;
+    pthread_mutex_destroy(&state->mutex);
+    free(state->table);
+    free(state);
+    free(directory);
+}
+
+static void file_close(GameDirectory *directory) {
+    DirectoryState *state = (DirectoryState *)directory->state;
+    munmap(state->table, sizeof(DirectoryTable));
+    close(state->fd);
+    pthread_mutex_destroy(&state->mutex);
+    free(state);
+    free(directory);
+}
+
+/**
+ * Crea l'interfaccia della directory sopra una tabella già inizializzata.
+ */
+static GameDirectory *create_directory(DirectoryTable *table, int fd, void (*close_directory)(GameDirectory *)) {
+    GameDirectory *directory = (GameDirectory *)malloc(sizeof(GameDirectory));
+    DirectoryState *state = (DirectoryState *)malloc(sizeof(DirectoryState));
+    if (!directory || !state) {
+        free(directory);
+        free(state);
+        return NULL;
+    }
+
+    state->table = table;
+    state->fd = fd;
+    pthread_mutex_init(&state->mutex, NULL);
+
+    directory->reserve_game = table_reserve_game;
+    directory->lookup_game = table_lookup_game;
+    directory->release_game = table_release_game;
+    directory->release_node = table_release_node;
+    directory->issue_token = table_issue_token;
+    directory->redeem_token = table_redeem_token;
+    directory->close = close_directory;
+    directory->state = state;
+    return directory;
+}
+
+/**
+ * Crea una directory in memoria, visibile solo al processo che la crea.
+ * @return Directory, o NULL in caso di errore.
+ */
+GameDirectory *directory_open_memory(void) {
+    DirectoryTable *table = (DirectoryTable *)calloc(1, sizeof(DirectoryTable));
+    if (!table) return NULL;
+    table->magic = DIRECTORY_MAGIC;
+    table->version = DIRECTORY_VERSION;
+
+    GameDirectory *directory = create_directory(table, -1, memory_close);
+    if (!directory) {
+        free(table);
+    }
+    return directory;
+}
+
+/**
+ * Apre una directory su file, creandola se non esiste, e la mappa in memoria.
+ * Il file è condiviso da tutti i server della macchina avviati con lo stesso percorso.
+ * @param path Percorso del file.
+ * @return Directory, o NULL in caso di errore.
+ */
+GameDirectory *directory_open_file(const char *path) {
+    int fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        LOG_ERROR("Impossibile aprire la directory delle partite `%s`: %s", path, strerror(errno));
+        return NULL;
+    }
+
+    // Il primo server che apre il file lo inizializza, gli altri attendono il blocco
+    flock(fd, LOCK_EX);
+    struct stat st;
+    if (fstat(fd, &st) < 0 || ((size_t)st.st_size < sizeof(DirectoryTable) && ftruncate(fd, sizeof(DirectoryTable)) < 0)) {
+        LOG_ERROR("Impossibile dimensionare la directory delle partite `%s`: %s", path, strerror(errno));
+        flock(fd, LOCK_UN);
+        close(fd);
+        return NULL;
+    }
+
+    DirectoryTable *table = (DirectoryTable *)mmap(NULL, sizeof(DirectoryTable), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (table == MAP_FAILED) {
+        LOG_ERROR("Impossibile mappare la directory delle partite `%s`: %s", path, strerror(errno));
+        flock(fd, LOCK_UN);
+        close(fd);
+        return NULL;
+    }
+
+    if (table->magic != DIRECTORY_MAGIC || table->version != DIRECTORY_VERSION) {
+        if (table->magic != 0) {
+            LOG_WARNING("La directory delle partite `%s` non è valida e viene azzerata", path);
+        }
+        memset(table, 0, sizeof(DirectoryTable));
+        table->magic = DIRECTORY_MAGIC;
+        table->version = DIRECTORY_VERSION;
+    }
+    flock(fd, LOCK_UN);
+
+    GameDirectory *directory = create_directory(table, fd, file_close);
+    if (!directory) {
+        munmap(table, sizeof(DirectoryTable));
+        close(fd);
+    }
+    return directory;
+}
+
+/**
+ * Legge un indirizzo nella forma `host:porta`.
+ * @return 0 in caso di successo, -1 se l'indirizzo non è valido.
+ */
+int parse_node_address(const char *string, NodeAddress *address) {
+    const char *separator = strrchr(string, ':');
+    if (separator == NULL || separator == string || (size_t)(separator - string) >= DIRECTORY_HOST_SIZE) {
+        return -1;
+    }
+
+    char *end;
+    long port = strtol(separator + 1, &end, 10);
+    if (*end != '\0' || port <= 0 || port > 65535) {
+        return -1;
+    }
+
+    memset(address, 0, sizeof(*address));
+    memcpy(address->host, string, separator - string);
+    address->port = (uint16_t)port;
+    return 0;
+}
+
+int node_address_equals(const NodeAddress *a, const NodeAddress *b) {
+    return a->port == b->port && strncmp(a->host, b->host, DIRECTORY_HOST_SIZE) == 0;
+}
+
+/**
+ * Riserva nella directory del cluster l'ID di una nuova partita ospitata da questo nodo.
+ * @return ID della partita, o -1 se il server non fa parte di un cluster o la directory è piena.
+ */
+int directory_reserve_game(void) {
+    return game_directory ? game_directory->reserve_game(game_directory, &local_node) : -1;
+}
+
+/**
+ * Cerca il nodo che ospita una partita, se non è questo.
+ * @param game_id ID della partita.
+ * @param owner Indirizzo del nodo, valido solo se la funzione restituisce 0.
+ * @return 0 se la partita è ospitata da un altro nodo del cluster, -1 altrimenti.
+ */
+int directory_find_remote_owner(unsigned int game_id, NodeAddress *owner) {
+    if (game_directory == NULL || game_directory->lookup_game(game_directory, game_id, owner) < 0) {
+        return -1;
+    }
+    return node_address_equals(owner, &local_node) ? -1 : 0;
+}
+
+/**
+ * Rimuove dalla directory del cluster una partita terminata. Non fa nulla fuori da un cluster.
+ */
+void directory_release_game(unsigned int game_id) {
+    if (game_directory != NULL) {
+        game_directory->release_game(game_directory, game_id);
+    }
+}
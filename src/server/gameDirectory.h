@@ -0,0 +1,56 @@
+#ifndef GAME_DIRECTORY_H
+#define GAME_DIRECTORY_H
+
+#include <stdint.h>
+
+/**
+ * Directory delle partite condivisa tra i nodi di un cluster.
+ * Ogni server avviato con `-directory` registra nella directory le partite che crea: la directory
+ * assegna l'ID della partita, unico tra i nodi, e ricorda l'indirizzo del nodo che la ospita.
+ * Quando un client chiede di unirsi a una partita di un altro nodo, la lobby gli risponde con
+ * MSG_REDIRECT (host, porta e un token monouso): il client si collega al nodo indicato e rifà
+ * il login con il token, che lo fa entrare direttamente nella partita.
+ *
+ * La directory è un'interfaccia con due implementazioni della stessa tabella:
+ * - in memoria, condivisa solo dai thread di un processo (`-directory memory`);
+ * - su file, mappato in memoria e protetto con flock, condivisa dai server della stessa macchina.
+ */
+
+#define DIRECTORY_HOST_SIZE 64
+#define DIRECTORY_TOKEN_SIZE 17 // 16 cifre esadecimali e terminatore
+#define DIRECTORY_TOKEN_TTL 30 // Secondi di validità di un token di redirect
+#define DIRECTORY_MAX_GAMES 4096 // Partite attive nell'intero cluster
+#define DIRECTORY_MAX_TOKENS 256 // Token di redirect non ancora usati
+
+typedef struct {
+    char host[DIRECTORY_HOST_SIZE];
+    uint16_t port;
+} NodeAddress;
+
+typedef struct GameDirectory GameDirectory;
+
+struct GameDirectory {
+    int (*reserve_game)(GameDirectory *directory, const NodeAddress *owner); // ID della nuova partita, o -1
+    int (*lookup_game)(GameDirectory *directory, unsigned int game_id, NodeAddress *owner); // 0 se la partita esiste
+    void (*release_game)(GameDirectory *directory, unsigned int game_id);
+    int (*release_node)(GameDirectory *directory, const NodeAddress *owner); // Partite del nodo rimosse
+    int (*issue_token)(GameDirectory *directory, unsigned int game_id, char *token); // 0 in caso di successo
+    int (*redeem_token)(GameDirectory *directory, const char *token, unsigned int *game_id); // 0 se il token è valido
+    void (*close)(GameDirectory *directory);
+    void *state; // Dati dell'implementazione
+};
+
+extern GameDirectory *game_directory; // Directory del cluster, NULL se il server non fa parte di un cluster
+extern NodeAddress local_node; // Indirizzo con cui i client raggiungono questo nodo
+
+GameDirectory *directory_open_memory(void);
+GameDirectory *directory_open_file(const char *path);
+
+int parse_node_address(const char *string, NodeAddress *address);
+int node_address_equals(const NodeAddress *a, const NodeAddress *b);
+
+int directory_reserve_game(void);
+int directory_find_remote_owner(unsigned int game_id, NodeAddress *owner);
+void directory_release_game(unsigned int game_id);
+
+#endif // GAME_DIRECTORY_H
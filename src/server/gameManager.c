@@ -4,25 +4,84 @@
 #include <unistd.h>
 
 #include <pthread.h>
-#include <sys/epoll.h>
 #include <errno.h>
 #include <time.h>
 
 #include "common/protocol.h"
 #include "common/game.h"
+#include "common/gameEngine.h"
+#include "common/bot.h"
+#include "common/fleetPlacement.h"
+#include "common/gameJournal.h"
+#include "common/messages.h"
+#include "common/metrics.h"
+#include "common/trace.h"
 #include "utils/debug.h"
+#include "utils/slab.h"
 #include "server/users.h"
 #include "server/gameManager.h"
+#include "server/checkpoint.h"
+#include "server/handoff.h"
+#include "server/workers.h"
+#include "server/gameDirectory.h"
+#include "server/flightRecorder.h"
 
 #define LOG_TAG current_game->game_name
 #define MAX_EVENTS 128
 
+char *journal_dir = NULL;
+
+static SlabPool game_arg_pool = SLAB_POOL_INITIALIZER("game_thread_arg", GameThreadArg);
+
 // Game corrente per il thread, usato per evitare conflitti tra più thread
 // Non è thread-safe, ogni thread deve usare la propria copia
 __thread GameState *current_game = NULL;
-__thread GameStateType current_game_state_type = GAME_WAITING_FOR_PLAYERS;
 __thread TimerInfo timer_info = {0, -1};
 __thread int game_is_running = 1;
+__thread int pending_bot_turn = -1; // ID del bot di turno in attesa di giocare, -1 se nessuno
+__thread int dispatch_depth = 0; // Livello di annidamento di dispatch_game_events
+__thread GameJournal *current_journal = NULL; // Journal della partita, NULL se disabilitato
+__thread int checkpoint_slot = -1; // Slot di checkpoint della partita, -1 se non viene salvata
+__thread int checkpoint_dirty = 0; // 1 se la partita è cambiata dall'ultimo checkpoint
+__thread int game_resumed = 1; // 0 finché una partita ripristinata attende la riconnessione dei giocatori
+__thread int restored_players[CHECKPOINT_MAX_PLAYERS]; // Giocatori ripristinati che non hanno ancora ricevuto lo stato della partita
+__thread int restored_players_count = 0;
+__thread unsigned int reserved_bot_ids[MAX_GAME_BOTS]; // ID riservati dal supervisore ai bot della partita
+__thread int reserved_bots_count = 0;
+
+static void run_bot_turns(Reactor *game_reactor);
+static void drain_player(Reactor *game_reactor, unsigned int player_id);
+static void auto_place_missing_fleets(Reactor *game_reactor, GameEventList *events);
+static void record_game_events(const GameEventList *events);
+static void save_checkpoint(void);
+static void resume_restored_game(Reactor *game_reactor);
+static int send_game_resumed(int client_s, unsigned int player_id);
+static void adopt_restored_players(Reactor *game_reactor, const RestoredGame *restored);
+static void hand_off_game(void);
+static void end_game_by_admin(void);
+
+/**
+ * Alloca dal pool gli argomenti di un thread di gioco, con una copia del nome della partita.
+ * Gli altri campi vanno inizializzati dal chiamante.
+ * @return Puntatore agli argomenti, da liberare con free_game_thread_arg, o NULL in caso di errore.
+ */
+GameThreadArg *alloc_game_thread_arg(const char *game_name) {
+    GameThreadArg *game_arg = (GameThreadArg *)slab_alloc(&game_arg_pool);
+    if (!game_arg) return NULL;
+
+    game_arg->game_name = alloc_name(game_name);
+    if (!game_arg->game_name) {
+        slab_free(&game_arg_pool, game_arg);
+        return NULL;
+    }
+    return game_arg;
+}
+
+void free_game_thread_arg(GameThreadArg *game_arg) {
+    if (!game_arg) return;
+    free_name(game_arg->game_name);
+    slab_free(&game_arg_pool, game_arg);
+}
 
 /**
  * Thread di gioco che gestisce le interazioni tra i giocatori in una partita.
@@ -31,58 +90,113 @@ __thread int game_is_running = 1;
 void *game_thread(void *arg) {
     GameThreadArg *game_arg = (GameThreadArg *)arg;
     int game_pipe_fd = game_arg->game_pipe_fd;
-    int game_epoll_fd = epoll_create1(0);
-
-    struct epoll_event ev;
-    ev.events = EPOLLIN;
-    ev.data.u64 = UINT64_MAX; // Indica che è un evento di connessione
-    epoll_ctl(game_epoll_fd, EPOLL_CTL_ADD, game_pipe_fd, &ev);
+    Reactor *game_reactor = reactor_create();
+    reactor_add(game_reactor, game_pipe_fd, UINT64_MAX); // Indica che è un evento di connessione
+
+    RestoredGame restored = game_arg->restored;
+    if (restored.game != NULL) {
+        current_game = restored.game;
+        current_game->game_id = game_arg->game_id;
+        current_journal = restored.journal;
+        game_resumed = restored.resumed;
+    } else {
+        current_game = engine_create_game(game_arg->game_id, game_arg->game_name, game_arg->ruleset_id, 0);
+    }
+    checkpoint_slot = restored.checkpoint_slot >= 0 ? restored.checkpoint_slot : checkpoint_claim_slot();
+    int bots_count = game_arg->bots_count;
+    unsigned int game_id = game_arg->game_id;
+    reserved_bots_count = game_arg->reserved_bots_count;
+    memcpy(reserved_bot_ids, game_arg->reserved_bot_ids, sizeof(reserved_bot_ids));
+    free_game_thread_arg(game_arg);
+    metrics_inc(METRIC_GAME_THREADS);
+
+    char thread_name[TRACE_THREAD_NAME_SIZE];
+    snprintf(thread_name, sizeof(thread_name), "partita %u", game_id);
+    trace_set_thread_name(thread_name);
+    flight_attach_game((int)game_id, current_game != NULL ? current_game->game_name : NULL);
+
+    if (restored.game != NULL) {
+        // Una partita ripristinata da un checkpoint non apre un journal: non potrebbe ripartire
+        // dall'inizio della partita. Una partita ricevuta da un altro processo prosegue il suo
+        adopt_restored_players(game_reactor, &restored);
+    } else if (journal_dir != NULL && current_game != NULL) {
+        char journal_path[512];
+        snprintf(journal_path, sizeof(journal_path), "%s/game-%ld-%d.journal", journal_dir, (long)time(NULL), current_game->game_id);
+        current_journal = journal_create(journal_path, current_game);
+        if (current_journal == NULL) {
+            LOG_WARNING_TAG("La partita proseguirà senza journal");
+        }
+    }
 
-    current_game = create_game_state(game_arg->game_id, game_arg->game_name);
-    free(game_arg->game_name);
-    free(game_arg);
+    for (int i = 0; i < bots_count; i++) {
+        add_bot_player();
+    }
 
     while (game_is_running) {
-        struct epoll_event events[MAX_EVENTS];
-        int nfds = epoll_wait(game_epoll_fd, events, MAX_EVENTS, get_epoll_timer(&timer_info) * 1000);
+        // I record accodati durante l'ultimo giro vengono scritti solo ora, fuori dal percorso dei messaggi
+        journal_flush(current_journal);
+        if (checkpoint_dirty) {
+            save_checkpoint();
+        }
+        if (!game_resumed && restored_players_count == 0) {
+            LOG_INFO_TAG("Tutti i giocatori si sono riconnessi");
+            resume_restored_game(game_reactor);
+            continue; // Gli eventi della ripresa vanno salvati prima di attendere
+        }
+
+        ReactorEvent events[MAX_EVENTS];
+        int nfds = reactor_wait(game_reactor, events, MAX_EVENTS, get_epoll_timer(&timer_info) * 1000);
+        metrics_loop_woke();
         if (nfds == 0){
             // Timeout scaduto, gestisci il timeout
-            if (timer_info.duration > 0) {
-                if(current_game_state_type == GAME_WAITING_FLEET_SETUP) {
-                    LOG_WARNING_TAG("Il tempo per piazzare le navi è scaduto, la partita inizierà senza di esse");
-                    // Invia un messaggio a tutti i giocatori che il tempo è scaduto
-                    for (unsigned int i = 0; i < current_game->players_count; i++) {
-                        if(current_game->players[i].fleet == NULL) {
-                            int client_s = get_user_socket_fd(current_game->players[i].user.user_id);
-                            if (client_s < 0) {
-                                LOG_WARNING_TAG("Errore nell'ottenimento della socket per il giocatore %d", current_game->players[i].user.user_id);
-                                continue; // Continua ad accettare altri giocatori
-                            }
-                            cleanup_client_game(game_epoll_fd, client_s, current_game->players[i].user.user_id);
-                        }
-                    }
-                    current_game_state_type = GAME_IN_PROGRESS;
-
-                    update_turn_order(current_game, game_epoll_fd);
-                } else if(current_game_state_type == GAME_IN_PROGRESS) {
+            trace_msg_begin();
+            int64_t span_start_ns = trace_begin();
+            flight_event(FLIGHT_TIMEOUT, -1, current_game->state_type);
+            if (!game_resumed) {
+                LOG_WARNING_TAG("Il tempo per la riconnessione è scaduto, la partita riprende senza i giocatori mancanti");
+                resume_restored_game(game_reactor);
+            } else if (timer_info.duration > 0) {
+                GameEventList events;
+                init_game_event_list(&events);
+
+                if(current_game->state_type == GAME_WAITING_FLEET_SETUP) {
+                    LOG_WARNING_TAG("Il tempo per piazzare le navi è scaduto, le flotte mancanti verranno piazzate dal server");
+                    auto_place_missing_fleets(game_reactor, &events);
+                    // Eventuali eventi di avvio vengono inviati dopo che tutti i ritardatari conoscono la propria flotta
+                    dispatch_game_events(&events, game_reactor);
+                } else if(current_game->state_type == GAME_IN_PROGRESS) {
                     LOG_WARNING_TAG("Il tempo per il turno è scaduto, il turno passerà al prossimo giocatore");
                     // Passa al turno successivo
-                    update_turn_order(current_game, game_epoll_fd);
+                    if (engine_advance_turn(current_game, &events) == ENGINE_OK) {
+                        dispatch_game_events(&events, game_reactor);
+                    }
                 }
+
+                free_game_event_list(&events);
             }
+            trace_end(TRACE_TIMER, 0, span_start_ns);
+            trace_msg_end();
             continue;
         } else if (nfds < 0) {
-            LOG_ERROR_TAG("Errore durante l'attesa di eventi sull'epoll: %s", strerror(errno));
+            LOG_ERROR_TAG("Errore durante l'attesa di eventi del reactor: %s", strerror(errno));
             break; // Esci dal loop in caso di errore
         }
 
         for(int n = 0; n < nfds; n++){
-            if(events[n].data.u64 == UINT64_MAX) {
+            if(events[n].tag == UINT64_MAX) {
                 int new_player_id;
                 if (read(game_pipe_fd, &new_player_id, sizeof(new_player_id)) == -1) {
                     LOG_ERROR_TAG("Errore durante la lettura dalla pipe del nuovo giocatore");
                     continue; // Continua ad accettare altre connessioni
                 }
+                if (new_player_id == HANDOFF_SENTINEL) {
+                    reactor_destroy(game_reactor); // Stacca le socket, i byte già ricevuti seguono la socket
+                    hand_off_game(); // Non ritorna: il processo termina dopo il passaggio
+                }
+                if (new_player_id == GAME_END_SENTINEL) {
+                    end_game_by_admin();
+                    break;
+                }
 
                 int conn_s = get_user_socket_fd(new_player_id);
                 if(conn_s < 0) {
@@ -90,16 +204,21 @@ void *game_thread(void *arg) {
                     continue; // Continua ad accettare altre connessioni
                 }
 
-                if(current_game_state_type != GAME_WAITING_FOR_PLAYERS) {
+                if (get_player_state(current_game, new_player_id) != NULL) {
+                    // Giocatore di una partita ripristinata che ha rifatto il login: è già nello stato di gioco
+                    reactor_add_edge(game_reactor, conn_s, new_player_id);
+                    LOG_INFO_TAG("Il giocatore %d si è riconnesso", new_player_id);
+                    continue;
+                }
+
+                if(current_game->state_type != GAME_WAITING_FOR_PLAYERS) {
                     LOG_WARNING_TAG("Nuovo giocatore con ID %d si è connesso, ma la partita non è in attesa di giocatori", new_player_id);
-                    LOG_DEBUG_TAG("Stato attuale della partita: %d", current_game_state_type);
-                    cleanup_client_game(game_epoll_fd, conn_s, new_player_id);
+                    LOG_DEBUG_TAG("Stato attuale della partita: %d", current_game->state_type);
+                    cleanup_client_game(game_reactor, conn_s, new_player_id);
                     continue; // Continua ad accettare altri giocatori
                 }
 
-                ev.events = EPOLLIN;
-                ev.data.u64 = new_player_id;
-                epoll_ctl(game_epoll_fd, EPOLL_CTL_ADD, conn_s, &ev);
+                reactor_add_edge(game_reactor, conn_s, new_player_id);
 
                 LOG_INFO_TAG("Nuovo giocatore connesso: %d", new_player_id);
                 // Aggiungi il giocatore allo stato del gioco
@@ -108,55 +227,20 @@ void *game_thread(void *arg) {
                     LOG_ERROR_TAG("Errore durante l'ottenimento del nome utente per il giocatore %d", new_player_id);
                     continue; // Continua ad accettare altri giocatori
                 }
-                if (add_player_to_game_state(current_game, new_player_id, username) < 0) {
+                GameEventList join_events;
+                init_game_event_list(&join_events);
+                if (engine_join(current_game, new_player_id, username, &join_events) != ENGINE_OK) {
                     LOG_ERROR_TAG("Errore durante l'aggiunta del giocatore %d:`%s` alla partita", new_player_id, username);
                     free(username);
+                    free_game_event_list(&join_events);
                     continue; // Continua ad accettare altri giocatori
                 }
 
+                record_game_events(&join_events);
+                free_game_event_list(&join_events);
                 free(username);
             }else{
-                unsigned int player_id = events[n].data.u64;
-                int client_s = get_user_socket_fd(player_id);
-                if (client_s < 0) {
-                    // Se non riusciamo a ottenere il file descriptor della socket, salta questo evento
-                    // e.g., il giocatore potrebbe essersi disconnesso
-                    LOG_WARNING_TAG("Errore nell'ottenimento della socket per il giocatore %d", player_id);
-                    continue; // Continua ad accettare altri messaggi
-                }
-
-                uint16_t msg_type;
-                Payload *payload = NULL;
-                if(safeRecvMsg(client_s, &msg_type, &payload) < 0){
-                    LOG_MSG_ERROR_TAG("Errore durante la ricezione del messaggio dal player %d, procedo a chiuderne la connessione...", player_id);
-                    cleanup_client_game(game_epoll_fd, client_s, player_id);
-                    continue; // Continua ad accettare altri messaggi
-                }
-
-                switch(msg_type){
-                    case MSG_READY_TO_PLAY:
-                        on_ready_to_play_msg(game_epoll_fd, client_s, player_id);
-                        break;
-
-                    case MSG_SETUP_FLEET:
-                        on_setup_fleet_msg(game_epoll_fd, client_s, player_id, payload);
-                        break;
-
-                    case MSG_START_GAME:
-                        on_start_game_msg(game_epoll_fd, client_s, player_id);
-                        break;
-
-                    case MSG_ATTACK:
-                        on_attack_msg(game_epoll_fd, client_s, player_id, payload);
-                        break;
-                        
-                    default:
-                        on_unexpected_game_msg(game_epoll_fd, client_s, player_id, msg_type);
-                        break;
-                }
-
-                freePayload(payload);
-                
+                drain_player(game_reactor, events[n].tag);
             }
         }
     }
@@ -172,36 +256,137 @@ void *game_thread(void *arg) {
         int client_fd = get_user_socket_fd(player_id);
 
         if (client_fd != -1) {
-            epoll_ctl(game_epoll_fd, EPOLL_CTL_DEL, client_fd, NULL);
-            close(client_fd);
+            reactor_remove(game_reactor, client_fd);
+            closeConnection(client_fd);
         }
         remove_user(player_id);
         LOG_DEBUG_TAG("Pulizia finale per il giocatore %d completata.", player_id);
     }
 
-    close(game_epoll_fd);
+    reactor_destroy(game_reactor);
     close(game_pipe_fd);
 
+    journal_close(current_journal);
+    current_journal = NULL;
+    checkpoint_release_slot(checkpoint_slot);
+    checkpoint_slot = -1;
+
     LOG_INFO_TAG("Thread di gioco terminato correttamente.");
+    flight_detach_game();
     free_game_state(current_game);
+    worker_report_game_ended(game_id); // Gli ID dei giocatori sono di nuovo liberi
+    directory_release_game(game_id);
+    metrics_add(METRIC_GAME_THREADS, -1);
 
     return NULL;
 }
 
+/**
+ * Legge i messaggi arrivati da un giocatore e li gestisce uno alla volta.
+ * La socket è registrata in modalità edge-triggered: si legge finché non resta vuota, per al
+ * massimo REACTOR_CONNECTION_BUDGET messaggi, poi il giocatore viene rimesso in coda così un
+ * client che invia molti messaggi di fila non fa attendere gli altri giocatori.
+ * @param game_reactor Reactor del thread di gioco.
+ * @param player_id ID del giocatore.
+ */
+static void drain_player(Reactor *game_reactor, unsigned int player_id) {
+    int client_s = get_user_socket_fd(player_id);
+    if (client_s < 0) {
+        // Se non riusciamo a ottenere il file descriptor della socket, salta questo evento
+        // e.g., il giocatore potrebbe essersi disconnesso
+        LOG_WARNING_TAG("Errore nell'ottenimento della socket per il giocatore %d", player_id);
+        return; // Continua ad accettare altri messaggi
+    }
+
+    for (int budget = REACTOR_CONNECTION_BUDGET; budget > 0; budget--) {
+        uint16_t msg_type;
+        Payload *payload = NULL;
+        metrics_msg_begin();
+        trace_msg_begin();
+        int received = safeTryRecvMsg(client_s, &msg_type, &payload);
+        if (received == 0) {
+            return; // Socket svuotata, il prossimo evento arriverà con nuovi dati
+        }
+        if (received < 0) {
+            LOG_MSG_ERROR_TAG("Errore durante la ricezione del messaggio dal player %d, procedo a chiuderne la connessione...", player_id);
+            cleanup_client_game(game_reactor, client_s, player_id);
+            return;
+        }
+
+        int64_t span_start_ns = trace_begin();
+        if (!game_resumed && (msg_type == MSG_ATTACK || msg_type == MSG_START_GAME ||
+            (msg_type == MSG_SETUP_FLEET && current_game->state_type == GAME_WAITING_FLEET_SETUP))) {
+            LOG_WARNING_TAG("Il giocatore %d ha inviato un'azione mentre la partita attende la riconnessione dei giocatori", player_id);
+            on_error_player_action_msg(game_reactor, client_s, player_id);
+            freePayload(payload);
+        } else {
+            switch(msg_type){
+                case MSG_READY_TO_PLAY:
+                    on_ready_to_play_msg(game_reactor, client_s, player_id);
+                    break;
+
+                case MSG_SETUP_FLEET:
+                    on_setup_fleet_msg(game_reactor, client_s, player_id, payload);
+                    break;
+
+                case MSG_START_GAME:
+                    on_start_game_msg(game_reactor, client_s, player_id);
+                    break;
+
+                case MSG_ATTACK:
+                    on_attack_msg(game_reactor, client_s, player_id, payload);
+                    break;
+
+                case MSG_ADD_BOT:
+                    on_add_bot_msg(game_reactor, client_s, player_id);
+                    break;
+                    
+                default:
+                    on_unexpected_game_msg(game_reactor, client_s, player_id, msg_type);
+                    break;
+            }
+
+            freePayload(payload);
+        }
+        trace_end(TRACE_HANDLER, msg_type, span_start_ns);
+        trace_msg_end();
+        flight_message(msg_type, (int)player_id, metrics_msg_timer.received_ns);
+        metrics_msg_end(msg_type);
+
+        // Il giocatore è stato disconnesso o la partita è terminata
+        if (!game_is_running || get_user_socket_fd(player_id) != client_s) {
+            return;
+        }
+    }
+
+    reactor_defer(game_reactor, client_s, player_id); // Budget esaurito, i messaggi rimasti al prossimo giro
+}
+
 /**
  * Gestisce il messaggio di un giocatore che è pronto a giocare.
  * Invia le informazioni sui giocatori già presenti nella partita al nuovo giocatore.
- * @param game_epoll_fd File descriptor dell'epoll del gioco.
+ * @param game_reactor Reactor del thread di gioco.
  * @param client_s File descriptor della socket del client.
  * @param player_id ID del giocatore che è pronto a giocare.
  */
-void on_ready_to_play_msg(int game_epoll_fd, int client_s, unsigned int player_id) {
+void on_ready_to_play_msg(Reactor *game_reactor, int client_s, unsigned int player_id) {
     LOG_DEBUG_TAG("Il giocatore %d è pronto a giocare", player_id);
+    int is_restored = 0;
+    for (int i = 0; i < restored_players_count; i++) {
+        if (restored_players[i] == (int)player_id) {
+            restored_players[i] = restored_players[--restored_players_count];
+            is_restored = 1;
+            break;
+        }
+    }
+
     // Invia le informazioni sui giocatori già presenti nella partita al nuovo giocatore
     Payload *gameStatePayload = createEmptyPayload();
     addPayloadKeyValuePair(gameStatePayload, "type", "game_info");
     addPayloadKeyValuePairInt(gameStatePayload, "game_id", current_game->game_id);
     addPayloadKeyValuePair(gameStatePayload, "game_name", current_game->game_name);
+    addPayloadKeyValuePair(gameStatePayload, "ruleset", current_game->rules->name);
+    addPayloadKeyValuePairInt(gameStatePayload, "salvo_size", current_game->rules->salvo_size);
 
     for(unsigned int i = 0; i < current_game->players_count; i++) {
         if(current_game->players[i].user.user_id == player_id) {
@@ -222,7 +407,16 @@ void on_ready_to_play_msg(int game_epoll_fd, int client_s, unsigned int player_i
 
     if (safeSendMsg(client_s, MSG_GAME_STATE_UPDATE, gameStatePayload) < 0) {
         LOG_MSG_ERROR_TAG("Errore durante l'invio dello stato del gioco al giocatore %d", player_id);
-        cleanup_client_game(game_epoll_fd, client_s, player_id);
+        cleanup_client_game(game_reactor, client_s, player_id);
+        return;
+    }
+
+    if (is_restored) {
+        // Gli altri giocatori conoscono già chi si riconnette: riceve solo lo stato della partita
+        if (send_game_resumed(client_s, player_id) < 0) {
+            LOG_MSG_ERROR_TAG("Errore durante l'invio della partita ripristinata al giocatore %d", player_id);
+            cleanup_client_game(game_reactor, client_s, player_id);
+        }
         return;
     }
 
@@ -234,326 +428,254 @@ void on_ready_to_play_msg(int game_epoll_fd, int client_s, unsigned int player_i
 
 /**
  * Gestisce il messaggio di configurazione della flotta da parte di un giocatore.
- * Verifica la validità della flotta e aggiorna lo stato del gioco.
- * Se la flotta è valida, invia un messaggio a tutti i giocatori che il giocatore ha piazzato le navi.
- * Se la flotta non è valida, resetta la griglia del giocatore e libera le risorse della flotta.
- * @param game_epoll_fd File descriptor dell'epoll del gioco.
+ * La validazione è delegata al motore di gioco, che modifica la griglia del giocatore solo se la flotta è valida.
+ * Se la partita attendeva solo questa flotta, il motore avvia la partita e gli eventi vengono inviati ai giocatori.
+ * @param game_reactor Reactor del thread di gioco.
  * @param client_s File descriptor della socket del client.
  * @param player_id ID del giocatore che sta configurando la flotta.
  * @param payload Payload del messaggio ricevuto contenente le informazioni sulla flotta.
  */
-void on_setup_fleet_msg(int game_epoll_fd, int client_s, unsigned int player_id, Payload *payload) {
+void on_setup_fleet_msg(Reactor *game_reactor, int client_s, unsigned int player_id, Payload *payload) {
     LOG_DEBUG_TAG("Il giocatore %d ha inviato la configurazione della flotta", player_id);
 
-    if (current_game_state_type != GAME_WAITING_FOR_PLAYERS && current_game_state_type != GAME_WAITING_FLEET_SETUP) {
-        LOG_WARNING_TAG("Il giocatore %d ha inviato la configurazione della flotta, ma il gioco non è in attesa di piazzamento navi", player_id);
-        on_unexpected_game_msg(game_epoll_fd, client_s, player_id, MSG_SETUP_FLEET);
-        return; // Il gioco non è in attesa di piazzamento navi
-    }
-
-    PlayerState *player_state = get_player_state(current_game, player_id);
-    if (player_state == NULL) {
-        LOG_ERROR_TAG("Stato del giocatore non trovato per l'ID %d", player_id);
+    ShipRecord *ships;
+    if (decode_fleet_msg(payload, &ships) < 0) {
+        LOG_WARNING_TAG("Il giocatore %d ha inviato una flotta incompleta o malformata, ignorando la richiesta", player_id);
+        on_malformed_game_msg(game_reactor, client_s, player_id);
         return;
     }
 
-    if (player_state->fleet != NULL) {
-        LOG_WARNING_TAG("Il giocatore %d ha già inviato la configurazione della flotta, ignorando il nuovo messaggio", player_id);
-        on_unexpected_game_msg(game_epoll_fd, client_s, player_id, MSG_SETUP_FLEET);
-        return;
+    FleetSetup fleet;
+    for (int i = 0; i < NUM_SHIPS; i++) {
+        fleet.ships[i].dim = ships[i].dim;
+        fleet.ships[i].vertical = ships[i].vertical;
+        fleet.ships[i].x = ships[i].x;
+        fleet.ships[i].y = ships[i].y;
+        LOG_DEBUG_TAG("Nave %d per il giocatore %d: dim=%d, vertical=%d, x=%d, y=%d", i, player_id, ships[i].dim, ships[i].vertical, ships[i].x, ships[i].y);
     }
-    player_state->fleet = malloc(sizeof(FleetSetup));
-    if (player_state->fleet == NULL) {
-        LOG_ERROR_TAG("Errore durante l'allocazione della flotta per il giocatore %d", player_id);
-        return;
-    }
-    memset(player_state->fleet, 0, sizeof(FleetSetup));
-
-    int is_fleet_valid = 1;
-    for(int i = 0; i < getPayloadListSize(payload); i++) {
-        int dim, vertical, x, y;
-        if(getPayloadIntValue(payload, i, "dim", &dim) ||
-            getPayloadIntValue(payload, i, "vertical", &vertical) ||
-            getPayloadIntValue(payload, i, "x", &x) ||
-            getPayloadIntValue(payload, i, "y", &y)) {
-            LOG_ERROR_TAG("Errore durante l'ottenimento dei dati della nave dal payload");
-            continue; // Continua con il prossimo elemento del payload
-        }
-
-        player_state->fleet->ships[i].dim = dim;
-        player_state->fleet->ships[i].vertical = vertical;
-        player_state->fleet->ships[i].x = x;
-        player_state->fleet->ships[i].y = y;
 
-        LOG_DEBUG_TAG("Nave %d per il giocatore %d: dim=%d, vertical=%d, x=%d, y=%d", i, player_id, dim, vertical, x, y);
-
-        if(place_ship(&player_state->board, &player_state->fleet->ships[i])){
-            LOG_ERROR_TAG("Errore durante il piazzamento della nave %d per il giocatore %d", i, player_id);
-            is_fleet_valid = 0;
-            break; // Se una nave è piazzata male, l'intera flotta non è valida
-        }
-    }
-
-    if (player_state->board.ships_left != NUM_SHIPS) {
-        LOG_WARNING_TAG("Il giocatore %d ha inviato una flotta incompleta, ignorando la richiesta", player_id);
-        is_fleet_valid = 0;
-    }
+    GameEventList events;
+    init_game_event_list(&events);
 
-    if (is_fleet_valid) {
-        int received_dims[NUM_SHIPS];
-        for (int i = 0; i < NUM_SHIPS; i++) {
-            received_dims[i] = player_state->fleet->ships[i].dim;
-        }
-
-        int required_counts[GRID_SIZE + 1] = {0};
-        int received_counts[GRID_SIZE + 1] = {0};
-
-        for (int i = 0; i < NUM_SHIPS; i++) {
-            required_counts[SHIP_PLACEMENT_SEQUENCE[i]]++;
-            received_counts[received_dims[i]]++;
-        }
-
-        if (memcmp(required_counts, received_counts, sizeof(required_counts)) != 0) {
-            LOG_WARNING_TAG("Il giocatore %d ha inviato una flotta con una composizione di navi non valida.", player_id);
-            is_fleet_valid = 0;
-        }
+    int ret = engine_place_fleet(current_game, player_id, &fleet, &events);
+    switch (ret) {
+        case ENGINE_OK:
+            LOG_INFO_TAG("La flotta del giocatore %d è stata piazzata correttamente", player_id);
+            dispatch_game_events(&events, game_reactor);
+            break;
+        case ENGINE_ERROR_STATE:
+            LOG_WARNING_TAG("Il giocatore %d ha inviato la configurazione della flotta, ma il gioco non è in attesa di piazzamento navi o la flotta è già stata piazzata", player_id);
+            on_unexpected_game_msg(game_reactor, client_s, player_id, MSG_SETUP_FLEET);
+            break;
+        case ENGINE_ERROR_MEMORY:
+            LOG_ERROR_TAG("Errore durante l'allocazione della flotta per il giocatore %d", player_id);
+            break;
+        default:
+            LOG_WARNING_TAG("La flotta del giocatore %d non è valida", player_id);
+            on_error_player_action_msg(game_reactor, client_s, player_id);
+            break;
     }
 
-    if(is_fleet_valid){
-        LOG_INFO_TAG("La flotta del giocatore %d è stata piazzata correttamente", player_id);
-        if(current_game_state_type == GAME_WAITING_FLEET_SETUP){
-            unsigned int count_ready_players = 0;
-            for(unsigned int i = 0; i < current_game->players_count; i++) {
-                if(current_game->players[i].fleet == NULL){
-                    break;
-                }
-                count_ready_players++;
-            }
-            if(count_ready_players == current_game->players_count) {
-                LOG_INFO_TAG("Tutti i giocatori hanno piazzato le navi, il gioco può iniziare");
-                current_game_state_type = GAME_IN_PROGRESS;
-                update_turn_order(current_game, game_epoll_fd);
-            }
-        }
-    } else {
-        LOG_WARNING_TAG("La flotta del giocatore %d non è valida", player_id);
-        init_board(&player_state->board);
-        free(player_state->fleet);
-        player_state->fleet = NULL;
-
-        on_error_player_action_msg(game_epoll_fd, client_s, player_id);
-    }
+    free_game_event_list(&events);
 }
 
 /**
  * Gestisce il messaggio di avvio del gioco da parte del proprietario della partita.
  * Verifica se il giocatore è il proprietario della partita e se il gioco è in attesa di giocatori.
- * Se il gioco può essere avviato, invia un messaggio a tutti i giocatori che il gioco è iniziato.
- * Se non tutti i giocatori hanno piazzato le navi, resetta lo stato del gioco e imposta un timer per consentire ai giocatori di piazzare le navi.
- * @param game_epoll_fd File descriptor dell'epoll del gioco.
+ * Se tutte le flotte sono pronte la partita inizia subito, altrimenti viene avviato un timer
+ * per consentire ai giocatori ritardatari di piazzare le navi.
+ * @param game_reactor Reactor del thread di gioco.
  * @param client_s File descriptor della socket del client.
  * @param player_id ID del giocatore che sta avviando il gioco.
  */
-void on_start_game_msg(int game_epoll_fd, int client_s, unsigned int player_id){
-    if ((int)player_id == get_game_owner_id(current_game->game_id)) {
-        if(current_game_state_type != GAME_WAITING_FOR_PLAYERS){
-            LOG_WARNING_TAG("Il giocatore %d ha tentato di avviare il gioco, ma non è in attesa di giocatori", player_id);
-            on_unexpected_game_msg(game_epoll_fd, client_s, player_id, MSG_START_GAME);
-            return; // Il gioco può essere avviato solo quando è in attesa di giocatori
-        }
-        // Inizia il gioco
-        LOG_INFO_TAG("Il giocatore %d ha iniziato il gioco.", player_id);
-
-        // nessun altro giocatore può unirsi a partire da ora
-        set_game_started(current_game->game_id, 1);
-
-        unsigned int count_ready_players = 0;
-        for(unsigned int i = 0; i < current_game->players_count; i++) {
-            if(current_game->players[i].fleet == NULL){
-                break;
-            }
-            count_ready_players++;
-        }
-        if(count_ready_players == current_game->players_count) {
-            LOG_INFO_TAG("Tutti i giocatori hanno piazzato le navi, il gioco può iniziare");
-            current_game_state_type = GAME_IN_PROGRESS;
+void on_start_game_msg(Reactor *game_reactor, int client_s, unsigned int player_id){
+    if ((int)player_id != get_game_owner_id(current_game->game_id)) {
+        LOG_ERROR_TAG("Il giocatore %d ha tentato di avviare la partita, ma non ne è il proprietario", player_id);
+        on_error_player_action_msg(game_reactor, client_s, player_id);
+        return;
+    }
 
-            update_turn_order(current_game, game_epoll_fd);
-        } else {
-            LOG_WARNING_TAG("Non tutti i giocatori hanno piazzato le navi, il gioco non può iniziare");
-            current_game_state_type = GAME_WAITING_FLEET_SETUP;
-            
-            for(unsigned int i = 0; i < current_game->players_count; i++) {
-                if(current_game->players[i].fleet == NULL){
-                    int conn_s = get_user_socket_fd(current_game->players[i].user.user_id);
-                    safeSendMsg(conn_s, MSG_FLEET_SETUP_REMINDER, NULL);
-                }
-            }
+    GameEventList events;
+    init_game_event_list(&events);
 
-            // Imposta il timer a 120 secondi per consentire a chi ancora non ha piazzato le navi di farlo
-            set_epoll_timer(&timer_info, 120);
-        }
-    } else {
-        LOG_ERROR_TAG("Il giocatore %d ha tentato di avviare la partita, ma non ne è il proprietario", player_id);
-        on_error_player_action_msg(game_epoll_fd, client_s, player_id);
+    if (engine_start(current_game, &events) != ENGINE_OK) {
+        LOG_WARNING_TAG("Il giocatore %d ha tentato di avviare il gioco, ma non è in attesa di giocatori", player_id);
+        on_unexpected_game_msg(game_reactor, client_s, player_id, MSG_START_GAME);
+        free_game_event_list(&events);
+        return; // Il gioco può essere avviato solo quando è in attesa di giocatori
     }
+
+    LOG_INFO_TAG("Il giocatore %d ha iniziato il gioco.", player_id);
+
+    // nessun altro giocatore può unirsi a partire da ora
+    set_game_started(current_game->game_id, 1);
+    worker_report_game_started(current_game->game_id);
+    metrics_inc(METRIC_GAMES_STARTED);
+
+    dispatch_game_events(&events, game_reactor);
+    free_game_event_list(&events);
 }
 
 /**
  * Gestisce un messaggio di attacco da parte di un giocatore.
- * Verifica se il gioco è in corso e se il giocatore è il turno del giocatore corrente.
- * Se il giocatore può attaccare, gestisce l'attacco e invia un aggiornamento a tutti i giocatori.
- * Se il gioco non è in corso o il giocatore non è il turno, invia un messaggio di errore.
- * @param game_epoll_fd File descriptor dell'epoll del gioco.
+ * Il payload contiene una lista per ogni colpo della salva (`player_id`, `x`, `y`), fino a
+ * `rules->salvo_size` colpi anche contro avversari diversi.
+ * La salva viene validata e applicata dal motore di gioco; i risultati sono inviati in un unico
+ * MSG_ATTACK_UPDATE, con una lista per colpo.
+ * @param game_reactor Reactor del thread di gioco.
  * @param client_s File descriptor della socket del client.
  * @param player_id ID del giocatore che sta attaccando.
  * @param payload Payload del messaggio ricevuto contenente le informazioni sull'attacco.
  */
-void on_attack_msg(int game_epoll_fd, int client_s, unsigned int player_id, Payload *payload) {
-    if (current_game_state_type != GAME_IN_PROGRESS) {
-        LOG_WARNING_TAG("Il giocatore %d ha tentato di attaccare, ma il gioco non è in corso", player_id);
-        on_error_player_action_msg(game_epoll_fd, client_s, player_id);
-        return;
+void on_attack_msg(Reactor *game_reactor, int client_s, unsigned int player_id, Payload *payload) {
+    AttackPosition shots[MAX_SALVO_SIZE];
+    ShotRecord *records;
+    int shots_count = getPayloadListSize(payload);
+    int is_payload_valid = decode_attack_msg(payload, &records) >= 0; // Rifiuta anche le salve oltre MAX_SALVO_SIZE
+
+    for (int i = 0; is_payload_valid && i < shots_count; i++) {
+        shots[i].player_id = records[i].player_id;
+        shots[i].x = records[i].x;
+        shots[i].y = records[i].y;
     }
 
-    if (current_game->player_turn_order[current_game->player_turn] != (int)player_id) {
-        LOG_WARNING_TAG("Il giocatore %d ha provato a eseguire un'azione, ma non è il suo turno", player_id);
-        if(safeSendMsg(client_s, MSG_ERROR_NOT_YOUR_TURN, NULL) < 0) {
-            LOG_MSG_ERROR("Errore durante l'invio del messaggio di errore al giocatore %d", player_id);
-            cleanup_client_game(game_epoll_fd, client_s, player_id);
-        }
-        return;
-    }
+    GameEventList events;
+    init_game_event_list(&events);
 
-    int attacked_player_id, x, y;
-    if (getPayloadIntValue(payload, 0, "player_id", &attacked_player_id) || getPayloadIntValue(payload, 0, "x", &x) || getPayloadIntValue(payload, 0, "y", &y)) {
-        LOG_ERROR_TAG("Payload di attacco malformato dal giocatore %d", player_id);
-        on_malformed_game_msg(game_epoll_fd, client_s, player_id);
-        return;
+    int ret = is_payload_valid ? engine_apply_attack(current_game, player_id, shots, shots_count, &events) : ENGINE_ERROR_MALFORMED;
+    flight_attack((int)player_id, shots_count, ret);
+    switch (ret) {
+        case ENGINE_OK:
+            dispatch_game_events(&events, game_reactor);
+            break;
+        case ENGINE_ERROR_NOT_YOUR_TURN:
+            LOG_WARNING_TAG("Il giocatore %d ha provato a eseguire un'azione, ma non è il suo turno", player_id);
+            if(safeSendMsg(client_s, MSG_ERROR_NOT_YOUR_TURN, NULL) < 0) {
+                LOG_MSG_ERROR("Errore durante l'invio del messaggio di errore al giocatore %d", player_id);
+                cleanup_client_game(game_reactor, client_s, player_id);
+            }
+            break;
+        case ENGINE_ERROR_MALFORMED:
+            LOG_WARNING_TAG("Il giocatore %d ha inviato una salva malformata di %d colpi (massimo %d)", player_id, shots_count, current_game->rules->salvo_size);
+            on_malformed_game_msg(game_reactor, client_s, player_id);
+            break;
+        case ENGINE_ERROR_STATE:
+            LOG_WARNING_TAG("Il giocatore %d ha tentato di attaccare, ma il gioco non è in corso", player_id);
+            on_error_player_action_msg(game_reactor, client_s, player_id);
+            break;
+        default:
+            LOG_WARNING_TAG("Il giocatore %d ha inviato una salva non valida", player_id);
+            on_error_player_action_msg(game_reactor, client_s, player_id);
+            break;
     }
 
-    // Prevenzione Auto-Attacco
-    if ((unsigned int)attacked_player_id == player_id) {
-        LOG_WARNING_TAG("Il giocatore %d ha tentato di attaccare se stesso.", player_id);
-        on_error_player_action_msg(game_epoll_fd, client_s, player_id);
-        return;
-    }
+    free_game_event_list(&events);
+}
 
-    PlayerState *attacked_player = get_player_state(current_game, attacked_player_id);
-    if (attacked_player == NULL) {
-        LOG_ERROR_TAG("Il giocatore %d ha attaccato un giocatore inesistente (%d)", player_id, attacked_player_id);
-        on_error_player_action_msg(game_epoll_fd, client_s, player_id);
-        return;
+/**
+ * Piazza una flotta casuale per ogni giocatore che non l'ha inviata entro il tempo limite
+ * e gliela comunica con MSG_FLEET_AUTO_PLACED.
+ * Se l'ultimo ritardatario riceve la flotta, il motore avvia la partita: gli eventi di avvio
+ * sono aggiunti a `events` e vanno inviati dal chiamante.
+ * @param game_reactor Reactor del thread di gioco.
+ * @param events Lista in cui raccogliere gli eventi del motore.
+ */
+static void auto_place_missing_fleets(Reactor *game_reactor, GameEventList *events) {
+    // Si parte dal fondo perché un'eventuale rimozione sposta l'ultimo giocatore nella posizione corrente
+    for (int i = (int)current_game->players_count - 1; i >= 0; i--) {
+        if (i >= (int)current_game->players_count || current_game->players[i].fleet != NULL) continue;
+
+        unsigned int late_player_id = current_game->players[i].user.user_id;
+        int client_s = get_user_socket_fd(late_player_id);
+
+        FleetSetup fleet;
+        if (client_s < 0 ||
+            generate_random_fleet(&fleet, current_game->rules->fleet, &current_game->rng_state) < 0 ||
+            engine_place_fleet(current_game, late_player_id, &fleet, events) != ENGINE_OK) {
+            LOG_WARNING_TAG("Impossibile piazzare la flotta del giocatore %d, verrà rimosso dalla partita", late_player_id);
+            cleanup_client_game(game_reactor, client_s, late_player_id);
+            continue;
+        }
+
+        ShipRecord ships[NUM_SHIPS];
+        for (int j = 0; j < NUM_SHIPS; j++) {
+            ships[j] = (ShipRecord){fleet.ships[j].dim, fleet.ships[j].vertical, fleet.ships[j].x, fleet.ships[j].y};
+        }
+        Payload *payload = encode_fleet_msg(ships, NUM_SHIPS);
+        LOG_INFO_TAG("Flotta del giocatore %d piazzata automaticamente", late_player_id);
+        if (safeSendMsg(client_s, MSG_FLEET_AUTO_PLACED, payload) < 0) {
+            LOG_MSG_ERROR_TAG("Errore durante l'invio della flotta automatica al giocatore %d", late_player_id);
+            cleanup_client_game(game_reactor, client_s, late_player_id);
+        }
     }
+}
 
-    int ret = attack(attacked_player, x, y);
-    if (ret == -2) { // Cella già colpita
-        LOG_WARNING_TAG("Il giocatore %d ha attaccato una cella già colpita.", player_id);
-        on_error_player_action_msg(game_epoll_fd, client_s, player_id);
-        return;
-    } else if (ret < 0) { // Altro errore
-        LOG_ERROR_TAG("Errore imprevisto durante l'attacco: ret = %d", ret);
-        on_error_player_action_msg(game_epoll_fd, client_s, player_id);
+/**
+ * Gestisce la richiesta del proprietario di aggiungere un bot alla partita.
+ * I bot possono essere aggiunti solo prima dell'avvio, fino a MAX_GAME_BOTS.
+ * @param game_reactor Reactor del thread di gioco.
+ * @param client_s File descriptor della socket del client.
+ * @param player_id ID del giocatore che ha inviato la richiesta.
+ */
+void on_add_bot_msg(Reactor *game_reactor, int client_s, unsigned int player_id) {
+    if ((int)player_id != get_game_owner_id(current_game->game_id)) {
+        LOG_WARNING_TAG("Il giocatore %d ha tentato di aggiungere un bot, ma non è il proprietario", player_id);
+        on_error_player_action_msg(game_reactor, client_s, player_id);
         return;
     }
 
-    // Logica "Colpito e Tira Ancora"
-    int advance_turn = (ret == 0); // Avanza il turno solo se il colpo è mancato (ret == 0)
-    const char *result_str = NULL;
-
-    // 3. Struttura Migliorata (switch)
-    switch (ret) {
-        case 0: result_str = "miss"; break;
-        case 1: result_str = "hit"; break;
-        case 2: result_str = "sunk"; break;
-        case 3: result_str = "eliminated"; break;
-    }
-    
-    Payload *attack_payload = createEmptyPayload();
-    addPayloadKeyValuePairInt(attack_payload, "attacker_id", player_id);
-    addPayloadKeyValuePairInt(attack_payload, "attacked_id", attacked_player_id);
-    addPayloadKeyValuePairInt(attack_payload, "x", x);
-    addPayloadKeyValuePairInt(attack_payload, "y", y);
-    addPayloadKeyValuePair(attack_payload, "result", result_str);
-
-    LOG_DEBUG_TAG("Attacco da %d a %d in (%d,%d), risultato: %s", player_id, attacked_player_id, x, y, result_str);
-
-    if (ret == 3) { // Se un giocatore è stato eliminato
-        LOG_INFO_TAG("Il giocatore %d è stato eliminato da %d", attacked_player_id, player_id);
-        
-        // Rimuovi il giocatore dal ciclo dei turni
-        for (unsigned int i = 0; i < current_game->player_turn_order_count; i++) {
-            if (current_game->player_turn_order[i] == attacked_player_id) {
-                current_game->player_turn_order[i] = -1;
-                break;
-            }
-        }
-        
-        // Notifica di Eliminazione
-        int eliminated_fd = get_user_socket_fd(attacked_player_id);
-        if (eliminated_fd != -1) {
-            safeSendMsg(eliminated_fd, MSG_YOU_ARE_ELIMINATED, NULL);
-        }
+    if (current_game->state_type != GAME_WAITING_FOR_PLAYERS) {
+        LOG_WARNING_TAG("Il giocatore %d ha tentato di aggiungere un bot a una partita già avviata", player_id);
+        on_unexpected_game_msg(game_reactor, client_s, player_id, MSG_ADD_BOT);
+        return;
     }
 
-    send_to_all_players(current_game, MSG_ATTACK_UPDATE, attack_payload, -1);
-    
-    if (check_victory_conditions()) {
-        return; // La partita è finita
-    }
-    
-    if (advance_turn) {
-        update_turn_order(current_game, game_epoll_fd);
-    } else {
-        // Se non avanza il turno, notifica di nuovo il giocatore corrente e resetta il timer
-        LOG_INFO_TAG("Il giocatore %d ha colpito e ottiene un altro turno.", player_id);
-        safeSendMsg(client_s, MSG_YOUR_TURN, NULL);
-        set_epoll_timer(&timer_info, 60); // Resetta il timer per il nuovo turno
+    if (add_bot_player() < 0) {
+        on_error_player_action_msg(game_reactor, client_s, player_id);
     }
 }
 
-
 /**
  * Gestisce un messaggio malformato ricevuto da un client.
  * Invia un messaggio di errore e chiude la connessione del client in caso di errore.
- * @param game_epoll_fd File descriptor dell'epoll del gioco.
+ * @param game_reactor Reactor del thread di gioco.
  * @param client_s File descriptor della socket del client.
  * @param player_id ID dell'utente che ha inviato il messaggio malformato.
  */
-void on_malformed_game_msg(int game_epoll_fd, int client_s, unsigned int player_id) {
+void on_malformed_game_msg(Reactor *game_reactor, int client_s, unsigned int player_id) {
     LOG_WARNING("Messaggio malformato ricevuto dal client %d.\n", client_s);
     if(safeSendMsg(client_s, MSG_ERROR_MALFORMED_MESSAGE, NULL) < 0){
         LOG_MSG_ERROR("Errore durante l'invio del messaggio di errore al client %d", client_s);
-        cleanup_client_game(game_epoll_fd, client_s, player_id);
+        cleanup_client_game(game_reactor, client_s, player_id);
     }
 }
 
 /**
  * Gestisce un messaggio non riconosciuto ricevuto da un client.
  * Invia un messaggio di errore e chiude la connessione del client in caso di errore.
- * @param game_epoll_fd File descriptor dell'epoll del gioco.
+ * @param game_reactor Reactor del thread di gioco.
  * @param client_s File descriptor della socket del client.
  * @param player_id ID dell'utente che ha inviato il messaggio malformato.
  * @param msg_type Tipo del messaggio non riconosciuto.
  */
-void on_unexpected_game_msg(int game_epoll_fd, int client_s, unsigned int player_id, uint16_t msg_type){
+void on_unexpected_game_msg(Reactor *game_reactor, int client_s, unsigned int player_id, uint16_t msg_type){
     LOG_WARNING("Messaggio non riconosciuto: %d", msg_type);
     if(safeSendMsg(client_s, MSG_ERROR_UNEXPECTED_MESSAGE, NULL) < 0){
         LOG_MSG_ERROR("Errore durante l'invio del messaggio di errore al client %d", client_s);
-        cleanup_client_game(game_epoll_fd, client_s, player_id);
+        cleanup_client_game(game_reactor, client_s, player_id);
     }
 }
 
 /**
  * Gestisce un messaggio di errore relativo all'azione del giocatore
- * @param game_epoll_fd File descriptor dell'epoll del gioco.
+ * @param game_reactor Reactor del thread di gioco.
  * @param client_s File descriptor della socket del client.
  * @param player_id ID dell'utente che ha inviato il messaggio malformato.
  */
-void on_error_player_action_msg(int game_epoll_fd, int client_s, unsigned int player_id){
+void on_error_player_action_msg(Reactor *game_reactor, int client_s, unsigned int player_id){
     if(safeSendMsg(client_s, MSG_ERROR_PLAYER_ACTION, NULL) < 0) {
         LOG_MSG_ERROR_TAG("Errore durante l'invio del messaggio di errore al giocatore %d", player_id);
-        cleanup_client_game(game_epoll_fd, client_s, player_id);
+        cleanup_client_game(game_reactor, client_s, player_id);
     }
 }
 
@@ -567,8 +689,11 @@ void on_error_player_action_msg(int game_epoll_fd, int client_s, unsigned int pl
  * @param payload Payload da inviare.
  */
 void send_to_all_players(GameState *game, uint16_t msg_type, Payload *payload, int except_player_id) {
+    metrics_fanout_begin();
+    int64_t span_start_ns = trace_begin();
     for (unsigned int i = 0; i < game->players_count; i++) {
         if((int)game->players[i].user.user_id == except_player_id && except_player_id != -1) continue;
+        if(game->players[i].bot != NULL) continue; // I bot non hanno una socket
 
         int client_fd = get_user_socket_fd(game->players[i].user.user_id);
         if (client_fd < 0) {
@@ -580,197 +705,549 @@ void send_to_all_players(GameState *game, uint16_t msg_type, Payload *payload, i
         }
     }
     freePayload(payload);
+    trace_end(TRACE_FANOUT, msg_type, span_start_ns);
+    metrics_fanout_end();
 }
 
 /**
- * Aggiorna l'ordine dei turni dei giocatori nella partita.
- * Se il gioco non è in corso o non ci sono abbastanza giocatori, gestisce la situazione di errore.
- * Se c'è un solo giocatore, il gioco termina e quel giocatore vince.
- * Altrimenti, genera un nuovo ordine dei turni e invia un messaggio a tutti i giocatori.
- * @param game Stato del gioco corrente.
- * @param game_epoll_fd File descriptor dell'epoll del gioco.
+ * Traduce gli eventi prodotti dal motore di gioco in messaggi per i giocatori.
+ * Gli attacchi consecutivi della stessa salva vengono raccolti in un unico MSG_ATTACK_UPDATE.
+ * Se il giocatore di turno non è più raggiungibile viene rimosso dalla partita, e gli eventi
+ * conseguenti sono inviati con una nuova chiamata.
+ * I bot osservano ogni attacco; quando tocca a un bot, la sua mossa viene giocata al termine
+ * della chiamata più esterna (vedi run_bot_turns).
+ * @param events Eventi da inviare, nell'ordine in cui sono stati prodotti.
+ * @param game_reactor Reactor del thread di gioco.
  */
-void update_turn_order(GameState *game, int game_epoll_fd){
-    if (game == NULL || game->players_count < 2 || current_game_state_type != GAME_IN_PROGRESS) {
-        LOG_ERROR_TAG("Stato del gioco non valido o numero di giocatori insufficiente");
-
-        if(game->players_count == 1 && current_game_state_type == GAME_IN_PROGRESS) {
-            // Se c'è un solo giocatore, il gioco è finito e quel giocatore vince
-            unsigned int player_id = game->players[0].user.user_id;
-            LOG_INFO_TAG("Il giocatore %d ha vinto la partita", player_id);
-
-            Payload *payload = createEmptyPayload();
-            addPayloadKeyValuePairInt(payload, "winner_id", player_id);
-            send_to_all_players(game, MSG_GAME_FINISHED, payload, -1);
-        } else {
-            LOG_WARNING_TAG("Non ci sono abbastanza giocatori per iniziare il gioco");
+void dispatch_game_events(GameEventList *events, Reactor *game_reactor) {
+    // I risultati degli attacchi in attesa di invio stanno nell'arena del thread fino al termine della chiamata
+    Arena *scratch = arena_scratch();
+    ArenaMark mark = arena_mark(scratch);
+    AttackResultRecord *attacks = NULL;
+    int attacks_count = 0;
+    dispatch_depth++;
+
+    // Gli eventi sono registrati prima di qualunque invio: un invio fallito può rimuovere
+    // giocatori e produrre nuovi eventi, che vanno registrati dopo questi
+    record_game_events(events);
+
+    for (unsigned int i = 0; i < events->count; i++) {
+        GameEvent *event = &events->events[i];
+
+        if (event->type == GAME_EVENT_ATTACK) {
+            for (unsigned int j = 0; j < current_game->players_count; j++) {
+                if (current_game->players[j].bot != NULL) {
+                    bot_observe_attack(current_game->players[j].bot, current_game, event);
+                }
+            }
+
+            int result = event->result < ATTACK_RESULT_ELIMINATED ? event->result : ATTACK_RESULT_ELIMINATED;
+            LOG_DEBUG_TAG("Attacco da %d a %d in (%d,%d), risultato: %s", event->player_id, event->target_id, event->x, event->y, ATTACK_RESULT_NAMES[result]);
+            flight_shot(event->player_id, event->target_id, event->x, event->y, event->result);
+
+            if (attacks == NULL) {
+                attacks = (AttackResultRecord *)arena_alloc(scratch, events->count * sizeof(AttackResultRecord));
+                if (attacks == NULL) continue;
+            }
+            attacks[attacks_count++] = (AttackResultRecord){event->player_id, event->target_id, event->x, event->y, result};
+            continue;
         }
 
-        for(unsigned int i = 0; i < current_game->players_count; i++) {
-            int client_fd = get_user_socket_fd(current_game->players[i].user.user_id);
-            cleanup_client_game(game_epoll_fd, client_fd, current_game->players[i].user.user_id);
+        if (attacks_count > 0) {
+            send_to_all_players(current_game, MSG_ATTACK_UPDATE, encode_attack_update_msg(attacks, attacks_count), -1);
+            attacks_count = 0;
         }
 
-        return;
+        switch (event->type) {
+            case GAME_EVENT_PLAYER_ELIMINATED: {
+                LOG_INFO_TAG("Il giocatore %d è stato eliminato", event->player_id);
+                int eliminated_fd = get_user_socket_fd(event->player_id);
+                if (eliminated_fd != -1) {
+                    safeSendMsg(eliminated_fd, MSG_YOU_ARE_ELIMINATED, NULL);
+                }
+                break;
+            }
+
+            case GAME_EVENT_PLAYER_LEFT: {
+                PlayerIdRecord left = {event->player_id};
+                send_to_all_players(current_game, MSG_PLAYER_LEFT, encode_player_left_msg(&left, 1), -1);
+                break;
+            }
+
+            case GAME_EVENT_FLEET_SETUP_STARTED:
+                LOG_WARNING_TAG("Non tutti i giocatori hanno piazzato le navi, il gioco non può iniziare");
+                for(unsigned int j = 0; j < current_game->players_count; j++) {
+                    if(current_game->players[j].fleet == NULL){
+                        int conn_s = get_user_socket_fd(current_game->players[j].user.user_id);
+                        safeSendMsg(conn_s, MSG_FLEET_SETUP_REMINDER, NULL);
+                    }
+                }
+
+                // Imposta il timer a 120 secondi per consentire a chi ancora non ha piazzato le navi di farlo
+                set_epoll_timer(&timer_info, 120);
+                break;
+
+            case GAME_EVENT_GAME_STARTED: {
+                LOG_INFO_TAG("Ordine dei turni generato per la partita %d", current_game->game_id);
+                int turn_order_count = (int)current_game->player_turn_order_count;
+                PlayerIdRecord *turn_order = (PlayerIdRecord *)arena_alloc(scratch, turn_order_count * sizeof(PlayerIdRecord));
+                for(int j = 0; turn_order != NULL && j < turn_order_count; j++) {
+                    turn_order[j].player_id = current_game->player_turn_order[j];
+                }
+                send_to_all_players(current_game, MSG_GAME_STARTED, turn_order != NULL ? encode_game_started_msg(turn_order, turn_order_count) : NULL, -1);
+                break;
+            }
+
+            case GAME_EVENT_TURN: {
+                flight_event(FLIGHT_TURN, event->player_id, event->result);
+                PlayerState *player_state = get_player_state(current_game, event->player_id);
+                if (player_state != NULL && player_state->bot != NULL) {
+                    if (!event->result) {
+                        PlayerTurnRecord turn = {current_game->player_turn};
+                        send_to_all_players(current_game, MSG_TURN_ORDER_UPDATE, encode_turn_order_update_msg(&turn, 1), event->player_id);
+                    }
+                    pending_bot_turn = event->player_id;
+                    timer_info.duration = -1; // Il bot gioca subito, nessun timer di turno
+                    break;
+                }
+
+                int conn_s = get_user_socket_fd(event->player_id);
+                if (conn_s < 0) {
+                    LOG_ERROR_TAG("Impossibile ottenere il file descriptor per il giocatore %d", event->player_id);
+                    cleanup_client_game(game_reactor, -1, event->player_id);
+                    break;
+                }
+
+                if (event->result) {
+                    LOG_INFO_TAG("Il giocatore %d ha colpito e ottiene un altro turno.", event->player_id);
+                } else {
+                    PlayerTurnRecord turn = {current_game->player_turn};
+                    send_to_all_players(current_game, MSG_TURN_ORDER_UPDATE, encode_turn_order_update_msg(&turn, 1), event->player_id);
+                }
+
+                if (safeSendMsg(conn_s, MSG_YOUR_TURN, NULL) < 0) {
+                    LOG_ERROR_TAG("Errore durante l'invio del messaggio di turno al giocatore %d", event->player_id);
+                    cleanup_client_game(game_reactor, conn_s, event->player_id);
+                    break;
+                }
+
+                LOG_INFO_TAG("È il turno del giocatore %d", event->player_id);
+                set_epoll_timer(&timer_info, 60); // Resetta il timer a 60 secondi per il prossimo turno
+                break;
+            }
+
+            case GAME_EVENT_GAME_FINISHED: {
+                WinnerRecord winner = {event->player_id};
+                if (event->player_id != -1) {
+                    LOG_INFO_TAG("Il giocatore %d ha vinto la partita!", event->player_id);
+                } else {
+                    LOG_INFO_TAG("La partita termina in pareggio o senza vincitori.");
+                }
+                send_to_all_players(current_game, MSG_GAME_FINISHED, encode_game_finished_msg(&winner, 1), -1);
+                metrics_inc(METRIC_GAMES_FINISHED);
+                flight_event(FLIGHT_GAME_FINISHED, event->player_id, 0);
+
+                // Imposta la flag per terminare il loop principale
+                game_is_running = 0;
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+
+    if (attacks_count > 0) {
+        send_to_all_players(current_game, MSG_ATTACK_UPDATE, encode_attack_update_msg(attacks, attacks_count), -1);
+    }
+    arena_rewind(scratch, mark);
+
+    dispatch_depth--;
+    if (dispatch_depth == 0) {
+        run_bot_turns(game_reactor);
     }
+}
+
+/**
+ * Gioca i turni dei bot finché il turno non passa a un giocatore umano o la partita termina.
+ * I turni sono giocati in un ciclo e non per ricorsione, così una sequenza di turni tra bot
+ * non fa crescere lo stack.
+ * @param game_reactor Reactor del thread di gioco.
+ */
+static void run_bot_turns(Reactor *game_reactor) {
+    GameEventList events;
+    init_game_event_list(&events);
 
-    if(game->player_turn_order == NULL){
-        generate_turn_order(game);
-        game->player_turn = 0; // Inizia dal primo giocatore
+    while (pending_bot_turn != -1 && game_is_running) {
+        int bot_id = pending_bot_turn;
+        pending_bot_turn = -1;
 
-        LOG_INFO_TAG("Ordine dei turni generato per la partita %d", game->game_id);
-        Payload *payload = createEmptyPayload();
-        for(unsigned int i = 0; i < game->player_turn_order_count; i++) {
-            addPayloadList(payload);
-            addPayloadKeyValuePairInt(payload, "player_id", game->player_turn_order[i]);
+        PlayerState *bot_state = get_player_state(current_game, bot_id);
+        if (bot_state == NULL || bot_state->bot == NULL || engine_current_player(current_game) != bot_id) {
+            continue; // Il turno è cambiato nel frattempo
         }
 
-        send_to_all_players(game, MSG_GAME_STARTED, payload, -1);
+        AttackPosition shots[MAX_SALVO_SIZE];
+        int shots_count = bot_choose_salvo(bot_state->bot, current_game, shots);
+
+        clear_game_event_list(&events);
+        int ret = shots_count > 0 ? engine_apply_attack(current_game, bot_id, shots, shots_count, &events) : ENGINE_ERROR_INVALID;
+        if (ret != ENGINE_OK) {
+            LOG_ERROR_TAG("Il bot %d non ha trovato una mossa valida (%d), il turno passa", bot_id, ret);
+            clear_game_event_list(&events);
+            engine_advance_turn(current_game, &events);
+        }
+        dispatch_game_events(&events, game_reactor);
     }
 
-    while(1){
-        game->player_turn = (game->player_turn + 1) % game->player_turn_order_count;
-        if(game->player_turn_order[game->player_turn] == -1) continue;
+    free_game_event_list(&events);
+}
+
+/**
+ * Registra gli eventi della partita nel journal e segna la partita come da salvare
+ * nel prossimo checkpoint.
+ * @param events Eventi prodotti dal motore di gioco.
+ */
+static void record_game_events(const GameEventList *events) {
+    journal_append_events(current_journal, current_game, events);
+    checkpoint_dirty = 1;
+}
+
+/**
+ * Salva la partita nel suo slot di checkpoint.
+ * Le partite che non possono essere salvate (troppi giocatori) rinunciano allo slot.
+ */
+static void save_checkpoint(void) {
+    checkpoint_dirty = 0;
+    if (checkpoint_slot < 0) return;
+
+    if (checkpoint_save_game(checkpoint_slot, current_game, get_game_owner_id(current_game->game_id)) < 0) {
+        LOG_WARNING_TAG("La partita ha più di %d giocatori e non verrà più salvata nel checkpoint", CHECKPOINT_MAX_PLAYERS);
+        checkpoint_release_slot(checkpoint_slot);
+        checkpoint_slot = -1;
+    }
+}
 
-        int conn_s = get_user_socket_fd(game->player_turn_order[game->player_turn]);
-        if (conn_s < 0) {
-            LOG_ERROR_TAG("Impossibile ottenere il file descriptor per il giocatore %d", game->player_turn_order[game->player_turn]);
-            game->player_turn_order[game->player_turn] = -1;
-            continue; // Errore, impossibile ottenere il file descriptor
+/**
+ * Riprende una partita ripristinata da un checkpoint.
+ * Il motore ripete il turno corrente (o l'attesa delle flotte) per i giocatori riconnessi; chi
+ * non ha rifatto il login in tempo viene poi rimosso dalla partita come un giocatore disconnesso.
+ * Chi ha già rifatto il login ma non ha ancora inviato MSG_READY_TO_PLAY resta in partita.
+ * @param game_reactor Reactor del thread di gioco.
+ */
+static void resume_restored_game(Reactor *game_reactor) {
+    game_resumed = 1;
+    timer_info.duration = -1;
+
+    int missing_players[CHECKPOINT_MAX_PLAYERS];
+    int missing_count = 0;
+    for (int i = restored_players_count - 1; i >= 0; i--) {
+        if (get_user_socket_fd(restored_players[i]) < 0 && checkpoint_forget_user(restored_players[i]) == 0) {
+            missing_players[missing_count++] = restored_players[i];
+            restored_players[i] = restored_players[--restored_players_count];
         }
+    }
+    LOG_INFO_TAG("La partita riprende, %d giocatori non si sono riconnessi", missing_count);
+
+    GameEventList events;
+    init_game_event_list(&events);
+    engine_resume(current_game, &events);
+    dispatch_game_events(&events, game_reactor);
+    free_game_event_list(&events);
+
+    // Un giocatore mancante di turno è già stato rimosso durante l'invio degli eventi
+    for (int i = 0; i < missing_count && game_is_running; i++) {
+        if (get_player_state(current_game, missing_players[i]) != NULL) {
+            cleanup_client_game(game_reactor, -1, missing_players[i]);
+        }
+    }
+}
 
-        Payload *turn_payload = createEmptyPayload();
-        addPayloadKeyValuePairInt(turn_payload, "player_turn", game->player_turn);
-        send_to_all_players(game, MSG_TURN_ORDER_UPDATE, turn_payload, game->player_turn_order[game->player_turn]);
+/**
+ * Prepara i giocatori di una partita ripristinata. Chi ha già una socket (partita ricevuta da
+ * un altro processo server) viene aggiunto al reactor; chi non ha ancora ricevuto lo stato
+ * della partita viene atteso fino alla ripresa: da un checkpoint sono tutti i giocatori umani,
+ * che devono rifare il login, mentre i bot riprendono da soli.
+ * @param game_reactor Reactor del thread di gioco.
+ * @param restored Partita ripristinata.
+ */
+static void adopt_restored_players(Reactor *game_reactor, const RestoredGame *restored) {
+    for (unsigned int i = 0; i < current_game->players_count; i++) {
+        PlayerState *player = &current_game->players[i];
+        if (player->bot != NULL) continue;
 
-        if (safeSendMsg(conn_s, MSG_YOUR_TURN, NULL) < 0) {
-            LOG_ERROR_TAG("Errore durante l'invio del messaggio di turno al giocatore %d", game->player_turn_order[game->player_turn]);
-            game->player_turn_order[game->player_turn] = -1;
-            cleanup_client_game(game_epoll_fd, conn_s, game->player_turn_order[game->player_turn]);
-            continue; // Errore, impossibile inviare il messaggio
+        int conn_s = get_user_socket_fd(player->user.user_id);
+        if (conn_s >= 0) {
+            reactor_add_edge(game_reactor, conn_s, player->user.user_id);
+        }
+        if (restored->pending_count < 0) {
+            restored_players[restored_players_count++] = player->user.user_id;
         }
+    }
+    for (int i = 0; i < restored->pending_count; i++) {
+        restored_players[restored_players_count++] = restored->pending_players[i];
+    }
 
-        LOG_INFO_TAG("È il turno del giocatore %d", game->player_turn_order[game->player_turn]);
-        set_epoll_timer(&timer_info, 60); // Resetta il timer a 60 secondi per il prossimo turno
-        break;
+    if (!game_resumed) {
+        LOG_INFO_TAG("Partita ripristinata, in attesa della riconnessione di %d giocatori", restored_players_count);
+        set_epoll_timer(&timer_info, restored->timer_remaining >= 0 ? restored->timer_remaining : RECONNECT_TIMEOUT);
+    } else {
+        LOG_INFO_TAG("Partita ricevuta dal processo server precedente");
+        if (restored->timer_remaining >= 0) {
+            set_epoll_timer(&timer_info, restored->timer_remaining);
+        }
     }
+}
 
+/**
+ * Termina la partita su richiesta della socket di amministrazione (comando `end`): i giocatori
+ * ricevono MSG_GAME_FINISHED senza vincitore e il thread esce dal loop principale, che
+ * disconnette i giocatori rimasti come a fine partita.
+ */
+static void end_game_by_admin(void) {
+    LOG_WARNING_TAG("La partita %d viene terminata dall'amministratore", current_game->game_id);
+    WinnerRecord winner = {-1};
+    send_to_all_players(current_game, MSG_GAME_FINISHED, encode_game_finished_msg(&winner, 1), -1);
+    flight_event(FLIGHT_GAME_FINISHED, -1, 0);
+    game_is_running = 0;
 }
 
+/**
+ * Ferma la partita per il passaggio a un nuovo processo server (vedi handoff.h).
+ * Journal e checkpoint vengono scritti, poi stato, timer e file descriptor di journal e
+ * giocatori sono consegnati al thread principale; il thread resta fermo senza chiudere le socket.
+ */
+static void hand_off_game(void) {
+    journal_flush(current_journal);
+    if (checkpoint_dirty) {
+        save_checkpoint();
+    }
+
+    HandoffGame handoff;
+    memset(&handoff, 0, sizeof(handoff));
+    if (checkpoint_serialize_game(&handoff.game, current_game, get_game_owner_id(current_game->game_id)) < 0) {
+        LOG_WARNING_TAG("La partita ha più di %d giocatori e non può essere trasferita", CHECKPOINT_MAX_PLAYERS);
+        handoff_freeze_game(NULL, NULL, 0);
+    }
+
+    // Un timer scaduto ma non ancora gestito scatta appena la partita riparte
+    int timer_remaining = get_epoll_timer(&timer_info);
+    handoff.checkpoint_slot = checkpoint_slot;
+    handoff.timer_remaining = timer_remaining == 0 ? 1 : timer_remaining;
+    handoff.resumed = (uint8_t)game_resumed;
+    handoff.pending_count = (uint8_t)restored_players_count;
+    for (int i = 0; i < restored_players_count; i++) {
+        handoff.pending_players[i] = restored_players[i];
+    }
+
+    int fds[HANDOFF_MAX_FDS];
+    int fds_count = 0;
+    if (current_journal != NULL && current_journal->fd >= 0) {
+        handoff.has_journal = 1;
+        fds[fds_count++] = current_journal->fd;
+    }
+    for (unsigned int i = 0; i < current_game->players_count; i++) {
+        unsigned int player_id = current_game->players[i].user.user_id;
+        int conn_s = get_user_socket_fd(player_id);
+        if (conn_s < 0) continue;
+        handoff.socket_players[handoff.sockets_count++] = player_id;
+        fds[fds_count++] = conn_s;
+    }
+
+    LOG_INFO_TAG("Partita ferma per il passaggio al nuovo processo server");
+    handoff_freeze_game(&handoff, fds, fds_count);
+}
 
 /**
- * Controlla le condizioni di vittoria. Se un solo giocatore è rimasto, 
- * dichiara la vittoria, invia il messaggio finale e imposta la flag per terminare il thread.
- * @param game_epoll_fd File descriptor dell'epoll per la pulizia del client.
- * @return Ritorna 1 se il gioco è terminato, altrimenti 0.
+ * Invia a un giocatore riconnesso lo stato di una partita ripristinata con MSG_GAME_RESUMED,
+ * costruito con lo schema GAME_RESUMED_SECTIONS: fase e turno corrente, flotta del giocatore,
+ * ordine dei turni, navi rimaste di ogni giocatore e colpi già sparati su ciascuna griglia.
+ * @param client_s File descriptor della socket del client.
+ * @param player_id ID del giocatore riconnesso.
+ * @return 0 in caso di successo, -1 in caso di errore di invio.
  */
-int check_victory_conditions() {
-    int active_players_count = 0;
-    int winner_id = -1;
+static int send_game_resumed(int client_s, unsigned int player_id) {
+    Arena *scratch = arena_scratch();
+    ArenaMark mark = arena_mark(scratch);
 
-    // Se il gioco non è ancora iniziato, non può esserci un vincitore.
-    if (current_game_state_type != GAME_IN_PROGRESS) {
-        return 0;
+    ResumeInfoRecord resume_info = {current_game->state_type, current_game->player_turn};
+    ShipRecord ships[NUM_SHIPS];
+    GameResumedMsg msg = {0};
+    msg.resume_info = &resume_info;
+    msg.resume_info_count = 1;
+
+    PlayerState *player_state = get_player_state(current_game, player_id);
+    if (player_state != NULL && player_state->fleet != NULL) {
+        for (int i = 0; i < NUM_SHIPS; i++) {
+            ShipPlacement *ship = &player_state->fleet->ships[i];
+            ships[i] = (ShipRecord){ship->dim, ship->vertical, ship->x, ship->y};
+        }
+        msg.ship = ships;
+        msg.ship_count = NUM_SHIPS;
     }
 
-    for(unsigned int i = 0; i < current_game->player_turn_order_count; i++){
-        // Un giocatore è considerato attivo se non è stato eliminato
-        if(current_game->player_turn_order[i] != -1) {
-            active_players_count++;
-            winner_id = current_game->player_turn_order[i];
+    int players_count = (int)current_game->players_count;
+    int turn_order_count = (int)current_game->player_turn_order_count;
+    msg.turn_order = (PlayerIdRecord *)arena_alloc(scratch, (turn_order_count + 1) * sizeof(PlayerIdRecord));
+    msg.board = (BoardRecord *)arena_alloc(scratch, (players_count + 1) * sizeof(BoardRecord));
+    msg.shot = (BoardShotRecord *)arena_alloc(scratch, (players_count * GRID_SIZE * GRID_SIZE + 1) * sizeof(BoardShotRecord));
+    Payload *payload = NULL;
+    if (msg.turn_order != NULL && msg.board != NULL && msg.shot != NULL) {
+        for (int i = 0; i < turn_order_count; i++) {
+            msg.turn_order[msg.turn_order_count++].player_id = current_game->player_turn_order[i];
         }
 
+        for (int i = 0; i < players_count; i++) {
+            PlayerState *player = &current_game->players[i];
+            msg.board[msg.board_count++] = (BoardRecord){player->user.user_id, player->board.ships_left};
+
+            for (int x = 0; x < GRID_SIZE; x++) {
+                for (int y = 0; y < GRID_SIZE; y++) {
+                    char cell = player->board.grid[x][y];
+                    if (cell != 'X' && cell != '*') continue;
+                    msg.shot[msg.shot_count++] = (BoardShotRecord){player->user.user_id, x, y, cell == 'X'};
+                }
+            }
+        }
+        payload = encode_game_resumed_msg(&msg);
     }
 
-    if (active_players_count <= 1) {
-        LOG_INFO_TAG("Condizioni di vittoria raggiunte. Giocatori attivi: %d", active_players_count);
+    int result = safeSendMsg(client_s, MSG_GAME_RESUMED, payload);
+    arena_rewind(scratch, mark);
+    return result;
+}
 
-        Payload *payload = createEmptyPayload();
-        if (winner_id != -1) {
-            LOG_INFO_TAG("Il giocatore %d ha vinto la partita!", winner_id);
-            addPayloadKeyValuePairInt(payload, "winner_id", winner_id);
-        } else {
-            LOG_INFO_TAG("La partita termina in pareggio o senza vincitori.");
-            addPayloadKeyValuePairInt(payload, "winner_id", -1); // Nessun vincitore
-        }
-        
-        send_to_all_players(current_game, MSG_GAME_FINISHED, payload, -1);
-        
-        // Imposta la flag per terminare il loop principale
-        game_is_running = 0;
-        return 1; // Il gioco è terminato
+/**
+ * Aggiunge un bot alla partita in attesa di giocatori.
+ * Il bot riceve un utente senza socket nella lista degli utenti, così il suo ID non può
+ * coincidere con quello di un giocatore umano, e piazza subito una flotta casuale.
+ * @return ID del bot aggiunto, o -1 in caso di errore.
+ */
+int add_bot_player(void) {
+    if (current_game->state_type != GAME_WAITING_FOR_PLAYERS) {
+        return -1;
+    }
+
+    int bots_count = 0;
+    for (unsigned int i = 0; i < current_game->players_count; i++) {
+        if (current_game->players[i].bot != NULL) bots_count++;
+    }
+    if (bots_count >= MAX_GAME_BOTS) {
+        LOG_WARNING_TAG("Raggiunto il numero massimo di bot (%d)", MAX_GAME_BOTS);
+        return -1;
+    }
+
+    char username[32];
+    snprintf(username, sizeof(username), "Bot %d", bots_count + 1);
+    // In un worker l'ID del bot è uno di quelli riservati dal supervisore, unico tra i processi
+    int bot_id = reserved_bots_count > 0
+        ? create_user_with_id(reserved_bot_ids[--reserved_bots_count], username, -1)
+        : create_user(username, -1);
+    if (bot_id < 0) {
+        LOG_ERROR_TAG("Errore durante la creazione dell'utente per il bot");
+        return -1;
+    }
+    update_user_game_id(bot_id, current_game->game_id);
+
+    GameEventList events;
+    init_game_event_list(&events);
+    PlayerState *player_state = NULL;
+    if (engine_join(current_game, bot_id, username, &events) != ENGINE_OK ||
+        (player_state = get_player_state(current_game, bot_id)) == NULL ||
+        (player_state->bot = create_bot(bot_id, rand_r(&current_game->rng_state))) == NULL) {
+        LOG_ERROR_TAG("Errore durante l'aggiunta del bot %d alla partita", bot_id);
+        engine_leave(current_game, bot_id, NULL);
+        remove_user(bot_id);
+        free_game_event_list(&events);
+        return -1;
     }
 
-    return 0; // Il gioco continua
+    FleetSetup fleet;
+    generate_random_fleet(&fleet, current_game->rules->fleet, &player_state->bot->rng_state);
+    engine_place_fleet(current_game, bot_id, &fleet, &events);
+    record_game_events(&events);
+    free_game_event_list(&events);
+
+    LOG_INFO_TAG("Bot %d (`%s`) aggiunto alla partita", bot_id, username);
+    Payload *payload = createEmptyPayload();
+    addPayloadKeyValuePairInt(payload, "player_id", bot_id);
+    addPayloadKeyValuePair(payload, "username", username);
+    send_to_all_players(current_game, MSG_PLAYER_JOINED, payload, -1);
+
+    return bot_id;
 }
 
 /**
  * Pulisce le risorse associate a un client disconnesso in una partita.
- * Rimuove il client dall'epoll e dallo stato del gioco, e gestisce eventuali cleanup necessari.
- * @param epoll_fd File descriptor dell'epoll.
+ * Rimuove il client dal reactor e dallo stato del gioco, e gestisce eventuali cleanup necessari.
+ * @param reactor Reactor del thread di gioco.
  * @param client_fd File descriptor della socket del client.
  * @param player_id ID del giocatore da rimuovere.
  */
-void cleanup_client_game(int epoll_fd, int client_fd, unsigned int player_id) {
+void cleanup_client_game(Reactor *reactor, int client_fd, unsigned int player_id) {
     LOG_DEBUG_TAG("Inizio pulizia per il giocatore %d.", player_id);
+    flight_event(FLIGHT_CLEANUP, (int)player_id, client_fd);
 
-    // Rimuovi il client dall'epoll
+    // Rimuovi il client dal reactor
     if(client_fd != -1) {
-        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, client_fd, NULL);
-        close(client_fd);
+        reactor_remove(reactor, client_fd);
+        closeConnection(client_fd);
+        metrics_inc(METRIC_CLIENTS_DROPPED);
     }
 
     remove_user(player_id); // Rimuove l'utente dalla lista degli utenti
-    remove_player_from_game_state(current_game, player_id);
+    for (int i = 0; i < restored_players_count; i++) {
+        if (restored_players[i] == (int)player_id) {
+            restored_players[i] = restored_players[--restored_players_count];
+            break;
+        }
+    }
+
+    GameStateType previous_state = current_game->state_type;
+    GameEventList events;
+    init_game_event_list(&events);
+    if (engine_leave(current_game, player_id, &events) != ENGINE_OK) {
+        free_game_event_list(&events);
+        return; // Il giocatore non faceva parte della partita
+    }
     LOG_INFO_TAG("Utente %d disconnesso e rimosso", player_id);
 
     // Controlla se il proprietario ha abbandonato prima dell'inizio della partita
-    if ((int)player_id == get_game_owner_id(current_game->game_id) && current_game_state_type == GAME_WAITING_FOR_PLAYERS) {
+    if ((int)player_id == get_game_owner_id(current_game->game_id) && previous_state == GAME_WAITING_FOR_PLAYERS) {
         LOG_INFO_TAG("Il proprietario (%d) ha abbandonato la lobby. La partita %s verrà terminata.", player_id, current_game->game_name);
 
         // Notifica ai giocatori rimanenti che la partita è finita (annullata)
-        Payload *payload = createEmptyPayload();
-        addPayloadKeyValuePairInt(payload, "winner_id", -1); // -1 indica nessun vincitore/partita annullata
-        send_to_all_players(current_game, MSG_GAME_FINISHED, payload, -1);
+        WinnerRecord winner = {-1}; // -1 indica nessun vincitore/partita annullata
+        send_to_all_players(current_game, MSG_GAME_FINISHED, encode_game_finished_msg(&winner, 1), -1);
 
         // Termino il thread di gioco
         game_is_running = 0;
+        record_game_events(&events);
+        free_game_event_list(&events);
         return;
     }
 
-    // Rimuovi il giocatore dall'ordine dei turni se la partita è iniziata
-    for(unsigned int i = 0; i < current_game->player_turn_order_count; i++) {
-        if(current_game->player_turn_order[i] == (int)player_id) {
-            current_game->player_turn_order[i] = -1; // Rimuove il giocatore dall'ordine dei turni
-            LOG_INFO_TAG("Il giocatore %d è stato rimosso dall'ordine dei turni", player_id);
-            break;
-        }
-    }
-
-    // Se il gioco era in corso, la disconnessione di un giocatore potrebbe portare alla vittoria di un altro.
-    if (current_game_state_type == GAME_IN_PROGRESS) {
-        if (check_victory_conditions(epoll_fd)) {
-            LOG_INFO_TAG("La disconnessione del giocatore %d ha terminato la partita.", player_id);
-            return;
-        }
+    // Se non ci sono più giocatori umani (sia in lobby che in gioco), la partita deve terminare.
+    unsigned int human_players_count = 0;
+    for (unsigned int i = 0; i < current_game->players_count; i++) {
+        if (current_game->players[i].bot == NULL) human_players_count++;
     }
-    
-    // Se non ci sono più giocatori (sia in lobby che in gioco), la partita deve terminare.
-    if (current_game->players_count == 0) {
+    if (human_players_count == 0) {
         LOG_INFO_TAG("Tutti i giocatori si sono disconnessi. La partita %d sarà eliminata.", current_game->game_id);
         remove_game(current_game->game_id);
         current_game->game_id = -1;
         game_is_running = 0;
+        record_game_events(&events);
+        free_game_event_list(&events);
         return; // Non c'è nessuno da notificare.
     }
 
-    Payload *payload = createEmptyPayload();
-    addPayloadKeyValuePairInt(payload, "player_id", player_id);
-    send_to_all_players(current_game, MSG_PLAYER_LEFT, payload, -1);
+    // PLAYER_LEFT, ed eventualmente la fine della partita o il passaggio del turno
+    dispatch_game_events(&events, reactor);
+    free_game_event_list(&events);
     // TODO potrei evitare di rimuovere il giocatore per permettere la riconnessione
 }
 
-
 void set_epoll_timer(TimerInfo *timer_info, int duration){
     time_t current_time = time(NULL);
     timer_info->start_time = current_time;
@@ -3,11 +3,37 @@
 
 #include "common/protocol.h"
 #include "common/game.h"
+#include "common/gameEngine.h"
+#include "common/gameJournal.h"
+#include "server/checkpoint.h"
+#include "server/reactor.h"
+
+#define MAX_GAME_BOTS 8 // Numero massimo di bot in una partita
+#define RECONNECT_TIMEOUT 120 // Secondi concessi ai giocatori di una partita ripristinata per riconnettersi
+#define GAME_END_SENTINEL -2 // Valore scritto sulla pipe di una partita per terminarla senza vincitori (vedi HANDOFF_SENTINEL)
+
+extern char *journal_dir; // Directory dei journal delle partite, NULL se i journal sono disabilitati
+
+typedef struct {
+    GameState *game; // Stato della partita, di cui il thread di gioco diventa proprietario
+    int keep_game_id; // 1 per registrare la partita con game->game_id invece di un ID nuovo
+    int checkpoint_slot; // Slot di checkpoint della partita, -1 per riservarne uno nuovo
+    int resumed; // 1 se la partita è già ripresa e i giocatori connessi ne conoscono lo stato
+    int timer_remaining; // Secondi rimasti al timer della partita, -1 per nessun timer o per quello predefinito
+    int pending_players[CHECKPOINT_MAX_PLAYERS]; // Giocatori che devono ancora ricevere lo stato della partita
+    int pending_count; // Giocatori validi in `pending_players`, -1 per attendere tutti i giocatori umani
+    GameJournal *journal; // Journal da proseguire, NULL se la partita non ne ha uno
+} RestoredGame;
 
 typedef struct {
     unsigned int game_id; // ID della partita
     char *game_name; // Nome della partita
     int game_pipe_fd; // File descriptor della pipe per comunicare con il thread del gioco (per ricevere nuovi giocatori)
+    int ruleset_id; // ID del regolamento della partita
+    int bots_count; // Numero di bot da aggiungere alla creazione della partita
+    unsigned int reserved_bot_ids[MAX_GAME_BOTS]; // ID di utente per i bot riservati dal supervisore (vedi workers.h)
+    int reserved_bots_count; // ID validi in `reserved_bot_ids`, 0 se gli ID dei bot vengono assegnati dal processo
+    RestoredGame restored; // Partita da riprendere, restored.game NULL per una partita nuova
 } GameThreadArg;
 
 typedef struct{
@@ -15,29 +41,25 @@ typedef struct{
     int duration; // Durata del timer in secondi
 } TimerInfo;
 
-typedef enum {
-    GAME_WAITING_FOR_PLAYERS,
-    GAME_WAITING_FLEET_SETUP,
-    GAME_IN_PROGRESS,
-    GAME_FINISHED
-} GameStateType;
-
+GameThreadArg *alloc_game_thread_arg(const char *game_name);
+void free_game_thread_arg(GameThreadArg *game_arg);
 void *game_thread(void *arg);
 
-void cleanup_client_game(int epoll_fd, int client_fd, unsigned int player_id);
+void cleanup_client_game(Reactor *reactor, int client_fd, unsigned int player_id);
 
-void on_ready_to_play_msg(int game_epoll_fd, int client_s, unsigned int player_id);
-void on_setup_fleet_msg(int game_epoll_fd, int client_s, unsigned int player_id, Payload *payload);
-void on_start_game_msg(int game_epoll_fd, int client_s, unsigned int player_id);
-void on_attack_msg(int game_epoll_fd, int client_s, unsigned int player_id, Payload *payload);
+void on_ready_to_play_msg(Reactor *game_reactor, int client_s, unsigned int player_id);
+void on_setup_fleet_msg(Reactor *game_reactor, int client_s, unsigned int player_id, Payload *payload);
+void on_start_game_msg(Reactor *game_reactor, int client_s, unsigned int player_id);
+void on_attack_msg(Reactor *game_reactor, int client_s, unsigned int player_id, Payload *payload);
+void on_add_bot_msg(Reactor *game_reactor, int client_s, unsigned int player_id);
 
-void on_malformed_game_msg(int game_epoll_fd, int client_s, unsigned int player_id);
-void on_unexpected_game_msg(int game_epoll_fd, int client_s, unsigned int player_id, uint16_t msg_type);
-void on_error_player_action_msg(int game_epoll_fd, int client_s, unsigned int player_id);
+void on_malformed_game_msg(Reactor *game_reactor, int client_s, unsigned int player_id);
+void on_unexpected_game_msg(Reactor *game_reactor, int client_s, unsigned int player_id, uint16_t msg_type);
+void on_error_player_action_msg(Reactor *game_reactor, int client_s, unsigned int player_id);
 
 void send_to_all_players(GameState *game, uint16_t msg_type, Payload *payload, int except_player_id);
-void update_turn_order(GameState *game, int game_epoll_fd);
-int check_victory_conditions();
+void dispatch_game_events(GameEventList *events, Reactor *game_reactor);
+int add_bot_player(void);
 
 void set_epoll_timer(TimerInfo *timer_info, int duration);
 int get_epoll_timer(TimerInfo *timer_info);
@@ -0,0 +1,533 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "server/handoff.h"
+#include "server/users.h"
+#include "server/gameManager.h"
+#include "common/gameJournal.h"
+#include "common/protocol.h"
+#include "utils/debug.h"
+
+typedef struct {
+    HandoffGame game;
+    int fds[HANDOFF_MAX_FDS];
+    int fds_count;
+} FrozenGame;
+
+static pthread_mutex_t handoff_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t handoff_cond = PTHREAD_COND_INITIALIZER;
+static int lobby_frozen = 0; // 1 quando il thread della lobby si è fermato
+static int games_frozen = 0; // Thread di gioco che si sono fermati
+static int handoff_closed = 0; // 1 quando le partite ferme sono state inviate: chi arriva dopo non viene trasferito
+static FrozenGame *frozen_games = NULL;
+static unsigned int frozen_games_count = 0;
+static unsigned int frozen_games_capacity = 0;
+
+/**
+ * Ferma per sempre il thread chiamante: il processo termina dopo il passaggio.
+ */
+static void park_thread(void) {
+    while (1) {
+        pause();
+    }
+}
+
+/**
+ * Invia un messaggio sulla socket di passaggio, con i file descriptor indicati come SCM_RIGHTS.
+ * @return 0 in caso di successo, -1 in caso di errore.
+ */
+static int send_with_fds(int handoff_s, const void *data, size_t size, const int *fds, int fds_count) {
+    struct iovec iov = {(void *)data, size};
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    char control[CMSG_SPACE(HANDOFF_MAX_FDS * sizeof(int))];
+    if (fds_count > 0) {
+        memset(control, 0, sizeof(control));
+        msg.msg_control = control;
+        msg.msg_controllen = CMSG_SPACE(fds_count * sizeof(int));
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(fds_count * sizeof(int));
+        memcpy(CMSG_DATA(cmsg), fds, fds_count * sizeof(int));
+    }
+
+    if (sendmsg(handoff_s, &msg, 0) != (ssize_t)size) {
+        LOG_ERROR("Errore durante l'invio dello stato al nuovo processo server: %s", strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Riceve un messaggio dalla socket di passaggio, con gli eventuali file descriptor allegati.
+ * @param fds Array di almeno HANDOFF_MAX_FDS file descriptor da riempire.
+ * @return Numero di file descriptor ricevuti, o -1 in caso di errore o messaggio incompleto.
+ */
+static int recv_with_fds(int handoff_s, void *data, size_t size, int *fds) {
+    struct iovec iov = {data, size};
+    char control[CMSG_SPACE(HANDOFF_MAX_FDS * sizeof(int))];
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t received = recvmsg(handoff_s, &msg, MSG_CMSG_CLOEXEC);
+    int fds_count = 0;
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+            fds_count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            memcpy(fds, CMSG_DATA(cmsg), fds_count * sizeof(int));
+        }
+    }
+
+    if (received != (ssize_t)size || (msg.msg_flags & (MSG_TRUNC | MSG_CTRUNC))) {
+        LOG_ERROR("Messaggio incompleto dal processo server precedente");
+        for (int i = 0; i < fds_count; i++) {
+            close(fds[i]);
+        }
+        return -1;
+    }
+    return fds_count;
+}
+
+/**
+ * Invia i byte già ricevuti da una socket e non gestiti, in blocchi di al massimo HANDOFF_CHUNK_SIZE.
+ * @return 0 in caso di successo, -1 in caso di errore.
+ */
+static int send_pending_input(int handoff_s, const char *bytes, uint32_t size) {
+    for (uint32_t offset = 0; offset < size; offset += HANDOFF_CHUNK_SIZE) {
+        uint32_t chunk = size - offset < HANDOFF_CHUNK_SIZE ? size - offset : HANDOFF_CHUNK_SIZE;
+        if (send_with_fds(handoff_s, bytes + offset, chunk, NULL, 0) < 0) return -1;
+    }
+    return 0;
+}
+
+/**
+ * Riceve i byte già ricevuti da una socket nel vecchio processo e li riassocia alla socket.
+ * @param socket_fd Socket ricevuta a cui appartengono i byte.
+ * @param size Byte annunciati, 0 se la socket non ne ha.
+ * @return 0 in caso di successo, -1 in caso di errore: la connessione va chiusa.
+ */
+static int recv_pending_input(int handoff_s, int socket_fd, uint32_t size) {
+    if (size == 0) return 0;
+    if (size > MAX_CONNECTION_INPUT_EXPORT) return -1;
+
+    char *bytes = (char *)malloc(size);
+    if (bytes == NULL) return -1;
+    int fds[HANDOFF_MAX_FDS];
+    int result = 0;
+    for (uint32_t offset = 0; offset < size && result == 0; offset += HANDOFF_CHUNK_SIZE) {
+        uint32_t chunk = size - offset < HANDOFF_CHUNK_SIZE ? size - offset : HANDOFF_CHUNK_SIZE;
+        int fds_count = recv_with_fds(handoff_s, bytes + offset, chunk, fds);
+        for (int i = 0; i < fds_count; i++) {
+            close(fds[i]);
+        }
+        if (fds_count != 0) result = -1;
+    }
+    if (result == 0) {
+        result = importConnectionInput(socket_fd, bytes, size);
+    }
+    free(bytes);
+    return result;
+}
+
+/**
+ * Crea la socket UNIX su cui un nuovo processo server può chiedere il passaggio.
+ * Un eventuale file rimasto in `path` viene sostituito.
+ * @param path Percorso della socket.
+ * @return File descriptor della socket in ascolto, o -1 in caso di errore.
+ */
+int handoff_listen(const char *path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        LOG_ERROR("Percorso della socket di passaggio troppo lungo: %s", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    int handoff_s = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (handoff_s < 0) {
+        LOG_ERROR("Errore nella creazione della socket di passaggio: %s", strerror(errno));
+        return -1;
+    }
+
+    unlink(path);
+    if (bind(handoff_s, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(handoff_s, 1) < 0) {
+        LOG_ERROR("Impossibile ascoltare sulla socket di passaggio `%s`: %s", path, strerror(errno));
+        close(handoff_s);
+        return -1;
+    }
+
+    LOG_INFO("Riavvio a caldo disponibile su `%s`", path);
+    return handoff_s;
+}
+
+/**
+ * Ferma il thread della lobby per il passaggio. Non ritorna.
+ */
+void handoff_freeze_lobby(void) {
+    pthread_mutex_lock(&handoff_mutex);
+    lobby_frozen = 1;
+    pthread_cond_broadcast(&handoff_cond);
+    pthread_mutex_unlock(&handoff_mutex);
+
+    park_thread();
+}
+
+/**
+ * Consegna lo stato di una partita per il passaggio e ferma il thread di gioco. Non ritorna.
+ * @param game Stato della partita, NULL se la partita non può essere trasferita.
+ * @param fds File descriptor del journal e delle socket dei giocatori, nell'ordine di `game`.
+ * @param fds_count Numero di file descriptor, al massimo HANDOFF_MAX_FDS.
+ */
+void handoff_freeze_game(const HandoffGame *game, const int *fds, int fds_count) {
+    pthread_mutex_lock(&handoff_mutex);
+    if (game != NULL && !handoff_closed) {
+        if (frozen_games_count >= frozen_games_capacity) {
+            unsigned int new_capacity = frozen_games_capacity ? frozen_games_capacity * 2 : 64;
+            FrozenGame *new_games = (FrozenGame *)realloc(frozen_games, new_capacity * sizeof(FrozenGame));
+            if (new_games != NULL) {
+                frozen_games = new_games;
+                frozen_games_capacity = new_capacity;
+            }
+        }
+        if (frozen_games_count < frozen_games_capacity) {
+            FrozenGame *frozen = &frozen_games[frozen_games_count++];
+            frozen->game = *game;
+            memcpy(frozen->fds, fds, fds_count * sizeof(int));
+            frozen->fds_count = fds_count;
+        } else {
+            LOG_ERROR("Allocazione fallita, la partita `%.*s` non verrà trasferita", CHECKPOINT_NAME_SIZE, game->game.game_name);
+        }
+    }
+    games_frozen++;
+    pthread_cond_broadcast(&handoff_cond);
+    pthread_mutex_unlock(&handoff_mutex);
+
+    park_thread();
+}
+
+/**
+ * Cede lo stato del server e tutte le connessioni a un nuovo processo server.
+ * Lobby e partite vengono fermate e non ripartono: al ritorno il chiamante deve terminare il processo.
+ * @param handoff_s Socket connessa al nuovo processo.
+ * @param list_s Socket in ascolto del server.
+ * @param lobby_pipe_fd Estremità di scrittura della pipe della lobby.
+ */
+void handoff_send(int handoff_s, int list_s, int lobby_pipe_fd) {
+    LOG_INFO("Un nuovo processo server chiede il passaggio delle connessioni");
+
+    // La lobby si ferma per prima, così durante il passaggio non nascono partite né nuovi giocatori
+    int sentinel = HANDOFF_SENTINEL;
+    if (write(lobby_pipe_fd, &sentinel, sizeof(sentinel)) == -1) {
+        LOG_ERROR("Errore durante la scrittura sulla pipe della lobby");
+    }
+    pthread_mutex_lock(&handoff_mutex);
+    while (!lobby_frozen) {
+        pthread_cond_wait(&handoff_cond, &handoff_mutex);
+    }
+    pthread_mutex_unlock(&handoff_mutex);
+
+    // Una partita che sta terminando può non rispondere: dopo HANDOFF_TIMEOUT si procede senza
+    int games_count = notify_all_games(HANDOFF_SENTINEL);
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += HANDOFF_TIMEOUT;
+
+    pthread_mutex_lock(&handoff_mutex);
+    while (games_frozen < games_count) {
+        if (pthread_cond_timedwait(&handoff_cond, &handoff_mutex, &deadline) == ETIMEDOUT) break;
+    }
+    handoff_closed = 1;
+    pthread_mutex_unlock(&handoff_mutex);
+    if (games_frozen < games_count) {
+        LOG_WARNING("%d partite non si sono fermate in tempo e non verranno trasferite", games_count - games_frozen);
+    }
+
+    // Gli utenti della lobby sono quelli con una socket che non fanno parte di una partita
+    HandoffUser *users = NULL;
+    int *user_fds = NULL;
+    unsigned int users_count = 0, users_capacity = 0;
+    size_t cursor = 0;
+    int user_id;
+    while ((user_id = get_next_user_id(&cursor)) >= 0) {
+        int socket_fd = get_user_socket_fd(user_id);
+        if (socket_fd < 0 || get_user_game_id(user_id) != USER_NO_GAME) continue;
+
+        if (users_count >= users_capacity) {
+            unsigned int new_capacity = users_capacity ? users_capacity * 2 : 64;
+            HandoffUser *new_users = (HandoffUser *)realloc(users, new_capacity * sizeof(HandoffUser));
+            int *new_fds = new_users ? (int *)realloc(user_fds, new_capacity * sizeof(int)) : NULL;
+            if (new_users) users = new_users;
+            if (new_fds) user_fds = new_fds;
+            if (!new_users || !new_fds) {
+                LOG_ERROR("Allocazione fallita, gli utenti della lobby rimanenti non verranno trasferiti");
+                break;
+            }
+            users_capacity = new_capacity;
+        }
+
+        HandoffUser *user = &users[users_count];
+        memset(user, 0, sizeof(*user));
+        user->user_id = user_id;
+        char *username = get_username_by_id(user_id);
+        if (username != NULL) {
+            user->has_username = 1;
+            strncpy(user->username, username, sizeof(user->username) - 1);
+            free(username);
+        }
+        user_fds[users_count++] = socket_fd;
+    }
+
+    HandoffHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = HANDOFF_MAGIC;
+    header.version = HANDOFF_VERSION;
+    header.games_count = frozen_games_count;
+    header.users_count = users_count;
+
+    int sent_games = 0, sent_users = 0;
+    if (send_with_fds(handoff_s, &header, sizeof(header), &list_s, 1) == 0) {
+        for (unsigned int i = 0; i < frozen_games_count; i++) {
+            FrozenGame *frozen = &frozen_games[i];
+            int first_socket = frozen->game.has_journal ? 1 : 0;
+            char *partials[CHECKPOINT_MAX_PLAYERS] = {NULL};
+            for (int j = 0; j < frozen->game.sockets_count; j++) {
+                if (exportConnectionInput(frozen->fds[first_socket + j], &partials[j], &frozen->game.partial_sizes[j]) < 0) {
+                    LOG_WARNING("Allocazione fallita, il messaggio in arrivo dal giocatore %d andrà perso", frozen->game.socket_players[j]);
+                }
+            }
+
+            int result = send_with_fds(handoff_s, &frozen->game, sizeof(frozen->game), frozen->fds, frozen->fds_count);
+            for (int j = 0; j < frozen->game.sockets_count; j++) {
+                if (result == 0) result = send_pending_input(handoff_s, partials[j], frozen->game.partial_sizes[j]);
+                free(partials[j]);
+            }
+            if (result < 0) break;
+            sent_games++;
+        }
+        for (unsigned int i = 0; i < users_count && sent_games == (int)frozen_games_count; i++) {
+            char *partial;
+            if (exportConnectionInput(user_fds[i], &partial, &users[i].partial_size) < 0) {
+                LOG_WARNING("Allocazione fallita, il messaggio in arrivo dall'utente %d andrà perso", users[i].user_id);
+            }
+            int result = send_with_fds(handoff_s, &users[i], sizeof(users[i]), &user_fds[i], 1);
+            if (result == 0) result = send_pending_input(handoff_s, partial, users[i].partial_size);
+            free(partial);
+            if (result < 0) break;
+            sent_users++;
+        }
+    }
+
+    LOG_INFO("Passaggio completato: trasferite %d partite su %u e %d utenti della lobby su %u",
+             sent_games, frozen_games_count, sent_users, users_count);
+    free(users);
+    free(user_fds);
+    close(handoff_s);
+}
+
+/**
+ * Ricrea una partita ricevuta dal processo server precedente e ne avvia il thread di gioco.
+ * I giocatori ripristinati che non hanno ancora una socket vengono attesi al login.
+ * @param handoff Partita ricevuta.
+ * @param fds File descriptor ricevuti con la partita, di cui la funzione diventa proprietaria.
+ * @param fds_count Numero di file descriptor.
+ * @return ID della partita, o -1 in caso di errore.
+ */
+static int adopt_game(const HandoffGame *handoff, const int *fds, int fds_count) {
+    const CheckpointGame *saved = &handoff->game;
+    int first_socket = handoff->has_journal ? 1 : 0;
+    int socket_fds[CHECKPOINT_MAX_PLAYERS];
+    for (int i = 0; i < CHECKPOINT_MAX_PLAYERS; i++) {
+        socket_fds[i] = -1;
+    }
+    if (saved->players_count > CHECKPOINT_MAX_PLAYERS || handoff->sockets_count > CHECKPOINT_MAX_PLAYERS ||
+        handoff->pending_count > CHECKPOINT_MAX_PLAYERS || first_socket + handoff->sockets_count != fds_count) {
+        goto error;
+    }
+    for (int i = 0; i < handoff->sockets_count; i++) {
+        for (unsigned int j = 0; j < saved->players_count; j++) {
+            if (saved->players[j].user_id == handoff->socket_players[i]) {
+                socket_fds[j] = fds[first_socket + i];
+                break;
+            }
+        }
+    }
+
+    int owner_id;
+    GameState *game = checkpoint_load_game(saved, socket_fds, &owner_id);
+    if (game == NULL) goto error;
+
+    RestoredGame restored;
+    memset(&restored, 0, sizeof(restored));
+    restored.game = game;
+    restored.keep_game_id = 1;
+    restored.checkpoint_slot = handoff->checkpoint_slot;
+    restored.resumed = handoff->resumed;
+    restored.timer_remaining = handoff->timer_remaining;
+    restored.pending_count = handoff->pending_count;
+    memcpy(restored.pending_players, handoff->pending_players, sizeof(restored.pending_players));
+    restored.journal = handoff->has_journal ? journal_adopt(fds[0]) : NULL;
+    if (handoff->has_journal && restored.journal == NULL) {
+        close(fds[0]);
+    }
+
+    // Dopo restore_game lo stato appartiene al thread di gioco: i giocatori attesi vanno letti prima
+    char pending_names[CHECKPOINT_MAX_PLAYERS][CHECKPOINT_NAME_SIZE];
+    int pending_ids[CHECKPOINT_MAX_PLAYERS];
+    int pending_count = 0;
+    for (unsigned int i = 0; i < game->players_count; i++) {
+        if (game->players[i].bot == NULL && socket_fds[i] < 0) {
+            memcpy(pending_names[pending_count], saved->players[i].username, CHECKPOINT_NAME_SIZE);
+            pending_names[pending_count][CHECKPOINT_NAME_SIZE - 1] = '\0';
+            pending_ids[pending_count++] = game->players[i].user.user_id;
+        }
+    }
+
+    checkpoint_adopt_slot(handoff->checkpoint_slot);
+    int game_id = restore_game(&restored, owner_id);
+    if (game_id < 0) {
+        checkpoint_release_slot(handoff->checkpoint_slot);
+        checkpoint_discard_game(game);
+        if (restored.journal != NULL) {
+            journal_close(restored.journal); // Chiude anche fds[0]
+            fds++;
+            fds_count--;
+        }
+        goto error;
+    }
+
+    for (int i = 0; i < pending_count; i++) {
+        checkpoint_expect_user(pending_names[i], pending_ids[i], game_id);
+    }
+    return game_id;
+
+error:
+    for (int i = 0; i < fds_count; i++) {
+        closeConnection(fds[i]); // Rilascia anche i messaggi letti in parte riassociati alle socket
+    }
+    return -1;
+}
+
+/**
+ * Chiede al processo server in ascolto su `path` di cedere il suo stato e le sue connessioni.
+ * Le partite ricevute ripartono subito nei propri thread; gli utenti della lobby vengono
+ * ricreati con i loro ID e restituiti al chiamante, che li affida al thread della lobby.
+ * @param path Percorso della socket di passaggio.
+ * @param lobby_users Restituisce l'array degli ID degli utenti della lobby, da liberare con free().
+ * @param lobby_users_count Restituisce il numero di utenti della lobby.
+ * @return Socket in ascolto ricevuta, o -1 se non c'è nessun server da sostituire o il passaggio è fallito.
+ */
+int handoff_receive(const char *path, unsigned int **lobby_users, unsigned int *lobby_users_count) {
+    *lobby_users = NULL;
+    *lobby_users_count = 0;
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) return -1;
+    strcpy(addr.sun_path, path);
+
+    int handoff_s = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (handoff_s < 0) return -1;
+    if (connect(handoff_s, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        LOG_INFO("Nessun server in esecuzione su `%s`, avvio normale", path);
+        close(handoff_s);
+        return -1;
+    }
+
+    LOG_INFO("Richiesta del passaggio delle connessioni al server in esecuzione...");
+    HandoffHeader header;
+    int fds[HANDOFF_MAX_FDS];
+    int fds_count = recv_with_fds(handoff_s, &header, sizeof(header), fds);
+    if (fds_count < 0) {
+        close(handoff_s);
+        return -1;
+    }
+    if (fds_count != 1 || header.magic != HANDOFF_MAGIC || header.version != HANDOFF_VERSION) {
+        LOG_ERROR("Il server in esecuzione su `%s` usa un formato di passaggio incompatibile", path);
+        for (int i = 0; i < fds_count; i++) {
+            close(fds[i]);
+        }
+        close(handoff_s);
+        return -1;
+    }
+    int list_s = fds[0];
+
+    // Da qui il vecchio processo ha ceduto la socket in ascolto: un errore perde solo ciò che non è arrivato
+    HandoffGame *game = (HandoffGame *)malloc(sizeof(HandoffGame));
+    unsigned int adopted_games = 0;
+    for (unsigned int i = 0; game != NULL && i < header.games_count; i++) {
+        fds_count = recv_with_fds(handoff_s, game, sizeof(*game), fds);
+        if (fds_count < 0) break;
+        int first_socket = game->has_journal ? 1 : 0;
+        int partials_received = game->sockets_count <= CHECKPOINT_MAX_PLAYERS && first_socket + game->sockets_count == fds_count;
+        for (int j = 0; partials_received && j < game->sockets_count; j++) {
+            partials_received = recv_pending_input(handoff_s, fds[first_socket + j], game->partial_sizes[j]) == 0;
+        }
+        if (!partials_received) {
+            LOG_ERROR("Messaggi in arrivo della partita `%.*s` non ricevuti", CHECKPOINT_NAME_SIZE, game->game.game_name);
+            for (int j = 0; j < fds_count; j++) {
+                closeConnection(fds[j]);
+            }
+            break;
+        }
+        if (adopt_game(game, fds, fds_count) < 0) {
+            LOG_WARNING("Impossibile riprendere la partita `%.*s`, i suoi giocatori vengono disconnessi", CHECKPOINT_NAME_SIZE, game->game.game_name);
+            continue;
+        }
+        adopted_games++;
+    }
+    free(game);
+
+    unsigned int *users = header.users_count ? (unsigned int *)malloc(header.users_count * sizeof(unsigned int)) : NULL;
+    unsigned int users_count = 0;
+    for (unsigned int i = 0; users != NULL && i < header.users_count; i++) {
+        HandoffUser user;
+        fds_count = recv_with_fds(handoff_s, &user, sizeof(user), fds);
+        if (fds_count < 0) break;
+        if (fds_count != 1) {
+            for (int j = 0; j < fds_count; j++) {
+                close(fds[j]);
+            }
+            continue;
+        }
+
+        if (recv_pending_input(handoff_s, fds[0], user.partial_size) < 0) {
+            LOG_ERROR("Messaggio in arrivo dall'utente %d della lobby non ricevuto", user.user_id);
+            closeConnection(fds[0]);
+            break;
+        }
+
+        user.username[sizeof(user.username) - 1] = '\0';
+        if (create_user_with_id(user.user_id, user.has_username ? user.username : NULL, fds[0]) < 0) {
+            LOG_WARNING("Impossibile ricreare l'utente %d della lobby", user.user_id);
+            closeConnection(fds[0]);
+            continue;
+        }
+        users[users_count++] = user.user_id;
+    }
+    close(handoff_s);
+
+    LOG_INFO("Ricevute %u partite su %u e %u utenti della lobby su %u dal server precedente",
+             adopted_games, header.games_count, users_count, header.users_count);
+    *lobby_users = users;
+    *lobby_users_count = users_count;
+    return list_s;
+}
@@ -0,0 +1,71 @@
+#ifndef HANDOFF_H
+#define HANDOFF_H
+
+#include <stdint.h>
+
+#include "server/checkpoint.h"
+
+/**
+ * Riavvio a caldo del server: un nuovo processo prende il posto di quello in esecuzione senza
+ * chiudere nessuna connessione.
+ * Il server avviato con `-handoff PATH` ascolta su una socket UNIX in PATH. Un nuovo processo
+ * avviato con la stessa opzione vi si connette e il vecchio processo:
+ * - ferma il thread della lobby e poi ogni thread di gioco, scrivendo HANDOFF_SENTINEL sulle
+ *   loro pipe: ogni thread si ferma tra un messaggio e l'altro e consegna il proprio stato;
+ * - invia con SCM_RIGHTS la socket in ascolto, ogni partita (stato, timer, journal e socket
+ *   dei giocatori) e gli utenti della lobby con le loro socket;
+ * - termina. Le connessioni restano aperte perché le socket sono condivise con il nuovo processo.
+ *
+ * I byte non ancora letti restano nella coda del kernel e seguono la socket. Il thread può però
+ * averne già ricevuti alcuni senza gestirli: l'inizio di un messaggio arrivato solo in parte
+ * (vedi tryRecvMsg in protocol.c) e, con il backend uring, i byte nella coda della connessione.
+ * Lobby e partite tolgono le socket dal reactor prima di fermarsi, così il reactor non riceve
+ * altro; questi byte vengono inviati subito dopo la partita o l'utente, in blocchi di al massimo
+ * HANDOFF_CHUNK_SIZE, e il nuovo processo li riassocia alla socket prima di leggerla.
+ * Il nuovo processo mantiene gli ID di utenti e partite, che i client già conoscono, e si mette
+ * in ascolto su PATH per il riavvio successivo.
+ */
+
+#define HANDOFF_MAGIC 0x31464648 // "HFF1"
+#define HANDOFF_VERSION 3
+#define HANDOFF_SENTINEL -1 // Valore scritto sulle pipe di lobby e partite per fermarne il thread
+#define HANDOFF_TIMEOUT 5 // Secondi di attesa delle partite da fermare
+#define HANDOFF_MAX_FDS (CHECKPOINT_MAX_PLAYERS + 1) // Journal e socket dei giocatori di una partita
+#define HANDOFF_CHUNK_SIZE (64 * 1024) // Byte ricevuti e non gestiti inviati con una sola sendmsg
+
+typedef struct {
+    uint32_t magic; // HANDOFF_MAGIC
+    uint16_t version; // HANDOFF_VERSION
+    uint16_t reserved;
+    uint32_t games_count; // Messaggi HandoffGame che seguono
+    uint32_t users_count; // Messaggi HandoffUser che seguono le partite
+} HandoffHeader;
+
+typedef struct {
+    int32_t checkpoint_slot; // Slot di checkpoint della partita, -1 se non viene salvata
+    int32_t timer_remaining; // Secondi rimasti al timer della partita, -1 se non è attivo
+    uint8_t resumed; // 0 se la partita attende ancora la riconnessione dei giocatori ripristinati
+    uint8_t has_journal; // 1 se il primo file descriptor è il journal della partita
+    uint8_t sockets_count; // Giocatori in `socket_players`
+    uint8_t pending_count; // Giocatori in `pending_players`
+    int32_t socket_players[CHECKPOINT_MAX_PLAYERS]; // ID dei giocatori di cui segue la socket, nell'ordine dei file descriptor
+    int32_t pending_players[CHECKPOINT_MAX_PLAYERS]; // Giocatori ripristinati che non hanno ancora ricevuto lo stato della partita
+    uint32_t partial_sizes[CHECKPOINT_MAX_PLAYERS]; // Byte già ricevuti e non gestiti, per ogni socket
+    CheckpointGame game; // Stato della partita
+} HandoffGame;
+
+typedef struct {
+    int32_t user_id;
+    uint8_t has_username; // 0 se l'utente non ha ancora fatto il login
+    char username[CHECKPOINT_NAME_SIZE];
+    uint32_t partial_size; // Byte già ricevuti dalla socket e non gestiti
+} HandoffUser;
+
+int handoff_listen(const char *path);
+int handoff_receive(const char *path, unsigned int **lobby_users, unsigned int *lobby_users_count);
+void handoff_send(int handoff_s, int list_s, int lobby_pipe_fd);
+
+void handoff_freeze_lobby(void);
+void handoff_freeze_game(const HandoffGame *game, const int *fds, int fds_count);
+
+#endif // HANDOFF_H
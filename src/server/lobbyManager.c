@@ -11,40 +11,63 @@
 #include <netdb.h>
 
 #include <pthread.h>
-#include <sys/epoll.h>
 #include <errno.h>
 
 #include "server/lobbyManager.h"
 #include "utils/cmdLineParser.h"
 #include "utils/debug.h"
 #include "common/protocol.h"
+#include "common/shmTransport.h"
 #include "server/users.h"
+#include "common/game.h"
+#include "server/gameManager.h"
+#include "server/checkpoint.h"
+#include "server/handoff.h"
+#include "server/workers.h"
+#include "server/gameDirectory.h"
+#include "server/adminSocket.h"
+#include "common/metrics.h"
+#include "common/trace.h"
 
+int shared_memory_enabled = 1;
+
+static void join_game(Reactor *lobby_reactor, unsigned int user_id, int client_s, const char *username, unsigned int game_id);
+static void drain_lobby_client(Reactor *lobby_reactor, unsigned int user_id);
 
 /**
  * Funzione eseguita dal thread della lobby per gestire le connessioni dei client.
  */
 #define MAX_EVENTS 128
 void *lobby_thread_main(void *arg) {
-    int lobby_pipe_fd = *(int *)arg;
-    int lobby_epoll_fd = epoll_create1(0);
+    LobbyThreadArg *lobby_arg = (LobbyThreadArg *)arg;
+    int lobby_pipe_fd = lobby_arg->lobby_pipe_fd;
+    Reactor *lobby_reactor = reactor_create();
+    trace_set_thread_name("lobby");
+
+    reactor_add(lobby_reactor, lobby_pipe_fd, UINT64_MAX); // Indica che è un evento di connessione
+    workers_watch(lobby_reactor);
 
-    struct epoll_event ev;
-    ev.events = EPOLLIN;
-    ev.data.u64 = UINT64_MAX; // Indica che è un evento di connessione
-    epoll_ctl(lobby_epoll_fd, EPOLL_CTL_ADD, lobby_pipe_fd, &ev);
+    for (unsigned int i = 0; i < lobby_arg->adopted_users_count; i++) {
+        unsigned int user_id = lobby_arg->adopted_users[i];
+        reactor_add_edge(lobby_reactor, get_user_socket_fd(user_id), user_id);
+    }
 
     while (1) {
-        struct epoll_event events[MAX_EVENTS];
-        int nfds = epoll_wait(lobby_epoll_fd, events, MAX_EVENTS, -1);
+        ReactorEvent events[MAX_EVENTS];
+        int nfds = reactor_wait(lobby_reactor, events, MAX_EVENTS, -1);
+        metrics_loop_woke();
 
         for(int n = 0; n < nfds; n++){
-            if(events[n].data.u64 == UINT64_MAX) {
+            if(events[n].tag == UINT64_MAX) {
                 int new_conn_s;
                 if (read(lobby_pipe_fd, &new_conn_s, sizeof(new_conn_s)) == -1) {
                     LOG_ERROR("Errore durante la lettura dalla pipe della lobby");
                     continue; // Continua ad accettare altre connessioni
                 }
+                if (new_conn_s == HANDOFF_SENTINEL) {
+                    reactor_destroy(lobby_reactor); // Stacca le socket, i byte già ricevuti seguono la socket
+                    handoff_freeze_lobby(); // Non ritorna: il processo termina dopo il passaggio
+                }
 
                 int user_id = create_user(NULL, new_conn_s);
                 if(user_id < 0) {
@@ -53,83 +76,171 @@ void *lobby_thread_main(void *arg) {
                     continue; // Continua ad accettare altre connessioni
                 }
 
-                ev.events = EPOLLIN;
-                ev.data.u64 = user_id;
-                epoll_ctl(lobby_epoll_fd, EPOLL_CTL_ADD, new_conn_s, &ev);
+                reactor_add_edge(lobby_reactor, new_conn_s, user_id);
 
+            } else if (workers_is_channel_tag(events[n].tag)) {
+                workers_on_channel_event(events[n].tag);
             }else{
-                int user_id = events[n].data.u64;
-                int client_s = get_user_socket_fd(user_id);
-                if (client_s < 0) {
-                    LOG_WARNING("Errore nell'ottenimento della socket per il giocatore %d", user_id);
-                    continue; // Continua ad accettare altri messaggi
-                }
+                drain_lobby_client(lobby_reactor, events[n].tag);
+            }
+        }
+    }
 
-                uint16_t msg_type;
-                Payload *payload = NULL;
-                if(safeRecvMsg(client_s, &msg_type, &payload) < 0){
-                    LOG_MSG_ERROR("Errore durante la ricezione del messaggio dal client %d, procedo a chiuderne la connessione...", client_s);
-                    cleanup_client_lobby(lobby_epoll_fd, client_s, user_id);
-                    continue; // Continua ad accettare altri messaggi
-                }
+    return NULL;
+}
 
-                switch(msg_type){
-                    case MSG_LOGIN:
-                        // Gestione del login
-                        on_login_msg(lobby_epoll_fd, user_id, client_s, payload);
-                        break;
-
-                    case MSG_CREATE_GAME:
-                        // Gestione della creazione di una nuova partita
-                        on_create_game_msg(lobby_epoll_fd, user_id, client_s, payload);
-                        break;
-
-                    case MSG_JOIN_GAME:
-                        // Gestione dell'unione a una partita
-                        LOG_DEBUG("Il giocatore %d ha inviato un messaggio di unione a una partita", user_id);
-                        on_join_game_msg(lobby_epoll_fd, user_id, client_s, payload);
-                        break;
-                        
-                    default:
-                        on_unexpected_msg(lobby_epoll_fd, user_id, client_s, msg_type);
-                        break;
-                }
+/**
+ * Legge i messaggi arrivati da un client della lobby e li gestisce uno alla volta.
+ * La socket è registrata in modalità edge-triggered: si legge finché non resta vuota, per al
+ * massimo REACTOR_CONNECTION_BUDGET messaggi, poi il client viene rimesso in coda così gli
+ * altri client pronti non restano in attesa. La lettura si ferma appena il client lascia la
+ * lobby: i messaggi successivi restano nella socket per la partita che lo riceve, e un evento
+ * arrivato per un client che ha già lasciato la lobby viene ignorato.
+ * @param lobby_reactor Reactor della lobby.
+ * @param user_id ID dell'utente.
+ */
+static void drain_lobby_client(Reactor *lobby_reactor, unsigned int user_id) {
+    if (get_user_game_id(user_id) != USER_NO_GAME) {
+        return; // La socket ora è letta dal thread della partita
+    }
+    int client_s = get_user_socket_fd(user_id);
+    if (client_s < 0) {
+        LOG_WARNING("Errore nell'ottenimento della socket per il giocatore %d", user_id);
+        return; // Continua ad accettare altri messaggi
+    }
+
+    for (int budget = REACTOR_CONNECTION_BUDGET; budget > 0; budget--) {
+        uint16_t msg_type;
+        Payload *payload = NULL;
+        metrics_msg_begin();
+        trace_msg_begin();
+        int received = safeTryRecvMsg(client_s, &msg_type, &payload);
+        if (received == 0) {
+            return; // Socket svuotata, il prossimo evento arriverà con nuovi dati
+        }
+        if (received < 0) {
+            LOG_MSG_ERROR("Errore durante la ricezione del messaggio dal client %d, procedo a chiuderne la connessione...", client_s);
+            cleanup_client_lobby(lobby_reactor, client_s, user_id);
+            return;
+        }
 
-                freePayload(payload);
+        int64_t span_start_ns = trace_begin();
+        switch(msg_type){
+            case MSG_LOGIN:
+                // Gestione del login
+                on_login_msg(lobby_reactor, user_id, client_s, payload);
+                break;
+
+            case MSG_CREATE_GAME:
+                // Gestione della creazione di una nuova partita
+                on_create_game_msg(lobby_reactor, user_id, client_s, payload);
+                break;
+
+            case MSG_JOIN_GAME:
+                // Gestione dell'unione a una partita
+                LOG_DEBUG("Il giocatore %d ha inviato un messaggio di unione a una partita", user_id);
+                on_join_game_msg(lobby_reactor, user_id, client_s, payload);
+                break;
+
+            case MSG_ATTACH_SHARED_MEMORY:
+                // Passaggio di un client locale alla memoria condivisa
+                on_attach_shared_memory_msg(lobby_reactor, user_id, client_s);
+                break;
                 
-            }
+            default:
+                on_unexpected_msg(lobby_reactor, user_id, client_s, msg_type);
+                break;
+        }
+        trace_end(TRACE_HANDLER, msg_type, span_start_ns);
+        trace_msg_end();
+        metrics_msg_end(msg_type);
+
+        freePayload(payload);
+
+        // Disconnesso, entrato in una partita o riconnesso a una partita ripristinata
+        if (get_user_socket_fd(user_id) != client_s || get_user_game_id(user_id) != USER_NO_GAME) {
+            return;
         }
     }
 
-    return NULL;
+    reactor_defer(lobby_reactor, client_s, user_id); // Budget esaurito, i messaggi rimasti al prossimo giro
 }
 
 /**
- * Rimuove un client dal set epoll e chiude la relativa socket.
+ * Rimuove un client dal reactor della lobby e chiude la relativa socket.
  * Utile per gestire la disconnessione e il cleanup di risorse associate a un client.
- * @param epoll_fd File descriptor dell'epoll.
+ * @param reactor Reactor della lobby.
  * @param client_fd File descriptor della socket del client da chiudere.
  * @param user_id ID dell'utente da rimuovere.
  */
-void cleanup_client_lobby(int epoll_fd, int client_fd, unsigned int user_id) {
+void cleanup_client_lobby(Reactor *reactor, int client_fd, unsigned int user_id) {
     // TODO da rivedere
-    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, client_fd, NULL);
-    close(client_fd);
+    reactor_remove(reactor, client_fd);
+    closeConnection(client_fd);
     remove_user(user_id); // Rimuove l'utente dalla lista degli utenti
+    metrics_inc(METRIC_CLIENTS_DROPPED);
     LOG_INFO("Utente %d disconnesso e rimosso", user_id);
 }
 
 
+/**
+ * Riconnette un giocatore alla partita ripristinata da un checkpoint da cui proviene.
+ * La socket passa dall'utente temporaneo della lobby a quello ricreato per il giocatore, il
+ * client riceve un MSG_WELCOME con l'ID e il nome della partita e il thread di gioco riceve il
+ * giocatore dalla pipe.
+ * @param lobby_reactor Reactor della lobby.
+ * @param user_id ID dell'utente temporaneo della lobby.
+ * @param client_s File descriptor della socket del client.
+ * @param username Nome utente del login.
+ * @param restored_user_id ID dell'utente ricreato per il giocatore.
+ * @param game_id ID della partita ripristinata.
+ * @return 0 se il giocatore è stato affidato alla partita, -1 se la partita non lo attende più.
+ */
+static int rejoin_restored_game(Reactor *lobby_reactor, unsigned int user_id, int client_s, const char *username, unsigned int restored_user_id, unsigned int game_id) {
+    char *game_name = get_game_name_by_id(game_id);
+    if (game_name == NULL || update_user_socket_fd(restored_user_id, client_s) < 0) {
+        free(game_name);
+        return -1;
+    }
+
+    reactor_remove(lobby_reactor, client_s);
+    remove_user(user_id); // L'utente temporaneo non serve più, la socket resta aperta
+
+    Payload *welcomePayload = createEmptyPayload();
+    addPayloadKeyValuePair(welcomePayload, "username", username);
+    addPayloadKeyValuePairInt(welcomePayload, "user_id", restored_user_id);
+    addPayloadKeyValuePairInt(welcomePayload, "game_id", game_id);
+    addPayloadKeyValuePair(welcomePayload, "game_name", game_name);
+    if (safeSendMsg(client_s, MSG_WELCOME, welcomePayload) < 0) {
+        // La disconnessione viene gestita dal thread di gioco alla prima lettura
+        LOG_MSG_ERROR("Errore durante l'invio del messaggio di benvenuto a `%s`", username);
+    } else {
+        metrics_inc(METRIC_LOGINS);
+    }
+
+    if (hand_player_to_game(game_id, restored_user_id) < 0) {
+        LOG_ERROR("La partita %d non esiste più, impossibile riconnettere `%s`", game_id, username);
+    } else {
+        LOG_INFO("Utente `%s` riconnesso alla partita ripristinata `%s`", username, game_name);
+    }
+    free(game_name);
+    return 0;
+}
+
 /**
  * Gestisce il messaggio di login da parte di un client.
  * Se l'autenticazione va a buon fine, aggiorna il nome utente e invia un messaggio di benvenuto.
+ * Se il nome utente appartiene a un giocatore di una partita ripristinata, il client viene
+ * riconnesso direttamente alla partita.
+ * Un client indirizzato qui da un altro nodo del cluster presenta il token ricevuto con
+ * MSG_REDIRECT: dopo il benvenuto entra direttamente nella partita richiesta.
  * Se l'autenticazione fallisce, invia un messaggio di errore.
- * @param lobby_epoll_fd File descriptor dell'epoll della lobby.
+ * @param lobby_reactor Reactor della lobby.
  * @param user_id ID dell'utente che sta effettuando il login.
  * @param client_s File descriptor della socket del client.
  * @param payload Payload del messaggio ricevuto.
  */
-void on_login_msg(int lobby_epoll_fd, unsigned int user_id, int client_s, Payload *payload) {
+void on_login_msg(Reactor *lobby_reactor, unsigned int user_id, int client_s, Payload *payload) {
     char *username = getPayloadValue(payload, 0, "username");
 
     if (username) {
@@ -145,9 +256,15 @@ void on_login_msg(int lobby_epoll_fd, unsigned int user_id, int client_s, Payloa
         }
         LOG_INFO("Utente `%s` si è connesso", username);
 
+        unsigned int restored_user_id, restored_game_id;
+        if (checkpoint_claim_user(username, &restored_user_id, &restored_game_id) == 0 &&
+            rejoin_restored_game(lobby_reactor, user_id, client_s, username, restored_user_id, restored_game_id) == 0) {
+            goto cleanup;
+        }
+
         if(update_user_username(user_id, username) < 0){
             LOG_ERROR("Errore durante l'aggiornamento del nome utente per l'utente %d", user_id);
-            cleanup_client_lobby(lobby_epoll_fd, client_s, user_id);
+            cleanup_client_lobby(lobby_reactor, client_s, user_id);
             free(username);
             goto cleanup;
         }
@@ -157,14 +274,29 @@ void on_login_msg(int lobby_epoll_fd, unsigned int user_id, int client_s, Payloa
         addPayloadKeyValuePairInt(welcomePayload, "user_id", user_id);
         if(safeSendMsg(client_s, MSG_WELCOME, welcomePayload) < 0){
             LOG_MSG_ERROR("Errore durante l'invio del messaggio di benvenuto a `%s`", username);
-            cleanup_client_lobby(lobby_epoll_fd, client_s, user_id);
+            cleanup_client_lobby(lobby_reactor, client_s, user_id);
             goto cleanup;
         }
 
         LOG_INFO("Messaggio di benvenuto inviato a `%s`", username);
+        metrics_inc(METRIC_LOGINS);
+
+        char *token = getPayloadValue(payload, 0, "token");
+        if (token != NULL) {
+            unsigned int redirect_game_id;
+            if (game_directory != NULL && game_directory->redeem_token(game_directory, token, &redirect_game_id) == 0) {
+                join_game(lobby_reactor, user_id, client_s, username, redirect_game_id);
+            } else {
+                LOG_WARNING("Token di redirect non valido o scaduto per `%s`", username);
+                if(safeSendMsg(client_s, MSG_ERROR_JOIN_GAME, NULL) < 0){
+                    cleanup_client_lobby(lobby_reactor, client_s, user_id);
+                }
+            }
+            free(token);
+        }
     } else {
         LOG_WARNING("Messaggio di login non valido, nome utente mancante");
-        on_malformed_msg(lobby_epoll_fd, user_id, client_s);
+        on_malformed_msg(lobby_reactor, user_id, client_s);
     }
 
 
@@ -176,13 +308,13 @@ cleanup:
  * Gestisce il messaggio di creazione di una nuova partita.
  * Crea una nuova partita e invia un messaggio di conferma al client.
  * Se la creazione della partita fallisce, invia un messaggio di errore.
- * @param lobby_epoll_fd File descriptor dell'epoll della lobby.
+ * @param lobby_reactor Reactor della lobby.
  * @param user_id ID dell'utente che sta creando la partita.
  * @param client_s File descriptor della socket del client.
  * @param payload Payload del messaggio ricevuto.
  */
-void on_create_game_msg(int lobby_epoll_fd, unsigned int user_id, int client_s, Payload *payload) {
-    char *username = require_authentication(lobby_epoll_fd, user_id, client_s);
+void on_create_game_msg(Reactor *lobby_reactor, unsigned int user_id, int client_s, Payload *payload) {
+    char *username = require_authentication(lobby_reactor, user_id, client_s);
     if (!username) {
         return; // Client non autenticato, già gestito in require_authentication
     }
@@ -200,32 +332,80 @@ void on_create_game_msg(int lobby_epoll_fd, unsigned int user_id, int client_s,
             free(game_name);
             asprintf(&game_name, "Game_%d", user_id);
         }
-        int game_id = create_game(game_name, user_id);
 
-        if(game_id < 0){
+        // Il regolamento è opzionale, in sua assenza si usa "classic"
+        int ruleset_id = 0;
+        char *ruleset_name = getPayloadValue(payload, 0, "ruleset");
+        if (ruleset_name) {
+            ruleset_id = find_game_rules(ruleset_name);
+            free(ruleset_name);
+            if (ruleset_id < 0) {
+                LOG_WARNING("Regolamento non riconosciuto per la partita '%s'", game_name);
+                on_malformed_msg(lobby_reactor, user_id, client_s);
+                goto cleanup;
+            }
+        }
+
+        // Anche il numero di bot è opzionale, possono essere aggiunti in seguito con MSG_ADD_BOT
+        int bots_count = 0;
+        char *bots_value = getPayloadValue(payload, 0, "bots");
+        if (bots_value) {
+            free(bots_value);
+            if (getPayloadIntValue(payload, 0, "bots", &bots_count) < 0 || bots_count < 0 || bots_count > MAX_GAME_BOTS) {
+                LOG_WARNING("Numero di bot non valido per la partita '%s'", game_name);
+                on_malformed_msg(lobby_reactor, user_id, client_s);
+                goto cleanup;
+            }
+        }
+
+        // Durante lo spegnimento controllato (comando `drain`) le partite esistenti finiscono, ma non se ne creano altre
+        int game_id = -1;
+        if (atomic_load(&server_draining)) {
+            LOG_INFO("Partita '%s' di `%s` rifiutata, il server si sta spegnendo", game_name, username);
+        } else if ((game_id = create_game(game_name, user_id, ruleset_id, bots_count)) < 0) {
             LOG_ERROR("Errore durante la creazione della partita per l'utente `%s`", username);
+        }
+
+        if(game_id < 0){
             if(safeSendMsg(client_s, MSG_ERROR_CREATE_GAME, NULL) < 0){
                 LOG_MSG_ERROR("Errore durante l'invio del messaggio di errore al client `%s`", username);
-                cleanup_client_lobby(lobby_epoll_fd, client_s, user_id);
+                cleanup_client_lobby(lobby_reactor, client_s, user_id);
                 goto cleanup;
             }
         } else {
             LOG_INFO("Partita '%s' creata con ID %d da `%s`", game_name, game_id, username);
+            metrics_inc(METRIC_GAMES_CREATED);
 
+            const GameRules *rules = get_game_rules(ruleset_id);
             Payload *payload = createEmptyPayload();
             addPayloadKeyValuePairInt(payload, "game_id", game_id);
             addPayloadKeyValuePair(payload, "game_name", game_name);
+            addPayloadKeyValuePair(payload, "ruleset", rules->name);
+            addPayloadKeyValuePairInt(payload, "salvo_size", rules->salvo_size);
+            addPayloadKeyValuePairInt(payload, "bots", bots_count);
 
             if(safeSendMsg(client_s, MSG_GAME_CREATED, payload) < 0){
                 LOG_MSG_ERROR("Errore durante l'invio del messaggio di partita creata al client `%s`", username);
-                cleanup_client_lobby(lobby_epoll_fd, client_s, user_id);
-                goto cleanup;
+                if (workers_enabled()) {
+                    // La partita non è ancora stata affidata al worker: viene rimossa insieme all'utente
+                    remove_player_from_game(game_id, user_id);
+                    release_remote_game(game_id);
+                    cleanup_client_lobby(lobby_reactor, client_s, user_id);
+                    goto cleanup;
+                }
+                // Il thread di gioco è già partito: la disconnessione viene gestita da lui alla prima lettura
+            }
+            // La socket passa alla partita solo dopo la risposta, così non ha mai due proprietari
+            reactor_remove(lobby_reactor, client_s);
+            if (workers_enabled()) {
+                workers_hand_over_client(game_id, user_id, client_s, bots_count);
+            } else {
+                hand_player_to_game(game_id, user_id);
             }
-            epoll_ctl(lobby_epoll_fd, EPOLL_CTL_DEL, client_s, NULL);
         }
     } else {
         LOG_WARNING("Nome della partita non fornito");
-        on_malformed_msg(lobby_epoll_fd, user_id, client_s);
+        on_malformed_msg(lobby_reactor, user_id, client_s);
     }
 
 cleanup:
@@ -233,17 +413,89 @@ cleanup:
     free(game_name);
 }
 
+/**
+ * Aggiunge un utente autenticato della lobby a una partita di questo nodo e gli invia la conferma.
+ * Se l'unione alla partita fallisce, invia un messaggio di errore.
+ * @param lobby_reactor Reactor della lobby.
+ * @param user_id ID dell'utente che sta unendosi alla partita.
+ * @param client_s File descriptor della socket del client.
+ * @param username Nome dell'utente.
+ * @param game_id ID della partita.
+ */
+static void join_game(Reactor *lobby_reactor, unsigned int user_id, int client_s, const char *username, unsigned int game_id) {
+    if(add_player_to_game(game_id, user_id) == 0){
+        char *game_name = get_game_name_by_id(game_id);
+        LOG_INFO("Utente %d:`%s` si è unito alla partita %d:`%s`", user_id, username, game_id, game_name);
+        Payload *joinGamePayload = createEmptyPayload();
+        addPayloadKeyValuePair(joinGamePayload, "game_name", game_name);
+        addPayloadKeyValuePairInt(joinGamePayload, "game_id", game_id);
+        free(game_name);
+        if(safeSendMsg(client_s, MSG_GAME_JOINED, joinGamePayload) < 0){
+            LOG_MSG_ERROR("Errore durante l'invio del messaggio di partita unita al client %d:`%s`", user_id, username);
+            // Il thread di gioco non ha ancora ricevuto il giocatore
+            remove_player_from_game(game_id, user_id);
+            cleanup_client_lobby(lobby_reactor, client_s, user_id);
+            return;
+        }
+        // La socket passa alla partita solo dopo la risposta, così non ha mai due proprietari
+        reactor_remove(lobby_reactor, client_s);
+        if (workers_enabled()) {
+            workers_hand_over_client(game_id, user_id, client_s, -1);
+        } else {
+            hand_player_to_game(game_id, user_id);
+        }
+    } else {
+        LOG_ERROR("Errore durante l'unione alla partita %d per l'utente %d.`%s`", game_id, user_id, username);
+        if(safeSendMsg(client_s, MSG_ERROR_JOIN_GAME, NULL) < 0){
+            LOG_MSG_ERROR("Errore durante l'invio del messaggio di errore al client %d:`%s`", user_id, username);
+            cleanup_client_lobby(lobby_reactor, client_s, user_id);
+        }
+    }
+}
+
+/**
+ * Indirizza un client al nodo del cluster che ospita la partita richiesta.
+ * Il client riceve MSG_REDIRECT con l'indirizzo del nodo e un token monouso da presentare
+ * nel login, e chiude la connessione con questo nodo.
+ * @param lobby_reactor Reactor della lobby.
+ * @param user_id ID dell'utente.
+ * @param client_s File descriptor della socket del client.
+ * @param game_id ID della partita.
+ * @param owner Nodo che ospita la partita.
+ */
+static void redirect_to_node(Reactor *lobby_reactor, unsigned int user_id, int client_s, unsigned int game_id, const NodeAddress *owner) {
+    char token[DIRECTORY_TOKEN_SIZE];
+    if (game_directory->issue_token(game_directory, game_id, token) < 0) {
+        if(safeSendMsg(client_s, MSG_ERROR_JOIN_GAME, NULL) < 0){
+            cleanup_client_lobby(lobby_reactor, client_s, user_id);
+        }
+        return;
+    }
+
+    LOG_INFO("Utente %d indirizzato al nodo %s:%d per la partita %d", user_id, owner->host, owner->port, game_id);
+    Payload *redirectPayload = createEmptyPayload();
+    addPayloadKeyValuePair(redirectPayload, "host", owner->host);
+    addPayloadKeyValuePairInt(redirectPayload, "port", owner->port);
+    addPayloadKeyValuePair(redirectPayload, "token", token);
+    addPayloadKeyValuePairInt(redirectPayload, "game_id", game_id);
+    if(safeSendMsg(client_s, MSG_REDIRECT, redirectPayload) < 0){
+        LOG_MSG_ERROR("Errore durante l'invio del messaggio di redirect al client %d", user_id);
+        cleanup_client_lobby(lobby_reactor, client_s, user_id);
+    }
+}
+
 /**
  * Gestisce il messaggio di unione a una partita.
  * Aggiunge il giocatore alla partita specificata e invia un messaggio di conferma al client.
+ * Se la partita è ospitata da un altro nodo del cluster, indirizza il client a quel nodo.
  * Se l'unione alla partita fallisce, invia un messaggio di errore.
- * @param lobby_epoll_fd File descriptor dell'epoll della lobby.
+ * @param lobby_reactor Reactor della lobby.
  * @param user_id ID dell'utente che sta unendosi alla partita.
  * @param client_s File descriptor della socket del client.
  * @param payload Payload del messaggio ricevuto.
  */
-void on_join_game_msg(int lobby_epoll_fd, unsigned int user_id, int client_s, Payload *payload){
-    char *username = require_authentication(lobby_epoll_fd, user_id, client_s);
+void on_join_game_msg(Reactor *lobby_reactor, unsigned int user_id, int client_s, Payload *payload){
+    char *username = require_authentication(lobby_reactor, user_id, client_s);
     if (!username) {
         return; // Client non autenticato, già gestito in require_authentication
     }
@@ -252,33 +504,19 @@ void on_join_game_msg(int lobby_epoll_fd, unsigned int user_id, int client_s, Pa
     if(getPayloadIntValue(payload, 0, "game_id", &game_id) == 0){
         if (game_id < 0) {
             LOG_WARNING("ID della partita non valido: `%d`", game_id);
-            on_malformed_msg(lobby_epoll_fd, user_id, client_s);
+            on_malformed_msg(lobby_reactor, user_id, client_s);
             goto cleanup;
         }
 
-        if(add_player_to_game(game_id, user_id) == 0){
-            char *game_name = get_game_name_by_id(game_id);
-            LOG_INFO("Utente %d:`%s` si è unito alla partita %d:`%s`", user_id, username, game_id, game_name);
-            Payload *joinGamePayload = createEmptyPayload();
-            addPayloadKeyValuePair(joinGamePayload, "game_name", game_name);
-            if(safeSendMsg(client_s, MSG_GAME_JOINED, joinGamePayload) < 0){
-                LOG_MSG_ERROR("Errore durante l'invio del messaggio di partita unita al client %d:`%s`", user_id, username);
-                cleanup_client_lobby(lobby_epoll_fd, client_s, user_id);
-                goto cleanup;
-            }
-            free(game_name);
-            epoll_ctl(lobby_epoll_fd, EPOLL_CTL_DEL, client_s, NULL);
+        NodeAddress owner;
+        if (directory_find_remote_owner(game_id, &owner) == 0) {
+            redirect_to_node(lobby_reactor, user_id, client_s, game_id, &owner);
         } else {
-            LOG_ERROR("Errore durante l'unione alla partita %d per l'utente %d.`%s`", game_id, user_id, username);
-            if(safeSendMsg(client_s, MSG_ERROR_JOIN_GAME, NULL) < 0){
-                LOG_MSG_ERROR("Errore durante l'invio del messaggio di errore al client %d:`%s`", user_id, username);
-                cleanup_client_lobby(lobby_epoll_fd, client_s, user_id);
-                goto cleanup;
-            }
+            join_game(lobby_reactor, user_id, client_s, username, game_id);
         }
     } else {
         LOG_WARNING("ID della partita non fornito o non valido.\n");
-        on_malformed_msg(lobby_epoll_fd, user_id, client_s);
+        on_malformed_msg(lobby_reactor, user_id, client_s);
         goto cleanup;
     }
 
@@ -286,23 +524,55 @@ cleanup:
     free(username);
 }
 
+/**
+ * Gestisce la richiesta di un client locale di scambiare i messaggi in memoria condivisa.
+ * È accolta solo sulle connessioni arrivate dalla socket UNIX e se le connessioni restano in
+ * questo processo (shared_memory_enabled); altrimenti il client riceve
+ * MSG_ERROR_UNEXPECTED_MESSAGE e prosegue sulla socket.
+ * @param lobby_reactor Reactor della lobby.
+ * @param user_id ID dell'utente.
+ * @param client_s File descriptor della socket del client.
+ */
+void on_attach_shared_memory_msg(Reactor *lobby_reactor, unsigned int user_id, int client_s) {
+    struct sockaddr_storage addr;
+    socklen_t addr_len = sizeof(addr);
+    int is_local = getsockname(client_s, (struct sockaddr *)&addr, &addr_len) == 0 && addr.ss_family == AF_UNIX;
+
+    if (shared_memory_enabled && is_local) {
+        // La risposta porta i descrittori del canale in una sendmsg: la socket esce dal reactor,
+        // che con io_uring ne trasmette gli invii, e vi rientra dopo l'attivazione del canale
+        reactor_remove(lobby_reactor, client_s);
+        int offered = shm_offer_channel(client_s) == 0;
+        reactor_add_edge(lobby_reactor, client_s, user_id);
+        if (offered) {
+            LOG_INFO("La connessione %d dell'utente %d usa la memoria condivisa", client_s, user_id);
+            return;
+        }
+    }
+
+    LOG_WARNING("Memoria condivisa non disponibile per la connessione %d", client_s);
+    if (safeSendMsg(client_s, MSG_ERROR_UNEXPECTED_MESSAGE, NULL) < 0) {
+        LOG_MSG_ERROR("Errore durante l'invio del messaggio di errore al client %d", client_s);
+        cleanup_client_lobby(lobby_reactor, client_s, user_id);
+    }
+}
 
 /**
  * Verifica se un client è autenticato prima di procedere con l'elaborazione del messaggio.
  * Se il client non è autenticato, invia un messaggio di errore e chiude la connessione.
- * @param lobby_epoll_fd File descriptor dell'epoll della lobby.
+ * @param lobby_reactor Reactor della lobby.
  * @param user_id ID dell'utente da verificare.
  * @param client_s File descriptor della socket del client.
  * @return Puntatore al nome utente se autenticato, altrimenti NULL.
  */
-char *require_authentication(int lobby_epoll_fd, unsigned int user_id, int client_s) {
+char *require_authentication(Reactor *lobby_reactor, unsigned int user_id, int client_s) {
     char *username = get_username_by_id(user_id);
 
     if(!username){
         LOG_WARNING("Client %d non autenticato", client_s);
         if(safeSendMsg(client_s, MSG_ERROR_NOT_AUTHENTICATED, NULL) < 0){
             LOG_MSG_ERROR("Errore durante l'invio del messaggio di errore al client %d", client_s);
-            cleanup_client_lobby(lobby_epoll_fd, client_s, user_id);
+            cleanup_client_lobby(lobby_reactor, client_s, user_id);
         }
     }
     return username;
@@ -311,16 +581,16 @@ char *require_authentication(int lobby_epoll_fd, unsigned int user_id, int clien
 /**
  * Gestisce un messaggio malformato ricevuto da un client.
  * Invia un messaggio di errore e chiude la connessione del client in caso di errore.
- * @param lobby_epoll_fd File descriptor dell'epoll della lobby.
+ * @param lobby_reactor Reactor della lobby.
  * @param user_id ID dell'utente che ha inviato il messaggio malformato.
  * @param client_s File descriptor della socket del client.
  * @return 0 se l'operazione è andata a buon fine, -1 in caso di errore.
  */
-int on_malformed_msg(int lobby_epoll_fd, unsigned int user_id, int client_s) {
+int on_malformed_msg(Reactor *lobby_reactor, unsigned int user_id, int client_s) {
     // LOG_WARNING("Messaggio malformato ricevuto dal client %d.\n", client_s);
     if(safeSendMsg(client_s, MSG_ERROR_MALFORMED_MESSAGE, NULL) < 0){
         LOG_MSG_ERROR("Errore durante l'invio del messaggio di errore al client %d", client_s);
-        cleanup_client_lobby(lobby_epoll_fd, client_s, user_id);
+        cleanup_client_lobby(lobby_reactor, client_s, user_id);
         return -1;
     }
     return 0;
@@ -329,15 +599,15 @@ int on_malformed_msg(int lobby_epoll_fd, unsigned int user_id, int client_s) {
 /**
  * Gestisce un messaggio non riconosciuto ricevuto da un client.
  * Invia un messaggio di errore e chiude la connessione del client in caso di errore.
- * @param lobby_epoll_fd File descriptor dell'epoll della lobby.
+ * @param lobby_reactor Reactor della lobby.
  * @param user_id ID dell'utente che ha inviato il messaggio non riconosciuto.
  * @param client_s File descriptor della socket del client.
  * @param msg_type Tipo del messaggio non riconosciuto.
  */
-void on_unexpected_msg(int lobby_epoll_fd, unsigned int user_id, int client_s, uint16_t msg_type){
+void on_unexpected_msg(Reactor *lobby_reactor, unsigned int user_id, int client_s, uint16_t msg_type){
     LOG_WARNING("Messaggio non riconosciuto: %d", msg_type);
     if(safeSendMsg(client_s, MSG_ERROR_UNEXPECTED_MESSAGE, NULL) < 0){
         LOG_MSG_ERROR("Errore durante l'invio del messaggio di errore al client %d", client_s);
-        cleanup_client_lobby(lobby_epoll_fd, client_s, user_id);
+        cleanup_client_lobby(lobby_reactor, client_s, user_id);
     }
 }
\ No newline at end of file
@@ -2,17 +2,27 @@
 #define LOBBY_MANAGER_H
 
 #include "common/protocol.h"
+#include "server/reactor.h"
+
+typedef struct {
+    int lobby_pipe_fd; // Estremità di lettura della pipe da cui arrivano le nuove connessioni
+    unsigned int *adopted_users; // Utenti già connessi da gestire all'avvio (ricevuti da un altro processo server)
+    unsigned int adopted_users_count;
+} LobbyThreadArg;
+
+extern int shared_memory_enabled; // 0 se le connessioni possono passare a un altro processo (-handoff, -workers)
 
 void *lobby_thread_main(void *arg);
-void cleanup_client_lobby(int epoll_fd, int client_fd, unsigned int user_id);
+void cleanup_client_lobby(Reactor *reactor, int client_fd, unsigned int user_id);
 
-void on_login_msg(int lobby_epoll_fd, unsigned int user_id, int client_s, Payload *payload);
-void on_create_game_msg(int lobby_epoll_fd, unsigned int user_id, int client_s, Payload *payload);
-void on_join_game_msg(int lobby_epoll_fd, unsigned int user_id, int client_s, Payload *payload);
+void on_login_msg(Reactor *lobby_reactor, unsigned int user_id, int client_s, Payload *payload);
+void on_create_game_msg(Reactor *lobby_reactor, unsigned int user_id, int client_s, Payload *payload);
+void on_join_game_msg(Reactor *lobby_reactor, unsigned int user_id, int client_s, Payload *payload);
+void on_attach_shared_memory_msg(Reactor *lobby_reactor, unsigned int user_id, int client_s);
 
-char *require_authentication(int lobby_epoll_fd, unsigned int user_id, int client_s);
+char *require_authentication(Reactor *lobby_reactor, unsigned int user_id, int client_s);
 
-int on_malformed_msg(int lobby_epoll_fd, unsigned int user_id, int client_s);
-void on_unexpected_msg(int lobby_epoll_fd, unsigned int user_id, int client_s, uint16_t msg_type);
+int on_malformed_msg(Reactor *lobby_reactor, unsigned int user_id, int client_s);
+void on_unexpected_msg(Reactor *lobby_reactor, unsigned int user_id, int client_s, uint16_t msg_type);
 
 #endif // LOBBY_MANAGER_H
\ No newline at end of file
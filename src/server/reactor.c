@@ -0,0 +1,1024 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <time.h>
+
+#include <sys/epoll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#include "server/reactor.h"
+#include "common/protocol.h"
+#include "common/shmTransport.h"
+#include "utils/debug.h"
+
+#define URING_ENTRIES 256 // Voci della coda di invio; quella di completamento è il doppio
+#define URING_IGNORED UINT64_MAX // user_data delle richieste il cui completamento non interessa
+#define URING_SEND_FLAG (UINT64_C(1) << 31) // Nel user_data distingue le SEND dalla recv dello stesso fd
+#define URING_RECV_BUFFERS 256 // Buffer del ring di ricezione, potenza di 2
+#define URING_RECV_BUFFER_SIZE 512 // Byte di ogni buffer: un messaggio più lungo arriva in più completamenti
+#define URING_RECV_GROUP 0 // ID del gruppo di buffer usato dalle recv
+#define URING_REMOVE_EVENTS 64 // Eventi raccolti per volta mentre si attende la fine delle richieste di un fd rimosso
+
+typedef enum {
+    SOURCE_NONE,
+    SOURCE_POLL, // Descrittore con una POLL_ADD da riarmare dopo ogni evento
+    SOURCE_POLL_EDGE, // Descrittore con una POLL_ADD multishot, che segnala ogni arrivo di dati
+    SOURCE_ACCEPT, // Socket in ascolto con un'accept multishot
+    SOURCE_ACCEPT_POLL, // Socket in ascolto su un kernel senza accept multishot: si accetta dopo l'evento
+    SOURCE_RECV // Socket con una recv multishot: i dati arrivano nella coda della connessione, gli invii partono come SEND
+} SourceKind;
+
+typedef struct {
+    uint64_t tag;
+    uint32_t generation; // Distingue i completamenti di una registrazione precedente dello stesso fd
+    uint32_t reported; // Ultima raccolta dei completamenti in cui il descrittore ha prodotto un evento
+    uint8_t kind; // SourceKind
+    uint8_t armed; // 1 se una richiesta per il descrittore è in corso nel kernel
+    uint8_t throttled; // 1 se la recv è stata cancellata perché la coda della connessione è piena
+    uint8_t input_closed; // 1 se la recv è terminata per disconnessione o errore e non va riarmata
+    const char *send_buffer; // Byte della SEND in corso (SOURCE_RECV), NULL se nessuna
+    size_t send_size;
+    size_t send_done; // Byte già trasmessi
+} UringSource;
+
+typedef struct {
+    int ring_fd;
+    void *ring_ptr;
+    size_t ring_size;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned sq_entries;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_cqe *cqes;
+
+    UringSource *sources; // Indicizzate per file descriptor
+    size_t sources_capacity;
+    int *rearm; // Descrittori i cui eventi sono stati restituiti e vanno riarmati
+    size_t rearm_count;
+    size_t rearm_capacity;
+    uint32_t reaps; // Raccolte dei completamenti fatte finora
+
+    struct io_uring_buf_ring *buf_ring; // Buffer a disposizione delle recv, NULL finché non serve
+    char *buffers; // URING_RECV_BUFFERS buffer da URING_RECV_BUFFER_SIZE byte
+    uint16_t buf_tail; // Coda del ring dei buffer, pubblicata al kernel dopo ogni raccolta
+    int recv_unavailable; // 1 se il kernel non offre recv multishot con buffer ring: le socket usano POLL_ADD
+    ConnectionOutputList ready; // Socket con messaggi accodati da inviare alla prossima attesa
+} UringState;
+
+typedef struct {
+    int fd;
+    uint64_t tag;
+    int accepted_fd; // Connessione accettata portata dall'evento, -1 se nessuna
+} DeferredEvent;
+
+struct Reactor {
+    ReactorBackend backend;
+    int epoll_fd; // Backend epoll
+    UringState *uring; // Backend uring
+    DeferredEvent *deferred; // Connessioni con messaggi ancora da leggere, restituite dall'attesa successiva
+    size_t deferred_count;
+    size_t deferred_capacity;
+    uint64_t syscalls; // Chiamate di sistema fatte dal reactor, per i benchmark
+};
+
+ReactorBackend reactor_backend = REACTOR_EPOLL;
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *params) {
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int sys_io_uring_enter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags, void *arg, size_t arg_size) {
+    return (int)syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, arg, arg_size);
+}
+
+static int sys_io_uring_register(int ring_fd, unsigned opcode, void *arg, unsigned nr_args) {
+    return (int)syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args);
+}
+
+static int reactor_defer_event(Reactor *reactor, int fd, uint64_t tag, int accepted_fd);
+
+/**
+ * Crea un io_uring e ne mappa le code.
+ * @return Stato del ring, o NULL se il kernel non offre io_uring con le funzioni richieste.
+ */
+static UringState *uring_open(void) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int ring_fd = sys_io_uring_setup(URING_ENTRIES, &params);
+    if (ring_fd < 0) {
+        return NULL;
+    }
+    // EXT_ARG serve per il timeout dell'attesa, SINGLE_MMAP e NODROP semplificano la gestione delle code
+    unsigned required = IORING_FEAT_EXT_ARG | IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP;
+    if ((params.features & required) != required) {
+        close(ring_fd);
+        errno = ENOSYS;
+        return NULL;
+    }
+
+    UringState *state = (UringState *)calloc(1, sizeof(UringState));
+    if (!state) {
+        close(ring_fd);
+        return NULL;
+    }
+    state->ring_fd = ring_fd;
+
+    size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    state->ring_size = sq_size > cq_size ? sq_size : cq_size;
+    state->ring_ptr = mmap(NULL, state->ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+    state->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    state->sqes = mmap(NULL, state->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+    if (state->ring_ptr == MAP_FAILED || state->sqes == MAP_FAILED) {
+        if (state->ring_ptr != MAP_FAILED) munmap(state->ring_ptr, state->ring_size);
+        if (state->sqes != MAP_FAILED) munmap(state->sqes, state->sqes_size);
+        close(ring_fd);
+        free(state);
+        return NULL;
+    }
+
+    char *ring = (char *)state->ring_ptr;
+    state->sq_head = (unsigned *)(ring + params.sq_off.head);
+    state->sq_tail = (unsigned *)(ring + params.sq_off.tail);
+    state->sq_mask = (unsigned *)(ring + params.sq_off.ring_mask);
+    state->sq_array = (unsigned *)(ring + params.sq_off.array);
+    state->sq_entries = params.sq_entries;
+    state->cq_head = (unsigned *)(ring + params.cq_off.head);
+    state->cq_tail = (unsigned *)(ring + params.cq_off.tail);
+    state->cq_mask = (unsigned *)(ring + params.cq_off.ring_mask);
+    state->cqes = (struct io_uring_cqe *)(ring + params.cq_off.cqes);
+    return state;
+}
+
+static void uring_close(UringState *state) {
+    munmap(state->sqes, state->sqes_size);
+    munmap(state->ring_ptr, state->ring_size);
+    close(state->ring_fd);
+    if (state->buf_ring != NULL) {
+        munmap(state->buf_ring, URING_RECV_BUFFERS * sizeof(struct io_uring_buf));
+        munmap(state->buffers, (size_t)URING_RECV_BUFFERS * URING_RECV_BUFFER_SIZE);
+    }
+    free(state->sources);
+    free(state->rearm);
+    free(state->ready.fds);
+    free(state);
+}
+
+/**
+ * Rimette un buffer di ricezione a disposizione del kernel. Il kernel lo vede quando la coda
+ * del ring viene pubblicata (uring_publish_buffers).
+ */
+static void uring_recycle_buffer(UringState *state, uint16_t bid) {
+    struct io_uring_buf *buf = &state->buf_ring->bufs[state->buf_tail & (URING_RECV_BUFFERS - 1)];
+    buf->addr = (uint64_t)(uintptr_t)(state->buffers + (size_t)bid * URING_RECV_BUFFER_SIZE);
+    buf->len = URING_RECV_BUFFER_SIZE;
+    buf->bid = bid;
+    state->buf_tail++;
+}
+
+static void uring_publish_buffers(UringState *state) {
+    __atomic_store_n(&state->buf_ring->tail, state->buf_tail, __ATOMIC_RELEASE);
+}
+
+/**
+ * Registra il ring dei buffer da cui le recv multishot prendono lo spazio per i dati, alla prima
+ * socket che lo usa: i reactor senza connessioni non lo allocano.
+ * @return 0 in caso di successo, -1 se il kernel non offre i buffer ring o manca la memoria.
+ */
+static int uring_setup_buffers(Reactor *reactor) {
+    UringState *state = reactor->uring;
+    size_t ring_size = URING_RECV_BUFFERS * sizeof(struct io_uring_buf);
+    size_t buffers_size = (size_t)URING_RECV_BUFFERS * URING_RECV_BUFFER_SIZE;
+    void *ring = mmap(NULL, ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    void *buffers = mmap(NULL, buffers_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring == MAP_FAILED || buffers == MAP_FAILED) {
+        if (ring != MAP_FAILED) munmap(ring, ring_size);
+        if (buffers != MAP_FAILED) munmap(buffers, buffers_size);
+        return -1;
+    }
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)ring;
+    reg.ring_entries = URING_RECV_BUFFERS;
+    reg.bgid = URING_RECV_GROUP;
+    reactor->syscalls++;
+    if (sys_io_uring_register(state->ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        munmap(ring, ring_size);
+        munmap(buffers, buffers_size);
+        return -1;
+    }
+
+    state->buf_ring = (struct io_uring_buf_ring *)ring;
+    state->buffers = (char *)buffers;
+    for (uint16_t bid = 0; bid < URING_RECV_BUFFERS; bid++) {
+        uring_recycle_buffer(state, bid);
+    }
+    uring_publish_buffers(state);
+    return 0;
+}
+
+/**
+ * @return SQE preparate e non ancora consumate dal kernel.
+ */
+static unsigned uring_pending(UringState *state) {
+    return *state->sq_tail - __atomic_load_n(state->sq_head, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Invia al kernel le SQE preparate e, se richiesto, attende almeno un completamento.
+ * @param timeout_ms Tempo massimo di attesa in millisecondi, -1 per attendere senza limite.
+ * @return Valore di io_uring_enter.
+ */
+static int uring_enter(Reactor *reactor, unsigned min_complete, int timeout_ms) {
+    UringState *state = reactor->uring;
+    unsigned flags = 0;
+    struct io_uring_getevents_arg arg;
+    struct __kernel_timespec ts;
+    void *arg_ptr = NULL;
+    size_t arg_size = 0;
+    if (min_complete > 0) {
+        flags |= IORING_ENTER_GETEVENTS;
+        if (timeout_ms >= 0) {
+            ts.tv_sec = timeout_ms / 1000;
+            ts.tv_nsec = (long long)(timeout_ms % 1000) * 1000000;
+            memset(&arg, 0, sizeof(arg));
+            arg.ts = (uint64_t)(uintptr_t)&ts;
+            flags |= IORING_ENTER_EXT_ARG;
+            arg_ptr = &arg;
+            arg_size = sizeof(arg);
+        }
+    }
+    reactor->syscalls++;
+    return sys_io_uring_enter(state->ring_fd, uring_pending(state), min_complete, flags, arg_ptr, arg_size);
+}
+
+/**
+ * @return SQE libera in fondo alla coda di invio. Se la coda è piena viene prima inviata al kernel.
+ */
+static struct io_uring_sqe *uring_get_sqe(Reactor *reactor) {
+    UringState *state = reactor->uring;
+    while (uring_pending(state) >= state->sq_entries) {
+        if (uring_enter(reactor, 0, -1) < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            return NULL;
+        }
+    }
+    unsigned tail = *state->sq_tail;
+    unsigned index = tail & *state->sq_mask;
+    struct io_uring_sqe *sqe = &state->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    state->sq_array[index] = index;
+    __atomic_store_n(state->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    return sqe;
+}
+
+static uint64_t source_user_data(int fd, const UringSource *source) {
+    return ((uint64_t)source->generation << 32) | (uint32_t)fd;
+}
+
+/**
+ * Prepara la cancellazione della richiesta con il user_data indicato.
+ */
+static void uring_cancel(Reactor *reactor, uint64_t user_data) {
+    struct io_uring_sqe *sqe = uring_get_sqe(reactor);
+    if (sqe != NULL) {
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = user_data;
+        sqe->user_data = URING_IGNORED;
+    }
+}
+
+/**
+ * Prepara la richiesta che segnala il prossimo evento del descrittore.
+ */
+static int uring_arm(Reactor *reactor, int fd) {
+    UringSource *source = &reactor->uring->sources[fd];
+    struct io_uring_sqe *sqe = uring_get_sqe(reactor);
+    if (sqe == NULL) {
+        return -1;
+    }
+    sqe->fd = fd;
+    sqe->user_data = source_user_data(fd, source);
+    if (source->kind == SOURCE_ACCEPT) {
+        sqe->opcode = IORING_OP_ACCEPT;
+        sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    } else if (source->kind == SOURCE_RECV) {
+        // Ogni completamento porta i dati in un buffer scelto dal kernel nel gruppo URING_RECV_GROUP
+        sqe->opcode = IORING_OP_RECV;
+        sqe->ioprio = IORING_RECV_MULTISHOT;
+        sqe->flags = IOSQE_BUFFER_SELECT;
+        sqe->buf_group = URING_RECV_GROUP;
+    } else {
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->poll32_events = POLLIN;
+        if (source->kind == SOURCE_POLL_EDGE) {
+            sqe->len = IORING_POLL_ADD_MULTI;
+        }
+    }
+    source->armed = 1;
+    return 0;
+}
+
+static int uring_register(Reactor *reactor, int fd, uint64_t tag, SourceKind kind) {
+    UringState *state = reactor->uring;
+    if ((size_t)fd >= state->sources_capacity) {
+        size_t new_capacity = state->sources_capacity ? state->sources_capacity : 64;
+        while (new_capacity <= (size_t)fd) new_capacity *= 2;
+        UringSource *new_sources = (UringSource *)realloc(state->sources, new_capacity * sizeof(UringSource));
+        if (!new_sources) return -1;
+        memset(new_sources + state->sources_capacity, 0, (new_capacity - state->sources_capacity) * sizeof(UringSource));
+        state->sources = new_sources;
+        state->sources_capacity = new_capacity;
+    }
+    UringSource *source = &state->sources[fd];
+    if (source->kind != SOURCE_NONE) {
+        errno = EEXIST;
+        return -1;
+    }
+    source->tag = tag;
+    source->kind = kind;
+    source->armed = 0;
+    source->throttled = 0;
+    source->input_closed = 0;
+    source->send_buffer = NULL;
+    return uring_arm(reactor, fd);
+}
+
+/**
+ * Prepara la SEND dei byte ancora da trasmettere della SEND in corso.
+ */
+static void uring_submit_send(Reactor *reactor, int fd) {
+    UringSource *source = &reactor->uring->sources[fd];
+    struct io_uring_sqe *sqe = uring_get_sqe(reactor);
+    if (sqe == NULL) {
+        // Senza SEND la connessione non può più ricevere le risposte: chi la legge la chiuderà
+        LOG_ERROR("Impossibile preparare l'invio sulla socket %d", fd);
+        closeConnectionInput(fd);
+        return;
+    }
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)(source->send_buffer + source->send_done);
+    sqe->len = (uint32_t)(source->send_size - source->send_done);
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = source_user_data(fd, source) | URING_SEND_FLAG;
+}
+
+/**
+ * Avvia la SEND dei messaggi accodati per una connessione, se non ce n'è già una in corso:
+ * tutti i messaggi accodati dall'invio precedente partono insieme.
+ */
+static void uring_start_send(Reactor *reactor, int fd) {
+    UringState *state = reactor->uring;
+    if (fd < 0 || (size_t)fd >= state->sources_capacity) {
+        return;
+    }
+    UringSource *source = &state->sources[fd];
+    if (source->kind != SOURCE_RECV || source->send_buffer != NULL) {
+        return;
+    }
+    size_t size;
+    const char *buffer = startConnectionSend(fd, &size);
+    if (buffer == NULL) {
+        return;
+    }
+    source->send_buffer = buffer;
+    source->send_size = size;
+    source->send_done = 0;
+    uring_submit_send(reactor, fd);
+}
+
+/**
+ * Restituisce l'evento di un descrittore, al massimo una volta per raccolta: più completamenti
+ * dello stesso descrittore nella stessa raccolta producono un solo evento.
+ * @return 1 se l'evento è stato scritto, 0 se il descrittore è già stato segnalato.
+ */
+static int uring_event(UringState *state, UringSource *source, ReactorEvent *event) {
+    if (source->reported == state->reaps) {
+        return 0;
+    }
+    source->reported = state->reaps;
+    event->tag = source->tag;
+    event->fd = -1;
+    return 1;
+}
+
+static int uring_reap(Reactor *reactor, ReactorEvent *events, int *fds, int max_events);
+
+/**
+ * Attende la fine delle richieste di una socket con SOURCE_RECV e la stacca dal reactor: la recv
+ * viene cancellata, la SEND in corso e i messaggi accodati vengono trasmessi, e i byte ricevuti
+ * restano nella coda della connessione per chi leggerà la socket. Gli eventi degli altri
+ * descrittori raccolti nel frattempo vengono restituiti dall'attesa successiva.
+ */
+static void uring_drain_source(Reactor *reactor, int fd) {
+    UringSource *source = &reactor->uring->sources[fd];
+    if (source->armed) {
+        uring_cancel(reactor, source_user_data(fd, source));
+    }
+    while (source->armed || source->send_buffer != NULL) {
+        if (uring_enter(reactor, 1, -1) < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            LOG_ERROR("Errore in attesa delle richieste della socket %d: %s", fd, strerror(errno));
+            break;
+        }
+        ReactorEvent events[URING_REMOVE_EVENTS];
+        int fds[URING_REMOVE_EVENTS];
+        int count = uring_reap(reactor, events, fds, URING_REMOVE_EVENTS);
+        for (int n = 0; n < count; n++) {
+            if (fds[n] != fd) {
+                reactor_defer_event(reactor, fds[n], events[n].tag, events[n].fd);
+            }
+        }
+    }
+    detachConnectionQueue(fd, 0);
+}
+
+static void uring_unregister(Reactor *reactor, int fd) {
+    UringState *state = reactor->uring;
+    if (fd < 0 || (size_t)fd >= state->sources_capacity || state->sources[fd].kind == SOURCE_NONE) {
+        return;
+    }
+    UringSource *source = &state->sources[fd];
+    if (source->kind == SOURCE_RECV) {
+        uring_drain_source(reactor, fd);
+    } else if (source->armed) {
+        struct io_uring_sqe *sqe = uring_get_sqe(reactor);
+        if (sqe != NULL) {
+            sqe->opcode = source->kind == SOURCE_ACCEPT ? IORING_OP_ASYNC_CANCEL : IORING_OP_POLL_REMOVE;
+            sqe->fd = -1;
+            sqe->addr = source_user_data(fd, source);
+            sqe->user_data = URING_IGNORED;
+        }
+    }
+    // Gli eventi della registrazione rimossa, anche se già in coda, non vengono più restituiti
+    source->generation++;
+    source->kind = SOURCE_NONE;
+    source->armed = 0;
+    source->send_buffer = NULL;
+}
+
+static int uring_push_rearm(UringState *state, int fd) {
+    if (state->rearm_count == state->rearm_capacity) {
+        size_t new_capacity = state->rearm_capacity ? state->rearm_capacity * 2 : 64;
+        int *new_rearm = (int *)realloc(state->rearm, new_capacity * sizeof(int));
+        if (!new_rearm) return -1;
+        state->rearm = new_rearm;
+        state->rearm_capacity = new_capacity;
+    }
+    state->rearm[state->rearm_count++] = fd;
+    return 0;
+}
+
+/**
+ * Gestisce il completamento della recv multishot di una socket: i dati vengono copiati nella
+ * coda della connessione e il buffer torna al kernel alla fine della raccolta.
+ * @return 1 se è stato scritto un evento, 0 altrimenti.
+ */
+static int uring_complete_recv(Reactor *reactor, int fd, const struct io_uring_cqe *cqe, ReactorEvent *event) {
+    UringState *state = reactor->uring;
+    UringSource *source = &state->sources[fd];
+    int more = (cqe->flags & IORING_CQE_F_MORE) != 0;
+    if (!more) {
+        source->armed = 0;
+    }
+
+    if (cqe->res > 0) {
+        const char *data = state->buffers + (size_t)(cqe->flags >> IORING_CQE_BUFFER_SHIFT) * URING_RECV_BUFFER_SIZE;
+        if (pushConnectionInput(fd, data, (size_t)cqe->res) < 0) {
+            LOG_WARNING("Il client della socket %d ha inviato troppi byte senza attendere le risposte", fd);
+            closeConnectionInput(fd);
+            source->input_closed = 1;
+            if (more) uring_cancel(reactor, source_user_data(fd, source));
+        } else if (more && !source->throttled && pendingConnectionInput(fd) > CONNECTION_INPUT_LIMIT) {
+            // Si smette di ricevere finché chi legge la connessione non svuota la coda
+            source->throttled = 1;
+            uring_cancel(reactor, source_user_data(fd, source));
+        }
+        if (!more && !source->input_closed) {
+            uring_push_rearm(state, fd);
+        }
+        return uring_event(state, source, event);
+    }
+
+    if (cqe->res == -ENOBUFS || cqe->res == -ECANCELED) {
+        // Buffer esauriti o coda piena: i dati restano nella socket e la recv riparte alla prossima attesa
+        if (!source->input_closed) uring_push_rearm(state, fd);
+        return 0;
+    }
+    if (cqe->res == -EINVAL && !source->input_closed) {
+        LOG_WARNING("Recv multishot non disponibile, le socket vengono controllate con poll");
+        state->recv_unavailable = 1;
+        if (source->send_buffer == NULL) {
+            detachConnectionQueue(fd, 0);
+            source->kind = SOURCE_POLL_EDGE;
+        }
+        uring_push_rearm(state, fd);
+        return uring_event(state, source, event);
+    }
+
+    // 0 byte (disconnessione) o errore: letto ciò che è in coda, la prossima lettura fallisce
+    closeConnectionInput(fd);
+    source->input_closed = 1;
+    return uring_event(state, source, event);
+}
+
+/**
+ * Gestisce il completamento di una SEND: i byte rimasti vengono inviati di nuovo, poi partono i
+ * messaggi accodati nel frattempo.
+ * @return 1 se è stato scritto un evento (invio fallito), 0 altrimenti.
+ */
+static int uring_complete_send(Reactor *reactor, int fd, int res, ReactorEvent *event) {
+    UringState *state = reactor->uring;
+    UringSource *source = &state->sources[fd];
+    if (source->send_buffer == NULL) {
+        return 0;
+    }
+    if (res > 0) {
+        source->send_done += (size_t)res;
+        if (source->send_done < source->send_size) {
+            uring_submit_send(reactor, fd);
+            return 0;
+        }
+    }
+
+    source->send_buffer = NULL;
+    finishConnectionSend(fd);
+    if (res <= 0) {
+        // Il client non riceve più: chi legge la connessione la chiuderà
+        closeConnectionInput(fd);
+        return uring_event(state, source, event);
+    }
+    uring_start_send(reactor, fd);
+    return 0;
+}
+
+/**
+ * Traduce un completamento in un evento.
+ * @param fd_out Puntatore per il descrittore registrato a cui appartiene l'evento.
+ * @return 1 se è stato scritto un evento, 0 altrimenti.
+ */
+static int uring_complete(Reactor *reactor, const struct io_uring_cqe *cqe, ReactorEvent *event, int *fd_out) {
+    UringState *state = reactor->uring;
+    if (cqe->user_data == URING_IGNORED) {
+        return 0;
+    }
+    int fd = (int)((uint32_t)cqe->user_data & ~(uint32_t)URING_SEND_FLAG);
+    uint32_t generation = (uint32_t)(cqe->user_data >> 32);
+    if ((size_t)fd >= state->sources_capacity) {
+        return 0;
+    }
+    UringSource *source = &state->sources[fd];
+    if (source->kind == SOURCE_NONE || source->generation != generation) {
+        return 0; // Completamento di una registrazione già rimossa
+    }
+    *fd_out = fd;
+
+    if (cqe->user_data & URING_SEND_FLAG) {
+        return uring_complete_send(reactor, fd, cqe->res, event);
+    }
+    if (source->kind == SOURCE_RECV) {
+        return uring_complete_recv(reactor, fd, cqe, event);
+    }
+
+    if (source->kind == SOURCE_ACCEPT) {
+        if (!(cqe->flags & IORING_CQE_F_MORE)) {
+            source->armed = 0;
+            if (cqe->res == -EINVAL) {
+                LOG_WARNING("Accept multishot non disponibile, la socket %d viene controllata con poll", fd);
+                source->kind = SOURCE_ACCEPT_POLL;
+            }
+            uring_push_rearm(state, fd);
+        }
+        if (cqe->res < 0) {
+            return 0;
+        }
+        event->tag = source->tag;
+        event->fd = cqe->res;
+        return 1;
+    }
+
+    if (source->kind == SOURCE_POLL_EDGE) {
+        // La POLL_ADD multishot resta attiva finché il kernel non la chiude (senza F_MORE)
+        if (!(cqe->flags & IORING_CQE_F_MORE)) {
+            source->armed = 0;
+            uring_push_rearm(state, fd);
+        }
+    } else {
+        // POLL_ADD singola: il descrittore viene riarmato alla prossima attesa, dopo che il
+        // chiamante ha gestito l'evento, così resta segnalato finché ha dati da leggere
+        source->armed = 0;
+        uring_push_rearm(state, fd);
+    }
+    return cqe->res >= 0 ? uring_event(state, source, event) : 0;
+}
+
+/**
+ * Raccoglie i completamenti disponibili e li traduce in eventi.
+ * @param fds Array per il descrittore registrato di ogni evento, NULL se non serve.
+ * @return Numero di eventi scritti in `events`.
+ */
+static int uring_reap(Reactor *reactor, ReactorEvent *events, int *fds, int max_events) {
+    UringState *state = reactor->uring;
+    unsigned head = *state->cq_head;
+    unsigned tail = __atomic_load_n(state->cq_tail, __ATOMIC_ACQUIRE);
+    uint16_t buf_tail = state->buf_tail;
+    int count = 0;
+    state->reaps++;
+
+    while (head != tail && count < max_events) {
+        struct io_uring_cqe *cqe = &state->cqes[head & *state->cq_mask];
+        head++;
+        int fd = -1;
+        if (uring_complete(reactor, cqe, &events[count], &fd)) {
+            if (fds != NULL) fds[count] = fd;
+            count++;
+        }
+        if (cqe->flags & IORING_CQE_F_BUFFER) {
+            // Anche i dati di una registrazione rimossa occupano un buffer da restituire
+            uring_recycle_buffer(state, (uint16_t)(cqe->flags >> IORING_CQE_BUFFER_SHIFT));
+        }
+    }
+
+    if (state->buf_tail != buf_tail) {
+        uring_publish_buffers(state);
+    }
+    __atomic_store_n(state->cq_head, head, __ATOMIC_RELEASE);
+    return count;
+}
+
+/**
+ * @return 1 se un evento del descrittore è in coda (reactor_defer) o viene restituito dall'attesa in corso.
+ */
+static int reactor_is_deferred(const Reactor *reactor, int fd) {
+    for (size_t i = 0; i < reactor->deferred_count; i++) {
+        if (reactor->deferred[i].fd == fd) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Riarma i descrittori i cui eventi sono già stati gestiti dal chiamante. Un descrittore con un
+ * evento ancora in coda aspetta: una POLL_ADD riarmata prima della lettura segnalerebbe di
+ * nuovo gli stessi dati.
+ */
+static void uring_rearm(Reactor *reactor) {
+    UringState *state = reactor->uring;
+    size_t kept = 0;
+    for (size_t i = 0; i < state->rearm_count; i++) {
+        int fd = state->rearm[i];
+        UringSource *source = &state->sources[fd];
+        if (source->kind == SOURCE_NONE || source->armed || (source->kind == SOURCE_RECV && source->input_closed)) {
+            continue;
+        }
+        if (reactor_is_deferred(reactor, fd) ||
+            (source->kind == SOURCE_RECV && pendingConnectionInput(fd) > CONNECTION_INPUT_LIMIT / 2)) {
+            state->rearm[kept++] = fd; // Evento da gestire o coda ancora piena: si riprova alla prossima attesa
+            continue;
+        }
+        source->throttled = 0;
+        uring_arm(reactor, fd);
+    }
+    state->rearm_count = kept;
+}
+
+static int uring_wait(Reactor *reactor, ReactorEvent *events, int max_events, int timeout_ms) {
+    UringState *state = reactor->uring;
+    uring_rearm(reactor);
+
+    // I messaggi accodati dalle risposte partono con la stessa io_uring_enter dell'attesa
+    for (size_t i = 0; i < state->ready.count; i++) {
+        uring_start_send(reactor, state->ready.fds[i]);
+    }
+    state->ready.count = 0;
+
+    struct timespec deadline;
+    if (timeout_ms >= 0) {
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += timeout_ms / 1000;
+        deadline.tv_nsec += (long)(timeout_ms % 1000) * 1000000;
+        if (deadline.tv_nsec >= 1000000000) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000;
+        }
+    }
+
+    while (1) {
+        int count = uring_reap(reactor, events, NULL, max_events);
+        if (count > 0) {
+            // Senza attendere, le richieste preparate partono comunque prima di tornare al chiamante
+            if (uring_pending(state) > 0) uring_enter(reactor, 0, -1);
+            return count;
+        }
+
+        int remaining_ms = -1;
+        if (timeout_ms >= 0) {
+            struct timespec now;
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            long long left = (deadline.tv_sec - now.tv_sec) * 1000LL + (deadline.tv_nsec - now.tv_nsec) / 1000000;
+            if (left <= 0) {
+                // Invia comunque le richieste in sospeso, come farebbe l'attesa
+                if (uring_pending(state) > 0) uring_enter(reactor, 0, -1);
+                return 0;
+            }
+            remaining_ms = (int)left;
+        }
+
+        // I completamenti senza evento (registrazioni rimosse, recv senza buffer) non contano: i
+        // descrittori da riarmare ripartono subito e si riattende il tempo rimasto
+        uring_rearm(reactor);
+        if (uring_enter(reactor, 1, remaining_ms) < 0 && errno != ETIME && errno != EAGAIN && errno != EBUSY) {
+            return -1;
+        }
+    }
+}
+
+/**
+ * Sceglie il backend dei reactor. Se io_uring non è disponibile si resta su epoll.
+ * @param name "epoll" o "uring".
+ * @return 0 in caso di successo, -1 se il nome non è riconosciuto.
+ */
+int reactor_select_backend(const char *name) {
+    if (strcmp(name, "epoll") == 0) {
+        reactor_backend = REACTOR_EPOLL;
+        return 0;
+    }
+    if (strcmp(name, "uring") != 0) {
+        LOG_ERROR("Backend del reactor `%s` non riconosciuto (epoll o uring)", name);
+        return -1;
+    }
+
+    UringState *probe = uring_open();
+    if (probe == NULL) {
+        LOG_WARNING("io_uring non disponibile (%s), il server usa epoll", strerror(errno));
+        reactor_backend = REACTOR_EPOLL;
+        return 0;
+    }
+    uring_close(probe);
+    LOG_WARNING("Il backend uring è sperimentale, epoll resta quello predefinito");
+    reactor_backend = REACTOR_URING;
+    return 0;
+}
+
+const char *reactor_backend_name(void) {
+    return reactor_backend == REACTOR_URING ? "uring" : "epoll";
+}
+
+/**
+ * Crea un reactor con il backend scelto. Ogni reactor va usato da un solo thread.
+ * @return Reactor creato, o NULL in caso di errore.
+ */
+Reactor *reactor_create(void) {
+    Reactor *reactor = (Reactor *)calloc(1, sizeof(Reactor));
+    if (!reactor) return NULL;
+    reactor->backend = reactor_backend;
+    reactor->epoll_fd = -1;
+
+    if (reactor->backend == REACTOR_URING) {
+        reactor->uring = uring_open();
+        if (reactor->uring == NULL) {
+            LOG_WARNING("Creazione dell'io_uring fallita (%s), il reactor usa epoll", strerror(errno));
+            reactor->backend = REACTOR_EPOLL;
+        }
+    }
+    if (reactor->backend == REACTOR_EPOLL) {
+        reactor->epoll_fd = epoll_create1(0);
+        if (reactor->epoll_fd < 0) {
+            free(reactor);
+            return NULL;
+        }
+    }
+    return reactor;
+}
+
+/**
+ * Registra un descrittore: il tag viene restituito da reactor_wait quando è leggibile.
+ * @return 0 in caso di successo, -1 in caso di errore.
+ */
+int reactor_add(Reactor *reactor, int fd, uint64_t tag) {
+    if (reactor->backend == REACTOR_URING) {
+        return uring_register(reactor, fd, tag, SOURCE_POLL);
+    }
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.u64 = tag;
+    reactor->syscalls++;
+    return epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+/**
+ * Sceglie come il backend uring controlla una socket registrata con reactor_add_edge: con una
+ * recv multishot se il kernel la offre, altrimenti con una POLL_ADD multishot. Le socket con un
+ * canale in memoria condivisa usano sempre la POLL_ADD, perché sulla socket arrivano solo i
+ * byte di risveglio che il trasporto legge da sé.
+ */
+static SourceKind uring_edge_kind(Reactor *reactor, int fd) {
+    UringState *state = reactor->uring;
+    if (state->recv_unavailable || shm_is_channel(fd)) {
+        return SOURCE_POLL_EDGE;
+    }
+    if (state->buf_ring == NULL && uring_setup_buffers(reactor) < 0) {
+        LOG_WARNING("Buffer ring di io_uring non disponibile (%s), le socket vengono controllate con poll", strerror(errno));
+        state->recv_unavailable = 1;
+        return SOURCE_POLL_EDGE;
+    }
+    return attachConnectionQueue(fd, &state->ready) == 0 ? SOURCE_RECV : SOURCE_POLL_EDGE;
+}
+
+/**
+ * Registra una socket in modalità edge-triggered: il tag viene restituito quando arrivano nuovi
+ * dati, e chi lo riceve deve leggere finché la socket non è vuota (o rimetterla in coda con
+ * reactor_defer). Se la connessione ha già byte ricevuti da leggere (da un altro reactor o da un
+ * altro processo) il tag viene restituito dalla prossima attesa.
+ * @return 0 in caso di successo, -1 in caso di errore.
+ */
+int reactor_add_edge(Reactor *reactor, int fd, uint64_t tag) {
+    int result;
+    if (reactor->backend == REACTOR_URING) {
+        SourceKind kind = uring_edge_kind(reactor, fd);
+        result = uring_register(reactor, fd, tag, kind);
+        if (result < 0 && kind == SOURCE_RECV) {
+            detachConnectionQueue(fd, 0);
+        }
+    } else {
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLET;
+        ev.data.u64 = tag;
+        reactor->syscalls++;
+        result = epoll_ctl(reactor->epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+    }
+    if (result == 0 && pendingConnectionInput(fd) > 0) {
+        reactor_defer(reactor, fd, tag); // Nessun nuovo dato la segnalerebbe
+    }
+    return result;
+}
+
+/**
+ * Registra una socket in ascolto. Con il backend uring le connessioni vengono accettate dal
+ * kernel e ogni evento ne porta una in `fd`; altrimenti l'evento ha `fd` a -1 e va chiamata accept.
+ * @return 0 in caso di successo, -1 in caso di errore.
+ */
+int reactor_add_listener(Reactor *reactor, int fd, uint64_t tag) {
+    if (reactor->backend == REACTOR_URING) {
+        return uring_register(reactor, fd, tag, SOURCE_ACCEPT);
+    }
+    return reactor_add(reactor, fd, tag);
+}
+
+/**
+ * Rimuove un descrittore. Dopo la chiamata il suo tag non viene più restituito, anche se il
+ * descrittore passa a un altro reactor o viene chiuso. Una socket ricevuta con io_uring viene
+ * staccata dal reactor prima di ritornare: i messaggi accodati sono già stati inviati e i byte
+ * ricevuti restano da leggere per il prossimo reactor o thread che la legge.
+ */
+void reactor_remove(Reactor *reactor, int fd) {
+    for (size_t i = 0; i < reactor->deferred_count; ) {
+        if (reactor->deferred[i].fd == fd) {
+            reactor->deferred[i] = reactor->deferred[--reactor->deferred_count];
+        } else {
+            i++;
+        }
+    }
+    if (reactor->backend == REACTOR_URING) {
+        uring_unregister(reactor, fd);
+        return;
+    }
+    reactor->syscalls++;
+    epoll_ctl(reactor->epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+}
+
+/**
+ * Rimette in coda una connessione che ha ancora messaggi da leggere dopo aver esaurito il
+ * proprio budget: l'attesa successiva la restituisce senza bloccarsi.
+ * @return 0 in caso di successo, -1 in caso di errore.
+ */
+int reactor_defer(Reactor *reactor, int fd, uint64_t tag) {
+    return reactor_defer_event(reactor, fd, tag, -1);
+}
+
+/**
+ * Rimette in coda un evento, anche di una socket in ascolto con la connessione accettata.
+ * @param fd Descrittore registrato a cui appartiene l'evento.
+ * @param accepted_fd Connessione portata dall'evento, -1 se nessuna.
+ */
+static int reactor_defer_event(Reactor *reactor, int fd, uint64_t tag, int accepted_fd) {
+    if (reactor->deferred_count == reactor->deferred_capacity) {
+        size_t new_capacity = reactor->deferred_capacity ? reactor->deferred_capacity * 2 : 16;
+        DeferredEvent *new_deferred = (DeferredEvent *)realloc(reactor->deferred, new_capacity * sizeof(DeferredEvent));
+        if (!new_deferred) return -1;
+        reactor->deferred = new_deferred;
+        reactor->deferred_capacity = new_capacity;
+    }
+    reactor->deferred[reactor->deferred_count].fd = fd;
+    reactor->deferred[reactor->deferred_count].tag = tag;
+    reactor->deferred[reactor->deferred_count].accepted_fd = accepted_fd;
+    reactor->deferred_count++;
+    return 0;
+}
+
+/**
+ * @return 1 se tra i primi `count` eventi c'è già quello di una connessione con lo stesso tag.
+ */
+static int reactor_has_event(const ReactorEvent *events, int count, const ReactorEvent *event) {
+    if (event->fd >= 0) {
+        return 0; // Ogni connessione accettata è un evento a sé
+    }
+    for (int n = 0; n < count; n++) {
+        if (events[n].tag == event->tag && events[n].fd < 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int backend_wait(Reactor *reactor, ReactorEvent *events, int max_events, int timeout_ms) {
+    if (reactor->backend == REACTOR_URING) {
+        return uring_wait(reactor, events, max_events, timeout_ms);
+    }
+
+    struct epoll_event epoll_events[max_events];
+    reactor->syscalls++;
+    int nfds = epoll_wait(reactor->epoll_fd, epoll_events, max_events, timeout_ms);
+    for (int n = 0; n < nfds; n++) {
+        events[n].tag = epoll_events[n].data.u64;
+        events[n].fd = -1;
+    }
+    return nfds;
+}
+
+/**
+ * Attende che almeno un descrittore registrato sia leggibile.
+ * Le connessioni rimesse in coda con reactor_defer vengono restituite per prime, insieme agli
+ * eventi già pronti, senza attendere. Un evento pronto di una connessione già in coda viene
+ * scartato: ogni connessione compare una sola volta per attesa, così non viene letta di nuovo
+ * dopo che la prima lettura l'ha passata a un altro thread.
+ * @param timeout_ms Tempo massimo di attesa in millisecondi, -1 per attendere senza limite.
+ * @return Numero di eventi scritti in `events`, 0 allo scadere del timeout, -1 in caso di errore.
+ */
+int reactor_wait(Reactor *reactor, ReactorEvent *events, int max_events, int timeout_ms) {
+    if (reactor->deferred_count == 0) {
+        return backend_wait(reactor, events, max_events, timeout_ms);
+    }
+
+    size_t taken = 0;
+    int count = 0;
+    while (taken < reactor->deferred_count && count < max_events) {
+        ReactorEvent event = {reactor->deferred[taken].tag, reactor->deferred[taken].accepted_fd};
+        taken++;
+        if (!reactor_has_event(events, count, &event)) {
+            events[count++] = event;
+        }
+    }
+    if (count < max_events) {
+        // Gli eventi presi restano in coda durante l'attesa, così il backend non riarma i loro descrittori
+        int deferred = count;
+        int nfds = backend_wait(reactor, events + count, max_events - count, 0);
+        for (int n = 0; n < nfds; n++) {
+            if (!reactor_has_event(events, deferred, &events[deferred + n])) {
+                events[count++] = events[deferred + n];
+            }
+        }
+    }
+    reactor->deferred_count -= taken;
+    memmove(reactor->deferred, reactor->deferred + taken, reactor->deferred_count * sizeof(DeferredEvent));
+    return count;
+}
+
+/**
+ * @return Chiamate di sistema fatte finora dal reactor per registrare, rimuovere e attendere.
+ */
+uint64_t reactor_syscalls(const Reactor *reactor) {
+    return reactor->syscalls;
+}
+
+/**
+ * Distrugge il reactor. Le socket ricevute con io_uring vengono prima staccate come con
+ * reactor_remove, così possono passare a un altro thread o processo.
+ */
+void reactor_destroy(Reactor *reactor) {
+    if (reactor == NULL) return;
+    if (reactor->uring != NULL) {
+        for (size_t fd = 0; fd < reactor->uring->sources_capacity; fd++) {
+            if (reactor->uring->sources[fd].kind == SOURCE_RECV) {
+                uring_unregister(reactor, (int)fd);
+            }
+        }
+        uring_close(reactor->uring);
+    }
+    if (reactor->epoll_fd >= 0) {
+        close(reactor->epoll_fd);
+    }
+    free(reactor->deferred);
+    free(reactor);
+}
@@ -0,0 +1,65 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <stdint.h>
+
+/**
+ * Attesa di eventi sui file descriptor, usata dal thread della lobby, dai thread di gioco e dal
+ * thread principale che accetta le connessioni.
+ * Ogni file descriptor viene registrato con un tag (l'ID dell'utente, o un valore riservato per
+ * pipe e canali) che viene restituito quando il descrittore ha dati da leggere. Come con epoll in
+ * modalità level-triggered, un descrittore viene segnalato finché resta leggibile.
+ *
+ * Il backend si sceglie all'avvio con `-reactor epoll|uring`:
+ * - epoll: epoll_ctl per registrare e rimuovere, epoll_wait per attendere;
+ * - uring: un io_uring per ogni reactor, senza liburing. Le richieste sono SQE inviate insieme
+ *   all'attesa successiva, nella stessa io_uring_enter; i descrittori registrati con reactor_add
+ *   hanno una POLL_ADD che viene riarmata dopo che il loro evento è stato gestito, così vengono
+ *   segnalati di nuovo finché restano leggibili. Le socket in ascolto usano un'accept multishot:
+ *   l'evento porta già la nuova connessione.
+ * Se il kernel non offre io_uring (o le funzioni richieste) il server prosegue con epoll.
+ * Il backend uring è sperimentale e epoll resta quello predefinito (vedi README).
+ *
+ * Le socket dei client si registrano con reactor_add_edge: vengono segnalate solo quando arrivano
+ * nuovi dati, e chi riceve l'evento legge tutti i messaggi disponibili fino a
+ * REACTOR_CONNECTION_BUDGET. Se la connessione ne ha ancora, la si rimette in coda con
+ * reactor_defer: verrà restituita dall'attesa successiva, che non si blocca, dopo che gli altri
+ * client pronti sono stati serviti. Con epoll la socket è registrata con EPOLLET. Con io_uring ha
+ * una recv multishot che prende i buffer da un buffer ring e copia i dati nella coda di ingresso
+ * della connessione (protocol.c): le letture non fanno chiamate di sistema, e i messaggi inviati
+ * sulla connessione vengono accodati e partono come SEND alla prossima attesa. reactor_remove
+ * attende la fine di recv e SEND, invia le risposte rimaste e lascia alla connessione i byte
+ * ricevuti e non letti. Le socket con un canale in memoria condivisa, e tutte se il kernel non
+ * offre la recv multishot, usano una POLL_ADD multishot.
+ */
+
+#define REACTOR_CONNECTION_BUDGET 8 // Messaggi letti da una connessione per ogni evento
+
+typedef enum {
+    REACTOR_EPOLL,
+    REACTOR_URING
+} ReactorBackend;
+
+typedef struct Reactor Reactor;
+
+typedef struct {
+    uint64_t tag;
+    int fd; // Connessione già accettata da una socket in ascolto (backend uring), -1 altrimenti
+} ReactorEvent;
+
+extern ReactorBackend reactor_backend; // Backend dei reactor creati da qui in avanti
+
+int reactor_select_backend(const char *name);
+const char *reactor_backend_name(void);
+
+Reactor *reactor_create(void);
+int reactor_add(Reactor *reactor, int fd, uint64_t tag);
+int reactor_add_edge(Reactor *reactor, int fd, uint64_t tag);
+int reactor_add_listener(Reactor *reactor, int fd, uint64_t tag);
+void reactor_remove(Reactor *reactor, int fd);
+int reactor_defer(Reactor *reactor, int fd, uint64_t tag);
+int reactor_wait(Reactor *reactor, ReactorEvent *events, int max_events, int timeout_ms);
+uint64_t reactor_syscalls(const Reactor *reactor);
+void reactor_destroy(Reactor *reactor);
+
+#endif // REACTOR_H
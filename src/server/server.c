@@ -5,72 +5,261 @@
 
 #include <sys/socket.h>     // socket definitions
 #include <sys/types.h>      // socket types
+#include <sys/un.h>
 #include <arpa/inet.h>      // inet (3) functions
 #include <unistd.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <netdb.h>
 
 #include <pthread.h>
-#include <sys/epoll.h>
 #include <errno.h>
+#include <sys/stat.h>
+#include <time.h>
 
 #include "utils/cmdLineParser.h"
 #include "utils/debug.h"
 #include "common/protocol.h"
 #include "server/users.h"
 #include "server/lobbyManager.h"
+#include "server/gameManager.h"
+#include "server/checkpoint.h"
+#include "server/handoff.h"
+#include "server/workers.h"
+#include "server/gameDirectory.h"
+#include "server/reactor.h"
+#include "server/adminSocket.h"
+#include "server/flightRecorder.h"
+#include "common/metrics.h"
+#include "common/trace.h"
 
-void *lobby_thread_main(void *arg);
+#define MAX_ACCEPT_EVENTS 64
+#define LISTEN_TAG 0 // Tag della socket in ascolto nel reactor del thread principale
+#define HANDOFF_TAG 1 // Tag della socket di passaggio
+#define UNIX_TAG 2 // Tag della socket UNIX per i client locali
+#define DRAIN_TAG 3 // Tag della pipe con cui la socket di amministrazione avvia lo spegnimento
+#define DRAIN_CHECK_MS 1000 // Intervallo tra i controlli delle partite rimaste durante lo spegnimento
+
+/**
+ * Crea la socket UNIX su cui si collegano i client locali, sostituendo quella lasciata da
+ * un'esecuzione precedente.
+ * @param path Percorso della socket.
+ * @return La socket in ascolto, o -1 in caso di errore.
+ */
+static int listen_unix(const char *path) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        LOG_ERROR("Percorso della socket UNIX troppo lungo: `%s`", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    int unix_s = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (unix_s < 0) {
+        LOG_ERROR("Errore nella creazione della socket UNIX: %s", strerror(errno));
+        return -1;
+    }
+    unlink(path);
+    if (bind(unix_s, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(unix_s, 1024) < 0) {
+        LOG_ERROR("Impossibile ascoltare sulla socket UNIX `%s`: %s", path, strerror(errno));
+        close(unix_s);
+        return -1;
+    }
+    return unix_s;
+}
 
 int main(int argc, char *argv[]){
     signal(SIGPIPE, SIG_IGN);
 
     init_lists();
 
-    ArgvParam *allowedArgs = setArgvParams("RVport");
+    ArgvParam *allowedArgs = setArgvParams("RVport,-Vjournal,-Vcheckpoint,-Vhandoff,-Vworkers,-Vworker,-Vdirectory,-Vnode,-Vreactor,-Vunix,-Vadmin,-Vtrace,-Vloglevel");
     parseCmdLine(argc, argv, allowedArgs);
+    char *endPtr;
 
-    char *portString = getArgvParamValue("port", allowedArgs);
+    char *log_level = getArgvParamValue("loglevel", allowedArgs);
+    if (log_level != NULL && log_set_level(log_level) < 0) {
+        LOG_ERROR("Livello di log `%s` non riconosciuto, usa debug, info, warning o error", log_level);
+        exit(EXIT_FAILURE);
+    }
+    // I messaggi di log vengono scritti da un thread dedicato, chi li registra non si blocca (vedi asyncLog.h)
+    if (log_async_start() < 0) {
+        LOG_WARNING("Impossibile avviare il thread di scrittura dei log, i messaggi verranno scritti subito");
+    }
 
-    char *endPtr;
+    // Gli ultimi eventi di ogni partita vengono scritti in caso di crash (vedi flightRecorder.h)
+    flight_init();
+
+    // SIGUSR2 esporta la traccia (vedi trace.h): il segnale va bloccato prima di creare i thread.
+    // I worker eseguono di nuovo il server e avviano il proprio thread
+    if (trace_start_signal_thread() < 0) {
+        LOG_WARNING("Impossibile gestire SIGUSR2, la traccia si potrà esportare solo dalla socket di amministrazione");
+    }
+    char *trace_string = getArgvParamValue("trace", allowedArgs);
+    if (trace_string != NULL) {
+        long sample_rate = strtol(trace_string, &endPtr, 0);
+        if (*endPtr || sample_rate < 0) {
+            LOG_ERROR("Frequenza di campionamento del tracing non riconosciuta");
+            exit(EXIT_FAILURE);
+        }
+        trace_set_sample_rate((int)sample_rate);
+    }
+
+    char *portString = getArgvParamValue("port", allowedArgs);
     long port = strtol(portString, &endPtr, 0);
     if ( *endPtr ) {
         LOG_ERROR("Porta non riconosciuta");
         exit(EXIT_FAILURE);
     }
 
-    struct sockaddr_in servaddr;
-    memset(&servaddr, 0, sizeof(servaddr));
-    servaddr.sin_family = AF_INET;
-    servaddr.sin_addr.s_addr = htonl(INADDR_ANY);
-    servaddr.sin_port = htons(port);
-
-
-    /*  Create the listening socket  */
-    int list_s;
-    if((list_s = socket(AF_INET, SOCK_STREAM, 0)) < 0){
-        LOG_ERROR("Errore nella creazione della socket");
+    journal_dir = getArgvParamValue("journal", allowedArgs);
+    if (journal_dir != NULL && mkdir(journal_dir, 0755) < 0 && errno != EEXIST) {
+        LOG_ERROR("Impossibile creare la directory dei journal `%s`: %s", journal_dir, strerror(errno));
         exit(EXIT_FAILURE);
     }
 
-    int optval = 1;
-    if (setsockopt(list_s, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval)) < 0) {
-        LOG_ERROR("Errore in setsockopt SO_REUSEADDR");
+    // Il backend vale per tutti i reactor del processo, compresi quelli dei worker che ricevono gli stessi argomenti
+    char *reactor_string = getArgvParamValue("reactor", allowedArgs);
+    if (reactor_string != NULL && reactor_select_backend(reactor_string) < 0) {
         exit(EXIT_FAILURE);
     }
 
-    /*  Bind our socket addresss to the 
-    listening socket, and call listen()  */
-    if (bind(list_s, (struct sockaddr *) &servaddr, sizeof(servaddr)) < 0 ) {
-        LOG_ERROR("Errore durante la bind");
+    // Un processo worker riceve le partite dal supervisore che lo ha avviato (vedi workers.h)
+    char *worker_fd_string = getArgvParamValue("worker", allowedArgs);
+    if (worker_fd_string != NULL) {
+        worker_main(atoi(worker_fd_string)); // Non ritorna
+    }
+
+    char *workers_string = getArgvParamValue("workers", allowedArgs);
+    char *checkpoint_path = getArgvParamValue("checkpoint", allowedArgs);
+    char *handoff_path = getArgvParamValue("handoff", allowedArgs);
+    if (workers_string != NULL) {
+        long workers_count = strtol(workers_string, &endPtr, 0);
+        if (*endPtr) {
+            LOG_ERROR("Numero di worker non riconosciuto");
+            exit(EXIT_FAILURE);
+        }
+        if (checkpoint_path != NULL || handoff_path != NULL) {
+            LOG_ERROR("Le opzioni -checkpoint e -handoff non sono supportate con -workers");
+            exit(EXIT_FAILURE);
+        }
+        // I worker vengono avviati prima di qualsiasi thread o socket del supervisore
+        if (workers_start((int)workers_count, argv) < 0) {
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Con una directory condivisa il server è un nodo di un cluster (vedi gameDirectory.h)
+    char *directory_path = getArgvParamValue("directory", allowedArgs);
+    if (directory_path != NULL) {
+        if (checkpoint_path != NULL || handoff_path != NULL || workers_string != NULL) {
+            LOG_ERROR("Le opzioni -checkpoint, -handoff e -workers non sono supportate con -directory");
+            exit(EXIT_FAILURE);
+        }
+
+        // Senza -node i client raggiungono il nodo sulla sua porta in locale
+        char *node_string = getArgvParamValue("node", allowedArgs);
+        memset(&local_node, 0, sizeof(local_node));
+        if (node_string == NULL) {
+            snprintf(local_node.host, sizeof(local_node.host), "127.0.0.1");
+            local_node.port = (uint16_t)port;
+        } else if (parse_node_address(node_string, &local_node) < 0) {
+            LOG_ERROR("Indirizzo del nodo non valido `%s`, atteso host:porta", node_string);
+            exit(EXIT_FAILURE);
+        }
+
+        game_directory = strcmp(directory_path, "memory") == 0 ? directory_open_memory() : directory_open_file(directory_path);
+        if (game_directory == NULL) {
+            exit(EXIT_FAILURE);
+        }
+        int stale = game_directory->release_node(game_directory, &local_node);
+        LOG_INFO("Nodo %s:%d del cluster, rimosse %d partite di un'esecuzione precedente", local_node.host, local_node.port, stale);
+    }
+
+    if (checkpoint_path != NULL && checkpoint_open(checkpoint_path) < 0) {
         exit(EXIT_FAILURE);
     }
 
-    if(listen(list_s, 1024) < 0) {
-        LOG_ERROR("Errore durante la listen");
+    // Se un server è già in esecuzione sulla socket di passaggio, ne riceve partite e connessioni
+    LobbyThreadArg lobby_arg = {-1, NULL, 0};
+    int list_s = -1;
+    if (handoff_path != NULL) {
+        struct timespec handoff_start, handoff_end;
+        clock_gettime(CLOCK_MONOTONIC, &handoff_start);
+        list_s = handoff_receive(handoff_path, &lobby_arg.adopted_users, &lobby_arg.adopted_users_count);
+        clock_gettime(CLOCK_MONOTONIC, &handoff_end);
+        if (list_s >= 0) {
+            double elapsed_ms = (handoff_end.tv_sec - handoff_start.tv_sec) * 1e3 + (handoff_end.tv_nsec - handoff_start.tv_nsec) / 1e6;
+            LOG_INFO("Passaggio dal server precedente completato in %.1f ms", elapsed_ms);
+        }
+    }
+
+    // Le partite salvate vengono ripristinate prima di accettare connessioni, così i giocatori
+    // che rifanno il login le trovano già in attesa. Dopo un passaggio le partite sono già attive
+    if (checkpoint_path != NULL && list_s < 0) {
+        struct timespec restore_start, restore_end;
+        clock_gettime(CLOCK_MONOTONIC, &restore_start);
+        int restored = checkpoint_restore_games();
+        clock_gettime(CLOCK_MONOTONIC, &restore_end);
+        double elapsed_ms = (restore_end.tv_sec - restore_start.tv_sec) * 1e3 + (restore_end.tv_nsec - restore_start.tv_nsec) / 1e6;
+        LOG_INFO("Ripristinate %d partite dal checkpoint in %.1f ms", restored, elapsed_ms);
+    }
+
+    // Dopo un passaggio la socket in ascolto è quella del server precedente
+    if (list_s < 0) {
+        struct sockaddr_in servaddr;
+        memset(&servaddr, 0, sizeof(servaddr));
+        servaddr.sin_family = AF_INET;
+        servaddr.sin_addr.s_addr = htonl(INADDR_ANY);
+        servaddr.sin_port = htons(port);
+
+
+        /*  Create the listening socket  */
+        if((list_s = socket(AF_INET, SOCK_STREAM, 0)) < 0){
+            LOG_ERROR("Errore nella creazione della socket");
+            exit(EXIT_FAILURE);
+        }
+
+        int optval = 1;
+        if (setsockopt(list_s, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval)) < 0) {
+            LOG_ERROR("Errore in setsockopt SO_REUSEADDR");
+            exit(EXIT_FAILURE);
+        }
+
+        /*  Bind our socket addresss to the 
+        listening socket, and call listen()  */
+        if (bind(list_s, (struct sockaddr *) &servaddr, sizeof(servaddr)) < 0 ) {
+            LOG_ERROR("Errore durante la bind");
+            exit(EXIT_FAILURE);
+        }
+
+        if(listen(list_s, 1024) < 0) {
+            LOG_ERROR("Errore durante la listen");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // I client sulla stessa macchina possono collegarsi anche alla socket UNIX, e da lì chiedere la
+    // memoria condivisa (vedi shmTransport.h), che resta nel processo: non la si offre se le
+    // connessioni possono passare a un altro processo
+    char *unix_path = getArgvParamValue("unix", allowedArgs);
+    int unix_s = unix_path != NULL ? listen_unix(unix_path) : -1;
+    if (unix_path != NULL && unix_s < 0) {
         exit(EXIT_FAILURE);
     }
+    shared_memory_enabled = handoff_path == NULL && workers_string == NULL;
 
+    // Le metriche si leggono dalla socket di amministrazione (vedi adminSocket.h)
+    char *admin_path = getArgvParamValue("admin", allowedArgs);
+    int drain_pipe[2] = {-1, -1};
+    if (admin_path != NULL) {
+        int admin_s = listen_unix(admin_path);
+        if (admin_s < 0 || pipe(drain_pipe) == -1 || admin_start(admin_s, drain_pipe[1]) < 0) {
+            exit(EXIT_FAILURE);
+        }
+    }
 
     // Creo una pipe per comunicare con il thread della lobby
     // Il thread della lobby gestirà le connessioni dei client
@@ -80,13 +269,17 @@ int main(int argc, char *argv[]){
         exit(EXIT_FAILURE);
     }
 
+    lobby_arg.lobby_pipe_fd = lobby_pipe[0];
     pthread_t lobby_thread_id;
-    if (pthread_create(&lobby_thread_id, NULL, lobby_thread_main, &lobby_pipe[0]) != 0) {
+    if (pthread_create(&lobby_thread_id, NULL, lobby_thread_main, &lobby_arg) != 0) {
         LOG_ERROR("Errore durante la creazione del thread della lobby");
         exit(EXIT_FAILURE);
     }
 
-    LOG_INFO("Server in attesa di connessioni...");
+    // Da qui un nuovo processo può chiedere il passaggio, anche dopo averlo appena ricevuto
+    int handoff_s = handoff_path != NULL ? handoff_listen(handoff_path) : -1;
+
+    LOG_INFO("Server in attesa di connessioni (reactor %s)...", reactor_backend_name());
 
     int conn_s;
     struct sockaddr_in their_addr;
@@ -95,19 +288,103 @@ int main(int argc, char *argv[]){
     // Accetta le connessioni in un ciclo infinito
     // e passa il file descriptor della connessione al thread della lobby
     // per gestire la comunicazione con il client.
+    // Una connessione sulla socket di passaggio cede tutto a un nuovo processo e termina il server.
+    Reactor *accept_reactor = reactor_create();
+    if (accept_reactor == NULL || reactor_add_listener(accept_reactor, list_s, LISTEN_TAG) < 0) {
+        LOG_ERROR("Errore nella creazione del reactor delle connessioni: %s", strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    if (unix_s >= 0 && reactor_add_listener(accept_reactor, unix_s, UNIX_TAG) < 0) {
+        LOG_ERROR("Errore nella registrazione della socket UNIX: %s", strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    if (handoff_s >= 0) {
+        reactor_add(accept_reactor, handoff_s, HANDOFF_TAG);
+    }
+    if (drain_pipe[0] >= 0) {
+        reactor_add(accept_reactor, drain_pipe[0], DRAIN_TAG);
+    }
+    int draining = 0;
     while (1) {
-        if ((conn_s = accept(list_s, (struct sockaddr*)&their_addr, &sin_size)) < 0) {
-            LOG_ERROR("Errore durante l'accept");
-            continue; // Continua ad accettare altre connessioni
+        ReactorEvent events[MAX_ACCEPT_EVENTS];
+        int nfds = reactor_wait(accept_reactor, events, MAX_ACCEPT_EVENTS, draining ? DRAIN_CHECK_MS : -1);
+        if (draining) {
+            // Durante lo spegnimento il server termina appena finisce l'ultima partita
+            unsigned int waiting, started;
+            count_games_by_state(&waiting, &started);
+            if (waiting == 0 && started == 0) {
+                LOG_INFO("Nessuna partita rimasta, il server termina");
+                exit(EXIT_SUCCESS);
+            }
+        }
+        if (nfds < 0) {
+            if (errno != EINTR) {
+                LOG_ERROR("Errore durante l'attesa di connessioni: %s", strerror(errno));
+            }
+            continue;
         }
 
-        LOG_INFO("Connessione da %s", inet_ntoa(their_addr.sin_addr));
-        // Passa il nuovo file descriptor al thread lobby scrivendo sulla pipe
-        if (write(lobby_pipe[1], &conn_s, sizeof(conn_s)) == -1) {
-            LOG_ERROR("Errore durante la scrittura sulla pipe della lobby");
+        for (int n = 0; n < nfds; n++) {
+            if (events[n].tag == HANDOFF_TAG) {
+                int new_server_s = accept(handoff_s, NULL, NULL);
+                if (new_server_s >= 0) {
+                    // Chiudere il reactor annulla l'accept multishot: le nuove connessioni restano al nuovo processo
+                    reactor_destroy(accept_reactor);
+                    handoff_send(new_server_s, list_s, lobby_pipe[1]);
+                    LOG_INFO("Il server termina, il nuovo processo ha preso il suo posto");
+                    exit(EXIT_SUCCESS);
+                }
+                continue;
+            }
+            if (events[n].tag == DRAIN_TAG) {
+                char wake;
+                if (read(drain_pipe[0], &wake, sizeof(wake)) > 0 && !draining) {
+                    // Chiudere le socket in ascolto fa rifiutare subito le connessioni nuove
+                    reactor_remove(accept_reactor, list_s);
+                    close(list_s);
+                    if (unix_s >= 0) {
+                        reactor_remove(accept_reactor, unix_s);
+                        close(unix_s);
+                    }
+                    draining = 1;
+                    LOG_INFO("Spegnimento in corso: nessuna nuova connessione, il server termina alla fine delle partite");
+                }
+                continue;
+            }
+            if (draining) {
+                // Connessione accettata dal kernel prima della rimozione della socket in ascolto
+                if (events[n].fd >= 0) close(events[n].fd);
+                continue;
+            }
+
+            // Con io_uring la connessione è già stata accettata dal kernel (accept multishot)
+            conn_s = events[n].fd;
+            if (events[n].tag == UNIX_TAG) {
+                if (conn_s < 0 && (conn_s = accept(unix_s, NULL, NULL)) < 0) {
+                    LOG_ERROR("Errore durante l'accept sulla socket UNIX");
+                    continue;
+                }
+                LOG_INFO("Connessione locale sulla socket %d", conn_s);
+            } else if (conn_s < 0 && (conn_s = accept(list_s, (struct sockaddr*)&their_addr, &sin_size)) < 0) {
+                LOG_ERROR("Errore durante l'accept");
+                continue; // Continua ad accettare altre connessioni
+            } else if (events[n].fd < 0) {
+                LOG_INFO("Connessione da %s", inet_ntoa(their_addr.sin_addr));
+            } else {
+                LOG_INFO("Connessione accettata sulla socket %d", conn_s);
+            }
+            metrics_inc(METRIC_CONNECTIONS_ACCEPTED);
+            if (events[n].tag != UNIX_TAG) {
+                // Ogni messaggio parte con una sola scrittura: Nagle ritarderebbe solo i messaggi consecutivi
+                int nodelay = 1;
+                setsockopt(conn_s, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay));
+            }
+            // Passa il nuovo file descriptor al thread lobby scrivendo sulla pipe
+            if (write(lobby_pipe[1], &conn_s, sizeof(conn_s)) == -1) {
+                LOG_ERROR("Errore durante la scrittura sulla pipe della lobby");
+            }
         }
     }
 
 
-}
-
+}
\ No newline at end of file
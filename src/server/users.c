@@ -2,17 +2,33 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <unistd.h>
+#include <sched.h>
 
+#include <sys/socket.h>
 #include <pthread.h>
 
 #include "users.h"
 #include "utils/debug.h"
 #include "utils/list.h"
 #include "server/gameManager.h"
+#include "server/workers.h"
+#include "server/gameDirectory.h"
+#include "utils/slab.h"
+
+/**
+ * Oggetto del pool delle partite: la partita e l'array dei primi GAME_POOL_PLAYERS giocatori.
+ */
+typedef struct {
+    Game game;
+    unsigned int player_ids[GAME_POOL_PLAYERS];
+} GameSlot;
 
 ListManager *users_list = NULL;
 ListManager *games_list = NULL;
 
+static SlabPool game_pool = SLAB_POOL_INITIALIZER("game", GameSlot);
+
 /**
  * Inizializza le liste degli utenti e delle partite.
  * Se le liste sono già state inizializzate, non fa nulla.
@@ -27,27 +43,37 @@ void init_lists() {
 }
 
 /**
- * Crea un nuovo utente e lo aggiunge alla lista degli utenti.
- * @param username Nome dell'utente da creare.
- * @param socket_fd File descriptor della socket associata all'utente.
- * @return ID dell'utente creato, o -1 in caso di errore.
+ * Alloca un nuovo utente, senza aggiungerlo alla lista degli utenti.
+ * @return Puntatore all'utente, o NULL in caso di errore.
  */
-int create_user(const char *username, int socket_fd) {
+static User *alloc_user(const char *username, int socket_fd) {
     User *new_user = (User *)malloc(sizeof(User));
-    if (!new_user) return -1;
+    if (!new_user) return NULL;
 
     if (username) {
         new_user->username = strdup(username);
         if (!new_user->username) {
             free(new_user);
-            return -1;
+            return NULL;
         }
     } else {
         new_user->username = NULL;
     }
     
     new_user->socket_fd = socket_fd;
-    new_user->game_id = 0;
+    new_user->game_id = USER_NO_GAME;
+    return new_user;
+}
+
+/**
+ * Crea un nuovo utente e lo aggiunge alla lista degli utenti.
+ * @param username Nome dell'utente da creare.
+ * @param socket_fd File descriptor della socket associata all'utente.
+ * @return ID dell'utente creato, o -1 in caso di errore.
+ */
+int create_user(const char *username, int socket_fd) {
+    User *new_user = alloc_user(username, socket_fd);
+    if (!new_user) return -1;
 
     ListItem *node = add_node(users_list, new_user);
     new_user->id = node->index;
@@ -55,6 +81,39 @@ int create_user(const char *username, int socket_fd) {
     return new_user->id;
 }
 
+/**
+ * Crea un utente con un ID prestabilito, per ricreare gli utenti ricevuti da un altro
+ * processo server: i client continuano a usare gli ID che conoscono.
+ * @param user_id ID da assegnare all'utente.
+ * @param username Nome dell'utente, NULL se non ha ancora fatto il login.
+ * @param socket_fd File descriptor della socket associata all'utente.
+ * @return ID dell'utente creato, o -1 se l'ID è già in uso o in caso di errore.
+ */
+int create_user_with_id(unsigned int user_id, const char *username, int socket_fd) {
+    if (user_id >= MAX_ELEMENTS) return -1;
+
+    User *new_user = alloc_user(username, socket_fd);
+    if (!new_user) return -1;
+
+    if (add_node_at(users_list, user_id, new_user) == NULL) {
+        free_user(new_user);
+        return -1;
+    }
+    new_user->id = user_id;
+
+    return new_user->id;
+}
+
+/**
+ * Scorre gli utenti registrati.
+ * @param cursor Posizione da cui riprendere, da inizializzare a 0.
+ * @return ID del prossimo utente, o -1 se non ce ne sono altri.
+ */
+int get_next_user_id(size_t *cursor) {
+    ListItem *node = get_next_used_node(users_list, cursor);
+    return node ? (int)node->index : -1;
+}
+
 /**
  * Rimuove un utente dalla lista degli utenti e libera le risorse associate.
  * @param user_id ID dell'utente da rimuovere.
@@ -181,7 +240,7 @@ char *get_username_by_id(unsigned int user_id) {
 /**
  * Aggiorna l'ID della partita associata a un utente.
  * @param user_id ID dell'utente da aggiornare.
- * @param game_id Nuovo ID della partita, 0 se l'utente non è in una partita.
+ * @param game_id Nuovo ID della partita, USER_NO_GAME se l'utente non è in una partita.
  * @return 0 se l'aggiornamento è andato a buon fine, -1 in caso di errore.
  */
 int update_user_game_id(unsigned int user_id, unsigned int game_id) {
@@ -203,11 +262,11 @@ int update_user_game_id(unsigned int user_id, unsigned int game_id) {
 /**
  * Ottiene l'ID della partita associata a un utente.
  * @param user_id ID dell'utente di cui ottenere l'ID della partita.
- * @return ID della partita associata all'utente, o 0 se l'utente non è in una partita.
+ * @return ID della partita associata all'utente, o USER_NO_GAME se l'utente non è in una partita.
  */
 unsigned int get_user_game_id(unsigned int user_id) {
     ListItem *node = get_node(user_id, users_list);
-    unsigned int game_id = 0;
+    unsigned int game_id = USER_NO_GAME;
 
     pthread_mutex_lock(&node->mutex);
     
@@ -222,87 +281,264 @@ unsigned int get_user_game_id(unsigned int user_id) {
 
 
 /**
- * Crea una nuova partita e restituisce il suo ID.
+ * Alloca una partita dal pool, senza giocatori e con l'array dei giocatori dell'oggetto del pool.
+ * @return Puntatore alla partita, da liberare con free_game, o NULL in caso di errore.
+ */
+static Game *alloc_game(const char *game_name) {
+    GameSlot *slot = (GameSlot *)slab_alloc(&game_pool);
+    if (!slot) return NULL;
+
+    memset(&slot->game, 0, sizeof(slot->game));
+    slot->game.game_name = alloc_name(game_name);
+    if (!slot->game.game_name) {
+        slab_free(&game_pool, slot);
+        return NULL;
+    }
+    slot->game.player_ids = slot->player_ids;
+    slot->game.players_capacity = GAME_POOL_PLAYERS;
+    slot->game.game_pipe_fd = -1;
+    return &slot->game;
+}
+
+/**
+ * Porta l'array dei giocatori di una partita a `capacity` elementi: la prima volta lascia l'array
+ * dell'oggetto del pool e passa allo heap.
+ * @return 0 in caso di successo, -1 se manca la memoria.
+ */
+static int grow_game_players(Game *game, unsigned int capacity) {
+    unsigned int *pooled_ids = ((GameSlot *)game)->player_ids;
+    unsigned int *new_ids = game->player_ids == pooled_ids
+        ? (unsigned int *)malloc(capacity * sizeof(unsigned int))
+        : (unsigned int *)realloc(game->player_ids, capacity * sizeof(unsigned int));
+    if (!new_ids) return -1;
+
+    if (game->player_ids == pooled_ids) {
+        memcpy(new_ids, pooled_ids, game->players_count * sizeof(unsigned int));
+    }
+    game->player_ids = new_ids;
+    game->players_capacity = capacity;
+    return 0;
+}
+
+/**
+ * Registra una nuova partita nella lista delle partite e avvia il suo thread di gioco.
+ * @param game_id ID con cui registrare la partita, -1 per assegnarne uno nuovo.
  * @param game_name Nome della partita.
- * @param owner_id ID del giocatore che crea la partita.
+ * @param owner_id ID del giocatore che ha creato la partita.
+ * @param ruleset_id ID del regolamento della partita.
+ * @param bots_count Numero di bot che il thread di gioco aggiunge alla partita appena creata.
+ * @param bot_ids ID di utente riservati ai bot della partita, NULL se vengono assegnati dal processo.
+ * @param bot_ids_count Numero di ID in `bot_ids`.
+ * @param restored Partita da riprendere, NULL per una partita nuova.
  * @return ID della nuova partita, o -1 in caso di errore.
  */
-int create_game(const char *game_name, unsigned int owner_id) {
-    Game *new_game = (Game *)calloc(1, sizeof(Game));
+static int start_game(int game_id, const char *game_name, unsigned int owner_id, int ruleset_id, int bots_count,
+                      const unsigned int *bot_ids, unsigned int bot_ids_count, const RestoredGame *restored) {
+    GameState *restored_game = restored ? restored->game : NULL;
+    Game *new_game = alloc_game(game_name);
     if (!new_game) return -1;
     
-    new_game->game_name = strdup(game_name);
-    if (!new_game->game_name) {
-        free(new_game);
-        return -1;
-    }
-    
     new_game->owner_id = owner_id;
     new_game->started = 0; // Inizialmente la partita non è iniziata
-    new_game->players_capacity = 8;
-    new_game->players_count = 0;
-    new_game->player_ids = (unsigned int *)malloc(new_game->players_capacity * sizeof(unsigned int));
-    if (!new_game->player_ids) {
-        free(new_game->game_name);
-        free(new_game);
-        return -1;
+    new_game->ruleset_id = ruleset_id;
+    if (restored_game != NULL) {
+        // I giocatori della partita ripristinata sono già nello stato di gioco
+        new_game->started = restored_game->state_type != GAME_WAITING_FOR_PLAYERS;
+        unsigned int capacity = new_game->players_capacity;
+        while (capacity < restored_game->players_count) {
+            capacity *= 2;
+        }
+        if (capacity > new_game->players_capacity && grow_game_players(new_game, capacity) == -1) {
+            free_game(new_game);
+            return -1;
+        }
+        for (unsigned int i = 0; i < restored_game->players_count; i++) {
+            new_game->player_ids[new_game->players_count++] = restored_game->players[i].user.user_id;
+        }
     }
 
     int game_pipe[2];
     if (pipe(game_pipe) == -1) {
-        free(new_game->player_ids);
-        free(new_game->game_name);
-        free(new_game);
+        free_game(new_game);
         return -1;
     }
     new_game->game_pipe_fd = game_pipe[1];
 
-    ListItem *node = add_node(games_list, new_game);
-    new_game->game_id = node->index;
-
-    pthread_t thread_id;
-    GameThreadArg *game_arg = (GameThreadArg *)malloc(sizeof(GameThreadArg));
+    GameThreadArg *game_arg = alloc_game_thread_arg(game_name);
     if (!game_arg) {
-        free(new_game->player_ids);
-        free(new_game->game_name);
-        free(new_game);
         close(game_pipe[0]);
-        close(game_pipe[1]);
+        free_game(new_game); // Chiude anche l'estremità di scrittura della pipe
         return -1;
     }
-    game_arg->game_id = new_game->game_id; // L'ID sarà assegnato dopo
-    game_arg->game_name = strdup(game_name);
-    if (!game_arg->game_name) {
-        free(game_arg);
-        free(new_game->player_ids);
-        free(new_game->game_name);
-        free(new_game);
+
+    ListItem *node = game_id >= 0
+        ? add_node_at(games_list, game_id, new_game)
+        : add_node(games_list, new_game);
+    if (!node) {
+        LOG_ERROR("L'ID di partita %d è già in uso", game_id);
+        free_game_thread_arg(game_arg);
         close(game_pipe[0]);
-        close(game_pipe[1]);
+        free_game(new_game); // Chiude anche l'estremità di scrittura della pipe
         return -1;
     }
+    new_game->game_id = node->index;
+
+    for (unsigned int i = 0; i < new_game->players_count; i++) {
+        update_user_game_id(new_game->player_ids[i], new_game->game_id);
+    }
+
+    game_arg->game_id = new_game->game_id;
     game_arg->game_pipe_fd = game_pipe[0];
+    game_arg->ruleset_id = ruleset_id;
+    game_arg->bots_count = bots_count;
+    game_arg->reserved_bots_count = 0;
+    for (unsigned int i = 0; bot_ids != NULL && i < bot_ids_count && i < MAX_GAME_BOTS; i++) {
+        game_arg->reserved_bot_ids[game_arg->reserved_bots_count++] = bot_ids[i];
+    }
+    if (restored) {
+        game_arg->restored = *restored;
+    } else {
+        memset(&game_arg->restored, 0, sizeof(game_arg->restored));
+        game_arg->restored.checkpoint_slot = -1;
+    }
 
+    game_id = new_game->game_id;
+    pthread_t thread_id;
     if (pthread_create(&thread_id, NULL, game_thread, (void *)game_arg) != 0) {
-        LOG_ERROR("Errore durante la creazione del thread di gioco per la partita %d", new_game->game_id);
+        LOG_ERROR("Errore durante la creazione del thread di gioco per la partita %d", game_id);
 
-        free(game_arg->game_name);
-        free(game_arg);
-        free(new_game->player_ids);
-        free(new_game->game_name);
-        free(new_game);
+        free_game_thread_arg(game_arg);
         close(game_pipe[0]);
-        close(game_pipe[1]);
+        remove_game(game_id); // Chiude anche l'estremità di scrittura della pipe
         return -1;
     }
     pthread_detach(thread_id);
-    
-    // Aggiunge il creatore come primo giocatore
-    add_player_to_game(new_game->game_id, owner_id);
 
+    return game_id;
+}
+
+/**
+ * Registra nel supervisore una partita affidata a un processo worker, senza thread di gioco.
+ * Riserva MAX_GAME_BOTS utenti senza socket per i bot che il worker potrà aggiungere,
+ * così i loro ID non vengono assegnati ad altri client.
+ * @param game_name Nome della partita.
+ * @param owner_id ID del giocatore che crea la partita, aggiunto come primo giocatore.
+ * @param ruleset_id ID del regolamento della partita.
+ * @return ID della nuova partita, o -1 in caso di errore.
+ */
+static int register_remote_game(const char *game_name, unsigned int owner_id, int ruleset_id) {
+    Game *new_game = alloc_game(game_name);
+    if (!new_game) return -1;
+
+    new_game->owner_id = owner_id;
+    new_game->ruleset_id = ruleset_id;
+
+    ListItem *node = add_node(games_list, new_game);
+    new_game->game_id = node->index;
+
+    for (int i = 0; i < MAX_GAME_BOTS; i++) {
+        int bot_id = create_user(NULL, -1);
+        if (bot_id < 0) break;
+        update_user_game_id(bot_id, new_game->game_id);
+        new_game->reserved_bot_ids[new_game->reserved_bots_count++] = bot_id;
+    }
+
+    add_player_to_game(new_game->game_id, owner_id);
     return new_game->game_id;
 }
 
+/**
+ * Crea una nuova partita e restituisce il suo ID.
+ * @param game_name Nome della partita.
+ * @param owner_id ID del giocatore che crea la partita.
+ * @param ruleset_id ID del regolamento della partita.
+ * @param bots_count Numero di bot che il thread di gioco aggiunge alla partita appena creata.
+ * @return ID della nuova partita, o -1 in caso di errore.
+ */
+int create_game(const char *game_name, unsigned int owner_id, int ruleset_id, int bots_count) {
+    if (workers_enabled()) {
+        return register_remote_game(game_name, owner_id, ruleset_id);
+    }
+
+    // In un cluster l'ID viene assegnato dalla directory condivisa, così è unico tra i nodi
+    int reserved_id = directory_reserve_game();
+    if (reserved_id < 0 && game_directory != NULL) return -1;
+
+    int game_id = start_game(reserved_id, game_name, owner_id, ruleset_id, bots_count, NULL, 0, NULL);
+    if (game_id < 0) {
+        if (reserved_id >= 0) directory_release_game(reserved_id);
+        return -1;
+    }
+
+    // Aggiunge il creatore come primo giocatore
+    add_player_to_game(game_id, owner_id);
+
+    return game_id;
+}
+
+/**
+ * Crea in un processo worker la partita registrata dal supervisore, con lo stesso ID.
+ * Il creatore deve essere già presente nella lista degli utenti.
+ * @param game_id ID assegnato alla partita dal supervisore.
+ * @param game_name Nome della partita.
+ * @param owner_id ID del giocatore che crea la partita.
+ * @param ruleset_id ID del regolamento della partita.
+ * @param bots_count Numero di bot che il thread di gioco aggiunge alla partita appena creata.
+ * @param bot_ids ID di utente riservati dal supervisore ai bot della partita.
+ * @param bot_ids_count Numero di ID in `bot_ids`.
+ * @return ID della partita, o -1 in caso di errore.
+ */
+int create_game_with_id(unsigned int game_id, const char *game_name, unsigned int owner_id, int ruleset_id, int bots_count, const unsigned int *bot_ids, unsigned int bot_ids_count) {
+    if (game_id >= MAX_ELEMENTS || start_game((int)game_id, game_name, owner_id, ruleset_id, bots_count, bot_ids, bot_ids_count, NULL) < 0) {
+        return -1;
+    }
+
+    add_player_to_game(game_id, owner_id);
+    return game_id;
+}
+
+/**
+ * Riprende una partita ripristinata da un checkpoint o ricevuta da un altro processo server.
+ * I giocatori devono essere già presenti nella lista degli utenti: quelli senza socket vengono
+ * attesi dal thread di gioco finché non si riconnettono (vedi hand_player_to_game).
+ * @param restored Partita da riprendere; il thread di gioco diventa proprietario dello stato.
+ * @param owner_id ID del proprietario della partita, -1 se non è più presente.
+ * @return ID della partita, o -1 in caso di errore (lo stato resta al chiamante).
+ */
+int restore_game(const RestoredGame *restored, int owner_id) {
+    GameState *game = restored->game;
+    return start_game(restored->keep_game_id ? (int)game->game_id : -1, game->game_name, (unsigned int)owner_id,
+                      (int)(game->rules - GAME_RULESETS), 0, NULL, 0, restored);
+}
+
+/**
+ * Affida al thread di gioco la socket di un giocatore della partita.
+ * Va chiamata quando il chiamante non usa più la socket, dopo averla tolta dal proprio
+ * reactor: da qui in poi la legge e la scrive solo il thread di gioco.
+ * Serve anche per i giocatori di una partita ripristinata che si sono riconnessi.
+ * @param game_id ID della partita.
+ * @param player_id ID del giocatore, a cui è già associata la socket.
+ * @return 0 in caso di successo, -1 se la partita non esiste.
+ */
+int hand_player_to_game(unsigned int game_id, unsigned int player_id) {
+    ListItem *node = get_node(game_id, games_list);
+    int success = -1;
+
+    pthread_mutex_lock(&node->mutex);
+
+    Game *game = (Game *)node->ptr;
+    if (game) {
+        if (write(game->game_pipe_fd, &player_id, sizeof(player_id)) == -1) {
+            LOG_ERROR("Errore durante la scrittura sulla pipe della partita");
+        } else {
+            success = 0;
+        }
+    }
+
+    pthread_mutex_unlock(&node->mutex);
+    return success;
+}
+
 /**
  * Rimuove una partita e libera le risorse associate.
  * @param game_id ID della partita da rimuovere.
@@ -324,21 +560,64 @@ void remove_game(unsigned int game_id) {
     release_node(games_list, game_id);
 }
 
+/**
+ * Rimuove dal supervisore una partita affidata a un worker, insieme ai suoi giocatori e
+ * agli utenti riservati ai bot, di cui il worker non usa più gli ID.
+ * @param game_id ID della partita da rimuovere.
+ */
+void release_remote_game(unsigned int game_id) {
+    ListItem *node = get_node(game_id, games_list);
+
+    // La partita viene tolta dalla lista prima di rimuovere gli utenti, che restano solo suoi
+    pthread_mutex_lock(&node->mutex);
+    Game *game = (Game *)node->ptr;
+    if (game == NULL || game->game_pipe_fd >= 0) {
+        pthread_mutex_unlock(&node->mutex);
+        return;
+    }
+    node->ptr = NULL;
+    pthread_mutex_unlock(&node->mutex);
+    release_node(games_list, game_id);
+
+    for (unsigned int i = 0; i < game->players_count; i++) {
+        remove_user(game->player_ids[i]);
+    }
+    for (unsigned int i = 0; i < game->reserved_bots_count; i++) {
+        remove_user(game->reserved_bot_ids[i]);
+    }
+    free_game(game);
+}
+
+/**
+ * Scorre le partite registrate.
+ * @param cursor Posizione da cui riprendere, da inizializzare a 0.
+ * @return ID della prossima partita, o -1 se non ce ne sono altre.
+ */
+int get_next_game_id(size_t *cursor) {
+    ListItem *node = get_next_used_node(games_list, cursor);
+    return node ? (int)node->index : -1;
+}
+
 /**
  * Libera le risorse associate a una partita.
  * @param game Puntatore alla partita da liberare.
  */
 void free_game(Game *game) {
     if (!game) return;
-    close(game->game_pipe_fd);
-    free(game->game_name);
-    free(game->player_ids);
-    free(game);
+    if (game->game_pipe_fd >= 0) {
+        close(game->game_pipe_fd);
+    }
+    free_name(game->game_name);
+    if (game->player_ids != ((GameSlot *)game)->player_ids) {
+        free(game->player_ids);
+    }
+    slab_free(&game_pool, game);
 }
 
 /**
  * Aggiunge un giocatore a una partita.
  * Se l'array dei giocatori è pieno, raddoppia la sua capacità.
+ * Il thread di gioco riceve la socket del giocatore solo con hand_player_to_game.
  * @param game_id ID della partita a cui aggiungere il giocatore.
  * @param player_id ID del giocatore da aggiungere.
  * @return 0 se il giocatore è stato aggiunto con successo, -1 in caso di errore.
@@ -357,27 +636,17 @@ int add_player_to_game(unsigned int game_id, unsigned int player_id) {
             return -1; // Non si può aggiungere un giocatore a una partita già iniziata
         }
         // Se l'array dei giocatori è pieno, raddoppia la sua capacità
-        if (game->players_count >= game->players_capacity) {
-            size_t new_capacity = game->players_capacity * 2;
-            unsigned int *new_players = (unsigned int *)realloc(game->player_ids, new_capacity * sizeof(unsigned int));
-            if (new_players) {
-                game->player_ids = new_players;
-                game->players_capacity = new_capacity;
-            } else {
-                // realloc fallito, non si può aggiungere il giocatore
-                pthread_mutex_unlock(&node->mutex);
-                return -1;
-            }
+        if (game->players_count >= game->players_capacity &&
+            grow_game_players(game, game->players_capacity * 2) == -1) {
+            // Allocazione fallita, non si può aggiungere il giocatore
+            pthread_mutex_unlock(&node->mutex);
+            return -1;
         }
         
         // Aggiungi il giocatore
         game->player_ids[game->players_count] = player_id;
         game->players_count++;
 
-        if (write(game->game_pipe_fd, &player_id, sizeof(player_id)) == -1) {
-            LOG_ERROR("Errore durante la scrittura sulla pipe della partita");
-        }
-
         update_user_game_id(player_id, game_id);
 
         LOG_DEBUG("Giocatore %d aggiunto alla partita %d", player_id, game_id);
@@ -451,6 +720,44 @@ char *get_game_name_by_id(unsigned int game_id) {
     return game_name;
 }
 
+/**
+ * Ottiene il regolamento di una partita.
+ * @param game_id ID della partita.
+ * @return ID del regolamento, o -1 se la partita non esiste.
+ */
+int get_game_ruleset_id(unsigned int game_id) {
+    ListItem *node = get_node(game_id, games_list);
+    int ruleset_id = -1;
+
+    pthread_mutex_lock(&node->mutex);
+    Game *game = (Game *)node->ptr;
+    if (game) {
+        ruleset_id = game->ruleset_id;
+    }
+    pthread_mutex_unlock(&node->mutex);
+    return ruleset_id;
+}
+
+/**
+ * Copia gli ID di utente riservati ai bot di una partita affidata a un worker.
+ * @param game_id ID della partita.
+ * @param bot_ids Array di almeno MAX_GAME_BOTS elementi da riempire.
+ * @return Numero di ID copiati.
+ */
+unsigned int get_game_reserved_bots(unsigned int game_id, unsigned int *bot_ids) {
+    ListItem *node = get_node(game_id, games_list);
+    unsigned int count = 0;
+
+    pthread_mutex_lock(&node->mutex);
+    Game *game = (Game *)node->ptr;
+    if (game) {
+        count = game->reserved_bots_count;
+        memcpy(bot_ids, game->reserved_bot_ids, count * sizeof(unsigned int));
+    }
+    pthread_mutex_unlock(&node->mutex);
+    return count;
+}
+
 void set_game_started(unsigned int game_id, int started) {
     ListItem *node = get_node(game_id, games_list);
     
@@ -462,4 +769,233 @@ void set_game_started(unsigned int game_id, int started) {
     }
     
     pthread_mutex_unlock(&node->mutex);
-}
\ No newline at end of file
+}
+
+/**
+ * Scrive un valore sulla pipe di ogni partita registrata.
+ * @param value Valore da scrivere, letto dai thread di gioco come l'ID di un giocatore.
+ * @return Numero di partite a cui il valore è stato scritto.
+ */
+int notify_all_games(int value) {
+    int notified = 0;
+    size_t cursor = 0;
+    ListItem *node;
+    while ((node = get_next_used_node(games_list, &cursor)) != NULL) {
+        pthread_mutex_lock(&node->mutex);
+        Game *game = (Game *)node->ptr;
+        if (game && write(game->game_pipe_fd, &value, sizeof(value)) == (ssize_t)sizeof(value)) {
+            notified++;
+        }
+        pthread_mutex_unlock(&node->mutex);
+    }
+    return notified;
+}
+
+/**
+ * Conta le partite registrate in attesa di essere avviate e quelle già avviate.
+ * @param waiting_out Puntatore per il numero di partite in attesa.
+ * @param started_out Puntatore per il numero di partite avviate.
+ */
+void count_games_by_state(unsigned int *waiting_out, unsigned int *started_out) {
+    *waiting_out = 0;
+    *started_out = 0;
+    size_t cursor = 0;
+    ListItem *node;
+    while ((node = get_next_used_node(games_list, &cursor)) != NULL) {
+        pthread_mutex_lock(&node->mutex);
+        Game *game = (Game *)node->ptr;
+        if (game) {
+            (*(game->started ? started_out : waiting_out))++;
+        }
+        pthread_mutex_unlock(&node->mutex);
+    }
+}
+
+/**
+ * Conta gli utenti registrati che hanno una connessione aperta, esclusi quindi i bot e i
+ * giocatori di una partita ripristinata che non si sono ancora riconnessi.
+ * @return Numero di utenti connessi.
+ */
+unsigned int count_connected_users(void) {
+    unsigned int connected = 0;
+    size_t cursor = 0;
+    ListItem *node;
+    while ((node = get_next_used_node(users_list, &cursor)) != NULL) {
+        pthread_mutex_lock(&node->mutex);
+        User *user = (User *)node->ptr;
+        if (user && user->socket_fd >= 0) {
+            connected++;
+        }
+        pthread_mutex_unlock(&node->mutex);
+    }
+    return connected;
+}
+
+/**
+ * Prende il lock di un nodo senza attendere chi lo tiene: riprova SNAPSHOT_LOCK_ATTEMPTS volte,
+ * cedendo il processore tra un tentativo e l'altro.
+ * @return 0 se il lock è stato preso, -1 se il nodo è rimasto occupato.
+ */
+static int try_lock_node(ListItem *node) {
+    for (int attempt = 0; attempt < SNAPSHOT_LOCK_ATTEMPTS; attempt++) {
+        if (pthread_mutex_trylock(&node->mutex) == 0) return 0;
+        sched_yield();
+    }
+    return -1;
+}
+
+/**
+ * Aggiunge un elemento in fondo a un array che raddoppia quando è pieno.
+ * @return Puntatore al nuovo elemento (azzerato), o NULL se manca la memoria.
+ */
+static void *grow_snapshots(void **snapshots, int count, int *capacity, size_t item_size) {
+    if (count == *capacity) {
+        int new_capacity = *capacity ? *capacity * 2 : 64;
+        void *new_snapshots = realloc(*snapshots, new_capacity * item_size);
+        if (!new_snapshots) return NULL;
+        *snapshots = new_snapshots;
+        *capacity = new_capacity;
+    }
+    void *item = (char *)*snapshots + count * item_size;
+    memset(item, 0, item_size);
+    return item;
+}
+
+/**
+ * Copia i campi delle partite registrate in un array, per elencarle senza fermare i thread
+ * che le usano: ogni nodo resta bloccato solo per la copia, e un nodo tenuto a lungo da un
+ * altro thread viene segnato come occupato invece di attenderlo.
+ * @param snapshots_out Puntatore per l'array, da liberare con free.
+ * @return Numero di partite copiate, o -1 se manca la memoria.
+ */
+int snapshot_games(GameSnapshot **snapshots_out) {
+    GameSnapshot *snapshots = NULL;
+    int count = 0, capacity = 0;
+    size_t cursor = 0;
+    ListItem *node;
+    while ((node = get_next_used_node(games_list, &cursor)) != NULL) {
+        GameSnapshot *snapshot = (GameSnapshot *)grow_snapshots((void **)&snapshots, count, &capacity, sizeof(GameSnapshot));
+        if (!snapshot) {
+            free(snapshots);
+            return -1;
+        }
+        snapshot->game_id = (unsigned int)node->index;
+        if (try_lock_node(node) < 0) {
+            snapshot->busy = 1;
+            count++;
+            continue;
+        }
+        Game *game = (Game *)node->ptr;
+        if (game) {
+            snapshot->owner_id = game->owner_id;
+            snapshot->players_count = game->players_count;
+            snapshot->started = game->started;
+            snapshot->ruleset_id = game->ruleset_id;
+            snapshot->remote = game->game_pipe_fd == -1;
+            snprintf(snapshot->game_name, sizeof(snapshot->game_name), "%s", game->game_name ? game->game_name : "");
+            count++;
+        }
+        pthread_mutex_unlock(&node->mutex);
+    }
+    *snapshots_out = snapshots;
+    return count;
+}
+
+/**
+ * Copia i campi degli utenti registrati in un array, come snapshot_games.
+ * @param snapshots_out Puntatore per l'array, da liberare con free.
+ * @return Numero di utenti copiati, o -1 se manca la memoria.
+ */
+int snapshot_users(UserSnapshot **snapshots_out) {
+    UserSnapshot *snapshots = NULL;
+    int count = 0, capacity = 0;
+    size_t cursor = 0;
+    ListItem *node;
+    while ((node = get_next_used_node(users_list, &cursor)) != NULL) {
+        UserSnapshot *snapshot = (UserSnapshot *)grow_snapshots((void **)&snapshots, count, &capacity, sizeof(UserSnapshot));
+        if (!snapshot) {
+            free(snapshots);
+            return -1;
+        }
+        snapshot->user_id = (unsigned int)node->index;
+        if (try_lock_node(node) < 0) {
+            snapshot->busy = 1;
+            snapshot->socket_fd = -1;
+            count++;
+            continue;
+        }
+        User *user = (User *)node->ptr;
+        if (user) {
+            snapshot->game_id = user->game_id;
+            snapshot->socket_fd = user->socket_fd;
+            snprintf(snapshot->username, sizeof(snapshot->username), "%s", user->username ? user->username : "");
+            count++;
+        }
+        pthread_mutex_unlock(&node->mutex);
+    }
+    *snapshots_out = snapshots;
+    return count;
+}
+
+/**
+ * Cerca un utente registrato per nome.
+ * @param username Nome dell'utente.
+ * @return ID dell'utente, o -1 se non esiste.
+ */
+int find_user_id_by_username(const char *username) {
+    int user_id = -1;
+    size_t cursor = 0;
+    ListItem *node;
+    while (user_id < 0 && (node = get_next_used_node(users_list, &cursor)) != NULL) {
+        pthread_mutex_lock(&node->mutex);
+        User *user = (User *)node->ptr;
+        if (user && user->username && strcmp(user->username, username) == 0) {
+            user_id = (int)node->index;
+        }
+        pthread_mutex_unlock(&node->mutex);
+    }
+    return user_id;
+}
+
+/**
+ * Chiude in entrambe le direzioni la connessione di un utente, senza chiuderne il file
+ * descriptor: il thread che gestisce l'utente (lobby o partita) legge la fine della connessione
+ * e lo rimuove come per una normale disconnessione.
+ * @param user_id ID dell'utente.
+ * @return 0 in caso di successo, -1 se l'utente non esiste o non ha una connessione.
+ */
+int disconnect_user(unsigned int user_id) {
+    if (user_id >= MAX_ELEMENTS) return -1;
+    ListItem *node = get_node(user_id, users_list);
+    int success = -1;
+
+    // I thread chiudono la socket prima di rimuovere l'utente: se l'utente si sta già disconnettendo
+    // lo shutdown può colpire una connessione appena accettata con lo stesso descriptor
+    pthread_mutex_lock(&node->mutex);
+    User *user = (User *)node->ptr;
+    if (user && user->socket_fd >= 0 && shutdown(user->socket_fd, SHUT_RDWR) == 0) {
+        success = 0;
+    }
+    pthread_mutex_unlock(&node->mutex);
+    return success;
+}
+
+/**
+ * Scrive un valore sulla pipe di una partita gestita da un thread di questo processo.
+ * @param game_id ID della partita.
+ * @param value Valore da scrivere, letto dal thread di gioco come l'ID di un giocatore.
+ * @return 0 in caso di successo, -1 se la partita non esiste, è affidata a un worker o la scrittura non riesce.
+ */
+int notify_game(unsigned int game_id, int value) {
+    if (game_id >= MAX_ELEMENTS) return -1;
+    ListItem *node = get_node(game_id, games_list);
+    int success = -1;
+
+    pthread_mutex_lock(&node->mutex);
+    Game *game = (Game *)node->ptr;
+    if (game && game->game_pipe_fd >= 0 && write(game->game_pipe_fd, &value, sizeof(value)) == (ssize_t)sizeof(value)) {
+        success = 0;
+    }
+    pthread_mutex_unlock(&node->mutex);
+    return success;
+}
@@ -1,11 +1,16 @@
 #ifndef USERS_H
 #define USERS_H
 
+#include "common/game.h"
+#include "server/gameManager.h"
+
+#define USER_NO_GAME ((unsigned int)-1) // game_id di un utente che non è in una partita
+
 typedef struct {
     char *username; // Nome utente (max 30 caratteri + terminatore)
     int socket_fd;
     unsigned int id; // ID univoco dell'utente, può essere usato per identificare l'utente in modo univoco
-    unsigned int game_id; // ID della partita a cui l'utente è associato, 0 se non è in una partita
+    unsigned int game_id; // ID della partita a cui l'utente è associato, USER_NO_GAME se non è in una partita
 } User;
 
 typedef struct {
@@ -18,13 +23,41 @@ typedef struct {
     unsigned int players_count; // Numero attuale di giocatori nella partita
 
     int started; // Indica se la partita è iniziata
+    int ruleset_id; // ID del regolamento della partita (vedi GAME_RULESETS)
+
+    int game_pipe_fd; // -1 se la partita è affidata a un processo worker
 
-    int game_pipe_fd;
+    unsigned int reserved_bot_ids[MAX_GAME_BOTS]; // ID di utente riservati ai bot della partita affidata a un worker
+    unsigned int reserved_bots_count;
 } Game;
 
+#define SNAPSHOT_NAME_SIZE 40 // Byte copiati dei nomi di utenti e partite, terminatore compreso
+#define SNAPSHOT_LOCK_ATTEMPTS 4 // Tentativi di prendere il lock di un nodo prima di segnarlo come occupato
+
+typedef struct {
+    unsigned int game_id;
+    unsigned int owner_id;
+    unsigned int players_count;
+    int started;
+    int ruleset_id;
+    int remote; // 1 se la partita è affidata a un processo worker
+    int busy; // 1 se il nodo era occupato: solo game_id è valido
+    char game_name[SNAPSHOT_NAME_SIZE];
+} GameSnapshot;
+
+typedef struct {
+    unsigned int user_id;
+    unsigned int game_id;
+    int socket_fd;
+    int busy; // 1 se il nodo era occupato: solo user_id è valido
+    char username[SNAPSHOT_NAME_SIZE];
+} UserSnapshot;
+
 void init_lists();
 
 int create_user(const char *username, int socket_fd);
+int create_user_with_id(unsigned int user_id, const char *username, int socket_fd);
+int get_next_user_id(size_t *cursor);
 void remove_user(unsigned int user_id);
 void free_user(User *user);
 int update_user_socket_fd(unsigned int user_id, int socket_fd);
@@ -34,13 +67,28 @@ char *get_username_by_id(unsigned int user_id);
 int update_user_game_id(unsigned int user_id, unsigned int game_id);
 unsigned int get_user_game_id(unsigned int user_id);
 
-int create_game(const char *game_name, unsigned int owner_id);
+int create_game(const char *game_name, unsigned int owner_id, int ruleset_id, int bots_count);
+int create_game_with_id(unsigned int game_id, const char *game_name, unsigned int owner_id, int ruleset_id, int bots_count, const unsigned int *bot_ids, unsigned int bot_ids_count);
+int restore_game(const RestoredGame *restored, int owner_id);
+int hand_player_to_game(unsigned int game_id, unsigned int player_id);
 void remove_game(unsigned int game_id);
+void release_remote_game(unsigned int game_id);
+int get_next_game_id(size_t *cursor);
 void free_game(Game *game);
 int add_player_to_game(unsigned int game_id, unsigned int player_id);
 int remove_player_from_game(unsigned int game_id, unsigned int player_id);
 int get_game_owner_id(unsigned int game_id);
 char *get_game_name_by_id(unsigned int game_id);
+int get_game_ruleset_id(unsigned int game_id);
+unsigned int get_game_reserved_bots(unsigned int game_id, unsigned int *bot_ids);
 void set_game_started(unsigned int game_id, int started);
+int notify_all_games(int value);
+void count_games_by_state(unsigned int *waiting_out, unsigned int *started_out);
+unsigned int count_connected_users(void);
+int snapshot_games(GameSnapshot **snapshots_out);
+int snapshot_users(UserSnapshot **snapshots_out);
+int find_user_id_by_username(const char *username);
+int disconnect_user(unsigned int user_id);
+int notify_game(unsigned int game_id, int value);
 
 #endif // USERS_H
\ No newline at end of file
@@ -0,0 +1,477 @@
+#define _GNU_SOURCE // close_range
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include "server/workers.h"
+#include "server/users.h"
+#include "common/protocol.h"
+#include "utils/debug.h"
+
+#define WORKER_EPOLL_TAG(index) (UINT64_MAX - 1 - (uint64_t)(index)) // Tag del canale di un worker nel reactor della lobby
+
+typedef struct {
+    pid_t pid;
+    int channel_fd; // Canale con il worker, -1 se il worker non è attivo
+} WorkerProcess;
+
+static WorkerProcess workers[WORKER_MAX];
+static int workers_count = 0; // Worker avviati dal supervisore, 0 se il server è a processo singolo
+static char **worker_argv = NULL; // Argomenti con cui viene rieseguito il programma per avviare un worker
+static char worker_path[4096]; // Eseguibile del server
+static Reactor *lobby_reactor = NULL; // Reactor della lobby che riceve i messaggi dei worker
+static int worker_channel = -1; // Nel processo worker, canale con il supervisore
+
+/**
+ * Invia un messaggio su un canale tra supervisore e worker, con una socket allegata.
+ * @param client_s Socket da allegare come SCM_RIGHTS, -1 per nessuna.
+ * @return 0 in caso di successo, -1 in caso di errore.
+ */
+static int send_worker_message(int channel_fd, const WorkerMessage *message, int client_s) {
+    struct iovec iov = {(void *)message, sizeof(*message)};
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    char control[CMSG_SPACE(sizeof(int))];
+    if (client_s >= 0) {
+        memset(control, 0, sizeof(control));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &client_s, sizeof(int));
+    }
+
+    if (sendmsg(channel_fd, &msg, MSG_NOSIGNAL) != (ssize_t)sizeof(*message)) {
+        LOG_ERROR("Errore durante l'invio di un messaggio sul canale del worker: %s", strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Riceve un messaggio da un canale tra supervisore e worker, con l'eventuale socket allegata.
+ * @param client_s Socket ricevuta, -1 se il messaggio non ne ha.
+ * @return 1 se è stato ricevuto un messaggio, 0 se l'altro processo ha chiuso il canale,
+ *         -1 in caso di errore (errno EBADMSG se il messaggio era incompleto ed è stato scartato).
+ */
+static int recv_worker_message(int channel_fd, WorkerMessage *message, int *client_s) {
+    struct iovec iov = {message, sizeof(*message)};
+    char control[CMSG_SPACE(sizeof(int))];
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    *client_s = -1;
+    ssize_t received = recvmsg(channel_fd, &msg, MSG_CMSG_CLOEXEC);
+    if (received <= 0) {
+        return received == 0 ? 0 : -1;
+    }
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg != NULL && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+        memcpy(client_s, CMSG_DATA(cmsg), sizeof(int));
+    }
+    if (received != (ssize_t)sizeof(*message)) {
+        LOG_ERROR("Messaggio incompleto sul canale del worker (%zd byte)", received);
+        if (*client_s >= 0) close(*client_s);
+        errno = EBADMSG; // Il canale resta utilizzabile
+        return -1;
+    }
+    return 1;
+}
+
+/**
+ * Invia i byte già ricevuti dal client e non gestiti, in blocchi di al massimo WORKER_CHUNK_SIZE.
+ * @return 0 in caso di successo, -1 in caso di errore.
+ */
+static int send_pending_input(int channel_fd, const char *bytes, uint32_t size) {
+    for (uint32_t offset = 0; offset < size; offset += WORKER_CHUNK_SIZE) {
+        uint32_t chunk = size - offset < WORKER_CHUNK_SIZE ? size - offset : WORKER_CHUNK_SIZE;
+        if (send(channel_fd, bytes + offset, chunk, MSG_NOSIGNAL) != (ssize_t)chunk) {
+            LOG_ERROR("Errore durante l'invio dei byte del client al worker: %s", strerror(errno));
+            return -1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Riceve i byte che seguono un messaggio del supervisore e li riassocia alla socket del client.
+ * I blocchi vengono letti tutti anche se la socket manca, così il canale resta allineato.
+ * @param client_s Socket del client, -1 se il messaggio non ne ha.
+ * @param size Byte annunciati dal messaggio.
+ * @return 0 in caso di successo, -1 in caso di errore: la connessione va chiusa.
+ */
+static int recv_pending_input(int channel_fd, int client_s, uint32_t size) {
+    if (size > MAX_CONNECTION_INPUT_EXPORT) {
+        return -1;
+    }
+    char *bytes = (char *)malloc(size);
+    int result = bytes != NULL ? 0 : -1;
+    for (uint32_t offset = 0; offset < size; offset += WORKER_CHUNK_SIZE) {
+        uint32_t chunk = size - offset < WORKER_CHUNK_SIZE ? size - offset : WORKER_CHUNK_SIZE;
+        char discard[1];
+        ssize_t received = bytes != NULL ? recv(channel_fd, bytes + offset, chunk, 0) : recv(channel_fd, discard, sizeof(discard), MSG_TRUNC);
+        if (received != (ssize_t)chunk) result = -1;
+    }
+    if (result == 0 && client_s >= 0) {
+        result = importConnectionInput(client_s, bytes, size);
+    }
+    free(bytes);
+    return result;
+}
+
+/**
+ * Avvia un worker: crea il canale e riesegue il programma con `-worker`.
+ * Il figlio chiude tutti i file descriptor ereditati tranne il canale, che diventa
+ * WORKER_CHANNEL_FD, così le socket dei client restano solo al processo che le gestisce.
+ * @param index Indice del worker.
+ * @return 0 in caso di successo, -1 in caso di errore.
+ */
+static int spawn_worker(int index) {
+    int channel[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, channel) < 0) {
+        LOG_ERROR("Impossibile creare il canale del worker %d: %s", index, strerror(errno));
+        return -1;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        LOG_ERROR("Impossibile avviare il worker %d: %s", index, strerror(errno));
+        close(channel[0]);
+        close(channel[1]);
+        return -1;
+    }
+    if (pid == 0) {
+        // Solo chiamate async-signal-safe: il supervisore può avere altri thread
+        if (dup2(channel[1], WORKER_CHANNEL_FD) < 0) _exit(127); // dup2 azzera FD_CLOEXEC
+        close_range(WORKER_CHANNEL_FD + 1, ~0U, 0);
+        execv(worker_path, worker_argv);
+        _exit(127);
+    }
+
+    close(channel[1]);
+    workers[index].pid = pid;
+    workers[index].channel_fd = channel[0];
+    LOG_INFO("Worker %d avviato (pid %d)", index, (int)pid);
+    return 0;
+}
+
+/**
+ * Aggiunge il canale di un worker al reactor della lobby.
+ */
+static void watch_worker(int index) {
+    reactor_add(lobby_reactor, workers[index].channel_fd, WORKER_EPOLL_TAG(index));
+}
+
+/**
+ * Avvia i processi worker. Va chiamata prima di creare altri thread e socket.
+ * @param count Numero di worker, da 1 a WORKER_MAX.
+ * @param argv Argomenti del programma, con cui vengono rieseguiti i worker.
+ * @return 0 in caso di successo, -1 in caso di errore.
+ */
+int workers_start(int count, char *argv[]) {
+    if (count < 1 || count > WORKER_MAX) {
+        LOG_ERROR("Il numero di worker deve essere compreso tra 1 e %d", WORKER_MAX);
+        return -1;
+    }
+
+    // Eseguendo il percorso risolto invece di /proc/self/exe i worker mantengono il nome del server
+    ssize_t path_len = readlink("/proc/self/exe", worker_path, sizeof(worker_path) - 1);
+    if (path_len < 0) {
+        LOG_ERROR("Impossibile determinare l'eseguibile del server: %s", strerror(errno));
+        return -1;
+    }
+    worker_path[path_len] = '\0';
+
+    int argc = 0;
+    while (argv[argc] != NULL) argc++;
+    worker_argv = (char **)malloc((argc + 3) * sizeof(char *));
+    if (!worker_argv) return -1;
+    memcpy(worker_argv, argv, argc * sizeof(char *));
+    worker_argv[argc] = "-worker";
+    worker_argv[argc + 1] = "3"; // WORKER_CHANNEL_FD
+    worker_argv[argc + 2] = NULL;
+
+    for (int i = 0; i < count; i++) {
+        workers[i].channel_fd = -1;
+        if (spawn_worker(i) < 0) {
+            return -1;
+        }
+        workers_count++;
+    }
+    return 0;
+}
+
+/**
+ * @return 1 se il processo è un supervisore che affida le partite ai worker, 0 altrimenti.
+ */
+int workers_enabled(void) {
+    return workers_count > 0;
+}
+
+/**
+ * @return Indice del worker che possiede la partita.
+ */
+int worker_for_game(unsigned int game_id) {
+    return game_id % workers_count;
+}
+
+/**
+ * Aggiunge i canali dei worker al reactor della lobby, che ne riceve le notifiche.
+ * @param reactor Reactor della lobby.
+ */
+void workers_watch(Reactor *reactor) {
+    lobby_reactor = reactor;
+    for (int i = 0; i < workers_count; i++) {
+        watch_worker(i);
+    }
+}
+
+/**
+ * @return 1 se il tag di un evento del reactor della lobby appartiene al canale di un worker.
+ */
+int workers_is_channel_tag(uint64_t tag) {
+    return workers_count > 0 && tag < UINT64_MAX && tag >= WORKER_EPOLL_TAG(workers_count - 1);
+}
+
+/**
+ * Chiude le partite di un worker terminato e ne avvia un altro al suo posto.
+ * I client di quelle partite sono già stati disconnessi dalla terminazione del processo.
+ */
+static void replace_worker(int index) {
+    WorkerProcess *worker = &workers[index];
+    reactor_remove(lobby_reactor, worker->channel_fd);
+    close(worker->channel_fd);
+    worker->channel_fd = -1;
+
+    int status = 0;
+    waitpid(worker->pid, &status, 0);
+    LOG_ERROR("Il worker %d (pid %d) è terminato con stato %d, le sue partite vengono chiuse", index, (int)worker->pid, status);
+
+    int closed = 0;
+    size_t cursor = 0;
+    int game_id;
+    while ((game_id = get_next_game_id(&cursor)) >= 0) {
+        if (worker_for_game(game_id) == index) {
+            release_remote_game(game_id);
+            closed++;
+        }
+    }
+    LOG_INFO("Chiuse %d partite del worker %d", closed, index);
+
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 127) {
+        LOG_ERROR("Il worker %d non è riuscito ad avviarsi e non viene sostituito", index);
+        return;
+    }
+    if (spawn_worker(index) == 0) {
+        watch_worker(index);
+    }
+}
+
+/**
+ * Gestisce un messaggio ricevuto dal canale di un worker nel thread della lobby.
+ * @param tag Tag dell'evento del reactor (vedi workers_is_channel_tag).
+ */
+void workers_on_channel_event(uint64_t tag) {
+    int index = (int)(UINT64_MAX - 1 - tag);
+    WorkerMessage message;
+    int client_s;
+    int received = recv_worker_message(workers[index].channel_fd, &message, &client_s);
+    if (received == 0 || (received < 0 && errno != EINTR && errno != EBADMSG)) {
+        replace_worker(index);
+        return;
+    }
+    if (received < 0) {
+        return;
+    }
+    if (client_s >= 0) {
+        close(client_s); // I worker non inviano socket
+    }
+
+    switch (message.type) {
+        case WORKER_GAME_STARTED:
+            set_game_started(message.game_id, 1);
+            break;
+
+        case WORKER_GAME_ENDED:
+            LOG_DEBUG("Il worker %d ha chiuso la partita %d", index, message.game_id);
+            release_remote_game(message.game_id);
+            break;
+
+        default:
+            LOG_WARNING("Messaggio sconosciuto (%d) dal worker %d", message.type, index);
+            break;
+    }
+}
+
+/**
+ * Affida al worker della partita il client che l'ha appena creata o vi si è unito.
+ * Il client deve aver già ricevuto la risposta della lobby ed essere uscito dal suo reactor:
+ * la socket viene chiusa in questo processo e l'utente resta registrato senza socket fino
+ * alla fine della partita, per riservarne l'ID.
+ * @param game_id ID della partita.
+ * @param user_id ID dell'utente.
+ * @param client_s Socket del client.
+ * @param bots_count Bot da aggiungere alla nuova partita, -1 se l'utente si unisce a una partita esistente.
+ * @return 0 in caso di successo, -1 in caso di errore (il client viene disconnesso).
+ */
+int workers_hand_over_client(unsigned int game_id, unsigned int user_id, int client_s, int bots_count) {
+    WorkerMessage message;
+    memset(&message, 0, sizeof(message));
+    message.type = bots_count < 0 ? WORKER_JOIN_GAME : WORKER_CREATE_GAME;
+    message.game_id = game_id;
+    message.user_id = user_id;
+    message.ruleset_id = get_game_ruleset_id(game_id);
+    message.bots_count = bots_count < 0 ? 0 : bots_count;
+    message.reserved_bots_count = get_game_reserved_bots(game_id, message.reserved_bot_ids);
+
+    char *username = get_username_by_id(user_id);
+    char *game_name = get_game_name_by_id(game_id);
+    int game_exists = game_name != NULL;
+    snprintf(message.username, sizeof(message.username), "%s", username ? username : "");
+    snprintf(message.game_name, sizeof(message.game_name), "%s", game_name ? game_name : "");
+    free(username);
+    free(game_name);
+
+    char *pending = NULL;
+    if (exportConnectionInput(client_s, &pending, &message.pending_size) < 0) {
+        LOG_WARNING("Allocazione fallita, i messaggi in arrivo dall'utente %d andranno persi", user_id);
+    }
+
+    int index = worker_for_game(game_id);
+    int success = -1;
+    if (game_exists && workers[index].channel_fd >= 0) {
+        success = send_worker_message(workers[index].channel_fd, &message, client_s);
+        if (success == 0) success = send_pending_input(workers[index].channel_fd, pending, message.pending_size);
+    }
+    free(pending);
+    closeConnection(client_s);
+    update_user_socket_fd(user_id, -1);
+
+    if (success < 0) {
+        LOG_ERROR("Impossibile affidare l'utente %d al worker %d della partita %d", user_id, index, game_id);
+        if (message.type == WORKER_CREATE_GAME) {
+            release_remote_game(game_id);
+        }
+        // Chi si unisce resta nella partita fino alla sua fine, come se si fosse disconnesso
+    } else {
+        LOG_DEBUG("Utente %d affidato al worker %d per la partita %d", user_id, index, game_id);
+    }
+    return success;
+}
+
+/**
+ * Registra nel worker un client ricevuto dal supervisore e lo affida alla sua partita,
+ * creandola se necessario.
+ */
+static void adopt_client(const WorkerMessage *message, int client_s) {
+    if (create_user_with_id(message->user_id, message->username, client_s) < 0) {
+        LOG_ERROR("L'ID utente %d ricevuto dal supervisore è già in uso", message->user_id);
+        closeConnection(client_s);
+        return;
+    }
+
+    int result;
+    if (message->type == WORKER_CREATE_GAME) {
+        result = create_game_with_id(message->game_id, message->game_name, message->user_id, message->ruleset_id,
+                                     message->bots_count, message->reserved_bot_ids, message->reserved_bots_count);
+    } else {
+        result = add_player_to_game(message->game_id, message->user_id);
+    }
+
+    if (result < 0) {
+        LOG_ERROR("Impossibile affidare l'utente %d alla partita %d", message->user_id, message->game_id);
+        closeConnection(client_s);
+        remove_user(message->user_id);
+        if (message->type == WORKER_CREATE_GAME) {
+            worker_report_game_ended(message->game_id);
+        }
+        return;
+    }
+
+    hand_player_to_game(message->game_id, message->user_id);
+}
+
+/**
+ * Ciclo principale di un processo worker: riceve dal supervisore i client delle proprie
+ * partite. Termina il processo quando il supervisore chiude il canale.
+ * @param channel_fd Canale con il supervisore.
+ */
+void worker_main(int channel_fd) {
+    worker_channel = channel_fd;
+    LOG_INFO("Worker in attesa di partite dal supervisore (pid %d)", (int)getpid());
+
+    while (1) {
+        WorkerMessage message;
+        int client_s;
+        int received = recv_worker_message(channel_fd, &message, &client_s);
+        if (received == 0) {
+            LOG_INFO("Il supervisore ha chiuso il canale, il worker termina");
+            exit(EXIT_SUCCESS);
+        }
+        if (received < 0) {
+            if (errno == EINTR || errno == EBADMSG) continue;
+            LOG_ERROR("Errore sul canale con il supervisore: %s", strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+        if (message.pending_size > 0 && recv_pending_input(channel_fd, client_s, message.pending_size) < 0) {
+            LOG_ERROR("Messaggi in arrivo dall'utente %d non ricevuti", message.user_id);
+            if (client_s >= 0) closeConnection(client_s);
+            continue;
+        }
+        if (client_s < 0 || (message.type != WORKER_CREATE_GAME && message.type != WORKER_JOIN_GAME)) {
+            LOG_WARNING("Messaggio non valido dal supervisore (%d)", message.type);
+            if (client_s >= 0) closeConnection(client_s);
+            continue;
+        }
+
+        message.username[WORKER_NAME_SIZE - 1] = '\0';
+        message.game_name[WORKER_NAME_SIZE - 1] = '\0';
+        adopt_client(&message, client_s);
+    }
+}
+
+/**
+ * Notifica al supervisore un cambiamento di una partita del worker.
+ * Non fa nulla se il processo non è un worker.
+ */
+static void report_game(WorkerMessageType type, unsigned int game_id) {
+    if (worker_channel < 0) return;
+
+    WorkerMessage message;
+    memset(&message, 0, sizeof(message));
+    message.type = type;
+    message.game_id = game_id;
+    send_worker_message(worker_channel, &message, -1);
+}
+
+/**
+ * Notifica al supervisore che la partita è iniziata e non accetta più giocatori.
+ * @param game_id ID della partita.
+ */
+void worker_report_game_started(unsigned int game_id) {
+    report_game(WORKER_GAME_STARTED, game_id);
+}
+
+/**
+ * Notifica al supervisore che la partita è terminata e i suoi utenti sono stati rimossi dal worker,
+ * così il supervisore può riassegnarne gli ID.
+ * @param game_id ID della partita.
+ */
+void worker_report_game_ended(unsigned int game_id) {
+    report_game(WORKER_GAME_ENDED, game_id);
+}
@@ -0,0 +1,65 @@
+#ifndef WORKERS_H
+#define WORKERS_H
+
+#include <stdint.h>
+
+#include "server/gameManager.h"
+
+/**
+ * Modalità multi-processo del server.
+ * Con `-workers N` il processo avviato diventa il supervisore: mantiene la socket in ascolto e
+ * la lobby, e avvia N processi worker rieseguendo lo stesso programma con `-worker FD`.
+ * Ogni worker possiede le partite il cui ID, modulo N, è il suo indice: quando un client crea
+ * una partita o vi si unisce, la lobby gli risponde e poi passa la sua socket al worker
+ * con SCM_RIGHTS su una socket UNIX, insieme a utente e partita. Da lì il client parla solo
+ * con il worker, dove la partita gira nel suo thread come nel server a processo singolo.
+ *
+ * I byte che la lobby ha già ricevuto dal client senza gestirli (vedi exportConnectionInput in
+ * protocol.c) seguono il messaggio in blocchi di al massimo WORKER_CHUNK_SIZE, e il worker li
+ * riassocia alla socket prima di leggerla.
+ *
+ * Il supervisore assegna tutti gli ID, così restano unici tra i processi: la partita viene
+ * registrata nella sua lista senza thread di gioco e riserva MAX_GAME_BOTS ID di utente
+ * per i bot che il worker potrà aggiungere. Il worker segnala l'avvio della partita (che la
+ * chiude ai nuovi ingressi) e la sua fine, dopo la quale il supervisore libera gli ID.
+ * Se un worker termina, le sue partite vengono chiuse e il supervisore ne avvia un altro.
+ */
+
+#define WORKER_MAX 64 // Numero massimo di processi worker
+#define WORKER_CHANNEL_FD 3 // File descriptor del canale con il supervisore nel processo worker
+#define WORKER_NAME_SIZE 64
+#define WORKER_CHUNK_SIZE (64 * 1024) // Byte ricevuti dal client e non gestiti inviati con una sola sendmsg
+
+typedef enum {
+    WORKER_CREATE_GAME, // Supervisore -> worker: nuova partita, con la socket del proprietario
+    WORKER_JOIN_GAME, // Supervisore -> worker: nuovo giocatore, con la sua socket
+    WORKER_GAME_STARTED, // Worker -> supervisore: la partita non accetta più giocatori
+    WORKER_GAME_ENDED // Worker -> supervisore: la partita è terminata e i suoi utenti rimossi
+} WorkerMessageType;
+
+typedef struct {
+    uint8_t type; // WorkerMessageType
+    int32_t game_id;
+    int32_t user_id; // Utente di cui segue la socket
+    int32_t ruleset_id;
+    int32_t bots_count; // Bot da aggiungere alla creazione della partita
+    int32_t reserved_bots_count; // ID validi in `reserved_bot_ids`
+    uint32_t reserved_bot_ids[MAX_GAME_BOTS]; // ID di utente riservati dal supervisore ai bot della partita
+    char username[WORKER_NAME_SIZE];
+    char game_name[WORKER_NAME_SIZE];
+    uint32_t pending_size; // Byte già ricevuti dalla socket e non gestiti, inviati dopo il messaggio
+} WorkerMessage;
+
+int workers_start(int count, char *argv[]);
+int workers_enabled(void);
+int worker_for_game(unsigned int game_id);
+void workers_watch(Reactor *reactor);
+int workers_is_channel_tag(uint64_t tag);
+void workers_on_channel_event(uint64_t tag);
+int workers_hand_over_client(unsigned int game_id, unsigned int user_id, int client_s, int bots_count);
+
+void worker_main(int channel_fd);
+void worker_report_game_started(unsigned int game_id);
+void worker_report_game_ended(unsigned int game_id);
+
+#endif // WORKERS_H
@@ -0,0 +1,274 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <pthread.h>
+
+#include "utils/cmdLineParser.h"
+#include "utils/debug.h"
+#include "common/game.h"
+#include "common/gameEngine.h"
+#include "common/bot.h"
+#include "common/fleetPlacement.h"
+
+#define MAX_SIM_PLAYERS 16
+
+/**
+ * Simulatore headless: gioca partite complete con giocatori casuali usando direttamente
+ * il motore di gioco, senza socket né thread di partita.
+ * Le partite sono divise tra più thread, uno per core di default.
+ */
+
+typedef struct {
+    int thread_index;
+    unsigned long games; // Partite da giocare in questo thread
+    int players; // Giocatori per partita
+    int bots; // Giocatori per partita guidati dal bot, gli altri sparano a caso
+    int ruleset_id;
+    unsigned int seed;
+
+    // Risultati
+    unsigned long games_finished;
+    unsigned long turns;
+    unsigned long shots;
+    unsigned long engine_errors;
+    unsigned long bot_wins;
+} SimThreadArg;
+
+typedef struct {
+    int cells[GRID_SIZE * GRID_SIZE]; // Celle non ancora colpite, codificate come x * GRID_SIZE + y
+    int pos[GRID_SIZE * GRID_SIZE]; // Posizione di ogni cella in `cells`, -1 se già colpita
+    int count; // Numero di celle valide in `cells`
+} CellPool;
+
+static void init_cell_pool(CellPool *pool) {
+    pool->count = GRID_SIZE * GRID_SIZE;
+    for (int c = 0; c < GRID_SIZE * GRID_SIZE; c++) {
+        pool->cells[c] = c;
+        pool->pos[c] = c;
+    }
+}
+
+/**
+ * Rimuove una cella dal pool in O(1), se ancora presente.
+ */
+static void remove_cell(CellPool *pool, int cell) {
+    int index = pool->pos[cell];
+    if (index < 0) return;
+
+    int last = pool->cells[--pool->count];
+    pool->cells[index] = last;
+    pool->pos[last] = index;
+    pool->pos[cell] = -1;
+}
+
+/**
+ * Prepara la salva del giocatore di turno scegliendo celle non ancora colpite di avversari casuali.
+ * @return Numero di colpi nella salva.
+ */
+static int random_salvo(GameState *game, int attacker_id, CellPool *pools, AttackPosition *shots, unsigned int *rng_state) {
+    int opponents[MAX_SIM_PLAYERS];
+    int opponents_count = 0;
+    for (unsigned int i = 0; i < game->player_turn_order_count; i++) {
+        int player_id = game->player_turn_order[i];
+        if (player_id != -1 && player_id != attacker_id) {
+            opponents[opponents_count++] = player_id;
+        }
+    }
+
+    int shots_count = 0;
+    while (shots_count < game->rules->salvo_size && opponents_count > 0) {
+        int target_index = rand_r(rng_state) % opponents_count;
+        int target_id = opponents[target_index];
+        CellPool *pool = &pools[target_id];
+        if (pool->count == 0) {
+            opponents[target_index] = opponents[--opponents_count];
+            continue;
+        }
+
+        // Estrazione senza reinserimento: nessuna cella ripetuta nella salva
+        int cell = pool->cells[rand_r(rng_state) % pool->count];
+        remove_cell(pool, cell);
+
+        shots[shots_count].player_id = target_id;
+        shots[shots_count].x = cell / GRID_SIZE;
+        shots[shots_count].y = cell % GRID_SIZE;
+        shots_count++;
+    }
+    return shots_count;
+}
+
+/**
+ * Gioca una partita completa.
+ * @return 0 se la partita è terminata correttamente, -1 se il motore ha rifiutato un'azione.
+ */
+static int play_game(SimThreadArg *arg, unsigned int game_id, GameEventList *events, unsigned int *rng_state) {
+    GameState *game = engine_create_game(game_id, "sim", arg->ruleset_id, rand_r(rng_state) | 1);
+    if (game == NULL) return -1;
+
+    CellPool pools[MAX_SIM_PLAYERS];
+    char username[16];
+    int ret = 0;
+
+    for (int i = 0; i < arg->players && ret == 0; i++) {
+        snprintf(username, sizeof(username), "player%d", i);
+        FleetSetup fleet;
+        generate_random_fleet(&fleet, game->rules->fleet, rng_state);
+        if (engine_join(game, i, username, NULL) != ENGINE_OK || engine_place_fleet(game, i, &fleet, NULL) != ENGINE_OK) {
+            ret = -1;
+            break;
+        }
+        if (i < arg->bots) {
+            game->players[game->players_count - 1].bot = create_bot(i, rand_r(rng_state));
+        }
+        init_cell_pool(&pools[i]);
+    }
+
+    if (ret == 0 && engine_start(game, NULL) != ENGINE_OK) {
+        ret = -1;
+    }
+
+    while (ret == 0 && game->state_type == GAME_IN_PROGRESS) {
+        AttackPosition shots[MAX_SALVO_SIZE];
+        int attacker_id = engine_current_player(game);
+        PlayerState *attacker = get_player_state(game, attacker_id);
+        int shots_count = attacker->bot != NULL
+            ? bot_choose_salvo(attacker->bot, game, shots)
+            : random_salvo(game, attacker_id, pools, shots, rng_state);
+
+        clear_game_event_list(events);
+        if (engine_apply_attack(game, attacker_id, shots, shots_count, events) != ENGINE_OK) {
+            ret = -1;
+            break;
+        }
+        arg->turns++;
+        arg->shots += shots_count;
+
+        for (unsigned int e = 0; e < events->count; e++) {
+            GameEvent *event = &events->events[e];
+            if (event->type == GAME_EVENT_ATTACK) {
+                remove_cell(&pools[event->target_id], event->x * GRID_SIZE + event->y);
+                for (unsigned int p = 0; p < game->players_count; p++) {
+                    if (game->players[p].bot != NULL) {
+                        bot_observe_attack(game->players[p].bot, game, event);
+                    }
+                }
+            } else if (event->type == GAME_EVENT_GAME_FINISHED && event->player_id >= 0 && event->player_id < arg->bots) {
+                arg->bot_wins++;
+            }
+        }
+    }
+
+    if (ret == 0) arg->games_finished++;
+    free_game_state(game);
+    return ret;
+}
+
+void *sim_thread(void *arg) {
+    SimThreadArg *sim_arg = (SimThreadArg *)arg;
+    unsigned int rng_state = sim_arg->seed + sim_arg->thread_index * 7919;
+    GameEventList events;
+    init_game_event_list(&events);
+
+    for (unsigned long i = 0; i < sim_arg->games; i++) {
+        if (play_game(sim_arg, i, &events, &rng_state) < 0) {
+            sim_arg->engine_errors++;
+        }
+    }
+
+    free_game_event_list(&events);
+    return NULL;
+}
+
+static long parse_long_param(ArgvParam *args, char *name, long default_value, long min_value) {
+    char *value = getArgvParamValue(name, args);
+    if (value == NULL) return default_value;
+
+    char *endPtr;
+    long result = strtol(value, &endPtr, 0);
+    if (*endPtr || result < min_value) {
+        LOG_ERROR("Valore non valido per -%s: %s", name, value);
+        exit(EXIT_FAILURE);
+    }
+    return result;
+}
+
+int main(int argc, char *argv[]) {
+    ArgvParam *allowedArgs = setArgvParams("-Vgames,-Vplayers,-Vbots,-Vthreads,-Vruleset,-Vseed");
+    parseCmdLine(argc, argv, allowedArgs);
+
+    long games = parse_long_param(allowedArgs, "games", 100000, 1);
+    long players = parse_long_param(allowedArgs, "players", 2, 2);
+    long bots = parse_long_param(allowedArgs, "bots", 0, 0);
+    long threads = parse_long_param(allowedArgs, "threads", sysconf(_SC_NPROCESSORS_ONLN), 1);
+    long seed = parse_long_param(allowedArgs, "seed", time(NULL), 0);
+
+    int ruleset_id = 0;
+    char *ruleset = getArgvParamValue("ruleset", allowedArgs);
+    if (ruleset != NULL && (ruleset_id = find_game_rules(ruleset)) < 0) {
+        LOG_ERROR("Regolamento sconosciuto: %s", ruleset);
+        exit(EXIT_FAILURE);
+    }
+
+    if (players > MAX_SIM_PLAYERS) {
+        LOG_ERROR("Al massimo %d giocatori per partita", MAX_SIM_PLAYERS);
+        exit(EXIT_FAILURE);
+    }
+    if (bots > players) bots = players;
+    if (threads > games) threads = games;
+
+    SimThreadArg *thread_args = (SimThreadArg *)calloc(threads, sizeof(SimThreadArg));
+    pthread_t *tids = (pthread_t *)malloc(threads * sizeof(pthread_t));
+    if (thread_args == NULL || tids == NULL) {
+        LOG_ERROR("Allocazione dei thread del simulatore fallita");
+        exit(EXIT_FAILURE);
+    }
+
+    LOG_INFO("Simulazione di %ld partite (%ld giocatori di cui %ld bot, regolamento %s, seed %ld) su %ld thread",
+             games, players, bots, get_game_rules(ruleset_id)->name, seed, threads);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (long t = 0; t < threads; t++) {
+        thread_args[t].thread_index = t;
+        thread_args[t].games = games / threads + (t < games % threads ? 1 : 0);
+        thread_args[t].players = players;
+        thread_args[t].bots = bots;
+        thread_args[t].ruleset_id = ruleset_id;
+        thread_args[t].seed = (unsigned int)seed;
+        if (pthread_create(&tids[t], NULL, sim_thread, &thread_args[t]) != 0) {
+            LOG_ERROR("Errore nella creazione del thread %ld", t);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    unsigned long games_finished = 0, turns = 0, shots = 0, engine_errors = 0, bot_wins = 0;
+    for (long t = 0; t < threads; t++) {
+        pthread_join(tids[t], NULL);
+        games_finished += thread_args[t].games_finished;
+        turns += thread_args[t].turns;
+        shots += thread_args[t].shots;
+        engine_errors += thread_args[t].engine_errors;
+        bot_wins += thread_args[t].bot_wins;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    printf("partite:        %lu\n", games_finished);
+    printf("turni:          %lu (%.1f per partita)\n", turns, games_finished ? (double)turns / games_finished : 0.0);
+    printf("colpi:          %lu\n", shots);
+    printf("errori motore:  %lu\n", engine_errors);
+    if (bots > 0) {
+        printf("vittorie bot:   %lu (%.1f%%)\n", bot_wins, games_finished ? 100.0 * bot_wins / games_finished : 0.0);
+    }
+    printf("tempo:          %.3f s\n", elapsed);
+    printf("partite/s:      %.0f\n", elapsed > 0 ? games_finished / elapsed : 0.0);
+
+    free(thread_args);
+    free(tids);
+    return engine_errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,146 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <pthread.h>
+
+#include "utils/arena.h"
+
+#define STANDARD_BLOCK_DATA (ARENA_BLOCK_SIZE - sizeof(ArenaBlock))
+
+static __thread ArenaBlock *cached_blocks = NULL; // Blocchi standard liberi del thread
+static __thread int cached_count = 0;
+static __thread int thread_registered = 0;
+static __thread Arena scratch_arena = {NULL};
+
+static pthread_once_t cache_once = PTHREAD_ONCE_INIT;
+static pthread_key_t cache_key;
+
+/**
+ * Libera l'arena temporanea e la cache dei blocchi di un thread che termina.
+ */
+static void release_thread_blocks(void *arg) {
+    (void)arg;
+    arena_release(&scratch_arena);
+    while (cached_blocks != NULL) {
+        ArenaBlock *block = cached_blocks;
+        cached_blocks = block->previous;
+        free(block);
+    }
+    cached_count = 0;
+}
+
+static void init_cache_key(void) {
+    pthread_key_create(&cache_key, release_thread_blocks);
+}
+
+/**
+ * Fa liberare la cache del thread corrente quando termina.
+ */
+static void register_thread(void) {
+    // Il valore della chiave serve solo a far chiamare il distruttore all'uscita del thread
+    pthread_once(&cache_once, init_cache_key);
+    pthread_setspecific(cache_key, &scratch_arena);
+    thread_registered = 1;
+}
+
+/**
+ * Restituisce un blocco standard libero, dalla cache del thread se possibile.
+ * @return Il blocco, vuoto, o NULL se manca la memoria.
+ */
+static ArenaBlock *take_standard_block(void) {
+    ArenaBlock *block = cached_blocks;
+    if (block != NULL) {
+        cached_blocks = block->previous;
+        cached_count--;
+    } else {
+        if (!thread_registered) register_thread();
+        block = (ArenaBlock *)malloc(ARENA_BLOCK_SIZE);
+        if (block == NULL) return NULL;
+        block->size = STANDARD_BLOCK_DATA;
+    }
+    block->used = 0;
+    return block;
+}
+
+/**
+ * Restituisce un blocco: quelli standard tornano nella cache del thread finché c'è posto.
+ */
+static void give_back_block(ArenaBlock *block) {
+    if (block->size == STANDARD_BLOCK_DATA && cached_count < ARENA_CACHED_BLOCKS) {
+        if (!thread_registered) register_thread();
+        block->previous = cached_blocks;
+        cached_blocks = block;
+        cached_count++;
+    } else {
+        free(block);
+    }
+}
+
+/**
+ * Aggiunge un blocco all'arena e vi alloca `size` byte (già allineati). Chiamata da arena_alloc
+ * quando il blocco corrente non ha spazio.
+ * @return Puntatore alla memoria, o NULL se manca la memoria.
+ */
+void *arena_alloc_slow(Arena *arena, size_t size) {
+    ArenaBlock *block;
+    if (size <= STANDARD_BLOCK_DATA) {
+        block = take_standard_block();
+    } else {
+        block = (ArenaBlock *)malloc(sizeof(ArenaBlock) + size);
+        if (block != NULL) {
+            block->size = size;
+            block->used = 0;
+        }
+    }
+    if (block == NULL) return NULL;
+
+    block->previous = arena->current;
+    arena->current = block;
+    block->used = size;
+    return block->data;
+}
+
+/**
+ * Copia una stringa nell'arena.
+ * @return La copia, o NULL se manca la memoria.
+ */
+char *arena_strdup(Arena *arena, const char *s) {
+    size_t length = strlen(s);
+    char *copy = (char *)arena_alloc(arena, length + 1);
+    if (copy != NULL) {
+        memcpy(copy, s, length + 1);
+    }
+    return copy;
+}
+
+/**
+ * Libera tutto ciò che è stato allocato dall'arena dopo `mark`.
+ * @param mark Punto salvato con arena_mark sulla stessa arena.
+ */
+void arena_rewind(Arena *arena, ArenaMark mark) {
+    while (arena->current != mark.block) {
+        ArenaBlock *block = arena->current;
+        arena->current = block->previous;
+        give_back_block(block);
+    }
+    if (mark.block != NULL) {
+        mark.block->used = mark.used;
+    }
+}
+
+/**
+ * Libera tutta la memoria dell'arena, che resta utilizzabile (vuota).
+ * I blocchi possono essere allocati da un thread e liberati da un altro: finiscono nella cache
+ * del thread che li libera.
+ */
+void arena_release(Arena *arena) {
+    ArenaMark empty = {NULL, 0};
+    arena_rewind(arena, empty);
+}
+
+/**
+ * Restituisce l'arena temporanea del thread corrente.
+ */
+Arena *arena_scratch(void) {
+    return &scratch_arena;
+}
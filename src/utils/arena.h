@@ -0,0 +1,68 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/**
+ * Allocatore a incremento (bump) per gli oggetti piccoli e di vita breve del protocollo.
+ * Un'arena è una catena di blocchi: allocare è avanzare un indice nel blocco corrente, e la
+ * memoria si libera solo tutta insieme (arena_release) o fino a un punto salvato prima
+ * (arena_mark, arena_rewind). I blocchi da ARENA_BLOCK_SIZE byte liberati finiscono in una
+ * cache del thread che li libera, da cui le arene dello stesso thread li riprendono senza
+ * passare da malloc; le richieste più grandi hanno un blocco dedicato, restituito a free.
+ *
+ * Ogni thread ha anche un'arena temporanea (arena_scratch) per i buffer che servono solo durante
+ * l'invio o la ricezione di un messaggio: chi la usa salva il punto con arena_mark e lo
+ * ripristina prima di ritornare, così l'arena si svuota dopo ogni messaggio.
+ */
+
+#define ARENA_BLOCK_SIZE 4096 // Byte di un blocco standard, intestazione compresa
+#define ARENA_CACHED_BLOCKS 16 // Blocchi standard tenuti nella cache di ogni thread, quelli oltre tornano a free
+#define ARENA_ALIGN 8 // Allineamento delle allocazioni
+
+typedef struct _ArenaBlock {
+    struct _ArenaBlock *previous; // Blocco precedente dell'arena, o successivo nella cache del thread
+    size_t size; // Byte utilizzabili in `data`
+    size_t used;
+    char data[];
+} ArenaBlock;
+
+typedef struct {
+    ArenaBlock *current; // Blocco da cui si alloca, NULL per un'arena vuota
+} Arena;
+
+typedef struct {
+    ArenaBlock *block;
+    size_t used;
+} ArenaMark;
+
+void *arena_alloc_slow(Arena *arena, size_t size);
+char *arena_strdup(Arena *arena, const char *s);
+void arena_rewind(Arena *arena, ArenaMark mark);
+void arena_release(Arena *arena);
+Arena *arena_scratch(void);
+
+/**
+ * Alloca `size` byte dall'arena, allineati ad ARENA_ALIGN.
+ * @return Puntatore alla memoria, valido fino al rilascio dell'arena, o NULL se manca la memoria.
+ */
+static inline void *arena_alloc(Arena *arena, size_t size) {
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    ArenaBlock *block = arena->current;
+    if (block != NULL && block->size - block->used >= size) {
+        void *ptr = block->data + block->used;
+        block->used += size;
+        return ptr;
+    }
+    return arena_alloc_slow(arena, size);
+}
+
+/**
+ * Salva il punto attuale dell'arena, da ripristinare con arena_rewind.
+ */
+static inline ArenaMark arena_mark(const Arena *arena) {
+    ArenaMark mark = {arena->current, arena->current != NULL ? arena->current->used : 0};
+    return mark;
+}
+
+#endif // ARENA_H
@@ -0,0 +1,632 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <time.h>
+
+#include <pthread.h>
+
+#include "utils/asyncLog.h"
+#include "utils/debug.h"
+
+typedef struct {
+    const char *label;
+    const char *color;
+} LogKindInfo;
+
+static const LogKindInfo LOG_KIND_INFO_TABLE[LOG_KINDS] = {
+    [LOG_KIND_DEBUG] = {"DEBUG", ANSI_COLOR_BLUE},
+    [LOG_KIND_INFO] = {"INFO", ANSI_COLOR_GREEN},
+    [LOG_KIND_WARNING] = {"WARNING", ANSI_COLOR_YELLOW},
+    [LOG_KIND_ERROR] = {"ERROR", ANSI_COLOR_RED},
+    [LOG_KIND_MSG_ERROR] = {"MSG ERROR", ANSI_COLOR_MAGENTA},
+};
+
+static const char *const LOG_LEVEL_NAMES[] = {"debug", "info", "warning", "error"};
+
+#define LOG_RECORD_PAD 0xFF // Tipo del record che riempie la fine del ring
+#define LOG_MAX_TAG 255
+
+/**
+ * Intestazione di un record nel ring, seguita dagli argomenti (uint64_t), dal tag e dalle stringhe
+ * copiate. Un argomento stringa contiene la posizione della copia tra le stringhe e la sua lunghezza.
+ */
+typedef struct {
+    uint32_t size; // Byte del record, multiplo di 8
+    uint8_t kind;
+    uint8_t to_stderr;
+    uint16_t tag_length; // Il tag segue gli argomenti
+    uint32_t args_count;
+    uint32_t has_tag; // 0 per i messaggi senza tag
+    int64_t time_ns; // CLOCK_REALTIME
+    const char *fmt;
+} LogRecord;
+
+// Spazio per le stringhe di un record, tolti intestazione, argomenti e tag
+#define LOG_MAX_STRINGS (LOG_MAX_RECORD - sizeof(LogRecord) - LOG_MAX_ARGS * sizeof(uint64_t) - LOG_MAX_TAG)
+
+// Come leggere un argomento con va_arg, ricavato dalla sua conversione
+typedef enum {
+    LOG_ARG_INT,        // int con segno (d, i, c, larghezza e precisione con *)
+    LOG_ARG_UINT,       // unsigned int (o, u, x, X)
+    LOG_ARG_LONG,       // long, long long, size_t, ptrdiff_t, intmax_t: 64 bit
+    LOG_ARG_DOUBLE,
+    LOG_ARG_LONG_DOUBLE,
+    LOG_ARG_STRING,
+    LOG_ARG_POINTER     // Anche %n, che viene ignorata
+} LogArgType;
+
+/**
+ * Argomenti di una stringa di formato, ricavati la prima volta che il thread la usa: il
+ * puntatore alla stringa, sempre un letterale, fa da identificativo del formato.
+ */
+typedef struct {
+    const char *fmt;
+    uint8_t args_count;
+    uint8_t types[LOG_MAX_ARGS];
+    int16_t string_precisions[LOG_MAX_ARGS]; // Precisione di una stringa: -1 se assente, -2 se è l'argomento precedente
+} LogFormat;
+
+#define LOG_FORMAT_CACHE 128 // Formati ricordati da ogni thread, potenza di 2
+
+typedef struct _LogRing {
+    _Atomic uint64_t head; // Byte scritti, aggiornato solo dal thread proprietario
+    _Atomic uint64_t tail; // Byte letti, aggiornato solo dal thread di scrittura
+    _Atomic uint64_t dropped; // Messaggi scartati con il ring pieno
+    uint64_t dropped_reported; // Letto e scritto solo dal thread di scrittura
+    int in_use;
+    struct _LogRing *next; // Modificato solo sotto il lock del registro
+    LogFormat formats[LOG_FORMAT_CACHE]; // Usati solo dal thread proprietario
+    unsigned char data[LOG_RING_SIZE];
+} LogRing;
+
+/**
+ * Conversione di una stringa di formato, letta allo stesso modo da chi registra e da chi formatta.
+ */
+typedef struct {
+    char flags[8];
+    int width; // -1 se assente, -2 se letta dagli argomenti (*)
+    int precision; // -1 se assente, -2 se letta dagli argomenti (.*)
+    char length[3]; // Modificatore di lunghezza: "", "hh", "h", "l", "ll", "z", "j", "t", "L"
+    char conversion;
+} LogConversion;
+
+_Atomic int log_min_level = LOG_KIND_DEBUG;
+
+static _Atomic int async_active = 0;
+static __thread LogRing *local_ring = NULL;
+
+static pthread_mutex_t registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+static LogRing *registry_head = NULL;
+static pthread_once_t registry_once = PTHREAD_ONCE_INIT;
+static pthread_key_t registry_key;
+
+static pthread_mutex_t flush_mutex = PTHREAD_MUTEX_INITIALIZER; // Un solo thread alla volta svuota i ring
+static int stdout_colors = -1, stderr_colors = -1; // -1 se non ancora controllato
+
+/**
+ * Imposta il livello minimo dei messaggi scritti.
+ * @param name `debug`, `info`, `warning` o `error`.
+ * @return 0 in caso di successo, -1 se il livello non esiste.
+ */
+int log_set_level(const char *name) {
+    for (int level = 0; level < (int)(sizeof(LOG_LEVEL_NAMES) / sizeof(LOG_LEVEL_NAMES[0])); level++) {
+        if (strcmp(name, LOG_LEVEL_NAMES[level]) == 0) {
+            atomic_store_explicit(&log_min_level, level, memory_order_relaxed);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+const char *log_level_name(void) {
+    return LOG_LEVEL_NAMES[atomic_load_explicit(&log_min_level, memory_order_relaxed)];
+}
+
+/**
+ * Indica se usare i colori su uno stream, cioè se è un terminale.
+ */
+static int use_colors(FILE *stream) {
+    int *cached = stream == stdout ? &stdout_colors : stream == stderr ? &stderr_colors : NULL;
+    if (cached == NULL) return isatty(fileno(stream));
+    if (*cached < 0) *cached = isatty(fileno(stream));
+    return *cached;
+}
+
+/**
+ * Scrive l'etichetta di un messaggio: `[LIVELLO]` o `[LIVELLO][tag]`, colorata sui terminali.
+ */
+static void write_label(FILE *stream, LogKind kind, const char *tag, int tag_length) {
+    int colors = use_colors(stream);
+    fprintf(stream, "%s[%s]", colors ? LOG_KIND_INFO_TABLE[kind].color : "", LOG_KIND_INFO_TABLE[kind].label);
+    if (tag != NULL) {
+        fprintf(stream, "[%.*s]", tag_length, tag);
+    }
+    fprintf(stream, " %s", colors ? ANSI_COLOR_RESET : "");
+}
+
+/**
+ * Legge una conversione della stringa di formato.
+ * @param p Carattere successivo al `%`.
+ * @param conv Conversione letta.
+ * @return Il carattere successivo alla conversione, o NULL se la conversione non è valida.
+ */
+static const char *parse_conversion(const char *p, LogConversion *conv) {
+    size_t flags = 0;
+    while (*p && strchr("-+ #0'", *p) != NULL && flags < sizeof(conv->flags) - 1) {
+        conv->flags[flags++] = *p++;
+    }
+    conv->flags[flags] = '\0';
+
+    conv->width = -1;
+    if (*p == '*') {
+        conv->width = -2;
+        p++;
+    } else if (*p >= '0' && *p <= '9') {
+        conv->width = (int)strtol(p, (char **)&p, 10);
+    }
+
+    conv->precision = -1;
+    if (*p == '.') {
+        p++;
+        if (*p == '*') {
+            conv->precision = -2;
+            p++;
+        } else {
+            conv->precision = (int)strtol(p, (char **)&p, 10);
+        }
+    }
+
+    size_t length = 0;
+    while (*p && strchr("hlzjtL", *p) != NULL && length < sizeof(conv->length) - 1) {
+        conv->length[length++] = *p++;
+    }
+    conv->length[length] = '\0';
+
+    if (*p == '\0' || strchr("diouxXcsfFeEgGaApn", *p) == NULL) return NULL;
+    conv->conversion = *p;
+    return p + 1;
+}
+
+static void detach_thread(void *arg) {
+    LogRing *ring = (LogRing *)arg;
+    pthread_mutex_lock(&registry_mutex);
+    ring->in_use = 0;
+    pthread_mutex_unlock(&registry_mutex);
+}
+
+static void init_registry(void) {
+    pthread_key_create(&registry_key, detach_thread);
+}
+
+/**
+ * Assegna un ring al thread corrente, riusando quello di un thread terminato se c'è: il thread di
+ * scrittura continua a leggerlo da dove era arrivato.
+ * @return Il ring, o NULL se manca la memoria.
+ */
+static LogRing *attach_thread(void) {
+    pthread_once(&registry_once, init_registry);
+    pthread_mutex_lock(&registry_mutex);
+
+    LogRing *ring = registry_head;
+    while (ring != NULL && ring->in_use) {
+        ring = ring->next;
+    }
+    if (ring == NULL) {
+        ring = (LogRing *)calloc(1, sizeof(LogRing));
+        if (ring != NULL) {
+            ring->next = registry_head;
+            registry_head = ring;
+        }
+    }
+    if (ring != NULL) {
+        ring->in_use = 1;
+    }
+
+    pthread_mutex_unlock(&registry_mutex);
+
+    if (ring != NULL) {
+        pthread_setspecific(registry_key, ring);
+        local_ring = ring;
+    }
+    return ring;
+}
+
+/**
+ * Copia una stringa nell'area delle stringhe di un record.
+ * @return L'argomento che la descrive: posizione nell'area nei 32 bit alti, lunghezza nei bassi.
+ */
+static uint64_t copy_string(char *strings, size_t *used, const char *s, long max_length) {
+    if (s == NULL) s = "(null)";
+    size_t available = LOG_MAX_STRINGS - *used;
+    size_t length = strnlen(s, max_length >= 0 && (size_t)max_length < available ? (size_t)max_length : available);
+    memcpy(strings + *used, s, length);
+    uint64_t arg = (uint64_t)*used << 32 | length;
+    *used += length;
+    return arg;
+}
+
+/**
+ * Ricava i tipi degli argomenti di una stringa di formato, come li legge printf.
+ * @param fmt Stringa di formato.
+ * @param format Formato da riempire.
+ */
+static void compile_format(const char *fmt, LogFormat *format) {
+    int count = 0;
+    format->fmt = fmt;
+    for (const char *p = fmt; (p = strchr(p, '%')) != NULL && count < LOG_MAX_ARGS; ) {
+        if (p[1] == '%') {
+            p += 2;
+            continue;
+        }
+        LogConversion conv;
+        p = parse_conversion(p + 1, &conv);
+        if (p == NULL) break;
+
+        if (conv.width == -2) {
+            format->types[count++] = LOG_ARG_INT;
+        }
+        if (conv.precision == -2 && count < LOG_MAX_ARGS) {
+            format->types[count++] = LOG_ARG_INT;
+        }
+        if (count >= LOG_MAX_ARGS) break;
+
+        int wide = strcmp(conv.length, "l") == 0 || strcmp(conv.length, "ll") == 0 || strcmp(conv.length, "z") == 0 ||
+                   strcmp(conv.length, "t") == 0 || strcmp(conv.length, "j") == 0;
+        LogArgType type = LOG_ARG_POINTER;
+        switch (conv.conversion) {
+            case 'd': case 'i': type = wide ? LOG_ARG_LONG : LOG_ARG_INT; break;
+            case 'o': case 'u': case 'x': case 'X': type = wide ? LOG_ARG_LONG : LOG_ARG_UINT; break;
+            case 'c': type = LOG_ARG_INT; break;
+            case 's': type = LOG_ARG_STRING; break;
+            case 'p': case 'n': type = LOG_ARG_POINTER; break;
+            default: type = strcmp(conv.length, "L") == 0 ? LOG_ARG_LONG_DOUBLE : LOG_ARG_DOUBLE; break;
+        }
+        format->string_precisions[count] = (int16_t)(conv.precision < -1 ? -2 : conv.precision > INT16_MAX ? INT16_MAX : conv.precision);
+        format->types[count++] = (uint8_t)type;
+    }
+    format->args_count = (uint8_t)count;
+}
+
+/**
+ * Formato di una stringa di formato, dalla cache del thread.
+ */
+static const LogFormat *lookup_format(LogRing *ring, const char *fmt) {
+    LogFormat *format = &ring->formats[((uintptr_t)fmt >> 3) & (LOG_FORMAT_CACHE - 1)];
+    if (format->fmt != fmt) {
+        compile_format(fmt, format);
+    }
+    return format;
+}
+
+/**
+ * Registra un messaggio nel ring del thread corrente, senza formattarlo.
+ * Gli argomenti vengono letti con i tipi ricavati dalla stringa di formato, come farebbe printf;
+ * delle stringhe viene copiata al più la precisione indicata.
+ * @return 0 se il messaggio è stato registrato, -1 se è stato scartato.
+ */
+static int log_async_record(LogKind kind, FILE *stream, const char *tag, const char *fmt, va_list args) {
+    LogRing *ring = local_ring != NULL ? local_ring : attach_thread();
+    if (ring == NULL) return -1;
+
+    const LogFormat *format = lookup_format(ring, fmt);
+    uint64_t values[LOG_MAX_ARGS];
+    size_t args_count = format->args_count;
+    char strings[LOG_MAX_STRINGS]; // Stringhe copiate, in coda al record dopo argomenti e tag
+    size_t strings_used = 0;
+    size_t tag_length = tag != NULL ? strnlen(tag, LOG_MAX_TAG) : 0;
+
+    for (size_t i = 0; i < args_count; i++) {
+        switch (format->types[i]) {
+            case LOG_ARG_INT:
+                values[i] = (uint64_t)(int64_t)va_arg(args, int);
+                break;
+            case LOG_ARG_UINT:
+                values[i] = (uint64_t)va_arg(args, unsigned int);
+                break;
+            case LOG_ARG_LONG:
+                values[i] = (uint64_t)va_arg(args, long long);
+                break;
+            case LOG_ARG_DOUBLE:
+            case LOG_ARG_LONG_DOUBLE: {
+                double d = format->types[i] == LOG_ARG_LONG_DOUBLE ? (double)va_arg(args, long double) : va_arg(args, double);
+                memcpy(&values[i], &d, sizeof(d));
+                break;
+            }
+            case LOG_ARG_STRING: {
+                long precision = format->string_precisions[i];
+                if (precision == -2) precision = i > 0 ? (long)(int64_t)values[i - 1] : -1;
+                values[i] = copy_string(strings, &strings_used, va_arg(args, const char *), precision);
+                break;
+            }
+            default:
+                values[i] = (uint64_t)(uintptr_t)va_arg(args, void *);
+                break;
+        }
+    }
+
+    _Alignas(8) unsigned char record[LOG_MAX_RECORD];
+    size_t used = sizeof(LogRecord) + args_count * sizeof(uint64_t) + tag_length;
+    memcpy(record + sizeof(LogRecord), values, args_count * sizeof(uint64_t));
+    if (tag_length > 0) memcpy(record + used - tag_length, tag, tag_length); // tag NULL: memcpy non ammette puntatori nulli
+    memcpy(record + used, strings, strings_used);
+    size_t record_size = (used + strings_used + 7) & ~(size_t)7;
+
+    LogRecord *header = (LogRecord *)record;
+    header->size = (uint32_t)record_size;
+    header->kind = (uint8_t)kind;
+    header->to_stderr = stream == stderr;
+    header->tag_length = (uint16_t)tag_length;
+    header->args_count = (uint32_t)args_count;
+    header->has_tag = tag != NULL;
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    header->time_ns = (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+    header->fmt = fmt;
+
+    // Copia nel ring: un record non viene mai spezzato, la fine del ring si riempie con un record vuoto
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    size_t position = head % LOG_RING_SIZE;
+    size_t padding = position + record_size > LOG_RING_SIZE ? LOG_RING_SIZE - position : 0;
+    if (head + padding + record_size - tail > LOG_RING_SIZE) {
+        atomic_store_explicit(&ring->dropped, atomic_load_explicit(&ring->dropped, memory_order_relaxed) + 1, memory_order_relaxed);
+        return -1;
+    }
+    if (padding > 0) {
+        LogRecord pad = {.size = (uint32_t)padding, .kind = LOG_RECORD_PAD};
+        memcpy(ring->data + position, &pad, padding < sizeof(pad) ? padding : sizeof(pad));
+        position = 0;
+    }
+    memcpy(ring->data + position, record, record_size);
+    atomic_store_explicit(&ring->head, head + padding + record_size, memory_order_release);
+    return 0;
+}
+
+/**
+ * Scrive un messaggio registrato, formattandolo con la stringa di formato originale.
+ * @param out Stream di destinazione.
+ * @param record Record letto dal ring.
+ */
+static void format_record(FILE *out, const LogRecord *record) {
+    const unsigned char *base = (const unsigned char *)record;
+    const uint64_t *values = (const uint64_t *)(base + sizeof(LogRecord));
+    const char *tag = (const char *)(values + record->args_count);
+    const char *strings = tag + record->tag_length;
+    size_t strings_size = record->size - (size_t)(strings - (const char *)base);
+    uint32_t next = 0;
+
+    time_t seconds = (time_t)(record->time_ns / 1000000000);
+    struct tm local;
+    char time_string[32];
+    localtime_r(&seconds, &local);
+    strftime(time_string, sizeof(time_string), "%Y-%m-%d %H:%M:%S", &local);
+    fprintf(out, "%s.%06ld ", time_string, (long)(record->time_ns % 1000000000 / 1000));
+    write_label(out, (LogKind)record->kind, record->has_tag ? tag : NULL, record->tag_length);
+
+    const char *p = record->fmt;
+    while (*p) {
+        const char *percent = strchr(p, '%');
+        if (percent == NULL) {
+            fputs(p, out);
+            break;
+        }
+        fwrite(p, 1, percent - p, out);
+        if (percent[1] == '%') {
+            fputc('%', out);
+            p = percent + 2;
+            continue;
+        }
+
+        LogConversion conv;
+        const char *end = parse_conversion(percent + 1, &conv);
+        if (end == NULL || next >= record->args_count) {
+            fputs(percent, out); // Come registrato: nessun argomento da usare
+            break;
+        }
+        p = end;
+
+        int width = conv.width, precision = conv.precision;
+        if (width == -2) width = next < record->args_count ? (int)(int64_t)values[next++] : -1;
+        if (precision == -2) precision = next < record->args_count ? (int)(int64_t)values[next++] : -1;
+        if (next >= record->args_count) break;
+        uint64_t value = values[next++];
+
+        // La conversione viene riscritta per l'argomento a 64 bit salvato nel record
+        char spec[32];
+        int spec_length = snprintf(spec, sizeof(spec), "%%%s", conv.flags);
+        if (width >= 0) spec_length += snprintf(spec + spec_length, sizeof(spec) - spec_length, "%d", width);
+        if (conv.conversion == 's') {
+            size_t offset = (size_t)(value >> 32), length = (size_t)(value & 0xFFFFFFFF);
+            if (offset > strings_size) offset = strings_size;
+            if (length > strings_size - offset) length = strings_size - offset;
+            snprintf(spec + spec_length, sizeof(spec) - spec_length, ".*s");
+            fprintf(out, spec, (int)length, strings + offset);
+            continue;
+        }
+        if (precision >= 0) spec_length += snprintf(spec + spec_length, sizeof(spec) - spec_length, ".%d", precision);
+
+        switch (conv.conversion) {
+            case 'd': case 'i': case 'o': case 'u': case 'x': case 'X':
+                snprintf(spec + spec_length, sizeof(spec) - spec_length, "ll%c", conv.conversion);
+                fprintf(out, spec, (long long)value);
+                break;
+            case 'c':
+                snprintf(spec + spec_length, sizeof(spec) - spec_length, "c");
+                fprintf(out, spec, (int)value);
+                break;
+            case 'p':
+                snprintf(spec + spec_length, sizeof(spec) - spec_length, "p");
+                fprintf(out, spec, (void *)(uintptr_t)value);
+                break;
+            case 'n':
+                break;
+            default: {
+                double d;
+                memcpy(&d, &value, sizeof(d));
+                snprintf(spec + spec_length, sizeof(spec) - spec_length, "%c", conv.conversion);
+                fprintf(out, spec, d);
+                break;
+            }
+        }
+    }
+    fputc('\n', out);
+}
+
+/**
+ * Salta i record di riempimento all'inizio della parte da leggere di un ring.
+ * @return Il prossimo record da scrivere, o NULL se il ring non ne ha fino a `head`.
+ */
+static const LogRecord *peek_record(LogRing *ring, uint64_t head) {
+    uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    while (tail < head) {
+        const unsigned char *data = ring->data + tail % LOG_RING_SIZE;
+        uint32_t size;
+        memcpy(&size, data, sizeof(size));
+        if (data[offsetof(LogRecord, kind)] != LOG_RECORD_PAD) {
+            return (const LogRecord *)data;
+        }
+        tail += size;
+        atomic_store_explicit(&ring->tail, tail, memory_order_release);
+    }
+    return NULL;
+}
+
+/**
+ * Scrive i messaggi registrati in tutti i ring fino a questo momento, in ordine di tempo.
+ * @return Numero di messaggi scritti.
+ */
+static int drain_rings(void) {
+    static LogRing **rings = NULL;
+    static uint64_t *heads = NULL;
+    static int rings_capacity = 0;
+
+    pthread_mutex_lock(&registry_mutex);
+    int rings_count = 0;
+    for (LogRing *ring = registry_head; ring != NULL; ring = ring->next) rings_count++;
+    if (rings_count > rings_capacity) {
+        LogRing **new_rings = (LogRing **)realloc(rings, sizeof(LogRing *) * rings_count);
+        if (new_rings != NULL) rings = new_rings;
+        uint64_t *new_heads = (uint64_t *)realloc(heads, sizeof(uint64_t) * rings_count);
+        if (new_heads != NULL) heads = new_heads;
+        if (new_rings == NULL || new_heads == NULL) {
+            pthread_mutex_unlock(&registry_mutex);
+            return 0;
+        }
+        rings_capacity = rings_count;
+    }
+    int i = 0;
+    for (LogRing *ring = registry_head; ring != NULL; ring = ring->next) rings[i++] = ring;
+    pthread_mutex_unlock(&registry_mutex);
+
+    for (i = 0; i < rings_count; i++) {
+        heads[i] = atomic_load_explicit(&rings[i]->head, memory_order_acquire);
+    }
+
+    // Fusione dei ring per istante: i ring sono pochi, basta cercare il minimo a ogni messaggio
+    int written = 0;
+    while (1) {
+        int oldest = -1;
+        const LogRecord *oldest_record = NULL;
+        for (i = 0; i < rings_count; i++) {
+            const LogRecord *record = peek_record(rings[i], heads[i]);
+            if (record != NULL && (oldest_record == NULL || record->time_ns < oldest_record->time_ns)) {
+                oldest = i;
+                oldest_record = record;
+            }
+        }
+        if (oldest_record == NULL) break;
+
+        format_record(oldest_record->to_stderr ? stderr : stdout, oldest_record);
+        uint64_t tail = atomic_load_explicit(&rings[oldest]->tail, memory_order_relaxed);
+        atomic_store_explicit(&rings[oldest]->tail, tail + oldest_record->size, memory_order_release);
+        written++;
+    }
+
+    for (i = 0; i < rings_count; i++) {
+        uint64_t dropped = atomic_load_explicit(&rings[i]->dropped, memory_order_relaxed);
+        if (dropped != rings[i]->dropped_reported) {
+            fprintf(stderr, "%s[WARNING] %s%llu messaggi di log scartati: il buffer di un thread era pieno\n",
+                    use_colors(stderr) ? ANSI_COLOR_YELLOW : "", use_colors(stderr) ? ANSI_COLOR_RESET : "",
+                    (unsigned long long)(dropped - rings[i]->dropped_reported));
+            rings[i]->dropped_reported = dropped;
+        }
+    }
+    if (written > 0) {
+        fflush(stdout);
+        fflush(stderr);
+    }
+    return written;
+}
+
+/**
+ * Scrive subito i messaggi registrati da tutti i thread.
+ */
+void log_flush(void) {
+    pthread_mutex_lock(&flush_mutex);
+    drain_rings();
+    pthread_mutex_unlock(&flush_mutex);
+}
+
+static void *writer_thread_main(void *arg) {
+    (void)arg;
+    struct timespec interval = {0, LOG_FLUSH_INTERVAL_MS * 1000000L};
+
+    while (1) {
+        pthread_mutex_lock(&flush_mutex);
+        int written = drain_rings();
+        pthread_mutex_unlock(&flush_mutex);
+        if (written == 0) {
+            nanosleep(&interval, NULL);
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * Torna alla scrittura sincrona e scrive i messaggi rimasti, all'uscita del processo.
+ */
+static void stop_async(void) {
+    atomic_store(&async_active, 0);
+    log_flush();
+}
+
+/**
+ * Avvia il thread di scrittura: da qui in poi i messaggi per stdout e stderr vengono registrati
+ * nei ring dei thread e scritti in background. All'uscita del processo (exit) i messaggi rimasti
+ * vengono scritti.
+ * @return 0 in caso di successo, -1 in caso di errore (i messaggi restano sincroni).
+ */
+int log_async_start(void) {
+    pthread_t thread_id;
+    if (pthread_create(&thread_id, NULL, writer_thread_main, NULL) != 0) {
+        return -1;
+    }
+    pthread_detach(thread_id);
+    atexit(stop_async);
+    atomic_store(&async_active, 1);
+    return 0;
+}
+
+/**
+ * Scrive un messaggio su uno stream: in modo sincrono, o nel ring del thread se il thread di
+ * scrittura è attivo e lo stream è stdout o stderr. Va chiamata dalle macro LOG_* di debug.h,
+ * dopo aver controllato il livello con log_enabled.
+ */
+void log_write(LogKind kind, FILE *stream, const char *tag, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    if (atomic_load_explicit(&async_active, memory_order_relaxed) && (stream == stdout || stream == stderr)) {
+        log_async_record(kind, stream, tag, fmt, args);
+    } else {
+        // Un solo messaggio alla volta sullo stream, come con una singola fprintf
+        flockfile(stream);
+        write_label(stream, kind, tag, tag != NULL ? (int)strlen(tag) : 0);
+        vfprintf(stream, fmt, args);
+        fputc('\n', stream);
+        funlockfile(stream);
+    }
+    va_end(args);
+}
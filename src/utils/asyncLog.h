@@ -0,0 +1,53 @@
+#ifndef ASYNC_LOG_H
+#define ASYNC_LOG_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+/**
+ * Backend delle macro LOG_* di debug.h.
+ * Di default log_write scrive ogni messaggio subito con fprintf. Dopo log_async_start i
+ * messaggi per stdout e stderr vengono invece copiati in un ring per thread: il record contiene il
+ * puntatore alla stringa di formato, che fa da identificativo, e gli argomenti grezzi letti come
+ * farebbe printf (le stringhe vengono copiate), con i tipi ricavati dalla stringa di formato la
+ * prima volta che il thread la usa. Un thread dedicato legge i ring, ordina i record
+ * per istante, li formatta con data e ora e li scrive a blocchi. Chi scrive un messaggio non
+ * prende lock e non fa chiamate di sistema: se il ring del thread è pieno il messaggio viene
+ * scartato e contato, e il thread di scrittura segnala i messaggi persi.
+ *
+ * Il livello minimo (log_set_level) si cambia a runtime e viene controllato prima di valutare gli
+ * argomenti. I colori ANSI vengono usati solo se lo stream è un terminale.
+ */
+
+#define LOG_RING_SIZE (64 * 1024) // Byte del ring di ogni thread, potenza di 2
+#define LOG_MAX_RECORD 2048 // Byte massimi di un messaggio nel ring, stringhe comprese
+#define LOG_MAX_ARGS 16 // Argomenti registrati di un messaggio, quelli oltre vengono ignorati
+#define LOG_FLUSH_INTERVAL_MS 10 // Attesa del thread di scrittura quando i ring sono vuoti
+
+typedef enum {
+    LOG_KIND_DEBUG,
+    LOG_KIND_INFO,
+    LOG_KIND_WARNING,
+    LOG_KIND_ERROR,
+    LOG_KIND_MSG_ERROR, // Errore nel contenuto di un messaggio, con il livello di LOG_KIND_ERROR
+    LOG_KINDS
+} LogKind;
+
+extern _Atomic int log_min_level;
+
+int log_set_level(const char *name);
+const char *log_level_name(void);
+void log_write(LogKind kind, FILE *stream, const char *tag, const char *fmt, ...) __attribute__((format(printf, 4, 5)));
+int log_async_start(void);
+void log_flush(void);
+
+/**
+ * Indica se un messaggio del tipo indicato supera il livello minimo.
+ */
+static inline int log_enabled(LogKind kind) {
+    int min_level = atomic_load_explicit(&log_min_level, memory_order_relaxed);
+    return (kind == LOG_KIND_MSG_ERROR ? LOG_KIND_ERROR : (int)kind) >= min_level;
+}
+
+#endif // ASYNC_LOG_H
@@ -138,6 +138,40 @@ ListItem *add_node(ListManager *manager, void *ptr) {
     return node;
 }
 
+/**
+ * Aggiunge un puntatore alla lista nel nodo con l'indice indicato, se è libero.
+ * Il nodo va staccato dalla free-list scorrendola dalla testa, quindi il costo è lineare nel
+ * numero di nodi liberi che lo precedono: è pensata per ricreare all'avvio elementi che devono
+ * mantenere il proprio indice, non per l'uso normale.
+ * @return Nodo che contiene il puntatore, o NULL se il nodo è già occupato.
+ */
+ListItem *add_node_at(ListManager *manager, size_t index, void *ptr) {
+    pthread_mutex_lock(&manager->mutex);
+
+    ListItem *node = get_node_nolock(index, manager);
+    if (node->next_free_index == -1) {
+        pthread_mutex_unlock(&manager->mutex);
+        return NULL;
+    }
+
+    if (manager->first_index_free == index) {
+        manager->first_index_free = node->next_free_index;
+    } else {
+        ListItem *previous = get_node_nolock(manager->first_index_free, manager);
+        while ((size_t)previous->next_free_index != index) {
+            previous = get_node_nolock(previous->next_free_index, manager);
+        }
+        previous->next_free_index = node->next_free_index;
+    }
+
+    pthread_mutex_unlock(&manager->mutex);
+
+    node->next_free_index = -1; // Marca come "occupato"
+    node->ptr = ptr;
+
+    return node;
+}
+
 /**
  * Rende un nodo nuovamente disponibile nella free-list.
  * Usa il mutex della lista per garantire l'accesso sicuro alla free-list.
@@ -160,4 +194,29 @@ void release_node(ListManager *manager, size_t index) {
     manager->first_index_free = index;
 
     pthread_mutex_unlock(&manager->mutex);
-}
\ No newline at end of file
+}
+
+/**
+ * Restituisce il primo nodo occupato con indice maggiore o uguale a `*index` e sposta `*index`
+ * subito dopo di esso, per scorrere tutti gli elementi della lista.
+ * Le pagine non ancora allocate vengono saltate senza allocarle.
+ * @param manager Gestore della lista.
+ * @param index Indice da cui riprendere la ricerca, da inizializzare a 0.
+ * @return Nodo trovato, o NULL se non ci sono altri nodi occupati.
+ */
+ListItem *get_next_used_node(ListManager *manager, size_t *index) {
+    while (*index < MAX_ELEMENTS) {
+        size_t page_index = *index >> PAGE_SIZE_BITS;
+        if (manager->pages[page_index] == NULL) {
+            *index = (page_index + 1) << PAGE_SIZE_BITS;
+            continue;
+        }
+
+        ListItem *node = &manager->pages[page_index][*index & (PAGE_SIZE - 1)];
+        (*index)++;
+        if (node->next_free_index == -1 && node->ptr != NULL) {
+            return node;
+        }
+    }
+    return NULL;
+}
@@ -30,6 +30,8 @@ void free_list_manager(ListManager *manager);
 
 ListItem *get_node(size_t index, ListManager *manager);
 ListItem *add_node(ListManager *manager, void *ptr);
+ListItem *add_node_at(ListManager *manager, size_t index, void *ptr);
 void release_node(ListManager *manager, size_t index);
+ListItem *get_next_used_node(ListManager *manager, size_t *index);
 
 #endif // LIST_H
\ No newline at end of file
@@ -0,0 +1,222 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/slab.h"
+
+typedef struct {
+    SlabObject *head; // Oggetti liberi del thread
+    int count;
+} SlabCache;
+
+static SlabPool *pools[SLAB_MAX_POOLS]; // Pool registrati, per slab_pool_stats
+static _Atomic int pools_count = 0;
+static pthread_mutex_t registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static __thread SlabCache thread_caches[SLAB_MAX_POOLS];
+static __thread int thread_registered = 0;
+
+static pthread_once_t cache_once = PTHREAD_ONCE_INIT;
+static pthread_key_t cache_key;
+
+/**
+ * Sposta nella lista condivisa del pool fino a `count` oggetti della cache del thread.
+ */
+static void flush_cache(SlabPool *pool, SlabCache *cache, int count) {
+    if (cache->head == NULL || count <= 0) return;
+
+    SlabObject *first = cache->head;
+    SlabObject *last = first;
+    int moved = 1;
+    while (moved < count && last->next != NULL) {
+        last = last->next;
+        moved++;
+    }
+    cache->head = last->next;
+    cache->count -= moved;
+
+    pthread_mutex_lock(&pool->mutex);
+    last->next = pool->free_list;
+    pool->free_list = first;
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+/**
+ * Restituisce ai pool le cache di un thread che termina.
+ */
+static void release_thread_caches(void *arg) {
+    (void)arg;
+    int count = atomic_load(&pools_count);
+    for (int i = 0; i < count; i++) {
+        flush_cache(pools[i], &thread_caches[i], thread_caches[i].count);
+    }
+}
+
+static void init_cache_key(void) {
+    pthread_key_create(&cache_key, release_thread_caches);
+}
+
+/**
+ * Fa svuotare le cache del thread corrente quando termina.
+ */
+static void register_thread(void) {
+    // Il valore della chiave serve solo a far chiamare il distruttore all'uscita del thread
+    pthread_once(&cache_once, init_cache_key);
+    pthread_setspecific(cache_key, thread_caches);
+    thread_registered = 1;
+}
+
+/**
+ * Registra un pool alla sua prima allocazione.
+ * @return Indice del pool, o -1 se il registro è pieno.
+ */
+static int register_pool(SlabPool *pool) {
+    pthread_mutex_lock(&registry_mutex);
+    int index = atomic_load(&pool->index);
+    if (index < 0) {
+        index = atomic_load(&pools_count);
+        if (index < SLAB_MAX_POOLS) {
+            pools[index] = pool;
+            atomic_store(&pool->index, index);
+            atomic_store(&pools_count, index + 1);
+        } else {
+            index = -1;
+        }
+    }
+    pthread_mutex_unlock(&registry_mutex);
+    return index;
+}
+
+/**
+ * Prende un oggetto dalla lista condivisa, portando nella cache del thread anche fino a
+ * SLAB_REFILL_OBJECTS oggetti successivi. Se la lista è vuota alloca un nuovo gruppo di oggetti,
+ * che tranne il primo finisce nella lista condivisa: un thread di gioco usa pochi oggetti per pool
+ * e non deve trattenerne altri finché non termina.
+ * @return L'oggetto, o NULL se manca la memoria.
+ */
+static SlabObject *refill_cache(SlabPool *pool, SlabCache *cache) {
+    pthread_mutex_lock(&pool->mutex);
+    SlabObject *object = pool->free_list;
+    if (object != NULL) {
+        SlabObject *last = object;
+        for (int i = 0; i < SLAB_REFILL_OBJECTS && last->next != NULL; i++) {
+            last = last->next;
+            cache->count++;
+        }
+        pool->free_list = last->next;
+        last->next = cache->head;
+        cache->head = object->next;
+        pthread_mutex_unlock(&pool->mutex);
+        return object;
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    char *chunk = (char *)malloc(SLAB_CHUNK_OBJECTS * pool->object_size);
+    if (chunk == NULL) return NULL;
+    atomic_fetch_add_explicit(&pool->capacity, SLAB_CHUNK_OBJECTS, memory_order_relaxed);
+
+    SlabObject *first = (SlabObject *)(chunk + pool->object_size);
+    SlabObject *last = first;
+    for (int i = 2; i < SLAB_CHUNK_OBJECTS; i++) {
+        last->next = (SlabObject *)(chunk + i * pool->object_size);
+        last = last->next;
+    }
+    pthread_mutex_lock(&pool->mutex);
+    last->next = pool->free_list;
+    pool->free_list = first;
+    pthread_mutex_unlock(&pool->mutex);
+    return (SlabObject *)chunk;
+}
+
+/**
+ * Alloca un oggetto dal pool. Il contenuto dell'oggetto non è inizializzato.
+ * @return Puntatore all'oggetto, o NULL se manca la memoria.
+ */
+void *slab_alloc(SlabPool *pool) {
+    int index = atomic_load_explicit(&pool->index, memory_order_acquire);
+    if (index < 0 && (index = register_pool(pool)) < 0) {
+        return malloc(pool->object_size); // Senza cache, liberato comunque da slab_free
+    }
+    if (!thread_registered) register_thread();
+
+    SlabCache *cache = &thread_caches[index];
+    SlabObject *object = cache->head;
+    if (object != NULL) {
+        cache->head = object->next;
+        cache->count--;
+    } else if ((object = refill_cache(pool, cache)) == NULL) {
+        return NULL;
+    }
+    atomic_fetch_add_explicit(&pool->in_use, 1, memory_order_relaxed);
+    return object;
+}
+
+/**
+ * Restituisce un oggetto al pool da cui è stato allocato, anche da un thread diverso.
+ * @param object Oggetto da liberare, può essere NULL.
+ */
+void slab_free(SlabPool *pool, void *object) {
+    if (object == NULL) return;
+    int index = atomic_load_explicit(&pool->index, memory_order_acquire);
+    if (index < 0) {
+        free(object);
+        return;
+    }
+    if (!thread_registered) register_thread();
+
+    SlabCache *cache = &thread_caches[index];
+    if (cache->count >= SLAB_CACHED_OBJECTS) {
+        flush_cache(pool, cache, SLAB_CACHED_OBJECTS / 2);
+    }
+    SlabObject *free_object = (SlabObject *)object;
+    free_object->next = cache->head;
+    cache->head = free_object;
+    cache->count++;
+    atomic_fetch_sub_explicit(&pool->in_use, 1, memory_order_relaxed);
+}
+
+/**
+ * Copia una stringa in un oggetto del pool, o sullo heap se non ci sta.
+ * @return La copia, da liberare con slab_free_string sullo stesso pool, o NULL se manca la memoria.
+ */
+char *slab_strdup(SlabPool *pool, const char *s) {
+    size_t length = strlen(s);
+    if (length >= pool->object_size) {
+        return strdup(s);
+    }
+    char *copy = (char *)slab_alloc(pool);
+    if (copy != NULL) {
+        memcpy(copy, s, length + 1);
+    }
+    return copy;
+}
+
+/**
+ * Libera una stringa copiata con slab_strdup: la lunghezza dice da dove è stata allocata.
+ * @param s Stringa da liberare, può essere NULL.
+ */
+void slab_free_string(SlabPool *pool, char *s) {
+    if (s == NULL) return;
+    if (strlen(s) >= pool->object_size) {
+        free(s);
+    } else {
+        slab_free(pool, s);
+    }
+}
+
+/**
+ * Legge l'occupazione dei pool registrati.
+ * @param stats Array in cui scrivere i valori, uno per pool.
+ * @param max_stats Elementi di `stats`.
+ * @return Numero di pool scritti in `stats`.
+ */
+int slab_pool_stats(SlabPoolStats *stats, int max_stats) {
+    int count = atomic_load(&pools_count);
+    if (count > max_stats) count = max_stats;
+    for (int i = 0; i < count; i++) {
+        stats[i].name = pools[i]->name;
+        stats[i].object_size = pools[i]->object_size;
+        stats[i].capacity = atomic_load_explicit(&pools[i]->capacity, memory_order_relaxed);
+        stats[i].in_use = atomic_load_explicit(&pools[i]->in_use, memory_order_relaxed);
+    }
+    return count;
+}
@@ -0,0 +1,66 @@
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#include <pthread.h>
+
+/**
+ * Pool di oggetti della stessa dimensione, per gli oggetti che vengono creati e distrutti di
+ * continuo (partite, stati di gioco, flotte). Gli oggetti vengono allocati a gruppi di
+ * SLAB_CHUNK_OBJECTS e non tornano mai a free: un oggetto liberato finisce nella cache del thread
+ * che lo libera, o nella lista condivisa del pool quando la cache è piena, e viene riusato dalla
+ * prossima slab_alloc. La memoria del pool resta quindi quella del picco di oggetti usati insieme,
+ * senza frammentare lo heap con allocazioni di vita breve.
+ *
+ * Ogni thread tiene fino a SLAB_CACHED_OBJECTS oggetti liberi per pool, senza lock; la lista
+ * condivisa, protetta dal mutex del pool, serve agli oggetti allocati da un thread e liberati da
+ * un altro (la lobby crea la partita, il thread di gioco la libera). La cache di un thread che
+ * termina torna nella lista condivisa.
+ *
+ * I pool si dichiarano come variabili statiche con SLAB_POOL_INITIALIZER e si registrano da soli
+ * alla prima allocazione; slab_pool_stats ne riporta l'occupazione.
+ */
+
+#define SLAB_MAX_POOLS 16 // Pool registrabili nel processo
+#define SLAB_CHUNK_OBJECTS 32 // Oggetti allocati insieme quando il pool non ne ha di liberi
+#define SLAB_CACHED_OBJECTS 16 // Oggetti liberi tenuti da ogni thread per ogni pool
+#define SLAB_REFILL_OBJECTS 4 // Oggetti portati nella cache del thread, oltre a quello richiesto, quando è vuota
+
+typedef struct _SlabObject {
+    struct _SlabObject *next;
+} SlabObject;
+
+typedef struct {
+    const char *name; // Nome del pool nelle metriche
+    size_t object_size; // Dimensione degli oggetti, arrotondata all'allineamento massimo
+    pthread_mutex_t mutex; // Protegge `free_list`
+    SlabObject *free_list; // Oggetti liberi condivisi tra i thread
+    _Atomic int index; // Posizione nel registro e nelle cache dei thread, -1 finché non è registrato
+    _Atomic int64_t capacity; // Oggetti allocati dal pool
+    _Atomic int64_t in_use; // Oggetti restituiti da slab_alloc e non ancora liberati
+} SlabPool;
+
+typedef struct {
+    const char *name;
+    size_t object_size;
+    int64_t capacity;
+    int64_t in_use;
+} SlabPoolStats;
+
+#define SLAB_OBJECT_SIZE(size) \
+    (((size) + _Alignof(max_align_t) - 1) & ~(size_t)(_Alignof(max_align_t) - 1))
+
+#define SLAB_POOL_INITIALIZER(pool_name, type) \
+    {pool_name, SLAB_OBJECT_SIZE(sizeof(type) > sizeof(SlabObject) ? sizeof(type) : sizeof(SlabObject)), \
+     PTHREAD_MUTEX_INITIALIZER, NULL, -1, 0, 0}
+
+void *slab_alloc(SlabPool *pool);
+void slab_free(SlabPool *pool, void *object);
+char *slab_strdup(SlabPool *pool, const char *s);
+void slab_free_string(SlabPool *pool, char *s);
+int slab_pool_stats(SlabPoolStats *stats, int max_stats);
+
+#endif // SLAB_H